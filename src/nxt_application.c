@@ -43,6 +43,14 @@ static void nxt_discovery_quit(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 static nxt_app_module_t *nxt_app_module_load(nxt_task_t *task,
     const char *name);
 static nxt_int_t nxt_app_setup(nxt_task_t *task, nxt_process_t *process);
+#if (NXT_HAVE_CLONE)
+static nxt_int_t nxt_proto_setup(nxt_task_t *task, nxt_process_t *process);
+static nxt_int_t nxt_proto_start(nxt_task_t *task, nxt_process_data_t *data);
+static void nxt_proto_start_process_handler(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg);
+static void nxt_proto_fork(nxt_task_t *task, void *obj, void *data);
+static nxt_int_t nxt_proto_app_setup(nxt_task_t *task, nxt_process_t *process);
+#endif
 static nxt_int_t nxt_app_set_environment(nxt_conf_value_t *environment);
 static u_char *nxt_cstr_dup(nxt_mp_t *mp, u_char *dst, u_char *src);
 
@@ -55,8 +63,24 @@ static uint32_t  compat[] = {
 };
 
 
+#if (NXT_HAVE_CLONE)
+
+typedef struct {
+    nxt_fd_t            fd[2];
+    uint32_t            stream;
+    uint32_t            app_stream;
+} nxt_proto_fork_t;
+
+#endif
+
+
 static nxt_app_module_t  *nxt_app;
 
+#if (NXT_HAVE_CLONE)
+static nxt_process_t     *nxt_proto;
+static uint32_t          nxt_proto_stream;
+#endif
+
 
 static const nxt_port_handlers_t  nxt_discovery_process_port_handlers = {
     .quit         = nxt_signal_quit_handler,
@@ -100,6 +124,38 @@ const nxt_process_init_t  nxt_app_process = {
 };
 
 
+#if (NXT_HAVE_CLONE)
+
+static const nxt_port_handlers_t  nxt_proto_process_port_handlers = {
+    .quit           = nxt_signal_quit_handler,
+    .start_process  = nxt_proto_start_process_handler,
+};
+
+
+const nxt_process_init_t  nxt_proto_process = {
+    .type           = NXT_PROCESS_PROTOTYPE,
+    .setup          = nxt_proto_setup,
+    .prefork        = nxt_isolation_main_prefork,
+    .restart        = 0,
+    .start          = nxt_proto_start,
+    .port_handlers  = &nxt_proto_process_port_handlers,
+    .signals        = nxt_process_signals,
+};
+
+
+static const nxt_process_init_t  nxt_proto_app_process = {
+    .type           = NXT_PROCESS_APP,
+    .setup          = nxt_proto_app_setup,
+    .prefork        = NULL,
+    .restart        = 0,
+    .start          = NULL,     /* set to module->start */
+    .port_handlers  = &nxt_app_process_port_handlers,
+    .signals        = nxt_process_signals,
+};
+
+#endif
+
+
 static nxt_int_t
 nxt_discovery_start(nxt_task_t *task, nxt_process_data_t *data)
 {
@@ -524,6 +580,274 @@ nxt_app_setup(nxt_task_t *task, nxt_process_t *process)
 }
 
 
+#if (NXT_HAVE_CLONE)
+
+/*
+ * The prototype process initializes the application runtime once and
+ * forks application processes on the main process requests.  The processes
+ * are created with CLONE_PARENT to be children of the main process.
+ */
+
+static nxt_int_t
+nxt_proto_setup(nxt_task_t *task, nxt_process_t *process)
+{
+    nxt_int_t           ret;
+    nxt_runtime_t       *rt;
+    nxt_process_init_t  *init;
+
+    ret = nxt_app_setup(task, process);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return ret;
+    }
+
+    ret = nxt_process_apply_creds(task, process);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return ret;
+    }
+
+    /* The forked processes inherit the credentials already applied. */
+
+    rt = task->thread->runtime;
+    rt->capabilities.setid = 0;
+
+    if (nxt_app->prototype != NULL) {
+        ret = nxt_app->prototype(task, &process->data);
+
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+    }
+
+    nxt_proto = process;
+
+    init = nxt_process_init(process);
+
+    init->start = nxt_proto_start;
+
+    process->state = NXT_PROCESS_STATE_READY;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_proto_start(nxt_task_t *task, nxt_process_data_t *data)
+{
+    nxt_log(task, NXT_LOG_INFO, "%s started", nxt_proto->name);
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_proto_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+{
+    nxt_buf_t         *b;
+    nxt_port_t        *main_port;
+    nxt_runtime_t     *rt;
+    nxt_proto_fork_t  *pf;
+
+    b = msg->buf;
+
+    if (nxt_slow_path(msg->fd[0] == -1 || msg->fd[1] == -1
+                      || b == NULL
+                      || nxt_buf_mem_used_size(&b->mem) != sizeof(uint32_t)))
+    {
+        nxt_alert(task, "invalid start process message");
+        goto fail;
+    }
+
+    pf = nxt_malloc(sizeof(nxt_proto_fork_t));
+    if (nxt_slow_path(pf == NULL)) {
+        goto fail;
+    }
+
+    pf->fd[0] = msg->fd[0];
+    pf->fd[1] = msg->fd[1];
+    pf->stream = msg->port_msg.stream;
+
+    nxt_memcpy(&pf->app_stream, b->mem.pos, sizeof(uint32_t));
+
+    msg->fd[0] = -1;
+    msg->fd[1] = -1;
+
+    /*
+     * The process is forked out of the port read handler
+     * since the forked process closes the prototype port.
+     */
+    nxt_work_queue_add(&task->thread->engine->fast_work_queue,
+                       nxt_proto_fork, task, pf, NULL);
+
+    return;
+
+fail:
+
+    rt = task->thread->runtime;
+    main_port = rt->port_by_type[NXT_PROCESS_MAIN];
+
+    (void) nxt_port_socket_write(task, main_port, NXT_PORT_MSG_RPC_ERROR,
+                                 -1, msg->port_msg.stream, 0, NULL);
+}
+
+
+static void
+nxt_proto_fork(nxt_task_t *task, void *obj, void *data)
+{
+    u_char                 *p;
+    uint32_t               stream;
+    nxt_pid_t              pid;
+    nxt_port_t             *port, *main_port;
+    nxt_runtime_t          *rt;
+    nxt_process_t          *process;
+    nxt_proto_fork_t       *pf;
+    nxt_process_init_t     *init;
+    nxt_common_app_conf_t  *app_conf;
+
+    pf = obj;
+
+    rt = task->thread->runtime;
+
+    if (nxt_slow_path(nxt_pid != nxt_proto->pid)) {
+        /* A work inherited by an already forked process. */
+        nxt_fd_close(pf->fd[0]);
+        nxt_fd_close(pf->fd[1]);
+        nxt_free(pf);
+
+        return;
+    }
+
+    stream = pf->stream;
+    app_conf = nxt_proto->data.app;
+
+    port = NULL;
+
+    process = nxt_runtime_process_new(rt);
+    if (nxt_slow_path(process == NULL)) {
+        goto fail;
+    }
+
+    process->mem_pool = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(process->mem_pool == NULL)) {
+        goto fail;
+    }
+
+    init = nxt_process_init(process);
+
+    *init = nxt_proto_app_process;
+
+    init->name = (const char *) app_conf->name.start;
+
+    process->name = nxt_mp_alloc(process->mem_pool, app_conf->name.length
+                                 + sizeof("\"\" application") + 1);
+
+    if (nxt_slow_path(process->name == NULL)) {
+        goto fail;
+    }
+
+    p = (u_char *) process->name;
+    *p++ = '"';
+    p = nxt_cpymem(p, init->name, app_conf->name.length);
+    p = nxt_cpymem(p, "\" application", 13);
+    *p = '\0';
+
+    process->stream = pf->app_stream;
+    process->data.app = app_conf;
+    process->user_cred = nxt_proto->user_cred;
+    process->isolation.clone.flags = CLONE_PARENT;
+
+    port = nxt_port_new(task, 0, 0, NXT_PROCESS_APP);
+    if (nxt_slow_path(port == NULL)) {
+        goto fail;
+    }
+
+    nxt_process_port_add(task, process, port);
+
+    port->pair[0] = pf->fd[0];
+    port->pair[1] = pf->fd[1];
+    port->max_size = 16 * 1024;
+    port->max_share = 64 * 1024;
+    port->socket.task = task;
+
+    nxt_free(pf);
+    pf = NULL;
+
+    nxt_proto_stream = stream;
+
+    pid = nxt_process_create(task, process);
+
+    switch (pid) {
+
+    case -1:
+        goto fail;
+
+    case 0:
+        /* The child process: return to the event engine work queue loop. */
+        break;
+
+    default:
+        nxt_process_close_ports(task, process);
+        break;
+    }
+
+    nxt_port_use(task, port, -1);
+    nxt_process_use(task, process, -1);
+
+    return;
+
+fail:
+
+    if (pf != NULL) {
+        nxt_fd_close(pf->fd[0]);
+        nxt_fd_close(pf->fd[1]);
+        nxt_free(pf);
+    }
+
+    if (port != NULL) {
+        nxt_port_close(task, port);
+        nxt_port_use(task, port, -1);
+    }
+
+    if (process != NULL) {
+        nxt_process_use(task, process, -1);
+    }
+
+    main_port = rt->port_by_type[NXT_PROCESS_MAIN];
+
+    (void) nxt_port_socket_write(task, main_port, NXT_PORT_MSG_RPC_ERROR,
+                                 -1, stream, 0, NULL);
+}
+
+
+static nxt_int_t
+nxt_proto_app_setup(nxt_task_t *task, nxt_process_t *process)
+{
+    nxt_int_t           ret;
+    nxt_port_t          *main_port;
+    nxt_runtime_t       *rt;
+    nxt_process_init_t  *init;
+
+    rt = task->thread->runtime;
+    main_port = rt->port_by_type[NXT_PROCESS_MAIN];
+
+    /* The main process learns the new process pid from this reply. */
+    ret = nxt_port_socket_write(task, main_port, NXT_PORT_MSG_RPC_READY_LAST,
+                                -1, nxt_proto_stream, 0, NULL);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    init = nxt_process_init(process);
+
+    init->start = nxt_app->start;
+
+    process->state = NXT_PROCESS_STATE_CREATED;
+
+    return NXT_OK;
+}
+
+#endif
+
+
 static nxt_app_module_t *
 nxt_app_module_load(nxt_task_t *task, const char *name)
 {
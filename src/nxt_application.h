@@ -99,8 +99,10 @@ struct nxt_common_app_conf_s {
 
     nxt_conf_value_t           *isolation;
     nxt_conf_value_t           *limits;
+    nxt_conf_value_t           *prototype;
 
     size_t                     shm_limit;
+    uint8_t                    preload;  /* 1 bit */
 
     union {
         nxt_external_app_conf_t  external;
@@ -127,6 +129,8 @@ struct nxt_app_module_s {
 
     nxt_application_setup_t    setup;
     nxt_process_start_t        start;
+    /* An optional runtime initialization performed once in prototype. */
+    nxt_process_start_t        prototype;
 };
 
 
@@ -7,637 +7,488 @@
 #include <nxt_main.h>
 
 
-/* A cache time resolution is 10ms. */
-#define                                                                       \
-nxt_cache_time(thr)                                                           \
-    (uint64_t) (nxt_thread_time(thr) * 100)
+struct nxt_cache_s {
+    nxt_thread_spinlock_t     lock;
 
+    nxt_lvlhsh_t              hash;
+    /* The most recently used valid nodes are at the head. */
+    nxt_queue_t               expiry;
+    size_t                    size;
+    size_t                    max_size;
 
-static nxt_int_t nxt_cache_lvlhsh_test(nxt_lvlhsh_query_t *lhq, void *data);
-static nxt_work_handler_t nxt_cache_query_locked(nxt_cache_t *cache,
-    nxt_cache_query_t *q, nxt_lvlhsh_query_t *lhq);
-static nxt_work_handler_t nxt_cache_node_hold(nxt_cache_t *cache,
-    nxt_cache_query_t *q, nxt_lvlhsh_query_t *lhq);
-static nxt_work_handler_t nxt_cache_node_test(nxt_cache_t *cache,
-    nxt_cache_query_t *q);
+    size_t                    node_size;
+    nxt_cache_node_free_t     node_free;
+};
 
-static void nxt_cache_wait_handler(nxt_thread_t *thr, void *obj, void *data);
-static void nxt_cache_timeout_handler(nxt_thread_t *thr, void *obj, void *data);
-static void nxt_cache_wake_handler(nxt_thread_t *thr, void *obj, void *data);
-static ssize_t nxt_cache_release_locked(nxt_cache_t *cache,
-    nxt_cache_query_t *q, u_char *buf, size_t size);
 
-static nxt_cache_node_t *nxt_cache_node_alloc(nxt_cache_t *cache);
-static void nxt_cache_node_free(nxt_cache_t *cache, nxt_cache_node_t *node,
-    nxt_bool_t fast);
-static nxt_cache_query_wait_t *nxt_cache_query_wait_alloc(nxt_cache_t *cache,
-    nxt_bool_t *slow);
-static void nxt_cache_query_wait_free(nxt_cache_t *cache,
-    nxt_cache_query_wait_t *qw);
+static nxt_int_t nxt_cache_hash_test(nxt_lvlhsh_query_t *lhq, void *data);
+static void nxt_cache_wakeup(nxt_task_t *task, nxt_cache_node_t *node,
+    nxt_bool_t valid);
+static nxt_bool_t nxt_cache_delete(nxt_cache_t *cache, nxt_cache_node_t *node);
+static void nxt_cache_node_free(nxt_task_t *task, nxt_cache_t *cache,
+    nxt_cache_node_t *node);
 
 
-/* STUB */
-nxt_int_t nxt_cache_shm_create(nxt_mem_zone_t *pool);
-static void *nxt_cache_shm_alloc(void *data, size_t size, nxt_uint_t nalloc);
-/**/
+static const nxt_lvlhsh_proto_t  nxt_cache_hash_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_cache_hash_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
 
 
-nxt_int_t
-nxt_cache_shm_create(nxt_mem_zone_t *mz)
+/*
+ * "node_size" is the size of a structure that starts with nxt_cache_node_t.
+ * "node_free" frees the data a node refers to, the node itself is freed
+ * by the cache.
+ */
+
+nxt_cache_t *
+nxt_cache_create(size_t node_size, nxt_cache_node_free_t node_free)
 {
     nxt_cache_t  *cache;
 
-    static const nxt_lvlhsh_proto_t  proto  nxt_aligned(64) = {
-        NXT_LVLHSH_LARGE_SLAB,
-        0,
-        nxt_cache_lvlhsh_test,
-        (nxt_lvlhsh_alloc_t) nxt_cache_shm_alloc,
-        (nxt_lvlhsh_free_t) nxt_mem_zone_free,
-    };
-
-    cache = nxt_mem_zone_zalloc(mz, sizeof(nxt_cache_t));
-
-    if (cache == NULL) {
-        return NXT_ERROR;
+    cache = nxt_zalloc(sizeof(nxt_cache_t));
+    if (nxt_slow_path(cache == NULL)) {
+        return NULL;
     }
 
-    cache->proto = &proto;
-    cache->pool = mz;
+    nxt_queue_init(&cache->expiry);
 
-    cache->start_time = nxt_cache_time(nxt_thread());
+    cache->node_size = node_size;
+    cache->node_free = node_free;
 
-    return NXT_OK;
+    return cache;
 }
 
 
-static void *
-nxt_cache_shm_alloc(void *data, size_t size, nxt_uint_t nalloc)
-{
-    return nxt_mem_zone_align(data, size, size);
-}
-
+/*
+ * nxt_cache_query() returns:
+ *   NXT_OK        the node is valid and referenced;
+ *   NXT_DECLINED  the node is not found; if "q->update" is set, a new node
+ *                 is created in the updating state, it is referenced and
+ *                 should be either updated, passed, or cancelled; if the node
+ *                 is a valid "pass" node, no node is created;
+ *   NXT_AGAIN     the node is being updated, "q->handler" will be called
+ *                 in the current engine with a referenced node or with NULL
+ *                 if the update has been cancelled;
+ *   NXT_ERROR     a node could not be created.
+ */
 
-void
-nxt_cache_init(nxt_cache_t *cache)
+nxt_int_t
+nxt_cache_query(nxt_task_t *task, nxt_cache_t *cache, nxt_cache_conf_t *conf,
+    nxt_cache_query_t *q)
 {
-    static const nxt_lvlhsh_proto_t  proto  nxt_aligned(64) = {
-        NXT_LVLHSH_LARGE_MEMALIGN,
-        0,
-        nxt_cache_lvlhsh_test,
-        nxt_lvlhsh_alloc,
-        nxt_lvlhsh_free,
-    };
-
-    cache->proto = &proto;
+    nxt_int_t           ret;
+    nxt_lvlhsh_query_t  lhq;
+    nxt_cache_node_t    *node, *expired;
 
-    cache->start_time = nxt_cache_time(nxt_thread());
-}
+    lhq.key_hash = nxt_djb_hash(q->key.start, q->key.length);
+    lhq.key = q->key;
+    lhq.proto = &nxt_cache_hash_proto;
 
+    q->node = NULL;
+    q->engine = task->thread->engine;
 
-static nxt_int_t
-nxt_cache_lvlhsh_test(nxt_lvlhsh_query_t *lhq, void *data)
-{
-    nxt_cache_node_t  *node;
+    expired = NULL;
 
-    node = data;
+    nxt_thread_spin_lock(&cache->lock);
 
-    if (nxt_str_eq(&lhq->key, node->key_data, node->key_len)) {
-        return NXT_OK;
-    }
+    cache->max_size = conf->max_size;
 
-    return NXT_DECLINED;
-}
+    if (nxt_lvlhsh_find(&cache->hash, &lhq) == NXT_OK) {
+        node = lhq.value;
 
+        if (node->updating) {
+            nxt_debug(task, "cache wait: \"%V\"", &q->key);
 
-nxt_inline void
-nxt_cache_lock(nxt_cache_t *cache)
-{
-    if (cache->shared) {
-        nxt_thread_spin_lock(&cache->lock);
-    }
-}
+            nxt_queue_insert_tail(&node->waiting, &q->link);
 
+            ret = NXT_AGAIN;
+            goto done;
+        }
 
-nxt_inline void
-nxt_cache_unlock(nxt_cache_t *cache)
-{
-    if (cache->shared) {
-        nxt_thread_spin_unlock(&cache->lock);
-    }
-}
+        if (node->expiry > nxt_thread_time(task->thread)) {
 
+            if (node->pass) {
+                nxt_debug(task, "cache pass: \"%V\"", &q->key);
 
-void
-nxt_cache_query(nxt_cache_t *cache, nxt_cache_query_t *q)
-{
-    nxt_thread_t        *thr;
-    nxt_lvlhsh_query_t  lhq;
-    nxt_work_handler_t  handler;
+                ret = NXT_DECLINED;
+                goto done;
+            }
 
-    thr = nxt_thread();
+            nxt_debug(task, "cache hit: \"%V\"", &q->key);
 
-    if (cache != NULL) {
-        lhq.key_hash = nxt_murmur_hash2(q->key_data, q->key_len);
-        lhq.replace = 0;
-        lhq.key.len = q->key_len;
-        lhq.key.data = q->key_data;
-        lhq.proto = cache->proto;
-        lhq.pool = cache->pool;
+            node->count++;
 
-        q->now = nxt_cache_time(thr);
+            nxt_queue_remove(&node->link);
+            nxt_queue_insert_head(&cache->expiry, &node->link);
 
-        nxt_cache_lock(cache);
+            q->node = node;
 
-        handler = nxt_cache_query_locked(cache, q, &lhq);
+            ret = NXT_OK;
+            goto done;
+        }
 
-        nxt_cache_unlock(cache);
+        nxt_debug(task, "cache expired: \"%V\"", &q->key);
 
-    } else {
-        handler = q->state->nocache_handler;
+        if (nxt_cache_delete(cache, node)) {
+            expired = node;
+        }
     }
 
-    handler(thr, q, NULL);
-}
-
+    nxt_debug(task, "cache miss: \"%V\"", &q->key);
 
-static nxt_work_handler_t
-nxt_cache_query_locked(nxt_cache_t *cache, nxt_cache_query_t *q,
-    nxt_lvlhsh_query_t *lhq)
-{
-    nxt_int_t                ret;
-    nxt_time_t               expiry;
-    nxt_cache_node_t         *node;
-    nxt_cache_query_state_t  *state;
+    ret = NXT_DECLINED;
 
-    if (q->hold) {
-        return nxt_cache_node_hold(cache, q, lhq);
+    if (!q->update) {
+        goto done;
     }
 
-    ret = nxt_lvlhsh_find(&cache->lvlhsh, lhq);
-
-    state = q->state;
-
-    if (ret != NXT_OK) {
-        /* NXT_DECLINED */
-        return state->nocache_handler;
+    node = nxt_zalloc(cache->node_size + q->key.length);
+    if (nxt_slow_path(node == NULL)) {
+        ret = NXT_ERROR;
+        goto done;
     }
 
-    node = lhq->value;
-    node->count++;
-    q->node = node;
-
-    expiry = cache->start_time + node->expiry;
+    node->key.length = q->key.length;
+    node->key.start = (u_char *) node + cache->node_size;
+    nxt_memcpy(node->key.start, q->key.start, q->key.length);
 
-    if (q->now < expiry) {
-        return state->ready_handler;
-    }
+    node->key_hash = lhq.key_hash;
+    node->count = 1;
+    node->size = cache->node_size + q->key.length;
+    node->updating = 1;
 
-    q->stale = 1;
+    nxt_queue_init(&node->waiting);
 
-    return state->stale_handler;
-}
+    lhq.key = node->key;
+    lhq.replace = 0;
+    lhq.value = node;
+    lhq.pool = NULL;
 
+    if (nxt_slow_path(nxt_lvlhsh_insert(&cache->hash, &lhq) != NXT_OK)) {
+        nxt_free(node);
 
-static nxt_work_handler_t
-nxt_cache_node_hold(nxt_cache_t *cache, nxt_cache_query_t *q,
-    nxt_lvlhsh_query_t *lhq)
-{
-    nxt_int_t                ret;
-    nxt_bool_t               slow;
-    nxt_cache_node_t         *node, *sentinel;
-    nxt_work_handler_t       handler;
-    nxt_cache_query_wait_t   *qw;
-    nxt_cache_query_state_t  *state;
-
-    state = q->state;
-    sentinel = nxt_cache_node_alloc(cache);
-
-    if (nxt_slow_path(sentinel == NULL)) {
-        return state->error_handler;
+        ret = NXT_ERROR;
+        goto done;
     }
 
-    sentinel->key_data = q->key_data;
-    sentinel->key_len = q->key_len;
-    lhq->value = sentinel;
+    q->node = node;
 
-    /*
-     * Try to insert an empty sentinel node to hold updating
-     * process if there is no existent cache node in cache.
-     */
-    ret = nxt_lvlhsh_insert(&cache->lvlhsh, lhq);
+done:
 
-    if (ret == NXT_OK) {
-        /* The sentinel node was successully added. */
+    nxt_thread_spin_unlock(&cache->lock);
 
-        q->node = sentinel;
-        sentinel->updating = 1;
-        return state->update_handler;
+    if (expired != NULL) {
+        nxt_cache_node_free(task, cache, expired);
     }
 
-    nxt_cache_node_free(cache, sentinel, 1);
-
-    if (ret == NXT_ERROR) {
-        return state->error_handler;
-    }
-
-    /* NXT_DECLINED: a cache node exists. */
+    return ret;
+}
 
-    node = lhq->value;
-    node->count++;
-    q->node = node;
 
-    handler = nxt_cache_node_test(cache, q);
-    if (handler != NULL) {
-        return handler;
-    }
+/*
+ * nxt_cache_query_cancel() stops waiting for an updating node.  It returns
+ * zero if the query handler has already been scheduled.
+ */
 
-    /* Add the node to a wait queue. */
+nxt_bool_t
+nxt_cache_query_cancel(nxt_cache_t *cache, nxt_cache_query_t *q)
+{
+    nxt_bool_t  waiting;
 
-    qw = nxt_cache_query_wait_alloc(cache, &slow);
-    if (nxt_slow_path(qw == NULL)) {
-        return state->error_handler;
-    }
+    nxt_thread_spin_lock(&cache->lock);
 
-    if (slow) {
-        /* The node state may have been changed during slow allocation. */
+    waiting = (q->link.next != &q->link);
 
-        handler = nxt_cache_node_test(cache, q);
-        if (handler != NULL) {
-            nxt_cache_query_wait_free(cache, qw);
-            return handler;
-        }
+    if (waiting) {
+        nxt_queue_remove(&q->link);
+        nxt_queue_self(&q->link);
     }
 
-    qw->query = q;
-    qw->next = node->waiting;
-    qw->busy = 0;
-    qw->deleted = 0;
-    qw->pid = nxt_pid;
-    qw->engine = nxt_thread_event_engine();
-    qw->handler = nxt_cache_wake_handler;
-    qw->cache = cache;
-
-    node->waiting = qw;
+    nxt_thread_spin_unlock(&cache->lock);
 
-    return nxt_cache_wait_handler;
+    return waiting;
 }
 
 
-static nxt_work_handler_t
-nxt_cache_node_test(nxt_cache_t *cache, nxt_cache_query_t *q)
-{
-    nxt_time_t               expiry;
-    nxt_cache_node_t         *node;
-    nxt_cache_query_state_t  *state;
-
-    q->stale = 0;
-    state = q->state;
-    node = q->node;
-
-    expiry = cache->start_time + node->expiry;
-
-    if (q->now < expiry) {
-        return state->ready_handler;
-    }
-
-    /*
-     * A valid stale or empty sentinel cache node.
-     * The sentinel node can be only in updating state.
-     */
+/*
+ * nxt_cache_update() makes an updating node valid until "node->expiry".
+ * The caller keeps its reference.
+ */
 
-    if (node->updating) {
+void
+nxt_cache_update(nxt_task_t *task, nxt_cache_t *cache, nxt_cache_node_t *node)
+{
+    nxt_queue_t       evicted;
+    nxt_queue_link_t  *link;
+    nxt_cache_node_t  *last;
 
-        if (node->expiry != 0) {
-            /* A valid stale cache node. */
+    nxt_queue_init(&evicted);
 
-            q->stale = 1;
+    nxt_thread_spin_lock(&cache->lock);
 
-            if (q->use_stale) {
-                return state->stale_handler;
-            }
-        }
+    if (node->size > cache->max_size) {
+        nxt_thread_spin_unlock(&cache->lock);
 
-        /* A sentinel node. */
-        return NULL;
+        nxt_cache_cancel(task, cache, node);
+        return;
     }
 
-    /* A valid stale cache node is not being updated now. */
+    while (cache->size + node->size > cache->max_size) {
+        link = nxt_queue_last(&cache->expiry);
+        last = nxt_queue_link_data(link, nxt_cache_node_t, link);
 
-    q->stale = 1;
-
-    if (q->use_stale) {
-
-        if (q->update_stale) {
-            node->updating = 1;
-            return state->update_stale_handler;
+        if (nxt_cache_delete(cache, last)) {
+            nxt_queue_insert_tail(&evicted, &last->link);
         }
-
-        return state->stale_handler;
     }
 
-    node->updating = 1;
-    return state->update_handler;
-}
-
+    nxt_debug(task, "cache update: \"%V\", %uz bytes", &node->key, node->size);
 
-static void
-nxt_cache_wait_handler(nxt_thread_t *thr, void *obj, void *data)
-{
-    nxt_event_timer_t  *ev;
-    nxt_cache_query_t  *cq;
+    node->updating = 0;
 
-    cq = obj;
+    nxt_queue_insert_head(&cache->expiry, &node->link);
+    cache->size += node->size;
 
-    if (cq->timeout != 0) {
+    nxt_cache_wakeup(task, node, 1);
 
-        ev = &cq->timer;
+    nxt_thread_spin_unlock(&cache->lock);
 
-        if (ev->state == NXT_EVENT_TIMER_DISABLED) {
-            ev->handler = nxt_cache_timeout_handler;
-            nxt_event_timer_ident(ev, -1);
+    while (!nxt_queue_is_empty(&evicted)) {
+        link = nxt_queue_first(&evicted);
+        nxt_queue_remove(link);
 
-            nxt_event_timer_add(thr->engine, ev, cq->timeout);
-        }
+        nxt_cache_node_free(task, cache,
+                            nxt_queue_link_data(link, nxt_cache_node_t, link));
     }
 }
 
 
-static void
-nxt_cache_timeout_handler(nxt_thread_t *thr, void *obj, void *data)
-{
-    nxt_cache_query_t  *cq;
-    nxt_event_timer_t  *ev;
-
-    ev = obj;
-
-    cq = nxt_event_timer_data(ev, nxt_cache_query_t, timer);
-
-    cq->state->timeout_handler(thr, cq, NULL);
-}
-
+/*
+ * nxt_cache_pass() makes an updating node a valid "pass" node until
+ * "node->expiry".  Waiting queries are woken up without a node, as if
+ * the update has been cancelled.  The caller keeps its reference.
+ */
 
-static void
-nxt_cache_wake_handler(nxt_thread_t *thr, void *obj, void *data)
+void
+nxt_cache_pass(nxt_task_t *task, nxt_cache_t *cache, nxt_cache_node_t *node)
 {
-    nxt_cache_t             *cache;
-    nxt_work_handler_t      handler;
-    nxt_cache_query_t       *q;
-    nxt_cache_query_wait_t  *qw;
-
-    qw = obj;
-    q = qw->query;
-    cache = qw->cache;
+    nxt_queue_t       evicted;
+    nxt_queue_link_t  *link;
+    nxt_cache_node_t  *last;
 
-    nxt_cache_lock(cache);
+    nxt_queue_init(&evicted);
 
-    handler = nxt_cache_node_test(cache, q);
+    nxt_thread_spin_lock(&cache->lock);
 
-    if (handler != NULL) {
-        nxt_cache_query_wait_free(cache, qw);
+    if (node->size > cache->max_size) {
+        nxt_thread_spin_unlock(&cache->lock);
 
-    } else {
-        /* Wait again. */
-        qw->next = q->node->waiting;
-        q->node->waiting = qw;
+        nxt_cache_cancel(task, cache, node);
+        return;
     }
 
-    nxt_cache_unlock(cache);
-
-    handler(thr, q, NULL);
-}
+    while (cache->size + node->size > cache->max_size) {
+        link = nxt_queue_last(&cache->expiry);
+        last = nxt_queue_link_data(link, nxt_cache_node_t, link);
 
+        if (nxt_cache_delete(cache, last)) {
+            nxt_queue_insert_tail(&evicted, &last->link);
+        }
+    }
 
-nxt_int_t
-nxt_cache_update(nxt_cache_t *cache, nxt_cache_query_t *q)
-{
-    nxt_int_t           ret;
-    nxt_cache_node_t    *node;
-    nxt_lvlhsh_query_t  lhq;
-
-    node = q->node;
-
-    node->accessed = nxt_cache_time(nxt_thread()) - cache->start_time;
+    nxt_debug(task, "cache pass: \"%V\"", &node->key);
 
     node->updating = 0;
-    node->count = 1;
-
-    lhq.key_hash = nxt_murmur_hash2(node->key_data, node->key_len);
-    lhq.replace = 1;
-    lhq.key.len = node->key_len;
-    lhq.key.data = node->key_data;
-    lhq.value = node;
-    lhq.proto = cache->proto;
-    lhq.pool = cache->pool;
-
-    nxt_cache_lock(cache);
+    node->pass = 1;
 
-    ret = nxt_lvlhsh_insert(&cache->lvlhsh, &lhq);
+    nxt_queue_insert_head(&cache->expiry, &node->link);
+    cache->size += node->size;
 
-    if (nxt_fast_path(ret != NXT_OK)) {
+    nxt_cache_wakeup(task, node, 0);
 
-        nxt_queue_insert_head(&cache->expiry_queue, &node->link);
+    nxt_thread_spin_unlock(&cache->lock);
 
-        node = lhq.value;
-
-        if (node != NULL) {
-            /* A replaced node. */
-
-            nxt_queue_remove(&node->link);
-
-            if (node->count != 0) {
-                node->deleted = 1;
+    while (!nxt_queue_is_empty(&evicted)) {
+        link = nxt_queue_first(&evicted);
+        nxt_queue_remove(link);
 
-            } else {
-                // delete cache node
-            }
-        }
+        nxt_cache_node_free(task, cache,
+                            nxt_queue_link_data(link, nxt_cache_node_t, link));
     }
-
-    nxt_cache_unlock(cache);
-
-    return ret;
 }
 
 
+/*
+ * nxt_cache_cancel() deletes an updating node.  The caller keeps
+ * its reference.
+ */
+
 void
-nxt_cache_release(nxt_cache_t *cache, nxt_cache_query_t *q)
+nxt_cache_cancel(nxt_task_t *task, nxt_cache_t *cache, nxt_cache_node_t *node)
 {
-    u_char        *p, *data;
-    size_t        size;
-    ssize_t       ret;
-    nxt_thread_t  *thr;
-    u_char        buf[1024];
-
-    thr = nxt_thread();
-    q->now = nxt_cache_time(thr);
+    nxt_lvlhsh_query_t  lhq;
 
-    p = buf;
-    size = sizeof(buf);
+    nxt_debug(task, "cache cancel: \"%V\"", &node->key);
 
-    for ( ;; ) {
-        nxt_cache_lock(cache);
+    lhq.key_hash = node->key_hash;
+    lhq.key = node->key;
+    lhq.proto = &nxt_cache_hash_proto;
+    lhq.pool = NULL;
 
-        ret = nxt_cache_release_locked(cache, q, p, size);
+    nxt_thread_spin_lock(&cache->lock);
 
-        nxt_cache_unlock(cache);
+    (void) nxt_lvlhsh_delete(&cache->hash, &lhq);
 
-        if (ret == 0) {
-            return;
-        }
+    node->updating = 0;
+    node->deleted = 1;
 
-        size = nxt_abs(ret);
+    nxt_cache_wakeup(task, node, 0);
 
-        data = nxt_malloc(size);
+    nxt_thread_spin_unlock(&cache->lock);
+}
 
-        if (data == NULL) {
-            /* TODO: retry */
-            return;
-        }
 
-        if (ret < 0) {
-            p = data;
-            continue;
-        }
+void
+nxt_cache_retain(nxt_cache_t *cache, nxt_cache_node_t *node)
+{
+    nxt_thread_spin_lock(&cache->lock);
 
-        if (p != data) {
-            nxt_memcpy(data, p, size);
-        }
+    node->count++;
 
-        nxt_thread_work_queue_add(thr, &thr->work_queue.main,
-                                  cache->delete_handler, data, NULL, thr->log);
-    }
+    nxt_thread_spin_unlock(&cache->lock);
 }
 
 
-static ssize_t
-nxt_cache_release_locked(nxt_cache_t *cache, nxt_cache_query_t *q,
-    u_char *buf, size_t size)
+void
+nxt_cache_release(nxt_task_t *task, nxt_cache_t *cache, nxt_cache_node_t *node)
 {
-    ssize_t           ret;
-    nxt_cache_node_t  *node;
+    nxt_bool_t  unused;
 
-    node = q->node;
-    node->count--;
+    nxt_thread_spin_lock(&cache->lock);
 
-    if (node->count != 0) {
-        return 0;
-    }
+    node->count--;
 
-    if (!node->deleted) {
-        /*
-         * A cache node is locked whilst its count is non zero.
-         * To minimize number of operations the node's place in expiry
-         * queue can be updated only if the node is not currently used.
-         */
-        node->accessed = q->now - cache->start_time;
+    unused = (node->count == 0 && node->deleted);
 
-        nxt_queue_remove(&node->link);
-        nxt_queue_insert_head(&cache->expiry_queue, &node->link);
+    nxt_thread_spin_unlock(&cache->lock);
 
-        return 0;
+    if (unused) {
+        nxt_cache_node_free(task, cache, node);
     }
+}
 
-    ret = 0;
-#if 0
 
-    ret = cache->delete_copy(cache, node, buf, size);
+/* The cache is destroyed when no request uses it anymore. */
 
-    if (ret < 0) {
-        return ret;
-    }
+void
+nxt_cache_destroy(nxt_task_t *task, nxt_cache_t *cache)
+{
+    nxt_queue_link_t  *link;
+    nxt_cache_node_t  *node;
 
-#endif
+    while (!nxt_queue_is_empty(&cache->expiry)) {
+        link = nxt_queue_first(&cache->expiry);
+        node = nxt_queue_link_data(link, nxt_cache_node_t, link);
 
-    nxt_cache_node_free(cache, node, 0);
+        if (nxt_cache_delete(cache, node)) {
+            nxt_cache_node_free(task, cache, node);
+        }
+    }
 
-    return ret;
+    nxt_free(cache);
 }
 
 
-static nxt_cache_node_t *
-nxt_cache_node_alloc(nxt_cache_t *cache)
+static nxt_int_t
+nxt_cache_hash_test(nxt_lvlhsh_query_t *lhq, void *data)
 {
-    nxt_queue_link_t  *link;
     nxt_cache_node_t  *node;
 
-    link = nxt_queue_first(&cache->free_nodes);
-
-    if (nxt_fast_path(link != nxt_queue_tail(&cache->free_nodes))) {
-        cache->nfree_nodes--;
-        nxt_queue_remove(link);
+    node = data;
 
-        node = nxt_queue_link_data(link, nxt_cache_node_t, link);
-        nxt_memzero(node, sizeof(nxt_cache_node_t));
+    return nxt_strstr_eq(&lhq->key, &node->key) ? NXT_OK : NXT_DECLINED;
+}
 
-        return node;
-    }
 
-    nxt_cache_unlock(cache);
+/*
+ * The handler of a waiting query is posted to the engine of the query,
+ * the node is referenced on behalf of the query while the lock is held.
+ */
 
-    node = cache->alloc(cache->data, sizeof(nxt_cache_node_t));
+static void
+nxt_cache_wakeup(nxt_task_t *task, nxt_cache_node_t *node, nxt_bool_t valid)
+{
+    nxt_queue_link_t    *link;
+    nxt_cache_query_t   *q;
+    nxt_event_engine_t  *engine;
 
-    nxt_cache_lock(cache);
+    engine = task->thread->engine;
 
-    return node;
-}
+    while (!nxt_queue_is_empty(&node->waiting)) {
+        link = nxt_queue_first(&node->waiting);
+        q = nxt_queue_link_data(link, nxt_cache_query_t, link);
 
+        nxt_queue_remove(link);
+        nxt_queue_self(link);
 
-static void
-nxt_cache_node_free(nxt_cache_t *cache, nxt_cache_node_t *node, nxt_bool_t fast)
-{
-    if (fast || cache->nfree_nodes < 32) {
-        nxt_queue_insert_head(&cache->free_nodes, &node->link);
-        cache->nfree_nodes++;
-        return;
-    }
+        if (valid) {
+            node->count++;
+            q->node = node;
+        }
 
-    nxt_cache_unlock(cache);
+        if (q->engine == engine) {
+            nxt_work_queue_add(&engine->fast_work_queue, q->handler, q->task,
+                               q->obj, q->data);
+            continue;
+        }
 
-    cache->free(cache->data, node);
+        nxt_work_set(&q->work, q->handler, q->task, q->obj, q->data);
+        q->work.next = NULL;
 
-    nxt_cache_lock(cache);
+        nxt_event_engine_post(q->engine, &q->work);
+    }
 }
 
 
-static nxt_cache_query_wait_t *
-nxt_cache_query_wait_alloc(nxt_cache_t *cache, nxt_bool_t *slow)
-{
-    nxt_cache_query_wait_t  *qw;
-
-    qw = cache->free_query_wait;
+/*
+ * nxt_cache_delete() removes a valid node from the cache.  It returns
+ * non-zero if the node is not referenced anymore and should be freed
+ * after the lock is released.
+ */
 
-    if (nxt_fast_path(qw != NULL)) {
-        cache->free_query_wait = qw->next;
-        cache->nfree_query_wait--;
+static nxt_bool_t
+nxt_cache_delete(nxt_cache_t *cache, nxt_cache_node_t *node)
+{
+    nxt_lvlhsh_query_t  lhq;
 
-        *slow = 0;
-        return qw;
-    }
+    lhq.key_hash = node->key_hash;
+    lhq.key = node->key;
+    lhq.proto = &nxt_cache_hash_proto;
+    lhq.pool = NULL;
 
-    nxt_cache_unlock(cache);
+    (void) nxt_lvlhsh_delete(&cache->hash, &lhq);
 
-    qw = cache->alloc(cache->data, sizeof(nxt_cache_query_wait_t));
-    *slow = 1;
+    nxt_queue_remove(&node->link);
+    cache->size -= node->size;
 
-    nxt_cache_lock(cache);
+    node->deleted = 1;
 
-    return qw;
+    return (node->count == 0);
 }
 
 
 static void
-nxt_cache_query_wait_free(nxt_cache_t *cache, nxt_cache_query_wait_t *qw)
+nxt_cache_node_free(nxt_task_t *task, nxt_cache_t *cache,
+    nxt_cache_node_t *node)
 {
-    if (cache->nfree_query_wait < 32) {
-        qw->next = cache->free_query_wait;
-        cache->free_query_wait = qw;
-        cache->nfree_query_wait++;
-        return;
-    }
-
-    nxt_cache_unlock(cache);
+    nxt_debug(task, "cache node free: \"%V\"", &node->key);
 
-    cache->free(cache->data, qw);
+    if (cache->node_free != NULL) {
+        cache->node_free(task, node);
+    }
 
-    nxt_cache_lock(cache);
+    nxt_free(node);
 }
@@ -17,6 +17,9 @@
 #include <openssl/x509v3.h>
 #include <openssl/rsa.h>
 #include <openssl/err.h>
+#if (NXT_HAVE_OPENSSL_OCSP)
+#include <openssl/ocsp.h>
+#endif
 
 
 struct nxt_cert_s {
@@ -39,6 +42,39 @@ typedef struct {
 } nxt_cert_item_t;
 
 
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+#define NXT_CERT_OCSP_REFRESH  3600
+#define NXT_CERT_OCSP_RETRY    300
+#define NXT_CERT_OCSP_LEEWAY   300
+#define NXT_CERT_OCSP_TIMEOUT  5
+#define NXT_CERT_OCSP_BUFFER   65536
+
+
+typedef struct {
+    nxt_job_t         job;
+    nxt_task_t        task;
+    nxt_timer_t       timer;
+
+    nxt_array_t       *names;
+    nxt_array_t       *pending;
+    nxt_uint_t        next;
+
+    nxt_fd_t          chain_fd;
+    nxt_fd_t          ocsp_fd;
+
+    nxt_fd_t          response_fd;
+    size_t            response_size;
+
+    nxt_time_t        result;
+    nxt_time_t        interval;
+
+    uint8_t           job_running;  /* 1 bit */
+} nxt_cert_ocsp_t;
+
+#endif
+
+
 static nxt_cert_t *nxt_cert_fd(nxt_task_t *task, nxt_fd_t fd);
 static nxt_cert_t *nxt_cert_bio(nxt_task_t *task, BIO *bio);
 static int nxt_nxt_cert_pem_suffix(char *pem_str, const char *suffix);
@@ -49,10 +85,38 @@ static nxt_conf_value_t *nxt_cert_name_details(nxt_mp_t *mp, X509 *x509,
 static nxt_conf_value_t *nxt_cert_alt_names_details(nxt_mp_t *mp,
     STACK_OF(GENERAL_NAME) *alt_names);
 static void nxt_cert_buf_completion(nxt_task_t *task, void *obj, void *data);
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_int_t nxt_cert_ocsp_name_add(nxt_mp_t *mp, nxt_array_t *names,
+    nxt_conf_value_t *value);
+static void nxt_cert_ocsp_start(nxt_task_t *task);
+static void nxt_cert_ocsp_timer_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_cert_ocsp_next(nxt_task_t *task);
+static void nxt_cert_ocsp_get_handler(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg, void *data);
+static void nxt_cert_ocsp_job_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_cert_ocsp_done(nxt_task_t *task, void *obj, void *data);
+static nxt_time_t nxt_cert_ocsp_fetch(nxt_task_t *task, nxt_str_t *name,
+    nxt_cert_t *cert);
+static nxt_fd_t nxt_cert_ocsp_shm(nxt_task_t *task, nxt_str_t *body);
+static void nxt_cert_ocsp_store(nxt_task_t *task, nxt_str_t *name);
+static u_char *nxt_cert_ocsp_request(nxt_task_t *task, const char *url,
+    u_char *der, size_t len, nxt_str_t *body);
+static nxt_int_t nxt_cert_ocsp_send(nxt_socket_t s, u_char *buf, size_t size);
+#endif
 
 
 static nxt_lvlhsh_t  nxt_cert_info;
 
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_cert_ocsp_t  nxt_cert_ocsp = {
+    .chain_fd = -1,
+    .ocsp_fd = -1,
+    .response_fd = -1,
+};
+#endif
+
 
 nxt_cert_t *
 nxt_cert_mem(nxt_task_t *task, nxt_buf_mem_t *mbuf)
@@ -1127,7 +1191,7 @@ nxt_cert_store_get_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     u_char               *p;
     nxt_int_t            ret;
     nxt_str_t            name;
-    nxt_file_t           file;
+    nxt_file_t           file, ocsp;
     nxt_port_t           *port;
     nxt_runtime_t        *rt;
     nxt_port_msg_type_t  type;
@@ -1140,8 +1204,10 @@ nxt_cert_store_get_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     }
 
     nxt_memzero(&file, sizeof(nxt_file_t));
+    nxt_memzero(&ocsp, sizeof(nxt_file_t));
 
     file.fd = -1;
+    ocsp.fd = -1;
     type = NXT_PORT_MSG_RPC_ERROR;
 
     rt = task->thread->runtime;
@@ -1168,14 +1234,42 @@ nxt_cert_store_get_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
     nxt_free(file.name);
 
-    if (nxt_fast_path(ret == NXT_OK)) {
-        type = NXT_PORT_MSG_RPC_READY_LAST | NXT_PORT_MSG_CLOSE_FD;
+    if (nxt_slow_path(ret != NXT_OK)) {
+        goto error;
+    }
+
+    type = NXT_PORT_MSG_RPC_READY_LAST | NXT_PORT_MSG_CLOSE_FD;
+
+    /*
+     * The OCSP response file is passed along with the certificate,
+     * the router staples its content.  The file is replaced by
+     * nxt_cert_ocsp_store_handler() when the controller fetches
+     * a fresh response.
+     */
+
+    if (rt->ocsp.start != NULL) {
+        ocsp.name = nxt_malloc(rt->ocsp.length + name.length + 1);
+
+        if (nxt_fast_path(ocsp.name != NULL)) {
+            p = nxt_cpymem(ocsp.name, rt->ocsp.start, rt->ocsp.length);
+            p = nxt_cpymem(p, name.start, name.length + 1);
+
+            ret = nxt_file_open(task, &ocsp, NXT_FILE_RDONLY,
+                                NXT_FILE_CREATE_OR_OPEN,
+                                NXT_FILE_OWNER_ACCESS);
+
+            nxt_free(ocsp.name);
+
+            if (nxt_slow_path(ret != NXT_OK)) {
+                ocsp.fd = -1;
+            }
+        }
     }
 
 error:
 
-    (void) nxt_port_socket_write(task, port, type, file.fd,
-                                 msg->port_msg.stream, 0, NULL);
+    (void) nxt_port_socket_write2(task, port, type, file.fd, ocsp.fd,
+                                  msg->port_msg.stream, 0, NULL);
 }
 
 
@@ -1229,4 +1323,975 @@ nxt_cert_store_delete_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
         nxt_free(path);
     }
+
+    if (rt->ocsp.start == NULL) {
+        return;
+    }
+
+    path = nxt_malloc(rt->ocsp.length + name.length + 1);
+
+    if (nxt_fast_path(path != NULL)) {
+        p = nxt_cpymem(path, rt->ocsp.start, rt->ocsp.length);
+        p = nxt_cpymem(p, name.start, name.length + 1);
+
+        if (unlink((char *) path) != 0 && nxt_errno != NXT_ENOENT) {
+            nxt_alert(task, "unlink(\"%FN\") failed %E", path, nxt_errno);
+        }
+
+        nxt_free(path);
+    }
+}
+
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+/*
+ * OCSP responses for certificates used by listeners with "ocsp_stapling"
+ * enabled are fetched by the controller in a thread pool thread, one
+ * certificate at a time, and are written into the state directory files
+ * that the router has opened along with the certificates.
+ */
+
+void
+nxt_cert_ocsp_refresh(nxt_task_t *task, nxt_conf_value_t *conf)
+{
+    nxt_mp_t          *mp;
+    uint32_t          next;
+    nxt_str_t         name;
+    nxt_uint_t        i, n;
+    nxt_array_t       *names;
+    nxt_conf_value_t  *listeners, *listener, *value, *certificate;
+
+    static nxt_str_t  listeners_path = nxt_string("/listeners");
+    static nxt_str_t  stapling_path = nxt_string("/tls/ocsp_stapling");
+    static nxt_str_t  certificate_path = nxt_string("/tls/certificate");
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return;
+    }
+
+    names = nxt_array_create(mp, 4, sizeof(nxt_str_t));
+    if (nxt_slow_path(names == NULL)) {
+        goto fail;
+    }
+
+    listeners = (conf != NULL) ? nxt_conf_get_path(conf, &listeners_path)
+                               : NULL;
+
+    if (listeners != NULL) {
+        next = 0;
+
+        for ( ;; ) {
+            listener = nxt_conf_next_object_member(listeners, &name, &next);
+            if (listener == NULL) {
+                break;
+            }
+
+            value = nxt_conf_get_path(listener, &stapling_path);
+            if (value == NULL || !nxt_conf_get_boolean(value)) {
+                continue;
+            }
+
+            certificate = nxt_conf_get_path(listener, &certificate_path);
+            if (certificate == NULL) {
+                continue;
+            }
+
+            if (nxt_conf_type(certificate) == NXT_CONF_ARRAY) {
+                n = nxt_conf_array_elements_count(certificate);
+
+                for (i = 0; i < n; i++) {
+                    value = nxt_conf_get_array_element(certificate, i);
+
+                    if (nxt_cert_ocsp_name_add(mp, names, value) != NXT_OK) {
+                        goto fail;
+                    }
+                }
+
+            } else if (nxt_cert_ocsp_name_add(mp, names, certificate)
+                       != NXT_OK)
+            {
+                goto fail;
+            }
+        }
+    }
+
+    if (nxt_cert_ocsp.pending != NULL) {
+        nxt_mp_destroy(nxt_cert_ocsp.pending->mem_pool);
+    }
+
+    nxt_cert_ocsp.pending = names;
+
+    if (nxt_cert_ocsp.job_running) {
+        /* The new list is picked up once the current job completes. */
+        return;
+    }
+
+    nxt_cert_ocsp_start(task);
+
+    return;
+
+fail:
+
+    nxt_mp_destroy(mp);
+}
+
+
+static nxt_int_t
+nxt_cert_ocsp_name_add(nxt_mp_t *mp, nxt_array_t *names,
+    nxt_conf_value_t *value)
+{
+    nxt_str_t   name, *item;
+    nxt_uint_t  i;
+
+    nxt_conf_get_string(value, &name);
+
+    item = names->elts;
+
+    for (i = 0; i < names->nelts; i++) {
+        if (nxt_strstr_eq(&item[i], &name)) {
+            return NXT_OK;
+        }
+    }
+
+    item = nxt_array_add(names);
+    if (nxt_slow_path(item == NULL)) {
+        return NXT_ERROR;
+    }
+
+    if (nxt_slow_path(nxt_str_dup(mp, item, &name) == NULL)) {
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_cert_ocsp_start(nxt_task_t *task)
+{
+    nxt_event_engine_t  *engine;
+
+    engine = task->thread->engine;
+
+    if (nxt_cert_ocsp.pending != NULL) {
+        if (nxt_cert_ocsp.names != NULL) {
+            nxt_mp_destroy(nxt_cert_ocsp.names->mem_pool);
+        }
+
+        nxt_cert_ocsp.names = nxt_cert_ocsp.pending;
+        nxt_cert_ocsp.pending = NULL;
+    }
+
+    if (nxt_cert_ocsp.timer.handler == NULL) {
+        nxt_cert_ocsp.task = engine->task;
+
+        nxt_cert_ocsp.timer.bias = NXT_TIMER_DEFAULT_BIAS;
+        nxt_cert_ocsp.timer.work_queue = &engine->fast_work_queue;
+        nxt_cert_ocsp.timer.handler = nxt_cert_ocsp_timer_handler;
+        nxt_cert_ocsp.timer.task = &nxt_cert_ocsp.task;
+        nxt_cert_ocsp.timer.log = nxt_cert_ocsp.task.log;
+    }
+
+    nxt_timer_disable(engine, &nxt_cert_ocsp.timer);
+
+    nxt_cert_ocsp.next = 0;
+    nxt_cert_ocsp.interval = NXT_CERT_OCSP_REFRESH;
+
+    nxt_cert_ocsp_next(task);
+}
+
+
+static void
+nxt_cert_ocsp_timer_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_debug(task, "ocsp refresh timer");
+
+    nxt_cert_ocsp_start(task);
+}
+
+
+static void
+nxt_cert_ocsp_next(nxt_task_t *task)
+{
+    nxt_str_t    *name;
+    nxt_array_t  *names;
+
+    names = nxt_cert_ocsp.names;
+
+    if (names == NULL || nxt_cert_ocsp.next == names->nelts) {
+
+        if (names != NULL && names->nelts != 0) {
+            nxt_debug(task, "ocsp refresh in %T", nxt_cert_ocsp.interval);
+
+            nxt_timer_add(task->thread->engine, &nxt_cert_ocsp.timer,
+                          nxt_cert_ocsp.interval * 1000);
+        }
+
+        return;
+    }
+
+    name = names->elts;
+    name = &name[nxt_cert_ocsp.next];
+
+    nxt_cert_ocsp.job_running = 1;
+
+    nxt_cert_store_get(task, name, names->mem_pool, nxt_cert_ocsp_get_handler,
+                       NULL);
+}
+
+
+static void
+nxt_cert_ocsp_get_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
+    void *data)
+{
+    nxt_runtime_t      *rt;
+    nxt_thread_pool_t  **tp;
+
+    if (msg == NULL || msg->port_msg.type == _NXT_PORT_MSG_RPC_ERROR) {
+        nxt_cert_ocsp.result = NXT_CERT_OCSP_RETRY;
+        nxt_cert_ocsp_done(task, NULL, NULL);
+        return;
+    }
+
+    nxt_cert_ocsp.chain_fd = msg->fd[0];
+    nxt_cert_ocsp.ocsp_fd = msg->fd[1];
+    nxt_cert_ocsp.result = NXT_CERT_OCSP_RETRY;
+
+    if (nxt_cert_ocsp.ocsp_fd == -1) {
+        nxt_cert_ocsp_done(task, NULL, NULL);
+        return;
+    }
+
+    rt = task->thread->runtime;
+    tp = rt->thread_pools->elts;
+
+    nxt_job_init(&nxt_cert_ocsp.job, sizeof(nxt_job_t));
+    nxt_job_set_name(&nxt_cert_ocsp.job, "ocsp fetch");
+
+    nxt_cert_ocsp.job.task = &nxt_cert_ocsp.task;
+    nxt_cert_ocsp.job.data = &nxt_cert_ocsp;
+    nxt_cert_ocsp.job.thread_pool = tp[0];
+    nxt_cert_ocsp.job.abort_handler = nxt_cert_ocsp_done;
+
+    nxt_job_start(task, &nxt_cert_ocsp.job, nxt_cert_ocsp_job_handler);
+}
+
+
+/*
+ * nxt_cert_ocsp_job_handler() runs in a thread pool thread,
+ * it may use only the descriptors and the current certificate name.
+ */
+
+static void
+nxt_cert_ocsp_job_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_str_t    *name;
+    nxt_cert_t   *cert;
+
+    name = nxt_cert_ocsp.names->elts;
+    name = &name[nxt_cert_ocsp.next];
+
+    cert = nxt_cert_fd(task, nxt_cert_ocsp.chain_fd);
+
+    if (cert != NULL) {
+        nxt_cert_ocsp.result = nxt_cert_ocsp_fetch(task, name, cert);
+        nxt_cert_destroy(cert);
+    }
+
+    nxt_job_return(task, &nxt_cert_ocsp.job, nxt_cert_ocsp_done);
+}
+
+
+static void
+nxt_cert_ocsp_done(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_str_t  *name;
+
+    if (nxt_cert_ocsp.chain_fd != -1) {
+        nxt_fd_close(nxt_cert_ocsp.chain_fd);
+        nxt_cert_ocsp.chain_fd = -1;
+    }
+
+    if (nxt_cert_ocsp.ocsp_fd != -1) {
+        nxt_fd_close(nxt_cert_ocsp.ocsp_fd);
+        nxt_cert_ocsp.ocsp_fd = -1;
+    }
+
+    if (nxt_cert_ocsp.response_fd != -1) {
+        name = nxt_cert_ocsp.names->elts;
+
+        nxt_cert_ocsp_store(task, &name[nxt_cert_ocsp.next]);
+    }
+
+    nxt_cert_ocsp.job_running = 0;
+
+    if (nxt_cert_ocsp.pending != NULL) {
+        nxt_cert_ocsp_start(task);
+        return;
+    }
+
+    nxt_cert_ocsp.interval = nxt_min(nxt_cert_ocsp.interval,
+                                     nxt_cert_ocsp.result);
+    nxt_cert_ocsp.next++;
+
+    nxt_cert_ocsp_next(task);
+}
+
+
+/*
+ * Returns the number of seconds after which the response
+ * should be fetched again.
+ */
+
+static nxt_time_t
+nxt_cert_ocsp_fetch(nxt_task_t *task, nxt_str_t *name, nxt_cert_t *cert)
+{
+    int                   day, sec, status, len;
+    u_char                *der, *buf;
+    X509                  *issuer;
+    nxt_str_t             body;
+    nxt_uint_t            i;
+    nxt_time_t            refresh;
+    X509_STORE            *store;
+    OCSP_CERTID           *id;
+    OCSP_REQUEST          *req;
+    OCSP_RESPONSE         *resp;
+    OCSP_BASICRESP        *basic;
+    STACK_OF(X509)        *chain;
+    const unsigned char   *data;
+    ASN1_GENERALIZEDTIME  *thisupd, *nextupd;
+    STACK_OF(OPENSSL_STRING)  *aia;
+
+    refresh = NXT_CERT_OCSP_RETRY;
+
+    der = NULL;
+    buf = NULL;
+    aia = NULL;
+    id = NULL;
+    req = NULL;
+    resp = NULL;
+    basic = NULL;
+    store = NULL;
+    chain = NULL;
+    issuer = NULL;
+
+    for (i = 1; i < cert->count; i++) {
+        if (X509_check_issued(cert->chain[i], cert->chain[0]) == X509_V_OK) {
+            issuer = cert->chain[i];
+            break;
+        }
+    }
+
+    if (issuer == NULL) {
+        nxt_log(task, NXT_LOG_WARN, "no issuer certificate in \"%V\" "
+                "bundle, OCSP stapling ignored", name);
+
+        refresh = NXT_CERT_OCSP_REFRESH;
+        goto done;
+    }
+
+    aia = X509_get1_ocsp(cert->chain[0]);
+
+    if (aia == NULL || sk_OPENSSL_STRING_num(aia) == 0) {
+        nxt_log(task, NXT_LOG_WARN, "no OCSP responder URL in the \"%V\" "
+                "certificate, OCSP stapling ignored", name);
+
+        refresh = NXT_CERT_OCSP_REFRESH;
+        goto done;
+    }
+
+    id = OCSP_cert_to_id(NULL, cert->chain[0], issuer);
+    req = OCSP_REQUEST_new();
+
+    if (id == NULL || req == NULL
+        || OCSP_request_add0_id(req, OCSP_CERTID_dup(id)) == NULL)
+    {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "failed to create OCSP request");
+        goto done;
+    }
+
+    len = i2d_OCSP_REQUEST(req, &der);
+    if (len <= 0) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "i2d_OCSP_REQUEST() failed");
+        goto done;
+    }
+
+    buf = nxt_cert_ocsp_request(task, sk_OPENSSL_STRING_value(aia, 0),
+                                der, len, &body);
+    if (buf == NULL) {
+        goto done;
+    }
+
+    data = body.start;
+
+    resp = d2i_OCSP_RESPONSE(NULL, &data, body.length);
+    if (resp == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "d2i_OCSP_RESPONSE() failed for \"%V\"", name);
+        goto done;
+    }
+
+    status = OCSP_response_status(resp);
+
+    if (status != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+        nxt_log(task, NXT_LOG_ERR, "OCSP responder sent error status %d "
+                "(%s) for \"%V\"", status,
+                OCSP_response_status_str(status), name);
+        goto done;
+    }
+
+    basic = OCSP_response_get1_basic(resp);
+    store = X509_STORE_new();
+    chain = sk_X509_new_null();
+
+    if (basic == NULL || store == NULL || chain == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "failed to process OCSP response");
+        goto done;
+    }
+
+    for (i = 1; i < cert->count; i++) {
+        if (sk_X509_push(chain, cert->chain[i]) == 0) {
+            goto done;
+        }
+    }
+
+    /* The issuer is trusted as far as its own certificate is concerned. */
+
+    if (X509_STORE_add_cert(store, issuer) != 1) {
+        goto done;
+    }
+
+    X509_STORE_set_flags(store, X509_V_FLAG_PARTIAL_CHAIN);
+
+    if (OCSP_basic_verify(basic, chain, store, 0) != 1) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "OCSP response verification failed for \"%V\"",
+                              name);
+        goto done;
+    }
+
+    if (OCSP_resp_find_status(basic, id, &status, NULL, NULL,
+                              &thisupd, &nextupd)
+        != 1)
+    {
+        nxt_log(task, NXT_LOG_ERR, "certificate status not found in "
+                "the OCSP response for \"%V\"", name);
+        goto done;
+    }
+
+    if (status != V_OCSP_CERTSTATUS_GOOD) {
+        nxt_log(task, NXT_LOG_ERR, "certificate status \"%s\" in the OCSP "
+                "response for \"%V\"", OCSP_cert_status_str(status), name);
+        goto done;
+    }
+
+    if (OCSP_check_validity(thisupd, nextupd, NXT_CERT_OCSP_LEEWAY, -1) != 1) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR, "OCSP response is not "
+                              "valid for \"%V\"", name);
+        goto done;
+    }
+
+    /*
+     * The response is passed to the main process, which replaces
+     * the response file and pushes the new file to the router.
+     */
+
+    nxt_cert_ocsp.response_fd = nxt_cert_ocsp_shm(task, &body);
+
+    if (nxt_cert_ocsp.response_fd == -1) {
+        nxt_alert(task, "failed to save OCSP response for \"%V\"", name);
+        goto done;
+    }
+
+    nxt_cert_ocsp.response_size = body.length;
+
+    refresh = NXT_CERT_OCSP_REFRESH;
+
+    if (nextupd != NULL && ASN1_TIME_diff(&day, &sec, NULL, nextupd) == 1) {
+        refresh = nxt_min(refresh, (nxt_time_t) day * 86400 + sec
+                                   - NXT_CERT_OCSP_LEEWAY);
+        refresh = nxt_max(refresh, NXT_CERT_OCSP_RETRY);
+    }
+
+done:
+
+    ERR_clear_error();
+
+    sk_X509_free(chain);
+    X509_STORE_free(store);
+    OCSP_BASICRESP_free(basic);
+    OCSP_RESPONSE_free(resp);
+    OCSP_REQUEST_free(req);
+    OCSP_CERTID_free(id);
+    OPENSSL_free(der);
+
+    if (aia != NULL) {
+        X509_email_free(aia);
+    }
+
+    if (buf != NULL) {
+        nxt_free(buf);
+    }
+
+    return refresh;
+}
+
+
+static nxt_fd_t
+nxt_cert_ocsp_shm(nxt_task_t *task, nxt_str_t *body)
+{
+    void      *mem;
+    nxt_fd_t  fd;
+
+    fd = nxt_shm_open(task, body->length);
+    if (nxt_slow_path(fd == -1)) {
+        return -1;
+    }
+
+    mem = nxt_mem_mmap(NULL, body->length, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    if (nxt_slow_path(mem == MAP_FAILED)) {
+        nxt_fd_close(fd);
+        return -1;
+    }
+
+    nxt_memcpy(mem, body->start, body->length);
+
+    nxt_mem_munmap(mem, body->length);
+
+    return fd;
+}
+
+
+static void
+nxt_cert_ocsp_store(nxt_task_t *task, nxt_str_t *name)
+{
+    nxt_fd_t       fd;
+    nxt_buf_t      *b;
+    nxt_port_t     *main_port;
+    nxt_runtime_t  *rt;
+
+    fd = nxt_cert_ocsp.response_fd;
+    nxt_cert_ocsp.response_fd = -1;
+
+    b = nxt_buf_mem_alloc(task->thread->engine->mem_pool,
+                          sizeof(size_t) + name->length + 1, 0);
+
+    if (nxt_slow_path(b == NULL)) {
+        nxt_fd_close(fd);
+        return;
+    }
+
+    b->mem.free = nxt_cpymem(b->mem.free, &nxt_cert_ocsp.response_size,
+                             sizeof(size_t));
+    b->mem.free = nxt_cpymem(b->mem.free, name->start, name->length);
+    *b->mem.free++ = '\0';
+
+    rt = task->thread->runtime;
+    main_port = rt->port_by_type[NXT_PROCESS_MAIN];
+
+    (void) nxt_port_socket_write(task, main_port,
+                                 NXT_PORT_MSG_OCSP_STORE | NXT_PORT_MSG_CLOSE_FD,
+                                 fd, 0, 0, b);
+}
+
+
+/*
+ * nxt_cert_ocsp_store_handler() runs in the main process: the response
+ * is written to a temporary file outside of the OCSP directory, so it
+ * cannot clash with a certificate name, and is renamed over the response
+ * file.  The router gets the new file descriptor, so a response is never
+ * read while it is being written.
+ */
+
+void
+nxt_cert_ocsp_store_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+{
+    void             *mem;
+    u_char           *p;
+    size_t           size;
+    ssize_t          n;
+    nxt_buf_t        *b;
+    nxt_str_t        name;
+    nxt_file_t       file;
+    nxt_port_t       *router_port;
+    nxt_runtime_t    *rt;
+    nxt_file_name_t  *path, *tmp;
+
+    rt = task->thread->runtime;
+
+    if (nxt_slow_path(msg->fd[0] == -1)) {
+        nxt_alert(task, "ocsp_store_handler: invalid shm fd");
+        return;
+    }
+
+    if (nxt_slow_path(nxt_buf_mem_used_size(&msg->buf->mem)
+                      <= (ssize_t) sizeof(size_t)
+                      || rt->ocsp.start == NULL))
+    {
+        nxt_alert(task, "ocsp_store_handler: invalid message");
+
+        nxt_fd_close(msg->fd[0]);
+        msg->fd[0] = -1;
+        return;
+    }
+
+    nxt_memcpy(&size, msg->buf->mem.pos, sizeof(size_t));
+
+    name.start = msg->buf->mem.pos + sizeof(size_t);
+    name.length = nxt_strlen(name.start);
+
+    mem = nxt_mem_mmap(NULL, size, PROT_READ, MAP_SHARED, msg->fd[0], 0);
+
+    nxt_fd_close(msg->fd[0]);
+    msg->fd[0] = -1;
+
+    if (nxt_slow_path(mem == MAP_FAILED)) {
+        return;
+    }
+
+    path = nxt_malloc(rt->ocsp.length + name.length + 1);
+    tmp = nxt_malloc(rt->ocsp.length + nxt_length(".tmp"));
+
+    if (nxt_slow_path(path == NULL || tmp == NULL)) {
+        goto fail;
+    }
+
+    p = nxt_cpymem(path, rt->ocsp.start, rt->ocsp.length);
+    p = nxt_cpymem(p, name.start, name.length + 1);
+
+    /* rt->ocsp ends with a slash. */
+
+    p = nxt_cpymem(tmp, rt->ocsp.start, rt->ocsp.length - 1);
+    nxt_memcpy(p, ".tmp", sizeof(".tmp"));
+
+    nxt_memzero(&file, sizeof(nxt_file_t));
+
+    file.name = tmp;
+
+    if (nxt_slow_path(nxt_file_open(task, &file, NXT_FILE_WRONLY,
+                                    NXT_FILE_TRUNCATE, NXT_FILE_OWNER_ACCESS)
+                      != NXT_OK))
+    {
+        goto fail;
+    }
+
+    n = nxt_file_write(&file, mem, size, 0);
+
+    nxt_file_close(task, &file);
+
+    if (nxt_slow_path(n != (ssize_t) size)) {
+        (void) nxt_file_delete(tmp);
+        goto fail;
+    }
+
+    if (nxt_slow_path(nxt_file_rename(tmp, path) != NXT_OK)) {
+        goto fail;
+    }
+
+    nxt_debug(task, "OCSP response for \"%V\" saved", &name);
+
+    router_port = rt->port_by_type[NXT_PROCESS_ROUTER];
+
+    if (router_port == NULL) {
+        goto done;
+    }
+
+    file.name = path;
+
+    if (nxt_slow_path(nxt_file_open(task, &file, NXT_FILE_RDONLY,
+                                    NXT_FILE_OPEN, 0)
+                      != NXT_OK))
+    {
+        goto done;
+    }
+
+    b = nxt_buf_mem_alloc(task->thread->engine->mem_pool, name.length + 1, 0);
+
+    if (nxt_slow_path(b == NULL)) {
+        nxt_file_close(task, &file);
+        goto done;
+    }
+
+    b->mem.free = nxt_cpymem(b->mem.free, name.start, name.length + 1);
+
+    (void) nxt_port_socket_write(task, router_port,
+                                 NXT_PORT_MSG_OCSP_UPDATE
+                                 | NXT_PORT_MSG_CLOSE_FD,
+                                 file.fd, 0, 0, b);
+
+    goto done;
+
+fail:
+
+    nxt_alert(task, "failed to store OCSP response for \"%V\"", &name);
+
+done:
+
+    nxt_mem_munmap(mem, size);
+
+    if (path != NULL) {
+        nxt_free(path);
+    }
+
+    if (tmp != NULL) {
+        nxt_free(tmp);
+    }
+}
+
+
+/*
+ * A minimal blocking HTTP/1.0 client: OCSP responders are plain HTTP
+ * servers and the job thread may block, but only for a limited time.
+ */
+
+static u_char *
+nxt_cert_ocsp_request(nxt_task_t *task, const char *url, u_char *der,
+    size_t len, nxt_str_t *body)
+{
+    int              err;
+    u_char           *buf, *p, *end, *host_end;
+    size_t           size;
+    ssize_t          n;
+    nxt_str_t        host, port, path;
+    nxt_socket_t     s;
+    struct timeval   tv;
+    struct addrinfo  hint, *res, *r;
+
+    u_char           host_buf[256], port_buf[8];
+
+    buf = NULL;
+    res = NULL;
+    s = -1;
+
+    p = (u_char *) url;
+    end = p + nxt_strlen(url);
+
+    if (end - p < 7 || nxt_strncasecmp(p, (u_char *) "http://", 7) != 0) {
+        nxt_log(task, NXT_LOG_WARN, "unsupported OCSP responder URL \"%s\"",
+                url);
+        return NULL;
+    }
+
+    p += 7;
+
+    path.start = nxt_memchr(p, '/', end - p);
+
+    if (path.start == NULL) {
+        nxt_str_set(&path, "/");
+        host_end = end;
+
+    } else {
+        path.length = end - path.start;
+        host_end = path.start;
+    }
+
+    host.start = p;
+
+    if (p < host_end && *p == '[') {
+        /* An IPv6 address literal. */
+
+        host.start = p + 1;
+
+        p = nxt_memchr(p, ']', host_end - p);
+        if (p == NULL) {
+            goto invalid;
+        }
+
+        host.length = p - host.start;
+        p++;
+
+    } else {
+        p = nxt_memchr(p, ':', host_end - p);
+
+        if (p == NULL) {
+            p = host_end;
+        }
+
+        host.length = p - host.start;
+    }
+
+    if (p < host_end && *p == ':') {
+        port.start = p + 1;
+        port.length = host_end - port.start;
+
+    } else if (p == host_end) {
+        nxt_str_set(&port, "80");
+
+    } else {
+        goto invalid;
+    }
+
+    if (host.length == 0 || host.length >= sizeof(host_buf)
+        || port.length == 0 || port.length >= sizeof(port_buf))
+    {
+        goto invalid;
+    }
+
+    nxt_cpystrn(host_buf, host.start, host.length + 1);
+    nxt_cpystrn(port_buf, port.start, port.length + 1);
+
+    nxt_memzero(&hint, sizeof(struct addrinfo));
+    hint.ai_socktype = SOCK_STREAM;
+
+    err = getaddrinfo((char *) host_buf, (char *) port_buf, &hint, &res);
+
+    if (err != 0) {
+        nxt_log(task, NXT_LOG_ERR, "getaddrinfo(\"%s\") failed (%d: %s)",
+                host_buf, err, gai_strerror(err));
+        return NULL;
+    }
+
+    tv.tv_sec = NXT_CERT_OCSP_TIMEOUT;
+    tv.tv_usec = 0;
+
+    for (r = res; r != NULL; r = r->ai_next) {
+        s = socket(r->ai_family, SOCK_STREAM, 0);
+        if (s == -1) {
+            continue;
+        }
+
+        (void) setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        (void) setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        if (connect(s, r->ai_addr, r->ai_addrlen) == 0) {
+            break;
+        }
+
+        nxt_socket_close(task, s);
+        s = -1;
+    }
+
+    freeaddrinfo(res);
+
+    if (s == -1) {
+        nxt_log(task, NXT_LOG_ERR, "failed to connect to OCSP responder "
+                "\"%s\" %E", url, nxt_errno);
+        return NULL;
+    }
+
+    size = nxt_max(NXT_CERT_OCSP_BUFFER, path.length + host.length + 256);
+
+    buf = nxt_malloc(size);
+    if (nxt_slow_path(buf == NULL)) {
+        goto fail;
+    }
+
+    end = nxt_sprintf(buf, buf + size,
+                      "POST %V HTTP/1.0\r\n"
+                      "Host: %V\r\n"
+                      "Content-Type: application/ocsp-request\r\n"
+                      "Content-Length: %uz\r\n\r\n",
+                      &path, &host, len);
+
+    if (nxt_cert_ocsp_send(s, buf, end - buf) != NXT_OK
+        || nxt_cert_ocsp_send(s, der, len) != NXT_OK)
+    {
+        nxt_log(task, NXT_LOG_ERR, "failed to send OCSP request to "
+                "\"%s\" %E", url, nxt_errno);
+        goto fail;
+    }
+
+    p = buf;
+    end = buf + size;
+
+    while (p < end) {
+        n = recv(s, p, end - p, 0);
+
+        if (n > 0) {
+            p += n;
+            continue;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        if (nxt_errno == NXT_EINTR) {
+            continue;
+        }
+
+        nxt_log(task, NXT_LOG_ERR, "failed to read OCSP response from "
+                "\"%s\" %E", url, nxt_errno);
+        goto fail;
+    }
+
+    if (p == end) {
+        nxt_log(task, NXT_LOG_ERR, "too large OCSP response from \"%s\"",
+                url);
+        goto fail;
+    }
+
+    end = p;
+
+    if (end - buf < 12
+        || nxt_memcmp(buf, "HTTP/1.", 7) != 0
+        || nxt_memcmp(buf + 8, " 200", 4) != 0)
+    {
+        nxt_log(task, NXT_LOG_ERR, "OCSP responder \"%s\" failed: \"%*s\"",
+                url, (size_t) nxt_min(end - buf, 12), buf);
+        goto fail;
+    }
+
+    p = nxt_memstrn(buf, end, "\r\n\r\n", 4);
+    if (p == NULL) {
+        nxt_log(task, NXT_LOG_ERR, "invalid response from OCSP responder "
+                "\"%s\"", url);
+        goto fail;
+    }
+
+    body->start = p + 4;
+    body->length = end - body->start;
+
+    nxt_socket_close(task, s);
+
+    return buf;
+
+invalid:
+
+    nxt_log(task, NXT_LOG_WARN, "invalid OCSP responder URL \"%s\"", url);
+
+    return NULL;
+
+fail:
+
+    if (buf != NULL) {
+        nxt_free(buf);
+    }
+
+    nxt_socket_close(task, s);
+
+    return NULL;
 }
+
+
+static nxt_int_t
+nxt_cert_ocsp_send(nxt_socket_t s, u_char *buf, size_t size)
+{
+    ssize_t  n;
+
+    while (size != 0) {
+        n = send(s, buf, size, 0);
+
+        if (n > 0) {
+            buf += n;
+            size -= n;
+            continue;
+        }
+
+        if (n == -1 && nxt_errno == NXT_EINTR) {
+            continue;
+        }
+
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+#endif
@@ -29,4 +29,9 @@ void nxt_cert_store_delete(nxt_task_t *task, nxt_str_t *name, nxt_mp_t *mp);
 void nxt_cert_store_get_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg);
 void nxt_cert_store_delete_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg);
 
+#if (NXT_HAVE_OPENSSL_OCSP)
+void nxt_cert_ocsp_refresh(nxt_task_t *task, nxt_conf_value_t *conf);
+void nxt_cert_ocsp_store_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg);
+#endif
+
 #endif /* _NXT_CERT_INCLUDED_ */
@@ -106,6 +106,12 @@ static nxt_int_t nxt_conf_vldt_ticket_key_element(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value);
 #endif
 #endif
+static nxt_int_t nxt_conf_vldt_open_file_cache_number(
+    nxt_conf_validation_t *vldt, nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_var_key(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_cache_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_action(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_pass(nxt_conf_validation_t *vldt,
@@ -122,10 +128,26 @@ static nxt_int_t nxt_conf_vldt_python_path_element(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value);
 static nxt_int_t nxt_conf_vldt_python_protocol(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+#if (NXT_HAVE_ZLIB)
+static nxt_int_t nxt_conf_vldt_compress_min_length(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_compress_level(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+#endif
 static nxt_int_t nxt_conf_vldt_threads(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_thread_stack_size(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_cpu(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value);
+static nxt_int_t nxt_conf_vldt_access_log(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_access_log_format(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_access_log_buffer(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_access_log_flush(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_routes(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_routes_member(nxt_conf_validation_t *vldt,
@@ -166,6 +188,8 @@ static nxt_int_t nxt_conf_vldt_object(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_processes(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_processes_scaling(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_object_iterator(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_array_iterator(nxt_conf_validation_t *vldt,
@@ -190,6 +214,14 @@ static nxt_int_t nxt_conf_vldt_java_option(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value);
 static nxt_int_t nxt_conf_vldt_upstream(nxt_conf_validation_t *vldt,
      nxt_str_t *name, nxt_conf_value_t *value);
+static nxt_int_t nxt_conf_vldt_upstream_balance(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_upstream_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_health_check_uri(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_health_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_server(nxt_conf_validation_t *vldt,
     nxt_str_t *name, nxt_conf_value_t *value);
 static nxt_int_t nxt_conf_vldt_server_weight(nxt_conf_validation_t *vldt,
@@ -212,14 +244,24 @@ static nxt_int_t nxt_conf_vldt_clone_gidmap(nxt_conf_validation_t *vldt,
 
 static nxt_conf_vldt_object_t  nxt_conf_vldt_setting_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_http_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_router_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_access_log_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_websocket_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_proxy_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_static_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_open_file_cache_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_http_cache_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_cache_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_client_ip_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_health_check_members[];
 #if (NXT_TLS)
 static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_session_members[];
 #endif
 static nxt_conf_vldt_object_t  nxt_conf_vldt_match_members[];
+#if (NXT_HAVE_ZLIB)
+static nxt_conf_vldt_object_t  nxt_conf_vldt_compress_members[];
+#endif
 static nxt_conf_vldt_object_t  nxt_conf_vldt_python_target_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_php_common_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_php_options_members[];
@@ -227,6 +269,8 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_php_target_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_common_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_limits_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_processes_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_prototype_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_python_prototype_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_isolation_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_namespaces_members[];
 #if (NXT_HAVE_ISOLATION_ROOTFS)
@@ -261,7 +305,31 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_root_members[] = {
         .u.object   = nxt_conf_vldt_upstream,
     }, {
         .name       = nxt_string("access_log"),
+        .type       = NXT_CONF_VLDT_STRING | NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_access_log,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_access_log_members[] = {
+    {
+        .name       = nxt_string("path"),
         .type       = NXT_CONF_VLDT_STRING,
+        .flags      = NXT_CONF_VLDT_REQUIRED,
+    }, {
+        .name       = nxt_string("format"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_access_log_format,
+    }, {
+        .name       = nxt_string("buffer_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_access_log_buffer,
+    }, {
+        .name       = nxt_string("flush_interval"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_access_log_flush,
     },
 
     NXT_CONF_VLDT_END
@@ -274,6 +342,26 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_setting_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_http_members,
+    }, {
+        .name       = nxt_string("router"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_router_members,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_router_members[] = {
+    {
+        .name       = nxt_string("cpu_affinity"),
+        .type       = NXT_CONF_VLDT_ARRAY,
+        .validator  = nxt_conf_vldt_array_iterator,
+        .u.array    = nxt_conf_vldt_cpu,
+    }, {
+        .name       = nxt_string("numa"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
     NXT_CONF_VLDT_END
@@ -305,16 +393,32 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_http_members[] = {
     }, {
         .name       = nxt_string("discard_unsafe_fields"),
         .type       = NXT_CONF_VLDT_BOOLEAN,
+    }, {
+        .name       = nxt_string("body_streaming"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+    }, {
+        .name       = nxt_string("http2"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     }, {
         .name       = nxt_string("websocket"),
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_websocket_members,
+    }, {
+        .name       = nxt_string("proxy"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_proxy_members,
     }, {
         .name       = nxt_string("static"),
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_static_members,
+    }, {
+        .name       = nxt_string("cache"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_http_cache_members,
     },
 
     NXT_CONF_VLDT_END
@@ -338,11 +442,100 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_websocket_members[] = {
 };
 
 
+static nxt_conf_vldt_object_t  nxt_conf_vldt_proxy_members[] = {
+    {
+        .name       = nxt_string("keepalive"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("keepalive_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
 static nxt_conf_vldt_object_t  nxt_conf_vldt_static_members[] = {
     {
         .name       = nxt_string("mime_types"),
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_mtypes,
+    }, {
+        .name       = nxt_string("open_file_cache"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_open_file_cache_members,
+    }, {
+        .name       = nxt_string("threads"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_threads,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_open_file_cache_members[] = {
+    {
+        .name       = nxt_string("max"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_open_file_cache_number,
+        .u.string   = "max",
+    }, {
+        .name       = nxt_string("inactive"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_open_file_cache_number,
+        .u.string   = "inactive",
+    }, {
+        .name       = nxt_string("valid"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_open_file_cache_number,
+        .u.string   = "valid",
+    }, {
+        .name       = nxt_string("errors"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_int_t
+nxt_conf_vldt_open_file_cache_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  num;
+
+    num = nxt_conf_get_number(value);
+
+    if (num < 0 || num > NXT_INT32_T_MAX / 1000) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                   "0 and %d.", data, NXT_INT32_T_MAX / 1000);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_http_cache_members[] = {
+    {
+        .name       = nxt_string("max_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_cache_number,
+        .u.string   = "max_size",
+    }, {
+        .name       = nxt_string("max_entry_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_cache_number,
+        .u.string   = "max_entry_size",
+    }, {
+        .name       = nxt_string("lock_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_cache_number,
+        .u.string   = "lock_timeout",
+    }, {
+        .name       = nxt_string("path"),
+        .type       = NXT_CONF_VLDT_STRING,
     },
 
     NXT_CONF_VLDT_END
@@ -363,6 +556,9 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_listener_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_client_ip_members
+    }, {
+        .name       = nxt_string("reuseport"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
 #if (NXT_TLS)
@@ -419,6 +615,20 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_session_members,
+    }, {
+        .name       = nxt_string("ktls"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+#if !(NXT_HAVE_OPENSSL_KTLS)
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "ktls",
+#endif
+    }, {
+        .name       = nxt_string("ocsp_stapling"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+#if !(NXT_HAVE_OPENSSL_OCSP)
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "ocsp_stapling",
+#endif
     },
 
     NXT_CONF_VLDT_END
@@ -607,6 +817,21 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_pass_action_members[] = {
         .name       = nxt_string("pass"),
         .type       = NXT_CONF_VLDT_STRING,
         .validator  = nxt_conf_vldt_pass,
+    }, {
+        .name       = nxt_string("compress"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+#if (NXT_HAVE_ZLIB)
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_compress_members,
+#else
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "compress",
+#endif
+    }, {
+        .name       = nxt_string("cache"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_cache_members,
     },
 
     NXT_CONF_VLDT_END
@@ -635,6 +860,9 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_share_action_members[] = {
         .name       = nxt_string("types"),
         .type       = NXT_CONF_VLDT_STRING | NXT_CONF_VLDT_ARRAY,
         .validator  = nxt_conf_vldt_match_patterns,
+    }, {
+        .name       = nxt_string("precompressed"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     }, {
         .name       = nxt_string("fallback"),
         .type       = NXT_CONF_VLDT_OBJECT,
@@ -671,12 +899,130 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_proxy_action_members[] = {
         .name       = nxt_string("proxy"),
         .type       = NXT_CONF_VLDT_STRING,
         .validator  = nxt_conf_vldt_proxy,
+    }, {
+        .name       = nxt_string("compress"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+#if (NXT_HAVE_ZLIB)
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_compress_members,
+#else
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "compress",
+#endif
+    }, {
+        .name       = nxt_string("cache"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_cache_members,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_cache_members[] = {
+    {
+        .name       = nxt_string("key"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_var_key,
+    }, {
+        .name       = nxt_string("valid"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_cache_number,
+        .u.string   = "valid",
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_int_t
+nxt_conf_vldt_var_key(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    nxt_str_t  key;
+
+    nxt_conf_get_string(value, &key);
+
+    if (key.length == 0) {
+        return nxt_conf_vldt_error(vldt, "The \"key\" value must not be "
+                                   "empty.");
+    }
+
+    return nxt_conf_vldt_var(vldt, "key", &key);
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_cache_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  num;
+
+    num = nxt_conf_get_number(value);
+
+    if (num < 0 || num > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                   "0 and %d.", data, NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+#if (NXT_HAVE_ZLIB)
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_compress_members[] = {
+    {
+        .name       = nxt_string("types"),
+        .type       = NXT_CONF_VLDT_STRING | NXT_CONF_VLDT_ARRAY,
+        .validator  = nxt_conf_vldt_match_patterns,
+    }, {
+        .name       = nxt_string("min_length"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_compress_min_length,
+    }, {
+        .name       = nxt_string("level"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_compress_level,
     },
 
     NXT_CONF_VLDT_END
 };
 
 
+static nxt_int_t
+nxt_conf_vldt_compress_min_length(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    if (nxt_conf_get_number(value) < 0) {
+        return nxt_conf_vldt_error(vldt, "The \"min_length\" number must not "
+                                   "be negative.");
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_compress_level(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  level;
+
+    level = nxt_conf_get_number(value);
+
+    if (level < 1 || level > 9) {
+        return nxt_conf_vldt_error(vldt, "The \"level\" number must be "
+                                   "between 1 and 9.");
+    }
+
+    return NXT_OK;
+}
+
+#endif
+
+
 static nxt_conf_vldt_object_t  nxt_conf_vldt_external_members[] = {
     {
         .name       = nxt_string("executable"),
@@ -713,11 +1059,28 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_python_common_members[] = {
         .name       = nxt_string("thread_stack_size"),
         .type       = NXT_CONF_VLDT_INTEGER,
         .validator  = nxt_conf_vldt_thread_stack_size,
+    }, {
+        .name       = nxt_string("prototype"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_python_prototype_members,
     },
 
     NXT_CONF_VLDT_NEXT(nxt_conf_vldt_common_members)
 };
 
+
+/* Only the Python module can load the application in the prototype. */
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_python_prototype_members[] = {
+    {
+        .name       = nxt_string("preload"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+    },
+
+    NXT_CONF_VLDT_NEXT(nxt_conf_vldt_app_prototype_members)
+};
+
 static nxt_conf_vldt_object_t  nxt_conf_vldt_python_members[] = {
     {
         .name       = nxt_string("module"),
@@ -963,6 +1326,11 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_common_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_isolation,
         .u.members  = nxt_conf_vldt_app_isolation_members,
+    }, {
+        .name       = nxt_string("prototype"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_app_prototype_members,
     },
 
     NXT_CONF_VLDT_END
@@ -976,6 +1344,12 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_app_limits_members[] = {
     }, {
         .name       = nxt_string("requests"),
         .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("queue"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("queue_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
     }, {
         .name       = nxt_string("shm"),
         .type       = NXT_CONF_VLDT_INTEGER,
@@ -985,6 +1359,11 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_app_limits_members[] = {
 };
 
 
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_prototype_members[] = {
+    NXT_CONF_VLDT_END
+};
+
+
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_processes_members[] = {
     {
         .name       = nxt_string("spare"),
@@ -995,6 +1374,10 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_app_processes_members[] = {
     }, {
         .name       = nxt_string("idle_timeout"),
         .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("scaling"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_processes_scaling,
     },
 
     NXT_CONF_VLDT_END
@@ -1140,6 +1523,60 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_upstream_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object_iterator,
         .u.object   = nxt_conf_vldt_server,
+    }, {
+        .name       = nxt_string("balance"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_upstream_balance,
+    }, {
+        .name       = nxt_string("key"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_var_key,
+    }, {
+        .name       = nxt_string("health_check"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_health_check_members,
+    }, {
+        .name       = nxt_string("retries"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_upstream_number,
+        .u.string   = "retries",
+    }, {
+        .name       = nxt_string("retry_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_upstream_number,
+        .u.string   = "retry_timeout",
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_health_check_members[] = {
+    {
+        .name       = nxt_string("uri"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_health_check_uri,
+    }, {
+        .name       = nxt_string("interval"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_health_number,
+        .u.string   = "interval",
+    }, {
+        .name       = nxt_string("timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_health_number,
+        .u.string   = "timeout",
+    }, {
+        .name       = nxt_string("fails"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_health_number,
+        .u.string   = "fails",
+    }, {
+        .name       = nxt_string("passes"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_health_number,
+        .u.string   = "passes",
     },
 
     NXT_CONF_VLDT_END
@@ -1151,6 +1588,16 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_upstream_server_members[] = {
         .name       = nxt_string("weight"),
         .type       = NXT_CONF_VLDT_NUMBER,
         .validator  = nxt_conf_vldt_server_weight,
+    }, {
+        .name       = nxt_string("max_fails"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_upstream_number,
+        .u.string   = "max_fails",
+    }, {
+        .name       = nxt_string("fail_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_upstream_number,
+        .u.string   = "fail_timeout",
     },
 
     NXT_CONF_VLDT_END
@@ -1753,6 +2200,93 @@ nxt_conf_vldt_thread_stack_size(nxt_conf_validation_t *vldt,
 }
 
 
+static nxt_int_t
+nxt_conf_vldt_cpu(nxt_conf_validation_t *vldt, nxt_conf_value_t *value)
+{
+    int64_t  cpu;
+
+    if (nxt_conf_type(value) != NXT_CONF_INTEGER) {
+        return nxt_conf_vldt_error(vldt, "The \"cpu_affinity\" array "
+                                   "must contain only integer values.");
+    }
+
+    cpu = nxt_conf_get_number(value);
+
+    if (cpu < 0 || cpu >= 1024) {
+        return nxt_conf_vldt_error(vldt, "The \"cpu_affinity\" array "
+                                   "must contain CPU numbers from 0 to 1023.");
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_access_log(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    if (nxt_conf_type(value) == NXT_CONF_STRING) {
+        return NXT_OK;
+    }
+
+    /* NXT_CONF_OBJECT */
+
+    return nxt_conf_vldt_object(vldt, value, nxt_conf_vldt_access_log_members);
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_access_log_format(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t  format;
+
+    nxt_conf_get_string(value, &format);
+
+    if (format.length == 0) {
+        return nxt_conf_vldt_error(vldt, "The \"format\" value must not be "
+                                   "empty.");
+    }
+
+    return nxt_conf_vldt_var(vldt, "format", &format);
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_access_log_buffer(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  size;
+
+    size = nxt_conf_get_number(value);
+
+    if (size < 0 || size > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"buffer_size\" number must be "
+                                   "between 0 and %d.", NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_access_log_flush(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  interval;
+
+    interval = nxt_conf_get_number(value);
+
+    if (interval < 1 || interval > NXT_INT32_T_MAX / 1000) {
+        return nxt_conf_vldt_error(vldt, "The \"flush_interval\" number must "
+                                   "be between 1 and %d.",
+                                   NXT_INT32_T_MAX / 1000);
+    }
+
+    return NXT_OK;
+}
+
+
 static nxt_int_t
 nxt_conf_vldt_routes(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
     void *data)
@@ -2464,6 +2998,28 @@ nxt_conf_vldt_processes(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
 }
 
 
+static nxt_int_t
+nxt_conf_vldt_processes_scaling(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t  scaling;
+
+    static const nxt_str_t  reactive = nxt_string("reactive");
+    static const nxt_str_t  predictive = nxt_string("predictive");
+
+    nxt_conf_get_string(value, &scaling);
+
+    if (nxt_strstr_eq(&scaling, &reactive)
+        || nxt_strstr_eq(&scaling, &predictive))
+    {
+        return NXT_OK;
+    }
+
+    return nxt_conf_vldt_error(vldt, "The \"scaling\" can either be "
+                                     "\"reactive\" or \"predictive\".");
+}
+
+
 static nxt_int_t
 nxt_conf_vldt_object_iterator(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data)
@@ -2840,10 +3396,13 @@ static nxt_int_t
 nxt_conf_vldt_upstream(nxt_conf_validation_t *vldt, nxt_str_t *name,
     nxt_conf_value_t *value)
 {
+    nxt_str_t         balance;
     nxt_int_t         ret;
     nxt_conf_value_t  *conf;
 
     static nxt_str_t  servers = nxt_string("servers");
+    static nxt_str_t  balance_name = nxt_string("balance");
+    static nxt_str_t  key_name = nxt_string("key");
 
     ret = nxt_conf_vldt_type(vldt, name, value, NXT_CONF_VLDT_OBJECT);
 
@@ -2863,6 +3422,110 @@ nxt_conf_vldt_upstream(nxt_conf_validation_t *vldt, nxt_str_t *name,
                                    "\"servers\" object value.", name);
     }
 
+    conf = nxt_conf_get_object_member(value, &balance_name, NULL);
+
+    if (conf != NULL) {
+        nxt_conf_get_string(conf, &balance);
+
+    } else {
+        nxt_str_set(&balance, "round_robin");
+    }
+
+    conf = nxt_conf_get_object_member(value, &key_name, NULL);
+
+    if (nxt_str_eq(&balance, "hash", 4)) {
+        if (conf == NULL) {
+            return nxt_conf_vldt_error(vldt, "The \"%V\" upstream with "
+                                       "the \"hash\" balancing must contain "
+                                       "\"key\" string value.", name);
+        }
+
+    } else if (conf != NULL) {
+        return nxt_conf_vldt_error(vldt, "The \"key\" option of the \"%V\" "
+                                   "upstream is only valid with the \"hash\" "
+                                   "balancing.", name);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_upstream_balance(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t  balance;
+
+    nxt_conf_get_string(value, &balance);
+
+    if (nxt_str_eq(&balance, "round_robin", 11)
+        || nxt_str_eq(&balance, "least_conn", 10)
+        || nxt_str_eq(&balance, "hash", 4))
+    {
+        return NXT_OK;
+    }
+
+    return nxt_conf_vldt_error(vldt, "The \"balance\" can be either "
+                               "\"round_robin\", \"least_conn\", "
+                               "or \"hash\".");
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_upstream_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  num;
+
+    num = nxt_conf_get_number(value);
+
+    if (num < 0 || num > NXT_INT32_T_MAX / 1000) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                   "0 and %d.", data, NXT_INT32_T_MAX / 1000);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_health_check_uri(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t  uri;
+
+    nxt_conf_get_string(value, &uri);
+
+    if (uri.length == 0 || uri.start[0] != '/') {
+        return nxt_conf_vldt_error(vldt, "The \"uri\" of \"health_check\" "
+                                   "must start with \"/\".");
+    }
+
+    if (nxt_memchr(uri.start, ' ', uri.length) != NULL
+        || nxt_memchr(uri.start, '\r', uri.length) != NULL
+        || nxt_memchr(uri.start, '\n', uri.length) != NULL)
+    {
+        return nxt_conf_vldt_error(vldt, "The \"uri\" of \"health_check\" "
+                                   "must not contain whitespace.");
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_health_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  num;
+
+    num = nxt_conf_get_number(value);
+
+    if (num < 1 || num > NXT_INT32_T_MAX / 1000) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                   "1 and %d.", data, NXT_INT32_T_MAX / 1000);
+    }
+
     return NXT_OK;
 }
 
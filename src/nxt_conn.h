@@ -167,6 +167,8 @@ struct nxt_conn_s {
 
     uint8_t                       sendfile;     /* 2 bits */
     uint8_t                       tcp_nodelay;  /* 1 bit */
+    /* The "h2" protocol has been negotiated via TLS ALPN. */
+    uint8_t                       alpn_h2;      /* 1 bit */
 
     nxt_queue_link_t              link;
 };
@@ -236,6 +238,8 @@ void nxt_conn_connect_error(nxt_task_t *task, void *obj, void *data);
 
 NXT_EXPORT nxt_listen_event_t *nxt_listen_event(nxt_task_t *task,
     nxt_listen_socket_t *ls);
+NXT_EXPORT nxt_listen_event_t *nxt_listen_socket_event(nxt_task_t *task,
+    nxt_listen_socket_t *ls, nxt_socket_t s);
 void nxt_conn_io_accept(nxt_task_t *task, void *obj, void *data);
 NXT_EXPORT void nxt_conn_accept(nxt_task_t *task, nxt_listen_event_t *lev,
     nxt_conn_t *c);
@@ -36,6 +36,14 @@ static void nxt_conn_listen_timer_handler(nxt_task_t *task, void *obj,
 
 nxt_listen_event_t *
 nxt_listen_event(nxt_task_t *task, nxt_listen_socket_t *ls)
+{
+    return nxt_listen_socket_event(task, ls, ls->socket);
+}
+
+
+nxt_listen_event_t *
+nxt_listen_socket_event(nxt_task_t *task, nxt_listen_socket_t *ls,
+    nxt_socket_t s)
 {
     nxt_listen_event_t  *lev;
     nxt_event_engine_t  *engine;
@@ -43,7 +51,7 @@ nxt_listen_event(nxt_task_t *task, nxt_listen_socket_t *ls)
     lev = nxt_zalloc(sizeof(nxt_listen_event_t));
 
     if (nxt_fast_path(lev != NULL)) {
-        lev->socket.fd = ls->socket;
+        lev->socket.fd = s;
 
         engine = task->thread->engine;
         lev->batch = engine->batch;
@@ -396,6 +396,10 @@ nxt_controller_router_ready_handler(nxt_task_t *task,
     if (router_port != NULL) {
         nxt_controller_send_current_conf(task);
     }
+
+#if (NXT_TLS && NXT_HAVE_OPENSSL_OCSP)
+    nxt_cert_ocsp_refresh(task, nxt_controller_conf.root);
+#endif
 }
 
 
@@ -1606,6 +1610,13 @@ nxt_controller_process_cert_save(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
     nxt_fd_close(msg->fd[0]);
 
+    if (msg->fd[1] != -1) {
+        /* A stale OCSP response must not be stapled for a new chain. */
+        (void) ftruncate(msg->fd[1], 0);
+
+        nxt_fd_close(msg->fd[1]);
+    }
+
     nxt_memzero(&resp, sizeof(nxt_controller_response_t));
 
     resp.status = 200;
@@ -1678,6 +1689,10 @@ nxt_controller_conf_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
         nxt_controller_conf_store(task, req->conf.root);
 
+#if (NXT_TLS && NXT_HAVE_OPENSSL_OCSP)
+        nxt_cert_ocsp_refresh(task, req->conf.root);
+#endif
+
         resp.status = 200;
         resp.title = (u_char *) "Reconfiguration done.";
 
@@ -139,6 +139,7 @@ nxt_event_engine_create(nxt_task_t *task,
     nxt_queue_init(&engine->joints);
     nxt_queue_init(&engine->listen_connections);
     nxt_queue_init(&engine->idle_connections);
+    nxt_queue_init(&engine->ack_waiting_req);
 
     return engine;
 
@@ -449,6 +450,10 @@ nxt_event_engine_free(nxt_event_engine_t *engine)
 {
     nxt_thread_log_debug("free engine %p", engine);
 
+    if (engine->file_cache != NULL) {
+        nxt_file_cache_destroy(&engine->task, engine->file_cache);
+    }
+
     nxt_event_engine_signal_pipe_free(engine);
     nxt_free(engine->signals);
 
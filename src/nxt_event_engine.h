@@ -493,8 +493,16 @@ struct nxt_event_engine_s {
     nxt_queue_t                joints;
     nxt_queue_t                listen_connections;
     nxt_queue_t                idle_connections;
+    /* Requests waiting for an application process ack. */
+    nxt_queue_t                ack_waiting_req;
+    /* Idle upstream connections grouped by upstream server address. */
+    nxt_lvlhsh_t               peer_connections;
     nxt_array_t                *mem_cache;
 
+    nxt_file_cache_t           *file_cache;
+    /* The router access log buffer. */
+    void                       *access_log;
+
     nxt_queue_link_t           link;
     // STUB: router link
     nxt_queue_link_t           link0;
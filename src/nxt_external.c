@@ -21,6 +21,7 @@ nxt_app_module_t  nxt_external_module = {
     0,
     NULL,
     nxt_external_start,
+    NULL,
 };
 
 
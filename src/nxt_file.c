@@ -464,6 +464,26 @@ nxt_fd_write(nxt_fd_t fd, u_char *buf, size_t size)
 }
 
 
+ssize_t
+nxt_fd_writev(nxt_fd_t fd, struct iovec *iov, nxt_uint_t niov)
+{
+    ssize_t    n;
+    nxt_err_t  err;
+
+    n = writev(fd, iov, niov);
+
+    err = (n == -1) ? nxt_errno : 0;
+
+    nxt_thread_log_debug("writev(%FD, %ui): %z", fd, niov, n);
+
+    if (nxt_slow_path(n <= 0)) {
+        nxt_thread_log_alert("writev(%FD) failed %E", fd, err);
+    }
+
+    return n;
+}
+
+
 ssize_t
 nxt_fd_read(nxt_fd_t fd, u_char *buf, size_t size)
 {
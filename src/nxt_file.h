@@ -194,6 +194,8 @@ NXT_EXPORT nxt_int_t nxt_file_rename(nxt_file_name_t *old_name,
 NXT_EXPORT nxt_int_t nxt_fd_nonblocking(nxt_task_t *task, nxt_fd_t fd);
 NXT_EXPORT nxt_int_t nxt_fd_blocking(nxt_task_t *task, nxt_fd_t fd);
 NXT_EXPORT ssize_t nxt_fd_write(nxt_fd_t fd, u_char *buf, size_t size);
+NXT_EXPORT ssize_t nxt_fd_writev(nxt_fd_t fd, struct iovec *iov,
+    nxt_uint_t niov);
 NXT_EXPORT ssize_t nxt_fd_read(nxt_fd_t fd, u_char *buf, size_t size);
 NXT_EXPORT void nxt_fd_close(nxt_fd_t fd);
 
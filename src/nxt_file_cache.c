@@ -1,508 +1,339 @@
 
 /*
- * Copyright (C) Igor Sysoev
  * Copyright (C) NGINX, Inc.
  */
 
 #include <nxt_main.h>
 
 
-static nxt_int_t nxt_file_cache_lvlhsh_test(nxt_lvlhsh_key_t *hkey, void *data);
-static nxt_work_handler_t nxt_file_cache_query_locked(nxt_file_cache_t *cache,
-    nxt_file_cache_query_t *q, nxt_lvlhsh_key_t *hkey);
-static nxt_work_handler_t nxt_file_cache_node_hold(nxt_file_cache_t *cache,
-    nxt_file_cache_query_t *q, nxt_lvlhsh_key_t *hkey);
-static nxt_work_handler_t nxt_file_cache_node_test(nxt_file_cache_t *cache,
-    nxt_file_cache_query_t *q);
+struct nxt_file_cache_s {
+    nxt_lvlhsh_t              hash;
+    /* The most recently used nodes are at the head. */
+    nxt_queue_t               expiry;
+    uint32_t                  nodes;
 
-static void nxt_file_cache_wait_handler(void *data);
-static void nxt_file_cache_timeout_handler(nxt_event_timer_t *ev);
-static void nxt_file_cache_wake_handler(void *data);
+    nxt_msec_t                inactive;
+    nxt_timer_t               timer;
+};
 
-static nxt_file_cache_node_t *nxt_file_cache_node_alloc(nxt_cache_t *cache);
-static void nxt_file_cache_node_free(nxt_file_cache_t *cache,
-    nxt_file_cache_node_t *node, nxt_bool_t fast);
-static nxt_file_cache_query_wait_t *nxt_file_cache_query_wait_alloc(
-    nxt_file_cache_t *cache, nxt_bool_t *fast);
-static void nxt_file_cache_query_wait_free(nxt_file_cache_t *cache,
-    nxt_file_cache_query_wait_t *qw);
-static void nxt_file_cache_lock(nxt_file_cache_t *cache);
-static void nxt_file_cache_unlock(nxt_file_cache_t *cache);
 
+static nxt_file_cache_t *nxt_file_cache_create(nxt_event_engine_t *engine);
+static nxt_int_t nxt_file_cache_hash_test(nxt_lvlhsh_query_t *lhq,
+    void *data);
+static void nxt_file_cache_expire(nxt_task_t *task, nxt_file_cache_t *cache,
+    nxt_msec_t now, nxt_uint_t n);
+static void nxt_file_cache_timer_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_file_cache_delete(nxt_task_t *task, nxt_file_cache_t *cache,
+    nxt_file_cache_node_t *node);
+static void nxt_file_cache_node_free(nxt_task_t *task,
+    nxt_file_cache_node_t *node);
 
-void
-nxt_file_cache_init(nxt_cache_t *cache)
-{
-    static const nxt_lvlhsh_ctx_t  ctx = {
-        nxt_file_cache_lvlhsh_test,
-        nxt_lvlhsh_alloc,
-        nxt_lvlhsh_free,
-        0,
-    };
-
-    /* lvlhsh with large first level. */
-    cache->lvlhsh.shift[1] = 10;
 
-    cache->lvlhsh.ctx = &ctx;
-
-    cache->start_time = nxt_thread_time();
-}
+static const nxt_lvlhsh_proto_t  nxt_file_cache_hash_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_file_cache_hash_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
 
 
-static nxt_int_t
-nxt_file_cache_lvlhsh_test(nxt_lvlhsh_key_t *hkey, void *data)
+nxt_file_cache_node_t *
+nxt_file_cache_find(nxt_task_t *task, nxt_file_cache_conf_t *conf,
+    nxt_str_t *key)
 {
+    nxt_msec_t             now;
+    nxt_file_cache_t       *cache;
+    nxt_lvlhsh_query_t     lhq;
+    nxt_event_engine_t     *engine;
     nxt_file_cache_node_t  *node;
 
-    node = data;
-
-    if (nxt_strmem_eq(&hkey->key, node->key_data, node->key_len)) {
-        return NXT_OK;
-    }
-
-    return NXT_DECLINED;
-}
-
-
-void
-nxt_file_cache_query(nxt_file_cache_t *cache, nxt_file_cache_query_t *q)
-{
-    nxt_lvlhsh_key_t    hkey;
-    nxt_work_handler_t  handler;
-
-    if (cache != NULL) {
-        hkey.key.len = q->key_len;
-        hkey.key.data = q->key_data;
-        hkey.key_hash = nxt_murmur_hash2(q->key_data, q->key_len);
-        hkey.replace = 0;
-
-        nxt_file_cache_lock(cache);
+    engine = task->thread->engine;
+    cache = engine->file_cache;
 
-        handler = nxt_file_cache_query_locked(cache, q, &hkey);
-
-        nxt_file_cache_unlock(cache);
-
-    } else {
-        handler = q->state->nocache_handler;
+    if (cache == NULL) {
+        return NULL;
     }
 
-    handler(q);
-}
-
+    lhq.key_hash = nxt_djb_hash(key->start, key->length);
+    lhq.key = *key;
+    lhq.proto = &nxt_file_cache_hash_proto;
 
-static nxt_work_handler_t
-nxt_file_cache_query_locked(nxt_file_cache_t *cache, nxt_file_cache_query_t *q,
-    nxt_lvlhsh_key_t *hkey)
-{
-    nxt_int_t                     ret;
-    nxt_bool_t                    fast;
-    nxt_work_handler_t            handler;
-    nxt_file_cache_node_t         *node, *sentinel;
-    nxt_file_cache_query_wait_t   *qw;
-    nxt_file_cache_query_state_t  *state;
-
-    state = q->state;
-    sentinel = nxt_file_cache_node_alloc(cache);
-
-    if (nxt_slow_path(sentinel == NULL)) {
-        return state->error_handler;
+    if (nxt_lvlhsh_find(&cache->hash, &lhq) != NXT_OK) {
+        return NULL;
     }
 
-    sentinel->key_data = q->key_data;
-    sentinel->key_len = q->key_len;
-    hkey->value = sentinel;
-
-    /*
-     * Try to insert an empty sentinel node to hold updating
-     * process if there is no existent cache node in cache.
-     */
+    node = lhq.value;
+    now = engine->timers.now;
 
-    ret = nxt_lvlhsh_insert(&cache->lvlhsh, hkey);
+    if (nxt_msec_diff(now, node->validated) >= (int32_t) conf->valid
+        || (node->file.fd == -1 && !conf->errors))
+    {
+        nxt_debug(task, "file cache stale: \"%FN\"", node->file.name);
 
-    if (ret == NXT_OK) {
-        /* The sentinel node was successully added. */
-
-        q->node = sentinel;
-        sentinel->updating = 1;
-        return state->update_handler;
-    }
-
-    nxt_cache_node_free(cache, sentinel, 1);
-
-    if (ret == NXT_ERROR) {
-        return state->error_handler;
+        nxt_file_cache_delete(task, cache, node);
+        return NULL;
     }
 
-    /* NXT_DECLINED: a cache node exists. */
+    nxt_debug(task, "file cache hit: \"%FN\"", node->file.name);
 
-    node = hkey->value;
+    node->accessed = now;
     node->count++;
-    q->node = node;
-
-    handler = nxt_cache_node_test(cache, q);
-
-    if (handler == NULL) {
-        /* Add the node to a wait queue. */
-
-        qw = nxt_cache_query_wait_alloc(cache, &fast);
-        if (nxt_slow_path(qw == NULL)) {
-            return state->error_handler;
-        }
-
-        if (!fast) {
-            /* The node state may be changed during slow allocation. */
-            handler = nxt_cache_node_test(cache, q);
-
-            if (handler != NULL) {
-                nxt_cache_query_wait_free(cache, qw);
-                return handler;
-            }
-        }
-
-        qw->query = q;
-        qw->next = node->waiting;
-        qw->busy = 0;
-        qw->deleted = 0;
-        qw->pid = nxt_pid;
-        qw->engine = nxt_thread_event_engine();
-        qw->handler = nxt_cache_wake_handler;
-        qw->cache = cache;
 
-        node->waiting = qw;
+    nxt_queue_remove(&node->link);
+    nxt_queue_insert_head(&cache->expiry, &node->link);
 
-        return nxt_cache_wait_handler;
-    }
-
-    return handler;
+    return node;
 }
 
 
-static nxt_work_handler_t
-nxt_cache_node_test(nxt_cache_t *cache, nxt_cache_query_t *q)
-{
-    nxt_time_t               expiry;
-    nxt_cache_node_t         *node;
-    nxt_cache_query_state_t  *state;
+/*
+ * nxt_file_cache_add() takes ownership of the file descriptor.  The node
+ * returned is referenced and should be released by nxt_file_cache_release()
+ * even if it could not be cached.
+ */
 
-    q->stale = 0;
-    state = q->state;
-    node = q->node;
+nxt_file_cache_node_t *
+nxt_file_cache_add(nxt_task_t *task, nxt_file_cache_conf_t *conf,
+    nxt_str_t *key, nxt_file_t *file, nxt_file_info_t *fi)
+{
+    size_t                 size;
+    nxt_msec_t             now;
+    nxt_file_cache_t       *cache;
+    nxt_lvlhsh_query_t     lhq;
+    nxt_event_engine_t     *engine;
+    nxt_file_cache_node_t  *node;
 
-    expiry = cache->start_time + node->expiry;
+    engine = task->thread->engine;
+    cache = engine->file_cache;
 
-    if (nxt_thread_time() < expiry) {
-        return state->ready_handler;
+    if (cache == NULL) {
+        cache = nxt_file_cache_create(engine);
+        engine->file_cache = cache;
     }
 
-    /*
-     * A valid stale or empty sentinel cache node.
-     * The sentinel node can be only in updating state.
-     */
-
-    if (node->updating) {
-
-        if (node->expiry != 0) {
-            /* A valid stale cache node. */
-
-            q->stale = 1;
-
-            if (q->use_stale) {
-                return state->stale_handler;
-            }
-        }
+    /* The key starts with a null-terminated file name. */
+    size = sizeof(nxt_file_cache_node_t) + key->length + 1;
 
+    node = nxt_malloc(size);
+    if (nxt_slow_path(node == NULL)) {
         return NULL;
     }
 
-    /* A valid stale cache node is not being updated now. */
+    now = engine->timers.now;
 
-    q->stale = 1;
+    node->file = *file;
+    node->info = *fi;
+    node->validated = now;
+    node->accessed = now;
+    node->count = 1;
+    node->deleted = 1;
 
-    if (q->use_stale) {
+    node->key.length = key->length;
+    node->key.start = (u_char *) node + sizeof(nxt_file_cache_node_t);
+    nxt_memcpy(node->key.start, key->start, key->length);
+    node->key.start[key->length] = '\0';
 
-        if (q->update_stale) {
-            node->updating = 1;
-            return state->update_stale_handler;
-        }
+    node->file.name = node->key.start;
 
-        return state->stale_handler;
+    if (nxt_slow_path(cache == NULL)
+        || (file->fd == -1 && !conf->errors)
+        || conf->max == 0)
+    {
+        return node;
     }
 
-    node->updating = 1;
-    return state->update_handler;
-}
-
-
-static void
-nxt_cache_wait_handler(void *data)
-{
-    nxt_thread_t       *thr;
-    nxt_event_timer_t  *ev;
-    nxt_cache_query_t  *q;
-
-    q = data;
+    nxt_file_cache_expire(task, cache, now, 2);
 
-    if (&q->timeout == 0) {
-        return;
+    if (cache->nodes >= conf->max) {
+        nxt_file_cache_delete(task, cache,
+                              nxt_queue_link_data(nxt_queue_last(&cache->expiry),
+                                                  nxt_file_cache_node_t,
+                                                  link));
     }
 
-    ev = &q->timer;
+    node->key_hash = nxt_djb_hash(node->key.start, node->key.length);
 
-    if (!nxt_event_timer_is_set(ev)) {
-        thr = nxt_thread();
-        ev->log = thr->log;
-        ev->handler = nxt_cache_timeout_handler;
-        ev->data = q;
-        nxt_event_timer_ident(ev, -1);
+    lhq.key_hash = node->key_hash;
+    lhq.key = node->key;
+    lhq.replace = 0;
+    lhq.value = node;
+    lhq.proto = &nxt_file_cache_hash_proto;
+    lhq.pool = NULL;
 
-        nxt_event_timer_add(thr->engine, ev, q->timeout);
+    if (nxt_lvlhsh_insert(&cache->hash, &lhq) != NXT_OK) {
+        return node;
     }
-}
-
-
-static void
-nxt_cache_timeout_handler(nxt_event_timer_t *ev)
-{
-    nxt_cache_query_t  *q;
 
-    q = ev->data;
+    nxt_debug(task, "file cache add: \"%FN\"", node->file.name);
 
-    q->state->timeout_handler(q);
-}
-
-
-static void
-nxt_cache_wake_handler(void *data)
-{
-    nxt_cache_t             *cache;
-    nxt_work_handler_t      handler;
-    nxt_cache_query_t       *q;
-    nxt_cache_query_wait_t  *qw;
+    node->deleted = 0;
 
-    qw = data;
-    q = qw->query;
-    cache = qw->cache;
-
-    nxt_cache_lock(cache);
-
-    handler = nxt_cache_node_test(cache, q);
-
-    if (handler == NULL) {
-        /* Wait again. */
-        qw->next = q->node->waiting;
-        q->node->waiting = qw;
-    }
+    nxt_queue_insert_head(&cache->expiry, &node->link);
+    cache->nodes++;
 
-    nxt_cache_unlock(cache);
+    cache->inactive = conf->inactive;
 
-    if (handler != NULL) {
-        nxt_cache_query_wait_free(cache, qw);
+    if (!cache->timer.enabled) {
+        nxt_timer_add(engine, &cache->timer, cache->inactive);
     }
 
-    handler(q);
+    return node;
 }
 
 
-static nxt_cache_node_t *
-nxt_cache_node_alloc(nxt_cache_t *cache)
+void
+nxt_file_cache_release(nxt_task_t *task, nxt_file_cache_node_t *node)
 {
-    nxt_queue_node_t  *qn;
-    nxt_cache_node_t  *node;
-
-    qn = nxt_queue_first(&cache->free_nodes);
-
-    if (nxt_fast_path(qn != nxt_queue_tail(&cache->free_nodes))) {
-        cache->nfree_nodes--;
-        nxt_queue_remove(qn);
-
-        node = nxt_queue_node_data(qn, nxt_cache_node_t, queue);
-        nxt_memzero(node, sizeof(nxt_cache_node_t));
+    node->count--;
 
-        return node;
+    if (node->count == 0 && node->deleted) {
+        nxt_file_cache_node_free(task, node);
     }
-
-    nxt_cache_unlock(cache);
-
-    node = cache->alloc(cache->data, sizeof(nxt_cache_node_t));
-
-    nxt_cache_lock(cache);
-
-    return node;
 }
 
 
-static void
-nxt_cache_node_free(nxt_cache_t *cache, nxt_cache_node_t *node, nxt_bool_t fast)
+void
+nxt_file_cache_destroy(nxt_task_t *task, nxt_file_cache_t *cache)
 {
-    if (fast || cache->nfree_nodes < 32) {
-        nxt_queue_insert_head(&cache->free_nodes, &node->queue);
-        cache->nfree_nodes++;
-        return;
-    }
+    nxt_queue_link_t       *link;
+    nxt_file_cache_node_t  *node;
 
-    nxt_cache_unlock(cache);
+    while (!nxt_queue_is_empty(&cache->expiry)) {
+        link = nxt_queue_first(&cache->expiry);
+        node = nxt_queue_link_data(link, nxt_file_cache_node_t, link);
 
-    cache->free(cache->data, node);
+        nxt_file_cache_delete(task, cache, node);
+    }
 
-    nxt_cache_lock(cache);
+    nxt_free(cache);
 }
 
 
-static nxt_cache_query_wait_t *
-nxt_cache_query_wait_alloc(nxt_cache_t *cache, nxt_bool_t *fast)
+static nxt_file_cache_t *
+nxt_file_cache_create(nxt_event_engine_t *engine)
 {
-    nxt_cache_query_wait_t  *qw;
-
-    qw = cache->free_query_wait;
+    nxt_file_cache_t  *cache;
 
-    if (nxt_fast_path(qw != NULL)) {
-        cache->free_query_wait = qw->next;
-        cache->nfree_query_wait--;
-
-        *fast = 1;
-        return qw;
+    cache = nxt_zalloc(sizeof(nxt_file_cache_t));
+    if (nxt_slow_path(cache == NULL)) {
+        return NULL;
     }
 
-    nxt_cache_unlock(cache);
+    nxt_queue_init(&cache->expiry);
 
-    qw = cache->alloc(cache->data, sizeof(nxt_cache_query_wait_t));
-    *fast = 0;
+    cache->timer.bias = NXT_TIMER_DEFAULT_BIAS;
+    cache->timer.work_queue = &engine->fast_work_queue;
+    cache->timer.handler = nxt_file_cache_timer_handler;
+    cache->timer.task = &engine->task;
+    cache->timer.log = engine->task.log;
 
-    nxt_cache_lock(cache);
-
-    return qw;
+    return cache;
 }
 
 
-static void
-nxt_cache_query_wait_free(nxt_cache_t *cache, nxt_cache_query_wait_t *qw)
+static nxt_int_t
+nxt_file_cache_hash_test(nxt_lvlhsh_query_t *lhq, void *data)
 {
-    if (cache->nfree_query_wait < 32) {
-        qw->next = cache->free_query_wait;
-        cache->free_query_wait = qw;
-        cache->nfree_query_wait++;
-        return;
-    }
-
-    nxt_cache_unlock(cache);
+    nxt_file_cache_node_t  *node;
 
-    cache->free(cache->data, qw);
+    node = data;
 
-    nxt_cache_lock(cache);
+    return nxt_strstr_eq(&lhq->key, &node->key) ? NXT_OK : NXT_DECLINED;
 }
 
 
-#if 0
+/*
+ * nxt_file_cache_expire() deletes up to "n" unused nodes that have not been
+ * accessed during the inactivity time.  Zero "n" means no limit.
+ */
 
-nxt_int_t
-nxt_cache_update(nxt_cache_t *cache, nxt_cache_node_t *node)
+static void
+nxt_file_cache_expire(nxt_task_t *task, nxt_file_cache_t *cache,
+    nxt_msec_t now, nxt_uint_t n)
 {
-    nxt_lvlhsh_key_t  hkey;
+    nxt_queue_link_t       *link;
+    nxt_file_cache_node_t  *node;
 
-    if (node->expiry == 0) {
-        /* An empty sentinel node. */
-        nxt_cache_release(cache, node);
-        return;
-    }
+    while (!nxt_queue_is_empty(&cache->expiry)) {
+        link = nxt_queue_last(&cache->expiry);
+        node = nxt_queue_link_data(link, nxt_file_cache_node_t, link);
 
-    hkey.key.len = node->key_len;
-    hkey.key.data = node->key_data;
-    hkey.key_hash = nxt_murmur_hash2(node->key_data, node->key_len);
-    hkey.replace = 1;
-    hkey.value = node;
+        if (nxt_msec_diff(now, node->accessed) < (int32_t) cache->inactive) {
+            return;
+        }
 
-    node->count = 1;
+        if (node->count != 0) {
+            /* The node will be checked again after it is accessed. */
+            node->accessed = now;
 
-    if (nxt_lvlhsh_insert(&cache->lvlhsh, &hkey) != NXT_OK) {
-        return NXT_ERROR;
-    }
+            nxt_queue_remove(&node->link);
+            nxt_queue_insert_head(&cache->expiry, &node->link);
 
-    node = hkey.value;
+        } else {
+            nxt_debug(task, "file cache expire: \"%FN\"", node->file.name);
 
-    if (node != NULL) {
-        if (node->count != 0) {
-            node->delete = 1;
+            nxt_file_cache_delete(task, cache, node);
+        }
 
-        } else {
-            // delete cache node
+        if (n != 0 && --n == 0) {
+            return;
         }
     }
-
-    return NXT_OK;
 }
 
-#endif
 
-
-void
-nxt_cache_node_release(nxt_cache_t *cache, nxt_cache_node_t *node)
+static void
+nxt_file_cache_timer_handler(nxt_task_t *task, void *obj, void *data)
 {
-    nxt_bool_t  delete;
-
-    nxt_cache_lock(cache);
+    nxt_timer_t         *timer;
+    nxt_file_cache_t    *cache;
+    nxt_event_engine_t  *engine;
 
-    delete = nxt_cache_node_release_locked(cache, node);
+    timer = obj;
+    cache = nxt_timer_data(timer, nxt_file_cache_t, timer);
+    engine = task->thread->engine;
 
-    nxt_cache_unlock(cache);
+    nxt_file_cache_expire(task, cache, engine->timers.now, 0);
 
-    if (delete) {
-        nxt_thread_work_queue_add(cache->delete_handler, node);
+    if (cache->nodes != 0) {
+        nxt_timer_add(engine, &cache->timer, cache->inactive);
     }
 }
 
 
-nxt_bool_t
-nxt_cache_node_release_locked(nxt_cache_t *cache, nxt_cache_node_t *node)
+static void
+nxt_file_cache_delete(nxt_task_t *task, nxt_file_cache_t *cache,
+    nxt_file_cache_node_t *node)
 {
-#if 0
-    nxt_lvlhsh_key_t  hkey;
-#endif
+    nxt_lvlhsh_query_t  lhq;
 
-    node->count--;
+    lhq.key_hash = node->key_hash;
+    lhq.key = node->key;
+    lhq.proto = &nxt_file_cache_hash_proto;
+    lhq.pool = NULL;
 
-    if (node->count != 0) {
-        return 0;
-    }
+    (void) nxt_lvlhsh_delete(&cache->hash, &lhq);
 
-    if (!node->deleted) {
-        /*
-         * A cache node is locked whilst its count is non zero.
-         * To minimize number of operations the node's place in expiry
-         * queue can be updated only if the node is not currently used.
-         */
-        node->accessed = nxt_thread_time() - cache->start_time;
+    nxt_queue_remove(&node->link);
+    cache->nodes--;
 
-        nxt_queue_remove(&node->queue);
-        nxt_queue_insert_head(&cache->expiry_queue, &node->queue);
+    node->deleted = 1;
 
-        return 0;
+    if (node->count == 0) {
+        nxt_file_cache_node_free(task, node);
     }
-
-#if 0
-    hkey.key.len = node->key_len;
-    hkey.key.data = node->key_data;
-    hkey.key_hash = nxt_murmur_hash2(node->key_data, node->key_len);
-
-    nxt_lvlhsh_delete(&cache->lvlhsh, &hkey);
-#endif
-
-    return 1;
 }
 
 
 static void
-nxt_file_cache_lock(nxt_file_cache_t *cache)
+nxt_file_cache_node_free(nxt_task_t *task, nxt_file_cache_node_t *node)
 {
-    if (cache->shared) {
-        nxt_thread_spin_lock(&cache->lock);
-    }
-}
+    nxt_debug(task, "file cache node free: \"%FN\"", node->file.name);
 
-
-static void
-nxt_file_cache_unlock(nxt_file_cache_t *cache)
-{
-    if (cache->shared) {
-        nxt_thread_spin_unlock(&cache->lock);
+    if (node->file.fd != -1) {
+        nxt_file_close(task, &node->file);
     }
+
+    nxt_free(node);
 }
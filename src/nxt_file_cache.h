@@ -0,0 +1,56 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#ifndef _NXT_FILE_CACHE_H_INCLUDED_
+#define _NXT_FILE_CACHE_H_INCLUDED_
+
+
+/*
+ * The open file cache is local to an engine, so it requires no locking.
+ * A cache node holds an open file descriptor with its information or
+ * an open() error for negative lookups.  Nodes are referenced while in
+ * use and they are closed only after the last reference is released.
+ */
+
+typedef struct nxt_file_cache_s  nxt_file_cache_t;
+
+
+typedef struct {
+    uint32_t                  max;
+    nxt_msec_t                inactive;
+    nxt_msec_t                valid;
+    uint8_t                   errors;    /* 1 bit */
+} nxt_file_cache_conf_t;
+
+
+typedef struct {
+    nxt_file_t                file;
+    nxt_file_info_t           info;
+
+    nxt_queue_link_t          link;
+
+    nxt_msec_t                validated;
+    nxt_msec_t                accessed;
+
+    uint32_t                  count;
+    uint32_t                  key_hash;
+    nxt_str_t                 key;
+
+    uint8_t                   deleted;   /* 1 bit */
+} nxt_file_cache_node_t;
+
+
+NXT_EXPORT nxt_file_cache_node_t *nxt_file_cache_find(nxt_task_t *task,
+    nxt_file_cache_conf_t *conf, nxt_str_t *key);
+NXT_EXPORT nxt_file_cache_node_t *nxt_file_cache_add(nxt_task_t *task,
+    nxt_file_cache_conf_t *conf, nxt_str_t *key, nxt_file_t *file,
+    nxt_file_info_t *fi);
+NXT_EXPORT void nxt_file_cache_release(nxt_task_t *task,
+    nxt_file_cache_node_t *node);
+NXT_EXPORT void nxt_file_cache_destroy(nxt_task_t *task,
+    nxt_file_cache_t *cache);
+
+
+#endif /* _NXT_FILE_CACHE_H_INCLUDED_ */
@@ -18,6 +18,17 @@
  * nxt_h1p_request_ prefix is used for HTTP/1 protocol request methods.
  */
 
+
+/* Idle keep-alive connections to an upstream server in an engine. */
+
+typedef struct {
+    nxt_queue_t                idle;
+    uint32_t                   count;
+    socklen_t                  socklen;
+    u_char                     sockaddr[0];
+} nxt_h1p_peer_pool_t;
+
+
 #if (NXT_TLS)
 static ssize_t nxt_http_idle_io_read_handler(nxt_task_t *task, nxt_conn_t *c);
 static void nxt_http_conn_test(nxt_task_t *task, void *obj, void *data);
@@ -44,6 +55,24 @@ static nxt_int_t nxt_h1p_transfer_encoding(void *ctx, nxt_http_field_t *field,
 static void nxt_h1p_request_body_read(nxt_task_t *task, nxt_http_request_t *r);
 static void nxt_h1p_conn_request_body_read(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_h1p_request_body_chunked(nxt_task_t *task,
+    nxt_http_request_t *r);
+static void nxt_h1p_conn_request_body_chunked_read(nxt_task_t *task,
+    void *obj, void *data);
+static nxt_int_t nxt_h1p_request_body_dechunk(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_buf_t *in);
+static nxt_int_t nxt_h1p_request_body_store(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_buf_t *in);
+static nxt_int_t nxt_h1p_request_body_chunked_done(nxt_task_t *task,
+    nxt_http_request_t *r);
+static nxt_int_t nxt_h1p_request_body_stream(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_fd_t *fd);
+static void nxt_h1p_conn_body_stream_read(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_h1p_body_stream_sent(nxt_task_t *task, void *obj, void *data);
+static void nxt_h1p_body_stream_error(nxt_task_t *task, void *obj, void *data);
+static void nxt_h1p_body_stream_close(nxt_task_t *task, nxt_h1proto_t *h1p);
+static void nxt_h1p_body_stream_free(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_request_local_addr(nxt_task_t *task, nxt_http_request_t *r);
 static void nxt_h1p_request_header_send(nxt_task_t *task,
     nxt_http_request_t *r, nxt_work_handler_t body_handler, void *data);
@@ -53,6 +82,8 @@ static nxt_buf_t *nxt_h1p_chunk_create(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *out);
 static nxt_off_t nxt_h1p_request_body_bytes_sent(nxt_task_t *task,
     nxt_http_proto_t proto);
+static nxt_off_t nxt_h1p_request_bytes_received(nxt_task_t *task,
+    nxt_http_proto_t proto);
 static void nxt_h1p_request_discard(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *last);
 static void nxt_h1p_conn_request_error(nxt_task_t *task, void *obj, void *data);
@@ -81,7 +112,6 @@ static void nxt_h1p_idle_response_timeout(nxt_task_t *task, void *obj,
 static nxt_msec_t nxt_h1p_idle_response_timer_value(nxt_conn_t *c,
     uintptr_t data);
 static void nxt_h1p_shutdown(nxt_task_t *task, nxt_conn_t *c);
-static void nxt_h1p_closing(nxt_task_t *task, nxt_conn_t *c);
 static void nxt_h1p_conn_ws_shutdown(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_conn_closing(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_conn_free(nxt_task_t *task, void *obj, void *data);
@@ -106,7 +136,20 @@ static void nxt_h1p_peer_send_timeout(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_peer_read_timeout(nxt_task_t *task, void *obj, void *data);
 static nxt_msec_t nxt_h1p_peer_timer_value(nxt_conn_t *c, uintptr_t data);
 static void nxt_h1p_peer_close(nxt_task_t *task, nxt_http_peer_t *peer);
+static void nxt_h1p_peer_conn_close(nxt_task_t *task, nxt_conn_t *c);
 static void nxt_h1p_peer_free(nxt_task_t *task, void *obj, void *data);
+static nxt_conn_t *nxt_h1p_peer_pool_get(nxt_task_t *task, nxt_sockaddr_t *sa);
+static nxt_int_t nxt_h1p_peer_pool_add(nxt_task_t *task, nxt_conn_t *c,
+    nxt_socket_conf_t *skcf);
+static void nxt_h1p_peer_pool_remove(nxt_task_t *task,
+    nxt_h1p_peer_pool_t *pool, nxt_conn_t *c);
+static void nxt_h1p_peer_pool_query(nxt_lvlhsh_query_t *lhq,
+    nxt_sockaddr_t *sa);
+static nxt_int_t nxt_h1p_peer_pool_test(nxt_lvlhsh_query_t *lhq, void *data);
+static void nxt_h1p_peer_idle_close(nxt_task_t *task, void *obj, void *data);
+static void nxt_h1p_peer_idle_timeout(nxt_task_t *task, void *obj, void *data);
+static nxt_int_t nxt_h1p_peer_connection(void *ctx, nxt_http_field_t *field,
+    uintptr_t data);
 static nxt_int_t nxt_h1p_peer_transfer_encoding(void *ctx,
     nxt_http_field_t *field, uintptr_t data);
 
@@ -117,6 +160,10 @@ static const nxt_conn_state_t  nxt_h1p_shutdown_state;
 static const nxt_conn_state_t  nxt_h1p_idle_state;
 static const nxt_conn_state_t  nxt_h1p_header_parse_state;
 static const nxt_conn_state_t  nxt_h1p_read_body_state;
+static const nxt_conn_state_t  nxt_h1p_read_chunked_body_state;
+static const nxt_conn_state_t  nxt_h1p_body_stream_read_state;
+static const nxt_conn_state_t  nxt_h1p_body_stream_write_state;
+static const nxt_conn_state_t  nxt_h1p_body_stream_close_state;
 static const nxt_conn_state_t  nxt_h1p_request_send_state;
 static const nxt_conn_state_t  nxt_h1p_timeout_response_state;
 static const nxt_conn_state_t  nxt_h1p_keepalive_state;
@@ -128,16 +175,19 @@ static const nxt_conn_state_t  nxt_h1p_peer_header_read_state;
 static const nxt_conn_state_t  nxt_h1p_peer_header_read_timer_state;
 static const nxt_conn_state_t  nxt_h1p_peer_read_state;
 static const nxt_conn_state_t  nxt_h1p_peer_close_state;
+static const nxt_conn_state_t  nxt_h1p_peer_idle_state;
 
 
 const nxt_http_proto_table_t  nxt_http_proto[3] = {
     /* NXT_HTTP_PROTO_H1 */
     {
         .body_read        = nxt_h1p_request_body_read,
+        .body_stream      = nxt_h1p_request_body_stream,
         .local_addr       = nxt_h1p_request_local_addr,
         .header_send      = nxt_h1p_request_header_send,
         .send             = nxt_h1p_request_send,
         .body_bytes_sent  = nxt_h1p_request_body_bytes_sent,
+        .bytes_received   = nxt_h1p_request_bytes_received,
         .discard          = nxt_h1p_request_discard,
         .close            = nxt_h1p_request_close,
 
@@ -149,7 +199,18 @@ const nxt_http_proto_table_t  nxt_http_proto[3] = {
 
         .ws_frame_start   = nxt_h1p_websocket_frame_start,
     },
-    /* NXT_HTTP_PROTO_H2      */
+    /* NXT_HTTP_PROTO_H2 */
+    {
+        .body_read        = nxt_h2p_request_body_read,
+        .body_stream      = nxt_h2p_request_body_stream,
+        .local_addr       = nxt_h2p_request_local_addr,
+        .header_send      = nxt_h2p_request_header_send,
+        .send             = nxt_h2p_request_send,
+        .body_bytes_sent  = nxt_h2p_request_body_bytes_sent,
+        .bytes_received   = nxt_h2p_request_bytes_received,
+        .discard          = nxt_h2p_request_discard,
+        .close            = nxt_h2p_request_close,
+    },
     /* NXT_HTTP_PROTO_DEVNULL */
 };
 
@@ -176,13 +237,35 @@ static nxt_http_field_proc_t           nxt_h1p_fields[] = {
     { nxt_string("Content-Length"),    &nxt_http_request_content_length, 0 },
     { nxt_string("Authorization"),     &nxt_http_request_field,
         offsetof(nxt_http_request_t, authorization) },
+    { nxt_string("If-Match"),          &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_match) },
+    { nxt_string("If-None-Match"),     &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_none_match) },
+    { nxt_string("If-Modified-Since"), &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_modified_since) },
+    { nxt_string("If-Unmodified-Since"),
+                                       &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_unmodified_since) },
+    { nxt_string("If-Range"),          &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_range) },
+    { nxt_string("Range"),             &nxt_http_request_field,
+        offsetof(nxt_http_request_t, range) },
+    { nxt_string("Accept-Encoding"),   &nxt_http_request_field,
+        offsetof(nxt_http_request_t, accept_encoding) },
 };
 
 
 static nxt_lvlhsh_t                    nxt_h1p_peer_fields_hash;
 
+static const nxt_lvlhsh_proto_t  nxt_h1p_peer_pool_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_h1p_peer_pool_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
+
 static nxt_http_field_proc_t           nxt_h1p_peer_fields[] = {
-    { nxt_string("Connection"),        &nxt_http_proxy_skip, 0 },
+    { nxt_string("Connection"),        &nxt_h1p_peer_connection, 0 },
     { nxt_string("Transfer-Encoding"), &nxt_h1p_peer_transfer_encoding, 0 },
     { nxt_string("Server"),            &nxt_http_proxy_skip, 0 },
     { nxt_string("Date"),              &nxt_http_proxy_date, 0 },
@@ -443,13 +526,23 @@ nxt_h1p_idle_io_read_handler(nxt_task_t *task, nxt_conn_t *c)
 static void
 nxt_h1p_conn_proto_init(nxt_task_t *task, void *obj, void *data)
 {
-    nxt_conn_t     *c;
-    nxt_h1proto_t  *h1p;
+    nxt_conn_t               *c;
+    nxt_h1proto_t            *h1p;
+    nxt_socket_conf_joint_t  *joint;
 
     c = obj;
 
     nxt_debug(task, "h1p conn proto init");
 
+    joint = c->listen->socket.data;
+
+    if (c->alpn_h2
+        || (joint->socket_conf->http2 && nxt_h2p_preface_test(&c->read->mem)))
+    {
+        nxt_h2p_conn_init(task, c);
+        return;
+    }
+
     h1p = nxt_mp_zget(c->mem_pool, sizeof(nxt_h1proto_t));
     if (nxt_slow_path(h1p == NULL)) {
         nxt_h1p_closing(task, c);
@@ -491,6 +584,7 @@ nxt_h1p_conn_request_init(nxt_task_t *task, void *obj, void *data)
 
 #if (NXT_TLS)
         r->tls = c->u.tls;
+        r->ktls = (c->u.tls != NULL && c->sendfile == NXT_CONN_SENDFILE_ON);
 #endif
 
         r->task = c->task;
@@ -545,6 +639,7 @@ static const nxt_conn_state_t  nxt_h1p_header_parse_state
 static void
 nxt_h1p_conn_request_header_parse(nxt_task_t *task, void *obj, void *data)
 {
+    u_char              *pos;
     nxt_int_t           ret;
     nxt_conn_t          *c;
     nxt_h1proto_t       *h1p;
@@ -556,8 +651,12 @@ nxt_h1p_conn_request_header_parse(nxt_task_t *task, void *obj, void *data)
 
     nxt_debug(task, "h1p conn header parse");
 
+    pos = c->read->mem.pos;
+
     ret = nxt_http_parse_request(&h1p->parser, &c->read->mem);
 
+    h1p->received += c->read->mem.pos - pos;
+
     ret = nxt_expect(NXT_DONE, ret);
 
     if (ret != NXT_AGAIN) {
@@ -858,8 +957,8 @@ nxt_h1p_request_body_read(nxt_task_t *task, nxt_http_request_t *r)
     switch (h1p->transfer_encoding) {
 
     case NXT_HTTP_TE_CHUNKED:
-        status = NXT_HTTP_LENGTH_REQUIRED;
-        goto error;
+        nxt_h1p_request_body_chunked(task, r);
+        return;
 
     case NXT_HTTP_TE_UNSUPPORTED:
         status = NXT_HTTP_NOT_IMPLEMENTED;
@@ -879,6 +978,22 @@ nxt_h1p_request_body_read(nxt_task_t *task, nxt_http_request_t *r)
     body_buffer_size = nxt_min(r->conf->socket_conf->body_buffer_size,
                                body_length);
 
+    /*
+     * A large body is not read before routing in the streaming mode.
+     * Applications receive it via nxt_h1p_request_body_stream(),
+     * other actions call this handler again to read the body as usual.
+     */
+
+    if (r->body_state == NXT_HTTP_BODY_INITIAL
+        && body_length > body_buffer_size
+        && r->conf->socket_conf->body_streaming)
+    {
+        r->body_state = NXT_HTTP_BODY_DEFERRED;
+        goto ready;
+    }
+
+    r->body_state = NXT_HTTP_BODY_READ;
+
     if (body_length > body_buffer_size) {
         tmp_path = &r->conf->socket_conf->body_temp_path;
 
@@ -959,6 +1074,8 @@ nxt_h1p_request_body_read(nxt_task_t *task, nxt_http_request_t *r)
 
         in->mem.pos += size;
         body_rest -= size;
+
+        h1p->received += size;
     }
 
     nxt_debug(task, "h1p body rest: %uz", body_rest);
@@ -1029,60 +1146,713 @@ nxt_h1p_conn_request_body_read(nxt_task_t *task, void *obj, void *data)
 
     r = h1p->request;
 
+    h1p->received += c->nbytes;
+
     engine = task->thread->engine;
 
     b = c->read;
 
-    if (nxt_buf_is_file(b)) {
-        body_rest = b->file->size - b->file_end;
+    if (nxt_buf_is_file(b)) {
+        body_rest = b->file->size - b->file_end;
+
+        size = nxt_buf_mem_used_size(&b->mem);
+        size = nxt_min(size, body_rest);
+
+        res = nxt_fd_write(b->file->fd, b->mem.pos, size);
+        if (nxt_slow_path(res < (ssize_t) size)) {
+            nxt_h1p_request_error(task, h1p, r);
+            return;
+        }
+
+        b->file_end += size;
+        body_rest -= res;
+
+        b->mem.pos += size;
+
+        if (b->mem.pos == b->mem.free) {
+            if (body_rest >= (size_t) nxt_buf_mem_size(&b->mem)) {
+                b->mem.free = b->mem.start;
+
+            } else {
+                /* This required to avoid reading next request. */
+                b->mem.free = b->mem.end - body_rest;
+            }
+
+            b->mem.pos = b->mem.free;
+        }
+
+    } else {
+        body_rest = nxt_buf_mem_free_size(&c->read->mem);
+    }
+
+    nxt_debug(task, "h1p body rest: %uz", body_rest);
+
+    if (body_rest != 0) {
+        nxt_conn_read(engine, c);
+
+    } else {
+        if (nxt_buf_is_file(b)) {
+            b->mem.start = NULL;
+            b->mem.end = NULL;
+            b->mem.pos = NULL;
+            b->mem.free = NULL;
+        }
+
+        c->read = NULL;
+
+        r->state->ready_handler(task, r, NULL);
+    }
+}
+
+
+/*
+ * A chunked request body is decoded with nxt_http_chunk_parse() as it is
+ * read and is stored in the same way as a body with a known length: in
+ * a memory buffer while it fits into "body_buffer_size", in a temporary
+ * file otherwise.  The applications protocol requires the body length
+ * before the body, so a chunked body is read completely even in the body
+ * streaming mode, and the "Content-Length" field is added to the request.
+ */
+
+static void
+nxt_h1p_request_body_chunked(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_int_t      ret;
+    nxt_buf_t      *in, *b;
+    nxt_conn_t     *c;
+    nxt_h1proto_t  *h1p;
+
+    h1p = r->proto.h1;
+    c = h1p->conn;
+
+    r->body_state = NXT_HTTP_BODY_READ;
+
+    /* A request with both fields may be interpreted ambiguously. */
+    if (r->content_length != NULL) {
+        ret = NXT_HTTP_BAD_REQUEST;
+        goto error;
+    }
+
+    b = nxt_buf_mem_alloc(r->mem_pool, r->conf->socket_conf->body_buffer_size,
+                          0);
+    if (nxt_slow_path(b == NULL)) {
+        ret = NXT_HTTP_INTERNAL_SERVER_ERROR;
+        goto error;
+    }
+
+    r->body = b;
+
+    h1p->chunked_parse.mem_pool = r->mem_pool;
+
+    in = c->read;
+
+    ret = nxt_h1p_request_body_dechunk(task, r, in);
+
+    if (ret == NXT_OK) {
+        ret = nxt_h1p_request_body_chunked_done(task, r);
+
+        if (nxt_fast_path(ret == NXT_OK)) {
+            r->state->ready_handler(task, r, NULL);
+            return;
+        }
+    }
+
+    if (ret != NXT_AGAIN) {
+        goto error;
+    }
+
+    /*
+     * The connection buffer is used to read the rest of the body,
+     * because the end of the body is not known in advance.
+     */
+    b = nxt_buf_mem_alloc(c->mem_pool, r->conf->socket_conf->body_buffer_size,
+                          0);
+    if (nxt_slow_path(b == NULL)) {
+        ret = NXT_HTTP_INTERNAL_SERVER_ERROR;
+        goto error;
+    }
+
+    in->next = h1p->buffers;
+    h1p->buffers = in;
+    h1p->nbuffers++;
+
+    c->read = b;
+    c->read_state = &nxt_h1p_read_chunked_body_state;
+
+    nxt_conn_read(task->thread->engine, c);
+
+    return;
+
+error:
+
+    h1p->keepalive = 0;
+
+    nxt_http_request_error(task, r, ret);
+}
+
+
+static const nxt_conn_state_t  nxt_h1p_read_chunked_body_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h1p_conn_request_body_chunked_read,
+    .close_handler = nxt_h1p_conn_request_error,
+    .error_handler = nxt_h1p_conn_request_error,
+
+    .timer_handler = nxt_h1p_conn_request_timeout,
+    .timer_value = nxt_h1p_conn_request_timer_value,
+    .timer_data = offsetof(nxt_socket_conf_t, body_read_timeout),
+    .timer_autoreset = 1,
+};
+
+
+static void
+nxt_h1p_conn_request_body_chunked_read(nxt_task_t *task, void *obj,
+    void *data)
+{
+    nxt_int_t           ret;
+    nxt_buf_t           *b;
+    nxt_conn_t          *c;
+    nxt_h1proto_t       *h1p;
+    nxt_http_request_t  *r;
+
+    c = obj;
+    h1p = data;
+
+    nxt_debug(task, "h1p conn request body chunked read");
+
+    r = h1p->request;
+
+    h1p->received += c->nbytes;
+
+    b = c->read;
+
+    ret = nxt_h1p_request_body_dechunk(task, r, b);
+
+    if (ret == NXT_AGAIN) {
+        b->mem.pos = b->mem.start;
+        b->mem.free = b->mem.start;
+
+        nxt_conn_read(task->thread->engine, c);
+        return;
+    }
+
+    if (nxt_buf_mem_used_size(&b->mem) == 0) {
+        b->next = h1p->buffers;
+        h1p->buffers = b;
+        h1p->nbuffers++;
+
+        c->read = NULL;
+    }
+
+    /* Otherwise the rest of the buffer is the next pipelined request. */
+
+    if (ret == NXT_OK) {
+        ret = nxt_h1p_request_body_chunked_done(task, r);
+
+        if (nxt_fast_path(ret == NXT_OK)) {
+            r->state->ready_handler(task, r, NULL);
+            return;
+        }
+    }
+
+    h1p->keepalive = 0;
+
+    nxt_http_request_error(task, r, ret);
+}
+
+
+/*
+ * nxt_h1p_request_body_dechunk() stores the chunks data of the "in" buffer
+ * and returns NXT_OK if the body is complete, NXT_AGAIN if more data are
+ * required, or an HTTP error status.
+ */
+
+static nxt_int_t
+nxt_h1p_request_body_dechunk(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *in)
+{
+    nxt_int_t               ret;
+    nxt_buf_t               *b, *out;
+    nxt_h1proto_t           *h1p;
+    nxt_http_chunk_parse_t  *hcp;
+
+    if (nxt_buf_mem_used_size(&in->mem) == 0) {
+        return NXT_AGAIN;
+    }
+
+    h1p = r->proto.h1;
+    hcp = &h1p->chunked_parse;
+
+    /*
+     * The parser refers to the data of its input buffers and completes them,
+     * so it is given a temporary buffer instead of the connection buffer.
+     */
+    b = nxt_buf_mem_alloc(r->mem_pool, 0, 0);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    b->mem.start = in->mem.pos;
+    b->mem.pos = in->mem.pos;
+    b->mem.free = in->mem.free;
+    b->mem.end = in->mem.free;
+
+    out = nxt_http_chunk_parse(task, hcp, b);
+
+    if (nxt_slow_path(hcp->chunk_error)) {
+        ret = NXT_HTTP_BAD_REQUEST;
+
+    } else if (nxt_slow_path(hcp->error)) {
+        ret = NXT_HTTP_INTERNAL_SERVER_ERROR;
+
+    } else {
+        in->mem.pos = hcp->complete ? hcp->pos : in->mem.free;
+
+        ret = NXT_OK;
+
+        for (b = out; b != NULL; b = b->next) {
+            ret = nxt_h1p_request_body_store(task, r, b);
+
+            if (nxt_slow_path(ret != NXT_OK)) {
+                break;
+            }
+        }
+    }
+
+    if (out != NULL) {
+        out->completion_handler(task, out, out->parent);
+    }
+
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
+    return hcp->complete ? NXT_OK : NXT_AGAIN;
+}
+
+
+static nxt_int_t
+nxt_h1p_request_body_store(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *in)
+{
+    size_t     size;
+    ssize_t    res;
+    nxt_buf_t  *b;
+    nxt_str_t  *tmp_path, tmp_name;
+    nxt_off_t  length;
+
+    static const nxt_str_t tmp_name_pattern = nxt_string("/req-XXXXXXXX");
+
+    b = r->body;
+    size = nxt_buf_mem_used_size(&in->mem);
+
+    if (size == 0) {
+        return NXT_OK;
+    }
+
+    length = nxt_buf_is_file(b) ? b->file_end
+                                : (nxt_off_t) nxt_buf_mem_used_size(&b->mem);
+
+    if (nxt_slow_path(length + (nxt_off_t) size
+                      > (nxt_off_t) r->conf->socket_conf->max_body_size))
+    {
+        return NXT_HTTP_PAYLOAD_TOO_LARGE;
+    }
+
+    if (!nxt_buf_is_file(b)) {
+
+        if (size <= (size_t) nxt_buf_mem_free_size(&b->mem)) {
+            b->mem.free = nxt_cpymem(b->mem.free, in->mem.pos, size);
+            return NXT_OK;
+        }
+
+        /* The body does not fit into the buffer and moves to a file. */
+
+        tmp_path = &r->conf->socket_conf->body_temp_path;
+
+        tmp_name.length = tmp_path->length + tmp_name_pattern.length;
+
+        b = nxt_buf_file_alloc(r->mem_pool,
+                               sizeof(nxt_file_t) + tmp_name.length + 1, 0);
+        if (nxt_slow_path(b == NULL)) {
+            return NXT_HTTP_INTERNAL_SERVER_ERROR;
+        }
+
+        tmp_name.start = nxt_pointer_to(b->mem.start, sizeof(nxt_file_t));
+
+        memcpy(tmp_name.start, tmp_path->start, tmp_path->length);
+        memcpy(tmp_name.start + tmp_path->length, tmp_name_pattern.start,
+               tmp_name_pattern.length);
+        tmp_name.start[tmp_name.length] = '\0';
+
+        b->file = (nxt_file_t *) b->mem.start;
+        nxt_memzero(b->file, sizeof(nxt_file_t));
+
+        b->mem.start = NULL;
+        b->mem.end = NULL;
+        b->mem.pos = NULL;
+        b->mem.free = NULL;
+
+        b->file->fd = mkstemp((char *) tmp_name.start);
+        if (nxt_slow_path(b->file->fd == -1)) {
+            nxt_alert(task, "mkstemp(%s) failed %E", tmp_name.start, nxt_errno);
+
+            return NXT_HTTP_INTERNAL_SERVER_ERROR;
+        }
+
+        nxt_debug(task, "create body tmp file \"%V\", %d",
+                  &tmp_name, b->file->fd);
+
+        unlink((char *) tmp_name.start);
+
+        if (length != 0) {
+            res = nxt_fd_write(b->file->fd, r->body->mem.pos, length);
+            if (nxt_slow_path(res < (ssize_t) length)) {
+                nxt_fd_close(b->file->fd);
+                return NXT_HTTP_INTERNAL_SERVER_ERROR;
+            }
+
+            b->file_end = length;
+        }
+
+        nxt_mp_free(r->mem_pool, r->body);
+        r->body = b;
+    }
+
+    res = nxt_fd_write(b->file->fd, in->mem.pos, size);
+    if (nxt_slow_path(res < (ssize_t) size)) {
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    b->file_end += size;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_h1p_request_body_chunked_done(nxt_task_t *task, nxt_http_request_t *r)
+{
+    u_char            *p;
+    uint32_t          hash;
+    nxt_buf_t         *b;
+    nxt_uint_t        i;
+    nxt_http_field_t  *field;
+
+    static const char  name[] = "content-length";
+
+    b = r->body;
+
+    if (nxt_buf_is_file(b)) {
+        b->file->size = b->file_end;
+        r->content_length_n = b->file_end;
+
+    } else {
+        r->content_length_n = nxt_buf_mem_used_size(&b->mem);
+    }
+
+    nxt_debug(task, "h1p chunked body: %O", r->content_length_n);
+
+    field = nxt_list_zero_add(r->fields);
+    if (nxt_slow_path(field == NULL)) {
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    p = nxt_mp_nget(r->mem_pool, NXT_OFF_T_LEN);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    hash = NXT_HTTP_FIELD_HASH_INIT;
+
+    for (i = 0; i < nxt_length(name); i++) {
+        hash = nxt_http_field_hash_char(hash, name[i]);
+    }
+
+    field->hash = nxt_http_field_hash_end(hash) & 0xFFFF;
+
+    nxt_http_field_name_set(field, "Content-Length");
+
+    field->value = p;
+    field->value_length = nxt_sprintf(p, p + NXT_OFF_T_LEN, "%O",
+                                      r->content_length_n) - p;
+
+    r->content_length = field;
+
+    return NXT_OK;
+}
+
+
+/*
+ * The deferred request body is streamed to an application via a socket
+ * pair.  The preread part of the body is sent along with the request
+ * headers, the rest is read from the client connection by body_buffer_size
+ * chunks and each chunk is written to the socket before the next one is
+ * read, so a slow application throttles the client.  The application side
+ * of the socket pair is passed to the application as the body file
+ * descriptor and reaches the end of file when the body is complete.
+ */
+
+static nxt_int_t
+nxt_h1p_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_fd_t *fd)
+{
+    size_t              size;
+    nxt_mp_t            *mp;
+    nxt_buf_t           *in, *b;
+    nxt_conn_t          *c, *sc;
+    nxt_socket_t        pair[2];
+    nxt_h1proto_t       *h1p;
+    nxt_event_engine_t  *engine;
+
+    *fd = -1;
+
+    if (r->body_state != NXT_HTTP_BODY_DEFERRED) {
+        return NXT_OK;
+    }
+
+    r->body_state = NXT_HTTP_BODY_STREAMED;
+
+    h1p = r->proto.h1;
+    c = h1p->conn;
+    in = c->read;
+
+    h1p->remainder = r->content_length_n;
+
+    size = nxt_buf_mem_used_size(&in->mem);
+    size = nxt_min(size, (size_t) h1p->remainder);
+
+    if (size != 0) {
+        b = nxt_buf_mem_alloc(r->mem_pool, size, 0);
+        if (nxt_slow_path(b == NULL)) {
+            return NXT_ERROR;
+        }
+
+        b->mem.free = nxt_cpymem(b->mem.free, in->mem.pos, size);
+
+        in->mem.pos += size;
+        h1p->remainder -= size;
+        h1p->received += size;
+
+        r->body = b;
+    }
+
+    nxt_debug(task, "h1p body stream rest: %O", h1p->remainder);
+
+    if (h1p->remainder == 0) {
+        return NXT_OK;
+    }
+
+    size = nxt_min(r->conf->socket_conf->body_buffer_size,
+                   (size_t) h1p->remainder);
+
+    b = nxt_buf_mem_alloc(r->mem_pool, size, 0);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_ERROR;
+    }
+
+    if (nxt_slow_path(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)) {
+        nxt_alert(task, "socketpair() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_debug(task, "body stream socketpair(): %d:%d", pair[0], pair[1]);
+
+    if (nxt_slow_path(fcntl(pair[0], F_SETFD, FD_CLOEXEC) == -1
+                      || fcntl(pair[1], F_SETFD, FD_CLOEXEC) == -1
+                      || nxt_socket_nonblocking(task, pair[0]) != NXT_OK))
+    {
+        goto fail;
+    }
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        goto fail;
+    }
+
+    sc = nxt_conn_create(mp, task);
+    if (nxt_slow_path(sc == NULL)) {
+        nxt_mp_destroy(mp);
+        goto fail;
+    }
+
+    sc->socket.fd = pair[0];
+    sc->socket.data = h1p;
+    sc->socket.write_ready = 1;
+    sc->write_state = &nxt_h1p_body_stream_write_state;
+
+    sc->read_work_queue = c->read_work_queue;
+    sc->write_work_queue = c->write_work_queue;
+
+    h1p->body_stream = sc;
+
+    in->next = h1p->buffers;
+    h1p->buffers = in;
+    h1p->nbuffers++;
+
+    c->read = b;
+    c->read_state = &nxt_h1p_body_stream_read_state;
+
+    engine = task->thread->engine;
+
+    nxt_conn_read(engine, c);
+
+    *fd = pair[1];
+
+    return NXT_OK;
+
+fail:
+
+    nxt_socket_close(task, pair[0]);
+    nxt_socket_close(task, pair[1]);
+
+    return NXT_ERROR;
+}
+
+
+static const nxt_conn_state_t  nxt_h1p_body_stream_read_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h1p_conn_body_stream_read,
+    .close_handler = nxt_h1p_conn_request_error,
+    .error_handler = nxt_h1p_conn_request_error,
+
+    .timer_handler = nxt_h1p_conn_request_timeout,
+    .timer_value = nxt_h1p_conn_request_timer_value,
+    .timer_data = offsetof(nxt_socket_conf_t, body_read_timeout),
+    .timer_autoreset = 1,
+};
+
+
+static void
+nxt_h1p_conn_body_stream_read(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t     *c, *sc;
+    nxt_h1proto_t  *h1p;
+
+    c = obj;
+    h1p = data;
+
+    nxt_debug(task, "h1p conn body stream read %uz", c->nbytes);
+
+    sc = h1p->body_stream;
+
+    if (sc == NULL) {
+        /* The application has closed its side of the socket pair. */
+        c->read = NULL;
+        return;
+    }
+
+    h1p->remainder -= c->nbytes;
+    h1p->received += c->nbytes;
+
+    sc->write = c->read;
+
+    nxt_conn_write(task->thread->engine, sc);
+}
+
+
+static const nxt_conn_state_t  nxt_h1p_body_stream_write_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h1p_body_stream_sent,
+    .error_handler = nxt_h1p_body_stream_error,
+};
+
+
+static void
+nxt_h1p_body_stream_sent(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t      *b;
+    nxt_conn_t     *c, *sc;
+    nxt_h1proto_t  *h1p;
+
+    sc = obj;
+    h1p = data;
+
+    nxt_debug(task, "h1p body stream sent, rest: %O", h1p->remainder);
+
+    sc->write = NULL;
+
+    c = h1p->conn;
+
+    if (h1p->remainder == 0) {
+        c->read = NULL;
+
+        nxt_h1p_body_stream_close(task, h1p);
+        return;
+    }
+
+    b = c->read;
+
+    if (h1p->remainder >= (nxt_off_t) nxt_buf_mem_size(&b->mem)) {
+        b->mem.free = b->mem.start;
+
+    } else {
+        /* This required to avoid reading next request. */
+        b->mem.free = b->mem.end - h1p->remainder;
+    }
+
+    b->mem.pos = b->mem.free;
+
+    nxt_conn_read(task->thread->engine, c);
+}
+
+
+static void
+nxt_h1p_body_stream_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_h1proto_t  *h1p;
+
+    h1p = data;
+
+    nxt_debug(task, "h1p body stream error");
+
+    /*
+     * The application does not read the rest of the body,
+     * so the client connection cannot be kept alive.
+     */
+    h1p->keepalive = 0;
+    h1p->conn->read = NULL;
+
+    nxt_h1p_body_stream_close(task, h1p);
+}
 
-        size = nxt_buf_mem_used_size(&b->mem);
-        size = nxt_min(size, body_rest);
 
-        res = nxt_fd_write(b->file->fd, b->mem.pos, size);
-        if (nxt_slow_path(res < (ssize_t) size)) {
-            nxt_h1p_request_error(task, h1p, r);
-            return;
-        }
+static void
+nxt_h1p_body_stream_close(nxt_task_t *task, nxt_h1proto_t *h1p)
+{
+    nxt_conn_t  *sc;
 
-        b->file_end += size;
-        body_rest -= res;
+    sc = h1p->body_stream;
+    h1p->body_stream = NULL;
 
-        b->mem.pos += size;
+    nxt_debug(task, "h1p body stream close fd:%d", sc->socket.fd);
 
-        if (b->mem.pos == b->mem.free) {
-            if (body_rest >= (size_t) nxt_buf_mem_size(&b->mem)) {
-                b->mem.free = b->mem.start;
+    sc->socket.data = NULL;
+    sc->write_state = &nxt_h1p_body_stream_close_state;
 
-            } else {
-                /* This required to avoid reading next request. */
-                b->mem.free = b->mem.end - body_rest;
-            }
+    nxt_conn_close(task->thread->engine, sc);
+}
 
-            b->mem.pos = b->mem.free;
-        }
 
-    } else {
-        body_rest = nxt_buf_mem_free_size(&c->read->mem);
-    }
+static const nxt_conn_state_t  nxt_h1p_body_stream_close_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h1p_body_stream_free,
+};
 
-    nxt_debug(task, "h1p body rest: %uz", body_rest);
 
-    if (body_rest != 0) {
-        nxt_conn_read(engine, c);
+static void
+nxt_h1p_body_stream_free(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t  *sc;
 
-    } else {
-        if (nxt_buf_is_file(b)) {
-            b->mem.start = NULL;
-            b->mem.end = NULL;
-            b->mem.pos = NULL;
-            b->mem.free = NULL;
-        }
+    sc = obj;
 
-        c->read = NULL;
+    nxt_debug(task, "h1p body stream free");
 
-        r->state->ready_handler(task, r, NULL);
-    }
+    nxt_conn_free(task, sc);
 }
 
 
@@ -1227,6 +1997,11 @@ nxt_h1p_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
     h1p = r->proto.h1;
     n = r->status;
 
+    /* The response is sent before the streamed body has been read. */
+    if (r->body_state == NXT_HTTP_BODY_DEFERRED || h1p->remainder != 0) {
+        h1p->keepalive = 0;
+    }
+
     if (n >= NXT_HTTP_CONTINUE && n <= NXT_HTTP_LAST_INFORMATIONAL) {
         status = &nxt_http_informational[n - NXT_HTTP_CONTINUE];
 
@@ -1554,6 +2329,13 @@ nxt_h1p_request_body_bytes_sent(nxt_task_t *task, nxt_http_proto_t proto)
 }
 
 
+static nxt_off_t
+nxt_h1p_request_bytes_received(nxt_task_t *task, nxt_http_proto_t proto)
+{
+    return proto.h1->received;
+}
+
+
 static void
 nxt_h1p_request_discard(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *last)
@@ -1691,6 +2473,17 @@ nxt_h1p_request_close(nxt_task_t *task, nxt_http_proto_t proto,
 
     h1p = proto.h1;
     h1p->keepalive &= !h1p->request->inconsistent;
+
+    if (h1p->body_stream != NULL) {
+        nxt_h1p_body_stream_close(task, h1p);
+    }
+
+    if (h1p->request->body_state == NXT_HTTP_BODY_DEFERRED
+        || h1p->remainder != 0)
+    {
+        h1p->keepalive = 0;
+    }
+
     h1p->request = NULL;
 
     nxt_router_conf_release(task, joint);
@@ -2043,7 +2836,7 @@ nxt_h1p_conn_ws_shutdown(nxt_task_t *task, void *obj, void *data)
 }
 
 
-static void
+void
 nxt_h1p_closing(nxt_task_t *task, nxt_conn_t *c)
 {
     nxt_debug(task, "h1p closing");
@@ -2133,19 +2926,18 @@ nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
     nxt_fd_event_t      *socket;
     nxt_work_queue_t    *wq;
     nxt_http_request_t  *r;
+    nxt_event_engine_t  *engine;
 
     nxt_debug(task, "h1p peer connect");
 
     peer->status = NXT_HTTP_UNSET;
     r = peer->request;
 
-    mp = nxt_mp_create(1024, 128, 256, 32);
-
-    if (nxt_slow_path(mp == NULL)) {
-        goto fail;
-    }
-
-    h1p = nxt_mp_zalloc(mp, sizeof(nxt_h1proto_t));
+    /*
+     * The protocol state is allocated from the request pool
+     * since a keep-alive connection outlives the request.
+     */
+    h1p = nxt_mp_zalloc(r->mem_pool, sizeof(nxt_h1proto_t));
     if (nxt_slow_path(h1p == NULL)) {
         goto fail;
     }
@@ -2155,12 +2947,34 @@ nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
         goto fail;
     }
 
-    c = nxt_conn_create(mp, task);
-    if (nxt_slow_path(c == NULL)) {
-        goto fail;
+    engine = task->thread->engine;
+    c = NULL;
+
+    if (r->conf->socket_conf->proxy_keepalive != 0) {
+        c = nxt_h1p_peer_pool_get(task, peer->server->sockaddr);
+    }
+
+    peer->reused = (c != NULL);
+
+    if (c == NULL) {
+        mp = nxt_mp_create(1024, 128, 256, 32);
+
+        if (nxt_slow_path(mp == NULL)) {
+            goto fail;
+        }
+
+        c = nxt_conn_create(mp, task);
+        if (nxt_slow_path(c == NULL)) {
+            nxt_mp_destroy(mp);
+            goto fail;
+        }
+
+        c->mem_pool = mp;
+
+        c->socket.write_ready = 1;
+        c->write_state = &nxt_h1p_peer_connect_state;
     }
 
-    c->mem_pool = mp;
     h1p->conn = c;
 
     peer->proto.h1 = h1p;
@@ -2169,9 +2983,6 @@ nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
     c->socket.data = peer;
     c->remote = peer->server->sockaddr;
 
-    c->socket.write_ready = 1;
-    c->write_state = &nxt_h1p_peer_connect_state;
-
     /*
      * TODO: queues should be implemented via client proto interface.
      */
@@ -2189,7 +3000,13 @@ nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
     c->write_timer.work_queue = wq;
     /* TODO END */
 
-    nxt_conn_connect(task->thread->engine, c);
+    if (peer->reused) {
+        nxt_work_queue_add(&engine->fast_work_queue, nxt_h1p_peer_connected,
+                           task, c, peer);
+        return;
+    }
+
+    nxt_conn_connect(engine, c);
 
     return;
 
@@ -2224,6 +3041,8 @@ nxt_h1p_peer_connected(nxt_task_t *task, void *obj, void *data)
 
     nxt_debug(task, "h1p peer connected");
 
+    peer->connected = 1;
+
     r = peer->request;
     r->state->ready_handler(task, r, peer);
 }
@@ -2287,7 +3106,10 @@ nxt_h1p_peer_header_send(nxt_task_t *task, nxt_http_peer_t *peer)
     *p++ = ' ';
     p = nxt_cpymem(p, r->target.start, r->target.length);
     p = nxt_cpymem(p, " HTTP/1.1\r\n", 11);
-    p = nxt_cpymem(p, "Connection: close\r\n", 19);
+
+    if (r->conf->socket_conf->proxy_keepalive == 0) {
+        p = nxt_cpymem(p, "Connection: close\r\n", 19);
+    }
 
     nxt_list_each(field, r->fields) {
 
@@ -2542,8 +3364,31 @@ nxt_h1p_peer_header_read_done(nxt_task_t *task, void *obj, void *data)
 
             h1p->chunked_parse.mem_pool = c->mem_pool;
 
+        } else if (r->resp.content_length_n == 0
+                   || peer->status == NXT_HTTP_NO_CONTENT
+                   || peer->status == NXT_HTTP_NOT_MODIFIED
+                   || nxt_str_eq(r->method, "HEAD", 4))
+        {
+            /* The response has no body. */
+
+            if (nxt_buf_mem_used_size(&b->mem) != 0) {
+                h1p->keepalive = 0;
+            }
+
+            nxt_http_proxy_buf_mem_free(task, r, b);
+
+            peer->body = nxt_http_buf_last(r);
+            peer->closed = 1;
+
+            r->state->ready_handler(task, r, peer);
+            return;
+
         } else if (r->resp.content_length_n > 0) {
             h1p->remainder = r->resp.content_length_n;
+
+        } else {
+            /* The response is delimited by closing the connection. */
+            h1p->keepalive = 0;
         }
 
         if (nxt_buf_mem_used_size(&b->mem) != 0) {
@@ -2605,6 +3450,8 @@ nxt_h1p_peer_header_parse(nxt_http_peer_t *peer, nxt_buf_mem_t *bm)
             return NXT_ERROR;
         }
 
+        peer->proto.h1->keepalive = (p[7] == '1');
+
         p += 12;
         length -= 12;
 
@@ -2699,6 +3546,14 @@ nxt_h1p_peer_body_process(nxt_task_t *task, nxt_http_peer_t *peer,
     } else if (h1p->remainder > 0) {
         length = nxt_buf_chain_length(out);
         h1p->remainder -= length;
+
+        if (h1p->remainder <= 0) {
+            /* Data beyond the response body make the connection unusable. */
+            h1p->keepalive &= (h1p->remainder == 0);
+
+            nxt_buf_chain_add(&out, nxt_http_buf_last(peer->request));
+            peer->closed = 1;
+        }
     }
 
     peer->body = out;
@@ -2720,6 +3575,8 @@ nxt_h1p_peer_closed(nxt_task_t *task, void *obj, void *data)
 
     r = peer->request;
 
+    peer->proto.h1->keepalive = 0;
+
     if (peer->header_received) {
         peer->body = nxt_http_buf_last(r);
         peer->closed = 1;
@@ -2814,18 +3671,45 @@ nxt_h1p_peer_timer_value(nxt_conn_t *c, uintptr_t data)
 static void
 nxt_h1p_peer_close(nxt_task_t *task, nxt_http_peer_t *peer)
 {
-    nxt_conn_t  *c;
+    nxt_int_t          ret;
+    nxt_bool_t         keepalive;
+    nxt_conn_t         *c;
+    nxt_h1proto_t      *h1p;
+    nxt_socket_conf_t  *skcf;
 
     nxt_debug(task, "h1p peer close");
 
+    h1p = peer->proto.h1;
+    c = h1p->conn;
+    skcf = peer->request->conf->socket_conf;
+
+    /* The response has been read completely if the peer is closed here. */
+    keepalive = peer->closed && h1p->keepalive && skcf->proxy_keepalive != 0
+                && c->socket.fd != -1 && c->socket.error == 0
+                && !c->socket.closed && c->read == NULL && c->write == NULL;
+
     peer->closed = 1;
 
-    c = peer->proto.h1->conn;
     task = &c->task;
     c->socket.task = task;
     c->read_timer.task = task;
     c->write_timer.task = task;
 
+    if (keepalive) {
+        ret = nxt_h1p_peer_pool_add(task, c, skcf);
+
+        if (nxt_fast_path(ret == NXT_OK)) {
+            return;
+        }
+    }
+
+    nxt_h1p_peer_conn_close(task, c);
+}
+
+
+static void
+nxt_h1p_peer_conn_close(nxt_task_t *task, nxt_conn_t *c)
+{
     if (c->socket.fd != -1) {
         c->write_state = &nxt_h1p_peer_close_state;
 
@@ -2857,6 +3741,229 @@ nxt_h1p_peer_free(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static nxt_conn_t *
+nxt_h1p_peer_pool_get(nxt_task_t *task, nxt_sockaddr_t *sa)
+{
+    nxt_conn_t           *c;
+    nxt_queue_link_t     *link;
+    nxt_lvlhsh_query_t   lhq;
+    nxt_event_engine_t   *engine;
+    nxt_h1p_peer_pool_t  *pool;
+
+    engine = task->thread->engine;
+
+    nxt_h1p_peer_pool_query(&lhq, sa);
+
+    if (nxt_lvlhsh_find(&engine->peer_connections, &lhq) != NXT_OK) {
+        return NULL;
+    }
+
+    pool = lhq.value;
+
+    /* The most recently used connection is the least likely to be closed. */
+    link = nxt_queue_first(&pool->idle);
+    c = nxt_queue_link_data(link, nxt_conn_t, link);
+
+    nxt_debug(task, "h1p peer keepalive fd:%d", c->socket.fd);
+
+    nxt_h1p_peer_pool_remove(task, pool, c);
+
+    nxt_fd_event_block_read(engine, &c->socket);
+
+    return c;
+}
+
+
+static nxt_int_t
+nxt_h1p_peer_pool_add(nxt_task_t *task, nxt_conn_t *c, nxt_socket_conf_t *skcf)
+{
+    nxt_conn_t           *last;
+    nxt_queue_link_t     *link;
+    nxt_lvlhsh_query_t   lhq;
+    nxt_event_engine_t   *engine;
+    nxt_h1p_peer_pool_t  *pool;
+
+    engine = task->thread->engine;
+
+    nxt_h1p_peer_pool_query(&lhq, c->remote);
+
+    if (nxt_lvlhsh_find(&engine->peer_connections, &lhq) == NXT_OK) {
+        pool = lhq.value;
+
+    } else {
+        pool = nxt_malloc(sizeof(nxt_h1p_peer_pool_t) + lhq.key.length);
+        if (nxt_slow_path(pool == NULL)) {
+            return NXT_ERROR;
+        }
+
+        nxt_queue_init(&pool->idle);
+        pool->count = 0;
+        pool->socklen = lhq.key.length;
+        nxt_memcpy(pool->sockaddr, lhq.key.start, lhq.key.length);
+
+        lhq.key.start = pool->sockaddr;
+        lhq.replace = 0;
+        lhq.value = pool;
+
+        if (nxt_slow_path(nxt_lvlhsh_insert(&engine->peer_connections, &lhq)
+                          != NXT_OK))
+        {
+            nxt_free(pool);
+            return NXT_ERROR;
+        }
+    }
+
+    if (pool->count >= skcf->proxy_keepalive) {
+        link = nxt_queue_last(&pool->idle);
+        last = nxt_queue_link_data(link, nxt_conn_t, link);
+
+        nxt_queue_remove(link);
+        nxt_timer_disable(engine, &last->read_timer);
+        pool->count--;
+
+        nxt_h1p_peer_conn_close(task, last);
+    }
+
+    nxt_debug(task, "h1p peer idle fd:%d", c->socket.fd);
+
+    nxt_queue_insert_head(&pool->idle, &c->link);
+    pool->count++;
+
+    c->socket.data = pool;
+    c->read_state = &nxt_h1p_peer_idle_state;
+
+    c->read_timer.handler = nxt_h1p_peer_idle_timeout;
+    nxt_timer_add(engine, &c->read_timer, skcf->proxy_keepalive_timeout);
+
+    nxt_conn_wait(c);
+
+    return NXT_OK;
+}
+
+
+static const nxt_conn_state_t  nxt_h1p_peer_idle_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h1p_peer_idle_close,
+    .close_handler = nxt_h1p_peer_idle_close,
+    .error_handler = nxt_h1p_peer_idle_close,
+};
+
+
+static void
+nxt_h1p_peer_pool_remove(nxt_task_t *task, nxt_h1p_peer_pool_t *pool,
+    nxt_conn_t *c)
+{
+    nxt_lvlhsh_query_t  lhq;
+    nxt_event_engine_t  *engine;
+
+    engine = task->thread->engine;
+
+    nxt_queue_remove(&c->link);
+    nxt_timer_disable(engine, &c->read_timer);
+
+    pool->count--;
+
+    if (pool->count == 0) {
+        lhq.key_hash = nxt_djb_hash(pool->sockaddr, pool->socklen);
+        lhq.key.length = pool->socklen;
+        lhq.key.start = pool->sockaddr;
+        lhq.proto = &nxt_h1p_peer_pool_proto;
+        lhq.pool = NULL;
+
+        (void) nxt_lvlhsh_delete(&engine->peer_connections, &lhq);
+
+        nxt_free(pool);
+    }
+}
+
+
+static void
+nxt_h1p_peer_pool_query(nxt_lvlhsh_query_t *lhq, nxt_sockaddr_t *sa)
+{
+    lhq->key.length = sa->socklen;
+    lhq->key.start = (u_char *) &sa->u.sockaddr;
+    lhq->key_hash = nxt_djb_hash(lhq->key.start, lhq->key.length);
+    lhq->proto = &nxt_h1p_peer_pool_proto;
+    lhq->pool = NULL;
+}
+
+
+static nxt_int_t
+nxt_h1p_peer_pool_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_h1p_peer_pool_t  *pool;
+
+    pool = data;
+
+    if (lhq->key.length == pool->socklen
+        && nxt_memcmp(lhq->key.start, pool->sockaddr, pool->socklen) == 0)
+    {
+        return NXT_OK;
+    }
+
+    return NXT_DECLINED;
+}
+
+
+/*
+ * An idle connection is closed if an upstream server closes it
+ * or sends unexpected data.
+ */
+
+static void
+nxt_h1p_peer_idle_close(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t           *c;
+    nxt_h1p_peer_pool_t  *pool;
+
+    c = obj;
+    pool = data;
+
+    nxt_debug(task, "h1p peer idle close fd:%d", c->socket.fd);
+
+    nxt_h1p_peer_pool_remove(task, pool, c);
+
+    nxt_h1p_peer_conn_close(task, c);
+}
+
+
+static void
+nxt_h1p_peer_idle_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    c = nxt_read_timer_conn(timer);
+
+    nxt_debug(task, "h1p peer idle timeout fd:%d", c->socket.fd);
+
+    nxt_h1p_peer_pool_remove(task, c->socket.data, c);
+
+    nxt_h1p_peer_conn_close(task, c);
+}
+
+
+static nxt_int_t
+nxt_h1p_peer_connection(void *ctx, nxt_http_field_t *field, uintptr_t data)
+{
+    nxt_http_request_t  *r;
+
+    r = ctx;
+    field->skip = 1;
+
+    if (field->value_length == 5
+        && nxt_memcasecmp(field->value, "close", 5) == 0)
+    {
+        r->peer->proto.h1->keepalive = 0;
+    }
+
+    return NXT_OK;
+}
+
+
 static nxt_int_t
 nxt_h1p_peer_transfer_encoding(void *ctx, nxt_http_field_t *field,
     uintptr_t data)
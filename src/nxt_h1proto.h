@@ -20,6 +20,8 @@ struct nxt_h1proto_s {
     nxt_http_request_parse_t  parser;
     nxt_http_chunk_parse_t    chunked_parse;
     nxt_off_t                 remainder;
+    /* The request bytes read from the client connection. */
+    nxt_off_t                 received;
 
     uint8_t                   nbuffers;
     uint8_t                   header_buffer_slot;
@@ -42,6 +44,7 @@ struct nxt_h1proto_s {
 
     nxt_http_request_t        *request;
     nxt_buf_t                 *buffers;
+    nxt_conn_t                *body_stream;
 
     nxt_buf_t                 **conn_write_tail;
     /*
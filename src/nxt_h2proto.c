@@ -0,0 +1,2490 @@
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_h2proto.h>
+
+
+/*
+ * HTTP/2, RFC 7540.
+ *
+ * A connection is switched to HTTP/2 either by the "h2" protocol negotiated
+ * via TLS ALPN or by the connection preface of a client with prior knowledge.
+ * Each stream runs its own nxt_http_request_t through the usual request
+ * pipeline.  A request header block is decoded and converted to HTTP/1.1
+ * form, so the request line and header field parsers are shared with
+ * HTTP/1.  Response buffers are copied to DATA frames as long as the flow
+ * control windows allow and the connection output queue is short enough.
+ * The original buffers are completed as soon as they are copied, so the
+ * response source is released at the pace of the client.
+ *
+ * nxt_h2p_conn_ prefix is used for connection handlers.
+ * nxt_h2p_frame_ prefix is used for received frame handlers.
+ * nxt_h2p_request_ prefix is used for HTTP/2 protocol request methods.
+ */
+
+
+#define NXT_H2P_PREFACE            "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+#define NXT_H2P_MAX_STREAMS        128
+/*
+ * A client that resets more streams than this and at least
+ * half of the streams it has created gets GOAWAY.
+ */
+#define NXT_H2P_MAX_RESETS         NXT_H2P_MAX_STREAMS
+#define NXT_H2P_READ_BUFFER_SIZE                                              \
+    (NXT_H2P_FRAME_HEADER_SIZE + NXT_H2P_DEFAULT_FRAME_SIZE)
+#define NXT_H2P_WRITE_LIMIT        (4 * NXT_H2P_DEFAULT_FRAME_SIZE)
+#define NXT_H2P_HEADER_BLOCK_SIZE  (64 * 1024)
+
+
+typedef nxt_h2p_error_t (*nxt_h2p_frame_handler_t)(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+
+
+static void nxt_h2p_conn_read(nxt_task_t *task, void *obj, void *data);
+static nxt_h2p_error_t nxt_h2p_frame_data(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_headers(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_priority(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_rst_stream(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_settings(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_push_promise(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_ping(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_goaway(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_window_update(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_frame_continuation(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *p, size_t size, nxt_uint_t flags,
+    uint32_t id);
+static nxt_h2p_error_t nxt_h2p_header_block(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *pos, u_char *end, nxt_uint_t flags,
+    uint32_t id);
+static nxt_int_t nxt_h2p_header_skip(nxt_h2p_conn_t *h2c, u_char *pos,
+    u_char *end);
+static nxt_h2p_error_t nxt_h2p_stream_create(nxt_task_t *task,
+    nxt_h2p_conn_t *h2c, u_char *pos, u_char *end, nxt_uint_t flags,
+    uint32_t id);
+static nxt_int_t nxt_h2p_header_process(nxt_task_t *task,
+    nxt_h2proto_t *h2p, u_char *pos, u_char *end);
+static nxt_int_t nxt_h2p_headers_convert(nxt_h2proto_t *h2p,
+    nxt_array_t *headers, nxt_buf_mem_t *bm);
+static nxt_int_t nxt_h2p_header_valid(nxt_h2p_header_t *h);
+static nxt_h2proto_t *nxt_h2p_stream_find(nxt_h2p_conn_t *h2c, uint32_t id);
+static nxt_int_t nxt_h2p_body_alloc(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_body_append(nxt_task_t *task, nxt_h2proto_t *h2p,
+    u_char *p, size_t size);
+static void nxt_h2p_body_end(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_body_ready(nxt_task_t *task, nxt_h2proto_t *h2p);
+static nxt_int_t nxt_h2p_content_length_add(nxt_http_request_t *r);
+static nxt_buf_t *nxt_h2p_frame_alloc(nxt_h2p_conn_t *h2c, size_t size);
+static u_char *nxt_h2p_frame_header(u_char *p, size_t size, nxt_uint_t type,
+    nxt_uint_t flags, uint32_t id);
+static void nxt_h2p_frame_send(nxt_task_t *task, nxt_h2p_conn_t *h2c,
+    nxt_buf_t *b);
+static void nxt_h2p_frame_completion(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_settings_send(nxt_task_t *task, nxt_h2p_conn_t *h2c);
+static void nxt_h2p_window_update(nxt_task_t *task, nxt_h2p_conn_t *h2c,
+    nxt_h2proto_t *h2p);
+static void nxt_h2p_rst_stream(nxt_task_t *task, nxt_h2p_conn_t *h2c,
+    uint32_t id, nxt_h2p_error_t error);
+static void nxt_h2p_goaway(nxt_task_t *task, nxt_h2p_conn_t *h2c,
+    nxt_h2p_error_t error);
+static void nxt_h2p_conn_send(nxt_task_t *task, nxt_h2p_conn_t *h2c);
+static nxt_int_t nxt_h2p_stream_send(nxt_task_t *task, nxt_h2p_conn_t *h2c,
+    nxt_h2proto_t *h2p);
+static void nxt_h2p_buf_complete(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_request_error(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_stream_reset(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_conn_sent(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_conn_close(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_conn_error(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_conn_write_error(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_h2p_conn_idle_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_h2p_conn_send_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_msec_t nxt_h2p_conn_timer_value(nxt_conn_t *c, uintptr_t data);
+static void nxt_h2p_shutdown(nxt_task_t *task, nxt_h2p_conn_t *h2c);
+static void nxt_h2p_close_test(nxt_task_t *task, nxt_h2p_conn_t *h2c);
+
+
+static const nxt_conn_state_t  nxt_h2p_read_state;
+static const nxt_conn_state_t  nxt_h2p_write_state;
+
+
+static const nxt_h2p_frame_handler_t  nxt_h2p_frame_handlers[] = {
+    nxt_h2p_frame_data,
+    nxt_h2p_frame_headers,
+    nxt_h2p_frame_priority,
+    nxt_h2p_frame_rst_stream,
+    nxt_h2p_frame_settings,
+    nxt_h2p_frame_push_promise,
+    nxt_h2p_frame_ping,
+    nxt_h2p_frame_goaway,
+    nxt_h2p_frame_window_update,
+    nxt_h2p_frame_continuation,
+};
+
+
+static nxt_lvlhsh_t                    nxt_h2p_fields_hash;
+
+static nxt_http_field_proc_t           nxt_h2p_fields[] = {
+    { nxt_string("Host"),              &nxt_http_request_host, 0 },
+    { nxt_string("Cookie"),            &nxt_http_request_field,
+        offsetof(nxt_http_request_t, cookie) },
+    { nxt_string("Referer"),           &nxt_http_request_field,
+        offsetof(nxt_http_request_t, referer) },
+    { nxt_string("User-Agent"),        &nxt_http_request_field,
+        offsetof(nxt_http_request_t, user_agent) },
+    { nxt_string("Content-Type"),      &nxt_http_request_field,
+        offsetof(nxt_http_request_t, content_type) },
+    { nxt_string("Content-Length"),    &nxt_http_request_content_length, 0 },
+    { nxt_string("Authorization"),     &nxt_http_request_field,
+        offsetof(nxt_http_request_t, authorization) },
+    { nxt_string("If-Match"),          &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_match) },
+    { nxt_string("If-None-Match"),     &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_none_match) },
+    { nxt_string("If-Modified-Since"), &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_modified_since) },
+    { nxt_string("If-Unmodified-Since"),
+                                       &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_unmodified_since) },
+    { nxt_string("If-Range"),          &nxt_http_request_field,
+        offsetof(nxt_http_request_t, if_range) },
+    { nxt_string("Range"),             &nxt_http_request_field,
+        offsetof(nxt_http_request_t, range) },
+    { nxt_string("Accept-Encoding"),   &nxt_http_request_field,
+        offsetof(nxt_http_request_t, accept_encoding) },
+};
+
+
+static const nxt_str_t  nxt_h2p_version = nxt_string("HTTP/2.0");
+
+
+#define nxt_h2p_get_uint32(p)                                                 \
+    (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16)                    \
+     | ((uint32_t) (p)[2] << 8) | (uint32_t) (p)[3])
+
+
+nxt_inline u_char *
+nxt_h2p_put_uint32(u_char *p, uint32_t value)
+{
+    *p++ = (u_char) (value >> 24);
+    *p++ = (u_char) (value >> 16);
+    *p++ = (u_char) (value >> 8);
+    *p++ = (u_char) value;
+
+    return p;
+}
+
+
+nxt_int_t
+nxt_h2p_init(nxt_task_t *task)
+{
+    nxt_int_t  ret;
+
+    ret = nxt_http_fields_hash(&nxt_h2p_fields_hash,
+                               nxt_h2p_fields, nxt_nitems(nxt_h2p_fields));
+
+    if (nxt_fast_path(ret == NXT_OK)) {
+        ret = nxt_h2p_hpack_init();
+    }
+
+    return ret;
+}
+
+
+/*
+ * The first 4 bytes "PRI " are enough to distinguish the preface
+ * from an HTTP/1 request, the rest is tested as far as it has been read.
+ */
+
+nxt_bool_t
+nxt_h2p_preface_test(nxt_buf_mem_t *bm)
+{
+    size_t  size;
+
+    size = nxt_min((size_t) nxt_buf_mem_used_size(bm), nxt_length(NXT_H2P_PREFACE));
+
+    return (size >= 4 && nxt_memcmp(bm->pos, NXT_H2P_PREFACE, size) == 0);
+}
+
+
+void
+nxt_h2p_conn_init(nxt_task_t *task, nxt_conn_t *c)
+{
+    size_t          size;
+    nxt_buf_t       *in, *b;
+    nxt_h2p_conn_t  *h2c;
+
+    nxt_debug(task, "h2p conn init");
+
+    in = c->read;
+
+    h2c = nxt_mp_zget(c->mem_pool, sizeof(nxt_h2p_conn_t));
+    if (nxt_slow_path(h2c == NULL)) {
+        goto fail;
+    }
+
+    b = nxt_buf_mem_alloc(c->mem_pool, NXT_H2P_READ_BUFFER_SIZE, 0);
+    if (nxt_slow_path(b == NULL)) {
+        goto fail;
+    }
+
+    size = nxt_buf_mem_used_size(&in->mem);
+    b->mem.free = nxt_cpymem(b->mem.free, in->mem.pos, size);
+
+    nxt_event_engine_buf_mem_free(task->thread->engine, in);
+
+    c->read = b;
+    c->socket.data = h2c;
+    c->read_state = &nxt_h2p_read_state;
+    c->write_state = &nxt_h2p_write_state;
+
+    h2c->conn = c;
+    nxt_queue_init(&h2c->streams);
+
+    h2c->hpack.mem_pool = c->mem_pool;
+    h2c->hpack.max_size = NXT_H2P_HPACK_TABLE_SIZE;
+
+    h2c->send_window = NXT_H2P_DEFAULT_WINDOW;
+    h2c->init_window = NXT_H2P_DEFAULT_WINDOW;
+    h2c->frame_size = NXT_H2P_DEFAULT_FRAME_SIZE;
+    h2c->recv_window = NXT_H2P_DEFAULT_WINDOW;
+
+    nxt_queue_remove(&c->link);
+
+    if (!c->tcp_nodelay) {
+        nxt_conn_tcp_nodelay_on(task, c);
+    }
+
+    nxt_h2p_settings_send(task, h2c);
+
+    nxt_h2p_conn_read(task, c, h2c);
+
+    return;
+
+fail:
+
+    nxt_event_engine_buf_mem_free(task->thread->engine, in);
+    c->read = NULL;
+
+    nxt_h1p_closing(task, c);
+}
+
+
+static const nxt_conn_state_t  nxt_h2p_read_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h2p_conn_read,
+    .close_handler = nxt_h2p_conn_close,
+    .error_handler = nxt_h2p_conn_error,
+
+    .timer_handler = nxt_h2p_conn_idle_timeout,
+    .timer_value = nxt_h2p_conn_timer_value,
+    .timer_data = offsetof(nxt_socket_conf_t, idle_timeout),
+    .timer_autoreset = 1,
+};
+
+
+static void
+nxt_h2p_conn_read(nxt_task_t *task, void *obj, void *data)
+{
+    u_char           *p, *end;
+    size_t           size;
+    uint32_t         id;
+    nxt_buf_t        *b;
+    nxt_uint_t       type, flags;
+    nxt_conn_t       *c;
+    nxt_h2p_conn_t   *h2c;
+    nxt_h2p_error_t  error;
+
+    c = obj;
+    h2c = data;
+
+    nxt_debug(task, "h2p conn read");
+
+    b = c->read;
+    p = b->mem.pos;
+    end = b->mem.free;
+
+    if (!h2c->preface) {
+        size = nxt_min((size_t) (end - p), nxt_length(NXT_H2P_PREFACE));
+
+        if (nxt_memcmp(p, NXT_H2P_PREFACE, size) != 0) {
+            nxt_log(task, NXT_LOG_INFO, "h2p invalid connection preface");
+
+            error = NXT_H2P_PROTOCOL_ERROR;
+            goto fail;
+        }
+
+        if (size < nxt_length(NXT_H2P_PREFACE)) {
+            goto read;
+        }
+
+        p += size;
+        h2c->preface = 1;
+    }
+
+    while (end - p >= NXT_H2P_FRAME_HEADER_SIZE) {
+        size = (p[0] << 16) | (p[1] << 8) | p[2];
+        type = p[3];
+        flags = p[4];
+        id = nxt_h2p_get_uint32(&p[5]) & 0x7fffffff;
+
+        if (nxt_slow_path(size > NXT_H2P_DEFAULT_FRAME_SIZE)) {
+            error = NXT_H2P_FRAME_SIZE_ERROR;
+            goto fail;
+        }
+
+        if ((size_t) (end - p) < NXT_H2P_FRAME_HEADER_SIZE + size) {
+            break;
+        }
+
+        p += NXT_H2P_FRAME_HEADER_SIZE;
+
+        nxt_debug(task, "h2p frame type:%ui flags:%02Xi stream:%uD size:%uz",
+                  type, flags, id, size);
+
+        h2c->conn->nbytes = 0;
+
+        if (h2c->header_stream != 0
+            && (type != NXT_H2P_CONTINUATION || id != h2c->header_stream))
+        {
+            error = NXT_H2P_PROTOCOL_ERROR;
+            goto fail;
+        }
+
+        if (type < nxt_nitems(nxt_h2p_frame_handlers)) {
+            error = nxt_h2p_frame_handlers[type](task, h2c, p, size, flags,
+                                                 id);
+            if (nxt_slow_path(error != NXT_H2P_NO_ERROR)) {
+                goto fail;
+            }
+        }
+
+        p += size;
+
+        if (h2c->closing) {
+            return;
+        }
+    }
+
+    if (h2c->goaway && h2c->nstreams == 0) {
+        nxt_h2p_shutdown(task, h2c);
+        return;
+    }
+
+read:
+
+    size = end - p;
+
+    nxt_memmove(b->mem.start, p, size);
+
+    b->mem.pos = b->mem.start;
+    b->mem.free = b->mem.start + size;
+
+    nxt_conn_read(task->thread->engine, c);
+
+    return;
+
+fail:
+
+    nxt_debug(task, "h2p connection error %d", error);
+
+    nxt_h2p_goaway(task, h2c, error);
+    nxt_h2p_shutdown(task, h2c);
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_data(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    u_char         *end;
+    size_t         pad;
+    nxt_h2proto_t  *h2p;
+
+    if (nxt_slow_path(id == 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    /* The entire payload including padding is subject to flow control. */
+
+    if (nxt_slow_path(size > (size_t) h2c->recv_window)) {
+        return NXT_H2P_FLOW_CONTROL_ERROR;
+    }
+
+    end = p + size;
+
+    if (flags & NXT_H2P_FLAG_PADDED) {
+        if (nxt_slow_path(size == 0)) {
+            return NXT_H2P_FRAME_SIZE_ERROR;
+        }
+
+        pad = *p++;
+
+        if (nxt_slow_path(pad > (size_t) (end - p))) {
+            return NXT_H2P_PROTOCOL_ERROR;
+        }
+
+        end -= pad;
+    }
+
+    h2p = nxt_h2p_stream_find(h2c, id);
+
+    if (h2p == NULL && nxt_slow_path(id > h2c->last_stream)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    /*
+     * The body is buffered entirely, so the windows
+     * are restored as soon as the data is received.
+     */
+
+    h2c->recv_window -= size;
+    nxt_h2p_window_update(task, h2c, NULL);
+
+    if (h2p == NULL) {
+        /* The stream has been closed. */
+        return NXT_H2P_NO_ERROR;
+    }
+
+    if (h2p->end_received) {
+        nxt_h2p_rst_stream(task, h2c, id, NXT_H2P_STREAM_CLOSED);
+        nxt_h2p_stream_reset(task, h2p);
+
+        return NXT_H2P_NO_ERROR;
+    }
+
+    if (nxt_slow_path(size > (size_t) h2p->recv_window)) {
+        nxt_h2p_rst_stream(task, h2c, id, NXT_H2P_FLOW_CONTROL_ERROR);
+        nxt_h2p_stream_reset(task, h2p);
+
+        return NXT_H2P_NO_ERROR;
+    }
+
+    h2p->recv_window -= size;
+    h2p->received += size;
+
+    if (flags & NXT_H2P_FLAG_END_STREAM) {
+        h2p->end_received = 1;
+
+    } else if (!h2p->body_done) {
+        nxt_h2p_window_update(task, h2c, h2p);
+    }
+
+    if (h2p->body_done) {
+        /* The body is discarded after an error. */
+        return NXT_H2P_NO_ERROR;
+    }
+
+    nxt_h2p_body_append(task, h2p, p, end - p);
+
+    /* The stream could be closed by the body append. */
+    h2p = nxt_h2p_stream_find(h2c, id);
+
+    if (h2p != NULL && (flags & NXT_H2P_FLAG_END_STREAM)) {
+        nxt_h2p_body_end(task, h2p);
+    }
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_headers(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    u_char  *end;
+    size_t  pad;
+
+    if (nxt_slow_path(id == 0 || (id & 1) == 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    end = p + size;
+
+    if (flags & NXT_H2P_FLAG_PADDED) {
+        if (nxt_slow_path(size == 0)) {
+            return NXT_H2P_FRAME_SIZE_ERROR;
+        }
+
+        pad = *p++;
+
+        if (nxt_slow_path(pad > (size_t) (end - p))) {
+            return NXT_H2P_PROTOCOL_ERROR;
+        }
+
+        end -= pad;
+    }
+
+    if (flags & NXT_H2P_FLAG_PRIORITY) {
+        if (nxt_slow_path(end - p < 5)) {
+            return NXT_H2P_FRAME_SIZE_ERROR;
+        }
+
+        p += 5;
+    }
+
+    if (flags & NXT_H2P_FLAG_END_HEADERS) {
+        return nxt_h2p_header_block(task, h2c, p, end, flags, id);
+    }
+
+    if (h2c->header_block == NULL) {
+        h2c->header_block = nxt_mp_nget(h2c->conn->mem_pool,
+                                        NXT_H2P_HEADER_BLOCK_SIZE);
+        if (nxt_slow_path(h2c->header_block == NULL)) {
+            return NXT_H2P_INTERNAL_ERROR;
+        }
+    }
+
+    size = end - p;
+
+    nxt_memcpy(h2c->header_block, p, size);
+
+    h2c->header_size = size;
+    h2c->header_stream = id;
+    h2c->header_flags = flags;
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_continuation(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    u_char  *block;
+
+    if (nxt_slow_path(h2c->header_stream == 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(size > NXT_H2P_HEADER_BLOCK_SIZE - h2c->header_size)) {
+        nxt_log(task, NXT_LOG_INFO, "h2p too large header block");
+
+        return NXT_H2P_ENHANCE_YOUR_CALM;
+    }
+
+    block = h2c->header_block;
+
+    nxt_memcpy(block + h2c->header_size, p, size);
+    h2c->header_size += size;
+
+    if ((flags & NXT_H2P_FLAG_END_HEADERS) == 0) {
+        return NXT_H2P_NO_ERROR;
+    }
+
+    id = h2c->header_stream;
+    h2c->header_stream = 0;
+
+    return nxt_h2p_header_block(task, h2c, block, block + h2c->header_size,
+                                h2c->header_flags, id);
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_header_block(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *pos,
+    u_char *end, nxt_uint_t flags, uint32_t id)
+{
+    nxt_h2proto_t  *h2p;
+
+    h2p = nxt_h2p_stream_find(h2c, id);
+
+    if (h2p != NULL) {
+        /* Trailer fields are decoded to keep the HPACK state and ignored. */
+
+        if (nxt_slow_path((flags & NXT_H2P_FLAG_END_STREAM) == 0)) {
+            return NXT_H2P_PROTOCOL_ERROR;
+        }
+
+        if (nxt_slow_path(nxt_h2p_header_skip(h2c, pos, end) != NXT_OK)) {
+            return NXT_H2P_COMPRESSION_ERROR;
+        }
+
+        if (h2p->end_received) {
+            nxt_h2p_rst_stream(task, h2c, id, NXT_H2P_STREAM_CLOSED);
+            nxt_h2p_stream_reset(task, h2p);
+
+            return NXT_H2P_NO_ERROR;
+        }
+
+        h2p->end_received = 1;
+
+        if (!h2p->body_done) {
+            nxt_h2p_body_end(task, h2p);
+        }
+
+        return NXT_H2P_NO_ERROR;
+    }
+
+    if (id <= h2c->last_stream || h2c->goaway) {
+        if (nxt_slow_path(nxt_h2p_header_skip(h2c, pos, end) != NXT_OK)) {
+            return NXT_H2P_COMPRESSION_ERROR;
+        }
+
+        return NXT_H2P_NO_ERROR;
+    }
+
+    h2c->last_stream = id;
+
+    if (h2c->nstreams >= NXT_H2P_MAX_STREAMS
+        || h2c->conn->listen->socket.data == NULL)
+    {
+        if (nxt_slow_path(nxt_h2p_header_skip(h2c, pos, end) != NXT_OK)) {
+            return NXT_H2P_COMPRESSION_ERROR;
+        }
+
+        nxt_h2p_rst_stream(task, h2c, id, NXT_H2P_REFUSED_STREAM);
+
+        return NXT_H2P_NO_ERROR;
+    }
+
+    return nxt_h2p_stream_create(task, h2c, pos, end, flags, id);
+}
+
+
+static nxt_int_t
+nxt_h2p_header_skip(nxt_h2p_conn_t *h2c, u_char *pos, u_char *end)
+{
+    nxt_mp_t     *mp;
+    nxt_int_t    ret;
+    nxt_array_t  *headers;
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return NXT_ERROR;
+    }
+
+    ret = NXT_ERROR;
+
+    headers = nxt_array_create(mp, 8, sizeof(nxt_h2p_header_t));
+
+    if (nxt_fast_path(headers != NULL)) {
+        ret = nxt_h2p_hpack_decode(&h2c->hpack, mp, pos, end, headers);
+    }
+
+    nxt_mp_destroy(mp);
+
+    return ret;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_stream_create(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *pos,
+    u_char *end, nxt_uint_t flags, uint32_t id)
+{
+    nxt_int_t                ret;
+    nxt_conn_t               *c;
+    nxt_h2proto_t            *h2p;
+    nxt_http_request_t       *r;
+    nxt_socket_conf_joint_t  *joint;
+
+    c = h2c->conn;
+
+    r = nxt_http_request_create(task);
+    if (nxt_slow_path(r == NULL)) {
+        goto refuse;
+    }
+
+    h2p = nxt_mp_zget(r->mem_pool, sizeof(nxt_h2proto_t));
+    if (nxt_slow_path(h2p == NULL)) {
+        nxt_mp_release(r->mem_pool);
+        goto refuse;
+    }
+
+    ret = nxt_http_parse_request_init(&h2p->parser, r->mem_pool);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_mp_release(r->mem_pool);
+        goto refuse;
+    }
+
+    h2p->h2c = h2c;
+    h2p->request = r;
+    h2p->id = id;
+    h2p->send_window = h2c->init_window;
+    h2p->recv_window = NXT_H2P_DEFAULT_WINDOW;
+    h2p->received = end - pos;
+
+    h2c->requests++;
+
+    r->proto.h2 = h2p;
+    r->protocol = NXT_HTTP_PROTO_H2;
+    r->remote = c->remote;
+
+#if (NXT_TLS)
+    r->tls = c->u.tls;
+#endif
+
+    r->task = c->task;
+    task = &r->task;
+
+    r->method = &h2p->parser.method;
+    r->version = nxt_h2p_version;
+
+    joint = c->listen->socket.data;
+    joint->count++;
+
+    r->conf = joint;
+
+    if (c->local == NULL) {
+        c->local = joint->socket_conf->sockaddr;
+    }
+
+    h2p->parser.discard_unsafe_fields =
+                                   joint->socket_conf->discard_unsafe_fields;
+
+    nxt_queue_insert_tail(&h2c->streams, &h2p->link);
+    h2c->nstreams++;
+
+    ret = nxt_h2p_header_process(task, h2p, pos, end);
+
+    if (nxt_slow_path(ret == NXT_ERROR)) {
+        /* The HPACK state is lost, the connection is to be closed. */
+        h2p->reset = 1;
+
+        nxt_http_request_close_handler(task, r, h2p);
+
+        return NXT_H2P_COMPRESSION_ERROR;
+    }
+
+    if (flags & NXT_H2P_FLAG_END_STREAM) {
+        h2p->end_received = 1;
+        h2p->body_done = 1;
+    }
+
+#if (NXT_TLS)
+    if (ret == NXT_OK && c->u.tls == NULL
+        && joint->socket_conf->tls != NULL)
+    {
+        ret = NXT_HTTP_TO_HTTPS;
+    }
+#endif
+
+    if (ret != NXT_OK) {
+        nxt_http_request_error(task, r, ret);
+        return NXT_H2P_NO_ERROR;
+    }
+
+    r->state->ready_handler(task, r, NULL);
+
+    return NXT_H2P_NO_ERROR;
+
+refuse:
+
+    if (nxt_slow_path(nxt_h2p_header_skip(h2c, pos, end) != NXT_OK)) {
+        return NXT_H2P_COMPRESSION_ERROR;
+    }
+
+    nxt_h2p_rst_stream(task, h2c, id, NXT_H2P_REFUSED_STREAM);
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_int_t
+nxt_h2p_header_process(nxt_task_t *task, nxt_h2proto_t *h2p, u_char *pos,
+    u_char *end)
+{
+    nxt_int_t           ret;
+    nxt_array_t         *headers;
+    nxt_buf_mem_t       bm;
+    nxt_http_request_t  *r;
+
+    r = h2p->request;
+
+    headers = nxt_array_create(r->mem_pool, 16, sizeof(nxt_h2p_header_t));
+    if (nxt_slow_path(headers == NULL)) {
+        return NXT_ERROR;
+    }
+
+    ret = nxt_h2p_hpack_decode(&h2p->h2c->hpack, r->mem_pool, pos, end,
+                               headers);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_log(task, NXT_LOG_INFO, "h2p invalid header block");
+        return NXT_ERROR;
+    }
+
+    ret = nxt_h2p_headers_convert(h2p, headers, &bm);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return ret;
+    }
+
+    ret = nxt_http_parse_request(&h2p->parser, &bm);
+
+    r->target.start = h2p->parser.target_start;
+    r->target.length = h2p->parser.target_end - h2p->parser.target_start;
+
+    r->path = &h2p->parser.path;
+    r->args = &h2p->parser.args;
+
+    r->fields = h2p->parser.fields;
+
+    switch (ret) {
+
+    case NXT_DONE:
+        break;
+
+    case NXT_HTTP_PARSE_TOO_LARGE_FIELD:
+        return NXT_HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE;
+
+    case NXT_HTTP_PARSE_INVALID:
+    case NXT_HTTP_PARSE_UNSUPPORTED_VERSION:
+    case NXT_AGAIN:
+        return NXT_HTTP_BAD_REQUEST;
+
+    default:
+    case NXT_ERROR:
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    return nxt_http_fields_process(r->fields, &nxt_h2p_fields_hash, r);
+}
+
+
+/*
+ * The decoded header list is converted to the HTTP/1.1 request header:
+ * the pseudo-header fields form the request line and the "Host" field,
+ * the "cookie" fields are joined as RFC 7540, 8.1.2.5 requires.
+ */
+
+static nxt_int_t
+nxt_h2p_headers_convert(nxt_h2proto_t *h2p, nxt_array_t *headers,
+    nxt_buf_mem_t *bm)
+{
+    u_char            *p;
+    size_t            size, cookie_size;
+    nxt_str_t         *method, *path, *authority, *scheme, **pseudo;
+    nxt_bool_t        host, regular;
+    nxt_uint_t        i, n;
+    nxt_h2p_header_t  *h;
+
+    method = NULL;
+    path = NULL;
+    authority = NULL;
+    scheme = NULL;
+
+    host = 0;
+    regular = 0;
+    size = 0;
+    cookie_size = 0;
+
+    h = headers->elts;
+    n = headers->nelts;
+
+    for (i = 0; i < n; i++) {
+
+        if (nxt_slow_path(nxt_h2p_header_valid(&h[i]) != NXT_OK)) {
+            return NXT_HTTP_BAD_REQUEST;
+        }
+
+        if (h[i].name.start[0] == ':') {
+            if (nxt_slow_path(regular)) {
+                return NXT_HTTP_BAD_REQUEST;
+            }
+
+            if (nxt_str_eq(&h[i].name, ":method", 7)) {
+                pseudo = &method;
+
+            } else if (nxt_str_eq(&h[i].name, ":path", 5)) {
+                pseudo = &path;
+
+            } else if (nxt_str_eq(&h[i].name, ":authority", 10)) {
+                pseudo = &authority;
+
+            } else if (nxt_str_eq(&h[i].name, ":scheme", 7)) {
+                pseudo = &scheme;
+
+            } else {
+                return NXT_HTTP_BAD_REQUEST;
+            }
+
+            if (nxt_slow_path(*pseudo != NULL)) {
+                return NXT_HTTP_BAD_REQUEST;
+            }
+
+            *pseudo = &h[i].value;
+
+            continue;
+        }
+
+        regular = 1;
+
+        if (nxt_str_eq(&h[i].name, "cookie", 6)) {
+            cookie_size += h[i].value.length + nxt_length("; ");
+            continue;
+        }
+
+        if (nxt_str_eq(&h[i].name, "host", 4)) {
+            host = 1;
+        }
+
+        size += h[i].name.length + nxt_length(": ")
+                + h[i].value.length + nxt_length("\r\n");
+    }
+
+    if (nxt_slow_path(method == NULL || path == NULL || scheme == NULL
+                      || method->length == 0 || path->length == 0))
+    {
+        return NXT_HTTP_BAD_REQUEST;
+    }
+
+    for (i = 0; i < path->length; i++) {
+        if (nxt_slow_path(path->start[i] <= ' ')) {
+            return NXT_HTTP_BAD_REQUEST;
+        }
+    }
+
+    for (i = 0; i < method->length; i++) {
+        if (nxt_slow_path(method->start[i] <= ' ')) {
+            return NXT_HTTP_BAD_REQUEST;
+        }
+    }
+
+    size += method->length + nxt_length(" ")
+            + path->length + nxt_length(" HTTP/1.1\r\n")
+            + nxt_length("\r\n");
+
+    if (authority != NULL && !host) {
+        size += nxt_length("Host: ") + authority->length + nxt_length("\r\n");
+    }
+
+    if (cookie_size != 0) {
+        size += nxt_length("Cookie: ") + cookie_size;
+    }
+
+    p = nxt_mp_nget(h2p->request->mem_pool, size);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    bm->start = p;
+    bm->pos = p;
+
+    p = nxt_cpymem(p, method->start, method->length);
+    *p++ = ' ';
+    p = nxt_cpymem(p, path->start, path->length);
+    p = nxt_cpymem(p, " HTTP/1.1\r\n", nxt_length(" HTTP/1.1\r\n"));
+
+    if (authority != NULL && !host) {
+        p = nxt_cpymem(p, "Host: ", nxt_length("Host: "));
+        p = nxt_cpymem(p, authority->start, authority->length);
+        *p++ = '\r'; *p++ = '\n';
+    }
+
+    if (cookie_size != 0) {
+        p = nxt_cpymem(p, "Cookie: ", nxt_length("Cookie: "));
+
+        for (i = 0; i < n; i++) {
+            if (h[i].name.start[0] != ':'
+                && nxt_str_eq(&h[i].name, "cookie", 6))
+            {
+                p = nxt_cpymem(p, h[i].value.start, h[i].value.length);
+                *p++ = ';'; *p++ = ' ';
+            }
+        }
+
+        p[-2] = '\r'; p[-1] = '\n';
+    }
+
+    for (i = 0; i < n; i++) {
+        if (h[i].name.start[0] == ':'
+            || nxt_str_eq(&h[i].name, "cookie", 6))
+        {
+            continue;
+        }
+
+        p = nxt_cpymem(p, h[i].name.start, h[i].name.length);
+        *p++ = ':'; *p++ = ' ';
+        p = nxt_cpymem(p, h[i].value.start, h[i].value.length);
+        *p++ = '\r'; *p++ = '\n';
+    }
+
+    *p++ = '\r'; *p++ = '\n';
+
+    bm->free = p;
+    bm->end = p;
+
+    return NXT_OK;
+}
+
+
+/*
+ * A field name must be in lowercase, and the connection-specific
+ * fields are not allowed, RFC 7540, 8.1.2.
+ */
+
+static nxt_int_t
+nxt_h2p_header_valid(nxt_h2p_header_t *h)
+{
+    u_char      c;
+    nxt_uint_t  i;
+
+    if (nxt_slow_path(h->name.length == 0)) {
+        return NXT_ERROR;
+    }
+
+    for (i = 0; i < h->name.length; i++) {
+        c = h->name.start[i];
+
+        if (nxt_slow_path(c <= ' ' || c >= 0x7f || (c >= 'A' && c <= 'Z')
+                          || (c == ':' && i != 0)))
+        {
+            return NXT_ERROR;
+        }
+    }
+
+    for (i = 0; i < h->value.length; i++) {
+        c = h->value.start[i];
+
+        if (nxt_slow_path(c == '\r' || c == '\n' || c == '\0')) {
+            return NXT_ERROR;
+        }
+    }
+
+    if (nxt_str_eq(&h->name, "connection", 10)
+        || nxt_str_eq(&h->name, "keep-alive", 10)
+        || nxt_str_eq(&h->name, "proxy-connection", 16)
+        || nxt_str_eq(&h->name, "transfer-encoding", 17)
+        || nxt_str_eq(&h->name, "upgrade", 7))
+    {
+        return NXT_ERROR;
+    }
+
+    if (nxt_str_eq(&h->name, "te", 2)
+        && !nxt_str_eq(&h->value, "trailers", 8))
+    {
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_h2proto_t *
+nxt_h2p_stream_find(nxt_h2p_conn_t *h2c, uint32_t id)
+{
+    nxt_queue_link_t  *lnk;
+    nxt_h2proto_t     *h2p;
+
+    for (lnk = nxt_queue_first(&h2c->streams);
+         lnk != nxt_queue_tail(&h2c->streams);
+         lnk = nxt_queue_next(lnk))
+    {
+        h2p = nxt_queue_link_data(lnk, nxt_h2proto_t, link);
+
+        if (h2p->id == id) {
+            return h2p;
+        }
+    }
+
+    return NULL;
+}
+
+
+void
+nxt_h2p_request_body_read(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_h2proto_t  *h2p;
+
+    h2p = r->proto.h2;
+
+    nxt_debug(task, "h2p request body read %O", r->content_length_n);
+
+    if (h2p->body_done) {
+        nxt_h2p_body_ready(task, h2p);
+        return;
+    }
+
+    if (nxt_slow_path(nxt_h2p_body_alloc(task, h2p) != NXT_OK)) {
+        h2p->body_done = 1;
+
+        nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+        return;
+    }
+
+    h2p->body_wait = 1;
+}
+
+
+/*
+ * The body without "Content-Length" is limited to "body_buffer_size",
+ * similar to a chunked HTTP/1 body that is not supported at all.
+ */
+
+static nxt_int_t
+nxt_h2p_body_alloc(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    size_t              body_length, body_buffer_size;
+    nxt_str_t           *tmp_path, tmp_name;
+    nxt_buf_t           *b;
+    nxt_http_request_t  *r;
+
+    static const nxt_str_t tmp_name_pattern = nxt_string("/req-XXXXXXXX");
+
+    r = h2p->request;
+
+    body_buffer_size = r->conf->socket_conf->body_buffer_size;
+
+    if (r->content_length_n == -1) {
+        body_length = body_buffer_size;
+
+    } else {
+        body_length = (size_t) r->content_length_n;
+        body_buffer_size = nxt_min(body_buffer_size, body_length);
+    }
+
+    if (body_length == 0) {
+        return NXT_OK;
+    }
+
+    if (body_length > body_buffer_size) {
+        tmp_path = &r->conf->socket_conf->body_temp_path;
+
+        tmp_name.length = tmp_path->length + tmp_name_pattern.length;
+
+        b = nxt_buf_file_alloc(r->mem_pool,
+                               sizeof(nxt_file_t) + tmp_name.length + 1, 0);
+
+    } else {
+        /* This initialization required for CentOS 6, gcc 4.4.7. */
+        tmp_path = NULL;
+        tmp_name.length = 0;
+
+        b = nxt_buf_mem_alloc(r->mem_pool, body_buffer_size, 0);
+    }
+
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_ERROR;
+    }
+
+    r->body = b;
+
+    if (body_length > body_buffer_size) {
+        tmp_name.start = nxt_pointer_to(b->mem.start, sizeof(nxt_file_t));
+
+        memcpy(tmp_name.start, tmp_path->start, tmp_path->length);
+        memcpy(tmp_name.start + tmp_path->length, tmp_name_pattern.start,
+               tmp_name_pattern.length);
+        tmp_name.start[tmp_name.length] = '\0';
+
+        b->file = (nxt_file_t *) b->mem.start;
+        nxt_memzero(b->file, sizeof(nxt_file_t));
+        b->file->size = body_length;
+
+        b->mem.start = NULL;
+        b->mem.end = NULL;
+        b->mem.pos = NULL;
+        b->mem.free = NULL;
+
+        b->file->fd = mkstemp((char *) tmp_name.start);
+        if (nxt_slow_path(b->file->fd == -1)) {
+            nxt_alert(task, "mkstemp(%s) failed %E", tmp_name.start, nxt_errno);
+
+            return NXT_ERROR;
+        }
+
+        nxt_debug(task, "create body tmp file \"%V\", %d",
+                  &tmp_name, b->file->fd);
+
+        unlink((char *) tmp_name.start);
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_h2p_body_append(nxt_task_t *task, nxt_h2proto_t *h2p, u_char *p,
+    size_t size)
+{
+    ssize_t             n;
+    nxt_buf_t           *b;
+    nxt_http_status_t   status;
+    nxt_http_request_t  *r;
+
+    if (!h2p->body_wait || size == 0) {
+        return;
+    }
+
+    r = h2p->request;
+    b = r->body;
+
+    if (nxt_slow_path(r->content_length_n != -1
+                      && h2p->body_size + size
+                         > (size_t) r->content_length_n))
+    {
+        status = NXT_HTTP_BAD_REQUEST;
+        goto fail;
+    }
+
+    if (b != NULL && nxt_buf_is_file(b)) {
+        n = nxt_fd_write(b->file->fd, p, size);
+        if (nxt_slow_path(n < (ssize_t) size)) {
+            status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+            goto fail;
+        }
+
+        b->file_end += size;
+
+    } else {
+        if (nxt_slow_path(b == NULL
+                          || (size_t) nxt_buf_mem_free_size(&b->mem) < size))
+        {
+            status = NXT_HTTP_LENGTH_REQUIRED;
+            goto fail;
+        }
+
+        b->mem.free = nxt_cpymem(b->mem.free, p, size);
+    }
+
+    h2p->body_size += size;
+
+    return;
+
+fail:
+
+    h2p->body_done = 1;
+    h2p->body_wait = 0;
+
+    nxt_http_request_error(task, r, status);
+}
+
+
+static void
+nxt_h2p_body_end(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    nxt_http_request_t  *r;
+
+    h2p->body_done = 1;
+
+    if (!h2p->body_wait) {
+        return;
+    }
+
+    h2p->body_wait = 0;
+
+    r = h2p->request;
+
+    if (nxt_slow_path(r->content_length_n != -1
+                      && h2p->body_size != r->content_length_n))
+    {
+        nxt_http_request_error(task, r, NXT_HTTP_BAD_REQUEST);
+        return;
+    }
+
+    nxt_h2p_body_ready(task, h2p);
+}
+
+
+static void
+nxt_h2p_body_ready(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    nxt_http_request_t  *r;
+
+    r = h2p->request;
+
+    if (nxt_slow_path(r->content_length_n > 0 && h2p->body_size == 0)) {
+        nxt_http_request_error(task, r, NXT_HTTP_BAD_REQUEST);
+        return;
+    }
+
+    if (r->content_length_n == -1 && h2p->body_size != 0) {
+        if (nxt_slow_path(nxt_h2p_content_length_add(r) != NXT_OK)) {
+            nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+            return;
+        }
+    }
+
+    r->state->ready_handler(task, r, NULL);
+}
+
+
+/*
+ * The body size of a request without "Content-Length" is known
+ * as soon as the stream ends, so the field is added for applications.
+ */
+
+static nxt_int_t
+nxt_h2p_content_length_add(nxt_http_request_t *r)
+{
+    u_char            *p;
+    uint32_t          hash;
+    nxt_uint_t        i;
+    nxt_http_field_t  *field;
+
+    static const u_char  name[] = "Content-Length";
+
+    field = nxt_list_zero_add(r->fields);
+    if (nxt_slow_path(field == NULL)) {
+        return NXT_ERROR;
+    }
+
+    p = nxt_mp_nget(r->mem_pool, NXT_OFF_T_LEN);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    hash = NXT_HTTP_FIELD_HASH_INIT;
+
+    for (i = 0; i < nxt_length(name); i++) {
+        hash = nxt_http_field_hash_char(hash, nxt_lowcase(name[i]));
+    }
+
+    field->hash = nxt_http_field_hash_end(hash) & 0xFFFF;
+
+    nxt_http_field_name_set(field, "Content-Length");
+
+    r->content_length_n = r->proto.h2->body_size;
+
+    field->value = p;
+    field->value_length = nxt_sprintf(p, p + NXT_OFF_T_LEN, "%O",
+                                      r->content_length_n)
+                          - p;
+
+    r->content_length = field;
+
+    return NXT_OK;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_priority(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    if (nxt_slow_path(id == 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(size != 5)) {
+        return NXT_H2P_FRAME_SIZE_ERROR;
+    }
+
+    /* Stream priorities are ignored. */
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_rst_stream(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    nxt_h2proto_t  *h2p;
+
+    if (nxt_slow_path(id == 0 || id > h2c->last_stream)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(size != 4)) {
+        return NXT_H2P_FRAME_SIZE_ERROR;
+    }
+
+    nxt_debug(task, "h2p stream %uD reset: %uD", id, nxt_h2p_get_uint32(p));
+
+    h2p = nxt_h2p_stream_find(h2c, id);
+
+    if (h2p != NULL) {
+        nxt_h2p_stream_reset(task, h2p);
+    }
+
+    /* Rapidly created and reset streams would keep the router busy. */
+
+    h2c->resets++;
+
+    if (nxt_slow_path(h2c->resets > NXT_H2P_MAX_RESETS
+                      && h2c->resets * 2 >= h2c->requests))
+    {
+        nxt_log(task, NXT_LOG_INFO, "h2p client reset %ui of %ui streams",
+                h2c->resets, h2c->requests);
+
+        return NXT_H2P_ENHANCE_YOUR_CALM;
+    }
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_settings(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    u_char            *end;
+    int32_t           delta;
+    uint32_t          value;
+    nxt_uint_t        param;
+    nxt_buf_t         *b;
+    nxt_h2proto_t     *h2p;
+    nxt_queue_link_t  *lnk;
+
+    if (nxt_slow_path(id != 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    if (flags & NXT_H2P_FLAG_ACK) {
+        return (size == 0) ? NXT_H2P_NO_ERROR : NXT_H2P_FRAME_SIZE_ERROR;
+    }
+
+    if (nxt_slow_path(size % 6 != 0)) {
+        return NXT_H2P_FRAME_SIZE_ERROR;
+    }
+
+    for (end = p + size; p < end; p += 6) {
+        param = (p[0] << 8) | p[1];
+        value = nxt_h2p_get_uint32(&p[2]);
+
+        nxt_debug(task, "h2p setting %ui: %uD", param, value);
+
+        switch (param) {
+
+        case 2:  /* SETTINGS_ENABLE_PUSH */
+            if (nxt_slow_path(value > 1)) {
+                return NXT_H2P_PROTOCOL_ERROR;
+            }
+
+            break;
+
+        case 4:  /* SETTINGS_INITIAL_WINDOW_SIZE */
+            if (nxt_slow_path(value > NXT_H2P_MAX_WINDOW)) {
+                return NXT_H2P_FLOW_CONTROL_ERROR;
+            }
+
+            delta = value - h2c->init_window;
+            h2c->init_window = value;
+
+            for (lnk = nxt_queue_first(&h2c->streams);
+                 lnk != nxt_queue_tail(&h2c->streams);
+                 lnk = nxt_queue_next(lnk))
+            {
+                h2p = nxt_queue_link_data(lnk, nxt_h2proto_t, link);
+                h2p->send_window += delta;
+            }
+
+            break;
+
+        case 5:  /* SETTINGS_MAX_FRAME_SIZE */
+            if (nxt_slow_path(value < NXT_H2P_DEFAULT_FRAME_SIZE
+                              || value > NXT_H2P_MAX_FRAME_SIZE))
+            {
+                return NXT_H2P_PROTOCOL_ERROR;
+            }
+
+            h2c->frame_size = value;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    b = nxt_h2p_frame_alloc(h2c, 0);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_H2P_INTERNAL_ERROR;
+    }
+
+    b->mem.free = nxt_h2p_frame_header(b->mem.free, 0, NXT_H2P_SETTINGS,
+                                       NXT_H2P_FLAG_ACK, 0);
+
+    nxt_h2p_frame_send(task, h2c, b);
+
+    nxt_h2p_conn_send(task, h2c);
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_push_promise(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    return NXT_H2P_PROTOCOL_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_ping(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    nxt_buf_t  *b;
+
+    if (nxt_slow_path(id != 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(size != 8)) {
+        return NXT_H2P_FRAME_SIZE_ERROR;
+    }
+
+    if (flags & NXT_H2P_FLAG_ACK) {
+        return NXT_H2P_NO_ERROR;
+    }
+
+    b = nxt_h2p_frame_alloc(h2c, 8);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_H2P_INTERNAL_ERROR;
+    }
+
+    b->mem.free = nxt_h2p_frame_header(b->mem.free, 8, NXT_H2P_PING,
+                                       NXT_H2P_FLAG_ACK, 0);
+    b->mem.free = nxt_cpymem(b->mem.free, p, 8);
+
+    nxt_h2p_frame_send(task, h2c, b);
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_goaway(nxt_task_t *task, nxt_h2p_conn_t *h2c, u_char *p,
+    size_t size, nxt_uint_t flags, uint32_t id)
+{
+    if (nxt_slow_path(id != 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(size < 8)) {
+        return NXT_H2P_FRAME_SIZE_ERROR;
+    }
+
+    nxt_debug(task, "h2p goaway: %uD", nxt_h2p_get_uint32(&p[4]));
+
+    /* The active streams are completed, the connection is closed then. */
+    h2c->goaway = 1;
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_h2p_error_t
+nxt_h2p_frame_window_update(nxt_task_t *task, nxt_h2p_conn_t *h2c,
+    u_char *p, size_t size, nxt_uint_t flags, uint32_t id)
+{
+    int32_t        *window;
+    uint32_t       increment;
+    nxt_h2proto_t  *h2p;
+
+    if (nxt_slow_path(size != 4)) {
+        return NXT_H2P_FRAME_SIZE_ERROR;
+    }
+
+    increment = nxt_h2p_get_uint32(p) & 0x7fffffff;
+
+    if (nxt_slow_path(increment == 0)) {
+        return NXT_H2P_PROTOCOL_ERROR;
+    }
+
+    if (id == 0) {
+        window = &h2c->send_window;
+
+    } else {
+        h2p = nxt_h2p_stream_find(h2c, id);
+
+        if (h2p == NULL) {
+            return NXT_H2P_NO_ERROR;
+        }
+
+        window = &h2p->send_window;
+    }
+
+    if (nxt_slow_path(increment > (uint32_t) (NXT_H2P_MAX_WINDOW - *window))) {
+        return NXT_H2P_FLOW_CONTROL_ERROR;
+    }
+
+    *window += increment;
+
+    nxt_h2p_conn_send(task, h2c);
+
+    return NXT_H2P_NO_ERROR;
+}
+
+
+static nxt_buf_t *
+nxt_h2p_frame_alloc(nxt_h2p_conn_t *h2c, size_t size)
+{
+    nxt_mp_t   *mp;
+    nxt_buf_t  *b;
+
+    mp = h2c->conn->mem_pool;
+
+    b = nxt_buf_mem_alloc(mp, NXT_H2P_FRAME_HEADER_SIZE + size, 0);
+
+    if (nxt_fast_path(b != NULL)) {
+        b->completion_handler = nxt_h2p_frame_completion;
+        b->parent = h2c;
+        nxt_mp_retain(mp);
+    }
+
+    return b;
+}
+
+
+static u_char *
+nxt_h2p_frame_header(u_char *p, size_t size, nxt_uint_t type,
+    nxt_uint_t flags, uint32_t id)
+{
+    *p++ = (u_char) (size >> 16);
+    *p++ = (u_char) (size >> 8);
+    *p++ = (u_char) size;
+    *p++ = (u_char) type;
+    *p++ = (u_char) flags;
+
+    return nxt_h2p_put_uint32(p, id);
+}
+
+
+static void
+nxt_h2p_frame_send(nxt_task_t *task, nxt_h2p_conn_t *h2c, nxt_buf_t *b)
+{
+    nxt_conn_t  *c;
+
+    if (nxt_slow_path(h2c->closed)) {
+        b->completion_handler(task, b, b->parent);
+        return;
+    }
+
+    c = h2c->conn;
+
+    h2c->write_size += nxt_buf_mem_used_size(&b->mem);
+
+    if (c->write == NULL) {
+        c->write = b;
+
+        nxt_conn_write(task->thread->engine, c);
+
+    } else {
+        *h2c->write_tail = b;
+    }
+
+    h2c->write_tail = &b->next;
+}
+
+
+/*
+ * The completion of sent frames lets more response data be copied
+ * from the streams, so the response source is drained at the pace of
+ * the client.
+ */
+
+static void
+nxt_h2p_frame_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_mp_t        *mp;
+    nxt_buf_t       *b, *next;
+    nxt_uint_t      n;
+    nxt_h2p_conn_t  *h2c;
+
+    b = obj;
+    h2c = data;
+
+    mp = h2c->conn->mem_pool;
+    n = 0;
+
+    do {
+        next = b->next;
+
+        h2c->write_size -= b->mem.free - b->mem.start;
+
+        nxt_mp_free(mp, b);
+        n++;
+
+        b = next;
+    } while (b != NULL);
+
+    if (!h2c->closed) {
+        nxt_h2p_conn_send(task, h2c);
+    }
+
+    while (n-- != 0) {
+        nxt_mp_release(mp);
+    }
+}
+
+
+static void
+nxt_h2p_settings_send(nxt_task_t *task, nxt_h2p_conn_t *h2c)
+{
+    u_char     *p;
+    nxt_buf_t  *b;
+
+    b = nxt_h2p_frame_alloc(h2c, 6);
+    if (nxt_slow_path(b == NULL)) {
+        return;
+    }
+
+    p = nxt_h2p_frame_header(b->mem.free, 6, NXT_H2P_SETTINGS, 0, 0);
+
+    /* SETTINGS_MAX_CONCURRENT_STREAMS */
+    *p++ = 0;
+    *p++ = 3;
+    p = nxt_h2p_put_uint32(p, NXT_H2P_MAX_STREAMS);
+
+    b->mem.free = p;
+
+    nxt_h2p_frame_send(task, h2c, b);
+}
+
+
+/*
+ * A WINDOW_UPDATE frame restores a receive window
+ * once half of the window has been used.
+ */
+
+static void
+nxt_h2p_window_update(nxt_task_t *task, nxt_h2p_conn_t *h2c,
+    nxt_h2proto_t *h2p)
+{
+    int32_t    *window;
+    uint32_t   id, size;
+    nxt_buf_t  *b;
+
+    if (h2p != NULL) {
+        window = &h2p->recv_window;
+        id = h2p->id;
+
+    } else {
+        window = &h2c->recv_window;
+        id = 0;
+    }
+
+    if (*window >= NXT_H2P_DEFAULT_WINDOW / 2) {
+        return;
+    }
+
+    size = NXT_H2P_DEFAULT_WINDOW - *window;
+
+    b = nxt_h2p_frame_alloc(h2c, 4);
+    if (nxt_slow_path(b == NULL)) {
+        return;
+    }
+
+    *window = NXT_H2P_DEFAULT_WINDOW;
+
+    b->mem.free = nxt_h2p_frame_header(b->mem.free, 4, NXT_H2P_WINDOW_UPDATE,
+                                       0, id);
+    b->mem.free = nxt_h2p_put_uint32(b->mem.free, size);
+
+    nxt_h2p_frame_send(task, h2c, b);
+}
+
+
+static void
+nxt_h2p_rst_stream(nxt_task_t *task, nxt_h2p_conn_t *h2c, uint32_t id,
+    nxt_h2p_error_t error)
+{
+    nxt_buf_t  *b;
+
+    nxt_debug(task, "h2p rst stream %uD: %d", id, error);
+
+    b = nxt_h2p_frame_alloc(h2c, 4);
+    if (nxt_slow_path(b == NULL)) {
+        return;
+    }
+
+    b->mem.free = nxt_h2p_frame_header(b->mem.free, 4, NXT_H2P_RST_STREAM, 0,
+                                       id);
+    b->mem.free = nxt_h2p_put_uint32(b->mem.free, error);
+
+    nxt_h2p_frame_send(task, h2c, b);
+}
+
+
+static void
+nxt_h2p_goaway(nxt_task_t *task, nxt_h2p_conn_t *h2c, nxt_h2p_error_t error)
+{
+    u_char     *p;
+    nxt_buf_t  *b;
+
+    if (h2c->goaway && error == NXT_H2P_NO_ERROR) {
+        return;
+    }
+
+    h2c->goaway = 1;
+
+    b = nxt_h2p_frame_alloc(h2c, 8);
+    if (nxt_slow_path(b == NULL)) {
+        return;
+    }
+
+    p = nxt_h2p_frame_header(b->mem.free, 8, NXT_H2P_GOAWAY, 0, 0);
+    p = nxt_h2p_put_uint32(p, h2c->last_stream);
+    b->mem.free = nxt_h2p_put_uint32(p, error);
+
+    nxt_h2p_frame_send(task, h2c, b);
+}
+
+
+void
+nxt_h2p_request_local_addr(nxt_task_t *task, nxt_http_request_t *r)
+{
+    r->local = nxt_conn_local_addr(task, r->proto.h2->h2c->conn);
+}
+
+
+nxt_int_t
+nxt_h2p_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_fd_t *fd)
+{
+    /* The body is always read before routing. */
+
+    *fd = -1;
+
+    return NXT_OK;
+}
+
+
+void
+nxt_h2p_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_work_handler_t body_handler, void *data)
+{
+    u_char            *p, *block;
+    size_t            size, rest, n;
+    nxt_buf_t         *b;
+    nxt_uint_t        flags;
+    nxt_h2proto_t     *h2p;
+    nxt_h2p_conn_t    *h2c;
+    nxt_http_field_t  *field;
+
+    nxt_debug(task, "h2p request header send");
+
+    r->header_sent = 1;
+
+    h2p = r->proto.h2;
+    h2c = h2p->h2c;
+
+    size = 1 + 1 + 3;
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (field->skip || field->hopbyhop) {
+            continue;
+        }
+
+        size += nxt_h2p_hpack_field_size(field);
+
+    } nxt_list_loop;
+
+    block = nxt_mp_nget(r->mem_pool, size);
+    if (nxt_slow_path(block == NULL)) {
+        goto fail;
+    }
+
+    p = nxt_h2p_hpack_status(block, r->status);
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (field->skip || field->hopbyhop
+            || nxt_http_field_name_is(field, "Connection")
+            || nxt_http_field_name_is(field, "Keep-Alive")
+            || nxt_http_field_name_is(field, "Transfer-Encoding")
+            || nxt_http_field_name_is(field, "Upgrade"))
+        {
+            continue;
+        }
+
+        p = nxt_h2p_hpack_field(p, field);
+
+    } nxt_list_loop;
+
+    size = p - block;
+
+    /* The header block is split into HEADERS and CONTINUATION frames. */
+
+    n = (size + h2c->frame_size - 1) / h2c->frame_size;
+
+    b = nxt_h2p_frame_alloc(h2c, size + (n - 1) * NXT_H2P_FRAME_HEADER_SIZE);
+    if (nxt_slow_path(b == NULL)) {
+        goto fail;
+    }
+
+    flags = 0;
+
+    if (body_handler == NULL) {
+        flags = NXT_H2P_FLAG_END_STREAM;
+        h2p->end_sent = 1;
+    }
+
+    p = block;
+    rest = size;
+
+    do {
+        n = nxt_min(rest, h2c->frame_size);
+
+        if (n == rest) {
+            flags |= NXT_H2P_FLAG_END_HEADERS;
+        }
+
+        b->mem.free = nxt_h2p_frame_header(b->mem.free, n,
+                                           (p == block) ? NXT_H2P_HEADERS
+                                                        : NXT_H2P_CONTINUATION,
+                                           flags, h2p->id);
+
+        b->mem.free = nxt_cpymem(b->mem.free, p, n);
+
+        p += n;
+        rest -= n;
+        flags = 0;
+
+    } while (rest != 0);
+
+    if (h2p->reset) {
+        b->completion_handler(task, b, b->parent);
+
+    } else {
+        nxt_h2p_frame_send(task, h2c, b);
+    }
+
+    if (body_handler != NULL) {
+        nxt_work_queue_add(&task->thread->engine->fast_work_queue,
+                           body_handler, task, r, data);
+
+    } else {
+        h2p->out = nxt_http_buf_last(r);
+
+        nxt_h2p_conn_send(task, h2c);
+    }
+
+    return;
+
+fail:
+
+    nxt_h2p_request_error(task, h2p);
+}
+
+
+void
+nxt_h2p_request_send(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out)
+{
+    nxt_buf_t      **tail;
+    nxt_h2proto_t  *h2p;
+
+    nxt_debug(task, "h2p request send");
+
+    h2p = r->proto.h2;
+
+    for (tail = &h2p->out; *tail != NULL; tail = &(*tail)->next) {
+        /* void */
+    }
+
+    *tail = out;
+
+    nxt_h2p_conn_send(task, h2p->h2c);
+}
+
+
+static void
+nxt_h2p_conn_send(nxt_task_t *task, nxt_h2p_conn_t *h2c)
+{
+    nxt_h2proto_t     *h2p;
+    nxt_queue_link_t  *lnk, *next;
+
+    for (lnk = nxt_queue_first(&h2c->streams);
+         lnk != nxt_queue_tail(&h2c->streams);
+         lnk = next)
+    {
+        next = nxt_queue_next(lnk);
+
+        h2p = nxt_queue_link_data(lnk, nxt_h2proto_t, link);
+
+        if (h2p->out != NULL
+            && nxt_slow_path(nxt_h2p_stream_send(task, h2c, h2p) != NXT_OK))
+        {
+            nxt_h2p_request_error(task, h2p);
+        }
+
+        if (h2c->write_size >= NXT_H2P_WRITE_LIMIT) {
+            break;
+        }
+    }
+}
+
+
+/*
+ * The stream response buffers are copied to DATA frames within the send
+ * windows.  A buffer is completed as soon as it has been copied entirely,
+ * and the last buffer sets the END_STREAM flag of the preceding DATA frame
+ * if possible.
+ */
+
+static nxt_int_t
+nxt_h2p_stream_send(nxt_task_t *task, nxt_h2p_conn_t *h2c, nxt_h2proto_t *h2p)
+{
+    u_char      *p;
+    size_t      size, n;
+    ssize_t     nread;
+    int32_t     window;
+    nxt_buf_t   *b, *frame;
+    nxt_uint_t  flags;
+
+    while (h2p->out != NULL) {
+        b = h2p->out;
+
+        if (h2p->reset) {
+            h2p->out = NULL;
+            nxt_sendbuf_drain(task, &task->thread->engine->fast_work_queue, b);
+
+            return NXT_OK;
+        }
+
+        if (nxt_buf_is_sync(b)) {
+            if (nxt_buf_is_last(b) && !h2p->end_sent) {
+                frame = nxt_h2p_frame_alloc(h2c, 0);
+                if (nxt_slow_path(frame == NULL)) {
+                    return NXT_ERROR;
+                }
+
+                frame->mem.free = nxt_h2p_frame_header(frame->mem.free, 0,
+                                                       NXT_H2P_DATA,
+                                                       NXT_H2P_FLAG_END_STREAM,
+                                                       h2p->id);
+                nxt_h2p_frame_send(task, h2c, frame);
+
+                h2p->end_sent = 1;
+            }
+
+            nxt_h2p_buf_complete(task, h2p);
+            continue;
+        }
+
+        size = nxt_buf_used_size(b);
+
+        if (size == 0) {
+            nxt_h2p_buf_complete(task, h2p);
+            continue;
+        }
+
+        if (h2c->write_size >= NXT_H2P_WRITE_LIMIT) {
+            break;
+        }
+
+        window = nxt_min(h2c->send_window, h2p->send_window);
+
+        if (window <= 0) {
+            nxt_debug(task, "h2p stream %uD blocked by flow control",
+                      h2p->id);
+            break;
+        }
+
+        n = nxt_min(size, (size_t) window);
+        n = nxt_min(n, NXT_H2P_DEFAULT_FRAME_SIZE);
+        n = nxt_min(n, h2c->frame_size);
+
+        flags = 0;
+
+        if (n == size && b->next != NULL && nxt_buf_is_last(b->next)) {
+            flags = NXT_H2P_FLAG_END_STREAM;
+        }
+
+        frame = nxt_h2p_frame_alloc(h2c, n);
+        if (nxt_slow_path(frame == NULL)) {
+            return NXT_ERROR;
+        }
+
+        p = nxt_h2p_frame_header(frame->mem.free, n, NXT_H2P_DATA, flags,
+                                 h2p->id);
+
+        if (nxt_buf_is_mem(b)) {
+            nxt_memcpy(p, b->mem.pos, n);
+            b->mem.pos += n;
+
+        } else {
+            nread = nxt_file_read(b->file, p, n, b->file_pos);
+
+            if (nxt_slow_path(nread != (ssize_t) n)) {
+                frame->completion_handler(task, frame, frame->parent);
+                return NXT_ERROR;
+            }
+
+            b->file_pos += n;
+        }
+
+        frame->mem.free = p + n;
+
+        h2c->send_window -= n;
+        h2p->send_window -= n;
+        h2p->sent += n;
+
+        if (flags) {
+            h2p->end_sent = 1;
+        }
+
+        nxt_h2p_frame_send(task, h2c, frame);
+
+        if (n == size) {
+            nxt_h2p_buf_complete(task, h2p);
+        }
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_h2p_buf_complete(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    nxt_buf_t  *b;
+
+    b = h2p->out;
+
+    h2p->out = b->next;
+    b->next = NULL;
+
+    nxt_work_queue_add(&task->thread->engine->fast_work_queue,
+                       b->completion_handler, task, b, b->parent);
+}
+
+
+nxt_off_t
+nxt_h2p_request_body_bytes_sent(nxt_task_t *task, nxt_http_proto_t proto)
+{
+    return proto.h2->sent;
+}
+
+
+nxt_off_t
+nxt_h2p_request_bytes_received(nxt_task_t *task, nxt_http_proto_t proto)
+{
+    return proto.h2->received;
+}
+
+
+void
+nxt_h2p_request_discard(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *last)
+{
+    nxt_buf_t         *b;
+    nxt_h2proto_t     *h2p;
+    nxt_work_queue_t  *wq;
+
+    nxt_debug(task, "h2p request discard");
+
+    h2p = r->proto.h2;
+
+    if (!h2p->reset && !h2p->end_sent) {
+        h2p->reset = 1;
+
+        nxt_h2p_rst_stream(task, h2p->h2c, h2p->id, NXT_H2P_INTERNAL_ERROR);
+    }
+
+    b = h2p->out;
+    h2p->out = NULL;
+
+    wq = &task->thread->engine->fast_work_queue;
+
+    nxt_sendbuf_drain(task, wq, b);
+    nxt_sendbuf_drain(task, wq, last);
+}
+
+
+static void
+nxt_h2p_request_error(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    nxt_http_request_t  *r;
+
+    r = h2p->request;
+
+    r->state->error_handler(task, r, h2p);
+}
+
+
+/*
+ * The stream is terminated by the client or by the connection closing.
+ * The request may still wait for an application response, so it is
+ * marked as failed to discard the response.
+ */
+
+static void
+nxt_h2p_stream_reset(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    nxt_http_request_t  *r;
+
+    if (h2p->reset) {
+        return;
+    }
+
+    h2p->reset = 1;
+    h2p->body_done = 1;
+    h2p->body_wait = 0;
+
+    r = h2p->request;
+    r->error = 1;
+
+    r->state->error_handler(&r->task, r, h2p);
+}
+
+
+void
+nxt_h2p_request_close(nxt_task_t *task, nxt_http_proto_t proto,
+    nxt_socket_conf_joint_t *joint)
+{
+    nxt_h2proto_t   *h2p;
+    nxt_h2p_conn_t  *h2c;
+
+    nxt_debug(task, "h2p request close");
+
+    h2p = proto.h2;
+    h2c = h2p->h2c;
+
+    if (!h2p->reset && !h2c->goaway && (!h2p->end_sent || !h2p->body_done)) {
+        /*
+         * A response is incomplete, or the rest of the request body
+         * is not needed anymore, RFC 7540, 8.1.
+         */
+        nxt_h2p_rst_stream(task, h2c, h2p->id,
+                           h2p->end_sent ? NXT_H2P_NO_ERROR
+                                         : NXT_H2P_INTERNAL_ERROR);
+    }
+
+    if (h2p->out != NULL) {
+        nxt_sendbuf_drain(task, &task->thread->engine->fast_work_queue,
+                          h2p->out);
+        h2p->out = NULL;
+    }
+
+    nxt_queue_remove(&h2p->link);
+    h2c->nstreams--;
+
+    nxt_router_conf_release(task, joint);
+
+    task = &h2c->conn->task;
+
+    if (h2c->closing) {
+        nxt_h2p_close_test(task, h2c);
+
+    } else if (h2c->goaway && h2c->nstreams == 0) {
+        nxt_h2p_shutdown(task, h2c);
+    }
+}
+
+
+static const nxt_conn_state_t  nxt_h2p_write_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h2p_conn_sent,
+    .error_handler = nxt_h2p_conn_write_error,
+
+    .timer_handler = nxt_h2p_conn_send_timeout,
+    .timer_value = nxt_h2p_conn_timer_value,
+    .timer_data = offsetof(nxt_socket_conf_t, send_timeout),
+    .timer_autoreset = 1,
+};
+
+
+static void
+nxt_h2p_conn_sent(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t          *c;
+    nxt_h2p_conn_t      *h2c;
+    nxt_event_engine_t  *engine;
+
+    c = obj;
+    h2c = data;
+
+    nxt_debug(task, "h2p conn sent");
+
+    engine = task->thread->engine;
+
+    c->write = nxt_sendbuf_completion(task, &engine->fast_work_queue, c->write);
+
+    if (c->write != NULL) {
+        nxt_conn_write(engine, c);
+        return;
+    }
+
+    if (h2c->closing) {
+        nxt_h2p_close_test(task, h2c);
+    }
+}
+
+
+static void
+nxt_h2p_conn_close(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_h2p_conn_t  *h2c;
+
+    h2c = data;
+
+    nxt_debug(task, "h2p conn close");
+
+    /* The client has closed the connection, nothing is to be sent. */
+    h2c->goaway = 1;
+
+    nxt_h2p_shutdown(task, h2c);
+}
+
+
+static void
+nxt_h2p_conn_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t      *c;
+    nxt_h2p_conn_t  *h2c;
+
+    c = obj;
+    h2c = data;
+
+    nxt_debug(task, "h2p conn error");
+
+    c->block_write = 1;
+    h2c->goaway = 1;
+
+    nxt_h2p_shutdown(task, h2c);
+}
+
+
+static void
+nxt_h2p_conn_write_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t      *c;
+    nxt_h2p_conn_t  *h2c;
+
+    c = obj;
+    h2c = data;
+
+    nxt_debug(task, "h2p conn write error");
+
+    c->block_write = 1;
+    h2c->goaway = 1;
+
+    nxt_sendbuf_drain(task, &task->thread->engine->fast_work_queue, c->write);
+    c->write = NULL;
+
+    nxt_h2p_shutdown(task, h2c);
+}
+
+
+static void
+nxt_h2p_conn_idle_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t      *c;
+    nxt_timer_t     *timer;
+    nxt_h2p_conn_t  *h2c;
+
+    timer = obj;
+
+    nxt_debug(task, "h2p conn idle timeout");
+
+    c = nxt_read_timer_conn(timer);
+    h2c = c->socket.data;
+
+    if (h2c->nstreams != 0) {
+        /* The connection is not idle while the responses are prepared. */
+        nxt_conn_timer(task->thread->engine, c, c->read_state,
+                       &c->read_timer);
+        return;
+    }
+
+    c->block_read = 1;
+
+    nxt_h2p_goaway(task, h2c, NXT_H2P_NO_ERROR);
+    nxt_h2p_shutdown(task, h2c);
+}
+
+
+static void
+nxt_h2p_conn_send_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_debug(task, "h2p conn send timeout");
+
+    c = nxt_write_timer_conn(timer);
+
+    nxt_h2p_conn_write_error(task, c, c->socket.data);
+}
+
+
+static nxt_msec_t
+nxt_h2p_conn_timer_value(nxt_conn_t *c, uintptr_t data)
+{
+    nxt_socket_conf_joint_t  *joint;
+
+    joint = c->listen->socket.data;
+
+    if (nxt_fast_path(joint != NULL)) {
+        return nxt_value_at(nxt_msec_t, joint->socket_conf, data);
+    }
+
+    /* Listening socket had been closed. */
+    return 1;
+}
+
+
+/*
+ * The connection is not read anymore, the active streams are terminated,
+ * and the connection is closed as soon as they are closed and the queued
+ * frames are sent.
+ */
+
+static void
+nxt_h2p_shutdown(nxt_task_t *task, nxt_h2p_conn_t *h2c)
+{
+    nxt_h2proto_t     *h2p;
+    nxt_queue_link_t  *lnk, *next;
+
+    nxt_debug(task, "h2p shutdown");
+
+    if (h2c->closing) {
+        return;
+    }
+
+    h2c->closing = 1;
+
+    for (lnk = nxt_queue_first(&h2c->streams);
+         lnk != nxt_queue_tail(&h2c->streams);
+         lnk = next)
+    {
+        next = nxt_queue_next(lnk);
+
+        h2p = nxt_queue_link_data(lnk, nxt_h2proto_t, link);
+
+        nxt_h2p_stream_reset(task, h2p);
+    }
+
+    nxt_h2p_close_test(task, h2c);
+}
+
+
+static void
+nxt_h2p_close_test(nxt_task_t *task, nxt_h2p_conn_t *h2c)
+{
+    nxt_conn_t  *c;
+
+    c = h2c->conn;
+
+    if (h2c->closed || h2c->nstreams != 0 || c->write != NULL) {
+        return;
+    }
+
+    nxt_debug(task, "h2p conn closing");
+
+    h2c->closed = 1;
+
+    nxt_h2p_hpack_free(&h2c->hpack);
+
+    nxt_h1p_closing(task, c);
+}
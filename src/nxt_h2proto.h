@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#ifndef _NXT_H2PROTO_H_INCLUDED_
+#define _NXT_H2PROTO_H_INCLUDED_
+
+
+#include <nxt_main.h>
+#include <nxt_http_parse.h>
+#include <nxt_http.h>
+#include <nxt_router.h>
+
+
+#define NXT_H2P_FRAME_HEADER_SIZE      9
+#define NXT_H2P_DEFAULT_FRAME_SIZE     16384
+#define NXT_H2P_MAX_FRAME_SIZE         ((1 << 24) - 1)
+#define NXT_H2P_DEFAULT_WINDOW         65535
+#define NXT_H2P_MAX_WINDOW             0x7fffffff
+#define NXT_H2P_HPACK_TABLE_SIZE       4096
+#define NXT_H2P_HPACK_ENTRIES          (NXT_H2P_HPACK_TABLE_SIZE / 32)
+
+
+typedef enum {
+    NXT_H2P_DATA = 0,
+    NXT_H2P_HEADERS,
+    NXT_H2P_PRIORITY,
+    NXT_H2P_RST_STREAM,
+    NXT_H2P_SETTINGS,
+    NXT_H2P_PUSH_PROMISE,
+    NXT_H2P_PING,
+    NXT_H2P_GOAWAY,
+    NXT_H2P_WINDOW_UPDATE,
+    NXT_H2P_CONTINUATION,
+} nxt_h2p_frame_type_t;
+
+
+#define NXT_H2P_FLAG_END_STREAM        0x01
+#define NXT_H2P_FLAG_ACK               0x01
+#define NXT_H2P_FLAG_END_HEADERS       0x04
+#define NXT_H2P_FLAG_PADDED            0x08
+#define NXT_H2P_FLAG_PRIORITY          0x20
+
+
+typedef enum {
+    NXT_H2P_NO_ERROR = 0,
+    NXT_H2P_PROTOCOL_ERROR,
+    NXT_H2P_INTERNAL_ERROR,
+    NXT_H2P_FLOW_CONTROL_ERROR,
+    NXT_H2P_SETTINGS_TIMEOUT,
+    NXT_H2P_STREAM_CLOSED,
+    NXT_H2P_FRAME_SIZE_ERROR,
+    NXT_H2P_REFUSED_STREAM,
+    NXT_H2P_CANCEL,
+    NXT_H2P_COMPRESSION_ERROR,
+    NXT_H2P_CONNECT_ERROR,
+    NXT_H2P_ENHANCE_YOUR_CALM,
+    NXT_H2P_INADEQUATE_SECURITY,
+    NXT_H2P_HTTP_1_1_REQUIRED,
+} nxt_h2p_error_t;
+
+
+typedef struct {
+    uint32_t                  size;
+    uint32_t                  name_length;
+    uint32_t                  value_length;
+    u_char                    data[0];
+} nxt_h2p_hpack_entry_t;
+
+
+/* The HPACK decoder state, RFC 7541. */
+
+typedef struct {
+    nxt_mp_t                  *mem_pool;
+
+    /* The dynamic table is a ring of entries, the newest one is at "head". */
+    nxt_h2p_hpack_entry_t     *entries[NXT_H2P_HPACK_ENTRIES];
+    uint32_t                  head;
+    uint32_t                  count;
+
+    size_t                    size;
+    size_t                    max_size;
+} nxt_h2p_hpack_t;
+
+
+typedef struct {
+    nxt_str_t                 name;
+    nxt_str_t                 value;
+} nxt_h2p_header_t;
+
+
+typedef struct nxt_h2p_conn_s  nxt_h2p_conn_t;
+
+/* A stream of an HTTP/2 connection, it is r->proto.h2. */
+
+struct nxt_h2proto_s {
+    nxt_http_request_parse_t  parser;
+
+    nxt_queue_link_t          link;        /* h2c->streams */
+    nxt_h2p_conn_t            *h2c;
+    nxt_http_request_t        *request;
+
+    /* Response buffers waiting for the send window. */
+    nxt_buf_t                 *out;
+
+    /* The request bytes read from the client connection. */
+    nxt_off_t                 received;
+    /* The response DATA payload bytes sent. */
+    nxt_off_t                 sent;
+    nxt_off_t                 body_size;
+
+    uint32_t                  id;
+    int32_t                   send_window;
+    int32_t                   recv_window;
+
+    /* END_STREAM has been received, the stream is half-closed (remote). */
+    uint8_t                   end_received; /* 1 bit */
+    uint8_t                   body_done;   /* 1 bit */
+    uint8_t                   body_wait;   /* 1 bit */
+    uint8_t                   end_sent;    /* 1 bit */
+    uint8_t                   reset;       /* 1 bit */
+};
+
+
+struct nxt_h2p_conn_s {
+    nxt_conn_t                *conn;
+
+    nxt_queue_t               streams;
+    nxt_uint_t                nstreams;
+
+    nxt_h2p_hpack_t           hpack;
+
+    /* A header block split into HEADERS and CONTINUATION frames. */
+    u_char                    *header_block;
+    size_t                    header_size;
+    uint32_t                  header_stream;
+    uint8_t                   header_flags;
+
+    uint32_t                  last_stream;
+
+    /* The streams created and the streams reset by the client. */
+    nxt_uint_t                requests;
+    nxt_uint_t                resets;
+
+    /* The peer settings and the connection send window. */
+    int32_t                   send_window;
+    int32_t                   init_window;
+    uint32_t                  frame_size;
+
+    /* The connection receive window. */
+    int32_t                   recv_window;
+
+    /* The size of frames queued in c->write. */
+    size_t                    write_size;
+    nxt_buf_t                 **write_tail;
+
+    uint8_t                   preface;     /* 1 bit */
+    uint8_t                   goaway;      /* 1 bit */
+    uint8_t                   closing;     /* 1 bit */
+    uint8_t                   closed;      /* 1 bit */
+};
+
+
+nxt_int_t nxt_h2p_hpack_init(void);
+nxt_int_t nxt_h2p_hpack_decode(nxt_h2p_hpack_t *hpack, nxt_mp_t *mp,
+    u_char *pos, u_char *end, nxt_array_t *headers);
+u_char *nxt_h2p_hpack_status(u_char *p, nxt_uint_t status);
+size_t nxt_h2p_hpack_field_size(nxt_http_field_t *field);
+u_char *nxt_h2p_hpack_field(u_char *p, nxt_http_field_t *field);
+void nxt_h2p_hpack_free(nxt_h2p_hpack_t *hpack);
+
+
+#endif  /* _NXT_H2PROTO_H_INCLUDED_ */
@@ -0,0 +1,686 @@
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_h2proto.h>
+
+
+/*
+ * The HPACK header compression, RFC 7541.  The decoder supports the whole
+ * format including the Huffman coding and the dynamic table.  The encoder
+ * uses only literal representations without indexing, so no encoder
+ * dynamic table is needed, and the status and field names are taken from
+ * the static table where possible.
+ */
+
+
+#define NXT_H2P_HPACK_INT_LEN  5
+
+
+typedef struct {
+    uint32_t                   code;
+    uint32_t                   bits;
+} nxt_h2p_huff_code_t;
+
+
+static nxt_int_t nxt_h2p_hpack_int(u_char **pos, u_char *end,
+    nxt_uint_t prefix, uint32_t *value);
+static nxt_int_t nxt_h2p_hpack_string(u_char **pos, u_char *end, nxt_mp_t *mp,
+    nxt_str_t *str);
+static u_char *nxt_h2p_huff_decode(u_char *p, size_t size, u_char *dst);
+static nxt_int_t nxt_h2p_hpack_index(nxt_h2p_hpack_t *hpack, nxt_mp_t *mp,
+    uint32_t index, nxt_h2p_header_t *header);
+static nxt_int_t nxt_h2p_hpack_add(nxt_h2p_hpack_t *hpack,
+    nxt_h2p_header_t *header);
+static void nxt_h2p_hpack_evict(nxt_h2p_hpack_t *hpack, size_t size);
+static u_char *nxt_h2p_hpack_int_put(u_char *p, nxt_uint_t prefix,
+    uint32_t value);
+
+
+static const nxt_h2p_header_t  nxt_h2p_hpack_static[] = {
+    { nxt_string(":authority"), nxt_null_string },
+    { nxt_string(":method"), nxt_string("GET") },
+    { nxt_string(":method"), nxt_string("POST") },
+    { nxt_string(":path"), nxt_string("/") },
+    { nxt_string(":path"), nxt_string("/index.html") },
+    { nxt_string(":scheme"), nxt_string("http") },
+    { nxt_string(":scheme"), nxt_string("https") },
+    { nxt_string(":status"), nxt_string("200") },
+    { nxt_string(":status"), nxt_string("204") },
+    { nxt_string(":status"), nxt_string("206") },
+    { nxt_string(":status"), nxt_string("304") },
+    { nxt_string(":status"), nxt_string("400") },
+    { nxt_string(":status"), nxt_string("404") },
+    { nxt_string(":status"), nxt_string("500") },
+    { nxt_string("accept-charset"), nxt_null_string },
+    { nxt_string("accept-encoding"), nxt_string("gzip, deflate") },
+    { nxt_string("accept-language"), nxt_null_string },
+    { nxt_string("accept-ranges"), nxt_null_string },
+    { nxt_string("accept"), nxt_null_string },
+    { nxt_string("access-control-allow-origin"), nxt_null_string },
+    { nxt_string("age"), nxt_null_string },
+    { nxt_string("allow"), nxt_null_string },
+    { nxt_string("authorization"), nxt_null_string },
+    { nxt_string("cache-control"), nxt_null_string },
+    { nxt_string("content-disposition"), nxt_null_string },
+    { nxt_string("content-encoding"), nxt_null_string },
+    { nxt_string("content-language"), nxt_null_string },
+    { nxt_string("content-length"), nxt_null_string },
+    { nxt_string("content-location"), nxt_null_string },
+    { nxt_string("content-range"), nxt_null_string },
+    { nxt_string("content-type"), nxt_null_string },
+    { nxt_string("cookie"), nxt_null_string },
+    { nxt_string("date"), nxt_null_string },
+    { nxt_string("etag"), nxt_null_string },
+    { nxt_string("expect"), nxt_null_string },
+    { nxt_string("expires"), nxt_null_string },
+    { nxt_string("from"), nxt_null_string },
+    { nxt_string("host"), nxt_null_string },
+    { nxt_string("if-match"), nxt_null_string },
+    { nxt_string("if-modified-since"), nxt_null_string },
+    { nxt_string("if-none-match"), nxt_null_string },
+    { nxt_string("if-range"), nxt_null_string },
+    { nxt_string("if-unmodified-since"), nxt_null_string },
+    { nxt_string("last-modified"), nxt_null_string },
+    { nxt_string("link"), nxt_null_string },
+    { nxt_string("location"), nxt_null_string },
+    { nxt_string("max-forwards"), nxt_null_string },
+    { nxt_string("proxy-authenticate"), nxt_null_string },
+    { nxt_string("proxy-authorization"), nxt_null_string },
+    { nxt_string("range"), nxt_null_string },
+    { nxt_string("referer"), nxt_null_string },
+    { nxt_string("refresh"), nxt_null_string },
+    { nxt_string("retry-after"), nxt_null_string },
+    { nxt_string("server"), nxt_null_string },
+    { nxt_string("set-cookie"), nxt_null_string },
+    { nxt_string("strict-transport-security"), nxt_null_string },
+    { nxt_string("transfer-encoding"), nxt_null_string },
+    { nxt_string("user-agent"), nxt_null_string },
+    { nxt_string("vary"), nxt_null_string },
+    { nxt_string("via"), nxt_null_string },
+    { nxt_string("www-authenticate"), nxt_null_string },
+};
+
+
+static const nxt_h2p_huff_code_t  nxt_h2p_huff_codes[257] = {
+    { 0x00001ff8, 13 }, { 0x007fffd8, 23 }, { 0x0fffffe2, 28 },
+    { 0x0fffffe3, 28 }, { 0x0fffffe4, 28 }, { 0x0fffffe5, 28 },
+    { 0x0fffffe6, 28 }, { 0x0fffffe7, 28 }, { 0x0fffffe8, 28 },
+    { 0x00ffffea, 24 }, { 0x3ffffffc, 30 }, { 0x0fffffe9, 28 },
+    { 0x0fffffea, 28 }, { 0x3ffffffd, 30 }, { 0x0fffffeb, 28 },
+    { 0x0fffffec, 28 }, { 0x0fffffed, 28 }, { 0x0fffffee, 28 },
+    { 0x0fffffef, 28 }, { 0x0ffffff0, 28 }, { 0x0ffffff1, 28 },
+    { 0x0ffffff2, 28 }, { 0x3ffffffe, 30 }, { 0x0ffffff3, 28 },
+    { 0x0ffffff4, 28 }, { 0x0ffffff5, 28 }, { 0x0ffffff6, 28 },
+    { 0x0ffffff7, 28 }, { 0x0ffffff8, 28 }, { 0x0ffffff9, 28 },
+    { 0x0ffffffa, 28 }, { 0x0ffffffb, 28 }, { 0x00000014,  6 },
+    { 0x000003f8, 10 }, { 0x000003f9, 10 }, { 0x00000ffa, 12 },
+    { 0x00001ff9, 13 }, { 0x00000015,  6 }, { 0x000000f8,  8 },
+    { 0x000007fa, 11 }, { 0x000003fa, 10 }, { 0x000003fb, 10 },
+    { 0x000000f9,  8 }, { 0x000007fb, 11 }, { 0x000000fa,  8 },
+    { 0x00000016,  6 }, { 0x00000017,  6 }, { 0x00000018,  6 },
+    { 0x00000000,  5 }, { 0x00000001,  5 }, { 0x00000002,  5 },
+    { 0x00000019,  6 }, { 0x0000001a,  6 }, { 0x0000001b,  6 },
+    { 0x0000001c,  6 }, { 0x0000001d,  6 }, { 0x0000001e,  6 },
+    { 0x0000001f,  6 }, { 0x0000005c,  7 }, { 0x000000fb,  8 },
+    { 0x00007ffc, 15 }, { 0x00000020,  6 }, { 0x00000ffb, 12 },
+    { 0x000003fc, 10 }, { 0x00001ffa, 13 }, { 0x00000021,  6 },
+    { 0x0000005d,  7 }, { 0x0000005e,  7 }, { 0x0000005f,  7 },
+    { 0x00000060,  7 }, { 0x00000061,  7 }, { 0x00000062,  7 },
+    { 0x00000063,  7 }, { 0x00000064,  7 }, { 0x00000065,  7 },
+    { 0x00000066,  7 }, { 0x00000067,  7 }, { 0x00000068,  7 },
+    { 0x00000069,  7 }, { 0x0000006a,  7 }, { 0x0000006b,  7 },
+    { 0x0000006c,  7 }, { 0x0000006d,  7 }, { 0x0000006e,  7 },
+    { 0x0000006f,  7 }, { 0x00000070,  7 }, { 0x00000071,  7 },
+    { 0x00000072,  7 }, { 0x000000fc,  8 }, { 0x00000073,  7 },
+    { 0x000000fd,  8 }, { 0x00001ffb, 13 }, { 0x0007fff0, 19 },
+    { 0x00001ffc, 13 }, { 0x00003ffc, 14 }, { 0x00000022,  6 },
+    { 0x00007ffd, 15 }, { 0x00000003,  5 }, { 0x00000023,  6 },
+    { 0x00000004,  5 }, { 0x00000024,  6 }, { 0x00000005,  5 },
+    { 0x00000025,  6 }, { 0x00000026,  6 }, { 0x00000027,  6 },
+    { 0x00000006,  5 }, { 0x00000074,  7 }, { 0x00000075,  7 },
+    { 0x00000028,  6 }, { 0x00000029,  6 }, { 0x0000002a,  6 },
+    { 0x00000007,  5 }, { 0x0000002b,  6 }, { 0x00000076,  7 },
+    { 0x0000002c,  6 }, { 0x00000008,  5 }, { 0x00000009,  5 },
+    { 0x0000002d,  6 }, { 0x00000077,  7 }, { 0x00000078,  7 },
+    { 0x00000079,  7 }, { 0x0000007a,  7 }, { 0x0000007b,  7 },
+    { 0x00007ffe, 15 }, { 0x000007fc, 11 }, { 0x00003ffd, 14 },
+    { 0x00001ffd, 13 }, { 0x0ffffffc, 28 }, { 0x000fffe6, 20 },
+    { 0x003fffd2, 22 }, { 0x000fffe7, 20 }, { 0x000fffe8, 20 },
+    { 0x003fffd3, 22 }, { 0x003fffd4, 22 }, { 0x003fffd5, 22 },
+    { 0x007fffd9, 23 }, { 0x003fffd6, 22 }, { 0x007fffda, 23 },
+    { 0x007fffdb, 23 }, { 0x007fffdc, 23 }, { 0x007fffdd, 23 },
+    { 0x007fffde, 23 }, { 0x00ffffeb, 24 }, { 0x007fffdf, 23 },
+    { 0x00ffffec, 24 }, { 0x00ffffed, 24 }, { 0x003fffd7, 22 },
+    { 0x007fffe0, 23 }, { 0x00ffffee, 24 }, { 0x007fffe1, 23 },
+    { 0x007fffe2, 23 }, { 0x007fffe3, 23 }, { 0x007fffe4, 23 },
+    { 0x001fffdc, 21 }, { 0x003fffd8, 22 }, { 0x007fffe5, 23 },
+    { 0x003fffd9, 22 }, { 0x007fffe6, 23 }, { 0x007fffe7, 23 },
+    { 0x00ffffef, 24 }, { 0x003fffda, 22 }, { 0x001fffdd, 21 },
+    { 0x000fffe9, 20 }, { 0x003fffdb, 22 }, { 0x003fffdc, 22 },
+    { 0x007fffe8, 23 }, { 0x007fffe9, 23 }, { 0x001fffde, 21 },
+    { 0x007fffea, 23 }, { 0x003fffdd, 22 }, { 0x003fffde, 22 },
+    { 0x00fffff0, 24 }, { 0x001fffdf, 21 }, { 0x003fffdf, 22 },
+    { 0x007fffeb, 23 }, { 0x007fffec, 23 }, { 0x001fffe0, 21 },
+    { 0x001fffe1, 21 }, { 0x003fffe0, 22 }, { 0x001fffe2, 21 },
+    { 0x007fffed, 23 }, { 0x003fffe1, 22 }, { 0x007fffee, 23 },
+    { 0x007fffef, 23 }, { 0x000fffea, 20 }, { 0x003fffe2, 22 },
+    { 0x003fffe3, 22 }, { 0x003fffe4, 22 }, { 0x007ffff0, 23 },
+    { 0x003fffe5, 22 }, { 0x003fffe6, 22 }, { 0x007ffff1, 23 },
+    { 0x03ffffe0, 26 }, { 0x03ffffe1, 26 }, { 0x000fffeb, 20 },
+    { 0x0007fff1, 19 }, { 0x003fffe7, 22 }, { 0x007ffff2, 23 },
+    { 0x003fffe8, 22 }, { 0x01ffffec, 25 }, { 0x03ffffe2, 26 },
+    { 0x03ffffe3, 26 }, { 0x03ffffe4, 26 }, { 0x07ffffde, 27 },
+    { 0x07ffffdf, 27 }, { 0x03ffffe5, 26 }, { 0x00fffff1, 24 },
+    { 0x01ffffed, 25 }, { 0x0007fff2, 19 }, { 0x001fffe3, 21 },
+    { 0x03ffffe6, 26 }, { 0x07ffffe0, 27 }, { 0x07ffffe1, 27 },
+    { 0x03ffffe7, 26 }, { 0x07ffffe2, 27 }, { 0x00fffff2, 24 },
+    { 0x001fffe4, 21 }, { 0x001fffe5, 21 }, { 0x03ffffe8, 26 },
+    { 0x03ffffe9, 26 }, { 0x0ffffffd, 28 }, { 0x07ffffe3, 27 },
+    { 0x07ffffe4, 27 }, { 0x07ffffe5, 27 }, { 0x000fffec, 20 },
+    { 0x00fffff3, 24 }, { 0x000fffed, 20 }, { 0x001fffe6, 21 },
+    { 0x003fffe9, 22 }, { 0x001fffe7, 21 }, { 0x001fffe8, 21 },
+    { 0x007ffff3, 23 }, { 0x003fffea, 22 }, { 0x003fffeb, 22 },
+    { 0x01ffffee, 25 }, { 0x01ffffef, 25 }, { 0x00fffff4, 24 },
+    { 0x00fffff5, 24 }, { 0x03ffffea, 26 }, { 0x007ffff4, 23 },
+    { 0x03ffffeb, 26 }, { 0x07ffffe6, 27 }, { 0x03ffffec, 26 },
+    { 0x03ffffed, 26 }, { 0x07ffffe7, 27 }, { 0x07ffffe8, 27 },
+    { 0x07ffffe9, 27 }, { 0x07ffffea, 27 }, { 0x07ffffeb, 27 },
+    { 0x0ffffffe, 28 }, { 0x07ffffec, 27 }, { 0x07ffffed, 27 },
+    { 0x07ffffee, 27 }, { 0x07ffffef, 27 }, { 0x07fffff0, 27 },
+    { 0x03ffffee, 26 }, { 0x3fffffff, 30 },
+};
+
+
+/*
+ * The Huffman decoding tree: a positive value is the next node index,
+ * a negative value is a leaf with the (-value - 1) symbol.
+ */
+static int16_t  nxt_h2p_huff_tree[256][2];
+
+
+nxt_int_t
+nxt_h2p_hpack_init(void)
+{
+    int16_t     *next;
+    uint32_t    code, bits;
+    nxt_uint_t  sym, node, nodes;
+
+    nodes = 0;
+
+    for (sym = 0; sym < nxt_nitems(nxt_h2p_huff_codes); sym++) {
+        code = nxt_h2p_huff_codes[sym].code;
+        bits = nxt_h2p_huff_codes[sym].bits;
+
+        node = 0;
+
+        while (--bits != 0) {
+            next = &nxt_h2p_huff_tree[node][(code >> bits) & 1];
+
+            if (*next == 0) {
+                if (nxt_slow_path(++nodes >= nxt_nitems(nxt_h2p_huff_tree))) {
+                    return NXT_ERROR;
+                }
+
+                *next = nodes;
+            }
+
+            if (nxt_slow_path(*next < 0)) {
+                return NXT_ERROR;
+            }
+
+            node = *next;
+        }
+
+        nxt_h2p_huff_tree[node][code & 1] = -(int16_t) (sym + 1);
+    }
+
+    return NXT_OK;
+}
+
+
+nxt_int_t
+nxt_h2p_hpack_decode(nxt_h2p_hpack_t *hpack, nxt_mp_t *mp, u_char *pos,
+    u_char *end, nxt_array_t *headers)
+{
+    u_char            ch;
+    uint32_t          index;
+    nxt_int_t         ret;
+    nxt_h2p_header_t  *header;
+
+    while (pos < end) {
+        ch = *pos;
+
+        if ((ch & 0xe0) == 0x20) {
+            /* A dynamic table size update. */
+
+            ret = nxt_h2p_hpack_int(&pos, end, 5, &index);
+            if (nxt_slow_path(ret != NXT_OK
+                              || index > NXT_H2P_HPACK_TABLE_SIZE))
+            {
+                return NXT_ERROR;
+            }
+
+            hpack->max_size = index;
+            nxt_h2p_hpack_evict(hpack, 0);
+
+            continue;
+        }
+
+        header = nxt_array_add(headers);
+        if (nxt_slow_path(header == NULL)) {
+            return NXT_ERROR;
+        }
+
+        if (ch & 0x80) {
+            /* An indexed header field. */
+
+            ret = nxt_h2p_hpack_int(&pos, end, 7, &index);
+            if (nxt_slow_path(ret != NXT_OK || index == 0)) {
+                return NXT_ERROR;
+            }
+
+            ret = nxt_h2p_hpack_index(hpack, mp, index, header);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+
+            continue;
+        }
+
+        /*
+         * A literal header field with incremental indexing,
+         * without indexing, or never indexed.
+         */
+
+        ret = nxt_h2p_hpack_int(&pos, end, (ch & 0x40) ? 6 : 4, &index);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        if (index != 0) {
+            ret = nxt_h2p_hpack_index(hpack, mp, index, header);
+
+        } else {
+            ret = nxt_h2p_hpack_string(&pos, end, mp, &header->name);
+        }
+
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        ret = nxt_h2p_hpack_string(&pos, end, mp, &header->value);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        if (ch & 0x40) {
+            ret = nxt_h2p_hpack_add(hpack, header);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+        }
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_h2p_hpack_int(u_char **pos, u_char *end, nxt_uint_t prefix,
+    uint32_t *value)
+{
+    u_char      *p, ch;
+    uint32_t    v, mask;
+    nxt_uint_t  shift;
+
+    p = *pos;
+
+    if (nxt_slow_path(p == end)) {
+        return NXT_ERROR;
+    }
+
+    mask = (1 << prefix) - 1;
+    v = *p++ & mask;
+
+    if (v == mask) {
+        shift = 0;
+
+        do {
+            if (nxt_slow_path(p == end || shift > 21)) {
+                return NXT_ERROR;
+            }
+
+            ch = *p++;
+            v += (uint32_t) (ch & 0x7f) << shift;
+            shift += 7;
+
+        } while (ch & 0x80);
+    }
+
+    *pos = p;
+    *value = v;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_h2p_hpack_string(u_char **pos, u_char *end, nxt_mp_t *mp, nxt_str_t *str)
+{
+    u_char      *p, *dst;
+    uint32_t    size;
+    nxt_int_t   ret;
+    nxt_bool_t  huffman;
+
+    p = *pos;
+
+    if (nxt_slow_path(p == end)) {
+        return NXT_ERROR;
+    }
+
+    huffman = (*p & 0x80) != 0;
+
+    ret = nxt_h2p_hpack_int(&p, end, 7, &size);
+    if (nxt_slow_path(ret != NXT_OK || size > (size_t) (end - p))) {
+        return NXT_ERROR;
+    }
+
+    if (huffman) {
+        /* The shortest Huffman code is 5 bits long. */
+        dst = nxt_mp_nget(mp, size * 8 / 5 + 1);
+        if (nxt_slow_path(dst == NULL)) {
+            return NXT_ERROR;
+        }
+
+        str->start = dst;
+
+        dst = nxt_h2p_huff_decode(p, size, dst);
+        if (nxt_slow_path(dst == NULL)) {
+            return NXT_ERROR;
+        }
+
+        str->length = dst - str->start;
+
+    } else {
+        /* The string stays in the header block till the block is processed. */
+        str->start = p;
+        str->length = size;
+    }
+
+    *pos = p + size;
+
+    return NXT_OK;
+}
+
+
+static u_char *
+nxt_h2p_huff_decode(u_char *p, size_t size, u_char *dst)
+{
+    u_char      *end, ch;
+    int16_t     next;
+    nxt_uint_t  i, bit, node, bits, ones;
+
+    node = 0;
+    bits = 0;
+    ones = 1;
+
+    for (end = p + size; p < end; p++) {
+        ch = *p;
+
+        for (i = 8; i != 0; i--) {
+            bit = (ch >> (i - 1)) & 1;
+
+            next = nxt_h2p_huff_tree[node][bit];
+
+            if (next < 0) {
+                next = -next - 1;
+
+                if (nxt_slow_path(next == 256)) {
+                    /* EOS. */
+                    return NULL;
+                }
+
+                *dst++ = (u_char) next;
+
+                node = 0;
+                bits = 0;
+                ones = 1;
+
+                continue;
+            }
+
+            if (nxt_slow_path(next == 0)) {
+                return NULL;
+            }
+
+            node = next;
+            bits++;
+            ones &= bit;
+        }
+    }
+
+    /* The padding is the most significant bits of EOS, up to 7 ones. */
+
+    if (nxt_slow_path(bits > 7 || !ones)) {
+        return NULL;
+    }
+
+    return dst;
+}
+
+
+static nxt_int_t
+nxt_h2p_hpack_index(nxt_h2p_hpack_t *hpack, nxt_mp_t *mp, uint32_t index,
+    nxt_h2p_header_t *header)
+{
+    u_char                 *p;
+    nxt_h2p_hpack_entry_t  *entry;
+
+    if (index <= nxt_nitems(nxt_h2p_hpack_static)) {
+        *header = nxt_h2p_hpack_static[index - 1];
+        return NXT_OK;
+    }
+
+    index -= nxt_nitems(nxt_h2p_hpack_static) + 1;
+
+    if (nxt_slow_path(index >= hpack->count)) {
+        return NXT_ERROR;
+    }
+
+    entry = hpack->entries[(hpack->head + NXT_H2P_HPACK_ENTRIES - index)
+                           % NXT_H2P_HPACK_ENTRIES];
+
+    /*
+     * The entry is copied since it can be evicted
+     * while the rest of the header block is decoded.
+     */
+
+    p = nxt_mp_nget(mp, entry->name_length + entry->value_length);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_memcpy(p, entry->data, entry->name_length + entry->value_length);
+
+    header->name.start = p;
+    header->name.length = entry->name_length;
+    header->value.start = p + entry->name_length;
+    header->value.length = entry->value_length;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_h2p_hpack_add(nxt_h2p_hpack_t *hpack, nxt_h2p_header_t *header)
+{
+    u_char                 *p;
+    size_t                 size;
+    nxt_h2p_hpack_entry_t  *entry;
+
+    /* RFC 7541, 4.1: 32 bytes is an estimated overhead of an entry. */
+    size = header->name.length + header->value.length + 32;
+
+    if (size > hpack->max_size) {
+        nxt_h2p_hpack_evict(hpack, hpack->max_size);
+        return NXT_OK;
+    }
+
+    entry = nxt_mp_alloc(hpack->mem_pool, sizeof(nxt_h2p_hpack_entry_t)
+                                          + header->name.length
+                                          + header->value.length);
+    if (nxt_slow_path(entry == NULL)) {
+        return NXT_ERROR;
+    }
+
+    entry->size = size;
+    entry->name_length = header->name.length;
+    entry->value_length = header->value.length;
+
+    p = nxt_cpymem(entry->data, header->name.start, header->name.length);
+    nxt_memcpy(p, header->value.start, header->value.length);
+
+    nxt_h2p_hpack_evict(hpack, size);
+
+    hpack->head = (hpack->head + 1) % NXT_H2P_HPACK_ENTRIES;
+    hpack->entries[hpack->head] = entry;
+    hpack->count++;
+    hpack->size += size;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_h2p_hpack_evict(nxt_h2p_hpack_t *hpack, size_t size)
+{
+    nxt_uint_t             oldest;
+    nxt_h2p_hpack_entry_t  *entry;
+
+    while (hpack->count != 0 && hpack->size + size > hpack->max_size) {
+        oldest = (hpack->head + NXT_H2P_HPACK_ENTRIES - (hpack->count - 1))
+                 % NXT_H2P_HPACK_ENTRIES;
+
+        entry = hpack->entries[oldest];
+
+        hpack->size -= entry->size;
+        hpack->count--;
+
+        nxt_mp_free(hpack->mem_pool, entry);
+    }
+}
+
+
+void
+nxt_h2p_hpack_free(nxt_h2p_hpack_t *hpack)
+{
+    hpack->max_size = 0;
+
+    nxt_h2p_hpack_evict(hpack, 0);
+}
+
+
+u_char *
+nxt_h2p_hpack_status(u_char *p, nxt_uint_t status)
+{
+    nxt_uint_t  i;
+
+    static const uint16_t  indexed[] = { 200, 204, 206, 304, 400, 404, 500 };
+
+    for (i = 0; i < nxt_nitems(indexed); i++) {
+        if (status == indexed[i]) {
+            /* The static table indexes 8 - 14. */
+            *p++ = 0x80 | (8 + i);
+            return p;
+        }
+    }
+
+    /* A literal without indexing with the ":status" name index 8. */
+    *p++ = 0x08;
+    *p++ = 3;
+
+    return nxt_sprintf(p, p + 3, "%ui", status);
+}
+
+
+/*
+ * The worst case field size is a literal without indexing with new name:
+ * 1 byte of representation and two strings with length prefixes.
+ */
+
+size_t
+nxt_h2p_hpack_field_size(nxt_http_field_t *field)
+{
+    return 1 + 2 * NXT_H2P_HPACK_INT_LEN
+           + field->name_length + field->value_length;
+}
+
+
+u_char *
+nxt_h2p_hpack_field(u_char *p, nxt_http_field_t *field)
+{
+    nxt_uint_t              i;
+    const nxt_h2p_header_t  *h;
+
+    /* The pseudo-header fields and the ":status" ones are skipped. */
+
+    for (i = 15; i < nxt_nitems(nxt_h2p_hpack_static); i++) {
+        h = &nxt_h2p_hpack_static[i];
+
+        if (h->name.length == field->name_length
+            && nxt_memcasecmp(h->name.start, field->name,
+                              field->name_length) == 0)
+        {
+            /* A literal without indexing with an indexed name. */
+            *p = 0;
+            p = nxt_h2p_hpack_int_put(p, 4, i + 1);
+
+            goto value;
+        }
+    }
+
+    /* A literal without indexing with a new name. */
+    *p++ = 0;
+
+    *p = 0;
+    p = nxt_h2p_hpack_int_put(p, 7, field->name_length);
+
+    nxt_memcpy_lowcase(p, field->name, field->name_length);
+    p += field->name_length;
+
+value:
+
+    *p = 0;
+    p = nxt_h2p_hpack_int_put(p, 7, field->value_length);
+
+    return nxt_cpymem(p, field->value, field->value_length);
+}
+
+
+static u_char *
+nxt_h2p_hpack_int_put(u_char *p, nxt_uint_t prefix, uint32_t value)
+{
+    uint32_t  mask;
+
+    mask = (1 << prefix) - 1;
+
+    if (value < mask) {
+        *p++ |= value;
+        return p;
+    }
+
+    *p++ |= mask;
+    value -= mask;
+
+    while (value >= 0x80) {
+        *p++ = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+
+    *p++ = value;
+
+    return p;
+}
@@ -19,6 +19,7 @@ typedef enum {
 
     NXT_HTTP_OK = 200,
     NXT_HTTP_NO_CONTENT = 204,
+    NXT_HTTP_PARTIAL_CONTENT = 206,
 
     NXT_HTTP_MULTIPLE_CHOICES = 300,
     NXT_HTTP_MOVED_PERMANENTLY = 301,
@@ -34,8 +35,10 @@ typedef enum {
     NXT_HTTP_METHOD_NOT_ALLOWED = 405,
     NXT_HTTP_REQUEST_TIMEOUT = 408,
     NXT_HTTP_LENGTH_REQUIRED = 411,
+    NXT_HTTP_PRECONDITION_FAILED = 412,
     NXT_HTTP_PAYLOAD_TOO_LARGE = 413,
     NXT_HTTP_URI_TOO_LONG = 414,
+    NXT_HTTP_RANGE_NOT_SATISFIABLE = 416,
     NXT_HTTP_UPGRADE_REQUIRED = 426,
     NXT_HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
 
@@ -60,6 +63,15 @@ typedef enum {
 } nxt_http_te_t;
 
 
+typedef enum {
+    NXT_HTTP_BODY_INITIAL = 0,
+    /* The body is left unread until an action takes it. */
+    NXT_HTTP_BODY_DEFERRED,
+    NXT_HTTP_BODY_READ,
+    NXT_HTTP_BODY_STREAMED,
+} nxt_http_body_state_t;
+
+
 typedef enum {
     NXT_HTTP_PROTO_H1 = 0,
     NXT_HTTP_PROTO_H2,
@@ -74,6 +86,7 @@ typedef struct {
 
 
 typedef struct nxt_h1proto_s        nxt_h1proto_t;
+typedef struct nxt_h2proto_s        nxt_h2proto_t;
 
 struct nxt_h1p_websocket_timer_s {
     nxt_timer_t                     timer;
@@ -85,6 +98,7 @@ struct nxt_h1p_websocket_timer_s {
 typedef union {
     void                            *any;
     nxt_h1proto_t                   *h1;
+    nxt_h2proto_t                   *h2;
 } nxt_http_proto_t;
 
 
@@ -104,6 +118,11 @@ typedef union {
     } while (0)
 
 
+#define nxt_http_field_name_is(_field, _name)                                 \
+    ((_field)->name_length == nxt_length(_name)                               \
+     && nxt_memcasecmp((_field)->name, _name, nxt_length(_name)) == 0)
+
+
 typedef struct {
     nxt_list_t                      *fields;
     nxt_http_field_t                *date;
@@ -113,7 +132,11 @@ typedef struct {
 } nxt_http_response_t;
 
 
-typedef struct nxt_upstream_server_s  nxt_upstream_server_t;
+typedef struct nxt_upstream_server_s     nxt_upstream_server_t;
+typedef struct nxt_http_compress_conf_s  nxt_http_compress_conf_t;
+typedef struct nxt_http_compress_s       nxt_http_compress_t;
+typedef struct nxt_http_cache_conf_s     nxt_http_cache_conf_t;
+typedef struct nxt_http_cache_s          nxt_http_cache_t;
 
 typedef struct {
     nxt_http_proto_t                proto;
@@ -126,6 +149,8 @@ typedef struct {
     nxt_http_protocol_t             protocol:8;       /* 2 bits */
     uint8_t                         header_received;  /* 1 bit  */
     uint8_t                         closed;           /* 1 bit  */
+    uint8_t                         reused;           /* 1 bit  */
+    uint8_t                         connected;        /* 1 bit  */
 } nxt_http_peer_t;
 
 
@@ -157,6 +182,13 @@ struct nxt_http_request_s {
     nxt_http_field_t                *referer;
     nxt_http_field_t                *user_agent;
     nxt_http_field_t                *authorization;
+    nxt_http_field_t                *if_match;
+    nxt_http_field_t                *if_none_match;
+    nxt_http_field_t                *if_modified_since;
+    nxt_http_field_t                *if_unmodified_since;
+    nxt_http_field_t                *if_range;
+    nxt_http_field_t                *range;
+    nxt_http_field_t                *accept_encoding;
     nxt_off_t                       content_length_n;
 
     nxt_sockaddr_t                  *remote;
@@ -166,10 +198,14 @@ struct nxt_http_request_s {
 
     nxt_timer_t                     timer;
     void                            *timer_data;
+    /* The time limit of waiting for an application process. */
+    nxt_timer_t                     queue_timer;
 
     nxt_var_query_t                 *var_query;
 
     void                            *req_rpc_data;
+    /* nxt_router_file_reader_t. */
+    void                            *file_reader;
 
 #if (NXT_HAVE_REGEX)
     nxt_regex_match_t               *regex_match;
@@ -178,12 +214,21 @@ struct nxt_http_request_s {
     nxt_http_peer_t                 *peer;
     nxt_buf_t                       *last;
 
-    nxt_queue_link_t                app_link;   /* nxt_app_t.ack_waiting_req */
+    nxt_http_compress_conf_t        *compress;
+    nxt_http_compress_t             *compressor;
+    nxt_http_cache_t                *cache;
+
+    nxt_queue_link_t                app_link;   /* engine->ack_waiting_req */
     nxt_event_engine_t              *engine;
     nxt_work_t                      err_work;
 
     nxt_http_response_t             resp;
 
+    /* The monotonic time of the request and of its upstream response. */
+    nxt_nsec_t                      start;
+    nxt_nsec_t                      upstream_start;
+    nxt_nsec_t                      upstream_end;
+
     nxt_http_status_t               status:16;
 
     uint8_t                         pass_count;   /* 8 bits */
@@ -194,6 +239,8 @@ struct nxt_http_request_s {
     uint8_t                         inconsistent; /* 1 bit  */
     uint8_t                         error;        /* 1 bit  */
     uint8_t                         websocket_handshake;  /* 1 bit */
+    nxt_http_body_state_t           body_state:8;         /* 2 bits */
+    uint8_t                         ktls;                 /* 1 bit */
 };
 
 
@@ -212,6 +259,9 @@ typedef struct {
     nxt_conf_value_t                *follow_symlinks;
     nxt_conf_value_t                *traverse_mounts;
     nxt_conf_value_t                *types;
+    nxt_conf_value_t                *precompressed;
+    nxt_conf_value_t                *compress;
+    nxt_conf_value_t                *cache;
     nxt_conf_value_t                *fallback;
 } nxt_http_action_conf_t;
 
@@ -230,16 +280,21 @@ struct nxt_http_action_s {
 
     nxt_str_t                       name;
     nxt_http_action_t               *fallback;
+    nxt_http_compress_conf_t        *compress;
+    nxt_http_cache_conf_t           *cache;
 };
 
 
 typedef struct {
     void (*body_read)(nxt_task_t *task, nxt_http_request_t *r);
+    nxt_int_t (*body_stream)(nxt_task_t *task, nxt_http_request_t *r,
+        nxt_fd_t *fd);
     void (*local_addr)(nxt_task_t *task, nxt_http_request_t *r);
     void (*header_send)(nxt_task_t *task, nxt_http_request_t *r,
          nxt_work_handler_t body_handler, void *data);
     void (*send)(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out);
     nxt_off_t (*body_bytes_sent)(nxt_task_t *task, nxt_http_proto_t proto);
+    nxt_off_t (*bytes_received)(nxt_task_t *task, nxt_http_proto_t proto);
     void (*discard)(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *last);
     void (*close)(nxt_task_t *task, nxt_http_proto_t proto,
         nxt_socket_conf_joint_t *joint);
@@ -284,13 +339,18 @@ nxt_http_date(u_char *buf, struct tm *tm)
 
 nxt_int_t nxt_http_init(nxt_task_t *task);
 nxt_int_t nxt_h1p_init(nxt_task_t *task);
+nxt_int_t nxt_h2p_init(nxt_task_t *task);
 nxt_int_t nxt_http_response_hash_init(nxt_task_t *task);
 
 void nxt_http_conn_init(nxt_task_t *task, void *obj, void *data);
 nxt_http_request_t *nxt_http_request_create(nxt_task_t *task);
 void nxt_http_request_error(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_status_t status);
+void nxt_http_request_error_retry(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_status_t status, nxt_uint_t retry_after);
 void nxt_http_request_read_body(nxt_task_t *task, nxt_http_request_t *r);
+nxt_int_t nxt_http_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_fd_t *fd);
 void nxt_http_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_work_handler_t body_handler, void *data);
 void nxt_http_request_ws_frame_start(nxt_task_t *task, nxt_http_request_t *r,
@@ -302,6 +362,7 @@ nxt_buf_t *nxt_http_buf_mem(nxt_task_t *task, nxt_http_request_t *r,
 nxt_buf_t *nxt_http_buf_last(nxt_http_request_t *r);
 void nxt_http_request_error_handler(nxt_task_t *task, void *obj, void *data);
 void nxt_http_request_close_handler(nxt_task_t *task, void *obj, void *data);
+nxt_bool_t nxt_http_accept_encoding(nxt_http_request_t *r, nxt_str_t *coding);
 
 nxt_int_t nxt_http_request_host(void *ctx, nxt_http_field_t *field,
     uintptr_t data);
@@ -338,6 +399,8 @@ nxt_int_t nxt_upstreams_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_conf_value_t *conf);
 nxt_int_t nxt_upstreams_joint_create(nxt_router_temp_conf_t *tmcf,
     nxt_upstream_t ***upstream_joint);
+void nxt_upstream_health_checks_start(nxt_task_t *task,
+    nxt_upstreams_t *upstreams);
 
 nxt_int_t nxt_http_return_init(nxt_mp_t *mp, nxt_http_action_t *action,
     nxt_http_action_conf_t *acf);
@@ -349,6 +412,24 @@ nxt_int_t nxt_http_static_mtypes_hash_add(nxt_mp_t *mp, nxt_lvlhsh_t *hash,
     nxt_str_t *exten, nxt_str_t *type);
 nxt_str_t *nxt_http_static_mtype_get(nxt_lvlhsh_t *hash, nxt_str_t *exten);
 
+#if (NXT_HAVE_ZLIB)
+nxt_int_t nxt_http_compress_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf);
+nxt_int_t nxt_http_compress_start(nxt_task_t *task, nxt_http_request_t *r);
+nxt_buf_t *nxt_http_compress_filter(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *in);
+#endif
+
+nxt_int_t nxt_http_cache_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf);
+nxt_http_action_t *nxt_http_cache_handler(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_action_t *action);
+nxt_int_t nxt_http_cache_header(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_bool_t body);
+void nxt_http_cache_body(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *out);
+void nxt_http_cache_close(nxt_task_t *task, nxt_http_request_t *r);
+
 nxt_http_action_t *nxt_http_application_handler(nxt_task_t *task,
     nxt_http_request_t *r, nxt_http_action_t *action);
 nxt_int_t nxt_upstream_find(nxt_upstreams_t *upstreams, nxt_str_t *name,
@@ -370,6 +451,7 @@ void nxt_http_proxy_buf_mem_free(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *b);
 
 extern nxt_time_string_t  nxt_http_date_cache;
+extern nxt_cache_conf_t    nxt_http_cache_default_conf;
 
 extern nxt_lvlhsh_t                        nxt_response_fields_hash;
 
@@ -382,6 +464,26 @@ void nxt_h1p_websocket_frame_start(nxt_task_t *task, nxt_http_request_t *r,
 void nxt_h1p_complete_buffers(nxt_task_t *task, nxt_h1proto_t *h1p,
     nxt_bool_t all);
 nxt_msec_t nxt_h1p_conn_request_timer_value(nxt_conn_t *c, uintptr_t data);
+void nxt_h1p_closing(nxt_task_t *task, nxt_conn_t *c);
+
+nxt_bool_t nxt_h2p_preface_test(nxt_buf_mem_t *bm);
+void nxt_h2p_conn_init(nxt_task_t *task, nxt_conn_t *c);
+void nxt_h2p_request_body_read(nxt_task_t *task, nxt_http_request_t *r);
+nxt_int_t nxt_h2p_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_fd_t *fd);
+void nxt_h2p_request_local_addr(nxt_task_t *task, nxt_http_request_t *r);
+void nxt_h2p_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_work_handler_t body_handler, void *data);
+void nxt_h2p_request_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *out);
+nxt_off_t nxt_h2p_request_body_bytes_sent(nxt_task_t *task,
+    nxt_http_proto_t proto);
+nxt_off_t nxt_h2p_request_bytes_received(nxt_task_t *task,
+    nxt_http_proto_t proto);
+void nxt_h2p_request_discard(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *last);
+void nxt_h2p_request_close(nxt_task_t *task, nxt_http_proto_t proto,
+    nxt_socket_conf_joint_t *joint);
 
 extern const nxt_conn_state_t  nxt_h1p_idle_close_state;
 
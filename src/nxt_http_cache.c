@@ -0,0 +1,1294 @@
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+
+
+#define NXT_HTTP_CACHE_CHUNK_SIZE  16384
+#define NXT_HTTP_CACHE_BUF_COUNT   2
+#define NXT_HTTP_CACHE_BUF_SIZE    (64 * 1024)
+
+
+struct nxt_http_cache_conf_s {
+    /* A prefix that separates responses of different destinations. */
+    nxt_str_t                   zone;
+    nxt_var_t                   *key;
+    nxt_time_t                  valid;
+};
+
+
+typedef struct nxt_http_cache_chunk_s  nxt_http_cache_chunk_t;
+
+struct nxt_http_cache_chunk_s {
+    nxt_http_cache_chunk_t      *next;
+    u_char                      *start;
+    u_char                      *free;
+    u_char                      *end;
+};
+
+
+/*
+ * A response is stored in memory allocated outside of request pools,
+ * so it outlives the request that has stored it.  If the cache has
+ * a "path", the body is stored in an unlinked temporary file instead.
+ */
+
+typedef struct {
+    nxt_cache_node_t            node;
+
+    nxt_http_status_t           status;
+    nxt_uint_t                  nfields;
+    nxt_http_field_t            *fields;
+
+    nxt_off_t                   body_size;
+    nxt_http_cache_chunk_t      *body;
+    nxt_http_cache_chunk_t      *last;
+
+    nxt_fd_t                    fd;
+} nxt_http_cache_node_t;
+
+
+struct nxt_http_cache_s {
+    nxt_cache_query_t           query;
+    nxt_str_t                   key;
+    nxt_http_action_t           *action;
+    nxt_cache_conf_t            *conf;
+    nxt_cache_t                 *shared;
+
+    /* The position of the next read of a body stored in a file. */
+    nxt_off_t                   pos;
+
+    /* A valid node the response is sent from. */
+    nxt_http_cache_node_t       *hit;
+    /* An updating node the response is stored to. */
+    nxt_http_cache_node_t       *update;
+
+    /* Limits the wait for an updating node. */
+    nxt_timer_t                 timer;
+
+    uint8_t                     waiting;  /* 1 bit */
+};
+
+
+typedef struct {
+    nxt_str_t                   key;
+    int32_t                     valid;
+} nxt_http_cache_conf_map_t;
+
+
+static void nxt_http_cache_release(nxt_task_t *task, void *obj, void *data);
+static void nxt_http_cache_key_ready(nxt_task_t *task, void *obj, void *data);
+static void nxt_http_cache_key_error(nxt_task_t *task, void *obj, void *data);
+static void nxt_http_cache_wakeup(nxt_task_t *task, void *obj, void *data);
+static void nxt_http_cache_lock_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_timer_stop(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache);
+static void nxt_http_cache_timer_release(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache);
+static void nxt_http_cache_body_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_buf_completion(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_file_body(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_node_t *node);
+static void nxt_http_cache_file_completion(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_time_t nxt_http_cache_valid(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache);
+static nxt_bool_t nxt_http_cache_control(nxt_http_field_t *field,
+    nxt_int_t *max_age, nxt_int_t *s_maxage);
+static nxt_bool_t nxt_http_cache_field_stored(nxt_http_field_t *field);
+static nxt_int_t nxt_http_cache_append(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_cache_t *cache, u_char *p, size_t size);
+static nxt_int_t nxt_http_cache_write(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache, u_char *p, size_t size);
+static void nxt_http_cache_update(nxt_task_t *task, nxt_http_cache_t *cache);
+static void nxt_http_cache_pass(nxt_task_t *task, nxt_http_cache_t *cache);
+static void nxt_http_cache_cancel(nxt_task_t *task, nxt_http_cache_t *cache);
+static void nxt_http_cache_node_free(nxt_task_t *task, nxt_cache_node_t *node);
+
+
+static const nxt_http_request_state_t  nxt_http_cache_send_state;
+
+
+nxt_cache_conf_t  nxt_http_cache_default_conf = {
+    .max_size = 10 * 1024 * 1024,
+    .max_entry_size = 1024 * 1024,
+    .lock_timeout = 5000,
+    .path = nxt_null_string,
+};
+
+
+static nxt_conf_map_t  nxt_http_cache_conf[] = {
+    {
+        nxt_string("key"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_http_cache_conf_map_t, key),
+    },
+
+    {
+        nxt_string("valid"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_cache_conf_map_t, valid),
+    },
+};
+
+
+nxt_int_t
+nxt_http_cache_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf)
+{
+    u_char                     *p;
+    nxt_mp_t                   *mp;
+    nxt_int_t                  ret;
+    nxt_str_t                  name;
+    nxt_cache_t                *cache;
+    nxt_router_t               *router;
+    nxt_http_cache_conf_t      *conf;
+    nxt_http_cache_conf_map_t  map;
+
+    nxt_str_set(&map.key, "$host$request_uri");
+    map.valid = 0;
+
+    ret = nxt_conf_map_object(tmcf->mem_pool, acf->cache, nxt_http_cache_conf,
+                              nxt_nitems(nxt_http_cache_conf), &map);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    mp = tmcf->router_conf->mem_pool;
+
+    /*
+     * The cache is shared by all engines and by the configurations that
+     * use it, so it survives reconfiguration.  It is destroyed when
+     * the last configuration using it is released.
+     */
+
+    router = tmcf->router_conf->router;
+
+    cache = NULL;
+
+    nxt_thread_spin_lock(&router->lock);
+
+    if (router->http_cache == NULL) {
+        nxt_thread_spin_unlock(&router->lock);
+
+        cache = nxt_cache_create(sizeof(nxt_http_cache_node_t),
+                                 nxt_http_cache_node_free);
+        if (nxt_slow_path(cache == NULL)) {
+            return NXT_ERROR;
+        }
+
+        nxt_thread_spin_lock(&router->lock);
+
+        if (router->http_cache == NULL) {
+            router->http_cache = cache;
+            cache = NULL;
+        }
+    }
+
+    router->http_cache_count++;
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    if (cache != NULL) {
+        nxt_cache_destroy(task, cache);
+    }
+
+    ret = nxt_mp_cleanup(mp, nxt_http_cache_release, task, tmcf->router_conf,
+                         router);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_http_cache_release(task, tmcf->router_conf, router);
+        return NXT_ERROR;
+    }
+
+    conf = nxt_mp_zget(mp, sizeof(nxt_http_cache_conf_t));
+    if (nxt_slow_path(conf == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->key = nxt_var_compile(&map.key, mp);
+    if (nxt_slow_path(conf->key == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->valid = map.valid;
+
+    nxt_conf_get_string((acf->proxy != NULL) ? acf->proxy : acf->pass, &name);
+
+    p = nxt_mp_nget(mp, name.length + 1);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->zone.start = p;
+    conf->zone.length = name.length + 1;
+
+    p = nxt_cpymem(p, name.start, name.length);
+    *p = ' ';
+
+    action->cache = conf;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_http_cache_release(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_cache_t   *cache;
+    nxt_router_t  *router;
+
+    router = data;
+    cache = NULL;
+
+    nxt_thread_spin_lock(&router->lock);
+
+    if (--router->http_cache_count == 0) {
+        cache = router->http_cache;
+        router->http_cache = NULL;
+    }
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    if (cache != NULL) {
+        nxt_debug(task, "http cache destroy");
+
+        nxt_cache_destroy(task, cache);
+    }
+}
+
+
+nxt_http_action_t *
+nxt_http_cache_handler(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_action_t *action)
+{
+    nxt_int_t         ret;
+    nxt_http_cache_t  *cache;
+
+    if ((!nxt_str_eq(r->method, "GET", 3) && !nxt_str_eq(r->method, "HEAD", 4))
+        || r->authorization != NULL)
+    {
+        return action->handler(task, r, action);
+    }
+
+    cache = nxt_mp_zget(r->mem_pool, sizeof(nxt_http_cache_t));
+    if (nxt_slow_path(cache == NULL)) {
+        goto fail;
+    }
+
+    ret = nxt_var_query_init(&r->var_query, r, r->mem_pool);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        goto fail;
+    }
+
+    cache->action = action;
+    r->cache = cache;
+
+    nxt_var_query(task, r->var_query, action->cache->key, &cache->key);
+    nxt_var_query_resolve(task, r->var_query, cache,
+                          nxt_http_cache_key_ready,
+                          nxt_http_cache_key_error);
+    return NULL;
+
+fail:
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+    return NULL;
+}
+
+
+static void
+nxt_http_cache_key_ready(nxt_task_t *task, void *obj, void *data)
+{
+    u_char                 *p;
+    nxt_int_t              ret;
+    nxt_router_conf_t      *rtcf;
+    nxt_cache_query_t      *q;
+    nxt_http_cache_t       *cache;
+    nxt_event_engine_t     *engine;
+    nxt_http_request_t     *r;
+    nxt_http_cache_conf_t  *conf;
+
+    r = obj;
+    cache = data;
+    conf = cache->action->cache;
+    q = &cache->query;
+
+    q->key.length = conf->zone.length + cache->key.length;
+
+    p = nxt_mp_nget(r->mem_pool, q->key.length);
+    if (nxt_slow_path(p == NULL)) {
+        goto fail;
+    }
+
+    q->key.start = p;
+
+    p = nxt_cpymem(p, conf->zone.start, conf->zone.length);
+    nxt_memcpy(p, cache->key.start, cache->key.length);
+
+    q->handler = nxt_http_cache_wakeup;
+    q->task = &r->task;
+    q->obj = r;
+    q->data = cache;
+
+    /* A response to HEAD has no body to store. */
+    q->update = nxt_str_eq(r->method, "GET", 3);
+
+    rtcf = r->conf->socket_conf->router_conf;
+
+    cache->shared = rtcf->router->http_cache;
+    cache->conf = (rtcf->http_cache != NULL) ? rtcf->http_cache
+                                             : &nxt_http_cache_default_conf;
+
+    ret = nxt_cache_query(task, cache->shared, cache->conf, q);
+
+    switch (ret) {
+
+    case NXT_OK:
+        cache->hit = (nxt_http_cache_node_t *) q->node;
+
+        nxt_http_cache_send(task, r, cache);
+        return;
+
+    case NXT_DECLINED:
+        cache->update = (nxt_http_cache_node_t *) q->node;
+
+        if (cache->update != NULL) {
+            cache->update->fd = -1;
+        }
+
+        nxt_http_request_action(task, r, cache->action);
+        return;
+
+    case NXT_AGAIN:
+        /* The request pool is retained until the query handler is called. */
+        cache->waiting = 1;
+        nxt_mp_retain(r->mem_pool);
+
+        if (cache->conf->lock_timeout != 0) {
+            engine = task->thread->engine;
+
+            cache->timer.task = &engine->task;
+            cache->timer.work_queue = &engine->fast_work_queue;
+            cache->timer.log = engine->task.log;
+            cache->timer.bias = NXT_TIMER_DEFAULT_BIAS;
+            cache->timer.handler = nxt_http_cache_lock_timeout;
+
+            nxt_timer_add(engine, &cache->timer, cache->conf->lock_timeout);
+        }
+
+        return;
+
+    default:
+        break;
+    }
+
+fail:
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+}
+
+
+static void
+nxt_http_cache_key_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_request_t  *r;
+
+    r = obj;
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+}
+
+
+static void
+nxt_http_cache_wakeup(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_cache_node_t    *node;
+    nxt_http_cache_t    *cache;
+    nxt_http_request_t  *r;
+
+    r = obj;
+    cache = data;
+    node = cache->query.node;
+
+    cache->waiting = 0;
+
+    nxt_http_cache_timer_stop(task, r, cache);
+
+    if (r->proto.any == NULL) {
+        nxt_debug(task, "http cache wakeup: request closed");
+
+        if (node != NULL) {
+            nxt_cache_release(task, cache->shared, node);
+        }
+
+        nxt_mp_release(r->mem_pool);
+        return;
+    }
+
+    nxt_mp_release(r->mem_pool);
+
+    if (node != NULL) {
+        cache->hit = (nxt_http_cache_node_t *) node;
+
+        nxt_http_cache_send(task, r, cache);
+        return;
+    }
+
+    /* The update has been cancelled, so the response is not stored. */
+
+    nxt_http_request_action(task, r, cache->action);
+}
+
+
+/*
+ * A request that has waited for an updating node longer than
+ * "lock_timeout" is passed to the origin and its response is not stored.
+ */
+
+static void
+nxt_http_cache_lock_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t         *timer;
+    nxt_http_cache_t    *cache;
+    nxt_http_request_t  *r;
+
+    timer = obj;
+
+    cache = nxt_timer_data(timer, nxt_http_cache_t, timer);
+    r = cache->query.obj;
+
+    if (!nxt_cache_query_cancel(cache->shared, &cache->query)) {
+        /* The query handler has already been scheduled. */
+        return;
+    }
+
+    nxt_debug(task, "http cache lock timeout");
+
+    cache->waiting = 0;
+    nxt_mp_release(r->mem_pool);
+
+    nxt_http_request_action(task, r, cache->action);
+}
+
+
+/*
+ * The engine refers to a deleted timer until the change is committed,
+ * so the request pool is released by the timer itself, as the router does.
+ */
+
+static void
+nxt_http_cache_timer_stop(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache)
+{
+    nxt_event_engine_t  *engine;
+
+    if (!cache->timer.enabled
+        || cache->timer.handler != nxt_http_cache_lock_timeout)
+    {
+        return;
+    }
+
+    engine = task->thread->engine;
+
+    if (nxt_timer_delete(engine, &cache->timer)) {
+        nxt_mp_retain(r->mem_pool);
+
+        cache->timer.handler = nxt_http_cache_timer_release;
+        nxt_timer_add(engine, &cache->timer, 0);
+    }
+}
+
+
+static void
+nxt_http_cache_timer_release(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_cache_t    *cache;
+    nxt_http_request_t  *r;
+
+    cache = nxt_timer_data(obj, nxt_http_cache_t, timer);
+    r = cache->query.obj;
+
+    nxt_debug(task, "http cache timer release");
+
+    nxt_mp_release(r->mem_pool);
+}
+
+
+static void
+nxt_http_cache_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache)
+{
+    nxt_uint_t             i;
+    nxt_http_field_t       *field;
+    nxt_work_handler_t     body_handler;
+    nxt_http_cache_node_t  *node;
+
+    node = cache->hit;
+
+    r->status = node->status;
+
+    for (i = 0; i < node->nfields; i++) {
+        field = nxt_list_add(r->resp.fields);
+        if (nxt_slow_path(field == NULL)) {
+            nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+            return;
+        }
+
+        *field = node->fields[i];
+    }
+
+    r->resp.content_length_n = node->body_size;
+
+    if (node->body_size != 0 && !nxt_str_eq(r->method, "HEAD", 4)) {
+        body_handler = nxt_http_cache_body_handler;
+
+    } else {
+        body_handler = NULL;
+    }
+
+    r->state = &nxt_http_cache_send_state;
+
+    nxt_http_request_header_send(task, r, body_handler, node);
+}
+
+
+static const nxt_http_request_state_t  nxt_http_cache_send_state
+    nxt_aligned(64) =
+{
+    .error_handler = nxt_http_request_error_handler,
+};
+
+
+static void
+nxt_http_cache_body_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t               *b, *out, **next;
+    nxt_http_request_t      *r;
+    nxt_http_cache_node_t   *node;
+    nxt_http_cache_chunk_t  *chunk;
+
+    r = obj;
+    node = data;
+
+    if (node->fd != -1) {
+        nxt_http_cache_file_body(task, r, node);
+        return;
+    }
+
+    out = NULL;
+    next = &out;
+
+    /* Each buffer refers to the stored body and holds the node. */
+
+    for (chunk = node->body; chunk != NULL; chunk = chunk->next) {
+        b = nxt_buf_mem_alloc(r->mem_pool, 0, 0);
+        if (nxt_slow_path(b == NULL)) {
+            goto fail;
+        }
+
+        b->mem.start = chunk->start;
+        b->mem.pos = chunk->start;
+        b->mem.free = chunk->free;
+        b->mem.end = chunk->free;
+
+        b->completion_handler = nxt_http_cache_buf_completion;
+        b->parent = r;
+        b->data = node;
+
+        nxt_cache_retain(r->cache->shared, &node->node);
+        nxt_mp_retain(r->mem_pool);
+
+        *next = b;
+        next = &b->next;
+    }
+
+    *next = nxt_http_buf_last(r);
+
+    nxt_http_request_send(task, r, out);
+
+    return;
+
+fail:
+
+    if (out != NULL) {
+        nxt_http_cache_buf_completion(task, out, r);
+    }
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+}
+
+
+static void
+nxt_http_cache_buf_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b, *next;
+    nxt_cache_t         *cache;
+    nxt_http_request_t  *r;
+
+    b = obj;
+    r = data;
+    cache = r->cache->shared;
+
+    do {
+        next = b->next;
+
+        nxt_cache_release(task, cache, b->data);
+
+        nxt_mp_free(r->mem_pool, b);
+        nxt_mp_release(r->mem_pool);
+
+        b = next;
+    } while (b != NULL);
+}
+
+
+/*
+ * A body stored in a file is sent through a few memory buffers, the next
+ * part is read when a buffer has been sent.  The request holds the node.
+ */
+
+static void
+nxt_http_cache_file_body(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_node_t *node)
+{
+    size_t            alloc;
+    nxt_buf_t         *b, **next, *out;
+    nxt_off_t         rest;
+    nxt_int_t         n;
+    nxt_work_queue_t  *wq;
+
+    r->cache->pos = 0;
+
+    rest = node->body_size;
+    out = NULL;
+    next = &out;
+    n = 0;
+
+    do {
+        alloc = nxt_min(rest, NXT_HTTP_CACHE_BUF_SIZE);
+
+        b = nxt_buf_mem_alloc(r->mem_pool, alloc, 0);
+        if (nxt_slow_path(b == NULL)) {
+            goto fail;
+        }
+
+        b->completion_handler = nxt_http_cache_file_completion;
+        b->parent = r;
+
+        nxt_mp_retain(r->mem_pool);
+
+        *next = b;
+        next = &b->next;
+
+        rest -= alloc;
+
+    } while (rest > 0 && ++n < NXT_HTTP_CACHE_BUF_COUNT);
+
+    wq = &task->thread->engine->fast_work_queue;
+
+    nxt_sendbuf_drain(task, wq, out);
+    return;
+
+fail:
+
+    while (out != NULL) {
+        b = out;
+        out = b->next;
+
+        nxt_mp_free(r->mem_pool, b);
+        nxt_mp_release(r->mem_pool);
+    }
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+}
+
+
+static void
+nxt_http_cache_file_completion(nxt_task_t *task, void *obj, void *data)
+{
+    ssize_t                n, size;
+    nxt_buf_t              *b, *next;
+    nxt_off_t              rest;
+    nxt_http_cache_t       *cache;
+    nxt_http_request_t     *r;
+    nxt_http_cache_node_t  *node;
+
+    b = obj;
+    r = data;
+    cache = r->cache;
+
+complete_buf:
+
+    node = cache->hit;
+
+    if (nxt_slow_path(node == NULL || r->error)) {
+        goto clean;
+    }
+
+    rest = node->body_size - cache->pos;
+
+    if (rest == 0) {
+        goto clean;
+    }
+
+    size = nxt_min(rest, (nxt_off_t) nxt_buf_mem_size(&b->mem));
+
+    n = pread(node->fd, b->mem.start, size, cache->pos);
+
+    if (nxt_slow_path(n != size)) {
+        nxt_alert(task, "pread(%FD, %z, %O) failed %E",
+                  node->fd, size, cache->pos, nxt_errno);
+
+        nxt_http_request_error_handler(task, r, r->proto.any);
+        goto clean;
+    }
+
+    cache->pos += n;
+
+    next = b->next;
+
+    b->next = (n == rest) ? nxt_http_buf_last(r) : NULL;
+
+    b->mem.pos = b->mem.start;
+    b->mem.free = b->mem.pos + n;
+
+    nxt_http_request_send(task, r, b);
+
+    if (next != NULL) {
+        b = next;
+        goto complete_buf;
+    }
+
+    return;
+
+clean:
+
+    do {
+        next = b->next;
+
+        nxt_mp_free(r->mem_pool, b);
+        nxt_mp_release(r->mem_pool);
+
+        b = next;
+    } while (b != NULL);
+}
+
+
+/*
+ * nxt_http_cache_header() stores the response header if the response
+ * can be cached, otherwise it cancels the update.  "body" is zero if
+ * no response body follows the header.
+ */
+
+nxt_int_t
+nxt_http_cache_header(nxt_task_t *task, nxt_http_request_t *r, nxt_bool_t body)
+{
+    u_char                 *p;
+    size_t                 size;
+    nxt_uint_t             n;
+    nxt_time_t             valid;
+    nxt_http_cache_t       *cache;
+    nxt_http_field_t       *field, *f;
+    nxt_http_cache_node_t  *node;
+
+    cache = r->cache;
+    node = cache->update;
+
+    if (node == NULL) {
+        return NXT_OK;
+    }
+
+    valid = nxt_http_cache_valid(task, r, cache);
+
+    if (valid <= 0
+        || r->resp.content_length_n > (nxt_off_t) cache->conf->max_entry_size)
+    {
+        nxt_http_cache_pass(task, cache);
+        return NXT_OK;
+    }
+
+    n = 0;
+    size = 0;
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (nxt_http_cache_field_stored(field)) {
+            n++;
+            size += field->name_length + field->value_length;
+        }
+
+    } nxt_list_loop;
+
+    size += n * sizeof(nxt_http_field_t);
+
+    p = nxt_malloc(size);
+    if (nxt_slow_path(p == NULL)) {
+        nxt_http_cache_cancel(task, cache);
+        return NXT_ERROR;
+    }
+
+    node->fields = (nxt_http_field_t *) p;
+    node->nfields = n;
+    node->node.size += size;
+
+    p += n * sizeof(nxt_http_field_t);
+    f = node->fields;
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (nxt_http_cache_field_stored(field)) {
+            *f = *field;
+
+            f->name = p;
+            p = nxt_cpymem(p, field->name, field->name_length);
+
+            f->value = p;
+            p = nxt_cpymem(p, field->value, field->value_length);
+
+            f++;
+        }
+
+    } nxt_list_loop;
+
+    node->status = r->status;
+    node->node.expiry = nxt_thread_time(task->thread) + valid;
+
+    nxt_debug(task, "http cache store: %d, valid %T", r->status, valid);
+
+    if (!body) {
+        nxt_http_cache_update(task, cache);
+    }
+
+    return NXT_OK;
+}
+
+
+/*
+ * nxt_http_cache_valid() returns the response lifetime in seconds or zero
+ * if the response must not be stored.
+ */
+
+static nxt_time_t
+nxt_http_cache_valid(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache)
+{
+    nxt_int_t         max_age, s_maxage;
+    nxt_time_t        now, expires;
+    nxt_http_field_t  *field, *expires_field;
+
+    if (r->status != NXT_HTTP_OK) {
+        return 0;
+    }
+
+    max_age = -1;
+    s_maxage = -1;
+    expires_field = NULL;
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (field->skip) {
+            continue;
+        }
+
+        if (nxt_http_field_name_is(field, "Set-Cookie")
+            || nxt_http_field_name_is(field, "Vary"))
+        {
+            return 0;
+        }
+
+        if (nxt_http_field_name_is(field, "Cache-Control")) {
+            if (!nxt_http_cache_control(field, &max_age, &s_maxage)) {
+                return 0;
+            }
+
+        } else if (nxt_http_field_name_is(field, "Expires")) {
+            expires_field = field;
+        }
+
+    } nxt_list_loop;
+
+    if (s_maxage >= 0) {
+        return s_maxage;
+    }
+
+    if (max_age >= 0) {
+        return max_age;
+    }
+
+    if (expires_field != NULL) {
+        /* An invalid date means that the response has already expired. */
+        expires = nxt_time_parse(expires_field->value,
+                                 expires_field->value_length);
+
+        now = nxt_thread_time(task->thread);
+
+        return (expires > now) ? expires - now : 0;
+    }
+
+    return cache->action->cache->valid;
+}
+
+
+/*
+ * nxt_http_cache_control() returns zero if the "Cache-Control" directives
+ * forbid a shared cache to store the response.
+ */
+
+static nxt_bool_t
+nxt_http_cache_control(nxt_http_field_t *field, nxt_int_t *max_age,
+    nxt_int_t *s_maxage)
+{
+    u_char     *p, *end, *name, *value;
+    size_t     length;
+    nxt_int_t  n;
+
+    p = field->value;
+    end = p + field->value_length;
+
+    while (p < end) {
+
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        }
+
+        name = p;
+        value = NULL;
+
+        while (p < end && *p != ',') {
+            if (*p == '=' && value == NULL) {
+                value = p + 1;
+            }
+
+            p++;
+        }
+
+        length = ((value != NULL) ? value - 1 : p) - name;
+
+        while (length != 0 && (name[length - 1] == ' '
+                               || name[length - 1] == '\t'))
+        {
+            length--;
+        }
+
+        if ((length == 8 && nxt_memcasecmp(name, "no-store", 8) == 0)
+            || (length == 8 && nxt_memcasecmp(name, "no-cache", 8) == 0)
+            || (length == 7 && nxt_memcasecmp(name, "private", 7) == 0))
+        {
+            return 0;
+        }
+
+        if (value == NULL) {
+            continue;
+        }
+
+        if (length == 7 && nxt_memcasecmp(name, "max-age", 7) == 0) {
+            n = nxt_int_parse(value, p - value);
+            if (n < 0) {
+                return 0;
+            }
+
+            *max_age = n;
+
+        } else if (length == 8 && nxt_memcasecmp(name, "s-maxage", 8) == 0) {
+            n = nxt_int_parse(value, p - value);
+            if (n < 0) {
+                return 0;
+            }
+
+            *s_maxage = n;
+        }
+    }
+
+    return 1;
+}
+
+
+/* The fields that are generated for each response are not stored. */
+
+static nxt_bool_t
+nxt_http_cache_field_stored(nxt_http_field_t *field)
+{
+    return !(field->skip
+             || nxt_http_field_name_is(field, "Date")
+             || nxt_http_field_name_is(field, "Server")
+             || nxt_http_field_name_is(field, "Content-Length")
+             || nxt_http_field_name_is(field, "Transfer-Encoding")
+             || nxt_http_field_name_is(field, "Connection")
+             || nxt_http_field_name_is(field, "Keep-Alive"));
+}
+
+
+void
+nxt_http_cache_body(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out)
+{
+    size_t            size;
+    nxt_int_t         ret;
+    nxt_buf_t         *b;
+    nxt_http_cache_t  *cache;
+
+    cache = r->cache;
+
+    if (cache->update == NULL) {
+        return;
+    }
+
+    for (b = out; b != NULL; b = b->next) {
+
+        if (nxt_buf_is_file(b)) {
+            nxt_http_cache_cancel(task, cache);
+            return;
+        }
+
+        if (nxt_buf_is_mem(b)) {
+            size = nxt_buf_mem_used_size(&b->mem);
+
+            if (size != 0) {
+                ret = nxt_http_cache_append(task, r, cache, b->mem.pos,
+                                            size);
+
+                if (ret != NXT_OK) {
+                    nxt_debug(task, "http cache: body is not stored");
+
+                    nxt_http_cache_cancel(task, cache);
+                    return;
+                }
+            }
+        }
+
+        if (nxt_buf_is_last(b)) {
+            nxt_http_cache_update(task, cache);
+            return;
+        }
+    }
+}
+
+
+static nxt_int_t
+nxt_http_cache_append(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache, u_char *p, size_t size)
+{
+    size_t                  n;
+    nxt_off_t               rest;
+    nxt_http_cache_node_t   *node;
+    nxt_http_cache_chunk_t  *chunk;
+
+    node = cache->update;
+
+    if (node->body_size + size > cache->conf->max_entry_size) {
+        return NXT_DECLINED;
+    }
+
+    if (cache->conf->path.length != 0) {
+        return nxt_http_cache_write(task, r, cache, p, size);
+    }
+
+    while (size != 0) {
+        chunk = node->last;
+
+        if (chunk == NULL || chunk->free == chunk->end) {
+            /* A body of a known length is stored in a single chunk. */
+            rest = r->resp.content_length_n - node->body_size;
+
+            n = (rest >= (nxt_off_t) size) ? (size_t) rest
+                                           : nxt_max(size,
+                                                 NXT_HTTP_CACHE_CHUNK_SIZE);
+
+            chunk = nxt_malloc(sizeof(nxt_http_cache_chunk_t) + n);
+            if (nxt_slow_path(chunk == NULL)) {
+                return NXT_ERROR;
+            }
+
+            chunk->next = NULL;
+            chunk->start = (u_char *) chunk + sizeof(nxt_http_cache_chunk_t);
+            chunk->free = chunk->start;
+            chunk->end = chunk->start + n;
+
+            if (node->last != NULL) {
+                node->last->next = chunk;
+
+            } else {
+                node->body = chunk;
+            }
+
+            node->last = chunk;
+            node->node.size += sizeof(nxt_http_cache_chunk_t) + n;
+        }
+
+        n = nxt_min(size, (size_t) (chunk->end - chunk->free));
+
+        chunk->free = nxt_cpymem(chunk->free, p, n);
+        node->body_size += n;
+
+        p += n;
+        size -= n;
+    }
+
+    return NXT_OK;
+}
+
+
+/*
+ * The body is written to the temporary file synchronously in the engine
+ * thread, so "path" should be on a fast local file system.
+ */
+
+static nxt_int_t
+nxt_http_cache_write(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_t *cache, u_char *p, size_t size)
+{
+    u_char                 *tmp_name;
+    ssize_t                n;
+    nxt_str_t              *path;
+    nxt_http_cache_node_t  *node;
+
+    static const nxt_str_t  tmp_name_pattern = nxt_string("/cache-XXXXXXXX");
+
+    node = cache->update;
+
+    if (node->fd == -1) {
+        path = &cache->conf->path;
+
+        tmp_name = nxt_mp_nget(r->mem_pool,
+                               path->length + tmp_name_pattern.length + 1);
+        if (nxt_slow_path(tmp_name == NULL)) {
+            return NXT_ERROR;
+        }
+
+        nxt_memcpy(tmp_name, path->start, path->length);
+        nxt_memcpy(tmp_name + path->length, tmp_name_pattern.start,
+                   tmp_name_pattern.length);
+        tmp_name[path->length + tmp_name_pattern.length] = '\0';
+
+        node->fd = mkstemp((char *) tmp_name);
+        if (nxt_slow_path(node->fd == -1)) {
+            nxt_alert(task, "mkstemp(%s) failed %E", tmp_name, nxt_errno);
+            return NXT_ERROR;
+        }
+
+        if (unlink((char *) tmp_name) != 0) {
+            nxt_alert(task, "unlink(%s) failed %E", tmp_name, nxt_errno);
+        }
+    }
+
+    n = nxt_fd_write(node->fd, p, size);
+
+    if (nxt_slow_path(n != (ssize_t) size)) {
+        return NXT_ERROR;
+    }
+
+    node->body_size += n;
+
+    /* The maximum cache size limits disk usage as well. */
+    node->node.size += n;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_http_cache_update(nxt_task_t *task, nxt_http_cache_t *cache)
+{
+    nxt_cache_t       *c;
+    nxt_cache_node_t  *node;
+
+    c = cache->shared;
+    node = &cache->update->node;
+    cache->update = NULL;
+
+    nxt_cache_update(task, c, node);
+    nxt_cache_release(task, c, node);
+}
+
+
+/*
+ * A response that cannot be stored is not waited for during the lifetime
+ * configured for the action, so concurrent requests reach the origin
+ * without being serialized by an update.
+ */
+
+static void
+nxt_http_cache_pass(nxt_task_t *task, nxt_http_cache_t *cache)
+{
+    nxt_cache_t       *c;
+    nxt_cache_node_t  *node;
+
+    c = cache->shared;
+    node = &cache->update->node;
+    cache->update = NULL;
+
+    node->expiry = nxt_thread_time(task->thread) + cache->action->cache->valid;
+
+    nxt_cache_pass(task, c, node);
+    nxt_cache_release(task, c, node);
+}
+
+
+static void
+nxt_http_cache_cancel(nxt_task_t *task, nxt_http_cache_t *cache)
+{
+    nxt_cache_t       *c;
+    nxt_cache_node_t  *node;
+
+    c = cache->shared;
+    node = &cache->update->node;
+    cache->update = NULL;
+
+    nxt_cache_cancel(task, c, node);
+    nxt_cache_release(task, c, node);
+}
+
+
+void
+nxt_http_cache_close(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_http_cache_t  *cache;
+
+    cache = r->cache;
+
+    nxt_http_cache_timer_stop(task, r, cache);
+
+    if (cache->waiting && nxt_cache_query_cancel(cache->shared, &cache->query))
+    {
+        cache->waiting = 0;
+        nxt_mp_release(r->mem_pool);
+    }
+
+    if (cache->update != NULL) {
+        nxt_http_cache_cancel(task, cache);
+    }
+
+    if (cache->hit != NULL) {
+        nxt_cache_release(task, cache->shared, &cache->hit->node);
+        cache->hit = NULL;
+    }
+}
+
+
+static void
+nxt_http_cache_node_free(nxt_task_t *task, nxt_cache_node_t *node)
+{
+    nxt_http_cache_node_t   *hn;
+    nxt_http_cache_chunk_t  *chunk, *next;
+
+    hn = (nxt_http_cache_node_t *) node;
+
+    for (chunk = hn->body; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        nxt_free(chunk);
+    }
+
+    if (hn->fields != NULL) {
+        nxt_free(hn->fields);
+    }
+
+    if (hn->fd != -1) {
+        nxt_fd_close(hn->fd);
+    }
+}
@@ -157,6 +157,8 @@ nxt_http_chunk_parse(nxt_task_t *task, nxt_http_chunk_parse_t *hcp,
                         continue;
                     }
 
+                    hcp->complete = 1;
+
                     return out;
                 }
 
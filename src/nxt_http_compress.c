@@ -0,0 +1,546 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+
+#include <zlib.h>
+
+
+#define NXT_HTTP_COMPRESS_BUF_SIZE  8192
+
+
+struct nxt_http_compress_conf_s {
+    nxt_http_route_rule_t       *types;
+    nxt_off_t                   min_length;
+    int                         level;
+};
+
+
+/*
+ * The filter keeps memory bounded: the deflate state is sized by the response
+ * length if it is known, a single output buffer is filled at a time, and
+ * an input buffer is completed only after the output it produced is sent.
+ */
+
+struct nxt_http_compress_s {
+    z_stream                    zstream;
+    nxt_buf_t                   *out;
+    uint8_t                     done;  /* 1 bit */
+};
+
+
+typedef struct {
+    nxt_conf_value_t            *types;
+    nxt_off_t                   min_length;
+    int32_t                     level;
+} nxt_http_compress_conf_map_t;
+
+
+static nxt_bool_t nxt_http_compress_field_is(nxt_http_field_t *field,
+    const char *name, size_t length);
+static nxt_int_t nxt_http_compress_etag(nxt_http_request_t *r,
+    nxt_http_field_t *etag);
+static nxt_int_t nxt_http_compress_deflate(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_compress_t *comp, int flush,
+    nxt_buf_t ***tail);
+static void nxt_http_compress_buf_completion(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_compress_complete(nxt_task_t *task, nxt_buf_t *b);
+static void *nxt_http_compress_alloc(void *opaque, u_int items, u_int size);
+static void nxt_http_compress_free(void *opaque, void *address);
+
+
+static nxt_conf_map_t  nxt_http_compress_conf[] = {
+    {
+        nxt_string("types"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_compress_conf_map_t, types),
+    },
+
+    {
+        nxt_string("min_length"),
+        NXT_CONF_MAP_OFF,
+        offsetof(nxt_http_compress_conf_map_t, min_length),
+    },
+
+    {
+        nxt_string("level"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_compress_conf_map_t, level),
+    },
+};
+
+
+nxt_int_t
+nxt_http_compress_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf)
+{
+    nxt_mp_t                      *mp;
+    nxt_int_t                     ret;
+    nxt_http_compress_conf_t      *conf;
+    nxt_http_compress_conf_map_t  map;
+
+    map.types = NULL;
+    map.min_length = 20;
+    map.level = 1;
+
+    ret = nxt_conf_map_object(tmcf->mem_pool, acf->compress,
+                              nxt_http_compress_conf,
+                              nxt_nitems(nxt_http_compress_conf), &map);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    mp = tmcf->router_conf->mem_pool;
+
+    conf = nxt_mp_zget(mp, sizeof(nxt_http_compress_conf_t));
+    if (nxt_slow_path(conf == NULL)) {
+        return NXT_ERROR;
+    }
+
+    if (map.types != NULL) {
+        conf->types = nxt_http_route_types_rule_create(task, mp, map.types);
+        if (nxt_slow_path(conf->types == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
+    conf->min_length = map.min_length;
+    conf->level = map.level;
+
+    action->compress = conf;
+
+    return NXT_OK;
+}
+
+
+nxt_int_t
+nxt_http_compress_start(nxt_task_t *task, nxt_http_request_t *r)
+{
+    int                       wbits, memlevel, ret;
+    u_char                    *p;
+    nxt_off_t                 size;
+    nxt_str_t                 *coding;
+    nxt_http_field_t          *field, *type, *etag;
+    nxt_http_compress_t       *comp;
+    nxt_http_compress_conf_t  *conf;
+
+    static nxt_str_t  gzip = nxt_string("gzip");
+    static nxt_str_t  deflate = nxt_string("deflate");
+
+    conf = r->compress;
+
+    if (r->status < NXT_HTTP_OK
+        || r->status >= NXT_HTTP_MULTIPLE_CHOICES
+        || r->status == NXT_HTTP_NO_CONTENT
+        || r->status == NXT_HTTP_PARTIAL_CONTENT
+        || nxt_str_eq(r->method, "HEAD", 4))
+    {
+        return NXT_OK;
+    }
+
+    type = NULL;
+    etag = NULL;
+    size = r->resp.content_length_n;
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (field->skip) {
+            continue;
+        }
+
+        if (nxt_http_compress_field_is(field, "Content-Encoding",
+                                       nxt_length("Content-Encoding")))
+        {
+            return NXT_OK;
+        }
+
+        if (nxt_http_compress_field_is(field, "Content-Type",
+                                       nxt_length("Content-Type")))
+        {
+            type = field;
+
+        } else if (nxt_http_compress_field_is(field, "Content-Length",
+                                              nxt_length("Content-Length")))
+        {
+            size = nxt_off_t_parse(field->value, field->value_length);
+
+        } else if (nxt_http_compress_field_is(field, "ETag",
+                                              nxt_length("ETag")))
+        {
+            etag = field;
+        }
+
+    } nxt_list_loop;
+
+    if (conf->types != NULL) {
+        if (type == NULL) {
+            return NXT_OK;
+        }
+
+        p = nxt_memchr(type->value, ';', type->value_length);
+        if (p == NULL) {
+            p = type->value + type->value_length;
+        }
+
+        while (p > type->value && (p[-1] == ' ' || p[-1] == '\t')) {
+            p--;
+        }
+
+        ret = nxt_http_route_test_rule(r, conf->types, type->value,
+                                       p - type->value);
+        if (ret <= 0) {
+            return ret;
+        }
+    }
+
+    if (size >= 0 && size < conf->min_length) {
+        return NXT_OK;
+    }
+
+    field = nxt_list_zero_add(r->resp.fields);
+    if (nxt_slow_path(field == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_http_field_set(field, "Vary", "Accept-Encoding");
+
+    if (nxt_http_accept_encoding(r, &gzip)) {
+        coding = &gzip;
+
+    } else if (nxt_http_accept_encoding(r, &deflate)) {
+        coding = &deflate;
+
+    } else {
+        return NXT_OK;
+    }
+
+    comp = nxt_mp_zget(r->mem_pool, sizeof(nxt_http_compress_t));
+    if (nxt_slow_path(comp == NULL)) {
+        return NXT_ERROR;
+    }
+
+    /* A smaller window suffices for a response of a known length. */
+
+    wbits = MAX_WBITS;
+    memlevel = MAX_MEM_LEVEL - 1;
+
+    if (size > 0) {
+        while (size < (1 << (wbits - 1)) && wbits > 9) {
+            wbits--;
+            memlevel--;
+        }
+    }
+
+    if (coding == &gzip) {
+        wbits += 16;
+    }
+
+    comp->zstream.zalloc = nxt_http_compress_alloc;
+    comp->zstream.zfree = nxt_http_compress_free;
+    comp->zstream.opaque = r->mem_pool;
+
+    ret = deflateInit2(&comp->zstream, conf->level, Z_DEFLATED, wbits,
+                       memlevel, Z_DEFAULT_STRATEGY);
+    if (nxt_slow_path(ret != Z_OK)) {
+        nxt_alert(task, "deflateInit2() failed: %d", ret);
+        return NXT_ERROR;
+    }
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (nxt_http_compress_field_is(field, "Content-Length",
+                                       nxt_length("Content-Length")))
+        {
+            field->skip = 1;
+        }
+
+    } nxt_list_loop;
+
+    r->resp.content_length = NULL;
+    r->resp.content_length_n = -1;
+
+    if (etag != NULL) {
+        ret = nxt_http_compress_etag(r, etag);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
+    field = nxt_list_zero_add(r->resp.fields);
+    if (nxt_slow_path(field == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_http_field_name_set(field, "Content-Encoding");
+    field->value = coding->start;
+    field->value_length = coding->length;
+
+    nxt_debug(task, "http compress: %V, level %d, window bits %d",
+              coding, conf->level, wbits);
+
+    r->compressor = comp;
+
+    return NXT_OK;
+}
+
+
+static nxt_bool_t
+nxt_http_compress_field_is(nxt_http_field_t *field, const char *name,
+    size_t length)
+{
+    return (field->name_length == length
+            && nxt_memcasecmp(field->name, name, length) == 0);
+}
+
+
+/* A strong entity tag does not match a compressed representation. */
+
+static nxt_int_t
+nxt_http_compress_etag(nxt_http_request_t *r, nxt_http_field_t *etag)
+{
+    u_char  *p;
+
+    if (etag->value_length == 0 || etag->value[0] != '"') {
+        return NXT_OK;
+    }
+
+    p = nxt_mp_nget(r->mem_pool, etag->value_length + 2);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    p[0] = 'W';
+    p[1] = '/';
+    nxt_memcpy(p + 2, etag->value, etag->value_length);
+
+    etag->value = p;
+    etag->value_length += 2;
+
+    return NXT_OK;
+}
+
+
+/*
+ * nxt_http_compress_filter() returns the compressed chain to send or NULL
+ * if there is nothing to send yet or an error has occurred.
+ */
+
+nxt_buf_t *
+nxt_http_compress_filter(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *in)
+{
+    nxt_int_t            ret;
+    nxt_buf_t            *b, *next, *out, **tail, *last, *consumed, **prev;
+    nxt_http_compress_t  *comp;
+
+    comp = r->compressor;
+
+    out = NULL;
+    tail = &out;
+    last = NULL;
+    consumed = NULL;
+    prev = &consumed;
+
+    for (b = in; b != NULL; b = next) {
+        next = b->next;
+        b->next = NULL;
+
+        if (nxt_buf_is_last(b)) {
+            last = b;
+            continue;
+        }
+
+        if (nxt_buf_is_mem(b) && !comp->done) {
+            comp->zstream.next_in = b->mem.pos;
+            comp->zstream.avail_in = nxt_buf_mem_used_size(&b->mem);
+
+            ret = nxt_http_compress_deflate(task, r, comp, Z_NO_FLUSH, &tail);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                b->next = next;
+                goto fail;
+            }
+
+            b->mem.pos = b->mem.free;
+        }
+
+        *prev = b;
+        prev = &b->next;
+    }
+
+    if (last != NULL && !comp->done) {
+        comp->zstream.avail_in = 0;
+
+        ret = nxt_http_compress_deflate(task, r, comp, Z_FINISH, &tail);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            goto fail;
+        }
+
+        comp->done = 1;
+        (void) deflateEnd(&comp->zstream);
+    }
+
+    if (consumed != NULL) {
+        if (out != NULL) {
+            /*
+             * The input buffers are completed along with the last output
+             * buffer to keep the response producer in step with the client.
+             */
+            for (b = out; b->next != NULL; b = b->next) { /* void */ }
+
+            b->data = consumed;
+
+        } else {
+            nxt_http_compress_complete(task, consumed);
+        }
+    }
+
+    *tail = last;
+
+    return out;
+
+fail:
+
+    *prev = b;
+
+    if (out != NULL) {
+        nxt_http_compress_buf_completion(task, out, r);
+    }
+
+    for (b = consumed; b != NULL; b = next) {
+        next = b->next;
+        b->next = NULL;
+
+        if (nxt_buf_is_last(b)) {
+            last = b;
+
+        } else {
+            nxt_http_compress_complete(task, b);
+        }
+    }
+
+    if (last != NULL) {
+        r->last = last;
+    }
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+
+    return NULL;
+}
+
+
+static nxt_int_t
+nxt_http_compress_deflate(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_compress_t *comp, int flush, nxt_buf_t ***tail)
+{
+    int        ret;
+    nxt_buf_t  *b;
+    z_stream   *zs;
+
+    zs = &comp->zstream;
+
+    for ( ;; ) {
+        b = comp->out;
+
+        if (b == NULL) {
+            b = nxt_buf_mem_alloc(r->mem_pool, NXT_HTTP_COMPRESS_BUF_SIZE, 0);
+            if (nxt_slow_path(b == NULL)) {
+                return NXT_ERROR;
+            }
+
+            b->data = NULL;
+            b->completion_handler = nxt_http_compress_buf_completion;
+            b->parent = r;
+
+            zs->next_out = b->mem.free;
+            zs->avail_out = NXT_HTTP_COMPRESS_BUF_SIZE;
+
+            comp->out = b;
+        }
+
+        ret = deflate(zs, flush);
+
+        if (nxt_slow_path(ret != Z_OK && ret != Z_STREAM_END
+                          && ret != Z_BUF_ERROR))
+        {
+            nxt_alert(task, "deflate() failed: %d", ret);
+            return NXT_ERROR;
+        }
+
+        b->mem.free = zs->next_out;
+
+        if (zs->avail_out == 0 || ret == Z_STREAM_END) {
+            /* The buffer retains the pool only after it is sent. */
+            nxt_mp_retain(r->mem_pool);
+
+            **tail = b;
+            *tail = &b->next;
+
+            comp->out = NULL;
+        }
+
+        if (ret == Z_STREAM_END
+            || (flush == Z_NO_FLUSH && zs->avail_in == 0))
+        {
+            return NXT_OK;
+        }
+    }
+}
+
+
+static void
+nxt_http_compress_buf_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b, *next;
+    nxt_http_request_t  *r;
+
+    b = obj;
+    r = data;
+
+    do {
+        next = b->next;
+
+        if (b->data != NULL) {
+            nxt_http_compress_complete(task, b->data);
+        }
+
+        nxt_mp_free(r->mem_pool, b);
+        nxt_mp_release(r->mem_pool);
+
+        b = next;
+    } while (b != NULL);
+}
+
+
+static void
+nxt_http_compress_complete(nxt_task_t *task, nxt_buf_t *b)
+{
+    nxt_buf_t  *next;
+
+    while (b != NULL) {
+        next = b->next;
+        b->next = NULL;
+
+        nxt_work_queue_add(&task->thread->engine->fast_work_queue,
+                           b->completion_handler, task, b, b->parent);
+
+        b = next;
+    }
+}
+
+
+static void *
+nxt_http_compress_alloc(void *opaque, u_int items, u_int size)
+{
+    return nxt_mp_alloc(opaque, (size_t) items * size);
+}
+
+
+static void
+nxt_http_compress_free(void *opaque, void *address)
+{
+    nxt_mp_free(opaque, address);
+}
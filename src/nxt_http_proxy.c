@@ -23,6 +23,7 @@ static void nxt_http_proxy_upstream_error(nxt_task_t *task,
     nxt_upstream_server_t *us);
 static nxt_http_action_t *nxt_http_proxy(nxt_task_t *task,
     nxt_http_request_t *r, nxt_http_action_t *action);
+static void nxt_http_proxy_start(nxt_task_t *task, void *obj, void *data);
 static void nxt_http_proxy_header_send(nxt_task_t *task, void *obj, void *data);
 static void nxt_http_proxy_header_sent(nxt_task_t *task, void *obj, void *data);
 static void nxt_http_proxy_header_read(nxt_task_t *task, void *obj, void *data);
@@ -30,8 +31,13 @@ static void nxt_http_proxy_send_body(nxt_task_t *task, void *obj, void *data);
 static void nxt_http_proxy_buf_mem_completion(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_http_proxy_error(nxt_task_t *task, void *obj, void *data);
+static nxt_bool_t nxt_http_proxy_retry(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_peer_t *peer);
+static void nxt_http_proxy_server_free(nxt_task_t *task,
+    nxt_http_peer_t *peer);
 
 
+static const nxt_http_request_state_t  nxt_http_proxy_body_state;
 static const nxt_http_request_state_t  nxt_http_proxy_header_send_state;
 static const nxt_http_request_state_t  nxt_http_proxy_header_sent_state;
 static const nxt_http_request_state_t  nxt_http_proxy_header_read_state;
@@ -74,7 +80,7 @@ nxt_http_proxy_init(nxt_mp_t *mp, nxt_http_action_t *action,
     }
 
     if (sa != NULL) {
-        up = nxt_mp_alloc(mp, sizeof(nxt_upstream_t));
+        up = nxt_mp_zalloc(mp, sizeof(nxt_upstream_t));
         if (nxt_slow_path(up == NULL)) {
             return NXT_ERROR;
         }
@@ -136,19 +142,56 @@ nxt_upstream_proxy_handler(nxt_task_t *task, nxt_http_request_t *r,
     peer->request = r;
     r->peer = peer;
 
-    nxt_mp_retain(r->mem_pool);
-
     us->state = &nxt_upstream_proxy_state;
     us->peer.http = peer;
     peer->server = us;
 
     us->upstream = upstream;
-    upstream->proto->get(task, us);
+
+    if (r->body_state == NXT_HTTP_BODY_DEFERRED) {
+        /* The body is not read yet in the body streaming mode. */
+        r->state = &nxt_http_proxy_body_state;
+
+        nxt_http_request_read_body(task, r);
+
+        return NULL;
+    }
+
+    nxt_http_proxy_start(task, r, NULL);
 
     return NULL;
 }
 
 
+static const nxt_http_request_state_t  nxt_http_proxy_body_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_http_proxy_start,
+    .error_handler = nxt_http_request_close_handler,
+};
+
+
+static void
+nxt_http_proxy_start(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_upstream_server_t  *us;
+    nxt_http_request_t     *r;
+
+    r = obj;
+    us = r->peer->server;
+
+    nxt_mp_retain(r->mem_pool);
+
+    us->start = task->thread->engine->timers.now;
+
+    if (r->upstream_start == 0) {
+        r->upstream_start = nxt_thread_monotonic_time(task->thread);
+    }
+
+    us->upstream->proto->get(task, us);
+}
+
+
 static void
 nxt_http_proxy_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
 {
@@ -181,13 +224,21 @@ nxt_http_proxy_upstream_ready(nxt_task_t *task, nxt_upstream_server_t *us)
 static void
 nxt_http_proxy_upstream_error(nxt_task_t *task, nxt_upstream_server_t *us)
 {
+    nxt_http_peer_t     *peer;
+    nxt_http_status_t   status;
     nxt_http_request_t  *r;
 
-    r = us->peer.http->request;
+    peer = us->peer.http;
+    r = peer->request;
+
+    /* No servers are left to retry a timed out request. */
+
+    status = (peer->status == NXT_HTTP_GATEWAY_TIMEOUT)
+             ? NXT_HTTP_GATEWAY_TIMEOUT : NXT_HTTP_BAD_GATEWAY;
 
     nxt_mp_release(r->mem_pool);
 
-    nxt_http_request_error(task, r, NXT_HTTP_BAD_GATEWAY);
+    nxt_http_request_error(task, r, status);
 }
 
 
@@ -257,6 +308,8 @@ nxt_http_proxy_header_read(nxt_task_t *task, void *obj, void *data)
 
     nxt_debug(task, "http proxy status: %d", peer->status);
 
+    nxt_upstream_health_passed(peer->server);
+
     nxt_list_each(field, peer->fields) {
 
         nxt_debug(task, "http proxy header: \"%*s: %*s\"",
@@ -310,6 +363,7 @@ nxt_http_proxy_send_body(nxt_task_t *task, void *obj, void *data)
 
     } else {
         nxt_http_proto[peer->protocol].peer_close(task, peer);
+        nxt_http_proxy_server_free(task, peer);
 
         nxt_mp_release(r->mem_pool);
     }
@@ -383,12 +437,119 @@ nxt_http_proxy_error(nxt_task_t *task, void *obj, void *data)
 
     nxt_http_proto[peer->protocol].peer_close(task, peer);
 
+    if (peer->reused && !peer->header_received
+        && peer->status == NXT_HTTP_BAD_GATEWAY)
+    {
+        /*
+         * A keep-alive connection may have been closed
+         * by the upstream server while it was idle.
+         */
+        nxt_debug(task, "http proxy retry");
+
+        peer->fields = NULL;
+        peer->body = NULL;
+        peer->closed = 0;
+
+        r->state = &nxt_http_proxy_header_send_state;
+
+        nxt_http_proto[peer->protocol].peer_connect(task, peer);
+        return;
+    }
+
+    if (!peer->header_received
+        && (peer->status == NXT_HTTP_BAD_GATEWAY
+            || peer->status == NXT_HTTP_GATEWAY_TIMEOUT))
+    {
+        nxt_upstream_health_failed(task, peer->server);
+
+        if (nxt_http_proxy_retry(task, r, peer)) {
+            return;
+        }
+    }
+
+    nxt_http_proxy_server_free(task, peer);
+
     nxt_mp_release(r->mem_pool);
 
     nxt_http_request_error(&r->task, r, peer->status);
 }
 
 
+static nxt_bool_t
+nxt_http_proxy_retry(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_peer_t *peer)
+{
+    nxt_str_t              *method;
+    nxt_msec_t             now;
+    nxt_upstream_t         *upstream;
+    nxt_upstream_server_t  *us;
+
+    us = peer->server;
+    upstream = us->upstream;
+
+    if (us->tries >= upstream->retries) {
+        return 0;
+    }
+
+    now = task->thread->engine->timers.now;
+
+    if (upstream->retry_timeout != 0
+        && nxt_msec_diff(now, us->start)
+           >= (nxt_msec_int_t) upstream->retry_timeout)
+    {
+        return 0;
+    }
+
+    /*
+     * A request that may have reached the server is passed to the next
+     * server only if it is idempotent.  Request bodies are read completely
+     * before the request is proxied, so they can be sent again.
+     */
+
+    if (peer->connected) {
+        method = r->method;
+
+        if (!nxt_str_eq(method, "GET", 3)
+            && !nxt_str_eq(method, "HEAD", 4)
+            && !nxt_str_eq(method, "PUT", 3)
+            && !nxt_str_eq(method, "DELETE", 6)
+            && !nxt_str_eq(method, "OPTIONS", 7)
+            && !nxt_str_eq(method, "TRACE", 5))
+        {
+            return 0;
+        }
+    }
+
+    us->tries++;
+
+    nxt_debug(task, "http proxy next upstream, try %uD", us->tries);
+
+    nxt_http_proxy_server_free(task, peer);
+
+    peer->fields = NULL;
+    peer->body = NULL;
+    peer->closed = 0;
+    peer->connected = 0;
+
+    upstream->proto->get(task, us);
+
+    return 1;
+}
+
+
+static void
+nxt_http_proxy_server_free(nxt_task_t *task, nxt_http_peer_t *peer)
+{
+    nxt_upstream_server_t  *us;
+
+    us = peer->server;
+
+    if (us->upstream->proto->free != NULL) {
+        us->upstream->proto->free(task, us);
+    }
+}
+
+
 nxt_int_t
 nxt_http_proxy_date(void *ctx, nxt_http_field_t *field, uintptr_t data)
 {
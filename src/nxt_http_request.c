@@ -50,6 +50,12 @@ nxt_http_init(nxt_task_t *task)
         return ret;
     }
 
+    ret = nxt_h2p_init(task);
+
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
     return nxt_http_response_hash_init(task);
 }
 
@@ -254,6 +260,7 @@ nxt_http_request_create(nxt_task_t *task)
     r->content_length_n = -1;
     r->resp.content_length_n = -1;
     r->state = &nxt_http_request_init_state;
+    r->start = nxt_thread_monotonic_time(task->thread);
 
     return r;
 
@@ -462,7 +469,14 @@ nxt_http_request_action(nxt_task_t *task, nxt_http_request_t *r,
         do {
             nxt_debug(task, "http request route: %V", &action->name);
 
-            action = action->handler(task, r, action);
+            r->compress = action->compress;
+
+            if (action->cache != NULL && r->cache == NULL) {
+                action = nxt_http_cache_handler(task, r, action);
+
+            } else {
+                action = action->handler(task, r, action);
+            }
 
             if (action == NULL) {
                 return;
@@ -498,6 +512,8 @@ nxt_http_application_handler(nxt_task_t *task, nxt_http_request_t *r,
         nxt_str_set(&r->server_name, "localhost");
     }
 
+    r->upstream_start = nxt_thread_monotonic_time(task->thread);
+
     nxt_router_process_http_request(task, r, action);
 
     return NULL;
@@ -522,6 +538,18 @@ nxt_http_request_read_body(nxt_task_t *task, nxt_http_request_t *r)
 }
 
 
+nxt_int_t
+nxt_http_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_fd_t *fd)
+{
+    if (nxt_fast_path(r->proto.any != NULL)) {
+        return nxt_http_proto[r->protocol].body_stream(task, r, fd);
+    }
+
+    return NXT_ERROR;
+}
+
+
 void
 nxt_http_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_work_handler_t body_handler, void *data)
@@ -534,6 +562,26 @@ nxt_http_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
      * to the last header filter.
      */
 
+    if (r->upstream_start != 0 && r->upstream_end == 0) {
+        r->upstream_end = nxt_thread_monotonic_time(task->thread);
+    }
+
+    if (r->cache != NULL) {
+        if (nxt_slow_path(nxt_http_cache_header(task, r, body_handler != NULL)
+                          != NXT_OK))
+        {
+            goto fail;
+        }
+    }
+
+#if (NXT_HAVE_ZLIB)
+    if (r->compress != NULL) {
+        if (nxt_slow_path(nxt_http_compress_start(task, r) != NXT_OK)) {
+            goto fail;
+        }
+    }
+#endif
+
     server = nxt_list_zero_add(r->resp.fields);
     if (nxt_slow_path(server == NULL)) {
         goto fail;
@@ -609,6 +657,19 @@ nxt_http_request_ws_frame_start(nxt_task_t *task, nxt_http_request_t *r,
 void
 nxt_http_request_send(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out)
 {
+    if (r->cache != NULL) {
+        nxt_http_cache_body(task, r, out);
+    }
+
+#if (NXT_HAVE_ZLIB)
+    if (r->compressor != NULL) {
+        out = nxt_http_compress_filter(task, r, out);
+        if (out == NULL) {
+            return;
+        }
+    }
+#endif
+
     if (nxt_fast_path(r->proto.any != NULL)) {
         nxt_http_proto[r->protocol].send(task, r, out);
     }
@@ -726,6 +787,10 @@ nxt_http_request_close_handler(nxt_task_t *task, void *obj, void *data)
 
     r->proto.any = NULL;
 
+    if (r->cache != NULL) {
+        nxt_http_cache_close(task, r);
+    }
+
     if (r->body != NULL && nxt_buf_is_file(r->body)
         && r->body->file->fd != -1)
     {
@@ -750,3 +815,77 @@ nxt_http_date_cache_handler(u_char *buf, nxt_realtime_t *now, struct tm *tm,
 {
     return nxt_http_date(buf, tm);
 }
+
+
+/*
+ * nxt_http_accept_encoding() tests if the content coding is acceptable
+ * according to the "Accept-Encoding" header field.  The coding is not
+ * acceptable if its weight is zero.  An explicitly listed coding takes
+ * precedence over the "*" one.
+ */
+
+nxt_bool_t
+nxt_http_accept_encoding(nxt_http_request_t *r, nxt_str_t *coding)
+{
+    u_char      *p, *end, *token;
+    size_t      length;
+    nxt_int_t   any;
+    nxt_bool_t  accept;
+
+    if (r->accept_encoding == NULL) {
+        return 0;
+    }
+
+    p = r->accept_encoding->value;
+    end = p + r->accept_encoding->value_length;
+
+    any = -1;
+
+    while (p < end) {
+
+        if (*p == ',' || *p == ' ' || *p == '\t') {
+            p++;
+            continue;
+        }
+
+        token = p;
+
+        while (p < end
+               && *p != ',' && *p != ';' && *p != ' ' && *p != '\t')
+        {
+            p++;
+        }
+
+        length = p - token;
+        accept = 1;
+
+        while (p < end && *p != ',') {
+
+            if (*p == '=' && (p[-1] == 'q' || p[-1] == 'Q')) {
+                accept = 0;
+
+                for (p++; p < end && *p != ',' && *p != ';'; p++) {
+                    if (*p >= '1' && *p <= '9') {
+                        accept = 1;
+                    }
+                }
+
+                continue;
+            }
+
+            p++;
+        }
+
+        if (length == coding->length
+            && nxt_strncasecmp(token, coding->start, length) == 0)
+        {
+            return accept;
+        }
+
+        if (length == 1 && token[0] == '*') {
+            any = accept;
+        }
+    }
+
+    return (any == 1);
+}
@@ -638,6 +638,21 @@ static nxt_conf_map_t  nxt_http_route_action_conf[] = {
         NXT_CONF_MAP_PTR,
         offsetof(nxt_http_action_conf_t, types)
     },
+    {
+        nxt_string("precompressed"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_action_conf_t, precompressed)
+    },
+    {
+        nxt_string("compress"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_action_conf_t, compress)
+    },
+    {
+        nxt_string("cache"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_action_conf_t, cache)
+    },
     {
         nxt_string("fallback"),
         NXT_CONF_MAP_PTR,
@@ -675,6 +690,22 @@ nxt_http_action_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         return nxt_http_static_init(task, tmcf, action, &acf);
     }
 
+#if (NXT_HAVE_ZLIB)
+    if (acf.compress != NULL) {
+        ret = nxt_http_compress_init(task, tmcf, action, &acf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+    }
+#endif
+
+    if (acf.cache != NULL) {
+        ret = nxt_http_cache_init(task, tmcf, action, &acf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+    }
+
     if (acf.proxy != NULL) {
         return nxt_http_proxy_init(mp, action, &acf);
     }
@@ -1406,8 +1437,10 @@ static nxt_http_action_t *
 nxt_http_action_pass_var(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_action_t *action)
 {
-    nxt_var_t  *var;
-    nxt_int_t  ret;
+    nxt_var_t                 *var;
+    nxt_int_t                 ret;
+    nxt_http_cache_conf_t     *cache;
+    nxt_http_compress_conf_t  *compress;
 
     ret = nxt_var_query_init(&r->var_query, r, r->mem_pool);
     if (nxt_slow_path(ret != NXT_OK)) {
@@ -1416,11 +1449,17 @@ nxt_http_action_pass_var(nxt_task_t *task, nxt_http_request_t *r,
 
     var = action->u.var;
 
+    compress = action->compress;
+    cache = action->cache;
+
     action = nxt_mp_get(r->mem_pool, sizeof(nxt_http_action_t));
     if (nxt_slow_path(action == NULL)) {
         goto fail;
     }
 
+    action->compress = compress;
+    action->cache = cache;
+
     nxt_var_query(task, r->var_query, var, &action->name);
     nxt_var_query_resolve(task, r->var_query, action,
                           nxt_http_action_pass_var_ready,
@@ -1600,6 +1639,8 @@ nxt_http_action_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
     action->name = *name;
     action->handler = NULL;
+    action->compress = NULL;
+    action->cache = NULL;
 
     ret = nxt_http_action_resolve(task, tmcf, action);
     if (nxt_slow_path(ret != NXT_OK)) {
@@ -1624,6 +1665,8 @@ nxt_http_pass_application(nxt_task_t *task, nxt_router_conf_t *rtcf,
     }
 
     action->name = *name;
+    action->compress = NULL;
+    action->cache = NULL;
 
     (void) nxt_router_application_init(rtcf, name, NULL, action);
 
@@ -12,21 +12,120 @@ typedef struct {
     nxt_str_t               chroot;
     nxt_uint_t              resolve;
     nxt_http_route_rule_t   *types;
+    uint8_t                 precompressed;  /* 1 bit */
 } nxt_http_static_conf_t;
 
 
+typedef struct {
+    nxt_off_t               start;
+    nxt_off_t               end;
+    nxt_str_t               header;
+} nxt_http_static_range_t;
+
+
+typedef struct {
+    nxt_http_static_range_t  *ranges;
+    nxt_uint_t               nranges;
+    nxt_uint_t               current;
+    nxt_str_t                header;
+} nxt_http_static_multipart_t;
+
+
+typedef struct {
+    nxt_job_t               job;
+    nxt_task_t              task;
+
+    nxt_http_request_t      *r;
+    nxt_http_action_t       *action;
+
+    nxt_str_t               exten;
+    nxt_str_t               *mtype;
+    nxt_str_t               key;
+
+    u_char                  *fname;
+    size_t                  length;
+
+    u_char                  *path;
+    size_t                  path_length;
+
+    nxt_file_t              file;
+    nxt_file_info_t         fi;
+    nxt_int_t               ret;
+
+    nxt_file_cache_node_t   *node;
+
+    uint8_t                 need_body;  /* 1 bit */
+    uint8_t                 encodings;
+    uint8_t                 encoding;
+} nxt_http_static_ctx_t;
+
+
+typedef struct {
+    nxt_str_t               name;
+    nxt_str_t               exten;
+} nxt_http_static_encoding_t;
+
+
 #define NXT_HTTP_STATIC_BUF_COUNT  2
 #define NXT_HTTP_STATIC_BUF_SIZE   (128 * 1024)
 
+#define NXT_HTTP_STATIC_MAX_RANGES  32
+
+#define NXT_HTTP_STATIC_IDENTITY    nxt_nitems(nxt_http_static_encodings)
+
 
 static nxt_http_action_t *nxt_http_static(nxt_task_t *task,
     nxt_http_request_t *r, nxt_http_action_t *action);
+static nxt_http_action_t *nxt_http_static_lookup(nxt_task_t *task,
+    nxt_http_static_ctx_t *ctx);
+static void nxt_http_static_file_open(nxt_task_t *task,
+    nxt_http_static_ctx_t *ctx);
+static void nxt_http_static_job_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_static_job_abort(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_static_job_done(nxt_task_t *task, void *obj, void *data);
+static nxt_http_action_t *nxt_http_static_opened(nxt_task_t *task,
+    nxt_http_static_ctx_t *ctx);
+static nxt_http_action_t *nxt_http_static_found(nxt_task_t *task,
+    nxt_http_static_ctx_t *ctx);
+static nxt_http_action_t *nxt_http_static_send(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_static_ctx_t *ctx);
+static nxt_int_t nxt_http_static_open(nxt_task_t *task,
+    nxt_http_static_conf_t *conf, nxt_file_t *file, u_char **fname,
+    size_t length);
+static nxt_int_t nxt_http_static_cache_key(nxt_http_request_t *r,
+    nxt_http_static_conf_t *conf, u_char *fname, size_t length,
+    nxt_str_t *key);
+static void nxt_http_static_file_close(nxt_task_t *task, nxt_file_t *f,
+    nxt_file_cache_node_t *node);
 static void nxt_http_static_extract_extension(nxt_str_t *path,
     nxt_str_t *exten);
+static nxt_http_status_t nxt_http_static_conditional(nxt_http_request_t *r,
+    nxt_file_info_t *fi, nxt_str_t *etag);
+static nxt_bool_t nxt_http_static_etag_match(nxt_http_field_t *field,
+    nxt_str_t *etag, nxt_bool_t weak);
+static nxt_int_t nxt_http_static_range(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_buf_t *fb, nxt_file_info_t *fi,
+    nxt_str_t *etag, nxt_str_t *mtype);
+static nxt_int_t nxt_http_static_range_parse(nxt_http_request_t *r,
+    nxt_off_t size, nxt_array_t *ranges);
+static void nxt_http_static_trim(nxt_str_t *str);
+static nxt_int_t nxt_http_static_multipart(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_buf_t *fb, nxt_array_t *ranges,
+    nxt_off_t size, nxt_str_t *mtype);
+static u_char *nxt_http_static_multipart_read(nxt_task_t *task,
+    nxt_buf_t *fb, u_char *p, u_char *end);
 static void nxt_http_static_body_handler(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_http_static_buf_completion(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_http_static_file_completion(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_buf_t *nxt_http_static_multipart_bufs(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_buf_t *fb);
+static void nxt_http_static_part_completion(nxt_task_t *task, void *obj,
+    void *data);
 
 static nxt_int_t nxt_http_static_mtypes_hash_test(nxt_lvlhsh_query_t *lhq,
     void *data);
@@ -37,6 +136,14 @@ static void nxt_http_static_mtypes_hash_free(void *data, void *p);
 static const nxt_http_request_state_t  nxt_http_static_send_state;
 
 
+/* The encodings are tried in the order of preference. */
+
+static nxt_http_static_encoding_t  nxt_http_static_encodings[] = {
+    { nxt_string("br"),   nxt_string(".br") },
+    { nxt_string("gzip"), nxt_string(".gz") },
+};
+
+
 nxt_int_t
 nxt_http_static_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_http_action_t *action, nxt_http_action_conf_t *acf)
@@ -110,6 +217,10 @@ nxt_http_static_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         }
     }
 
+    if (acf->precompressed != NULL) {
+        conf->precompressed = nxt_conf_get_boolean(acf->precompressed);
+    }
+
     if (acf->fallback != NULL) {
         action->fallback = nxt_mp_alloc(mp, sizeof(nxt_http_action_t));
         if (nxt_slow_path(action->fallback == NULL)) {
@@ -128,20 +239,14 @@ static nxt_http_action_t *
 nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_action_t *action)
 {
-    size_t                  length, encode;
+    size_t                  length;
     u_char                  *p, *fname;
-    struct tm               tm;
-    nxt_buf_t               *fb;
     nxt_int_t               ret;
-    nxt_str_t               index, exten, *mtype, *chroot;
-    nxt_uint_t              level;
+    nxt_str_t               index, exten, *mtype;
+    nxt_uint_t              i;
     nxt_bool_t              need_body;
-    nxt_file_t              *f, file;
-    nxt_file_info_t         fi;
-    nxt_http_field_t        *field;
-    nxt_http_status_t       status;
     nxt_router_conf_t       *rtcf;
-    nxt_work_handler_t      body_handler;
+    nxt_http_static_ctx_t   *ctx;
     nxt_http_static_conf_t  *conf;
 
     conf = action->u.conf;
@@ -175,8 +280,6 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
         nxt_str_null(&exten);
     }
 
-    f = NULL;
-
     rtcf = r->conf->socket_conf->router_conf;
 
     mtype = NULL;
@@ -203,7 +306,9 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
 
     length = conf->share.length + r->path->length + index.length;
 
-    fname = nxt_mp_nget(r->mem_pool, length + 1);
+    /* Reserve space for an extension of a precompressed file. */
+
+    fname = nxt_mp_nget(r->mem_pool, length + 4);
     if (nxt_slow_path(fname == NULL)) {
         goto fail;
     }
@@ -214,64 +319,316 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
     p = nxt_cpymem(p, index.start, index.length);
     *p = '\0';
 
-    nxt_memzero(&file, sizeof(nxt_file_t));
+    ctx = nxt_mp_zget(r->mem_pool, sizeof(nxt_http_static_ctx_t));
+    if (nxt_slow_path(ctx == NULL)) {
+        goto fail;
+    }
 
-    file.name = fname;
+    ctx->r = r;
+    ctx->action = action;
+    ctx->exten = exten;
+    ctx->mtype = mtype;
+    ctx->path = fname;
+    ctx->path_length = length;
+    ctx->need_body = need_body;
+    ctx->encoding = NXT_HTTP_STATIC_IDENTITY;
+
+    if (conf->precompressed) {
+        for (i = 0; i < NXT_HTTP_STATIC_IDENTITY; i++) {
+            if (nxt_http_accept_encoding(r, &nxt_http_static_encodings[i].name))
+            {
+                ctx->encodings |= 1 << i;
+            }
+        }
 
-    chroot = &conf->chroot;
+        ctx->encoding = 0;
+    }
 
-#if (NXT_HAVE_OPENAT2)
-    if (conf->resolve != 0) {
+    return nxt_http_static_lookup(task, ctx);
 
-        if (chroot->length > 0) {
-            file.name = chroot->start;
+fail:
 
-            if (length > chroot->length
-                && nxt_memcmp(fname, chroot->start, chroot->length) == 0)
-            {
-                fname += chroot->length;
-                ret = nxt_file_open(task, &file, NXT_FILE_SEARCH, NXT_FILE_OPEN,
-                                    0);
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+    return NULL;
+}
 
-            } else {
-                file.error = NXT_EACCES;
-                ret = NXT_ERROR;
-            }
 
-        } else if (fname[0] == '/') {
-            file.name = (u_char *) "/";
-            ret = nxt_file_open(task, &file, NXT_FILE_SEARCH, NXT_FILE_OPEN, 0);
+static nxt_http_action_t *
+nxt_http_static_lookup(nxt_task_t *task, nxt_http_static_ctx_t *ctx)
+{
+    u_char                  *p;
+    nxt_int_t               ret;
+    nxt_str_t               *exten;
+    nxt_http_request_t      *r;
+    nxt_router_conf_t       *rtcf;
+    nxt_http_static_conf_t  *conf;
 
-        } else {
-            file.name = (u_char *) ".";
-            file.fd = AT_FDCWD;
-            ret = NXT_OK;
+    r = ctx->r;
+    conf = ctx->action->u.conf;
+    rtcf = r->conf->socket_conf->router_conf;
+
+    while (ctx->encoding < NXT_HTTP_STATIC_IDENTITY
+           && (ctx->encodings & (1 << ctx->encoding)) == 0)
+    {
+        ctx->encoding++;
+    }
+
+    ctx->fname = ctx->path;
+    ctx->length = ctx->path_length;
+    ctx->node = NULL;
+
+    p = ctx->path + ctx->path_length;
+
+    if (ctx->encoding < NXT_HTTP_STATIC_IDENTITY) {
+        exten = &nxt_http_static_encodings[ctx->encoding].exten;
+
+        p = nxt_cpymem(p, exten->start, exten->length);
+        ctx->length += exten->length;
+    }
+
+    *p = '\0';
+
+    if (rtcf->file_cache != NULL) {
+        ret = nxt_http_static_cache_key(r, conf, ctx->fname, ctx->length,
+                                        &ctx->key);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+            return NULL;
         }
 
-        if (nxt_fast_path(ret == NXT_OK)) {
-            nxt_file_t  af;
+        ctx->node = nxt_file_cache_find(task, rtcf->file_cache, &ctx->key);
 
-            af = file;
-            nxt_memzero(&file, sizeof(nxt_file_t));
-            file.name = fname;
+        if (ctx->node != NULL) {
+            return nxt_http_static_found(task, ctx);
+        }
+    }
 
-            ret = nxt_file_openat2(task, &file, NXT_FILE_RDONLY,
-                                   NXT_FILE_OPEN, 0, af.fd, conf->resolve);
+    if (rtcf->thread_pool != NULL) {
+        ctx->task = *task;
 
-            if (af.fd != AT_FDCWD) {
-                nxt_file_close(task, &af);
+        nxt_job_init(&ctx->job, sizeof(nxt_job_t));
+        nxt_job_set_name(&ctx->job, "http static open");
+
+        ctx->job.task = &ctx->task;
+        ctx->job.data = r;
+        ctx->job.thread_pool = rtcf->thread_pool;
+        ctx->job.abort_handler = nxt_http_static_job_abort;
+
+        nxt_mp_retain(r->mem_pool);
+
+        r->state = &nxt_http_static_send_state;
+
+        nxt_job_start(task, &ctx->job, nxt_http_static_job_handler);
+
+        return NULL;
+    }
+
+    nxt_http_static_file_open(task, ctx);
+
+    return nxt_http_static_opened(task, ctx);
+}
+
+
+/*
+ * nxt_http_static_file_open() may run in a thread pool thread, so it must
+ * not use the request memory pool and the open file cache.
+ */
+
+static void
+nxt_http_static_file_open(nxt_task_t *task, nxt_http_static_ctx_t *ctx)
+{
+    nxt_http_static_conf_t  *conf;
+
+    conf = ctx->action->u.conf;
+
+    ctx->ret = nxt_http_static_open(task, conf, &ctx->file, &ctx->fname,
+                                    ctx->length);
+
+    if (ctx->ret == NXT_OK) {
+        ctx->ret = nxt_file_info(&ctx->file, &ctx->fi);
+
+        if (nxt_slow_path(ctx->ret != NXT_OK)) {
+            ctx->file.error = nxt_errno;
+            nxt_file_close(task, &ctx->file);
+        }
+    }
+
+    if (ctx->ret != NXT_OK) {
+        ctx->file.fd = NXT_FILE_INVALID;
+        nxt_memzero(&ctx->fi, sizeof(nxt_file_info_t));
+    }
+}
+
+
+static void
+nxt_http_static_job_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_static_ctx_t  *ctx;
+
+    ctx = obj;
+
+    nxt_http_static_file_open(task, ctx);
+
+    nxt_job_return(task, &ctx->job, nxt_http_static_job_done);
+}
+
+
+static void
+nxt_http_static_job_abort(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_static_ctx_t  *ctx;
+
+    ctx = obj;
+
+    nxt_http_static_file_open(task, ctx);
+
+    nxt_http_static_job_done(task, ctx, data);
+}
+
+
+static void
+nxt_http_static_job_done(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_action_t      *action;
+    nxt_http_request_t     *r;
+    nxt_http_static_ctx_t  *ctx;
+
+    ctx = obj;
+    r = data;
+
+    nxt_debug(task, "http static open done: \"%s\"", ctx->fname);
+
+    if (nxt_slow_path(r->error)) {
+        if (ctx->file.fd != NXT_FILE_INVALID) {
+            nxt_file_close(task, &ctx->file);
+        }
+
+    } else {
+        action = nxt_http_static_opened(task, ctx);
+
+        if (action != NULL) {
+            nxt_http_request_action(task, r, action);
+        }
+    }
+
+    nxt_mp_release(r->mem_pool);
+}
+
+
+static nxt_http_action_t *
+nxt_http_static_opened(nxt_task_t *task, nxt_http_static_ctx_t *ctx)
+{
+    nxt_http_request_t  *r;
+    nxt_router_conf_t   *rtcf;
+
+    r = ctx->r;
+    rtcf = r->conf->socket_conf->router_conf;
+
+    if (rtcf->file_cache != NULL) {
+        ctx->node = nxt_file_cache_add(task, rtcf->file_cache, &ctx->key,
+                                       &ctx->file, &ctx->fi);
+
+        if (nxt_slow_path(ctx->node == NULL)) {
+            if (ctx->file.fd != NXT_FILE_INVALID) {
+                nxt_file_close(task, &ctx->file);
             }
+
+            nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+            return NULL;
         }
+    }
+
+    return nxt_http_static_found(task, ctx);
+}
+
+
+/*
+ * A precompressed file is used only if it is a regular file,
+ * otherwise the next acceptable encoding is tried.
+ */
+
+static nxt_http_action_t *
+nxt_http_static_found(nxt_task_t *task, nxt_http_static_ctx_t *ctx)
+{
+    nxt_file_t       *file;
+    nxt_file_info_t  *fi;
+
+    if (ctx->encoding == NXT_HTTP_STATIC_IDENTITY) {
+        return nxt_http_static_send(task, ctx->r, ctx);
+    }
+
+    if (ctx->node != NULL) {
+        file = &ctx->node->file;
+        fi = &ctx->node->info;
 
     } else {
-        ret = nxt_file_open(task, &file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
+        file = &ctx->file;
+        fi = &ctx->fi;
     }
 
-#else
-    ret = nxt_file_open(task, &file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
-#endif
+    if (file->fd != NXT_FILE_INVALID && nxt_is_file(fi)) {
+        return nxt_http_static_send(task, ctx->r, ctx);
+    }
+
+    nxt_debug(task, "http static \"%s\" not used", ctx->fname);
+
+    if (ctx->node != NULL) {
+        nxt_file_cache_release(task, ctx->node);
+
+    } else if (file->fd != NXT_FILE_INVALID) {
+        nxt_file_close(task, file);
+    }
+
+    ctx->encoding++;
+
+    return nxt_http_static_lookup(task, ctx);
+}
+
+
+static nxt_http_action_t *
+nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_static_ctx_t *ctx)
+{
+    size_t                  length, encode;
+    u_char                  *p, *fname;
+    struct tm               tm;
+    nxt_buf_t               *fb;
+    nxt_int_t               ret;
+    nxt_str_t               exten, etag, *mtype, *chroot, *coding;
+    nxt_uint_t              level;
+    nxt_file_t              *f, file;
+    nxt_file_info_t         fi;
+    nxt_http_field_t        *field;
+    nxt_http_status_t       status;
+    nxt_router_conf_t       *rtcf;
+    nxt_http_action_t       *action;
+    nxt_work_handler_t      body_handler;
+    nxt_file_cache_node_t   *node;
+    nxt_http_static_conf_t  *conf;
+
+    action = ctx->action;
+    conf = action->u.conf;
+    chroot = &conf->chroot;
+
+    rtcf = r->conf->socket_conf->router_conf;
+
+    exten = ctx->exten;
+    mtype = ctx->mtype;
+    fname = ctx->fname;
+    node = ctx->node;
+
+    if (node != NULL) {
+        file = node->file;
+        fi = node->info;
+
+    } else {
+        file = ctx->file;
+        fi = ctx->fi;
+    }
+
+    f = NULL;
 
-    if (nxt_slow_path(ret != NXT_OK)) {
+    if (nxt_slow_path(file.fd == NXT_FILE_INVALID)) {
 
         switch (file.error) {
 
@@ -309,6 +666,10 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
         }
 
         if (level == NXT_LOG_ERR && action->fallback != NULL) {
+            if (node != NULL) {
+                nxt_file_cache_release(task, node);
+            }
+
             return action->fallback;
         }
 
@@ -323,22 +684,28 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
             }
         }
 
+        if (node != NULL) {
+            nxt_file_cache_release(task, node);
+        }
+
         nxt_http_request_error(task, r, status);
         return NULL;
     }
 
     f = nxt_mp_get(r->mem_pool, sizeof(nxt_file_t));
     if (nxt_slow_path(f == NULL)) {
-        goto fail;
-    }
+        if (node != NULL) {
+            nxt_file_cache_release(task, node);
 
-    *f = file;
+        } else {
+            nxt_file_close(task, &file);
+        }
 
-    ret = nxt_file_info(f, &fi);
-    if (nxt_slow_path(ret != NXT_OK)) {
         goto fail;
     }
 
+    *f = file;
+
     if (nxt_fast_path(nxt_is_file(&fi))) {
         r->status = NXT_HTTP_OK;
         r->resp.content_length_n = nxt_file_size(&fi);
@@ -355,7 +722,7 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
             goto fail;
         }
 
-        nxt_localtime(nxt_file_mtime(&fi), &tm);
+        nxt_gmtime(nxt_file_mtime(&fi), &tm);
 
         field->value = p;
         field->value_length = nxt_http_date(p, &tm) - p;
@@ -380,6 +747,30 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
                                           nxt_file_size(&fi))
                               - p;
 
+        etag.start = field->value;
+        etag.length = field->value_length;
+
+        status = nxt_http_static_conditional(r, &fi, &etag);
+
+        if (status == NXT_HTTP_PRECONDITION_FAILED) {
+            nxt_http_static_file_close(task, f, node);
+
+            nxt_http_request_error(task, r, status);
+            return NULL;
+        }
+
+        if (status == NXT_HTTP_NOT_MODIFIED) {
+            nxt_http_static_file_close(task, f, node);
+
+            r->status = NXT_HTTP_NOT_MODIFIED;
+            r->resp.content_length_n = -1;
+
+            nxt_http_request_header_send(task, r, NULL, NULL);
+
+            r->state = &nxt_http_static_send_state;
+            return NULL;
+        }
+
         if (exten.start == NULL) {
             nxt_http_static_extract_extension(r->path, &exten);
         }
@@ -398,44 +789,89 @@ nxt_http_static(nxt_task_t *task, nxt_http_request_t *r,
 
             field->value = mtype->start;
             field->value_length = mtype->length;
+
+            r->resp.content_type = field;
         }
 
-        if (need_body && nxt_file_size(&fi) > 0) {
-            fb = nxt_mp_zget(r->mem_pool, NXT_BUF_FILE_SIZE);
-            if (nxt_slow_path(fb == NULL)) {
+        if (ctx->encoding < NXT_HTTP_STATIC_IDENTITY) {
+            field = nxt_list_zero_add(r->resp.fields);
+            if (nxt_slow_path(field == NULL)) {
                 goto fail;
             }
 
-            fb->file = f;
-            fb->file_end = nxt_file_size(&fi);
+            nxt_http_field_name_set(field, "Content-Encoding");
 
-            r->out = fb;
+            coding = &nxt_http_static_encodings[ctx->encoding].name;
 
-            body_handler = &nxt_http_static_body_handler;
+            field->value = coding->start;
+            field->value_length = coding->length;
+        }
 
-        } else {
-            nxt_file_close(task, f);
-            body_handler = NULL;
+        if (conf->precompressed) {
+            field = nxt_list_zero_add(r->resp.fields);
+            if (nxt_slow_path(field == NULL)) {
+                goto fail;
+            }
+
+            nxt_http_field_set(field, "Vary", "Accept-Encoding");
+        }
+
+        if (ctx->need_body && nxt_file_size(&fi) > 0) {
+            fb = nxt_mp_zget(r->mem_pool, NXT_BUF_FILE_SIZE);
+            if (nxt_slow_path(fb == NULL)) {
+                goto fail;
+            }
+
+            fb->file = f;
+            fb->file_end = nxt_file_size(&fi);
+            fb->parent = node;
+
+            if (r->range != NULL) {
+                ret = nxt_http_static_range(task, r, fb, &fi, &etag, mtype);
+
+                if (nxt_slow_path(ret == NXT_ERROR)) {
+                    goto fail;
+                }
+
+                if (ret == NXT_DONE) {
+                    /* 416 Range Not Satisfiable. */
+                    nxt_http_static_file_close(task, f, node);
+
+                    nxt_http_request_header_send(task, r, NULL, NULL);
+
+                    r->state = &nxt_http_static_send_state;
+                    return NULL;
+                }
+            }
+
+            r->out = fb;
+
+            body_handler = &nxt_http_static_body_handler;
+
+        } else {
+            nxt_http_static_file_close(task, f, node);
+            body_handler = NULL;
         }
 
     } else {
         /* Not a file. */
 
-        nxt_file_close(task, f);
+        nxt_http_static_file_close(task, f, node);
 
         if (nxt_slow_path(!nxt_is_dir(&fi))) {
             if (action->fallback != NULL) {
                 return action->fallback;
             }
 
-            nxt_log(task, NXT_LOG_ERR, "\"%FN\" is not a regular file",
-                    f->name);
+            nxt_log(task, NXT_LOG_ERR, "\"%s\" is not a regular file",
+                    fname);
 
             nxt_http_request_error(task, r, NXT_HTTP_NOT_FOUND);
             return NULL;
         }
 
         f = NULL;
+        node = NULL;
 
         r->status = NXT_HTTP_MOVED_PERMANENTLY;
         r->resp.content_length_n = 0;
@@ -489,13 +925,124 @@ fail:
     nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
 
     if (f != NULL) {
-        nxt_file_close(task, f);
+        nxt_http_static_file_close(task, f, node);
     }
 
     return NULL;
 }
 
 
+static nxt_int_t
+nxt_http_static_open(nxt_task_t *task, nxt_http_static_conf_t *conf,
+    nxt_file_t *file, u_char **fname, size_t length)
+{
+    nxt_int_t  ret;
+#if (NXT_HAVE_OPENAT2)
+    nxt_str_t  *chroot;
+#endif
+
+    nxt_memzero(file, sizeof(nxt_file_t));
+
+    file->name = *fname;
+
+#if (NXT_HAVE_OPENAT2)
+    if (conf->resolve != 0) {
+        chroot = &conf->chroot;
+
+        if (chroot->length > 0) {
+            file->name = chroot->start;
+
+            if (length > chroot->length
+                && nxt_memcmp(*fname, chroot->start, chroot->length) == 0)
+            {
+                *fname += chroot->length;
+                ret = nxt_file_open(task, file, NXT_FILE_SEARCH, NXT_FILE_OPEN,
+                                    0);
+
+            } else {
+                file->error = NXT_EACCES;
+                ret = NXT_ERROR;
+            }
+
+        } else if ((*fname)[0] == '/') {
+            file->name = (u_char *) "/";
+            ret = nxt_file_open(task, file, NXT_FILE_SEARCH, NXT_FILE_OPEN, 0);
+
+        } else {
+            file->name = (u_char *) ".";
+            file->fd = AT_FDCWD;
+            ret = NXT_OK;
+        }
+
+        if (nxt_fast_path(ret == NXT_OK)) {
+            nxt_file_t  af;
+
+            af = *file;
+            nxt_memzero(file, sizeof(nxt_file_t));
+            file->name = *fname;
+
+            ret = nxt_file_openat2(task, file, NXT_FILE_RDONLY,
+                                   NXT_FILE_OPEN, 0, af.fd, conf->resolve);
+
+            if (af.fd != AT_FDCWD) {
+                nxt_file_close(task, &af);
+            }
+        }
+
+    } else {
+        ret = nxt_file_open(task, file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
+    }
+
+#else
+    ret = nxt_file_open(task, file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
+#endif
+
+    return ret;
+}
+
+
+/*
+ * The same file name may be opened with different "chroot" and symlink
+ * options, so they are the part of the cache key.  The key starts with
+ * the null-terminated file name.
+ */
+
+static nxt_int_t
+nxt_http_static_cache_key(nxt_http_request_t *r, nxt_http_static_conf_t *conf,
+    u_char *fname, size_t length, nxt_str_t *key)
+{
+    u_char  *p;
+
+    key->length = length + 1 + conf->chroot.length + NXT_INT_T_LEN;
+
+    key->start = nxt_mp_nget(r->mem_pool, key->length);
+    if (nxt_slow_path(key->start == NULL)) {
+        return NXT_ERROR;
+    }
+
+    p = nxt_cpymem(key->start, fname, length + 1);
+    p = nxt_cpymem(p, conf->chroot.start, conf->chroot.length);
+    p = nxt_sprintf(p, key->start + key->length, "%ui", conf->resolve);
+
+    key->length = p - key->start;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_http_static_file_close(nxt_task_t *task, nxt_file_t *f,
+    nxt_file_cache_node_t *node)
+{
+    if (node != NULL) {
+        nxt_file_cache_release(task, node);
+
+    } else {
+        nxt_file_close(task, f);
+    }
+}
+
+
 static void
 nxt_http_static_extract_extension(nxt_str_t *path, nxt_str_t *exten)
 {
@@ -523,11 +1070,544 @@ nxt_http_static_extract_extension(nxt_str_t *path, nxt_str_t *exten)
 }
 
 
+static nxt_http_status_t
+nxt_http_static_conditional(nxt_http_request_t *r, nxt_file_info_t *fi,
+    nxt_str_t *etag)
+{
+    nxt_time_t        since;
+    nxt_http_field_t  *field;
+
+    /* The evaluation order follows RFC 7232, Section 6. */
+
+    field = r->if_match;
+
+    if (field != NULL) {
+        if (!nxt_http_static_etag_match(field, etag, 0)) {
+            return NXT_HTTP_PRECONDITION_FAILED;
+        }
+
+    } else {
+        field = r->if_unmodified_since;
+
+        if (field != NULL) {
+            since = nxt_time_parse(field->value, field->value_length);
+
+            if (since != -1 && nxt_file_mtime(fi) > since) {
+                return NXT_HTTP_PRECONDITION_FAILED;
+            }
+        }
+    }
+
+    field = r->if_none_match;
+
+    if (field != NULL) {
+        if (nxt_http_static_etag_match(field, etag, 1)) {
+            return NXT_HTTP_NOT_MODIFIED;
+        }
+
+    } else {
+        field = r->if_modified_since;
+
+        if (field != NULL) {
+            since = nxt_time_parse(field->value, field->value_length);
+
+            if (since != -1 && nxt_file_mtime(fi) <= since) {
+                return NXT_HTTP_NOT_MODIFIED;
+            }
+        }
+    }
+
+    return NXT_HTTP_OK;
+}
+
+
+static nxt_bool_t
+nxt_http_static_etag_match(nxt_http_field_t *field, nxt_str_t *etag,
+    nxt_bool_t weak)
+{
+    u_char  *p, *end, *start;
+
+    p = field->value;
+    end = p + field->value_length;
+
+    while (p < end && *p == ' ') {
+        p++;
+    }
+
+    if (end - p == 1 && *p == '*') {
+        return 1;
+    }
+
+    while (p < end) {
+
+        if (*p == ' ' || *p == ',') {
+            p++;
+            continue;
+        }
+
+        start = p;
+
+        if (end - p > 2 && p[0] == 'W' && p[1] == '/') {
+            p += 2;
+
+            if (!weak) {
+                start = NULL;
+            }
+        }
+
+        if (*p != '"') {
+            return 0;
+        }
+
+        p = nxt_memchr(p + 1, '"', end - p - 1);
+        if (p == NULL) {
+            return 0;
+        }
+
+        p++;
+
+        if (start != NULL) {
+            if (weak && start[0] == 'W') {
+                start += 2;
+            }
+
+            if ((size_t) (p - start) == etag->length
+                && nxt_memcmp(start, etag->start, etag->length) == 0)
+            {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+static nxt_int_t
+nxt_http_static_range(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *fb,
+    nxt_file_info_t *fi, nxt_str_t *etag, nxt_str_t *mtype)
+{
+    u_char                   *p;
+    size_t                   length;
+    nxt_int_t                ret;
+    nxt_off_t                size;
+    nxt_time_t               time;
+    nxt_array_t              *ranges;
+    nxt_http_field_t         *field;
+    nxt_http_static_range_t  *range;
+
+    field = r->if_range;
+
+    if (field != NULL) {
+        if (field->value_length > 0
+            && (field->value[0] == '"' || field->value[0] == 'W'))
+        {
+            if (!nxt_http_static_etag_match(field, etag, 0)) {
+                return NXT_DECLINED;
+            }
+
+        } else {
+            time = nxt_time_parse(field->value, field->value_length);
+
+            if (time != nxt_file_mtime(fi)) {
+                return NXT_DECLINED;
+            }
+        }
+    }
+
+    size = nxt_file_size(fi);
+
+    ranges = nxt_array_create(r->mem_pool, 1, sizeof(nxt_http_static_range_t));
+    if (nxt_slow_path(ranges == NULL)) {
+        return NXT_ERROR;
+    }
+
+    ret = nxt_http_static_range_parse(r, size, ranges);
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
+    range = ranges->elts;
+
+    if (ranges->nelts == 0) {
+        r->status = NXT_HTTP_RANGE_NOT_SATISFIABLE;
+        r->resp.content_length_n = 0;
+
+        if (r->resp.content_type != NULL) {
+            r->resp.content_type->skip = 1;
+        }
+
+        length = nxt_length("bytes */") + NXT_OFF_T_LEN;
+
+    } else if (ranges->nelts == 1) {
+        r->status = NXT_HTTP_PARTIAL_CONTENT;
+        r->resp.content_length_n = range->end - range->start;
+
+        fb->file_pos = range->start;
+        fb->file_end = range->end;
+
+        length = nxt_length("bytes -/") + 3 * NXT_OFF_T_LEN;
+
+    } else {
+        return nxt_http_static_multipart(task, r, fb, ranges, size, mtype);
+    }
+
+    field = nxt_list_zero_add(r->resp.fields);
+    if (nxt_slow_path(field == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_http_field_name_set(field, "Content-Range");
+
+    p = nxt_mp_nget(r->mem_pool, length);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    field->value = p;
+
+    if (ranges->nelts == 0) {
+        p = nxt_sprintf(p, p + length, "bytes */%O", size);
+
+    } else {
+        p = nxt_sprintf(p, p + length, "bytes %O-%O/%O",
+                        range->start, range->end - 1, size);
+    }
+
+    field->value_length = p - field->value;
+
+    return (ranges->nelts == 0) ? NXT_DONE : NXT_OK;
+}
+
+
+/*
+ * nxt_http_static_range_parse() parses the "Range" header field value
+ * and fills the array with satisfiable ranges.  NXT_DECLINED is returned
+ * if the value is invalid or not worth processing, so the whole file
+ * should be sent.  An empty array means that no range is satisfiable.
+ *
+ * As RFC 9110, Section 14.3 allows, ranges that overlap or adjoin
+ * the previous one are coalesced, and ranges that are not in ascending
+ * order are not processed.
+ */
+
+static nxt_int_t
+nxt_http_static_range_parse(nxt_http_request_t *r, nxt_off_t size,
+    nxt_array_t *ranges)
+{
+    u_char                   *p, *end, *spec, *dash;
+    nxt_off_t                start, last;
+    nxt_str_t                first, second;
+    nxt_http_static_range_t  *range;
+
+    p = r->range->value;
+    end = p + r->range->value_length;
+
+    if (end - p < 6 || nxt_strncasecmp(p, (u_char *) "bytes=", 6) != 0) {
+        return NXT_DECLINED;
+    }
+
+    p += 6;
+    range = NULL;
+
+    while (p < end) {
+        spec = p;
+
+        p = nxt_memchr(spec, ',', end - spec);
+        if (p == NULL) {
+            p = end;
+        }
+
+        dash = nxt_memchr(spec, '-', p - spec);
+        if (dash == NULL) {
+            return NXT_DECLINED;
+        }
+
+        first.start = spec;
+        first.length = dash - spec;
+        nxt_http_static_trim(&first);
+
+        second.start = dash + 1;
+        second.length = p - second.start;
+        nxt_http_static_trim(&second);
+
+        p++;
+
+        if (second.length == 0) {
+            if (first.length == 0) {
+                return NXT_DECLINED;
+            }
+
+            last = NXT_OFF_T_MAX;
+
+        } else {
+            last = nxt_off_t_parse(second.start, second.length);
+            if (last < 0) {
+                return NXT_DECLINED;
+            }
+        }
+
+        if (first.length == 0) {
+            /* A suffix range: "-N" means the last N bytes. */
+            start = (last < size) ? size - last : 0;
+            last = size;
+
+        } else {
+            start = nxt_off_t_parse(first.start, first.length);
+            if (start < 0 || start > last) {
+                return NXT_DECLINED;
+            }
+
+            last = (last < size) ? last + 1 : size;
+        }
+
+        if (start >= last) {
+            /* An unsatisfiable range. */
+            continue;
+        }
+
+        if (range != NULL) {
+            if (start < range->start) {
+                return NXT_DECLINED;
+            }
+
+            if (start <= range->end) {
+                range->end = nxt_max(range->end, last);
+                continue;
+            }
+        }
+
+        if (ranges->nelts == NXT_HTTP_STATIC_MAX_RANGES) {
+            return NXT_DECLINED;
+        }
+
+        range = nxt_array_add(ranges);
+        if (nxt_slow_path(range == NULL)) {
+            return NXT_ERROR;
+        }
+
+        range->start = start;
+        range->end = last;
+        nxt_str_null(&range->header);
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_http_static_trim(nxt_str_t *str)
+{
+    while (str->length > 0 && str->start[0] == ' ') {
+        str->start++;
+        str->length--;
+    }
+
+    while (str->length > 0 && str->start[str->length - 1] == ' ') {
+        str->length--;
+    }
+}
+
+
+static nxt_int_t
+nxt_http_static_multipart(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *fb, nxt_array_t *ranges, nxt_off_t size, nxt_str_t *mtype)
+{
+    u_char                       *p, *end;
+    size_t                       length;
+    uint32_t                     boundary;
+    nxt_uint_t                   i;
+    nxt_off_t                    content_length;
+    nxt_http_field_t             *field;
+    nxt_http_static_range_t      *range;
+    nxt_http_static_multipart_t  *mp;
+
+    static const char  content_type[] = "multipart/byteranges; boundary=";
+
+    mp = nxt_mp_zget(r->mem_pool, sizeof(nxt_http_static_multipart_t));
+    if (nxt_slow_path(mp == NULL)) {
+        return NXT_ERROR;
+    }
+
+    /* The closing boundary is stored as an additional empty range. */
+
+    range = nxt_array_add(ranges);
+    if (nxt_slow_path(range == NULL)) {
+        return NXT_ERROR;
+    }
+
+    range->start = 0;
+    range->end = 0;
+
+    boundary = nxt_random(&task->thread->random);
+
+    length = 0;
+
+    if (mtype->length != 0) {
+        length = nxt_length("\r\nContent-Type: ") + mtype->length;
+    }
+
+    length += nxt_length("\r\n--") + 8
+              + nxt_length("\r\nContent-Range: bytes -/\r\n\r\n")
+              + 3 * NXT_OFF_T_LEN;
+
+    content_length = 0;
+    range = ranges->elts;
+
+    for (i = 0; i < ranges->nelts; i++) {
+        p = nxt_mp_nget(r->mem_pool, length);
+        if (nxt_slow_path(p == NULL)) {
+            return NXT_ERROR;
+        }
+
+        end = p + length;
+        range[i].header.start = p;
+
+        p = nxt_sprintf(p, end, "\r\n--%08xD", boundary);
+
+        if (i == ranges->nelts - 1) {
+            p = nxt_cpymem(p, "--\r\n", 4);
+
+        } else {
+            if (mtype->length != 0) {
+                p = nxt_sprintf(p, end, "\r\nContent-Type: %V", mtype);
+            }
+
+            p = nxt_sprintf(p, end, "\r\nContent-Range: bytes %O-%O/%O\r\n\r\n",
+                            range[i].start, range[i].end - 1, size);
+        }
+
+        range[i].header.length = p - range[i].header.start;
+
+        content_length += range[i].header.length
+                          + range[i].end - range[i].start;
+    }
+
+    field = r->resp.content_type;
+
+    if (field == NULL) {
+        field = nxt_list_zero_add(r->resp.fields);
+        if (nxt_slow_path(field == NULL)) {
+            return NXT_ERROR;
+        }
+
+        nxt_http_field_name_set(field, "Content-Type");
+
+        r->resp.content_type = field;
+    }
+
+    length = nxt_length(content_type) + 8;
+
+    p = nxt_mp_nget(r->mem_pool, length);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    field->value = p;
+    field->value_length = nxt_sprintf(p, p + length, "%s%08xD",
+                                      content_type, boundary)
+                          - p;
+
+    mp->ranges = range;
+    mp->nranges = ranges->nelts;
+    mp->current = 0;
+    mp->header = range[0].header;
+
+    fb->file_pos = range[0].start;
+    fb->file_end = range[0].end;
+    fb->data = mp;
+
+    r->status = NXT_HTTP_PARTIAL_CONTENT;
+    r->resp.content_length_n = content_length;
+
+    return NXT_OK;
+}
+
+
+/*
+ * nxt_http_static_multipart_read() fills the buffer with the part headers
+ * and the ranges data.  It returns a pointer to the end of the filled data
+ * or NULL on error.  The multipart context current part is set to the
+ * number of parts after the last part has been completely read.
+ */
+
+static u_char *
+nxt_http_static_multipart_read(nxt_task_t *task, nxt_buf_t *fb, u_char *p,
+    u_char *end)
+{
+    size_t                       size;
+    ssize_t                      n;
+    nxt_off_t                    rest;
+    nxt_http_static_range_t      *range;
+    nxt_http_static_multipart_t  *mp;
+
+    mp = fb->data;
+
+    while (p < end) {
+
+        if (mp->header.length != 0) {
+            size = nxt_min(mp->header.length, (size_t) (end - p));
+
+            p = nxt_cpymem(p, mp->header.start, size);
+
+            mp->header.start += size;
+            mp->header.length -= size;
+
+            continue;
+        }
+
+        rest = fb->file_end - fb->file_pos;
+
+        if (rest != 0) {
+            size = nxt_min(rest, end - p);
+
+            n = nxt_file_read(fb->file, p, size, fb->file_pos);
+
+            if (n != (ssize_t) size) {
+                if (n >= 0) {
+                    nxt_log(task, NXT_LOG_ERR, "file \"%FN\" has changed "
+                            "while sending response to a client",
+                            fb->file->name);
+                }
+
+                return NULL;
+            }
+
+            fb->file_pos += n;
+            p += n;
+
+            continue;
+        }
+
+        if (++mp->current == mp->nranges) {
+            break;
+        }
+
+        range = &mp->ranges[mp->current];
+
+        mp->header = range->header;
+
+        fb->file_pos = range->start;
+        fb->file_end = range->end;
+    }
+
+    if (mp->current == mp->nranges - 1
+        && mp->header.length == 0
+        && fb->file_pos == fb->file_end)
+    {
+        /* The closing boundary has been read. */
+        mp->current = mp->nranges;
+    }
+
+    return p;
+}
+
+
 static void
 nxt_http_static_body_handler(nxt_task_t *task, void *obj, void *data)
 {
     size_t              alloc;
-    nxt_buf_t           *fb, *b, **next, *out;
+    nxt_buf_t           *b, **next, *out, *fb;
     nxt_off_t           rest;
     nxt_int_t           n;
     nxt_work_queue_t    *wq;
@@ -536,7 +1616,45 @@ nxt_http_static_body_handler(nxt_task_t *task, void *obj, void *data)
     r = obj;
     fb = r->out;
 
-    rest = fb->file_end - fb->file_pos;
+    /*
+     * On plain connections and if the kernel encrypts the TLS records,
+     * the file is sent with sendfile(), unless the body is compressed
+     * or stored in a cache.
+     */
+
+    if ((r->tls == NULL || r->ktls) && r->cache == NULL
+#if (NXT_HAVE_ZLIB)
+        && r->compressor == NULL
+#endif
+       )
+    {
+        if (fb->data != NULL) {
+            out = nxt_http_static_multipart_bufs(task, r, fb);
+
+        } else {
+            out = fb;
+            fb->next = nxt_http_buf_last(r);
+        }
+
+        if (nxt_fast_path(out != NULL)) {
+            r->out = NULL;
+
+            nxt_buf_set_file(fb);
+
+            fb->data = fb->parent;
+            fb->parent = r;
+            fb->completion_handler = nxt_http_static_file_completion;
+
+            nxt_mp_retain(r->mem_pool);
+
+            nxt_http_request_send(task, r, out);
+            return;
+        }
+
+        /* The multipart body is read into memory buffers. */
+    }
+
+    rest = r->resp.content_length_n;
     out = NULL;
     next = &out;
     n = 0;
@@ -588,10 +1706,13 @@ static const nxt_http_request_state_t  nxt_http_static_send_state
 static void
 nxt_http_static_buf_completion(nxt_task_t *task, void *obj, void *data)
 {
-    ssize_t             n, size;
-    nxt_buf_t           *b, *fb, *next;
-    nxt_off_t           rest;
-    nxt_http_request_t  *r;
+    u_char                       *p;
+    ssize_t                      n, size;
+    nxt_buf_t                    *b, *fb, *next;
+    nxt_off_t                    rest;
+    nxt_bool_t                   done;
+    nxt_http_request_t           *r;
+    nxt_http_static_multipart_t  *mp;
 
     b = obj;
     r = data;
@@ -604,33 +1725,50 @@ complete_buf:
         goto clean;
     }
 
-    rest = fb->file_end - fb->file_pos;
-    size = nxt_buf_mem_size(&b->mem);
+    mp = fb->data;
+
+    if (mp != NULL) {
+        p = nxt_http_static_multipart_read(task, fb, b->mem.start, b->mem.end);
+
+        if (nxt_slow_path(p == NULL)) {
+            nxt_http_request_error_handler(task, r, r->proto.any);
+            goto clean;
+        }
+
+        n = p - b->mem.start;
+        done = (mp->current == mp->nranges);
 
-    size = nxt_min(rest, (nxt_off_t) size);
+    } else {
+        rest = fb->file_end - fb->file_pos;
+        size = nxt_buf_mem_size(&b->mem);
+
+        size = nxt_min(rest, (nxt_off_t) size);
 
-    n = nxt_file_read(fb->file, b->mem.start, size, fb->file_pos);
+        n = nxt_file_read(fb->file, b->mem.start, size, fb->file_pos);
+
+        if (n != size) {
+            if (n >= 0) {
+                nxt_log(task, NXT_LOG_ERR, "file \"%FN\" has changed "
+                        "while sending response to a client", fb->file->name);
+            }
 
-    if (n != size) {
-        if (n >= 0) {
-            nxt_log(task, NXT_LOG_ERR, "file \"%FN\" has changed "
-                    "while sending response to a client", fb->file->name);
+            nxt_http_request_error_handler(task, r, r->proto.any);
+            goto clean;
         }
 
-        nxt_http_request_error_handler(task, r, r->proto.any);
-        goto clean;
+        fb->file_pos += n;
+        done = (n == rest);
     }
 
     next = b->next;
 
-    if (n == rest) {
-        nxt_file_close(task, fb->file);
+    if (done) {
+        nxt_http_static_file_close(task, fb->file, fb->parent);
         r->out = NULL;
 
         b->next = nxt_http_buf_last(r);
 
     } else {
-        fb->file_pos += n;
         b->next = NULL;
     }
 
@@ -658,12 +1796,141 @@ clean:
     } while (b != NULL);
 
     if (fb != NULL) {
-        nxt_file_close(task, fb->file);
+        nxt_http_static_file_close(task, fb->file, fb->parent);
         r->out = NULL;
     }
 }
 
 
+static void
+nxt_http_static_file_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b;
+    nxt_http_request_t  *r;
+
+    b = obj;
+    r = data;
+
+    nxt_http_static_file_close(task, b->file, b->data);
+
+    /* The file buffer is allocated with nxt_mp_zget(). */
+
+    nxt_mp_release(r->mem_pool);
+}
+
+
+/*
+ * nxt_http_static_multipart_bufs() links the part headers as memory
+ * buffers and the ranges as file buffers.  The file buffer of the last
+ * range is the original one, its completion closes the file after all
+ * the ranges have been sent.
+ */
+
+static nxt_buf_t *
+nxt_http_static_multipart_bufs(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *fb)
+{
+    nxt_buf_t                    *b, *out, **next;
+    nxt_uint_t                   i;
+    nxt_http_static_range_t      *range;
+    nxt_http_static_multipart_t  *mp;
+
+    mp = fb->data;
+    range = mp->ranges;
+
+    out = NULL;
+    next = &out;
+
+    for (i = 0; i < mp->nranges; i++) {
+        b = nxt_buf_mem_alloc(r->mem_pool, 0, 0);
+        if (nxt_slow_path(b == NULL)) {
+            goto fail;
+        }
+
+        b->mem.start = range[i].header.start;
+        b->mem.pos = b->mem.start;
+        b->mem.free = b->mem.start + range[i].header.length;
+        b->mem.end = b->mem.free;
+
+        b->completion_handler = nxt_http_static_part_completion;
+        b->parent = r;
+
+        nxt_mp_retain(r->mem_pool);
+
+        *next = b;
+        next = &b->next;
+
+        /* The last range is the closing boundary. */
+
+        if (i == mp->nranges - 1) {
+            break;
+        }
+
+        if (i == mp->nranges - 2) {
+            b = fb;
+
+        } else {
+            b = nxt_buf_file_alloc(r->mem_pool, 0, 0);
+            if (nxt_slow_path(b == NULL)) {
+                goto fail;
+            }
+
+            b->file = fb->file;
+            b->completion_handler = nxt_http_static_part_completion;
+            b->parent = r;
+
+            nxt_mp_retain(r->mem_pool);
+        }
+
+        b->file_pos = range[i].start;
+        b->file_end = range[i].end;
+
+        *next = b;
+        next = &b->next;
+    }
+
+    *next = nxt_http_buf_last(r);
+
+    return out;
+
+fail:
+
+    while (out != NULL) {
+        b = out;
+        out = b->next;
+
+        if (b != fb) {
+            nxt_mp_free(r->mem_pool, b);
+            nxt_mp_release(r->mem_pool);
+        }
+    }
+
+    fb->next = NULL;
+
+    return NULL;
+}
+
+
+static void
+nxt_http_static_part_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b, *next;
+    nxt_http_request_t  *r;
+
+    b = obj;
+    r = data;
+
+    do {
+        next = b->next;
+
+        nxt_mp_free(r->mem_pool, b);
+        nxt_mp_release(r->mem_pool);
+
+        b = next;
+    } while (b != NULL);
+}
+
+
 nxt_int_t
 nxt_http_static_mtypes_init(nxt_mp_t *mp, nxt_lvlhsh_t *hash)
 {
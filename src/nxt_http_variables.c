@@ -13,6 +13,32 @@ static nxt_int_t nxt_http_var_uri(nxt_task_t *task, nxt_var_query_t *query,
     nxt_str_t *str, void *ctx);
 static nxt_int_t nxt_http_var_host(nxt_task_t *task, nxt_var_query_t *query,
     nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_request_uri(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_remote_addr(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_time_local(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static u_char *nxt_http_var_time_local_format(u_char *buf, nxt_realtime_t *now,
+    struct tm *tm, size_t size, const char *format);
+static nxt_int_t nxt_http_var_request_line(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_status(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_body_bytes_sent(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_bytes_received(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_request_time(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_upstream_response_time(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_msec(nxt_http_request_t *r, nxt_str_t *str,
+    nxt_nsec_t time);
+static nxt_int_t nxt_http_var_referer(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
+static nxt_int_t nxt_http_var_user_agent(nxt_task_t *task,
+    nxt_var_query_t *query, nxt_str_t *str, void *ctx);
 
 
 static nxt_var_decl_t  nxt_http_vars[] = {
@@ -27,6 +53,50 @@ static nxt_var_decl_t  nxt_http_vars[] = {
     { nxt_string("host"),
       &nxt_http_var_host,
       0 },
+
+    { nxt_string("request_uri"),
+      &nxt_http_var_request_uri,
+      0 },
+
+    { nxt_string("remote_addr"),
+      &nxt_http_var_remote_addr,
+      0 },
+
+    { nxt_string("time_local"),
+      &nxt_http_var_time_local,
+      0 },
+
+    { nxt_string("request_line"),
+      &nxt_http_var_request_line,
+      0 },
+
+    { nxt_string("status"),
+      &nxt_http_var_status,
+      0 },
+
+    { nxt_string("body_bytes_sent"),
+      &nxt_http_var_body_bytes_sent,
+      0 },
+
+    { nxt_string("bytes_received"),
+      &nxt_http_var_bytes_received,
+      0 },
+
+    { nxt_string("request_time"),
+      &nxt_http_var_request_time,
+      0 },
+
+    { nxt_string("upstream_response_time"),
+      &nxt_http_var_upstream_response_time,
+      0 },
+
+    { nxt_string("header_referer"),
+      &nxt_http_var_referer,
+      0 },
+
+    { nxt_string("header_user_agent"),
+      &nxt_http_var_user_agent,
+      0 },
 };
 
 
@@ -77,3 +147,289 @@ nxt_http_var_host(nxt_task_t *task, nxt_var_query_t *query, nxt_str_t *str,
 
     return NXT_OK;
 }
+
+
+static nxt_int_t
+nxt_http_var_request_uri(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    *str = r->target;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_remote_addr(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    str->length = r->remote->address_length;
+    str->start = nxt_sockaddr_address(r->remote);
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_time_local(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    u_char              *p;
+    nxt_http_request_t  *r;
+
+    static nxt_time_string_t  date_cache = {
+        (nxt_atomic_uint_t) -1,
+        nxt_http_var_time_local_format,
+        "%02d/%s/%4d:%02d:%02d:%02d %c%02d%02d",
+        nxt_length("31/Dec/1986:19:40:00 +0300"),
+        NXT_THREAD_TIME_LOCAL,
+        NXT_THREAD_TIME_SEC,
+    };
+
+    r = ctx;
+
+    p = nxt_mp_nget(r->mem_pool, date_cache.size);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    str->start = p;
+    str->length = nxt_thread_time_string(task->thread, &date_cache, p) - p;
+
+    return NXT_OK;
+}
+
+
+static u_char *
+nxt_http_var_time_local_format(u_char *buf, nxt_realtime_t *now, struct tm *tm,
+    size_t size, const char *format)
+{
+    u_char  sign;
+    time_t  gmtoff;
+
+    static const char  *month[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    gmtoff = nxt_timezone(tm) / 60;
+
+    if (gmtoff < 0) {
+        gmtoff = -gmtoff;
+        sign = '-';
+
+    } else {
+        sign = '+';
+    }
+
+    return nxt_sprintf(buf, buf + size, format,
+                       tm->tm_mday, month[tm->tm_mon], tm->tm_year + 1900,
+                       tm->tm_hour, tm->tm_min, tm->tm_sec,
+                       sign, gmtoff / 60, gmtoff % 60);
+}
+
+
+static nxt_int_t
+nxt_http_var_request_line(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    u_char              *p;
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    if (r->method->length == 0) {
+        nxt_str_set(str, "-");
+        return NXT_OK;
+    }
+
+    p = nxt_mp_nget(r->mem_pool, r->method->length + 1 + r->target.length
+                                 + 1 + r->version.length);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    str->start = p;
+
+    p = nxt_cpymem(p, r->method->start, r->method->length);
+
+    if (r->target.length != 0) {
+        *p++ = ' ';
+        p = nxt_cpymem(p, r->target.start, r->target.length);
+
+        if (r->version.length != 0) {
+            *p++ = ' ';
+            p = nxt_cpymem(p, r->version.start, r->version.length);
+        }
+    }
+
+    str->length = p - str->start;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_status(nxt_task_t *task, nxt_var_query_t *query, nxt_str_t *str,
+    void *ctx)
+{
+    u_char              *p;
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    p = nxt_mp_nget(r->mem_pool, 3);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    str->start = p;
+    str->length = nxt_sprintf(p, p + 3, "%03d", r->status) - p;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_body_bytes_sent(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    u_char              *p;
+    nxt_off_t           bytes;
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    p = nxt_mp_nget(r->mem_pool, NXT_OFF_T_LEN);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    bytes = nxt_http_proto[r->protocol].body_bytes_sent(task, r->proto);
+
+    str->start = p;
+    str->length = nxt_sprintf(p, p + NXT_OFF_T_LEN, "%O", bytes) - p;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_bytes_received(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    u_char              *p;
+    nxt_off_t           bytes;
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    p = nxt_mp_nget(r->mem_pool, NXT_OFF_T_LEN);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    bytes = nxt_http_proto[r->protocol].bytes_received(task, r->proto);
+
+    str->start = p;
+    str->length = nxt_sprintf(p, p + NXT_OFF_T_LEN, "%O", bytes) - p;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_request_time(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    return nxt_http_var_msec(r, str,
+                             nxt_thread_monotonic_time(task->thread) - r->start);
+}
+
+
+static nxt_int_t
+nxt_http_var_upstream_response_time(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    if (r->upstream_end == 0) {
+        nxt_str_set(str, "-");
+        return NXT_OK;
+    }
+
+    return nxt_http_var_msec(r, str, r->upstream_end - r->upstream_start);
+}
+
+
+static nxt_int_t
+nxt_http_var_msec(nxt_http_request_t *r, nxt_str_t *str, nxt_nsec_t time)
+{
+    u_char    *p;
+    uint64_t  ms;
+
+    p = nxt_mp_nget(r->mem_pool, NXT_INT64_T_LEN + 4);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    ms = time / 1000000;
+
+    str->start = p;
+    str->length = nxt_sprintf(p, p + NXT_INT64_T_LEN + 4, "%uL.%03uL",
+                              ms / 1000, ms % 1000) - p;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_referer(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    if (r->referer != NULL) {
+        str->start = r->referer->value;
+        str->length = r->referer->value_length;
+
+    } else {
+        nxt_str_null(str);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_var_user_agent(nxt_task_t *task, nxt_var_query_t *query,
+    nxt_str_t *str, void *ctx)
+{
+    nxt_http_request_t  *r;
+
+    r = ctx;
+
+    if (r->user_agent != NULL) {
+        str->start = r->user_agent->value;
+        str->length = r->user_agent->value_length;
+
+    } else {
+        nxt_str_null(str);
+    }
+
+    return NXT_OK;
+}
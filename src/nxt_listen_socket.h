@@ -13,6 +13,10 @@ typedef struct {
     nxt_socket_t              socket;
     int                       backlog;
 
+    /* The SO_REUSEPORT sockets, one per router engine thread. */
+    nxt_socket_t              *sockets;
+    uint32_t                  nsockets;
+
     nxt_work_queue_t          *work_queue;
     nxt_work_handler_t        handler;
 
@@ -140,6 +140,7 @@ typedef void (*nxt_event_conn_handler_t)(nxt_thread_t *thr, nxt_conn_t *c);
 #include <nxt_listen_socket.h>
 
 #include <nxt_conn.h>
+#include <nxt_file_cache.h>
 #include <nxt_event_engine.h>
 
 #include <nxt_job.h>
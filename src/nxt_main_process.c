@@ -31,6 +31,43 @@ typedef struct {
 } nxt_conf_app_map_t;
 
 
+#if (NXT_HAVE_CLONE)
+
+/*
+ * An application prototype process forks new application processes.
+ * The prototype is shared by all processes of the same application
+ * generation and configuration and exits with its last process.
+ */
+
+typedef struct {
+    nxt_queue_link_t       link;
+
+    nxt_mp_t               *mem_pool;
+    nxt_str_t              key;
+    nxt_common_app_conf_t  *conf;
+
+    /* -1 if the prototype process has exited. */
+    nxt_pid_t              pid;
+
+    /* Both the pending and the forked application processes. */
+    nxt_uint_t             nprocesses;
+    nxt_queue_t            pending;
+
+    uint8_t                ready;     /* 1 bit */
+    uint8_t                quitting;  /* 1 bit */
+} nxt_main_proto_t;
+
+
+typedef struct {
+    nxt_queue_link_t       link;
+    nxt_main_proto_t       *proto;
+    nxt_process_t          *process;
+    nxt_port_t             *reply_port;
+} nxt_main_proto_fork_t;
+
+#endif
+
+
 extern nxt_port_handlers_t  nxt_controller_process_port_handlers;
 extern nxt_port_handlers_t  nxt_router_process_port_handlers;
 
@@ -57,7 +94,7 @@ static void nxt_main_cleanup_process(nxt_task_t *task, nxt_pid_t pid);
 static void nxt_main_port_socket_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
 static nxt_int_t nxt_main_listening_socket(nxt_sockaddr_t *sa,
-    nxt_listening_socket_t *ls);
+    nxt_bool_t reuseport, nxt_listening_socket_t *ls);
 static void nxt_main_port_modules_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
 static int nxt_cdecl nxt_app_lang_compare(const void *v1, const void *v2);
@@ -65,6 +102,29 @@ static void nxt_main_port_conf_store_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
 static void nxt_main_port_access_log_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
+static nxt_common_app_conf_t *nxt_main_app_conf(nxt_task_t *task, nxt_mp_t *mp,
+    u_char *start, u_char *end);
+static void nxt_main_process_ready_handler(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg);
+#if (NXT_HAVE_CLONE)
+static void nxt_main_proto_spawn(nxt_task_t *task, nxt_process_t *process,
+    nxt_port_t *reply_port, nxt_buf_t *b);
+static nxt_main_proto_t *nxt_main_proto_create(nxt_task_t *task,
+    nxt_str_t *key);
+static nxt_int_t nxt_main_proto_start(nxt_task_t *task,
+    nxt_main_proto_t *proto);
+static void nxt_main_proto_fork(nxt_task_t *task, nxt_main_proto_fork_t *fork);
+static void nxt_main_proto_fork_ready(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg, void *data);
+static void nxt_main_proto_fork_error(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg, void *data);
+static void nxt_main_proto_fork_fail(nxt_task_t *task,
+    nxt_main_proto_fork_t *fork);
+static void nxt_main_proto_release(nxt_task_t *task, nxt_main_proto_t *proto);
+static void nxt_main_proto_exited(nxt_task_t *task, nxt_pid_t pid);
+static void nxt_main_proto_process_exited(nxt_task_t *task,
+    nxt_common_app_conf_t *conf);
+#endif
 
 const nxt_sig_event_t  nxt_main_process_signals[] = {
     nxt_event_signal(SIGHUP,  nxt_main_process_signal_handler),
@@ -79,6 +139,10 @@ const nxt_sig_event_t  nxt_main_process_signals[] = {
 
 static nxt_bool_t  nxt_exiting;
 
+#if (NXT_HAVE_CLONE)
+static nxt_queue_t  nxt_main_protos;
+#endif
+
 
 nxt_int_t
 nxt_main_process_start(nxt_thread_t *thr, nxt_task_t *task,
@@ -86,12 +150,31 @@ nxt_main_process_start(nxt_thread_t *thr, nxt_task_t *task,
 {
     rt->type = NXT_PROCESS_MAIN;
 
+#if (NXT_HAVE_CLONE)
+    nxt_queue_init(&nxt_main_protos);
+#endif
+
     if (nxt_main_process_port_create(task, rt) != NXT_OK) {
         return NXT_ERROR;
     }
 
     nxt_main_process_title(task);
 
+#if (NXT_TLS)
+    /*
+     * The TLS session cache is inherited by the router process,
+     * so it survives the router restarts.  The pages are allocated
+     * on the first use.
+     */
+    rt->tls_sessions = nxt_mem_mmap(NULL, sizeof(nxt_tls_sessions_t),
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_ANON | MAP_SHARED, -1, 0);
+
+    if (nxt_slow_path(rt->tls_sessions == MAP_FAILED)) {
+        rt->tls_sessions = NULL;
+    }
+#endif
+
     /*
      * The discovery process will send a message processed by
      * nxt_main_port_modules_handler() which starts the controller
@@ -144,6 +227,12 @@ static nxt_conf_map_t  nxt_common_app_conf[] = {
         offsetof(nxt_common_app_conf_t, limits),
     },
 
+    {
+        nxt_string("prototype"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_common_app_conf_t, prototype),
+    },
+
 };
 
 
@@ -157,6 +246,16 @@ static nxt_conf_map_t  nxt_common_app_limits_conf[] = {
 };
 
 
+static nxt_conf_map_t  nxt_common_app_prototype_conf[] = {
+    {
+        nxt_string("preload"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_common_app_conf_t, preload),
+    },
+
+};
+
+
 static nxt_conf_map_t  nxt_external_app_conf[] = {
     {
         nxt_string("executable"),
@@ -335,15 +434,12 @@ nxt_port_main_data_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 static void
 nxt_port_main_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 {
-    u_char                 *start, *p, ch;
-    size_t                 type_len;
+    u_char                 *p;
     nxt_int_t              ret;
     nxt_buf_t              *b;
     nxt_port_t             *port;
     nxt_runtime_t          *rt;
     nxt_process_t          *process;
-    nxt_app_type_t         idx;
-    nxt_conf_value_t       *conf;
     nxt_process_init_t     *init;
     nxt_common_app_conf_t  *app_conf;
 
@@ -366,17 +462,13 @@ nxt_port_main_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     nxt_debug(task, "main start process: %*s", b->mem.free - b->mem.pos,
               b->mem.pos);
 
-    app_conf = nxt_mp_zalloc(process->mem_pool, sizeof(nxt_common_app_conf_t));
+    app_conf = nxt_main_app_conf(task, process->mem_pool, b->mem.pos,
+                                 b->mem.free);
     if (nxt_slow_path(app_conf == NULL)) {
         goto failed;
     }
 
-    start = b->mem.pos;
-
-    app_conf->name.start = start;
-    app_conf->name.length = nxt_strlen(start);
-
-    init->name = (const char *) start;
+    init->name = (const char *) app_conf->name.start;
 
     process->name = nxt_mp_alloc(process->mem_pool, app_conf->name.length
                                  + sizeof("\"\" application") + 1);
@@ -391,15 +483,78 @@ nxt_port_main_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     p = nxt_cpymem(p, "\" application", 13);
     *p = '\0';
 
+    process->stream = msg->port_msg.stream;
+    process->data.app = app_conf;
+
+#if (NXT_HAVE_CLONE)
+
+    /* Isolated processes still have to be created by the main process. */
+
+    if (app_conf->prototype != NULL && app_conf->isolation == NULL) {
+        port = nxt_runtime_port_find(rt, msg->port_msg.pid,
+                                     msg->port_msg.reply_port);
+
+        if (nxt_slow_path(port == NULL)) {
+            goto failed;
+        }
+
+        nxt_main_proto_spawn(task, process, port, b);
+
+        return;
+    }
+
+#endif
+
+    ret = nxt_main_start_process(task, process);
+    if (nxt_fast_path(ret == NXT_OK || ret == NXT_AGAIN)) {
+        return;
+    }
+
+failed:
+
+    nxt_process_use(task, process, -1);
+
+    port = nxt_runtime_port_find(rt, msg->port_msg.pid,
+                                 msg->port_msg.reply_port);
+
+    if (nxt_fast_path(port != NULL)) {
+        nxt_port_socket_write(task, port, NXT_PORT_MSG_RPC_ERROR,
+                              -1, msg->port_msg.stream, 0, NULL);
+    }
+}
+
+
+static nxt_common_app_conf_t *
+nxt_main_app_conf(nxt_task_t *task, nxt_mp_t *mp, u_char *start, u_char *end)
+{
+    u_char                 ch;
+    size_t                 type_len;
+    nxt_int_t              ret;
+    nxt_runtime_t          *rt;
+    nxt_app_type_t         idx;
+    nxt_conf_value_t       *conf;
+    nxt_common_app_conf_t  *app_conf;
+
+    app_conf = nxt_mp_zalloc(mp, sizeof(nxt_common_app_conf_t));
+    if (nxt_slow_path(app_conf == NULL)) {
+        return NULL;
+    }
+
+    app_conf->name.start = start;
+    app_conf->name.length = nxt_strlen(start);
+
     app_conf->shm_limit = 100 * 1024 * 1024;
 
     start += app_conf->name.length + 1;
 
-    conf = nxt_conf_json_parse(process->mem_pool, start, b->mem.free, NULL);
+    /* Skip the application generation. */
+    start += nxt_strlen(start) + 1;
+
+    conf = nxt_conf_json_parse(mp, start, end, NULL);
     if (conf == NULL) {
         nxt_alert(task, "router app configuration parsing error");
 
-        goto failed;
+        return NULL;
     }
 
     rt = task->thread->runtime;
@@ -407,12 +562,12 @@ nxt_port_main_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     app_conf->user.start  = (u_char*)rt->user_cred.user;
     app_conf->user.length = nxt_strlen(rt->user_cred.user);
 
-    ret = nxt_conf_map_object(process->mem_pool, conf, nxt_common_app_conf,
+    ret = nxt_conf_map_object(mp, conf, nxt_common_app_conf,
                               nxt_nitems(nxt_common_app_conf), app_conf);
 
     if (ret != NXT_OK) {
         nxt_alert(task, "failed to map common app conf received from router");
-        goto failed;
+        return NULL;
     }
 
     for (type_len = 0; type_len != app_conf->type.length; type_len++) {
@@ -427,53 +582,516 @@ nxt_port_main_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
     if (nxt_slow_path(idx >= nxt_nitems(nxt_app_maps))) {
         nxt_alert(task, "invalid app type %d received from router", (int) idx);
-        goto failed;
+        return NULL;
     }
 
-    ret = nxt_conf_map_object(process->mem_pool, conf, nxt_app_maps[idx].map,
+    ret = nxt_conf_map_object(mp, conf, nxt_app_maps[idx].map,
                               nxt_app_maps[idx].size, app_conf);
 
     if (nxt_slow_path(ret != NXT_OK)) {
         nxt_alert(task, "failed to map app conf received from router");
-        goto failed;
+        return NULL;
     }
 
     if (app_conf->limits != NULL) {
-        ret = nxt_conf_map_object(process->mem_pool, app_conf->limits,
+        ret = nxt_conf_map_object(mp, app_conf->limits,
                                   nxt_common_app_limits_conf,
                                   nxt_nitems(nxt_common_app_limits_conf),
                                   app_conf);
 
         if (nxt_slow_path(ret != NXT_OK)) {
             nxt_alert(task, "failed to map app limits received from router");
-            goto failed;
+            return NULL;
+        }
+    }
+
+    if (app_conf->prototype != NULL) {
+        ret = nxt_conf_map_object(mp, app_conf->prototype,
+                                  nxt_common_app_prototype_conf,
+                                  nxt_nitems(nxt_common_app_prototype_conf),
+                                  app_conf);
+
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_alert(task, "failed to map app prototype received from router");
+            return NULL;
         }
     }
 
     app_conf->self = conf;
 
-    process->stream = msg->port_msg.stream;
-    process->data.app = app_conf;
+    return app_conf;
+}
 
-    ret = nxt_main_start_process(task, process);
-    if (nxt_fast_path(ret == NXT_OK || ret == NXT_AGAIN)) {
+
+#if (NXT_HAVE_CLONE)
+
+static void
+nxt_main_proto_spawn(nxt_task_t *task, nxt_process_t *process,
+    nxt_port_t *reply_port, nxt_buf_t *b)
+{
+    nxt_int_t              ret;
+    nxt_str_t              key;
+    nxt_main_proto_t       *proto;
+    nxt_main_proto_fork_t  *fork;
+
+    key.start = b->mem.pos;
+    key.length = b->mem.free - b->mem.pos;
+
+    nxt_queue_each(proto, &nxt_main_protos, nxt_main_proto_t, link) {
+
+        if (proto->pid != -1
+            && !proto->quitting
+            && nxt_strstr_eq(&proto->key, &key))
+        {
+            goto found;
+        }
+
+    } nxt_queue_loop;
+
+    proto = nxt_main_proto_create(task, &key);
+    if (nxt_slow_path(proto == NULL)) {
+        goto fail;
+    }
+
+    ret = nxt_main_proto_start(task, proto);
+
+    if (ret == NXT_AGAIN) {
+        /* The prototype process. */
+        nxt_process_use(task, process, -1);
         return;
     }
 
-failed:
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_queue_remove(&proto->link);
+        nxt_mp_destroy(proto->mem_pool);
+
+        goto fail;
+    }
+
+found:
+
+    fork = nxt_mp_zalloc(process->mem_pool, sizeof(nxt_main_proto_fork_t));
+    if (nxt_slow_path(fork == NULL)) {
+        goto fail;
+    }
+
+    fork->proto = proto;
+    fork->process = process;
+    fork->reply_port = reply_port;
+
+    nxt_port_use(task, reply_port, 1);
+
+    process->data.app = proto->conf;
+
+    proto->nprocesses++;
+
+    if (proto->ready) {
+        nxt_main_proto_fork(task, fork);
+
+    } else {
+        nxt_queue_insert_tail(&proto->pending, &fork->link);
+    }
+
+    return;
+
+fail:
+
+    nxt_port_socket_write(task, reply_port, NXT_PORT_MSG_RPC_ERROR,
+                          -1, process->stream, 0, NULL);
 
     nxt_process_use(task, process, -1);
+}
 
-    port = nxt_runtime_port_find(rt, msg->port_msg.pid,
-                                 msg->port_msg.reply_port);
+
+static nxt_main_proto_t *
+nxt_main_proto_create(nxt_task_t *task, nxt_str_t *key)
+{
+    u_char            *p;
+    nxt_mp_t          *mp;
+    nxt_main_proto_t  *proto;
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return NULL;
+    }
+
+    proto = nxt_mp_zalloc(mp, sizeof(nxt_main_proto_t));
+    if (nxt_slow_path(proto == NULL)) {
+        goto fail;
+    }
+
+    p = nxt_mp_nget(mp, key->length);
+    if (nxt_slow_path(p == NULL)) {
+        goto fail;
+    }
+
+    nxt_memcpy(p, key->start, key->length);
+
+    proto->key.start = p;
+    proto->key.length = key->length;
+
+    proto->conf = nxt_main_app_conf(task, mp, p, p + key->length);
+    if (nxt_slow_path(proto->conf == NULL)) {
+        goto fail;
+    }
+
+    proto->mem_pool = mp;
+
+    nxt_queue_init(&proto->pending);
+    nxt_queue_insert_tail(&nxt_main_protos, &proto->link);
+
+    return proto;
+
+fail:
+
+    nxt_mp_destroy(mp);
+
+    return NULL;
+}
+
+
+static nxt_int_t
+nxt_main_proto_start(nxt_task_t *task, nxt_main_proto_t *proto)
+{
+    u_char              *p;
+    nxt_int_t           ret;
+    nxt_runtime_t       *rt;
+    nxt_process_t       *process;
+    nxt_process_init_t  *init;
+
+    rt = task->thread->runtime;
+
+    process = nxt_main_process_new(task, rt);
+    if (nxt_slow_path(process == NULL)) {
+        return NXT_ERROR;
+    }
+
+    init = nxt_process_init(process);
+
+    *init = nxt_proto_process;
+
+    init->name = (const char *) proto->conf->name.start;
+
+    process->name = nxt_mp_alloc(process->mem_pool, proto->conf->name.length
+                                 + sizeof("\"\" prototype") + 1);
+
+    if (nxt_slow_path(process->name == NULL)) {
+        nxt_process_use(task, process, -1);
+        return NXT_ERROR;
+    }
+
+    p = (u_char *) process->name;
+    *p++ = '"';
+    p = nxt_cpymem(p, init->name, proto->conf->name.length);
+    p = nxt_cpymem(p, "\" prototype", 11);
+    *p = '\0';
+
+    process->data.app = proto->conf;
+
+    ret = nxt_main_start_process(task, process);
+
+    switch (ret) {
+
+    case NXT_OK:
+        proto->pid = process->pid;
+        break;
+
+    case NXT_AGAIN:
+        break;
+
+    default:
+        nxt_process_use(task, process, -1);
+    }
+
+    return ret;
+}
+
+
+static void
+nxt_main_proto_fork(nxt_task_t *task, nxt_main_proto_fork_t *fork)
+{
+    uint32_t       stream;
+    nxt_int_t      ret;
+    nxt_buf_t      *b;
+    nxt_port_t     *port, *proto_port, *main_port;
+    nxt_runtime_t  *rt;
+    nxt_process_t  *process;
+
+    rt = task->thread->runtime;
+    process = fork->process;
+
+    proto_port = nxt_runtime_port_find(rt, fork->proto->pid, 0);
+    if (nxt_slow_path(proto_port == NULL)) {
+        goto fail;
+    }
+
+    port = nxt_port_new(task, 0, 0, NXT_PROCESS_APP);
+    if (nxt_slow_path(port == NULL)) {
+        goto fail;
+    }
+
+    nxt_process_port_add(task, process, port);
+
+    ret = nxt_port_socket_init(task, port, 0);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        goto free_port;
+    }
+
+    b = nxt_buf_mem_ts_alloc(task, task->thread->engine->mem_pool,
+                             sizeof(uint32_t));
+    if (nxt_slow_path(b == NULL)) {
+        goto close_port;
+    }
+
+    b->mem.free = nxt_cpymem(b->mem.free, &process->stream, sizeof(uint32_t));
+
+    main_port = rt->port_by_type[NXT_PROCESS_MAIN];
+
+    stream = nxt_port_rpc_register_handler(task, main_port,
+                                           nxt_main_proto_fork_ready,
+                                           nxt_main_proto_fork_error,
+                                           fork->proto->pid, fork);
+    if (nxt_slow_path(stream == 0)) {
+        goto close_port;
+    }
+
+    /*
+     * The new process replies itself with its pid, the port socket pair
+     * is kept until then.
+     */
+    ret = nxt_port_socket_write2(task, proto_port, NXT_PORT_MSG_START_PROCESS,
+                                 port->pair[0], port->pair[1], stream, 0, b);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_port_rpc_cancel(task, main_port, stream);
+        goto close_port;
+    }
+
+    return;
+
+close_port:
+
+    nxt_port_close(task, port);
+
+free_port:
+
+    nxt_port_use(task, port, -1);
+
+fail:
+
+    nxt_main_proto_fork_fail(task, fork);
+}
+
+
+static void
+nxt_main_proto_fork_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
+    void *data)
+{
+    nxt_port_t             *port;
+    nxt_process_t          *process;
+    nxt_main_proto_fork_t  *fork;
+
+    fork = data;
+    process = fork->process;
+
+    process->pid = msg->port_msg.pid;
+
+    nxt_debug(task, "prototype %PI forked %s: %PI", fork->proto->pid,
+              process->name, process->pid);
+
+    nxt_runtime_process_add(task, process);
+
+    port = nxt_process_port_first(process);
+
+    nxt_port_read_close(port);
+    nxt_port_write_enable(task, port);
+
+    nxt_port_use(task, port, -1);
+    nxt_port_use(task, fork->reply_port, -1);
+
+    nxt_process_use(task, process, -1);
+}
+
+
+static void
+nxt_main_proto_fork_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
+    void *data)
+{
+    nxt_port_t             *port;
+    nxt_main_proto_fork_t  *fork;
+
+    fork = data;
+
+    nxt_alert(task, "prototype %PI failed to fork %s", fork->proto->pid,
+              fork->process->name);
+
+    port = nxt_process_port_first(fork->process);
+
+    nxt_port_close(task, port);
+    nxt_port_use(task, port, -1);
+
+    nxt_main_proto_fork_fail(task, fork);
+}
+
+
+static void
+nxt_main_proto_fork_fail(nxt_task_t *task, nxt_main_proto_fork_t *fork)
+{
+    nxt_port_t        *port;
+    nxt_process_t     *process;
+    nxt_main_proto_t  *proto;
+
+    proto = fork->proto;
+    process = fork->process;
+    port = fork->reply_port;
+
+    nxt_port_socket_write(task, port, NXT_PORT_MSG_RPC_ERROR, -1,
+                          process->stream, 0, NULL);
+
+    nxt_port_use(task, port, -1);
+
+    nxt_process_use(task, process, -1);
+
+    nxt_main_proto_release(task, proto);
+}
+
+
+static void
+nxt_main_proto_release(nxt_task_t *task, nxt_main_proto_t *proto)
+{
+    nxt_port_t     *port;
+    nxt_runtime_t  *rt;
+
+    proto->nprocesses--;
+
+    if (proto->nprocesses != 0) {
+        return;
+    }
+
+    if (proto->pid == -1) {
+        nxt_queue_remove(&proto->link);
+        nxt_mp_destroy(proto->mem_pool);
+
+        return;
+    }
+
+    if (proto->quitting) {
+        return;
+    }
+
+    nxt_debug(task, "prototype %PI has no processes", proto->pid);
+
+    proto->quitting = 1;
+
+    rt = task->thread->runtime;
+
+    port = nxt_runtime_port_find(rt, proto->pid, 0);
 
     if (nxt_fast_path(port != NULL)) {
-        nxt_port_socket_write(task, port, NXT_PORT_MSG_RPC_ERROR,
-                              -1, msg->port_msg.stream, 0, NULL);
+        (void) nxt_port_socket_write(task, port, NXT_PORT_MSG_QUIT, -1,
+                                     0, 0, NULL);
     }
 }
 
 
+static void
+nxt_main_proto_exited(nxt_task_t *task, nxt_pid_t pid)
+{
+    nxt_queue_link_t       *link;
+    nxt_runtime_t          *rt;
+    nxt_main_proto_t       *proto;
+    nxt_main_proto_fork_t  *fork;
+
+    nxt_queue_each(proto, &nxt_main_protos, nxt_main_proto_t, link) {
+
+        if (proto->pid == pid) {
+            goto found;
+        }
+
+    } nxt_queue_loop;
+
+    return;
+
+found:
+
+    proto->pid = -1;
+    proto->ready = 0;
+
+    /* The record is released below after all the failures are reported. */
+    proto->nprocesses++;
+
+    while (!nxt_queue_is_empty(&proto->pending)) {
+        link = nxt_queue_first(&proto->pending);
+        nxt_queue_remove(link);
+
+        fork = nxt_queue_link_data(link, nxt_main_proto_fork_t, link);
+
+        nxt_main_proto_fork_fail(task, fork);
+    }
+
+    rt = task->thread->runtime;
+
+    nxt_port_rpc_remove_peer(task, rt->port_by_type[NXT_PROCESS_MAIN], pid);
+
+    nxt_main_proto_release(task, proto);
+}
+
+
+static void
+nxt_main_proto_process_exited(nxt_task_t *task, nxt_common_app_conf_t *conf)
+{
+    nxt_main_proto_t  *proto;
+
+    nxt_queue_each(proto, &nxt_main_protos, nxt_main_proto_t, link) {
+
+        if (proto->conf == conf) {
+            nxt_main_proto_release(task, proto);
+            return;
+        }
+
+    } nxt_queue_loop;
+}
+
+#endif
+
+
+static void
+nxt_main_process_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+{
+#if (NXT_HAVE_CLONE)
+    nxt_queue_link_t       *link;
+    nxt_main_proto_t       *proto;
+    nxt_main_proto_fork_t  *fork;
+#endif
+
+    nxt_port_process_ready_handler(task, msg);
+
+#if (NXT_HAVE_CLONE)
+
+    nxt_queue_each(proto, &nxt_main_protos, nxt_main_proto_t, link) {
+
+        if (proto->pid != msg->port_msg.pid) {
+            continue;
+        }
+
+        proto->ready = 1;
+
+        while (!nxt_queue_is_empty(&proto->pending)) {
+            link = nxt_queue_first(&proto->pending);
+            nxt_queue_remove(link);
+
+            fork = nxt_queue_link_data(link, nxt_main_proto_fork_t, link);
+
+            nxt_main_proto_fork(task, fork);
+        }
+
+        return;
+
+    } nxt_queue_loop;
+
+#endif
+}
+
+
 static void
 nxt_main_process_created_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 {
@@ -523,7 +1141,7 @@ nxt_main_process_created_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 static nxt_port_handlers_t  nxt_main_process_port_handlers = {
     .data             = nxt_port_main_data_handler,
     .process_created  = nxt_main_process_created_handler,
-    .process_ready    = nxt_port_process_ready_handler,
+    .process_ready    = nxt_main_process_ready_handler,
     .start_process    = nxt_port_main_start_process_handler,
     .socket           = nxt_main_port_socket_handler,
     .modules          = nxt_main_port_modules_handler,
@@ -531,6 +1149,9 @@ static nxt_port_handlers_t  nxt_main_process_port_handlers = {
 #if (NXT_TLS)
     .cert_get         = nxt_cert_store_get_handler,
     .cert_delete      = nxt_cert_store_delete_handler,
+#if (NXT_HAVE_OPENSSL_OCSP)
+    .ocsp_store       = nxt_cert_ocsp_store_handler,
+#endif
 #endif
     .access_log       = nxt_main_port_access_log_handler,
     .rpc_ready        = nxt_port_rpc_handler,
@@ -922,14 +1543,15 @@ nxt_main_process_signal_handler(nxt_task_t *task, void *obj, void *data)
 static void
 nxt_main_cleanup_process(nxt_task_t *task, nxt_pid_t pid)
 {
-    int                 stream;
-    nxt_int_t           ret;
-    nxt_buf_t           *buf;
-    nxt_port_t          *port;
-    const char          *name;
-    nxt_runtime_t       *rt;
-    nxt_process_t       *process;
-    nxt_process_init_t  init;
+    int                    stream;
+    nxt_int_t              ret;
+    nxt_buf_t              *buf;
+    nxt_port_t             *port;
+    const char             *name;
+    nxt_runtime_t          *rt;
+    nxt_process_t          *process;
+    nxt_process_init_t     init;
+    nxt_common_app_conf_t  *app_conf;
 
     rt = task->thread->runtime;
 
@@ -950,6 +1572,8 @@ nxt_main_cleanup_process(nxt_task_t *task, nxt_pid_t pid)
         process->stream = 0;
     }
 
+    app_conf = (init.type == NXT_PROCESS_APP) ? process->data.app : NULL;
+
     nxt_process_close_ports(task, process);
 
     if (nxt_exiting) {
@@ -960,6 +1584,15 @@ nxt_main_cleanup_process(nxt_task_t *task, nxt_pid_t pid)
         return;
     }
 
+#if (NXT_HAVE_CLONE)
+    if (init.type == NXT_PROCESS_PROTOTYPE) {
+        nxt_main_proto_exited(task, pid);
+
+    } else if (app_conf != NULL) {
+        nxt_main_proto_process_exited(task, app_conf);
+    }
+#endif
+
     nxt_runtime_process_each(rt, process) {
 
         if (process->pid == nxt_pid
@@ -1004,6 +1637,7 @@ nxt_main_port_socket_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     size_t                  size;
     nxt_int_t               ret;
     nxt_buf_t               *b, *out;
+    nxt_bool_t              reuseport;
     nxt_port_t              *port;
     nxt_sockaddr_t          *sa;
     nxt_port_msg_type_t     type;
@@ -1021,6 +1655,11 @@ nxt_main_port_socket_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
     /* TODO check b size and make plain */
 
+    /* An optional byte after the address requests SO_REUSEPORT. */
+    size = nxt_sockaddr_size(sa);
+    reuseport = ((size_t) nxt_buf_mem_used_size(&b->mem) > size
+                 && b->mem.pos[size] != 0);
+
     ls.socket = -1;
     ls.error = NXT_SOCKET_ERROR_SYSTEM;
     ls.start = message;
@@ -1029,7 +1668,7 @@ nxt_main_port_socket_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     nxt_debug(task, "listening socket \"%*s\"",
               (size_t) sa->length, nxt_sockaddr_start(sa));
 
-    ret = nxt_main_listening_socket(sa, &ls);
+    ret = nxt_main_listening_socket(sa, reuseport, &ls);
 
     if (ret == NXT_OK) {
         nxt_debug(task, "socket(\"%*s\"): %d",
@@ -1061,7 +1700,8 @@ nxt_main_port_socket_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
 
 static nxt_int_t
-nxt_main_listening_socket(nxt_sockaddr_t *sa, nxt_listening_socket_t *ls)
+nxt_main_listening_socket(nxt_sockaddr_t *sa, nxt_bool_t reuseport,
+    nxt_listening_socket_t *ls)
 {
     nxt_err_t         err;
     nxt_socket_t      s;
@@ -1097,6 +1737,20 @@ nxt_main_listening_socket(nxt_sockaddr_t *sa, nxt_listening_socket_t *ls)
         goto fail;
     }
 
+#ifdef SO_REUSEPORT
+
+    if (reuseport
+        && setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &enable, length) != 0)
+    {
+        ls->end = nxt_sprintf(ls->start, ls->end,
+                              "setsockopt(\\\"%*s\\\", SO_REUSEPORT) failed %E",
+                              (size_t) sa->length, nxt_sockaddr_start(sa),
+                              nxt_errno);
+        goto fail;
+    }
+
+#endif
+
 #if (NXT_INET6)
 
     if (sa->u.sockaddr.sa_family == AF_INET6) {
@@ -27,6 +27,7 @@ NXT_EXPORT extern const nxt_process_init_t  nxt_discovery_process;
 NXT_EXPORT extern const nxt_process_init_t  nxt_controller_process;
 NXT_EXPORT extern const nxt_process_init_t  nxt_router_process;
 NXT_EXPORT extern const nxt_process_init_t  nxt_app_process;
+NXT_EXPORT extern const nxt_process_init_t  nxt_proto_process;
 
 extern const nxt_sig_event_t  nxt_main_process_signals[];
 extern const nxt_sig_event_t  nxt_process_signals[];
@@ -13,6 +13,9 @@
 #include <openssl/x509v3.h>
 #include <openssl/bio.h>
 #include <openssl/evp.h>
+#if (NXT_HAVE_OPENSSL_OCSP)
+#include <openssl/ocsp.h>
+#endif
 
 
 typedef struct {
@@ -25,6 +28,11 @@ typedef struct {
 
     nxt_tls_conf_t    *conf;
     nxt_buf_mem_t     buffer;
+
+    /* Dynamic record sizing state. */
+    nxt_off_t         sent;
+    size_t            write_size;
+    nxt_msec_t        last_write;
 } nxt_openssl_conn_t;
 
 
@@ -42,6 +50,34 @@ struct nxt_tls_tickets_s {
 };
 
 
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+/*
+ * The stapled response is read from the file passed along with
+ * the certificate.  When the controller fetches a fresh response,
+ * the main process replaces the file and passes the new one to
+ * nxt_openssl_ocsp_update().  The responses are shared by all
+ * contexts of a certificate and are looked up by its name.
+ */
+
+#define NXT_OPENSSL_OCSP_MAX_SIZE  65536
+
+
+typedef struct {
+    nxt_queue_link_t       link;
+    nxt_str_t              name;
+    nxt_uint_t             count;
+
+    nxt_thread_spinlock_t  lock;
+    nxt_time_t             valid;
+
+    u_char                 *response;
+    size_t                 size;
+} nxt_openssl_ocsp_t;
+
+#endif
+
+
 typedef enum {
     NXT_OPENSSL_HANDSHAKE = 0,
     NXT_OPENSSL_READ,
@@ -62,6 +98,21 @@ static nxt_int_t nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
     nxt_tls_init_t *tls_init, nxt_bool_t last);
 static nxt_int_t nxt_openssl_chain_file(nxt_task_t *task, SSL_CTX *ctx,
     nxt_tls_conf_t *conf, nxt_mp_t *mp, nxt_bool_t single);
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_int_t nxt_openssl_ocsp_stapling(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_bundle_conf_t *bundle);
+static nxt_openssl_ocsp_t *nxt_openssl_ocsp_get(nxt_str_t *name,
+    nxt_bool_t create);
+static void nxt_openssl_ocsp_release(nxt_openssl_ocsp_t *ocsp);
+static int nxt_openssl_ocsp_status(SSL *s, void *arg);
+static void nxt_openssl_ocsp_update(nxt_task_t *task, nxt_str_t *name,
+    nxt_fd_t fd);
+static void nxt_openssl_ocsp_read(nxt_openssl_ocsp_t *ocsp, nxt_fd_t fd,
+    nxt_time_t now);
+static nxt_time_t nxt_openssl_ocsp_valid(u_char *response, size_t size,
+    nxt_time_t now);
+static void nxt_openssl_ocsp_free(SSL_CTX *ctx);
+#endif
 #if (NXT_HAVE_OPENSSL_CONF_CMD)
 static nxt_int_t nxt_ssl_conf_commands(nxt_task_t *task, SSL_CTX *ctx,
     nxt_conf_value_t *value, nxt_mp_t *mp);
@@ -74,6 +125,17 @@ static int nxt_tls_ticket_key_callback(SSL *s, unsigned char *name,
 #endif
 static void nxt_ssl_session_cache(SSL_CTX *ctx, size_t cache_size,
     time_t timeout);
+static void nxt_openssl_sessions_init(nxt_task_t *task);
+static nxt_int_t nxt_openssl_session_id_context(nxt_task_t *task,
+    SSL_CTX *ctx, nxt_tls_init_t *tls_init, nxt_tls_bundle_conf_t *bundle);
+static int nxt_openssl_session_new(SSL *s, SSL_SESSION *sess);
+static SSL_SESSION *nxt_openssl_session_get(SSL *s,
+#if OPENSSL_VERSION_NUMBER >= 0x10100003L
+    const
+#endif
+    unsigned char *id, int len, int *copy);
+static nxt_tls_session_t *nxt_openssl_session_bucket(const u_char *id,
+    size_t len, nxt_tls_session_shard_t **shard);
 static nxt_uint_t nxt_openssl_cert_get_names(nxt_task_t *task, X509 *cert,
     nxt_tls_conf_t *conf, nxt_mp_t *mp);
 static nxt_int_t nxt_openssl_bundle_hash_test(nxt_lvlhsh_query_t *lhq,
@@ -81,6 +143,11 @@ static nxt_int_t nxt_openssl_bundle_hash_test(nxt_lvlhsh_query_t *lhq,
 static nxt_int_t nxt_openssl_bundle_hash_insert(nxt_task_t *task,
     nxt_lvlhsh_t *lvlhsh, nxt_tls_bundle_hash_item_t *item, nxt_mp_t * mp);
 static nxt_int_t nxt_openssl_servername(SSL *s, int *ad, void *arg);
+#ifdef TLSEXT_TYPE_application_layer_protocol_negotiation
+static int nxt_openssl_alpn_select(SSL *s, const unsigned char **out,
+    unsigned char *outlen, const unsigned char *in, unsigned int inlen,
+    void *arg);
+#endif
 static nxt_tls_bundle_conf_t *nxt_openssl_find_ctx(nxt_tls_conf_t *conf,
     nxt_str_t *sn);
 static void nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf);
@@ -89,6 +156,12 @@ static void nxt_openssl_conn_init(nxt_task_t *task, nxt_tls_conf_t *conf,
 static void nxt_openssl_conn_handshake(nxt_task_t *task, void *obj, void *data);
 static ssize_t nxt_openssl_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b);
 static ssize_t nxt_openssl_conn_io_sendbuf(nxt_task_t *task, nxt_sendbuf_t *sb);
+static size_t nxt_openssl_conn_record_size(nxt_task_t *task,
+    nxt_openssl_conn_t *tls);
+#if (NXT_HAVE_OPENSSL_KTLS)
+static ssize_t nxt_openssl_conn_io_sendfile(nxt_task_t *task,
+    nxt_sendbuf_t *sb);
+#endif
 static ssize_t nxt_openssl_conn_io_send(nxt_task_t *task, nxt_sendbuf_t *sb,
     void *buf, size_t size);
 static void nxt_openssl_conn_io_shutdown(nxt_task_t *task, void *obj,
@@ -108,6 +181,10 @@ const nxt_tls_lib_t  nxt_openssl_lib = {
 
     .server_init = nxt_openssl_server_init,
     .server_free = nxt_openssl_server_free,
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    .ocsp_update = nxt_openssl_ocsp_update,
+#endif
 };
 
 
@@ -125,6 +202,13 @@ static nxt_conn_io_t  nxt_openssl_conn_io = {
 static long  nxt_openssl_version;
 static int   nxt_openssl_connection_index;
 
+static nxt_tls_sessions_t  *nxt_openssl_sessions;
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_queue_t            nxt_openssl_ocsps;
+static nxt_thread_spinlock_t  nxt_openssl_ocsps_lock;
+#endif
+
 
 static nxt_int_t
 nxt_openssl_library_init(nxt_task_t *task)
@@ -163,6 +247,10 @@ nxt_openssl_library_init(nxt_task_t *task)
 
 #endif
 
+#if (NXT_HAVE_OPENSSL_OCSP)
+    nxt_queue_init(&nxt_openssl_ocsps);
+#endif
+
     nxt_openssl_version = SSLeay();
 
     nxt_log(task, NXT_LOG_INFO, "%s, %xl",
@@ -195,6 +283,8 @@ nxt_openssl_library_init(nxt_task_t *task)
 
     nxt_openssl_connection_index = index;
 
+    nxt_openssl_sessions_init(task);
+
     return NXT_OK;
 }
 
@@ -323,6 +413,14 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
     SSL_CTX_set_options(ctx, SSL_OP_NO_COMPRESSION);
 #endif
 
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    /*
+     * Clients, HTTP/2 ones in particular, close idle connections
+     * without "close notify" alert, OpenSSL 3.0 treats this as an error.
+     */
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
 #ifdef SSL_MODE_RELEASE_BUFFERS
 
     if (nxt_openssl_version >= 10001078) {
@@ -336,12 +434,32 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
 #endif
 
+    /*
+     * An SSL_write() retry may pass the same data either from a memory
+     * buffer or from the connection coalescing buffer.
+     */
+    SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
     if (nxt_openssl_chain_file(task, ctx, conf, mp,
                                last && bundle->next == NULL)
         != NXT_OK)
     {
         goto fail;
     }
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    if (tls_init->ocsp_stapling && bundle->ocsp_file != -1) {
+        if (nxt_openssl_ocsp_stapling(task, ctx, bundle) != NXT_OK) {
+            goto fail;
+        }
+    }
+#endif
+
+    if (bundle->ocsp_file != -1) {
+        nxt_fd_close(bundle->ocsp_file);
+        bundle->ocsp_file = -1;
+    }
+
 /*
     key = conf->certificate_key;
 
@@ -372,6 +490,13 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
     nxt_ssl_session_cache(ctx, tls_init->cache_size, tls_init->timeout);
 
+    if (tls_init->cache_size != 0
+        && nxt_openssl_session_id_context(task, ctx, tls_init, bundle)
+           != NXT_OK)
+    {
+        goto fail;
+    }
+
 #if (NXT_HAVE_OPENSSL_TLSEXT)
     if (nxt_tls_ticket_keys(task, ctx, tls_init, mp) != NXT_OK) {
         goto fail;
@@ -380,6 +505,23 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
     SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+    /*
+     * OpenSSL offloads the record encryption to the kernel only if
+     * the kernel supports the negotiated cipher, otherwise the connection
+     * silently remains in user space.
+     */
+    if (tls_init->ktls) {
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
+#ifdef TLSEXT_TYPE_application_layer_protocol_negotiation
+    if (tls_init->http2) {
+        SSL_CTX_set_alpn_select_cb(ctx, nxt_openssl_alpn_select, NULL);
+    }
+#endif
+
     if (conf->ca_certificate != NULL) {
 
         /* TODO: verify callback */
@@ -427,6 +569,15 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
 fail:
 
+    if (bundle->ocsp_file != -1) {
+        nxt_fd_close(bundle->ocsp_file);
+        bundle->ocsp_file = -1;
+    }
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    nxt_openssl_ocsp_free(ctx);
+#endif
+
     SSL_CTX_free(ctx);
 
 #if (OPENSSL_VERSION_NUMBER >= 0x1010100fL \
@@ -533,6 +684,305 @@ clean:
 }
 
 
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+static nxt_int_t
+nxt_openssl_ocsp_stapling(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_bundle_conf_t *bundle)
+{
+    nxt_openssl_ocsp_t  *ocsp;
+
+    ocsp = nxt_openssl_ocsp_get(&bundle->name, 1);
+    if (nxt_slow_path(ocsp == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_openssl_ocsp_read(ocsp, bundle->ocsp_file,
+                          nxt_thread_time(task->thread));
+
+    SSL_CTX_set_tlsext_status_cb(ctx, nxt_openssl_ocsp_status);
+    SSL_CTX_set_tlsext_status_arg(ctx, ocsp);
+
+    nxt_debug(task, "tls ocsp stapling enabled for \"%V\"", &bundle->name);
+
+    return NXT_OK;
+}
+
+
+static nxt_openssl_ocsp_t *
+nxt_openssl_ocsp_get(nxt_str_t *name, nxt_bool_t create)
+{
+    nxt_queue_link_t    *link;
+    nxt_openssl_ocsp_t  *ocsp;
+
+    nxt_thread_spin_lock(&nxt_openssl_ocsps_lock);
+
+    for (link = nxt_queue_first(&nxt_openssl_ocsps);
+         link != nxt_queue_tail(&nxt_openssl_ocsps);
+         link = nxt_queue_next(link))
+    {
+        ocsp = nxt_queue_link_data(link, nxt_openssl_ocsp_t, link);
+
+        if (nxt_strstr_eq(&ocsp->name, name)) {
+            ocsp->count++;
+            goto done;
+        }
+    }
+
+    ocsp = NULL;
+
+    if (create) {
+        ocsp = nxt_zalloc(sizeof(nxt_openssl_ocsp_t) + name->length);
+
+        if (nxt_fast_path(ocsp != NULL)) {
+            ocsp->name.length = name->length;
+            ocsp->name.start = (u_char *) (ocsp + 1);
+            nxt_memcpy(ocsp->name.start, name->start, name->length);
+
+            ocsp->count = 1;
+
+            nxt_queue_insert_tail(&nxt_openssl_ocsps, &ocsp->link);
+        }
+    }
+
+done:
+
+    nxt_thread_spin_unlock(&nxt_openssl_ocsps_lock);
+
+    return ocsp;
+}
+
+
+static void
+nxt_openssl_ocsp_release(nxt_openssl_ocsp_t *ocsp)
+{
+    nxt_uint_t  count;
+
+    nxt_thread_spin_lock(&nxt_openssl_ocsps_lock);
+
+    count = --ocsp->count;
+
+    if (count == 0) {
+        nxt_queue_remove(&ocsp->link);
+    }
+
+    nxt_thread_spin_unlock(&nxt_openssl_ocsps_lock);
+
+    if (count != 0) {
+        return;
+    }
+
+    if (ocsp->response != NULL) {
+        nxt_free(ocsp->response);
+    }
+
+    nxt_free(ocsp);
+}
+
+
+static int
+nxt_openssl_ocsp_status(SSL *s, void *arg)
+{
+    u_char              *p;
+    size_t              size;
+    nxt_time_t          now;
+    nxt_openssl_ocsp_t  *ocsp;
+
+    ocsp = arg;
+
+    now = nxt_thread_time(nxt_thread());
+
+    p = NULL;
+    size = 0;
+
+    nxt_thread_spin_lock(&ocsp->lock);
+
+    if (ocsp->response != NULL && ocsp->valid > now) {
+        size = ocsp->size;
+
+        p = OPENSSL_malloc(size);
+        if (p != NULL) {
+            nxt_memcpy(p, ocsp->response, size);
+        }
+    }
+
+    nxt_thread_spin_unlock(&ocsp->lock);
+
+    if (p == NULL) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    /* OpenSSL takes ownership of the response copy. */
+
+    if (SSL_set_tlsext_status_ocsp_resp(s, p, size) != 1) {
+        OPENSSL_free(p);
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    return SSL_TLSEXT_ERR_OK;
+}
+
+
+static void
+nxt_openssl_ocsp_update(nxt_task_t *task, nxt_str_t *name, nxt_fd_t fd)
+{
+    nxt_openssl_ocsp_t  *ocsp;
+
+    ocsp = nxt_openssl_ocsp_get(name, 0);
+
+    if (ocsp == NULL) {
+        return;
+    }
+
+    nxt_debug(task, "tls ocsp response updated for \"%V\"", name);
+
+    nxt_openssl_ocsp_read(ocsp, fd, nxt_thread_time(task->thread));
+
+    nxt_openssl_ocsp_release(ocsp);
+}
+
+
+/*
+ * The response file is never written in place, it is replaced
+ * with rename(), so the descriptor always refers to a whole response.
+ */
+
+static void
+nxt_openssl_ocsp_read(nxt_openssl_ocsp_t *ocsp, nxt_fd_t fd, nxt_time_t now)
+{
+    u_char       *response, *old;
+    ssize_t      n;
+    nxt_time_t   valid;
+    struct stat  sb;
+
+    if (fstat(fd, &sb) != 0) {
+        nxt_thread_log_alert("fstat(%FD) failed %E", fd, nxt_errno);
+        return;
+    }
+
+    response = NULL;
+    n = 0;
+    valid = 0;
+
+    if (sb.st_size > 0 && sb.st_size <= NXT_OPENSSL_OCSP_MAX_SIZE) {
+        response = nxt_malloc(sb.st_size);
+        if (nxt_slow_path(response == NULL)) {
+            return;
+        }
+
+        n = pread(fd, response, sb.st_size, 0);
+
+        if (n != sb.st_size) {
+            nxt_thread_log_alert("pread(%FD) failed %E", fd, nxt_errno);
+            nxt_free(response);
+            return;
+        }
+
+        /*
+         * An invalid response is kept as well to avoid parsing it
+         * again, but it is never stapled.
+         */
+        valid = nxt_openssl_ocsp_valid(response, n, now);
+    }
+
+    nxt_thread_spin_lock(&ocsp->lock);
+
+    old = ocsp->response;
+
+    ocsp->response = response;
+    ocsp->size = n;
+    ocsp->valid = valid;
+
+    nxt_thread_spin_unlock(&ocsp->lock);
+
+    if (old != NULL) {
+        nxt_free(old);
+    }
+}
+
+
+static nxt_time_t
+nxt_openssl_ocsp_valid(u_char *response, size_t size, nxt_time_t now)
+{
+    int                   day, sec;
+    nxt_time_t            valid;
+    OCSP_RESPONSE         *resp;
+    OCSP_BASICRESP        *basic;
+    OCSP_SINGLERESP       *single;
+    const unsigned char   *p;
+    ASN1_GENERALIZEDTIME  *next;
+
+    valid = 0;
+    basic = NULL;
+
+    p = response;
+
+    resp = d2i_OCSP_RESPONSE(NULL, &p, size);
+    if (resp == NULL) {
+        goto done;
+    }
+
+    if (OCSP_response_status(resp) != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+        goto done;
+    }
+
+    basic = OCSP_response_get1_basic(resp);
+    if (basic == NULL) {
+        goto done;
+    }
+
+    single = OCSP_resp_get0(basic, 0);
+    if (single == NULL) {
+        goto done;
+    }
+
+    next = NULL;
+
+    (void) OCSP_single_get0_status(single, NULL, NULL, NULL, &next);
+
+    if (next == NULL) {
+        valid = NXT_TIME_T_MAX;
+
+    } else if (ASN1_TIME_diff(&day, &sec, NULL, next) == 1) {
+        valid = now + (nxt_time_t) day * 86400 + sec;
+    }
+
+done:
+
+    if (valid <= now) {
+        nxt_thread_log_error(NXT_LOG_WARN,
+                             "OCSP response is invalid or expired");
+        ERR_clear_error();
+    }
+
+    OCSP_BASICRESP_free(basic);
+    OCSP_RESPONSE_free(resp);
+
+    return valid;
+}
+
+
+static void
+nxt_openssl_ocsp_free(SSL_CTX *ctx)
+{
+    nxt_openssl_ocsp_t  *ocsp;
+
+    ocsp = NULL;
+
+    (void) SSL_CTX_get_tlsext_status_arg(ctx, &ocsp);
+
+    if (ocsp == NULL) {
+        return;
+    }
+
+    nxt_openssl_ocsp_release(ocsp);
+
+    SSL_CTX_set_tlsext_status_arg(ctx, NULL);
+}
+
+#endif
+
+
 #if (NXT_HAVE_OPENSSL_CONF_CMD)
 
 static nxt_int_t
@@ -841,6 +1291,231 @@ nxt_ssl_session_cache(SSL_CTX *ctx, size_t cache_size, time_t timeout)
     SSL_CTX_sess_set_cache_size(ctx, cache_size);
 
     SSL_CTX_set_timeout(ctx, (long) timeout);
+
+    if (nxt_openssl_sessions != NULL) {
+        /*
+         * The internal cache is looked up first, the shared cache keeps
+         * sessions of the contexts destroyed on reconfiguration.
+         * Sessions removed from the internal cache, e.g. if it is full,
+         * remain in the shared cache until they expire or are evicted.
+         */
+        SSL_CTX_sess_set_new_cb(ctx, nxt_openssl_session_new);
+        SSL_CTX_sess_set_get_cb(ctx, nxt_openssl_session_get);
+    }
+}
+
+
+static void
+nxt_openssl_sessions_init(nxt_task_t *task)
+{
+    nxt_uint_t          i;
+    nxt_tls_sessions_t  *sessions;
+
+    sessions = task->thread->runtime->tls_sessions;
+
+    if (sessions == NULL) {
+        return;
+    }
+
+    /*
+     * The router might have exited while holding a lock,
+     * the cached sessions themselves are kept.
+     */
+
+    for (i = 0; i < NXT_TLS_SESSION_SHARDS; i++) {
+        sessions->shards[i].lock = 0;
+    }
+
+    nxt_openssl_sessions = sessions;
+}
+
+
+/*
+ * OpenSSL does not resume a session in a context with a different
+ * session id context, so sessions of different listeners and certificate
+ * bundles are kept apart while the session ids alone are used as the keys
+ * in the shared cache.
+ */
+
+static nxt_int_t
+nxt_openssl_session_id_context(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_init_t *tls_init, nxt_tls_bundle_conf_t *bundle)
+{
+    unsigned int  len;
+    EVP_MD_CTX    *md;
+
+    u_char        buf[EVP_MAX_MD_SIZE];
+
+    md = EVP_MD_CTX_create();
+    if (md == NULL) {
+        return NXT_ERROR;
+    }
+
+    if (EVP_DigestInit_ex(md, EVP_sha256(), NULL) != 1
+        || EVP_DigestUpdate(md, tls_init->name.start, tls_init->name.length)
+           != 1
+        || EVP_DigestUpdate(md, "", 1) != 1
+        || EVP_DigestUpdate(md, bundle->name.start, bundle->name.length) != 1
+        || EVP_DigestFinal_ex(md, buf, &len) != 1)
+    {
+        EVP_MD_CTX_destroy(md);
+
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "failed to create session id context");
+        return NXT_ERROR;
+    }
+
+    EVP_MD_CTX_destroy(md);
+
+    len = nxt_min(len, SSL_MAX_SID_CTX_LENGTH);
+
+    if (SSL_CTX_set_session_id_context(ctx, buf, len) != 1) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_set_session_id_context() failed");
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static int
+nxt_openssl_session_new(SSL *s, SSL_SESSION *sess)
+{
+    int                      len;
+    u_char                   *p;
+    nxt_uint_t               i;
+    nxt_time_t               now;
+    unsigned int             id_length;
+    const unsigned char      *id;
+    nxt_tls_session_t        *session, *slot;
+    nxt_tls_session_shard_t  *shard;
+
+    u_char                   buf[NXT_TLS_SESSION_SIZE];
+
+    len = i2d_SSL_SESSION(sess, NULL);
+
+    if (len <= 0 || len > NXT_TLS_SESSION_SIZE) {
+        return 0;
+    }
+
+    id = SSL_SESSION_get_id(sess, &id_length);
+
+    if (id_length == 0 || id_length > NXT_TLS_SESSION_ID_SIZE) {
+        return 0;
+    }
+
+    p = buf;
+
+    if (i2d_SSL_SESSION(sess, &p) != len) {
+        return 0;
+    }
+
+    now = nxt_thread_time(nxt_thread());
+
+    session = nxt_openssl_session_bucket(id, id_length, &shard);
+
+    nxt_thread_spin_lock(&shard->lock);
+
+    slot = &session[0];
+
+    for (i = 0; i < NXT_TLS_SESSION_WAYS; i++) {
+
+        if (session[i].id_length == id_length
+            && nxt_memcmp(session[i].id, id, id_length) == 0)
+        {
+            slot = &session[i];
+            break;
+        }
+
+        /* An empty or expired slot, or else the one expiring first. */
+
+        if (slot->expire > now && session[i].expire < slot->expire) {
+            slot = &session[i];
+        }
+    }
+
+    slot->expire = SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+    slot->size = len;
+    slot->id_length = id_length;
+    nxt_memcpy(slot->id, id, id_length);
+    nxt_memcpy(slot->data, buf, len);
+
+    nxt_thread_spin_unlock(&shard->lock);
+
+    /* The session is not referenced by the cache. */
+
+    return 0;
+}
+
+
+static SSL_SESSION *
+nxt_openssl_session_get(SSL *s,
+#if OPENSSL_VERSION_NUMBER >= 0x10100003L
+    const
+#endif
+    unsigned char *id, int len, int *copy)
+{
+    size_t                   size;
+    nxt_uint_t               i;
+    nxt_time_t               now;
+    const u_char             *p;
+    nxt_tls_session_t        *session;
+    nxt_tls_session_shard_t  *shard;
+
+    u_char                   buf[NXT_TLS_SESSION_SIZE];
+
+    *copy = 0;
+
+    if (len <= 0 || len > NXT_TLS_SESSION_ID_SIZE) {
+        return NULL;
+    }
+
+    now = nxt_thread_time(nxt_thread());
+
+    session = nxt_openssl_session_bucket(id, len, &shard);
+
+    size = 0;
+
+    nxt_thread_spin_lock(&shard->lock);
+
+    for (i = 0; i < NXT_TLS_SESSION_WAYS; i++) {
+
+        if (session[i].id_length == len
+            && session[i].expire > now
+            && nxt_memcmp(session[i].id, id, len) == 0)
+        {
+            size = session[i].size;
+            nxt_memcpy(buf, session[i].data, size);
+            break;
+        }
+    }
+
+    nxt_thread_spin_unlock(&shard->lock);
+
+    if (size == 0) {
+        return NULL;
+    }
+
+    p = buf;
+
+    return d2i_SSL_SESSION(NULL, &p, size);
+}
+
+
+static nxt_tls_session_t *
+nxt_openssl_session_bucket(const u_char *id, size_t len,
+    nxt_tls_session_shard_t **shard)
+{
+    uint32_t  hash;
+
+    hash = nxt_murmur_hash2(id, len);
+
+    *shard = &nxt_openssl_sessions->shards[hash % NXT_TLS_SESSION_SHARDS];
+
+    hash = (hash / NXT_TLS_SESSION_SHARDS) % NXT_TLS_SESSION_BUCKETS;
+
+    return &(*shard)->sessions[hash * NXT_TLS_SESSION_WAYS];
 }
 
 
@@ -1131,6 +1806,43 @@ nxt_openssl_find_ctx(nxt_tls_conf_t *conf, nxt_str_t *sn)
 }
 
 
+#ifdef TLSEXT_TYPE_application_layer_protocol_negotiation
+
+static int
+nxt_openssl_alpn_select(SSL *s, const unsigned char **out,
+    unsigned char *outlen, const unsigned char *in, unsigned int inlen,
+    void *arg)
+{
+    int         ret;
+    nxt_conn_t  *c;
+
+    static const u_char  protos[] = "\x02h2\x08http/1.1";
+
+    c = SSL_get_ex_data(s, nxt_openssl_connection_index);
+
+    if (nxt_slow_path(c == NULL)) {
+        nxt_thread_log_alert("SSL_get_ex_data() failed");
+        return SSL_TLSEXT_ERR_ALERT_FATAL;
+    }
+
+    ret = SSL_select_next_proto((unsigned char **) out, outlen,
+                                protos, nxt_length(protos), in, inlen);
+
+    if (ret != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    c->alpn_h2 = (*outlen == 2 && nxt_memcmp(*out, "h2", 2) == 0);
+
+    nxt_debug(c->socket.task, "tls alpn selected \"%*s\"",
+              (size_t) *outlen, *out);
+
+    return SSL_TLSEXT_ERR_OK;
+}
+
+#endif
+
+
 static void
 nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf)
 {
@@ -1140,6 +1852,9 @@ nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf)
     nxt_assert(bundle != NULL);
 
     do {
+#if (NXT_HAVE_OPENSSL_OCSP)
+        nxt_openssl_ocsp_free(bundle->ctx);
+#endif
         SSL_CTX_free(bundle->ctx);
         bundle = bundle->next;
     } while (bundle != NULL);
@@ -1277,6 +1992,13 @@ nxt_openssl_conn_handshake(nxt_task_t *task, void *obj, void *data)
         /* ret == 1, the handshake was successfully completed. */
         tls->handshake = 1;
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+        if (BIO_get_ktls_send(SSL_get_wbio(tls->session))) {
+            nxt_debug(task, "openssl conn kTLS send enabled");
+            c->sendfile = NXT_CONN_SENDFILE_ON;
+        }
+#endif
+
         if (c->read_state != NULL) {
             if (state->io_read_handler != NULL || c->read != NULL) {
                 nxt_conn_read(task->thread->engine, c);
@@ -1365,19 +2087,170 @@ nxt_openssl_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b)
 static ssize_t
 nxt_openssl_conn_io_sendbuf(nxt_task_t *task, nxt_sendbuf_t *sb)
 {
-    nxt_uint_t    niov;
-    struct iovec  iov;
+    u_char              *p;
+    size_t              size, limit;
+    ssize_t             n;
+    nxt_uint_t          i, niov;
+    nxt_buf_mem_t       *bm;
+    nxt_openssl_conn_t  *tls;
+    struct iovec        iov[NXT_IOBUF_MAX];
+
+    tls = sb->tls;
+    bm = &tls->buffer;
+
+    /*
+     * Each SSL_write() call produces at least one TLS record and one
+     * system call, so small memory buffers are copied into the connection
+     * buffer and are encrypted as a single record.  The amount of data
+     * is limited by the current record size.
+     */
 
-    niov = nxt_sendbuf_mem_coalesce0(task, sb, &iov, 1);
+    size = nxt_openssl_conn_record_size(task, tls);
+
+    limit = sb->limit;
+    sb->limit = nxt_min(limit, size);
+
+    niov = nxt_sendbuf_mem_coalesce0(task, sb, iov,
+                                     ((size_t) nxt_buf_mem_size(bm) >= size)
+                                     ? NXT_IOBUF_MAX : 1);
+    sb->limit = limit;
 
     if (niov == 0 && sb->sync) {
         return 0;
     }
 
-    return nxt_openssl_conn_io_send(task, sb, iov.iov_base, iov.iov_len);
+#if (NXT_HAVE_OPENSSL_KTLS)
+    if (niov == 0 && nxt_buf_is_file(sb->buf)) {
+        return nxt_openssl_conn_io_sendfile(task, sb);
+    }
+#endif
+
+    if (niov == 0) {
+        iov[0].iov_base = NULL;
+        iov[0].iov_len = 0;
+
+    } else if (niov > 1) {
+
+        if (bm->start == NULL) {
+            bm->start = nxt_malloc(nxt_buf_mem_size(bm));
+            if (nxt_slow_path(bm->start == NULL)) {
+                return NXT_ERROR;
+            }
+
+            bm->end += (uintptr_t) bm->start;
+        }
+
+        p = bm->start;
+
+        for (i = 0; i < niov; i++) {
+            p = nxt_cpymem(p, iov[i].iov_base, iov[i].iov_len);
+        }
+
+        iov[0].iov_base = bm->start;
+        iov[0].iov_len = p - bm->start;
+    }
+
+    n = nxt_openssl_conn_io_send(task, sb, iov[0].iov_base, iov[0].iov_len);
+
+    if (n > 0) {
+        tls->sent += n;
+    }
+
+    /* SSL_write() must be retried with at least the same amount of data. */
+    tls->write_size = (n == NXT_AGAIN) ? iov[0].iov_len : 0;
+
+    return n;
+}
+
+
+/*
+ * Dynamic record sizing: a connection starts with small records which
+ * can be decrypted by a client as soon as the first TCP packets arrive.
+ * After NXT_TLS_RECORD_WARMUP bytes the records grow to the maximum size
+ * to decrease the TLS overhead of bulk transfers.  An idle connection
+ * starts over, since the TCP congestion window is reset as well.
+ */
+
+static size_t
+nxt_openssl_conn_record_size(nxt_task_t *task, nxt_openssl_conn_t *tls)
+{
+    size_t      size;
+    nxt_msec_t  now;
+
+    now = task->thread->engine->timers.now;
+
+    if ((nxt_msec_int_t) (now - tls->last_write) > NXT_TLS_RECORD_IDLE) {
+        tls->sent = 0;
+    }
+
+    tls->last_write = now;
+
+    size = (tls->sent < NXT_TLS_RECORD_WARMUP) ? NXT_TLS_BUFFER_SIZE
+                                                : NXT_TLS_RECORD_SIZE;
+
+    return nxt_max(size, tls->write_size);
 }
 
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+
+static ssize_t
+nxt_openssl_conn_io_sendfile(nxt_task_t *task, nxt_sendbuf_t *sb)
+{
+    size_t              size;
+    ossl_ssize_t        ret;
+    nxt_buf_t           *b;
+    nxt_err_t           err;
+    nxt_int_t           n;
+    nxt_conn_t          *c;
+    nxt_openssl_conn_t  *tls;
+
+    tls = sb->tls;
+    c = tls->conn;
+    b = sb->buf;
+
+    if (nxt_slow_path(c->sendfile != NXT_CONN_SENDFILE_ON)) {
+        nxt_alert(task, "file buffer on TLS connection without kTLS");
+        return NXT_ERROR;
+    }
+
+    size = nxt_min((nxt_off_t) sb->limit, b->file_end - b->file_pos);
+
+    ret = SSL_sendfile(tls->session, b->file->fd, b->file_pos, size, 0);
+
+    err = (ret <= 0) ? nxt_socket_errno : 0;
+
+    nxt_debug(task, "SSL_sendfile(%d, %FD, @%O, %uz): %z err:%d",
+              sb->socket, b->file->fd, b->file_pos, size, ret, err);
+
+    if (ret > 0) {
+        if (ret < (ossl_ssize_t) size) {
+            sb->ready = 0;
+        }
+
+        return ret;
+    }
+
+    c->socket.write_ready = sb->ready;
+
+    n = nxt_openssl_conn_test_error(task, c, (int) ret, err,
+                                    NXT_OPENSSL_WRITE);
+
+    sb->ready = c->socket.write_ready;
+
+    if (n == NXT_ERROR) {
+        sb->error = c->socket.error;
+        nxt_openssl_conn_error(task, err, "SSL_sendfile(%d, %FD, @%O, %uz) "
+                               "failed", sb->socket, b->file->fd,
+                               b->file_pos, size);
+    }
+
+    return n;
+}
+
+#endif
+
+
 static ssize_t
 nxt_openssl_conn_io_send(nxt_task_t *task, nxt_sendbuf_t *sb, void *buf,
     size_t size)
@@ -20,10 +20,12 @@ struct nxt_port_handlers_s {
     nxt_port_handler_t  conf_store;
     nxt_port_handler_t  cert_get;
     nxt_port_handler_t  cert_delete;
+    nxt_port_handler_t  ocsp_store;
     nxt_port_handler_t  access_log;
 
     /* File descriptor exchange. */
     nxt_port_handler_t  change_file;
+    nxt_port_handler_t  ocsp_update;
     nxt_port_handler_t  new_port;
     nxt_port_handler_t  get_port;
     nxt_port_handler_t  port_ack;
@@ -81,9 +83,11 @@ typedef enum {
     _NXT_PORT_MSG_CONF_STORE      = nxt_port_handler_idx(conf_store),
     _NXT_PORT_MSG_CERT_GET        = nxt_port_handler_idx(cert_get),
     _NXT_PORT_MSG_CERT_DELETE     = nxt_port_handler_idx(cert_delete),
+    _NXT_PORT_MSG_OCSP_STORE      = nxt_port_handler_idx(ocsp_store),
     _NXT_PORT_MSG_ACCESS_LOG      = nxt_port_handler_idx(access_log),
 
     _NXT_PORT_MSG_CHANGE_FILE     = nxt_port_handler_idx(change_file),
+    _NXT_PORT_MSG_OCSP_UPDATE     = nxt_port_handler_idx(ocsp_update),
     _NXT_PORT_MSG_NEW_PORT        = nxt_port_handler_idx(new_port),
     _NXT_PORT_MSG_GET_PORT        = nxt_port_handler_idx(get_port),
     _NXT_PORT_MSG_PORT_ACK        = nxt_port_handler_idx(port_ack),
@@ -120,8 +124,10 @@ typedef enum {
     NXT_PORT_MSG_CONF_STORE       = nxt_msg_last(_NXT_PORT_MSG_CONF_STORE),
     NXT_PORT_MSG_CERT_GET         = nxt_msg_last(_NXT_PORT_MSG_CERT_GET),
     NXT_PORT_MSG_CERT_DELETE      = nxt_msg_last(_NXT_PORT_MSG_CERT_DELETE),
+    NXT_PORT_MSG_OCSP_STORE       = nxt_msg_last(_NXT_PORT_MSG_OCSP_STORE),
     NXT_PORT_MSG_ACCESS_LOG       = nxt_msg_last(_NXT_PORT_MSG_ACCESS_LOG),
     NXT_PORT_MSG_CHANGE_FILE      = nxt_msg_last(_NXT_PORT_MSG_CHANGE_FILE),
+    NXT_PORT_MSG_OCSP_UPDATE      = nxt_msg_last(_NXT_PORT_MSG_OCSP_UPDATE),
     NXT_PORT_MSG_NEW_PORT         = nxt_msg_last(_NXT_PORT_MSG_NEW_PORT),
     NXT_PORT_MSG_GET_PORT         = nxt_msg_last(_NXT_PORT_MSG_GET_PORT),
     NXT_PORT_MSG_PORT_ACK         = nxt_msg_last(_NXT_PORT_MSG_PORT_ACK),
@@ -224,10 +230,10 @@ struct nxt_port_s {
     /* Maximum interleave of message parts. */
     uint32_t            max_share;
 
-    uint32_t            app_responses;
+    nxt_atomic_t        app_responses;
 
     uint32_t            active_websockets;
-    uint32_t            active_requests;
+    nxt_atomic_t        active_requests;
 
     nxt_port_handler_t  handler;
     nxt_port_handler_t  *data;
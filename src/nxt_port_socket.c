@@ -872,6 +872,9 @@ nxt_port_queue_read_handler(nxt_task_t *task, void *obj, void *data)
         if (n >= (ssize_t) sizeof(nxt_port_msg_t)) {
             nxt_memcpy(&msg.port_msg, qmsg, sizeof(nxt_port_msg_t));
 
+            msg.fd[0] = -1;
+            msg.fd[1] = -1;
+
             if (n > (ssize_t) sizeof(nxt_port_msg_t)) {
                 nxt_memcpy(b->mem.pos, qmsg + sizeof(nxt_port_msg_t),
                            n - sizeof(nxt_port_msg_t));
@@ -43,19 +43,21 @@ nxt_uid_t  nxt_euid;
 nxt_gid_t  nxt_egid;
 
 nxt_bool_t  nxt_proc_conn_matrix[NXT_PROCESS_MAX][NXT_PROCESS_MAX] = {
-    { 1, 1, 1, 1, 1 },
-    { 1, 0, 0, 0, 0 },
-    { 1, 0, 0, 1, 0 },
-    { 1, 0, 1, 0, 1 },
-    { 1, 0, 0, 1, 0 },
+    { 1, 1, 1, 1, 1, 1 },
+    { 1, 0, 0, 0, 0, 0 },
+    { 1, 0, 0, 1, 0, 0 },
+    { 1, 0, 1, 0, 1, 0 },
+    { 1, 0, 0, 1, 0, 0 },
+    { 1, 0, 0, 1, 0, 0 },
 };
 
 nxt_bool_t  nxt_proc_remove_notify_matrix[NXT_PROCESS_MAX][NXT_PROCESS_MAX] = {
-    { 0, 0, 0, 0, 0 },
-    { 0, 0, 0, 0, 0 },
-    { 0, 0, 0, 1, 0 },
-    { 0, 0, 1, 0, 1 },
-    { 0, 0, 0, 1, 0 },
+    { 0, 0, 0, 0, 0, 0 },
+    { 0, 0, 0, 0, 0, 0 },
+    { 0, 0, 0, 1, 0, 0 },
+    { 0, 0, 1, 0, 1, 0 },
+    { 0, 0, 0, 1, 0, 0 },
+    { 0, 0, 0, 0, 0, 0 },
 };
 
 
@@ -112,6 +114,15 @@ nxt_process_child_fixup(nxt_task_t *task, nxt_process_t *process)
 
     rt = task->thread->runtime;
 
+#if (NXT_TLS)
+    /* The TLS session cache contains secrets and is used by router only. */
+
+    if (rt->tls_sessions != NULL && ptype != NXT_PROCESS_ROUTER) {
+        nxt_mem_munmap(rt->tls_sessions, sizeof(nxt_tls_sessions_t));
+        rt->tls_sessions = NULL;
+    }
+#endif
+
     /* Remove not ready processes. */
     nxt_runtime_process_each(rt, p) {
 
@@ -243,7 +254,11 @@ nxt_process_setup(nxt_task_t *task, nxt_process_t *process)
 
     main_port = rt->port_by_type[NXT_PROCESS_MAIN];
 
-    nxt_port_read_close(main_port);
+    /* The main port is already read closed in processes forked by prototype. */
+    if (main_port->pair[0] != -1) {
+        nxt_port_read_close(main_port);
+    }
+
     nxt_port_write_enable(task, main_port);
 
     port = nxt_process_port_first(process);
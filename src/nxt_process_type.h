@@ -14,6 +14,7 @@ typedef enum {
     NXT_PROCESS_CONTROLLER,
     NXT_PROCESS_ROUTER,
     NXT_PROCESS_APP,
+    NXT_PROCESS_PROTOTYPE,
 
     NXT_PROCESS_MAX,
 } nxt_process_type_t;
@@ -20,6 +20,10 @@
 
 #define NXT_SHARED_PORT_ID  0xFFFFu
 
+#define NXT_ROUTER_SCALING_INTERVAL  1000
+#define NXT_ROUTER_FILE_BUF_COUNT    2
+#define NXT_ROUTER_FILE_BUF_SIZE     65536
+
 typedef struct {
     nxt_str_t         type;
     uint32_t          processes;
@@ -27,7 +31,10 @@ typedef struct {
     uint32_t          spare_processes;
     nxt_msec_t        timeout;
     nxt_msec_t        idle_timeout;
+    nxt_str_t         scaling;
     uint32_t          requests;
+    uint32_t          queue;
+    nxt_msec_t        queue_timeout;
     nxt_conf_value_t  *limits_value;
     nxt_conf_value_t  *processes_value;
     nxt_conf_value_t  *targets_value;
@@ -37,6 +44,7 @@ typedef struct {
 typedef struct {
     nxt_str_t         pass;
     nxt_str_t         application;
+    uint8_t           reuseport;
 } nxt_router_listener_conf_t;
 
 
@@ -69,6 +77,67 @@ typedef struct {
 } nxt_app_rpc_t;
 
 
+typedef struct {
+    nxt_str_t               path;
+    nxt_str_t               format;
+    size_t                  buffer_size;
+    nxt_msec_t              flush_interval;
+} nxt_router_access_log_conf_t;
+
+
+/*
+ * A response file that has to be passed through TLS or compression is read
+ * into a few memory buffers, each buffer is refilled when it has been sent.
+ * The response buffers that follow the file are held until it is read.
+ */
+
+typedef struct {
+    nxt_buf_t                *file;
+    nxt_buf_t                *pending;
+    nxt_http_request_t       *request;
+    nxt_uint_t               nbufs;
+} nxt_router_file_reader_t;
+
+
+typedef struct {
+    nxt_str_t                text;
+    nxt_router_access_log_t  *access_log;
+    nxt_socket_conf_joint_t  *joint;
+} nxt_router_access_log_line_t;
+
+
+/*
+ * The engine's access log ring buffer.  The buffer holds a reference
+ * to the access log while it contains lines.  The lines are written
+ * by a thread pool thread, the engine keeps appending new lines
+ * to the free part of the buffer meanwhile.  Lines that do not fit
+ * are dropped and counted, the count is logged on the next flush.
+ */
+
+typedef struct {
+    nxt_router_access_log_t  *access_log;
+
+    u_char                   *start;
+    size_t                   size;
+
+    /* The offset of the oldest line and the size of buffered lines. */
+    size_t                   pos;
+    size_t                   used;
+
+    /* The size of lines being written by the thread pool. */
+    size_t                   flushing;
+
+    nxt_uint_t               dropped;
+
+    struct iovec             iov[2];
+    nxt_uint_t               niov;
+
+    nxt_timer_t              timer;
+    nxt_task_t               task;
+    nxt_job_t                job;
+} nxt_router_access_log_buf_t;
+
+
 typedef struct {
     nxt_app_joint_t         *app_joint;
     uint32_t                generation;
@@ -82,6 +151,7 @@ static void nxt_router_greet_controller(nxt_task_t *task,
     nxt_port_t *controller_port);
 
 static nxt_int_t nxt_router_start_app_process(nxt_task_t *task, nxt_app_t *app);
+static void nxt_router_app_start_buf(nxt_buf_t *b, nxt_app_t *app);
 
 static void nxt_router_new_port_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
@@ -105,8 +175,16 @@ static void nxt_router_conf_send(nxt_task_t *task,
 
 static nxt_int_t nxt_router_conf_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, u_char *start, u_char *end);
+static nxt_int_t nxt_router_conf_process_cpus(nxt_router_conf_t *rtcf,
+    nxt_conf_value_t *conf);
 static nxt_int_t nxt_router_conf_process_static(nxt_task_t *task,
     nxt_router_conf_t *rtcf, nxt_conf_value_t *conf);
+static nxt_int_t nxt_router_static_thread_pool(nxt_task_t *task,
+    nxt_router_conf_t *rtcf, nxt_uint_t threads);
+static void nxt_router_static_thread_pool_release(nxt_task_t *task,
+    void *obj, void *data);
+static void nxt_router_static_thread_pool_destroy(nxt_task_t *task,
+    void *obj, void *data);
 static nxt_int_t nxt_router_conf_process_client_ip(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_socket_conf_t *skcf,
     nxt_conf_value_t *conf);
@@ -135,6 +213,8 @@ static void nxt_router_listen_socket_error(nxt_task_t *task,
 #if (NXT_TLS)
 static void nxt_router_tls_rpc_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
+static void nxt_router_ocsp_update_handler(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg);
 static nxt_int_t nxt_router_conf_tls_insert(nxt_router_temp_conf_t *tmcf,
     nxt_conf_value_t *value, nxt_socket_conf_t *skcf, nxt_tls_init_t *tls_init,
     nxt_bool_t last);
@@ -162,6 +242,8 @@ static nxt_int_t nxt_router_engine_conf_delete(nxt_router_temp_conf_t *tmcf,
 static nxt_int_t nxt_router_engine_joints_create(nxt_router_temp_conf_t *tmcf,
     nxt_router_engine_conf_t *recf, nxt_queue_t *sockets,
     nxt_work_handler_t handler);
+static nxt_int_t nxt_router_engine_pin(nxt_router_temp_conf_t *tmcf,
+    nxt_router_engine_conf_t *recf, nxt_uint_t n);
 static nxt_int_t nxt_router_engine_quit(nxt_router_temp_conf_t *tmcf,
     nxt_router_engine_conf_t *recf);
 static nxt_int_t nxt_router_engine_joints_delete(nxt_router_temp_conf_t *tmcf,
@@ -188,6 +270,10 @@ static void nxt_router_listen_socket_update(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_listen_socket_delete(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_router_engine_affinity(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_listen_sockets_steer(nxt_task_t *task,
+    nxt_router_conf_t *rtcf, nxt_queue_t *sockets);
 static void nxt_router_worker_thread_quit(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_listen_socket_close(nxt_task_t *task, void *obj,
@@ -196,11 +282,56 @@ static void nxt_router_thread_exit_handler(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_req_headers_ack_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, nxt_request_rpc_data_t *req_rpc_data);
+static nxt_buf_t *nxt_router_response_file(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_port_recv_msg_t *msg);
+static void nxt_router_response_file_completion(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_response_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *b);
+static void nxt_router_response_file_read(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_buf_t *fb);
+static void nxt_router_response_file_buf_completion(nxt_task_t *task,
+    void *obj, void *data);
+static nxt_int_t nxt_router_listen_sockets_create(nxt_task_t *task,
+    nxt_router_conf_t *rtcf, nxt_listen_socket_t *ls);
+static void nxt_router_listen_socket_free(nxt_task_t *task,
+    nxt_listen_socket_t *ls);
 static void nxt_router_listen_socket_release(nxt_task_t *task,
     nxt_socket_conf_t *skcf);
 
+static nxt_int_t nxt_router_access_log_create(nxt_task_t *task,
+    nxt_router_conf_t *rtcf, nxt_conf_value_t *value);
 static void nxt_router_access_log_writer(nxt_task_t *task,
     nxt_http_request_t *r, nxt_router_access_log_t *access_log);
+static void nxt_router_access_log_format(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_router_access_log_t *access_log,
+    nxt_var_t *format);
+static void nxt_router_access_log_format_ready(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_access_log_format_error(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_access_log_write(nxt_task_t *task,
+    nxt_router_access_log_t *access_log, u_char *buf, size_t size);
+static nxt_router_access_log_buf_t *nxt_router_access_log_buf(
+    nxt_task_t *task);
+static void nxt_router_access_log_flush(nxt_task_t *task,
+    nxt_router_access_log_buf_t *alb);
+static void nxt_router_access_log_flush_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_access_log_flushed(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_access_log_flush_timer(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_access_log_sync(nxt_task_t *task,
+    nxt_router_access_log_buf_t *alb);
+static nxt_bool_t nxt_router_access_log_done(nxt_task_t *task,
+    nxt_event_engine_t *engine);
+static void nxt_router_access_log_drop(nxt_task_t *task,
+    nxt_router_access_log_buf_t *alb, nxt_router_access_log_t *access_log);
+static void nxt_router_access_log_dropped(nxt_task_t *task,
+    nxt_router_access_log_buf_t *alb);
+static nxt_uint_t nxt_router_access_log_iovec(nxt_router_access_log_buf_t *alb,
+    struct iovec *iov);
 static u_char *nxt_router_access_log_date(u_char *buf, nxt_realtime_t *now,
     struct tm *tm, size_t size, const char *format);
 static void nxt_router_access_log_open(nxt_task_t *task,
@@ -224,6 +355,8 @@ static nxt_int_t nxt_router_app_shared_port_send(nxt_task_t *task,
     nxt_port_t *app_port);
 static void nxt_router_app_port_error(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
+static void nxt_router_app_cancel_requests(nxt_task_t *task,
+    nxt_port_t *port, void *data);
 
 static void nxt_router_app_use(nxt_task_t *task, nxt_app_t *app, int i);
 static void nxt_router_app_unlink(nxt_task_t *task, nxt_app_t *app);
@@ -243,10 +376,17 @@ static nxt_buf_t *nxt_router_prepare_msg(nxt_task_t *task,
     nxt_http_request_t *r, nxt_app_t *app, const nxt_str_t *prefix);
 
 static void nxt_router_app_timeout(nxt_task_t *task, void *obj, void *data);
+static void nxt_router_app_queue_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_app_reject(nxt_task_t *task, nxt_app_t *app,
+    nxt_http_request_t *r, nxt_bool_t timeout);
 static void nxt_router_adjust_idle_timer(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_app_idle_timeout(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_router_app_scaling_start(nxt_task_t *task, nxt_app_t *app);
+static void nxt_router_app_scaling_handler(nxt_task_t *task, void *obj,
+    void *data);
 static void nxt_router_app_joint_release_handler(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_free_app(nxt_task_t *task, void *obj, void *data);
@@ -295,6 +435,9 @@ static const nxt_port_handlers_t  nxt_router_process_port_handlers = {
     .app_restart  = nxt_router_app_restart_handler,
     .remove_pid   = nxt_router_remove_pid_handler,
     .access_log   = nxt_router_access_log_reopen_handler,
+#if (NXT_TLS)
+    .ocsp_update  = nxt_router_ocsp_update_handler,
+#endif
     .rpc_ready    = nxt_port_rpc_handler,
     .rpc_error    = nxt_port_rpc_handler,
     .oosm         = nxt_router_oosm_handler,
@@ -342,6 +485,8 @@ nxt_router_start(nxt_task_t *task, nxt_process_data_t *data)
 
     nxt_log(task, NXT_LOG_INFO, "router started");
 
+    (void) nxt_thread_cpu_affinity_save(task);
+
 #if (NXT_TLS)
     rt->tls = nxt_service_get(rt->services, "SSL/TLS", "OpenSSL");
     if (nxt_slow_path(rt->tls == NULL)) {
@@ -387,6 +532,25 @@ nxt_router_greet_controller(nxt_task_t *task, nxt_port_t *controller_port)
 }
 
 
+/*
+ * The START_PROCESS message buffer contains the application name,
+ * its generation, and configuration.  The main process uses all of them
+ * as the key of the application prototype process.
+ */
+
+static void
+nxt_router_app_start_buf(nxt_buf_t *b, nxt_app_t *app)
+{
+    nxt_buf_cpystr(b, &app->name);
+    *b->mem.free++ = '\0';
+
+    b->mem.free = nxt_sprintf(b->mem.free, b->mem.end, "%uD", app->generation);
+    *b->mem.free++ = '\0';
+
+    nxt_buf_cpystr(b, &app->conf);
+}
+
+
 static void
 nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
     void *data)
@@ -408,7 +572,7 @@ nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
 
     nxt_debug(task, "app '%V' %p start process", &app->name, app);
 
-    size = app->name.length + 1 + app->conf.length;
+    size = app->name.length + 1 + NXT_INT32_T_LEN + 1 + app->conf.length;
 
     b = nxt_buf_mem_ts_alloc(task, task->thread->engine->mem_pool, size);
 
@@ -416,9 +580,7 @@ nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
         goto failed;
     }
 
-    nxt_buf_cpystr(b, &app->name);
-    *b->mem.free++ = '\0';
-    nxt_buf_cpystr(b, &app->conf);
+    nxt_router_app_start_buf(b, app);
 
     app_joint_rpc = nxt_port_rpc_register_handler_ex(task, port,
                                                      nxt_router_app_port_ready,
@@ -578,7 +740,6 @@ nxt_request_rpc_data_unlink(nxt_task_t *task,
     nxt_request_rpc_data_t *req_rpc_data)
 {
     nxt_app_t           *app;
-    nxt_bool_t          unlinked;
     nxt_http_request_t  *r;
 
     nxt_router_msg_cancel(task, req_rpc_data);
@@ -601,23 +762,17 @@ nxt_request_rpc_data_unlink(nxt_task_t *task,
         r->req_rpc_data = NULL;
         req_rpc_data->request = NULL;
 
-        if (app != NULL) {
-            unlinked = 0;
-
-            nxt_thread_mutex_lock(&app->mutex);
-
-            if (r->app_link.next != NULL) {
-                nxt_queue_remove(&r->app_link);
-                r->app_link.next = NULL;
+        if (r->queue_timer.enabled) {
+            (void) nxt_timer_delete(task->thread->engine, &r->queue_timer);
+        }
 
-                unlinked = 1;
-            }
+        if (r->app_link.next != NULL) {
+            nxt_queue_remove(&r->app_link);
+            r->app_link.next = NULL;
 
-            nxt_thread_mutex_unlock(&app->mutex);
+            (void) nxt_atomic_fetch_add(&app->queued, -1);
 
-            if (unlinked) {
-                nxt_mp_release(r->mem_pool);
-            }
+            nxt_mp_release(r->mem_pool);
         }
     }
 
@@ -1090,6 +1245,9 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 
     router = rtcf->router;
 
+    nxt_router_listen_sockets_steer(task, rtcf, &creating_sockets);
+    nxt_router_listen_sockets_steer(task, rtcf, &updating_sockets);
+
     ret = nxt_router_engines_create(task, router, tmcf, interface);
     if (nxt_slow_path(ret != NXT_OK)) {
         goto fail;
@@ -1104,12 +1262,15 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 
     nxt_router_apps_hash_use(task, rtcf, 1);
 
+    nxt_upstream_health_checks_start(task, rtcf->upstreams);
+
     nxt_router_engines_post(router, tmcf);
 
     nxt_queue_add(&router->sockets, &updating_sockets);
     nxt_queue_add(&router->sockets, &creating_sockets);
 
     router->access_log = rtcf->access_log;
+    router->pinned = (rtcf->cpus != NULL || rtcf->numa);
 
     nxt_router_conf_ready(task, tmcf);
 
@@ -1178,7 +1339,6 @@ nxt_router_conf_error(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
 {
     nxt_app_t          *app;
     nxt_queue_t        new_socket_confs;
-    nxt_socket_t       s;
     nxt_router_t       *router;
     nxt_queue_link_t   *qlk;
     nxt_socket_conf_t  *skcf;
@@ -1191,13 +1351,8 @@ nxt_router_conf_error(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
          qlk = nxt_queue_next(qlk))
     {
         skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
-        s = skcf->listen->socket;
-
-        if (s != -1) {
-            nxt_socket_close(task, s);
-        }
 
-        nxt_free(skcf->listen);
+        nxt_router_listen_socket_free(task, skcf->listen);
     }
 
     nxt_queue_init(&new_socket_confs);
@@ -1253,6 +1408,42 @@ static nxt_conf_map_t  nxt_router_conf[] = {
 };
 
 
+static nxt_conf_map_t  nxt_router_settings_conf[] = {
+    {
+        nxt_string("numa"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_router_conf_t, numa),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_access_log_conf[] = {
+    {
+        nxt_string("path"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_router_access_log_conf_t, path),
+    },
+
+    {
+        nxt_string("format"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_router_access_log_conf_t, format),
+    },
+
+    {
+        nxt_string("buffer_size"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_router_access_log_conf_t, buffer_size),
+    },
+
+    {
+        nxt_string("flush_interval"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_router_access_log_conf_t, flush_interval),
+    },
+};
+
+
 static nxt_conf_map_t  nxt_router_app_conf[] = {
     {
         nxt_string("type"),
@@ -1298,6 +1489,18 @@ static nxt_conf_map_t  nxt_router_app_limits_conf[] = {
         NXT_CONF_MAP_INT32,
         offsetof(nxt_router_app_conf_t, requests),
     },
+
+    {
+        nxt_string("queue"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_app_conf_t, queue),
+    },
+
+    {
+        nxt_string("queue_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_router_app_conf_t, queue_timeout),
+    },
 };
 
 
@@ -1319,6 +1522,66 @@ static nxt_conf_map_t  nxt_router_app_processes_conf[] = {
         NXT_CONF_MAP_MSEC,
         offsetof(nxt_router_app_conf_t, idle_timeout),
     },
+
+    {
+        nxt_string("scaling"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_router_app_conf_t, scaling),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_file_cache_conf[] = {
+    {
+        nxt_string("max"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_file_cache_conf_t, max),
+    },
+
+    {
+        nxt_string("inactive"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_file_cache_conf_t, inactive),
+    },
+
+    {
+        nxt_string("valid"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_file_cache_conf_t, valid),
+    },
+
+    {
+        nxt_string("errors"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_file_cache_conf_t, errors),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_http_cache_conf[] = {
+    {
+        nxt_string("max_size"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_cache_conf_t, max_size),
+    },
+
+    {
+        nxt_string("max_entry_size"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_cache_conf_t, max_entry_size),
+    },
+
+    {
+        nxt_string("lock_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_cache_conf_t, lock_timeout),
+    },
+
+    {
+        nxt_string("path"),
+        NXT_CONF_MAP_STR_COPY,
+        offsetof(nxt_cache_conf_t, path),
+    },
 };
 
 
@@ -1334,6 +1597,12 @@ static nxt_conf_map_t  nxt_router_listener_conf[] = {
         NXT_CONF_MAP_STR_COPY,
         offsetof(nxt_router_listener_conf_t, application),
     },
+
+    {
+        nxt_string("reuseport"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_router_listener_conf_t, reuseport),
+    },
 };
 
 
@@ -1403,6 +1672,33 @@ static nxt_conf_map_t  nxt_router_http_conf[] = {
         NXT_CONF_MAP_INT8,
         offsetof(nxt_socket_conf_t, discard_unsafe_fields),
     },
+
+    {
+        nxt_string("body_streaming"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_socket_conf_t, body_streaming),
+    },
+
+    {
+        nxt_string("http2"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_socket_conf_t, http2),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_proxy_conf[] = {
+    {
+        nxt_string("keepalive"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_socket_conf_t, proxy_keepalive),
+    },
+
+    {
+        nxt_string("keepalive_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_socket_conf_t, proxy_keepalive_timeout),
+    },
 };
 
 
@@ -1437,7 +1733,7 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_mp_t                    *mp, *app_mp;
     uint32_t                    next, next_target;
     nxt_int_t                   ret;
-    nxt_str_t                   name, path, target;
+    nxt_str_t                   name, target;
     nxt_app_t                   *app, *prev;
     nxt_str_t                   *t, *s, *targets;
     nxt_uint_t                  n, i;
@@ -1448,16 +1744,16 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_tls_init_t              *tls_init;
     nxt_conf_value_t            *certificate;
 #endif
-    nxt_conf_value_t            *conf, *http, *value, *websocket;
+    nxt_conf_value_t            *conf, *http, *value, *websocket, *proxy;
     nxt_conf_value_t            *applications, *application;
     nxt_conf_value_t            *listeners, *listener;
     nxt_conf_value_t            *routes_conf, *static_conf, *client_ip_conf;
+    nxt_conf_value_t            *cache_conf, *router_conf;
     nxt_socket_conf_t           *skcf;
     nxt_http_routes_t           *routes;
     nxt_event_engine_t          *engine;
     nxt_app_lang_module_t       *lang;
     nxt_router_app_conf_t       apcf;
-    nxt_router_access_log_t     *access_log;
     nxt_router_listener_conf_t  lscf;
 
     static nxt_str_t  http_path = nxt_string("/settings/http");
@@ -1471,10 +1767,15 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     static nxt_str_t  conf_cache_path = nxt_string("/tls/session/cache_size");
     static nxt_str_t  conf_timeout_path = nxt_string("/tls/session/timeout");
     static nxt_str_t  conf_tickets = nxt_string("/tls/session/tickets");
+    static nxt_str_t  conf_ktls = nxt_string("/tls/ktls");
+    static nxt_str_t  conf_ocsp = nxt_string("/tls/ocsp_stapling");
 #endif
     static nxt_str_t  static_path = nxt_string("/settings/http/static");
+    static nxt_str_t  cache_path = nxt_string("/settings/http/cache");
     static nxt_str_t  websocket_path = nxt_string("/settings/http/websocket");
+    static nxt_str_t  proxy_path = nxt_string("/settings/http/proxy");
     static nxt_str_t  client_ip_path = nxt_string("/client_ip");
+    static nxt_str_t  router_path = nxt_string("/settings/router");
 
     conf = nxt_conf_json_parse(tmcf->mem_pool, start, end, NULL);
     if (conf == NULL) {
@@ -1495,6 +1796,22 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         tmcf->router_conf->threads = nxt_ncpu;
     }
 
+    router_conf = nxt_conf_get_path(conf, &router_path);
+
+    if (router_conf != NULL) {
+        ret = nxt_conf_map_object(mp, router_conf, nxt_router_settings_conf,
+                                  nxt_nitems(nxt_router_settings_conf),
+                                  tmcf->router_conf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        ret = nxt_router_conf_process_cpus(tmcf->router_conf, router_conf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
     static_conf = nxt_conf_get_path(conf, &static_path);
 
     ret = nxt_router_conf_process_static(task, tmcf->router_conf, static_conf);
@@ -1502,6 +1819,25 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         return NXT_ERROR;
     }
 
+    cache_conf = nxt_conf_get_path(conf, &cache_path);
+
+    if (cache_conf != NULL) {
+        tmcf->router_conf->http_cache = nxt_mp_get(mp,
+                                                   sizeof(nxt_cache_conf_t));
+        if (nxt_slow_path(tmcf->router_conf->http_cache == NULL)) {
+            return NXT_ERROR;
+        }
+
+        *tmcf->router_conf->http_cache = nxt_http_cache_default_conf;
+
+        ret = nxt_conf_map_object(mp, cache_conf, nxt_router_http_cache_conf,
+                                  nxt_nitems(nxt_router_http_cache_conf),
+                                  tmcf->router_conf->http_cache);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
     router = tmcf->router_conf->router;
 
     applications = nxt_conf_get_path(conf, &applications_path);
@@ -1566,7 +1902,10 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             apcf.spare_processes = 0;
             apcf.timeout = 0;
             apcf.idle_timeout = 15000;
+            nxt_str_null(&apcf.scaling);
             apcf.requests = 0;
+            apcf.queue = 0;
+            apcf.queue_timeout = 0;
             apcf.limits_value = NULL;
             apcf.processes_value = NULL;
             apcf.targets_value = NULL;
@@ -1665,7 +2004,6 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             nxt_queue_init(&app->ports);
             nxt_queue_init(&app->spare_ports);
             nxt_queue_init(&app->idle_ports);
-            nxt_queue_init(&app->ack_waiting_req);
 
             app->name.length = name.length;
             nxt_memcpy(app->name.start, name.start, name.length);
@@ -1678,6 +2016,9 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             app->timeout = apcf.timeout;
             app->idle_timeout = apcf.idle_timeout;
             app->max_requests = apcf.requests;
+            app->max_queue = apcf.queue;
+            app->queue_timeout = apcf.queue_timeout;
+            app->predictive = nxt_str_eq(&apcf.scaling, "predictive", 10);
 
             app->targets = targets;
 
@@ -1709,6 +2050,12 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             app_joint->idle_timer.task = &engine->task;
             app_joint->idle_timer.log = app_joint->idle_timer.task->log;
 
+            app_joint->scaling_timer.bias = NXT_TIMER_DEFAULT_BIAS;
+            app_joint->scaling_timer.work_queue = &engine->fast_work_queue;
+            app_joint->scaling_timer.handler = nxt_router_app_scaling_handler;
+            app_joint->scaling_timer.task = &engine->task;
+            app_joint->scaling_timer.log = app_joint->scaling_timer.task->log;
+
             app_joint->free_app_work.handler = nxt_router_free_app;
             app_joint->free_app_work.task = &engine->task;
             app_joint->free_app_work.obj = app_joint;
@@ -1765,6 +2112,7 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 #endif
 
     websocket = nxt_conf_get_path(conf, &websocket_path);
+    proxy = nxt_conf_get_path(conf, &proxy_path);
 
     listeners = nxt_conf_get_path(conf, &listeners_path);
 
@@ -1794,11 +2142,23 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
             nxt_debug(task, "application: %V", &lscf.application);
 
+            if (lscf.reuseport && skcf->listen->socket == -1
+                && skcf->listen->sockets == NULL)
+            {
+                ret = nxt_router_listen_sockets_create(task, tmcf->router_conf,
+                                                       skcf->listen);
+                if (nxt_slow_path(ret != NXT_OK)) {
+                    goto fail;
+                }
+            }
+
             // STUB, default values if http block is not defined.
             skcf->header_buffer_size = 2048;
             skcf->large_header_buffer_size = 8192;
             skcf->large_header_buffers = 4;
             skcf->discard_unsafe_fields = 1;
+            skcf->body_streaming = 0;
+            skcf->http2 = 0;
             skcf->body_buffer_size = 16 * 1024;
             skcf->max_body_size = 8 * 1024 * 1024;
             skcf->proxy_header_buffer_size = 64 * 1024;
@@ -1811,6 +2171,8 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             skcf->proxy_timeout = 60 * 1000;
             skcf->proxy_send_timeout = 30 * 1000;
             skcf->proxy_read_timeout = 30 * 1000;
+            skcf->proxy_keepalive = 0;
+            skcf->proxy_keepalive_timeout = 60 * 1000;
 
             skcf->websocket_conf.max_frame_size = 1024 * 1024;
             skcf->websocket_conf.read_timeout = 60 * 1000;
@@ -1839,6 +2201,16 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 }
             }
 
+            if (proxy != NULL) {
+                ret = nxt_conf_map_object(mp, proxy, nxt_router_proxy_conf,
+                                          nxt_nitems(nxt_router_proxy_conf),
+                                          skcf);
+                if (ret != NXT_OK) {
+                    nxt_alert(task, "proxy map error");
+                    goto fail;
+                }
+            }
+
             t = &skcf->body_temp_path;
 
             if (t->length == 0) {
@@ -1881,6 +2253,18 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 tls_init->tickets_conf = nxt_conf_get_path(listener,
                                                            &conf_tickets);
 
+                tls_init->name = name;
+
+                tls_init->http2 = skcf->http2;
+
+                value = nxt_conf_get_path(listener, &conf_ktls);
+                tls_init->ktls = (value != NULL
+                                  && nxt_conf_get_boolean(value));
+
+                value = nxt_conf_get_path(listener, &conf_ocsp);
+                tls_init->ocsp_stapling = (value != NULL
+                                           && nxt_conf_get_boolean(value));
+
                 if (nxt_conf_type(certificate) == NXT_CONF_ARRAY) {
                     n = nxt_conf_array_elements_count(certificate);
 
@@ -1935,35 +2319,10 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     value = nxt_conf_get_path(conf, &access_log_path);
 
     if (value != NULL) {
-        nxt_conf_get_string(value, &path);
-
-        access_log = router->access_log;
-
-        if (access_log != NULL && nxt_strstr_eq(&path, &access_log->path)) {
-            nxt_thread_spin_lock(&router->lock);
-            access_log->count++;
-            nxt_thread_spin_unlock(&router->lock);
-
-        } else {
-            access_log = nxt_malloc(sizeof(nxt_router_access_log_t)
-                                    + path.length);
-            if (access_log == NULL) {
-                nxt_alert(task, "failed to allocate access log structure");
-                goto fail;
-            }
-
-            access_log->fd = -1;
-            access_log->handler = &nxt_router_access_log_writer;
-            access_log->count = 1;
-
-            access_log->path.length = path.length;
-            access_log->path.start = (u_char *) access_log
-                                     + sizeof(nxt_router_access_log_t);
-
-            nxt_memcpy(access_log->path.start, path.start, path.length);
+        ret = nxt_router_access_log_create(task, tmcf->router_conf, value);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            goto fail;
         }
-
-        tmcf->router_conf->access_log = access_log;
     }
 
     nxt_queue_add(&deleting_sockets, &router->sockets);
@@ -2017,6 +2376,40 @@ nxt_router_conf_tls_insert(nxt_router_temp_conf_t *tmcf,
 #endif
 
 
+static nxt_int_t
+nxt_router_conf_process_cpus(nxt_router_conf_t *rtcf, nxt_conf_value_t *conf)
+{
+    uint32_t          i, n;
+    nxt_conf_value_t  *cpus, *value;
+
+    static nxt_str_t  cpus_path = nxt_string("/cpu_affinity");
+
+    cpus = nxt_conf_get_path(conf, &cpus_path);
+    if (cpus == NULL) {
+        return NXT_OK;
+    }
+
+    n = nxt_conf_array_elements_count(cpus);
+    if (n == 0) {
+        return NXT_OK;
+    }
+
+    rtcf->cpus = nxt_mp_get(rtcf->mem_pool, n * sizeof(uint32_t));
+    if (nxt_slow_path(rtcf->cpus == NULL)) {
+        return NXT_ERROR;
+    }
+
+    for (i = 0; i < n; i++) {
+        value = nxt_conf_get_array_element(cpus, i);
+        rtcf->cpus[i] = nxt_conf_get_number(value);
+    }
+
+    rtcf->ncpus = n;
+
+    return NXT_OK;
+}
+
+
 static nxt_int_t
 nxt_router_conf_process_static(nxt_task_t *task, nxt_router_conf_t *rtcf,
     nxt_conf_value_t *conf)
@@ -2026,9 +2419,11 @@ nxt_router_conf_process_static(nxt_task_t *task, nxt_router_conf_t *rtcf,
     nxt_str_t         *type, exten, str;
     nxt_int_t         ret;
     nxt_uint_t        exts;
-    nxt_conf_value_t  *mtypes_conf, *ext_conf, *value;
+    nxt_conf_value_t  *mtypes_conf, *ext_conf, *value, *cache_conf;
 
     static nxt_str_t  mtypes_path = nxt_string("/mime_types");
+    static nxt_str_t  cache_path = nxt_string("/open_file_cache");
+    static nxt_str_t  threads_path = nxt_string("/threads");
 
     mp = rtcf->mem_pool;
 
@@ -2094,10 +2489,162 @@ nxt_router_conf_process_static(nxt_task_t *task, nxt_router_conf_t *rtcf,
         }
     }
 
+    cache_conf = nxt_conf_get_path(conf, &cache_path);
+
+    if (cache_conf != NULL) {
+        rtcf->file_cache = nxt_mp_get(mp, sizeof(nxt_file_cache_conf_t));
+        if (nxt_slow_path(rtcf->file_cache == NULL)) {
+            return NXT_ERROR;
+        }
+
+        rtcf->file_cache->max = 1000;
+        rtcf->file_cache->inactive = 60 * 1000;
+        rtcf->file_cache->valid = 60 * 1000;
+        rtcf->file_cache->errors = 0;
+
+        ret = nxt_conf_map_object(mp, cache_conf, nxt_router_file_cache_conf,
+                                  nxt_nitems(nxt_router_file_cache_conf),
+                                  rtcf->file_cache);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
+    value = nxt_conf_get_path(conf, &threads_path);
+
+    if (value != NULL) {
+        ret = nxt_router_static_thread_pool(task, rtcf,
+                                            nxt_conf_get_number(value));
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
     return NXT_OK;
 }
 
 
+/*
+ * The thread pool is shared by all configurations with the same number
+ * of threads.  Idle threads exit after the pool timeout.
+ */
+
+static nxt_int_t
+nxt_router_static_thread_pool(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_uint_t threads)
+{
+    nxt_int_t                 ret;
+    nxt_router_t              *router;
+    nxt_runtime_t             *rt;
+    nxt_thread_pool_t         **tp;
+    nxt_router_thread_pool_t  *rtp, *old;
+
+    router = rtcf->router;
+    rtp = router->thread_pool;
+
+    if (rtp == NULL || rtp->threads != threads) {
+        rtp = nxt_zalloc(sizeof(nxt_router_thread_pool_t));
+        if (nxt_slow_path(rtp == NULL)) {
+            return NXT_ERROR;
+        }
+
+        rt = task->thread->runtime;
+
+        ret = nxt_runtime_thread_pool_create(task->thread, rt, threads,
+                                             60000 * 1000000LL);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_free(rtp);
+            return NXT_ERROR;
+        }
+
+        tp = rt->thread_pools->elts;
+        rtp->pool = tp[rt->thread_pools->nelts - 1];
+        rtp->threads = threads;
+
+        nxt_thread_spin_lock(&router->lock);
+
+        old = router->thread_pool;
+        router->thread_pool = rtp;
+
+        if (old != NULL && old->count != 0) {
+            old = NULL;
+        }
+
+        nxt_thread_spin_unlock(&router->lock);
+
+        if (old != NULL) {
+            nxt_router_static_thread_pool_destroy(task, old, NULL);
+        }
+    }
+
+    ret = nxt_mp_cleanup(rtcf->mem_pool, nxt_router_static_thread_pool_release,
+                         task, rtcf, rtp);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    nxt_thread_spin_lock(&router->lock);
+    rtp->count++;
+    nxt_thread_spin_unlock(&router->lock);
+
+    rtcf->thread_pool = rtp->pool;
+
+    return NXT_OK;
+}
+
+
+/* The handler is called by a configuration memory pool in any thread. */
+
+static void
+nxt_router_static_thread_pool_release(nxt_task_t *task, void *obj,
+    void *data)
+{
+    nxt_router_t              *router;
+    nxt_router_conf_t         *rtcf;
+    nxt_event_engine_t        *engine;
+    nxt_router_thread_pool_t  *rtp;
+
+    rtcf = obj;
+    rtp = data;
+
+    router = rtcf->router;
+
+    nxt_thread_spin_lock(&router->lock);
+
+    if (--rtp->count != 0 || rtp == router->thread_pool) {
+        rtp = NULL;
+    }
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    if (rtp != NULL) {
+        /* The runtime thread pools are managed by the router main thread. */
+        engine = rtp->pool->engine;
+
+        nxt_work_set(&rtp->work, nxt_router_static_thread_pool_destroy,
+                     &engine->task, rtp, NULL);
+
+        nxt_event_engine_post(engine, &rtp->work);
+    }
+}
+
+
+static void
+nxt_router_static_thread_pool_destroy(nxt_task_t *task, void *obj,
+    void *data)
+{
+    nxt_router_thread_pool_t  *rtp;
+
+    rtp = obj;
+
+    nxt_debug(task, "static thread pool %p destroy", rtp->pool);
+
+    nxt_thread_pool_destroy(rtp->pool);
+
+    nxt_free(rtp);
+}
+
+
 static nxt_int_t
 nxt_router_conf_process_client_ip(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_socket_conf_t *skcf, nxt_conf_value_t *conf)
@@ -2529,7 +3076,7 @@ nxt_router_listen_socket_rpc_create(nxt_task_t *task,
 
     size = nxt_sockaddr_size(skcf->listen->sockaddr);
 
-    b = nxt_buf_mem_alloc(tmcf->mem_pool, size, 0);
+    b = nxt_buf_mem_alloc(tmcf->mem_pool, size + 1, 0);
     if (b == NULL) {
         goto fail;
     }
@@ -2537,6 +3084,7 @@ nxt_router_listen_socket_rpc_create(nxt_task_t *task,
     b->completion_handler = nxt_buf_dummy_completion;
 
     b->mem.free = nxt_cpymem(b->mem.free, skcf->listen->sockaddr, size);
+    *b->mem.free++ = (skcf->listen->sockets != NULL);
 
     rt = task->thread->runtime;
     main_port = rt->port_by_type[NXT_PROCESS_MAIN];
@@ -2570,9 +3118,11 @@ static void
 nxt_router_listen_socket_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     void *data)
 {
-    nxt_int_t         ret;
-    nxt_socket_t      s;
-    nxt_socket_rpc_t  *rpc;
+    nxt_int_t            ret;
+    nxt_uint_t           i;
+    nxt_socket_t         s;
+    nxt_socket_rpc_t     *rpc;
+    nxt_listen_socket_t  *ls;
 
     rpc = data;
 
@@ -2590,7 +3140,23 @@ nxt_router_listen_socket_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         goto fail;
     }
 
-    rpc->socket_conf->listen->socket = s;
+    ls = rpc->socket_conf->listen;
+
+    if (ls->sockets != NULL) {
+        for (i = 0; ls->sockets[i] != -1; i++) { /* void */ }
+
+        ls->sockets[i++] = s;
+
+        if (i < ls->nsockets) {
+            nxt_router_listen_socket_rpc_create(task, rpc->temp_conf,
+                                                rpc->socket_conf);
+            return;
+        }
+
+        s = ls->sockets[0];
+    }
+
+    ls->socket = s;
 
     nxt_work_queue_add(&task->thread->engine->fast_work_queue,
                        nxt_router_conf_apply, task, rpc->temp_conf, NULL);
@@ -2697,6 +3263,7 @@ nxt_router_tls_rpc_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         }
 
         tlscf->no_wait_shutdown = 1;
+        tlscf->buffer_size = NXT_TLS_RECORD_SIZE;
         tls->socket_conf->tls = tlscf;
 
     } else {
@@ -2715,6 +3282,7 @@ nxt_router_tls_rpc_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     }
 
     bundle->chain_file = msg->fd[0];
+    bundle->ocsp_file = msg->fd[1];
     bundle->next = tlscf->bundle;
     tlscf->bundle = bundle;
 
@@ -2733,6 +3301,30 @@ fail:
     nxt_router_conf_error(task, tmcf);
 }
 
+
+static void
+nxt_router_ocsp_update_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+{
+    nxt_str_t      name;
+    nxt_runtime_t  *rt;
+
+    if (nxt_slow_path(msg->fd[0] == -1)) {
+        return;
+    }
+
+    rt = task->thread->runtime;
+
+    if (rt->tls->ocsp_update != NULL) {
+        name.start = msg->buf->mem.pos;
+        name.length = nxt_strlen(name.start);
+
+        rt->tls->ocsp_update(task, &name, msg->fd[0]);
+    }
+
+    nxt_fd_close(msg->fd[0]);
+    msg->fd[0] = -1;
+}
+
 #endif
 
 
@@ -2758,7 +3350,7 @@ nxt_router_app_rpc_create(nxt_task_t *task,
 
     nxt_debug(task, "app '%V' prefork", &app->name);
 
-    size = app->name.length + 1 + app->conf.length;
+    size = app->name.length + 1 + NXT_INT32_T_LEN + 1 + app->conf.length;
 
     b = nxt_buf_mem_alloc(tmcf->mem_pool, size, 0);
     if (nxt_slow_path(b == NULL)) {
@@ -2767,9 +3359,7 @@ nxt_router_app_rpc_create(nxt_task_t *task,
 
     b->completion_handler = nxt_buf_dummy_completion;
 
-    nxt_buf_cpystr(b, &app->name);
-    *b->mem.free++ = '\0';
-    nxt_buf_cpystr(b, &app->conf);
+    nxt_router_app_start_buf(b, app);
 
     rt = task->thread->runtime;
     main_port = rt->port_by_type[NXT_PROCESS_MAIN];
@@ -2903,6 +3493,10 @@ nxt_router_engines_create(nxt_task_t *task, nxt_router_t *router,
             recf->action = NXT_ROUTER_ENGINE_KEEP;
             ret = nxt_router_engine_conf_update(tmcf, recf);
 
+            if (ret == NXT_OK) {
+                ret = nxt_router_engine_pin(tmcf, recf, n);
+            }
+
         } else {
             recf->action = NXT_ROUTER_ENGINE_DELETE;
             ret = nxt_router_engine_conf_delete(tmcf, recf);
@@ -2935,6 +3529,11 @@ nxt_router_engines_create(nxt_task_t *task, nxt_router_t *router,
             return ret;
         }
 
+        ret = nxt_router_engine_pin(tmcf, recf, n);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+
         n++;
     }
 
@@ -3062,8 +3661,51 @@ nxt_router_engine_joints_create(nxt_router_temp_conf_t *tmcf,
         joint->socket_conf = skcf;
 
         joint->engine = recf->engine;
+        joint->index = recf - (nxt_router_engine_conf_t *) tmcf->engines->elts;
+    }
+
+    return NXT_OK;
+}
+
+
+/*
+ * The job is added last to run first, so the engine allocates
+ * the new configuration memory already on its CPU.
+ */
+
+static nxt_int_t
+nxt_router_engine_pin(nxt_router_temp_conf_t *tmcf,
+    nxt_router_engine_conf_t *recf, nxt_uint_t n)
+{
+    nxt_int_t          cpu;
+    nxt_joint_job_t    *job;
+    nxt_router_conf_t  *rtcf;
+
+    rtcf = tmcf->router_conf;
+
+    if (rtcf->cpus == NULL && !rtcf->numa && !rtcf->router->pinned) {
+        return NXT_OK;
+    }
+
+    cpu = (rtcf->cpus != NULL) ? (nxt_int_t) rtcf->cpus[n % rtcf->ncpus] : -1;
+
+    job = nxt_mp_get(tmcf->mem_pool, sizeof(nxt_joint_job_t));
+    if (nxt_slow_path(job == NULL)) {
+        return NXT_ERROR;
     }
 
+    job->work.next = recf->jobs;
+    recf->jobs = &job->work;
+
+    job->task = tmcf->engine->task;
+    job->work.handler = nxt_router_engine_affinity;
+    job->work.task = &job->task;
+    job->work.obj = job;
+    job->work.data = (void *) (intptr_t) cpu;
+    job->tmcf = tmcf;
+
+    tmcf->count++;
+
     return NXT_OK;
 }
 
@@ -3192,6 +3834,14 @@ nxt_router_apps_sort(nxt_task_t *task, nxt_router_t *router,
 
     } nxt_queue_loop;
 
+    nxt_queue_each(app, &tmcf->apps, nxt_app_t, link) {
+
+        if (app->predictive) {
+            nxt_router_app_scaling_start(task, app);
+        }
+
+    } nxt_queue_loop;
+
     nxt_queue_add(&router->apps, &tmcf->previous);
     nxt_queue_add(&router->apps, &tmcf->apps);
 }
@@ -3349,6 +3999,7 @@ nxt_router_rt_add_port(nxt_task_t *task, void *obj, void *data)
 static void
 nxt_router_listen_socket_create(nxt_task_t *task, void *obj, void *data)
 {
+    nxt_socket_t             s;
     nxt_joint_job_t          *job;
     nxt_socket_conf_t        *skcf;
     nxt_listen_event_t       *lev;
@@ -3364,7 +4015,17 @@ nxt_router_listen_socket_create(nxt_task_t *task, void *obj, void *data)
     skcf = joint->socket_conf;
     ls = skcf->listen;
 
-    lev = nxt_listen_event(task, ls);
+    lock = &skcf->router_conf->router->lock;
+
+    nxt_thread_spin_lock(lock);
+    ls->count++;
+    nxt_thread_spin_unlock(lock);
+
+    /* Each engine takes its own SO_REUSEPORT socket. */
+    s = (ls->sockets != NULL && joint->index < ls->nsockets)
+        ? ls->sockets[joint->index] : ls->socket;
+
+    lev = nxt_listen_socket_event(task, ls, s);
     if (nxt_slow_path(lev == NULL)) {
         nxt_router_listen_socket_release(task, skcf);
         return;
@@ -3372,12 +4033,6 @@ nxt_router_listen_socket_create(nxt_task_t *task, void *obj, void *data)
 
     lev->socket.data = joint;
 
-    lock = &skcf->router_conf->router->lock;
-
-    nxt_thread_spin_lock(lock);
-    ls->count++;
-    nxt_thread_spin_unlock(lock);
-
     job->work.next = NULL;
     job->work.handler = nxt_router_conf_wait;
 
@@ -3389,11 +4044,11 @@ nxt_inline nxt_listen_event_t *
 nxt_router_listen_event(nxt_queue_t *listen_connections,
     nxt_socket_conf_t *skcf)
 {
-    nxt_socket_t        fd;
-    nxt_queue_link_t    *qlk;
-    nxt_listen_event_t  *lev;
+    nxt_queue_link_t     *qlk;
+    nxt_listen_event_t   *lev;
+    nxt_listen_socket_t  *ls;
 
-    fd = skcf->listen->socket;
+    ls = skcf->listen;
 
     for (qlk = nxt_queue_first(listen_connections);
          qlk != nxt_queue_tail(listen_connections);
@@ -3401,7 +4056,7 @@ nxt_router_listen_event(nxt_queue_t *listen_connections,
     {
         lev = nxt_queue_link_data(qlk, nxt_listen_event_t, link);
 
-        if (fd == lev->socket.fd) {
+        if (ls == lev->listen) {
             return lev;
         }
     }
@@ -3475,6 +4130,69 @@ nxt_router_listen_socket_delete(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static void
+nxt_router_engine_affinity(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_int_t        cpu;
+    nxt_joint_job_t  *job;
+
+    job = obj;
+    cpu = (intptr_t) data;
+
+    (void) nxt_thread_cpu_affinity(task, cpu);
+    (void) nxt_thread_memory_local(task, job->tmcf->router_conf->numa);
+
+    job->work.next = NULL;
+    job->work.handler = nxt_router_conf_wait;
+
+    nxt_event_engine_post(job->tmcf->engine, &job->work);
+}
+
+
+static void
+nxt_router_listen_sockets_steer(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_queue_t *sockets)
+{
+    uint32_t             *cpus;
+    nxt_uint_t           i;
+    nxt_queue_link_t     *qlk;
+    nxt_socket_conf_t    *skcf;
+    nxt_listen_socket_t  *ls;
+
+    if (rtcf->cpus == NULL && !rtcf->router->pinned) {
+        return;
+    }
+
+    for (qlk = nxt_queue_first(sockets);
+         qlk != nxt_queue_tail(sockets);
+         qlk = nxt_queue_next(qlk))
+    {
+        skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
+        ls = skcf->listen;
+
+        if (ls->sockets == NULL) {
+            continue;
+        }
+
+        cpus = NULL;
+
+        if (rtcf->cpus != NULL) {
+            cpus = nxt_mp_get(rtcf->mem_pool, ls->nsockets * sizeof(uint32_t));
+            if (nxt_slow_path(cpus == NULL)) {
+                return;
+            }
+
+            for (i = 0; i < ls->nsockets; i++) {
+                cpus[i] = rtcf->cpus[i % rtcf->ncpus];
+            }
+        }
+
+        /* The connections are still distributed without the program. */
+        (void) nxt_socket_reuseport_cpus(task, ls->socket, cpus, ls->nsockets);
+    }
+}
+
+
 static void
 nxt_router_worker_thread_quit(nxt_task_t *task, void *obj, void *data)
 {
@@ -3486,7 +4204,9 @@ nxt_router_worker_thread_quit(nxt_task_t *task, void *obj, void *data)
 
     engine->shutdown = 1;
 
-    if (nxt_queue_is_empty(&engine->joints)) {
+    if (nxt_router_access_log_done(task, engine)
+        && nxt_queue_is_empty(&engine->joints))
+    {
         nxt_thread_exit(task->thread);
     }
 }
@@ -3547,9 +4267,68 @@ nxt_router_listen_socket_release(nxt_task_t *task, nxt_socket_conf_t *skcf)
     nxt_thread_spin_unlock(lock);
 
     if (ls != NULL) {
+        nxt_router_listen_socket_free(task, ls);
+    }
+}
+
+
+static nxt_int_t
+nxt_router_listen_sockets_create(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_listen_socket_t *ls)
+{
+    nxt_uint_t  i;
+
+#if (NXT_HAVE_UNIX_DOMAIN)
+
+    if (ls->sockaddr->u.sockaddr.sa_family == AF_UNIX) {
+        /* A UNIX domain socket path cannot be bound more than once. */
+        return NXT_OK;
+    }
+
+#endif
+
+#ifdef SO_REUSEPORT
+
+    ls->sockets = nxt_malloc(rtcf->threads * sizeof(nxt_socket_t));
+    if (nxt_slow_path(ls->sockets == NULL)) {
+        return NXT_ERROR;
+    }
+
+    for (i = 0; i < rtcf->threads; i++) {
+        ls->sockets[i] = -1;
+    }
+
+    ls->nsockets = rtcf->threads;
+
+#else
+
+    nxt_log(task, NXT_LOG_WARN, "SO_REUSEPORT is not supported");
+
+#endif
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_router_listen_socket_free(nxt_task_t *task, nxt_listen_socket_t *ls)
+{
+    nxt_uint_t  i;
+
+    if (ls->sockets != NULL) {
+        for (i = 0; i < ls->nsockets; i++) {
+            if (ls->sockets[i] != -1) {
+                nxt_socket_close(task, ls->sockets[i]);
+            }
+        }
+
+        nxt_free(ls->sockets);
+
+    } else if (ls->socket != -1) {
         nxt_socket_close(task, ls->socket);
-        nxt_free(ls);
     }
+
+    nxt_free(ls);
 }
 
 
@@ -3577,7 +4356,9 @@ nxt_router_listen_event_release(nxt_task_t *task, nxt_listen_event_t *lev,
         nxt_router_conf_release(task, joint);
     }
 
-    if (engine->shutdown && nxt_queue_is_empty(&engine->joints)) {
+    if (engine->shutdown && nxt_queue_is_empty(&engine->joints)
+        && nxt_router_access_log_done(task, engine))
+    {
         nxt_thread_exit(task->thread);
     }
 }
@@ -3648,29 +4429,132 @@ nxt_router_conf_release(nxt_task_t *task, nxt_socket_conf_joint_t *joint)
 }
 
 
-static void
-nxt_router_access_log_writer(nxt_task_t *task, nxt_http_request_t *r,
-    nxt_router_access_log_t *access_log)
+static nxt_int_t
+nxt_router_access_log_create(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_conf_value_t *value)
 {
-    size_t     size;
-    u_char     *buf, *p;
-    nxt_off_t  bytes;
+    nxt_int_t                     ret;
+    nxt_router_t                  *router;
+    nxt_runtime_t                 *rt;
+    nxt_thread_pool_t             **tp;
+    nxt_router_access_log_t       *access_log;
+    nxt_router_access_log_conf_t  alcf;
 
-    static nxt_time_string_t  date_cache = {
-        (nxt_atomic_uint_t) -1,
-        nxt_router_access_log_date,
-        "%02d/%s/%4d:%02d:%02d:%02d %c%02d%02d",
-        nxt_length("31/Dec/1986:19:40:00 +0300"),
-        NXT_THREAD_TIME_LOCAL,
-        NXT_THREAD_TIME_SEC,
-    };
+    nxt_memzero(&alcf, sizeof(nxt_router_access_log_conf_t));
 
-    size = r->remote->address_length
-           + 6                  /* ' - - [' */
-           + date_cache.size
-           + 3                  /* '] "' */
-           + r->method->length
-           + 1                  /* space */
+    alcf.flush_interval = 1000;
+
+    if (nxt_conf_type(value) == NXT_CONF_STRING) {
+        nxt_conf_get_string(value, &alcf.path);
+
+    } else {
+        ret = nxt_conf_map_object(rtcf->mem_pool, value,
+                                  nxt_router_access_log_conf,
+                                  nxt_nitems(nxt_router_access_log_conf),
+                                  &alcf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_alert(task, "access log map error");
+            return NXT_ERROR;
+        }
+
+        if (alcf.format.length != 0) {
+            rtcf->access_log_format = nxt_var_compile(&alcf.format,
+                                                      rtcf->mem_pool);
+            if (nxt_slow_path(rtcf->access_log_format == NULL)) {
+                nxt_alert(task, "access log format compile error");
+                return NXT_ERROR;
+            }
+        }
+    }
+
+    router = rtcf->router;
+    access_log = router->access_log;
+
+    if (access_log != NULL
+        && nxt_strstr_eq(&alcf.path, &access_log->path)
+        && alcf.buffer_size == access_log->buffer_size
+        && alcf.flush_interval == access_log->flush_interval)
+    {
+        nxt_thread_spin_lock(&router->lock);
+        access_log->count++;
+        nxt_thread_spin_unlock(&router->lock);
+
+        rtcf->access_log = access_log;
+
+        return NXT_OK;
+    }
+
+    if (alcf.buffer_size != 0 && router->access_log_thread_pool == NULL) {
+        rt = task->thread->runtime;
+
+        /* A single thread keeps the order of the flushed buffers. */
+
+        ret = nxt_runtime_thread_pool_create(task->thread, rt, 1,
+                                             60000 * 1000000LL);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        tp = rt->thread_pools->elts;
+        router->access_log_thread_pool = tp[rt->thread_pools->nelts - 1];
+    }
+
+    access_log = nxt_malloc(sizeof(nxt_router_access_log_t)
+                            + alcf.path.length);
+    if (access_log == NULL) {
+        nxt_alert(task, "failed to allocate access log structure");
+        return NXT_ERROR;
+    }
+
+    access_log->fd = -1;
+    access_log->handler = &nxt_router_access_log_writer;
+    access_log->count = 1;
+    access_log->buffer_size = alcf.buffer_size;
+    access_log->flush_interval = alcf.flush_interval;
+
+    access_log->path.length = alcf.path.length;
+    access_log->path.start = (u_char *) access_log
+                             + sizeof(nxt_router_access_log_t);
+
+    nxt_memcpy(access_log->path.start, alcf.path.start, alcf.path.length);
+
+    rtcf->access_log = access_log;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_router_access_log_writer(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_router_access_log_t *access_log)
+{
+    size_t     size;
+    u_char     *buf, *p;
+    nxt_off_t  bytes;
+    nxt_var_t  *format;
+
+    static nxt_time_string_t  date_cache = {
+        (nxt_atomic_uint_t) -1,
+        nxt_router_access_log_date,
+        "%02d/%s/%4d:%02d:%02d:%02d %c%02d%02d",
+        nxt_length("31/Dec/1986:19:40:00 +0300"),
+        NXT_THREAD_TIME_LOCAL,
+        NXT_THREAD_TIME_SEC,
+    };
+
+    format = r->conf->socket_conf->router_conf->access_log_format;
+
+    if (format != NULL) {
+        nxt_router_access_log_format(task, r, access_log, format);
+        return;
+    }
+
+    size = r->remote->address_length
+           + 6                  /* ' - - [' */
+           + date_cache.size
+           + 3                  /* '] "' */
+           + r->method->length
+           + 1                  /* space */
            + r->target.length
            + 1                  /* space */
            + r->version.length
@@ -3746,7 +4630,409 @@ nxt_router_access_log_writer(nxt_task_t *task, nxt_http_request_t *r,
 
     p = nxt_cpymem(p, "\"\n", 2);
 
-    nxt_fd_write(access_log->fd, buf, p - buf);
+    nxt_router_access_log_write(task, access_log, buf, p - buf);
+}
+
+
+/*
+ * A configured format is compiled once per configuration, so its static
+ * text is copied as is and only the variables are evaluated per request.
+ * The line is resolved asynchronously, hence the request memory pool and
+ * the configuration holding the access log are retained until it is written.
+ */
+
+static void
+nxt_router_access_log_format(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_router_access_log_t *access_log, nxt_var_t *format)
+{
+    nxt_int_t                     ret;
+    nxt_router_access_log_line_t  *line;
+
+    ret = nxt_var_query_init(&r->var_query, r, r->mem_pool);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return;
+    }
+
+    line = nxt_mp_get(r->mem_pool, sizeof(nxt_router_access_log_line_t));
+    if (nxt_slow_path(line == NULL)) {
+        return;
+    }
+
+    line->access_log = access_log;
+    line->joint = r->conf;
+
+    nxt_var_query(task, r->var_query, format, &line->text);
+
+    nxt_mp_retain(r->mem_pool);
+    line->joint->count++;
+
+    nxt_var_query_resolve(task, r->var_query, line,
+                          nxt_router_access_log_format_ready,
+                          nxt_router_access_log_format_error);
+}
+
+
+static void
+nxt_router_access_log_format_ready(nxt_task_t *task, void *obj, void *data)
+{
+    u_char                        *buf, *p;
+    nxt_http_request_t            *r;
+    nxt_router_access_log_line_t  *line;
+
+    r = obj;
+    line = data;
+
+    buf = nxt_mp_nget(r->mem_pool, line->text.length + 1);
+
+    if (nxt_fast_path(buf != NULL)) {
+        p = nxt_cpymem(buf, line->text.start, line->text.length);
+        *p++ = '\n';
+
+        nxt_router_access_log_write(task, line->access_log, buf, p - buf);
+    }
+
+    nxt_router_conf_release(task, line->joint);
+    nxt_mp_release(r->mem_pool);
+}
+
+
+static void
+nxt_router_access_log_format_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_request_t            *r;
+    nxt_router_access_log_line_t  *line;
+
+    r = obj;
+    line = data;
+
+    nxt_router_conf_release(task, line->joint);
+    nxt_mp_release(r->mem_pool);
+}
+
+
+static void
+nxt_router_access_log_write(nxt_task_t *task,
+    nxt_router_access_log_t *access_log, u_char *buf, size_t size)
+{
+    size_t                       avail, pos, n;
+    nxt_router_access_log_buf_t  *alb;
+
+    alb = task->thread->engine->access_log;
+
+    if (alb != NULL && alb->access_log != access_log
+        && alb->access_log != NULL)
+    {
+        if (alb->flushing != 0) {
+            /* The previous access log is still being written. */
+            nxt_router_access_log_drop(task, alb, access_log);
+            return;
+        }
+
+        nxt_router_access_log_sync(task, alb);
+    }
+
+    if (access_log->buffer_size == 0) {
+        goto write;
+    }
+
+    alb = nxt_router_access_log_buf(task);
+    if (nxt_slow_path(alb == NULL)) {
+        goto write;
+    }
+
+    if (alb->access_log == NULL) {
+
+        if (alb->size != access_log->buffer_size) {
+            nxt_free(alb->start);
+
+            alb->size = 0;
+            alb->start = nxt_malloc(access_log->buffer_size);
+            if (nxt_slow_path(alb->start == NULL)) {
+                goto write;
+            }
+
+            alb->size = access_log->buffer_size;
+        }
+
+        if (size > alb->size) {
+            nxt_router_access_log_drop(task, alb, access_log);
+            return;
+        }
+
+        nxt_thread_spin_lock(&nxt_router->lock);
+        access_log->count++;
+        nxt_thread_spin_unlock(&nxt_router->lock);
+
+        alb->access_log = access_log;
+        alb->pos = 0;
+
+        nxt_timer_add(task->thread->engine, &alb->timer,
+                      access_log->flush_interval);
+    }
+
+    avail = alb->size - alb->used;
+
+    if (size > avail) {
+        /* The buffer is full while the thread pool writes its part. */
+        nxt_router_access_log_drop(task, alb, access_log);
+        return;
+    }
+
+    pos = (alb->pos + alb->used) % alb->size;
+    n = nxt_min(size, alb->size - pos);
+
+    nxt_memcpy(alb->start + pos, buf, n);
+    nxt_memcpy(alb->start, buf + n, size - n);
+
+    alb->used += size;
+
+    /*
+     * The buffer is flushed when a half of it is filled,
+     * so the other half can absorb lines until the flush is done.
+     */
+
+    if (alb->used - alb->flushing >= alb->size / 2) {
+        nxt_router_access_log_flush(task, alb);
+    }
+
+    return;
+
+write:
+
+    nxt_fd_write(access_log->fd, buf, size);
+}
+
+
+static nxt_router_access_log_buf_t *
+nxt_router_access_log_buf(nxt_task_t *task)
+{
+    nxt_event_engine_t           *engine;
+    nxt_router_access_log_buf_t  *alb;
+
+    engine = task->thread->engine;
+
+    alb = engine->access_log;
+
+    if (nxt_fast_path(alb != NULL)) {
+        return alb;
+    }
+
+    alb = nxt_zalloc(sizeof(nxt_router_access_log_buf_t));
+    if (nxt_slow_path(alb == NULL)) {
+        return NULL;
+    }
+
+    alb->task = engine->task;
+
+    alb->timer.task = &alb->task;
+    alb->timer.work_queue = &engine->fast_work_queue;
+    alb->timer.handler = nxt_router_access_log_flush_timer;
+    alb->timer.log = engine->task.log;
+
+    engine->access_log = alb;
+
+    return alb;
+}
+
+
+static void
+nxt_router_access_log_flush(nxt_task_t *task, nxt_router_access_log_buf_t *alb)
+{
+    if (alb->flushing != 0 || alb->used == 0) {
+        return;
+    }
+
+    alb->niov = nxt_router_access_log_iovec(alb, alb->iov);
+    alb->flushing = alb->used;
+
+    nxt_job_init(&alb->job, sizeof(nxt_job_t));
+    nxt_job_set_name(&alb->job, "access log flush");
+
+    alb->job.task = &alb->task;
+    alb->job.data = alb;
+    alb->job.thread_pool = nxt_router->access_log_thread_pool;
+    alb->job.abort_handler = nxt_router_access_log_flush_handler;
+
+    nxt_job_start(task, &alb->job, nxt_router_access_log_flush_handler);
+}
+
+
+/*
+ * nxt_router_access_log_flush_handler() runs in a thread pool thread,
+ * it may use only the lines passed in the iovec and the log descriptor.
+ */
+
+static void
+nxt_router_access_log_flush_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_router_access_log_buf_t  *alb;
+
+    alb = data;
+
+    (void) nxt_fd_writev(alb->access_log->fd, alb->iov, alb->niov);
+
+    nxt_job_return(task, &alb->job, nxt_router_access_log_flushed);
+}
+
+
+static void
+nxt_router_access_log_flushed(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_event_engine_t           *engine;
+    nxt_router_access_log_buf_t  *alb;
+
+    alb = data;
+
+    alb->pos = (alb->pos + alb->flushing) % alb->size;
+    alb->used -= alb->flushing;
+    alb->flushing = 0;
+
+    nxt_router_access_log_dropped(task, alb);
+
+    engine = task->thread->engine;
+
+    if (engine->shutdown) {
+        nxt_router_access_log_sync(task, alb);
+
+        if (nxt_queue_is_empty(&engine->joints)) {
+            nxt_thread_exit(task->thread);
+        }
+
+        return;
+    }
+
+    if (alb->used == 0) {
+        nxt_router_access_log_release(task, &nxt_router->lock,
+                                      alb->access_log);
+        alb->access_log = NULL;
+        return;
+    }
+
+    if (alb->used >= alb->size / 2) {
+        nxt_router_access_log_flush(task, alb);
+        return;
+    }
+
+    nxt_timer_add(task->thread->engine, &alb->timer,
+                  alb->access_log->flush_interval);
+}
+
+
+static void
+nxt_router_access_log_flush_timer(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t                  *timer;
+    nxt_router_access_log_buf_t  *alb;
+
+    timer = obj;
+
+    alb = nxt_timer_data(timer, nxt_router_access_log_buf_t, timer);
+
+    nxt_router_access_log_dropped(task, alb);
+
+    nxt_router_access_log_flush(task, alb);
+}
+
+
+static void
+nxt_router_access_log_sync(nxt_task_t *task, nxt_router_access_log_buf_t *alb)
+{
+    nxt_uint_t    niov;
+    struct iovec  iov[2];
+
+    nxt_router_access_log_dropped(task, alb);
+
+    if (alb->access_log == NULL) {
+        return;
+    }
+
+    if (alb->used != 0) {
+        niov = nxt_router_access_log_iovec(alb, iov);
+
+        (void) nxt_fd_writev(alb->access_log->fd, iov, niov);
+
+        alb->used = 0;
+    }
+
+    nxt_timer_disable(task->thread->engine, &alb->timer);
+
+    nxt_router_access_log_release(task, &nxt_router->lock, alb->access_log);
+    alb->access_log = NULL;
+}
+
+
+/*
+ * nxt_router_access_log_done() writes the rest of the lines before
+ * the engine thread exits.  It returns zero while a flush is in progress,
+ * the thread exits when the flush is done then.
+ */
+
+static nxt_bool_t
+nxt_router_access_log_done(nxt_task_t *task, nxt_event_engine_t *engine)
+{
+    nxt_router_access_log_buf_t  *alb;
+
+    alb = engine->access_log;
+
+    if (alb == NULL) {
+        return 1;
+    }
+
+    if (alb->flushing != 0) {
+        return 0;
+    }
+
+    nxt_router_access_log_sync(task, alb);
+
+    return 1;
+}
+
+
+static void
+nxt_router_access_log_drop(nxt_task_t *task, nxt_router_access_log_buf_t *alb,
+    nxt_router_access_log_t *access_log)
+{
+    alb->dropped++;
+
+    if (!alb->timer.enabled && alb->flushing == 0) {
+        nxt_timer_add(task->thread->engine, &alb->timer,
+                      access_log->flush_interval);
+    }
+}
+
+
+static void
+nxt_router_access_log_dropped(nxt_task_t *task,
+    nxt_router_access_log_buf_t *alb)
+{
+    if (alb->dropped != 0) {
+        nxt_log(task, NXT_LOG_WARN, "%ui access log lines dropped",
+                alb->dropped);
+
+        alb->dropped = 0;
+    }
+}
+
+
+static nxt_uint_t
+nxt_router_access_log_iovec(nxt_router_access_log_buf_t *alb,
+    struct iovec *iov)
+{
+    size_t  n;
+
+    n = nxt_min(alb->used, alb->size - alb->pos);
+
+    iov[0].iov_base = alb->start + alb->pos;
+    iov[0].iov_len = n;
+
+    if (n == alb->used) {
+        return 1;
+    }
+
+    iov[1].iov_base = alb->start;
+    iov[1].iov_len = alb->used - n;
+
+    return 2;
 }
 
 
@@ -4062,12 +5348,16 @@ nxt_router_response_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     req_rpc_data = data;
 
     r = req_rpc_data->request;
-    if (nxt_slow_path(r == NULL)) {
-        return;
-    }
+    if (nxt_slow_path(r == NULL || r->error)) {
+        if (msg->fd[0] != -1) {
+            nxt_fd_close(msg->fd[0]);
+            msg->fd[0] = -1;
+        }
+
+        if (r != NULL) {
+            nxt_request_rpc_data_unlink(task, req_rpc_data);
+        }
 
-    if (r->error) {
-        nxt_request_rpc_data_unlink(task, req_rpc_data);
         return;
     }
 
@@ -4103,6 +5393,17 @@ nxt_router_response_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         }
     }
 
+    if (msg->fd[0] != -1) {
+        b = nxt_router_response_file(task, r, msg);
+        if (nxt_slow_path(b == NULL)) {
+            goto fail;
+        }
+
+        nxt_router_response_send(task, r, b);
+
+        return;
+    }
+
     if (b == NULL) {
         return;
     }
@@ -4113,8 +5414,7 @@ nxt_router_response_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     }
 
     if (r->header_sent) {
-        nxt_buf_chain_add(&r->out, b);
-        nxt_http_request_send_body(task, r, NULL);
+        nxt_router_response_send(task, r, b);
 
     } else {
         b_size = nxt_buf_is_mem(b) ? nxt_buf_mem_used_size(&b->mem) : 0;
@@ -4177,59 +5477,408 @@ nxt_router_response_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
             b->mem.pos = nxt_unit_sptr_get(&resp->piggyback_content);
             b->mem.free = b->mem.pos + resp->piggyback_content_length;
 
-        } else {
-            b->mem.pos = b->mem.free;
-        }
+        } else {
+            b->mem.pos = b->mem.free;
+        }
+
+        if (nxt_buf_mem_used_size(&b->mem) == 0) {
+            next = b->next;
+            b->next = NULL;
+
+            nxt_work_queue_add(&task->thread->engine->fast_work_queue,
+                               b->completion_handler, task, b, b->parent);
+
+            b = next;
+        }
+
+        if (b != NULL) {
+            nxt_buf_chain_add(&r->out, b);
+        }
+
+        nxt_http_request_header_send(task, r, nxt_http_request_send_body, NULL);
+
+        if (r->websocket_handshake
+            && r->status == NXT_HTTP_SWITCHING_PROTOCOLS)
+        {
+            app_port = req_rpc_data->app_port;
+            if (nxt_slow_path(app_port == NULL)) {
+                goto fail;
+            }
+
+            nxt_thread_mutex_lock(&app->mutex);
+
+            app_port->main_app_port->active_websockets++;
+
+            nxt_thread_mutex_unlock(&app->mutex);
+
+            nxt_router_app_port_release(task, app_port, NXT_APR_UPGRADE);
+            req_rpc_data->apr_action = NXT_APR_CLOSE;
+
+            nxt_debug(task, "stream #%uD upgrade", req_rpc_data->stream);
+
+            r->state = &nxt_http_websocket;
+
+        } else {
+            r->state = &nxt_http_request_send_state;
+        }
+    }
+
+    return;
+
+fail:
+
+    nxt_http_request_error(task, r, NXT_HTTP_SERVICE_UNAVAILABLE);
+
+    nxt_request_rpc_data_unlink(task, req_rpc_data);
+}
+
+
+/*
+ * The response file message carries a descriptor of the file along with
+ * the range to send, so the content is sent with sendfile() and never
+ * passes through the shared memory.
+ */
+
+static nxt_buf_t *
+nxt_router_response_file(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_port_recv_msg_t *msg)
+{
+    nxt_fd_t                  fd;
+    nxt_buf_t                 *b;
+    nxt_file_t                *file;
+    nxt_file_info_t           fi;
+    nxt_unit_response_file_t  *rf;
+
+    fd = msg->fd[0];
+    msg->fd[0] = -1;
+
+    if (nxt_slow_path(!r->header_sent
+                      || msg->size != sizeof(nxt_unit_response_file_t)))
+    {
+        nxt_alert(task, "invalid response file message");
+        goto fail;
+    }
+
+    rf = (nxt_unit_response_file_t *) msg->buf->mem.pos;
+
+    nxt_debug(task, "router response file %FD @%uL:%uL",
+              fd, rf->offset, rf->size);
+
+    if (nxt_slow_path(rf->size == 0)) {
+        nxt_alert(task, "empty response file range");
+        goto fail;
+    }
+
+    if (nxt_slow_path(fstat(fd, &fi) != 0)) {
+        nxt_alert(task, "fstat(%FD) failed %E", fd, nxt_errno);
+        goto fail;
+    }
+
+    /*
+     * The application may pass any descriptor: a pipe or a socket
+     * would block sendfile() and a range past the end of file would
+     * never complete.
+     */
+
+    if (nxt_slow_path(!nxt_is_file(&fi))) {
+        nxt_alert(task, "response file %FD is not a regular file", fd);
+        goto fail;
+    }
+
+    if (nxt_slow_path(rf->size > (uint64_t) nxt_file_size(&fi)
+                      || rf->offset > (uint64_t) nxt_file_size(&fi) - rf->size))
+    {
+        nxt_alert(task, "response file range %uL:%uL is out of "
+                  "the file size %O", rf->offset, rf->size,
+                  nxt_file_size(&fi));
+        goto fail;
+    }
+
+    b = nxt_buf_file_alloc(r->mem_pool, sizeof(nxt_file_t), 0);
+    if (nxt_slow_path(b == NULL)) {
+        goto fail;
+    }
+
+    file = (nxt_file_t *) b->mem.start;
+    nxt_memzero(file, sizeof(nxt_file_t));
+
+    file->fd = fd;
+
+    b->mem.start = NULL;
+    b->mem.end = NULL;
+    b->mem.pos = NULL;
+    b->mem.free = NULL;
+
+    b->file = file;
+    b->file_pos = rf->offset;
+    b->file_end = rf->offset + rf->size;
+
+    b->completion_handler = nxt_router_response_file_completion;
+    b->parent = r;
+
+    nxt_mp_retain(r->mem_pool);
+
+    return b;
+
+fail:
+
+    nxt_fd_close(fd);
+
+    return NULL;
+}
+
+
+static void
+nxt_router_response_file_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b, *next;
+    nxt_http_request_t  *r;
+
+    b = obj;
+    r = data;
+
+    do {
+        next = b->next;
+
+        if (nxt_buf_is_file(b)) {
+            nxt_fd_close(b->file->fd);
+        }
+
+        nxt_mp_free(r->mem_pool, b);
+        nxt_mp_release(r->mem_pool);
+
+        b = next;
+    } while (b != NULL);
+}
+
+
+static void
+nxt_router_response_send(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *b)
+{
+    nxt_buf_t                 *fb, **prev;
+    nxt_router_file_reader_t  *reader;
+
+    reader = r->file_reader;
+
+    if (reader != NULL) {
+        nxt_buf_chain_add(&reader->pending, b);
+        return;
+    }
+
+    fb = NULL;
+
+    /*
+     * TLS and compression process memory buffers only, unless the TLS
+     * records are encrypted by the kernel.
+     */
+
+    if ((r->tls != NULL && !r->ktls)
+#if (NXT_HAVE_ZLIB)
+        || r->compressor != NULL
+#endif
+       )
+    {
+        for (prev = &b; *prev != NULL; prev = &(*prev)->next) {
+
+            if (nxt_buf_is_file(*prev)) {
+                fb = *prev;
+                *prev = NULL;
+                break;
+            }
+        }
+    }
+
+    if (b != NULL) {
+        nxt_buf_chain_add(&r->out, b);
+        nxt_http_request_send_body(task, r, NULL);
+    }
+
+    if (fb != NULL) {
+        nxt_router_response_file_read(task, r, fb);
+    }
+}
+
+
+static void
+nxt_router_response_file_read(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *fb)
+{
+    size_t                    size;
+    nxt_buf_t                 *b, *out, **next;
+    nxt_off_t                 rest;
+    nxt_work_queue_t          *wq;
+    nxt_router_file_reader_t  *reader;
+
+    wq = &task->thread->engine->fast_work_queue;
+
+    reader = nxt_mp_zget(r->mem_pool, sizeof(nxt_router_file_reader_t));
+    if (nxt_slow_path(reader == NULL)) {
+        goto fail;
+    }
+
+    reader->file = fb;
+    reader->pending = fb->next;
+    reader->request = r;
+
+    fb->next = NULL;
+
+    rest = fb->file_end - fb->file_pos;
+    out = NULL;
+    next = &out;
+
+    do {
+        size = nxt_min(rest, NXT_ROUTER_FILE_BUF_SIZE);
+
+        b = nxt_buf_mem_alloc(r->mem_pool, size, 0);
+        if (nxt_slow_path(b == NULL)) {
+            break;
+        }
+
+        b->completion_handler = nxt_router_response_file_buf_completion;
+        b->parent = reader;
+
+        nxt_mp_retain(r->mem_pool);
+
+        *next = b;
+        next = &b->next;
+
+        reader->nbufs++;
+        rest -= size;
+
+    } while (rest > 0 && reader->nbufs < NXT_ROUTER_FILE_BUF_COUNT);
+
+    if (nxt_slow_path(out == NULL)) {
+        fb->next = reader->pending;
+        goto fail;
+    }
+
+    r->file_reader = reader;
+
+    /* The buffers are filled by their completion handler. */
+    nxt_sendbuf_drain(task, wq, out);
+
+    return;
+
+fail:
+
+    nxt_sendbuf_drain(task, wq, fb);
+
+    nxt_http_request_error_handler(task, r, r->proto.any);
+}
+
+
+static void
+nxt_router_response_file_buf_completion(nxt_task_t *task, void *obj,
+    void *data)
+{
+    ssize_t                   n, size;
+    nxt_buf_t                 *b, *fb, *next, *pending;
+    nxt_off_t                 rest;
+    nxt_uint_t                freed;
+    nxt_work_queue_t          *wq;
+    nxt_http_request_t        *r;
+    nxt_router_file_reader_t  *reader;
+
+    b = obj;
+    reader = data;
+    r = reader->request;
+
+complete_buf:
+
+    fb = reader->file;
+
+    if (fb == NULL || r->error) {
+        goto clean;
+    }
+
+    rest = fb->file_end - fb->file_pos;
+    size = nxt_min(rest, (nxt_off_t) nxt_buf_mem_size(&b->mem));
 
-        if (nxt_buf_mem_used_size(&b->mem) == 0) {
-            next = b->next;
-            b->next = NULL;
+    n = pread(fb->file->fd, b->mem.start, size, fb->file_pos);
 
-            nxt_work_queue_add(&task->thread->engine->fast_work_queue,
-                               b->completion_handler, task, b, b->parent);
+    if (nxt_slow_path(n != size)) {
+        if (n >= 0) {
+            nxt_alert(task, "response file was truncated at %O", fb->file_pos);
 
-            b = next;
+        } else {
+            nxt_alert(task, "pread(%FD, %z, %O) failed %E",
+                      fb->file->fd, size, fb->file_pos, nxt_errno);
         }
 
-        if (b != NULL) {
-            nxt_buf_chain_add(&r->out, b);
-        }
+        nxt_http_request_error_handler(task, r, r->proto.any);
+        goto clean;
+    }
 
-        nxt_http_request_header_send(task, r, nxt_http_request_send_body, NULL);
+    fb->file_pos += n;
 
-        if (r->websocket_handshake
-            && r->status == NXT_HTTP_SWITCHING_PROTOCOLS)
-        {
-            app_port = req_rpc_data->app_port;
-            if (nxt_slow_path(app_port == NULL)) {
-                goto fail;
-            }
+    next = b->next;
 
-            nxt_thread_mutex_lock(&app->mutex);
+    b->next = NULL;
+    b->mem.pos = b->mem.start;
+    b->mem.free = b->mem.start + n;
 
-            app_port->main_app_port->active_websockets++;
+    if (n == rest) {
+        /* The file has been read, the held buffers follow it. */
 
-            nxt_thread_mutex_unlock(&app->mutex);
+        pending = reader->pending;
 
-            nxt_router_app_port_release(task, app_port, NXT_APR_UPGRADE);
-            req_rpc_data->apr_action = NXT_APR_CLOSE;
+        reader->file = NULL;
+        reader->pending = NULL;
+        r->file_reader = NULL;
 
-            nxt_debug(task, "stream #%uD upgrade", req_rpc_data->stream);
+        wq = &task->thread->engine->fast_work_queue;
+        nxt_work_queue_add(wq, fb->completion_handler, task, fb, fb->parent);
 
-            r->state = &nxt_http_websocket;
+        nxt_http_request_send(task, r, b);
 
-        } else {
-            r->state = &nxt_http_request_send_state;
+        if (pending != NULL) {
+            nxt_router_response_send(task, r, pending);
         }
+
+    } else {
+        nxt_http_request_send(task, r, b);
+    }
+
+    if (next != NULL) {
+        b = next;
+        goto complete_buf;
     }
 
     return;
 
-fail:
+clean:
 
-    nxt_http_request_error(task, r, NXT_HTTP_SERVICE_UNAVAILABLE);
+    freed = 0;
 
-    nxt_request_rpc_data_unlink(task, req_rpc_data);
+    do {
+        next = b->next;
+
+        nxt_mp_free(r->mem_pool, b);
+        freed++;
+
+        b = next;
+    } while (b != NULL);
+
+    reader->nbufs -= freed;
+
+    if (reader->nbufs == 0 && reader->file != NULL) {
+        fb = reader->file;
+        fb->next = reader->pending;
+
+        reader->file = NULL;
+        reader->pending = NULL;
+
+        if (r->file_reader == reader) {
+            r->file_reader = NULL;
+        }
+
+        nxt_sendbuf_drain(task, &task->thread->engine->fast_work_queue, fb);
+    }
+
+    while (freed != 0) {
+        nxt_mp_release(r->mem_pool);
+        freed--;
+    }
 }
 
 
@@ -4255,18 +5904,31 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
     app = req_rpc_data->app;
     r = req_rpc_data->request;
 
+    if (app->predictive) {
+        (void) nxt_atomic_fetch_add(&app->wait_time,
+                                    task->thread->engine->timers.now
+                                    - req_rpc_data->queued);
+        (void) nxt_atomic_fetch_add(&app->waited, 1);
+    }
+
     start_process = 0;
     unlinked = 0;
 
-    nxt_thread_mutex_lock(&app->mutex);
-
     if (r->app_link.next != NULL) {
         nxt_queue_remove(&r->app_link);
         r->app_link.next = NULL;
 
+        (void) nxt_atomic_fetch_add(&app->queued, -1);
+
         unlinked = 1;
     }
 
+    if (r->queue_timer.enabled) {
+        (void) nxt_timer_delete(task->thread->engine, &r->queue_timer);
+    }
+
+    nxt_thread_mutex_lock(&app->mutex);
+
     app_port = nxt_port_hash_find(&app->port_hash, msg->port_msg.pid,
                                   msg->port_msg.reply_port);
     if (nxt_slow_path(app_port == NULL)) {
@@ -4319,7 +5981,7 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
         }
     }
 
-    main_app_port->active_requests++;
+    (void) nxt_atomic_fetch_add(&main_app_port->active_requests, 1);
 
     nxt_port_inc_use(app_port);
 
@@ -4535,10 +6197,11 @@ static void
 nxt_router_app_port_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     void *data)
 {
+    nxt_int_t            ret;
     nxt_app_t            *app;
+    nxt_bool_t           cancel;
     nxt_app_joint_t      *app_joint;
-    nxt_queue_link_t     *link;
-    nxt_http_request_t   *r;
+    nxt_event_engine_t   *engine;
     nxt_app_joint_rpc_t  *app_joint_rpc;
 
     nxt_assert(data != NULL);
@@ -4560,43 +6223,84 @@ nxt_router_app_port_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
     nxt_debug(task, "app '%V' %p start error", &app->name, app);
 
-    link = NULL;
-
     nxt_thread_mutex_lock(&app->mutex);
 
     nxt_assert(app->pending_processes != 0);
 
     app->pending_processes--;
 
-    if (app->processes == 0 && !nxt_queue_is_empty(&app->ack_waiting_req)) {
-        link = nxt_queue_first(&app->ack_waiting_req);
+    cancel = (app->processes == 0 && app->pending_processes == 0);
 
-        nxt_queue_remove(link);
-        link->next = NULL;
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    if (!cancel) {
+        return;
     }
 
-    nxt_thread_mutex_unlock(&app->mutex);
+    /*
+     * Requests waiting for the application are linked in per-engine lists,
+     * so each engine cancels its own requests.
+     */
+    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0)
+    {
+        if (nxt_slow_path(engine->port == NULL)) {
+            continue;
+        }
+
+        nxt_router_app_use(task, app, 1);
+
+        ret = nxt_port_post(task, engine->port,
+                            nxt_router_app_cancel_requests, app);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_router_app_use(task, app, -1);
+        }
+    }
+    nxt_queue_loop;
+}
+
+
+static void
+nxt_router_app_cancel_requests(nxt_task_t *task, nxt_port_t *port, void *data)
+{
+    nxt_app_t               *app;
+    nxt_bool_t              cancel;
+    nxt_event_engine_t      *engine;
+    nxt_http_request_t      *r;
+    nxt_request_rpc_data_t  *req_rpc_data;
 
-    while (link != NULL) {
-        r = nxt_container_of(link, nxt_http_request_t, app_link);
+    app = data;
+    engine = task->thread->engine;
 
-        nxt_event_engine_post(r->engine, &r->err_work);
+    nxt_thread_mutex_lock(&app->mutex);
 
-        link = NULL;
+    cancel = (app->processes == 0 && app->pending_processes == 0);
 
-        nxt_thread_mutex_lock(&app->mutex);
+    nxt_thread_mutex_unlock(&app->mutex);
 
-        if (app->processes == 0 && app->pending_processes == 0
-            && !nxt_queue_is_empty(&app->ack_waiting_req))
+    if (cancel) {
+        nxt_queue_each(r, &engine->ack_waiting_req, nxt_http_request_t,
+                       app_link)
         {
-            link = nxt_queue_first(&app->ack_waiting_req);
+            req_rpc_data = r->req_rpc_data;
 
-            nxt_queue_remove(link);
-            link->next = NULL;
-        }
+            if (req_rpc_data == NULL || req_rpc_data->app != app) {
+                continue;
+            }
 
-        nxt_thread_mutex_unlock(&app->mutex);
+            nxt_debug(task, "app '%V' %p cancel request", &app->name, app);
+
+            nxt_queue_remove(&r->app_link);
+            r->app_link.next = NULL;
+
+            (void) nxt_atomic_fetch_add(&app->queued, -1);
+
+            nxt_work_queue_add(&engine->fast_work_queue, r->err_work.handler,
+                               r->err_work.task, r, NULL);
+        }
+        nxt_queue_loop;
     }
+
+    nxt_router_app_use(task, app, -1);
 }
 
 
@@ -4673,11 +6377,12 @@ static void
 nxt_router_app_port_release(nxt_task_t *task, nxt_port_t *port,
     nxt_apr_action_t action)
 {
-    int         inc_use;
-    uint32_t    got_response, dec_requests;
-    nxt_app_t   *app;
-    nxt_bool_t  port_unchained, send_quit, adjust_idle_timer;
-    nxt_port_t  *main_app_port;
+    int               inc_use;
+    uint32_t          got_response, dec_requests;
+    nxt_app_t         *app;
+    nxt_bool_t        port_unchained, send_quit, adjust_idle_timer;
+    nxt_port_t        *main_app_port;
+    nxt_atomic_int_t  requests, responses, active;
 
     nxt_assert(port != NULL);
     nxt_assert(port->app != NULL);
@@ -4711,27 +6416,39 @@ nxt_router_app_port_release(nxt_task_t *task, nxt_port_t *port,
               port->pid, port->id,
               (int) inc_use, (int) got_response);
 
-    if (port->id == NXT_SHARED_PORT_ID) {
-        nxt_thread_mutex_lock(&app->mutex);
-
-        app->active_requests -= got_response + dec_requests;
+    requests = got_response + dec_requests;
 
-        nxt_thread_mutex_unlock(&app->mutex);
+    (void) nxt_atomic_fetch_add(&app->active_requests, -requests);
 
+    if (port->id == NXT_SHARED_PORT_ID) {
         goto adjust_use;
     }
 
     main_app_port = port->main_app_port;
 
-    nxt_thread_mutex_lock(&app->mutex);
+    responses = nxt_atomic_fetch_add(&main_app_port->app_responses,
+                                     got_response)
+                + got_response;
 
-    main_app_port->app_responses += got_response;
-    main_app_port->active_requests -= got_response + dec_requests;
-    app->active_requests -= got_response + dec_requests;
+    active = nxt_atomic_fetch_add(&main_app_port->active_requests, -requests)
+             - requests;
+
+    /*
+     * The port is still busy and chained to the application, so there is
+     * nothing to update in the application process lists.
+     */
+    if (active != 0
+        && main_app_port->app_link.next != NULL
+        && (app->max_requests == 0 || responses < app->max_requests))
+    {
+        goto adjust_use;
+    }
+
+    nxt_thread_mutex_lock(&app->mutex);
 
     if (main_app_port->pair[1] != -1
         && (app->max_requests == 0
-            || main_app_port->app_responses < app->max_requests))
+            || responses < app->max_requests))
     {
         if (main_app_port->app_link.next == NULL) {
             nxt_queue_insert_tail(&app->ports, &main_app_port->app_link);
@@ -4740,8 +6457,7 @@ nxt_router_app_port_release(nxt_task_t *task, nxt_port_t *port,
         }
     }
 
-    send_quit = (app->max_requests > 0
-                 && main_app_port->app_responses >= app->max_requests);
+    send_quit = (app->max_requests > 0 && responses >= app->max_requests);
 
     if (send_quit) {
         port_unchained = nxt_queue_chk_remove(&main_app_port->app_link);
@@ -4936,8 +6652,9 @@ nxt_router_adjust_idle_timer(nxt_task_t *task, void *obj, void *data)
               &app->name,
               (int) app->idle_processes, (int) app->spare_processes);
 
-    while (app->idle_processes > app->spare_processes) {
-
+    while (app->idle_processes > app->spare_processes
+           && app->processes > app->target_processes)
+    {
         nxt_assert(!nxt_queue_is_empty(&app->idle_ports));
 
         lnk = nxt_queue_first(&app->idle_ports);
@@ -5010,6 +6727,138 @@ nxt_router_app_idle_timeout(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static void
+nxt_router_app_scaling_start(nxt_task_t *task, nxt_app_t *app)
+{
+    app->scaling_time = app->engine->timers.now;
+    app->scale_down_start = app->scaling_time;
+
+    nxt_router_app_joint_use(task, app->joint, 1);
+
+    nxt_timer_add(app->engine, &app->joint->scaling_timer,
+                  NXT_ROUTER_SCALING_INTERVAL);
+}
+
+
+/*
+ * The predictive scaling samples the request arrival rate, the number of
+ * active requests, and the time requests wait for an application process,
+ * and smooths them with exponentially weighted moving averages.  The number
+ * of processes needed is the active requests average, scaled by the ratio
+ * of the fast and the slow arrival rate averages while the rate grows, plus
+ * the queue length estimated by Little's law.  The processes are started
+ * ahead of the queue growth; the target is lowered only if the demand stays
+ * lower during idle_timeout.
+ */
+
+static void
+nxt_router_app_scaling_handler(nxt_task_t *task, void *obj, void *data)
+{
+    int64_t            rate, wait, demand;
+    uint32_t           target, start;
+    nxt_app_t          *app;
+    nxt_bool_t         scale_down;
+    nxt_msec_t         now, elapsed;
+    nxt_timer_t        *timer;
+    nxt_app_joint_t    *app_joint;
+    nxt_atomic_uint_t  arrivals, waited, wait_time;
+
+    timer = obj;
+    app_joint = nxt_container_of(timer, nxt_app_joint_t, scaling_timer);
+
+    app = app_joint->app;
+
+    if (nxt_slow_path(app == NULL)) {
+        nxt_router_app_joint_use(task, app_joint, -1);
+        return;
+    }
+
+    now = task->thread->engine->timers.now;
+
+    elapsed = nxt_max(now - app->scaling_time, 1);
+    app->scaling_time = now;
+
+    arrivals = app->arrivals;
+    waited = app->waited;
+    wait_time = app->wait_time;
+
+    /* Requests per second and milliseconds, scaled by 1000. */
+
+    rate = (int64_t) (arrivals - app->last_arrivals) * 1000000 / elapsed;
+
+    if (waited != app->last_waited) {
+        wait = (int64_t) (wait_time - app->last_wait_time) * 1000
+               / (int64_t) (waited - app->last_waited);
+
+    } else {
+        wait = 0;
+    }
+
+    app->last_arrivals = arrivals;
+    app->last_waited = waited;
+    app->last_wait_time = wait_time;
+
+    app->fast_rate += (rate - app->fast_rate) / 2;
+    app->slow_rate += (rate - app->slow_rate) / 8;
+    app->load += ((int64_t) app->active_requests * 1000 - app->load) / 4;
+    app->wait += (wait - app->wait) / 4;
+
+    demand = app->load;
+
+    if (app->fast_rate > app->slow_rate && app->slow_rate > 0) {
+        demand = demand * app->fast_rate / app->slow_rate;
+    }
+
+    demand += app->fast_rate * app->wait / 1000000;
+
+    demand = (demand + 500) / 1000;
+
+    target = nxt_min(demand, (int64_t) app->max_processes);
+    target = nxt_max(target, app->spare_processes);
+
+    scale_down = 0;
+
+    if (target >= app->target_processes) {
+        app->target_processes = target;
+        app->scale_down_start = now;
+
+    } else if (now - app->scale_down_start >= app->idle_timeout) {
+        app->target_processes = target;
+        app->scale_down_start = now;
+
+        scale_down = 1;
+    }
+
+    nxt_debug(task, "app '%V' rate %L/%L, load %L, wait %L, target %uD",
+              &app->name, app->fast_rate, app->slow_rate, app->load,
+              app->wait, app->target_processes);
+
+    start = 0;
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    while (app->processes + app->pending_processes < app->target_processes
+           && nxt_router_app_can_start(app))
+    {
+        app->pending_processes++;
+        start++;
+    }
+
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    while (start != 0) {
+        nxt_router_start_app_process(task, app);
+        start--;
+    }
+
+    if (scale_down) {
+        nxt_router_adjust_idle_timer(task, app, NULL);
+    }
+
+    nxt_timer_add(task->thread->engine, timer, NXT_ROUTER_SCALING_INTERVAL);
+}
+
+
 static void
 nxt_router_app_joint_release_handler(nxt_task_t *task, void *obj, void *data)
 {
@@ -5028,11 +6877,14 @@ nxt_router_free_app(nxt_task_t *task, void *obj, void *data)
 {
     nxt_app_t        *app;
     nxt_port_t       *port;
+    nxt_bool_t       predictive;
     nxt_app_joint_t  *app_joint;
 
     app_joint = obj;
     app = app_joint->app;
 
+    predictive = app->predictive;
+
     for ( ;; ) {
         port = nxt_router_app_get_port_for_quit(task, app);
         if (port == NULL) {
@@ -5090,6 +6942,15 @@ nxt_router_free_app(nxt_task_t *task, void *obj, void *data)
 
     app_joint->app = NULL;
 
+    if (predictive) {
+        if (nxt_timer_delete(task->thread->engine, &app_joint->scaling_timer)) {
+            nxt_timer_add(task->thread->engine, &app_joint->scaling_timer, 0);
+
+        } else {
+            nxt_router_app_joint_use(task, app_joint, -1);
+        }
+    }
+
     if (nxt_timer_delete(task->thread->engine, &app_joint->idle_timer)) {
         app_joint->idle_timer.handler = nxt_router_app_joint_release_handler;
         nxt_timer_add(task->thread->engine, &app_joint->idle_timer, 0);
@@ -5110,27 +6971,40 @@ nxt_router_app_port_get(nxt_task_t *task, nxt_app_t *app,
 
     start_process = 0;
 
-    nxt_thread_mutex_lock(&app->mutex);
-
     port = app->shared_port;
     nxt_port_inc_use(port);
 
-    app->active_requests++;
+    (void) nxt_atomic_fetch_add(&app->active_requests, 1);
 
-    if (nxt_router_app_can_start(app) && nxt_router_app_need_start(app)) {
-        app->pending_processes++;
-        start_process = 1;
+    if (app->predictive) {
+        (void) nxt_atomic_fetch_add(&app->arrivals, 1);
+    }
+
+    /*
+     * The check is repeated under the mutex, so the mutex is taken
+     * only when the application probably needs one more process.
+     */
+    if (nxt_router_app_need_start(app)) {
+        nxt_thread_mutex_lock(&app->mutex);
+
+        if (nxt_router_app_can_start(app) && nxt_router_app_need_start(app)) {
+            app->pending_processes++;
+            start_process = 1;
+        }
+
+        nxt_thread_mutex_unlock(&app->mutex);
     }
 
     r = req_rpc_data->request;
 
     /*
-     * Put request into application-wide list to be able to cancel request
-     * if something goes wrong with application processes.
+     * Put request into engine-wide list to be able to cancel request
+     * if something goes wrong with application processes.  The list is
+     * accessed only by the request engine, so no locking is required.
      */
-    nxt_queue_insert_tail(&app->ack_waiting_req, &r->app_link);
+    nxt_queue_insert_tail(&r->engine->ack_waiting_req, &r->app_link);
 
-    nxt_thread_mutex_unlock(&app->mutex);
+    (void) nxt_atomic_fetch_add(&app->queued, 1);
 
     /*
      * Retain request memory pool while request is linked in ack_waiting_req
@@ -5140,6 +7014,11 @@ nxt_router_app_port_get(nxt_task_t *task, nxt_app_t *app,
 
     req_rpc_data->app_port = port;
     req_rpc_data->apr_action = NXT_APR_REQUEST_FAILED;
+    req_rpc_data->queued = r->engine->timers.now;
+
+    if (app->queue_timeout != 0) {
+        nxt_timer_add(r->engine, &r->queue_timer, app->queue_timeout);
+    }
 
     if (start_process) {
         nxt_router_start_app_process(task, app);
@@ -5151,6 +7030,7 @@ void
 nxt_router_process_http_request(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_action_t *action)
 {
+    nxt_app_t               *app;
     nxt_event_engine_t      *engine;
     nxt_http_app_conf_t     *conf;
     nxt_request_rpc_data_t  *req_rpc_data;
@@ -5158,6 +7038,13 @@ nxt_router_process_http_request(nxt_task_t *task, nxt_http_request_t *r,
     conf = action->u.conf;
     engine = task->thread->engine;
 
+    app = conf->app;
+
+    if (app->max_queue != 0 && (nxt_uint_t) app->queued >= app->max_queue) {
+        nxt_router_app_reject(task, app, r, 0);
+        return;
+    }
+
     r->app_target = conf->target;
 
     req_rpc_data = nxt_port_rpc_register_handler_ex(task, engine->port,
@@ -5184,6 +7071,12 @@ nxt_router_process_http_request(nxt_task_t *task, nxt_http_request_t *r,
     r->timer.log = engine->task.log;
     r->timer.bias = NXT_TIMER_DEFAULT_BIAS;
 
+    r->queue_timer.task = &engine->task;
+    r->queue_timer.work_queue = &engine->fast_work_queue;
+    r->queue_timer.log = engine->task.log;
+    r->queue_timer.bias = NXT_TIMER_DEFAULT_BIAS;
+    r->queue_timer.handler = nxt_router_app_queue_timeout;
+
     r->engine = engine;
     r->err_work.handler = nxt_router_http_request_error;
     r->err_work.task = task;
@@ -5248,6 +7141,7 @@ static void
 nxt_router_app_prepare_request(nxt_task_t *task,
     nxt_request_rpc_data_t *req_rpc_data)
 {
+    nxt_fd_t          body_fd;
     nxt_app_t         *app;
     nxt_buf_t         *buf, *body;
     nxt_int_t         res;
@@ -5271,12 +7165,27 @@ nxt_router_app_prepare_request(nxt_task_t *task,
 
     reply_port = task->thread->engine->port;
 
+    res = nxt_http_request_body_stream(task, req_rpc_data->request, &body_fd);
+    if (nxt_slow_path(res != NXT_OK)) {
+        nxt_alert(task, "stream #%uD, app '%V': failed to stream body",
+                  req_rpc_data->stream, &app->name);
+
+        nxt_http_request_error(task, req_rpc_data->request,
+                               NXT_HTTP_INTERNAL_SERVER_ERROR);
+
+        return;
+    }
+
     buf = nxt_router_prepare_msg(task, req_rpc_data->request, app,
                                  nxt_app_msg_prefix[app->type]);
     if (nxt_slow_path(buf == NULL)) {
         nxt_alert(task, "stream #%uD, app '%V': failed to prepare app message",
                   req_rpc_data->stream, &app->name);
 
+        if (body_fd != -1) {
+            nxt_fd_close(body_fd);
+        }
+
         nxt_http_request_error(task, req_rpc_data->request,
                                NXT_HTTP_INTERNAL_SERVER_ERROR);
 
@@ -5291,7 +7200,10 @@ nxt_router_app_prepare_request(nxt_task_t *task,
 
     body = req_rpc_data->request->body;
 
-    if (body != NULL && nxt_buf_is_file(body)) {
+    if (body_fd != -1) {
+        req_rpc_data->msg_info.body_fd = body_fd;
+
+    } else if (body != NULL && nxt_buf_is_file(body)) {
         req_rpc_data->msg_info.body_fd = body->file->fd;
 
         body->file->fd = -1;
@@ -5478,6 +7390,7 @@ nxt_router_prepare_msg(nxt_task_t *task, nxt_http_request_t *r,
     *p++ = '\0';
 
     req->tls = (r->tls != NULL);
+    req->ktls = r->ktls;
     req->websocket_handshake = r->websocket_handshake;
 
     req->server_name_length = r->server_name.length;
@@ -5690,6 +7603,62 @@ nxt_router_app_timeout(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static void
+nxt_router_app_queue_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t              *timer;
+    nxt_http_request_t       *r;
+    nxt_request_rpc_data_t   *req_rpc_data;
+
+    timer = obj;
+
+    nxt_debug(task, "router app queue timeout");
+
+    r = nxt_timer_data(timer, nxt_http_request_t, queue_timer);
+    req_rpc_data = r->req_rpc_data;
+
+    nxt_router_app_reject(task, req_rpc_data->app, r, 1);
+
+    nxt_request_rpc_data_unlink(task, req_rpc_data);
+}
+
+
+static void
+nxt_router_app_reject(nxt_task_t *task, nxt_app_t *app, nxt_http_request_t *r,
+    nxt_bool_t timeout)
+{
+    nxt_uint_t         retry_after;
+    nxt_atomic_uint_t  rejected;
+
+    static nxt_log_moderation_t  nxt_router_app_reject_log_moderation = {
+        NXT_LOG_WARN, 1, "application requests rejected", NXT_LOG_MODERATION
+    };
+
+    rejected = nxt_atomic_fetch_add(&app->rejected, 1) + 1;
+
+    if (timeout) {
+        nxt_log_moderate(&nxt_router_app_reject_log_moderation, NXT_LOG_WARN,
+                         task->log, "app \"%V\" request queue timeout "
+                         "expired, %uA requests queued, %uA rejected",
+                         &app->name, (nxt_atomic_uint_t) app->queued,
+                         rejected);
+
+    } else {
+        nxt_log_moderate(&nxt_router_app_reject_log_moderation, NXT_LOG_WARN,
+                         task->log, "app \"%V\" request queue limit "
+                         "exceeded, %uA requests queued, %uA rejected",
+                         &app->name, (nxt_atomic_uint_t) app->queued,
+                         rejected);
+    }
+
+    retry_after = (app->queue_timeout != 0)
+                  ? (app->queue_timeout + 999) / 1000 : 1;
+
+    nxt_http_request_error_retry(task, r, NXT_HTTP_SERVICE_UNAVAILABLE,
+                                 retry_after);
+}
+
+
 static void
 nxt_router_http_request_release_post(nxt_task_t *task, nxt_http_request_t *r)
 {
@@ -27,6 +27,20 @@ typedef struct nxt_router_access_log_s  nxt_router_access_log_t;
 #define NXT_HTTP_ACTION_ERROR  ((nxt_http_action_t *) -1)
 
 
+/*
+ * A static thread pool is sized when it is created.  A configuration with
+ * another number of threads gets a new pool, and the previous one is
+ * destroyed when the last configuration using it is released.
+ */
+
+typedef struct {
+    nxt_thread_pool_t        *pool;
+    nxt_uint_t               threads;
+    nxt_uint_t               count;  /* Protected by the router lock. */
+    nxt_work_t               work;
+} nxt_router_thread_pool_t;
+
+
 typedef struct {
     nxt_thread_spinlock_t    lock;
     nxt_queue_t              engines;
@@ -35,6 +49,14 @@ typedef struct {
     nxt_queue_t              apps;     /* of nxt_app_t */
 
     nxt_router_access_log_t  *access_log;
+    nxt_router_thread_pool_t *thread_pool;
+    nxt_thread_pool_t        *access_log_thread_pool;
+    nxt_cache_t              *http_cache;
+    /* The configurations using the cache, protected by the router lock. */
+    nxt_uint_t               http_cache_count;
+
+    /* The engine threads have been bound to CPUs or NUMA nodes. */
+    uint8_t                  pinned;  /* 1 bit */
 } nxt_router_t;
 
 
@@ -51,7 +73,17 @@ typedef struct {
     nxt_lvlhsh_t             mtypes_hash;
     nxt_lvlhsh_t             apps_hash;
 
+    nxt_file_cache_conf_t    *file_cache;
+    nxt_thread_pool_t        *thread_pool;
+    nxt_cache_conf_t         *http_cache;
+
     nxt_router_access_log_t  *access_log;
+    nxt_var_t                *access_log_format;
+
+    /* The CPUs to bind engine threads to, in order of the engines. */
+    uint32_t                 *cpus;
+    uint32_t                 ncpus;
+    uint8_t                  numa;  /* 1 bit */
 } nxt_router_conf_t;
 
 
@@ -98,6 +130,7 @@ typedef struct {
     uint32_t               use_count;
     nxt_app_t              *app;
     nxt_timer_t            idle_timer;
+    nxt_timer_t            scaling_timer;
     nxt_work_t             free_app_work;
 } nxt_app_joint_t;
 
@@ -116,7 +149,7 @@ struct nxt_app_s {
 
     uint32_t               port_hash_count;
 
-    uint32_t               active_requests;
+    nxt_atomic_t           active_requests;
     uint32_t               pending_processes;
     uint32_t               processes;
     uint32_t               idle_processes;
@@ -125,15 +158,41 @@ struct nxt_app_s {
     uint32_t               spare_processes;
     uint32_t               max_pending_processes;
     uint32_t               max_requests;
+    uint32_t               max_queue;
 
     uint32_t               generation;
 
     nxt_msec_t             timeout;
     nxt_msec_t             idle_timeout;
+    nxt_msec_t             queue_timeout;
+
+    /* Requests waiting for an application process ack. */
+    nxt_atomic_t           queued;
+    nxt_atomic_t           rejected;
 
     nxt_str_t              *targets;
 
     nxt_app_type_t         type:8;
+    uint8_t                predictive;  /* 1 bit */
+
+    /* Predictive scaling, see nxt_router_app_scaling_handler(). */
+    nxt_atomic_t           arrivals;
+    nxt_atomic_t           waited;
+    nxt_atomic_t           wait_time;
+
+    nxt_atomic_uint_t      last_arrivals;
+    nxt_atomic_uint_t      last_waited;
+    nxt_atomic_uint_t      last_wait_time;
+    nxt_msec_t             scaling_time;
+
+    /* Exponentially weighted moving averages, scaled by 1000. */
+    int64_t                fast_rate;
+    int64_t                slow_rate;
+    int64_t                load;
+    int64_t                wait;
+
+    uint32_t               target_processes;
+    nxt_msec_t             scale_down_start;
 
     nxt_mp_t               *mem_pool;
     nxt_queue_link_t       link;
@@ -141,7 +200,6 @@ struct nxt_app_s {
     nxt_str_t              conf;
 
     nxt_atomic_t           use_count;
-    nxt_queue_t            ack_waiting_req; /* of nxt_http_request_t.app_link */
 
     nxt_app_joint_t        *joint;
     nxt_port_t             *shared_port;
@@ -181,6 +239,7 @@ typedef struct {
     size_t                 proxy_header_buffer_size;
     size_t                 proxy_buffer_size;
     size_t                 proxy_buffers;
+    size_t                 proxy_keepalive;
 
     nxt_msec_t             idle_timeout;
     nxt_msec_t             header_read_timeout;
@@ -189,12 +248,15 @@ typedef struct {
     nxt_msec_t             proxy_timeout;
     nxt_msec_t             proxy_send_timeout;
     nxt_msec_t             proxy_read_timeout;
+    nxt_msec_t             proxy_keepalive_timeout;
 
     nxt_websocket_conf_t   websocket_conf;
 
     nxt_str_t              body_temp_path;
 
     uint8_t                discard_unsafe_fields;  /* 1 bit */
+    uint8_t                body_streaming;         /* 1 bit */
+    uint8_t                http2;                  /* 1 bit */
 
     nxt_http_client_ip_t   *client_ip;
 
@@ -210,6 +272,9 @@ typedef struct {
     nxt_event_engine_t     *engine;
     nxt_socket_conf_t      *socket_conf;
 
+    /* The engine index, it selects the engine's SO_REUSEPORT socket. */
+    uint32_t               index;
+
     nxt_joint_job_t        *close_job;
 
     nxt_upstream_t         **upstreams;
@@ -224,6 +289,10 @@ struct nxt_router_access_log_s {
     nxt_fd_t               fd;
     nxt_str_t              path;
     uint32_t               count;
+
+    /* The per-engine buffer size, zero disables buffering. */
+    size_t                 buffer_size;
+    nxt_msec_t             flush_interval;
 };
 
 
@@ -29,6 +29,8 @@ typedef struct {
 
     nxt_port_t              *app_port;
     nxt_apr_action_t        apr_action;
+    /* The time the request was queued to the application. */
+    nxt_msec_t              queued;
 
     nxt_http_request_t      *request;
     nxt_msg_info_t          msg_info;
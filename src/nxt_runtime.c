@@ -665,10 +665,13 @@ nxt_runtime_thread_pool_create(nxt_thread_t *thr, nxt_runtime_t *rt,
                                          thr->engine,
                                          nxt_runtime_thread_pool_exit);
 
-    if (nxt_fast_path(thread_pool != NULL)) {
-        *tp = thread_pool;
+    if (nxt_slow_path(thread_pool == NULL)) {
+        nxt_array_remove_last(rt->thread_pools);
+        return NXT_ERROR;
     }
 
+    *tp = thread_pool;
+
     return NXT_OK;
 }
 
@@ -871,6 +874,23 @@ nxt_runtime_conf_init(nxt_task_t *task, nxt_runtime_t *rt)
                   "mkdir(%s) failed %E", file_name.start, nxt_errno);
     }
 
+    ret = nxt_file_name_create(rt->mem_pool, &file_name, "%s%socsp/%Z",
+                               rt->state, slash);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    ret = mkdir((char *) file_name.start, S_IRWXU);
+
+    if (nxt_fast_path(ret == 0 || nxt_errno == EEXIST)) {
+        rt->ocsp.length = file_name.len;
+        rt->ocsp.start = file_name.start;
+
+    } else {
+        nxt_alert(task, "Unable to create OCSP responses storage directory: "
+                  "mkdir(%s) failed %E", file_name.start, nxt_errno);
+    }
+
     control.length = nxt_strlen(rt->control);
     control.start = (u_char *) rt->control;
 
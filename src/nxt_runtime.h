@@ -30,6 +30,7 @@ struct nxt_runtime_s {
 
 #if (NXT_TLS)
     const nxt_tls_lib_t    *tls;
+    nxt_tls_sessions_t     *tls_sessions;
 #endif
 
     nxt_array_t            *thread_pools;       /* of nxt_thread_pool_t */
@@ -71,6 +72,7 @@ struct nxt_runtime_s {
     const char             *tmp;
 
     nxt_str_t              certs;
+    nxt_str_t              ocsp;
 
     nxt_queue_t            engines;            /* of nxt_event_engine_t */
 
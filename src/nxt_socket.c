@@ -50,6 +50,77 @@ nxt_socket_create(nxt_task_t *task, nxt_uint_t domain, nxt_uint_t type,
 }
 
 
+/*
+ * Steers connections of the SO_REUSEPORT group to the socket
+ * of the thread bound to the CPU which has received the connection.
+ * The "cpus" array holds the CPUs of the group sockets in order of
+ * their creation.  Connections received on other CPUs are distributed
+ * by the kernel hash.  A NULL "cpus" array detaches the program.
+ */
+
+nxt_int_t
+nxt_socket_reuseport_cpus(nxt_task_t *task, nxt_socket_t s, uint32_t *cpus,
+    nxt_uint_t n)
+{
+#if (NXT_HAVE_REUSEPORT_CBPF)
+
+    int                 ret;
+    nxt_uint_t          i;
+    struct sock_fprog   prog;
+    struct sock_filter  *code, *p;
+
+    if (cpus == NULL) {
+#ifdef SO_DETACH_REUSEPORT_BPF
+        (void) setsockopt(s, SOL_SOCKET, SO_DETACH_REUSEPORT_BPF, NULL, 0);
+#endif
+        return NXT_OK;
+    }
+
+    code = nxt_malloc((2 * n + 2) * sizeof(struct sock_filter));
+    if (nxt_slow_path(code == NULL)) {
+        return NXT_ERROR;
+    }
+
+    p = code;
+
+    *p++ = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                         SKF_AD_OFF + SKF_AD_CPU);
+
+    for (i = 0; i < n; i++) {
+        *p++ = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                             cpus[i], 0, 1);
+        *p++ = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, i);
+    }
+
+    /* An index out of the group falls back to the hash. */
+    *p++ = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF);
+
+    prog.len = p - code;
+    prog.filter = code;
+
+    ret = setsockopt(s, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                     &prog, sizeof(struct sock_fprog));
+
+    nxt_free(code);
+
+    if (nxt_slow_path(ret != 0)) {
+        nxt_alert(task, "setsockopt(%d, SO_ATTACH_REUSEPORT_CBPF) failed %E",
+                  s, nxt_socket_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_debug(task, "setsockopt(%d, SO_ATTACH_REUSEPORT_CBPF): %ui", s, n);
+
+    return NXT_OK;
+
+#else
+
+    return NXT_OK;
+
+#endif
+}
+
+
 void
 nxt_socket_defer_accept(nxt_task_t *task, nxt_socket_t s, nxt_sockaddr_t *sa)
 {
@@ -133,6 +204,11 @@ nxt_socket_sockopt_name(nxt_uint_t level, nxt_uint_t sockopt)
         case SO_REUSEADDR:
             return "SO_REUSEADDR";
 
+#ifdef SO_REUSEPORT
+        case SO_REUSEPORT:
+            return "SO_REUSEPORT";
+#endif
+
         case SO_TYPE:
             return "SO_TYPE";
         }
@@ -93,6 +93,8 @@ typedef union {
 
 NXT_EXPORT nxt_socket_t nxt_socket_create(nxt_task_t *task, nxt_uint_t family,
     nxt_uint_t type, nxt_uint_t protocol, nxt_uint_t flags);
+NXT_EXPORT nxt_int_t nxt_socket_reuseport_cpus(nxt_task_t *task,
+    nxt_socket_t s, uint32_t *cpus, nxt_uint_t n);
 NXT_EXPORT void nxt_socket_defer_accept(nxt_task_t *task, nxt_socket_t s,
     nxt_sockaddr_t *sa);
 NXT_EXPORT nxt_int_t nxt_socket_getsockopt(nxt_task_t *task, nxt_socket_t s,
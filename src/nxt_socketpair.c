@@ -256,7 +256,14 @@ nxt_recvmsg(nxt_socket_t s, nxt_fd_t *fd, nxt_iobuf_t *iob, nxt_uint_t niob)
 
     n = recvmsg(s, &msg, 0);
 
+    /*
+     * The control message is tested only if it has been received,
+     * otherwise the stack contents left by a previous call could be
+     * taken for a descriptor.
+     */
+
     if (n > 0
+        && msg.msg_controllen >= CMSG_LEN(sizeof(int))
         && cmsg.cm.cmsg_level == SOL_SOCKET
         && cmsg.cm.cmsg_type == SCM_RIGHTS)
     {
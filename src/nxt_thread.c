@@ -239,6 +239,137 @@ nxt_thread_wait(nxt_thread_handle_t handle)
 }
 
 
+#if (NXT_HAVE_SCHED_SETAFFINITY)
+
+static cpu_set_t   nxt_thread_cpu_set;
+static nxt_bool_t  nxt_thread_cpu_set_saved;
+
+#endif
+
+
+/*
+ * Saves the CPU affinity the process has been started with, e.g. by taskset
+ * or a cgroup, to restore it later when a thread is unbound.  It is called
+ * once before any thread is bound.
+ */
+
+nxt_int_t
+nxt_thread_cpu_affinity_save(nxt_task_t *task)
+{
+#if (NXT_HAVE_SCHED_SETAFFINITY)
+
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &nxt_thread_cpu_set) != 0) {
+        nxt_alert(task, "sched_getaffinity() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_thread_cpu_set_saved = 1;
+
+#endif
+
+    return NXT_OK;
+}
+
+
+/*
+ * Binds the current thread to the CPU, a negative CPU number
+ * restores the saved affinity.
+ */
+
+nxt_int_t
+nxt_thread_cpu_affinity(nxt_task_t *task, nxt_int_t cpu)
+{
+#if (NXT_HAVE_SCHED_SETAFFINITY)
+
+    cpu_set_t  set;
+
+    if (cpu >= CPU_SETSIZE) {
+        nxt_alert(task, "CPU %i exceeds CPU_SETSIZE", cpu);
+        return NXT_ERROR;
+    }
+
+    if (cpu >= 0) {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+    } else if (nxt_thread_cpu_set_saved) {
+        set = nxt_thread_cpu_set;
+
+    } else {
+        return NXT_OK;
+    }
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0) {
+        nxt_alert(task, "sched_setaffinity(%i) failed %E", cpu, nxt_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_debug(task, "thread CPU affinity: %i", cpu);
+
+    return NXT_OK;
+
+#else
+
+    if (cpu >= 0) {
+        nxt_log(task, NXT_LOG_WARN, "CPU affinity is not supported");
+    }
+
+    return NXT_OK;
+
+#endif
+}
+
+
+#if (NXT_HAVE_SET_MEMPOLICY)
+
+/* <linux/mempolicy.h> and <numaif.h> may be unavailable. */
+
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT  0
+#endif
+
+#ifndef MPOL_LOCAL
+#define MPOL_LOCAL    4
+#endif
+
+#endif
+
+
+/*
+ * Makes the kernel allocate the thread's new pages on the NUMA node
+ * the thread runs on regardless of the process memory policy.
+ */
+
+nxt_int_t
+nxt_thread_memory_local(nxt_task_t *task, nxt_bool_t local)
+{
+#if (NXT_HAVE_SET_MEMPOLICY)
+
+    int  mode;
+
+    mode = local ? MPOL_LOCAL : MPOL_DEFAULT;
+
+    if (syscall(SYS_set_mempolicy, mode, NULL, 0) != 0) {
+        nxt_alert(task, "set_mempolicy(%d) failed %E", mode, nxt_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_debug(task, "thread memory policy: %d", mode);
+
+    return NXT_OK;
+
+#else
+
+    if (local) {
+        nxt_log(task, NXT_LOG_WARN, "NUMA memory policy is not supported");
+    }
+
+    return NXT_OK;
+
+#endif
+}
+
+
 nxt_tid_t
 nxt_thread_tid(nxt_thread_t *thr)
 {
@@ -99,6 +99,10 @@ NXT_EXPORT nxt_thread_t *nxt_thread_init(void);
 NXT_EXPORT void nxt_thread_exit(nxt_thread_t *thr);
 NXT_EXPORT void nxt_thread_cancel(nxt_thread_handle_t handle);
 NXT_EXPORT void nxt_thread_wait(nxt_thread_handle_t handle);
+NXT_EXPORT nxt_int_t nxt_thread_cpu_affinity_save(nxt_task_t *task);
+NXT_EXPORT nxt_int_t nxt_thread_cpu_affinity(nxt_task_t *task, nxt_int_t cpu);
+NXT_EXPORT nxt_int_t nxt_thread_memory_local(nxt_task_t *task,
+    nxt_bool_t local);
 
 
 #define                                                                       \
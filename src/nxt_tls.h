@@ -25,6 +25,53 @@
 
 #define NXT_TLS_BUFFER_SIZE       4096
 
+/*
+ * A connection starts with NXT_TLS_BUFFER_SIZE records and switches to
+ * the maximum record size after NXT_TLS_RECORD_WARMUP bytes have been
+ * sent.  It returns to the small records after NXT_TLS_RECORD_IDLE
+ * milliseconds of inactivity.
+ */
+
+#define NXT_TLS_RECORD_SIZE       (16 * 1024)
+#define NXT_TLS_RECORD_WARMUP     (1024 * 1024)
+#define NXT_TLS_RECORD_IDLE       1000
+
+
+/*
+ * The session cache is an anonymous shared memory created by the main
+ * process and inherited by the router, so the sessions survive both
+ * reconfiguration and router restarts.  The cache is split into shards
+ * with separate locks, each shard is a set-associative hash of fixed
+ * size slots.  Sessions that do not fit into a slot are not cached.
+ */
+
+#define NXT_TLS_SESSION_SHARDS    32
+#define NXT_TLS_SESSION_BUCKETS   128
+#define NXT_TLS_SESSION_WAYS      4
+#define NXT_TLS_SESSION_ID_SIZE   32
+#define NXT_TLS_SESSION_SIZE      464
+
+
+typedef struct {
+    nxt_time_t                    expire;
+    uint16_t                      size;
+    uint8_t                       id_length;
+    u_char                        id[NXT_TLS_SESSION_ID_SIZE];
+    u_char                        data[NXT_TLS_SESSION_SIZE];
+} nxt_tls_session_t;
+
+
+typedef struct {
+    nxt_thread_spinlock_t         lock;
+    nxt_tls_session_t             sessions[NXT_TLS_SESSION_BUCKETS
+                                           * NXT_TLS_SESSION_WAYS];
+} nxt_tls_session_shard_t;
+
+
+typedef struct {
+    nxt_tls_session_shard_t       shards[NXT_TLS_SESSION_SHARDS];
+} nxt_tls_sessions_t;
+
 
 typedef struct nxt_tls_conf_s         nxt_tls_conf_t;
 typedef struct nxt_tls_bundle_conf_s  nxt_tls_bundle_conf_t;
@@ -41,6 +88,9 @@ typedef struct {
                                       nxt_bool_t last);
     void                          (*server_free)(nxt_task_t *task,
                                       nxt_tls_conf_t *conf);
+
+    void                          (*ocsp_update)(nxt_task_t *task,
+                                      nxt_str_t *name, nxt_fd_t fd);
 } nxt_tls_lib_t;
 
 
@@ -55,6 +105,7 @@ struct nxt_tls_bundle_conf_s {
     void                          *ctx;
 
     nxt_fd_t                      chain_file;
+    nxt_fd_t                      ocsp_file;
     nxt_str_t                     name;
 
     nxt_tls_bundle_conf_t         *next;
@@ -87,6 +138,10 @@ struct nxt_tls_init_s {
     nxt_time_t                    timeout;
     nxt_conf_value_t              *conf_cmds;
     nxt_conf_value_t              *tickets_conf;
+    nxt_str_t                     name;
+    uint8_t                       http2;  /* 1 bit */
+    uint8_t                       ktls;   /* 1 bit */
+    uint8_t                       ocsp_stapling;  /* 1 bit */
 
     nxt_tls_conf_t                *conf;
 };
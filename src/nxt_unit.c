@@ -89,10 +89,16 @@ static nxt_unit_read_buf_t *nxt_unit_read_buf_get_impl(
     nxt_unit_ctx_impl_t *ctx_impl);
 static void nxt_unit_read_buf_release(nxt_unit_ctx_t *ctx,
     nxt_unit_read_buf_t *rbuf);
+static int nxt_unit_response_send_file(nxt_unit_request_info_t *req, int fd,
+    off_t offset, size_t size);
+static ssize_t nxt_unit_response_file_read(nxt_unit_read_info_t *read_info,
+    void *dst, size_t size);
 static nxt_unit_mmap_buf_t *nxt_unit_request_preread(
     nxt_unit_request_info_t *req, size_t size);
 static ssize_t nxt_unit_buf_read(nxt_unit_buf_t **b, uint64_t *len, void *dst,
     size_t size);
+static ssize_t nxt_unit_content_fd_read(nxt_unit_request_info_t *req,
+    void *dst, size_t size);
 static nxt_port_mmap_header_t *nxt_unit_mmap_get(nxt_unit_ctx_t *ctx,
     nxt_unit_port_t *port, nxt_chunk_id_t *c, int *n, int min_n);
 static int nxt_unit_send_oosm(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port);
@@ -195,6 +201,13 @@ static void nxt_unit_lvlhsh_free(void *data, void *p);
 static int nxt_unit_memcasecmp(const void *p1, const void *p2, size_t length);
 
 
+typedef struct {
+    int                      fd;
+    off_t                    offset;
+    size_t                   rest;
+} nxt_unit_read_file_t;
+
+
 struct nxt_unit_mmap_buf_s {
     nxt_unit_buf_t           buf;
 
@@ -3014,6 +3027,142 @@ nxt_unit_response_write_cb(nxt_unit_request_info_t *req,
 }
 
 
+int
+nxt_unit_response_sendfile(nxt_unit_request_info_t *req, int fd, off_t offset,
+    size_t size)
+{
+    int                           rc;
+    nxt_unit_read_file_t          file;
+    nxt_unit_read_info_t          read_info;
+    nxt_unit_request_info_impl_t  *req_impl;
+
+    nxt_unit_req_debug(req, "sendfile: fd %d, offset %"PRIu64", size %d",
+                       fd, (uint64_t) offset, (int) size);
+
+    req_impl = nxt_container_of(req, nxt_unit_request_info_impl_t, req);
+
+    if (nxt_slow_path(req_impl->state < NXT_UNIT_RS_RESPONSE_INIT)) {
+        nxt_unit_req_alert(req, "sendfile: response not initialized yet");
+
+        return NXT_UNIT_ERROR;
+    }
+
+    if (nxt_slow_path(size == 0)) {
+        return NXT_UNIT_OK;
+    }
+
+    /*
+     * A TLS connection cannot send the file directly unless kTLS is used,
+     * so the content is copied to the shared memory as with
+     * nxt_unit_response_write().
+     */
+    if (req->request->tls && !req->request->ktls) {
+        file.fd = fd;
+        file.offset = offset;
+        file.rest = size;
+
+        read_info.read = nxt_unit_response_file_read;
+        read_info.eof = 0;
+        read_info.buf_size = nxt_min(size, PORT_MMAP_DATA_SIZE);
+        read_info.data = &file;
+
+        return nxt_unit_response_write_cb(req, &read_info);
+    }
+
+    /* Check if response is not send yet. */
+    if (nxt_slow_path(req->response_buf != NULL)) {
+        rc = nxt_unit_response_send(req);
+        if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+            return rc;
+        }
+    }
+
+    return nxt_unit_response_send_file(req, fd, offset, size);
+}
+
+
+static int
+nxt_unit_response_send_file(nxt_unit_request_info_t *req, int fd,
+    off_t offset, size_t size)
+{
+    ssize_t                       res;
+    nxt_unit_impl_t               *lib;
+    nxt_unit_request_info_impl_t  *req_impl;
+    struct {
+        nxt_port_msg_t            msg;
+        nxt_unit_response_file_t  file;
+    } m;
+    union {
+        struct cmsghdr  cm;
+        char            space[CMSG_SPACE(sizeof(int))];
+    } cmsg;
+
+    lib = nxt_container_of(req->unit, nxt_unit_impl_t, unit);
+    req_impl = nxt_container_of(req, nxt_unit_request_info_impl_t, req);
+
+    m.msg.stream = req_impl->stream;
+    m.msg.pid = lib->pid;
+    m.msg.reply_port = 0;
+    m.msg.type = _NXT_PORT_MSG_DATA;
+    m.msg.last = 0;
+    m.msg.mmap = 0;
+    m.msg.nf = 0;
+    m.msg.mf = 0;
+    m.msg.tracking = 0;
+
+    m.file.offset = offset;
+    m.file.size = size;
+
+    /* Fill all padding fields with 0, see nxt_unit_send_mmap(). */
+    memset(&cmsg, 0, sizeof(cmsg));
+
+    cmsg.cm.cmsg_len = CMSG_LEN(sizeof(int));
+    cmsg.cm.cmsg_level = SOL_SOCKET;
+    cmsg.cm.cmsg_type = SCM_RIGHTS;
+
+    memcpy(CMSG_DATA(&cmsg.cm), &fd, sizeof(int));
+
+    res = nxt_unit_port_send(req->ctx, req->response_port, &m, sizeof(m),
+                             &cmsg, sizeof(cmsg));
+    if (nxt_slow_path(res != sizeof(m))) {
+        nxt_unit_req_error(req, "Failed to send file");
+
+        return NXT_UNIT_ERROR;
+    }
+
+    return NXT_UNIT_OK;
+}
+
+
+static ssize_t
+nxt_unit_response_file_read(nxt_unit_read_info_t *read_info, void *dst,
+    size_t size)
+{
+    ssize_t               res;
+    nxt_unit_read_file_t  *file;
+
+    file = read_info->data;
+
+    size = nxt_min(size, file->rest);
+
+    do {
+        res = pread(file->fd, dst, size, file->offset);
+    } while (res < 0 && errno == EINTR);
+
+    if (nxt_slow_path(res <= 0)) {
+        /* A read error or the file was truncated. */
+        return -1;
+    }
+
+    file->offset += res;
+    file->rest -= res;
+
+    read_info->eof = (file->rest == 0);
+
+    return res;
+}
+
+
 ssize_t
 nxt_unit_request_read(nxt_unit_request_info_t *req, void *dst, size_t size)
 {
@@ -3023,25 +3172,22 @@ nxt_unit_request_read(nxt_unit_request_info_t *req, void *dst, size_t size)
                                 dst, size);
 
     if (buf_res < (ssize_t) size && req->content_fd != -1) {
-        res = read(req->content_fd, dst, size);
-        if (nxt_slow_path(res < 0)) {
-            nxt_unit_req_alert(req, "failed to read content: %s (%d)",
-                               strerror(errno), errno);
+        size = nxt_min(size - buf_res, req->content_length);
 
+        res = nxt_unit_content_fd_read(req, nxt_pointer_to(dst, buf_res),
+                                       size);
+        if (nxt_slow_path(res < 0)) {
             return res;
         }
 
-        if (res < (ssize_t) size) {
+        req->content_length -= res;
+
+        if (req->content_length == 0 && req->content_fd != -1) {
             nxt_unit_close(req->content_fd);
 
             req->content_fd = -1;
         }
 
-        req->content_length -= res;
-        size -= res;
-
-        dst = nxt_pointer_to(dst, res);
-
     } else {
         res = 0;
     }
@@ -3133,22 +3279,15 @@ nxt_unit_request_preread(nxt_unit_request_info_t *req, size_t size)
     mmap_buf->buf.free = mmap_buf->buf.start;
     mmap_buf->buf.end = mmap_buf->buf.start + size;
 
-    res = read(req->content_fd, mmap_buf->free_ptr, size);
-    if (res < 0) {
-        nxt_unit_req_alert(req, "failed to read content: %s (%d)",
-                           strerror(errno), errno);
+    size = nxt_min(size, req->content_length);
 
+    res = nxt_unit_content_fd_read(req, mmap_buf->free_ptr, size);
+    if (res < 0) {
         nxt_unit_mmap_buf_free(mmap_buf);
 
         return NULL;
     }
 
-    if (res < (ssize_t) size) {
-        nxt_unit_close(req->content_fd);
-
-        req->content_fd = -1;
-    }
-
     nxt_unit_req_debug(req, "preread: read %d", (int) res);
 
     mmap_buf->buf.end = mmap_buf->buf.free + res;
@@ -3157,6 +3296,48 @@ nxt_unit_request_preread(nxt_unit_request_info_t *req, size_t size)
 }
 
 
+/*
+ * The body descriptor is either a temporary file or a socket the router
+ * streams the body to, so a short read does not mean the end of the body.
+ */
+
+static ssize_t
+nxt_unit_content_fd_read(nxt_unit_request_info_t *req, void *dst, size_t size)
+{
+    size_t   n;
+    ssize_t  res;
+
+    n = 0;
+
+    while (n < size) {
+        res = read(req->content_fd, nxt_pointer_to(dst, n), size - n);
+
+        if (nxt_slow_path(res < 0)) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            nxt_unit_req_alert(req, "failed to read content: %s (%d)",
+                               strerror(errno), errno);
+
+            return res;
+        }
+
+        if (res == 0) {
+            nxt_unit_close(req->content_fd);
+
+            req->content_fd = -1;
+
+            break;
+        }
+
+        n += res;
+    }
+
+    return n;
+}
+
+
 static ssize_t
 nxt_unit_buf_read(nxt_unit_buf_t **b, uint64_t *len, void *dst, size_t size)
 {
@@ -308,6 +308,14 @@ ssize_t nxt_unit_response_write_nb(nxt_unit_request_info_t *req,
 int nxt_unit_response_write_cb(nxt_unit_request_info_t *req,
     nxt_unit_read_info_t *read_info);
 
+/*
+ * Send the file range as a part of the response body.  The file descriptor
+ * is passed to Unit server which sends the content directly to the client,
+ * so the descriptor may be closed right after the call.
+ */
+int nxt_unit_response_sendfile(nxt_unit_request_info_t *req, int fd,
+    off_t offset, size_t size);
+
 ssize_t nxt_unit_request_read(nxt_unit_request_info_t *req, void *dst,
     size_t size);
 
@@ -22,6 +22,7 @@ struct nxt_unit_request_s {
     uint8_t               tls;
     uint8_t               websocket_handshake;
     uint8_t               app_target;
+    uint8_t               ktls;
     uint32_t              server_name_length;
     uint32_t              target_length;
     uint32_t              path_length;
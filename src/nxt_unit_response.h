@@ -24,4 +24,10 @@ struct nxt_unit_response_s {
 };
 
 
+typedef struct {
+    uint64_t              offset;
+    uint64_t              size;
+} nxt_unit_response_file_t;
+
+
 #endif /* _NXT_UNIT_RESPONSE_H_INCLUDED_ */
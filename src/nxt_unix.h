@@ -246,6 +246,10 @@
 #include <linux/openat2.h>
 #endif
 
+#if (NXT_HAVE_REUSEPORT_CBPF)
+#include <linux/filter.h>           /* SO_ATTACH_REUSEPORT_CBPF. */
+#endif
+
 #if (NXT_TEST_BUILD)
 #include <nxt_test_build.h>
 #endif
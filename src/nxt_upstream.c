@@ -21,11 +21,14 @@ nxt_upstreams_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     uint32_t          i, n, next;
     nxt_mp_t          *mp;
     nxt_int_t         ret;
-    nxt_str_t         name, *string;
+    nxt_str_t         name, balance, *string;
     nxt_upstreams_t   *upstreams;
-    nxt_conf_value_t  *upstreams_conf, *upcf;
+    nxt_conf_value_t  *upstreams_conf, *upcf, *value;
 
     static nxt_str_t  upstreams_name = nxt_string("upstreams");
+    static nxt_str_t  balance_name = nxt_string("balance");
+    static nxt_str_t  retries_name = nxt_string("retries");
+    static nxt_str_t  retry_timeout_name = nxt_string("retry_timeout");
 
     upstreams_conf = nxt_conf_get_object_member(conf, &upstreams_name, NULL);
 
@@ -58,8 +61,47 @@ nxt_upstreams_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             return NXT_ERROR;
         }
 
-        ret = nxt_upstream_round_robin_create(task, tmcf, upcf,
-                                              &upstreams->upstream[i]);
+        value = nxt_conf_get_object_member(upcf, &balance_name, NULL);
+
+        if (value != NULL) {
+            nxt_conf_get_string(value, &balance);
+
+        } else {
+            nxt_str_null(&balance);
+        }
+
+        value = nxt_conf_get_object_member(upcf, &retries_name, NULL);
+
+        if (value != NULL) {
+            upstreams->upstream[i].retries = nxt_conf_get_number(value);
+        }
+
+        value = nxt_conf_get_object_member(upcf, &retry_timeout_name, NULL);
+
+        if (value != NULL) {
+            upstreams->upstream[i].retry_timeout = nxt_conf_get_number(value)
+                                                   * 1000;
+        }
+
+        ret = nxt_upstream_health_check_create(tmcf, upcf,
+                                               &upstreams->upstream[i]);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        if (nxt_str_eq(&balance, "least_conn", 10)) {
+            ret = nxt_upstream_least_conn_create(task, tmcf, upcf,
+                                                 &upstreams->upstream[i]);
+
+        } else if (nxt_str_eq(&balance, "hash", 4)) {
+            ret = nxt_upstream_hash_create(task, tmcf, upcf,
+                                           &upstreams->upstream[i]);
+
+        } else {
+            ret = nxt_upstream_round_robin_create(task, tmcf, upcf,
+                                                  &upstreams->upstream[i]);
+        }
+
         if (nxt_slow_path(ret != NXT_OK)) {
             return NXT_ERROR;
         }
@@ -12,6 +12,12 @@ typedef struct nxt_upstream_proxy_s            nxt_upstream_proxy_t;
 typedef struct nxt_upstream_round_robin_s      nxt_upstream_round_robin_t;
 typedef struct nxt_upstream_round_robin_server_s
     nxt_upstream_round_robin_server_t;
+typedef struct nxt_upstream_least_conn_s       nxt_upstream_least_conn_t;
+typedef struct nxt_upstream_least_conn_server_s
+    nxt_upstream_least_conn_server_t;
+typedef struct nxt_upstream_hash_s             nxt_upstream_hash_t;
+typedef struct nxt_upstream_hash_server_s      nxt_upstream_hash_server_t;
+typedef struct nxt_upstream_health_check_s     nxt_upstream_health_check_t;
 
 
 typedef void (*nxt_upstream_peer_ready_t)(nxt_task_t *task,
@@ -26,24 +32,53 @@ typedef struct {
 } nxt_upstream_peer_state_t;
 
 
+/*
+ * The server health is shared by all router threads.  A server is
+ * unavailable if active health checks have found it unhealthy or if
+ * "max_fails" requests have failed within the last "fail_timeout".
+ * If all servers are unavailable, the balancers try them anyway.
+ */
+
+typedef struct {
+    nxt_atomic_t                               fails;
+    /* The engine time of the last failure. */
+    nxt_atomic_t                               failed;
+    nxt_atomic_t                               down;
+
+    uint32_t                                   max_fails;
+    nxt_msec_t                                 fail_timeout;
+} nxt_upstream_health_t;
+
+
 typedef nxt_upstream_t *(*nxt_upstream_joint_create_t)(
     nxt_router_temp_conf_t *tmcf, nxt_upstream_t *upstream);
 typedef void (*nxt_upstream_server_get_t)(nxt_task_t *task,
     nxt_upstream_server_t *us);
+typedef void (*nxt_upstream_server_free_t)(nxt_task_t *task,
+    nxt_upstream_server_t *us);
 
 
 typedef struct {
     nxt_upstream_joint_create_t                joint_create;
     nxt_upstream_server_get_t                  get;
+    /* An optional handler called when a request to the server is done. */
+    nxt_upstream_server_free_t                 free;
 } nxt_upstream_server_proto_t;
 
 
 struct nxt_upstream_s {
     const nxt_upstream_server_proto_t          *proto;
+    nxt_upstream_health_check_t                *health_check;
+
+    /* Attempts to pass a failed request to the next server. */
+    uint32_t                                   retries;
+    nxt_msec_t                                 retry_timeout;
 
     union {
         nxt_upstream_proxy_t                   *proxy;
         nxt_upstream_round_robin_t             *round_robin;
+        nxt_upstream_least_conn_t              *least_conn;
+        nxt_upstream_hash_t                    *hash;
     } type;
 
     nxt_str_t                                  name;
@@ -60,11 +95,19 @@ struct nxt_upstream_server_s {
     nxt_sockaddr_t                             *sockaddr;
     const nxt_upstream_peer_state_t            *state;
     nxt_upstream_t                             *upstream;
+    nxt_upstream_health_t                      *health;
+
+    /* The servers already tried, only the first 64 ones are tracked. */
+    uint64_t                                   tried;
+    uint32_t                                   tries;
+    nxt_msec_t                                 start;
 
     uint8_t                                    protocol;
 
     union {
         nxt_upstream_round_robin_server_t      *round_robin;
+        nxt_upstream_least_conn_server_t       *least_conn;
+        nxt_upstream_hash_server_t             *hash;
     } server;
 
     union {
@@ -73,9 +116,60 @@ struct nxt_upstream_server_s {
 };
 
 
+nxt_int_t nxt_upstream_health_check_create(nxt_router_temp_conf_t *tmcf,
+    nxt_conf_value_t *upstream_conf, nxt_upstream_t *upstream);
+nxt_upstream_health_t *nxt_upstream_health_create(nxt_router_temp_conf_t *tmcf,
+    nxt_conf_value_t *server_conf, nxt_upstream_t *upstream,
+    nxt_sockaddr_t *sa);
+void nxt_upstream_health_failed(nxt_task_t *task, nxt_upstream_server_t *us);
+
+
+nxt_inline nxt_bool_t
+nxt_upstream_server_tried(nxt_upstream_server_t *us, uint32_t n)
+{
+    return n < 64 && (us->tried & ((uint64_t) 1 << n)) != 0;
+}
+
+
+nxt_inline void
+nxt_upstream_server_try(nxt_upstream_server_t *us, uint32_t n)
+{
+    if (n < 64) {
+        us->tried |= (uint64_t) 1 << n;
+    }
+}
+
+
+nxt_inline nxt_bool_t
+nxt_upstream_health_available(nxt_event_engine_t *engine,
+    nxt_upstream_health_t *health)
+{
+    return !health->down
+           && (health->max_fails == 0
+               || health->fails < health->max_fails
+               || nxt_msec_diff(engine->timers.now, health->failed)
+                  >= (nxt_msec_int_t) health->fail_timeout);
+}
+
+
+nxt_inline void
+nxt_upstream_health_passed(nxt_upstream_server_t *us)
+{
+    if (us->health != NULL && us->health->fails != 0) {
+        us->health->fails = 0;
+    }
+}
+
+
 nxt_int_t nxt_upstream_round_robin_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *upstream_conf,
     nxt_upstream_t *upstream);
+nxt_int_t nxt_upstream_least_conn_create(nxt_task_t *task,
+    nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *upstream_conf,
+    nxt_upstream_t *upstream);
+nxt_int_t nxt_upstream_hash_create(nxt_task_t *task,
+    nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *upstream_conf,
+    nxt_upstream_t *upstream);
 
 
 #endif /* _NXT_UPSTREAM_H_INCLUDED_ */
@@ -0,0 +1,341 @@
+
+/*
+ * Copyright (C) Igor Sysoev
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_upstream.h>
+
+
+/*
+ * Consistent hashing: every server owns a number of points on the hash ring
+ * proportional to its weight and a request is passed to the server owning
+ * the first point that follows the key hash.  Adding or removing a server
+ * remaps only the keys of the neighbouring points.
+ */
+
+#define NXT_UPSTREAM_HASH_POINTS  160
+
+
+struct nxt_upstream_hash_server_s {
+    nxt_sockaddr_t              *sockaddr;
+    nxt_upstream_health_t       *health;
+    uint8_t                     protocol;
+};
+
+
+typedef struct {
+    uint32_t                    hash;
+    uint32_t                    server;
+} nxt_upstream_hash_point_t;
+
+
+struct nxt_upstream_hash_s {
+    nxt_var_t                   *key;
+
+    uint32_t                    points;
+    nxt_upstream_hash_point_t   *point;
+
+    uint32_t                    items;
+    nxt_upstream_hash_server_t  server[0];
+};
+
+
+static int nxt_upstream_hash_point_compare(const void *one, const void *two);
+static nxt_upstream_t *nxt_upstream_hash_joint_create(
+    nxt_router_temp_conf_t *tmcf, nxt_upstream_t *upstream);
+static void nxt_upstream_hash_server_get(nxt_task_t *task,
+    nxt_upstream_server_t *us);
+static void nxt_upstream_hash_key_ready(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_hash_key_error(nxt_task_t *task, void *obj,
+    void *data);
+
+
+static const nxt_upstream_server_proto_t  nxt_upstream_hash_proto = {
+    .joint_create = nxt_upstream_hash_joint_create,
+    .get          = nxt_upstream_hash_server_get,
+};
+
+
+nxt_int_t
+nxt_upstream_hash_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_conf_value_t *upstream_conf, nxt_upstream_t *upstream)
+{
+    double                     total, w;
+    size_t                     size;
+    uint32_t                   i, j, n, next, points, hash, data[2];
+    nxt_mp_t                   *mp;
+    nxt_str_t                  name, key;
+    nxt_sockaddr_t             *sa;
+    nxt_conf_value_t           *servers_conf, *srvcf, *wtcf, *value;
+    nxt_upstream_hash_t        *uh;
+    nxt_upstream_hash_point_t  *point;
+
+    static nxt_str_t  servers = nxt_string("servers");
+    static nxt_str_t  weight = nxt_string("weight");
+    static nxt_str_t  key_name = nxt_string("key");
+
+    mp = tmcf->router_conf->mem_pool;
+
+    servers_conf = nxt_conf_get_object_member(upstream_conf, &servers, NULL);
+    n = nxt_conf_object_members_count(servers_conf);
+
+    size = sizeof(nxt_upstream_hash_t) + n * sizeof(nxt_upstream_hash_server_t);
+
+    uh = nxt_mp_zalloc(mp, size);
+    if (nxt_slow_path(uh == NULL)) {
+        return NXT_ERROR;
+    }
+
+    value = nxt_conf_get_object_member(upstream_conf, &key_name, NULL);
+    nxt_conf_get_string(value, &key);
+
+    uh->key = nxt_var_compile(&key, mp);
+    if (nxt_slow_path(uh->key == NULL)) {
+        return NXT_ERROR;
+    }
+
+    total = 0.0;
+    next = 0;
+
+    for (i = 0; i < n; i++) {
+        srvcf = nxt_conf_next_object_member(servers_conf, &name, &next);
+        wtcf = nxt_conf_get_object_member(srvcf, &weight, NULL);
+        total += (wtcf != NULL) ? nxt_conf_get_number(wtcf) : 1;
+    }
+
+    /*
+     * The ring has about NXT_UPSTREAM_HASH_POINTS points per server
+     * regardless of the absolute weight values.
+     */
+
+    point = nxt_mp_alloc(mp, (NXT_UPSTREAM_HASH_POINTS * n + n)
+                             * sizeof(nxt_upstream_hash_point_t));
+    if (nxt_slow_path(point == NULL)) {
+        return NXT_ERROR;
+    }
+
+    uh->point = point;
+    uh->items = n;
+    next = 0;
+
+    for (i = 0; i < n; i++) {
+        srvcf = nxt_conf_next_object_member(servers_conf, &name, &next);
+
+        sa = nxt_sockaddr_parse(mp, &name);
+        if (nxt_slow_path(sa == NULL)) {
+            return NXT_ERROR;
+        }
+
+        sa->type = SOCK_STREAM;
+
+        uh->server[i].sockaddr = sa;
+        uh->server[i].protocol = NXT_HTTP_PROTO_H1;
+
+        uh->server[i].health = nxt_upstream_health_create(tmcf, srvcf,
+                                                          upstream, sa);
+        if (nxt_slow_path(uh->server[i].health == NULL)) {
+            return NXT_ERROR;
+        }
+
+        wtcf = nxt_conf_get_object_member(srvcf, &weight, NULL);
+        w = (wtcf != NULL) ? nxt_conf_get_number(wtcf) : 1;
+
+        if (w == 0) {
+            continue;
+        }
+
+        points = nxt_max(1, (uint32_t) (NXT_UPSTREAM_HASH_POINTS * n * w
+                                        / total + 0.5));
+
+        /* The points depend only on the server name as configured. */
+
+        data[0] = nxt_murmur_hash2(name.start, name.length);
+
+        for (j = 0; j < points; j++) {
+            data[1] = j;
+            hash = nxt_murmur_hash2(data, sizeof(data));
+
+            point[uh->points].hash = hash;
+            point[uh->points].server = i;
+            uh->points++;
+        }
+    }
+
+    nxt_qsort(uh->point, uh->points, sizeof(nxt_upstream_hash_point_t),
+              nxt_upstream_hash_point_compare);
+
+    upstream->proto = &nxt_upstream_hash_proto;
+    upstream->type.hash = uh;
+
+    return NXT_OK;
+}
+
+
+static int
+nxt_upstream_hash_point_compare(const void *one, const void *two)
+{
+    const nxt_upstream_hash_point_t  *first, *second;
+
+    first = one;
+    second = two;
+
+    if (first->hash != second->hash) {
+        return (first->hash < second->hash) ? -1 : 1;
+    }
+
+    return (int) first->server - (int) second->server;
+}
+
+
+static nxt_upstream_t *
+nxt_upstream_hash_joint_create(nxt_router_temp_conf_t *tmcf,
+    nxt_upstream_t *upstream)
+{
+    /* The ring is not modified, so it is shared by all router threads. */
+
+    return upstream;
+}
+
+
+static void
+nxt_upstream_hash_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
+{
+    nxt_int_t           ret;
+    nxt_str_t           *key;
+    nxt_http_request_t  *r;
+
+    r = us->peer.http->request;
+
+    key = nxt_mp_get(r->mem_pool, sizeof(nxt_str_t));
+    if (nxt_slow_path(key == NULL)) {
+        us->state->error(task, us);
+        return;
+    }
+
+    ret = nxt_var_query_init(&r->var_query, r, r->mem_pool);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        us->state->error(task, us);
+        return;
+    }
+
+    nxt_var_query(task, r->var_query, us->upstream->type.hash->key, key);
+    nxt_var_query_resolve(task, r->var_query, key,
+                          nxt_upstream_hash_key_ready,
+                          nxt_upstream_hash_key_error);
+}
+
+
+static void
+nxt_upstream_hash_key_ready(nxt_task_t *task, void *obj, void *data)
+{
+    uint32_t                    i, hash, first, start, end, middle;
+    nxt_str_t                   *key;
+    nxt_bool_t                  all;
+    nxt_event_engine_t          *engine;
+    nxt_http_request_t          *r;
+    nxt_upstream_hash_t         *uh;
+    nxt_upstream_server_t       *us;
+    nxt_upstream_hash_point_t   *point;
+    nxt_upstream_hash_server_t  *s;
+
+    r = obj;
+    key = data;
+
+    us = r->peer->server;
+    uh = us->upstream->type.hash;
+
+    if (nxt_slow_path(uh->points == 0)) {
+        us->state->error(task, us);
+        return;
+    }
+
+    hash = nxt_murmur_hash2(key->start, key->length);
+
+    /* The first point that is not less than the hash. */
+
+    point = uh->point;
+    start = 0;
+    end = uh->points;
+
+    while (start < end) {
+        middle = start + (end - start) / 2;
+
+        if (point[middle].hash < hash) {
+            start = middle + 1;
+
+        } else {
+            end = middle;
+        }
+    }
+
+    /*
+     * Unavailable and already tried servers are skipped
+     * to the next points of the ring.
+     */
+
+    engine = task->thread->engine;
+
+    first = start;
+    all = 0;
+
+again:
+
+    for (i = 0; i < uh->points; i++) {
+        if (start == uh->points) {
+            start = 0;
+        }
+
+        s = &uh->server[point[start].server];
+
+        if (!nxt_upstream_server_tried(us, point[start].server)
+            && (all || nxt_upstream_health_available(engine, s->health)))
+        {
+            break;
+        }
+
+        start++;
+    }
+
+    if (i == uh->points) {
+
+        if (!all) {
+            /* All servers are unavailable, so they are tried anyway. */
+            all = 1;
+            start = first;
+            goto again;
+        }
+
+        us->state->error(task, us);
+        return;
+    }
+
+    nxt_upstream_server_try(us, point[start].server);
+
+    nxt_debug(task, "upstream hash: \"%V\" %08xD, server: %*s",
+              key, hash, (size_t) s->sockaddr->length,
+              nxt_sockaddr_start(s->sockaddr));
+
+    us->sockaddr = s->sockaddr;
+    us->protocol = s->protocol;
+    us->server.hash = s;
+    us->health = s->health;
+
+    us->state->ready(task, us);
+}
+
+
+static void
+nxt_upstream_hash_key_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_request_t     *r;
+    nxt_upstream_server_t  *us;
+
+    r = obj;
+    us = r->peer->server;
+
+    us->state->error(task, us);
+}
@@ -0,0 +1,778 @@
+
+
+/*
+ * Copyright (C) Igor Sysoev
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_upstream.h>
+
+
+typedef struct {
+    nxt_sockaddr_t                   *sockaddr;
+    nxt_upstream_health_t            *health;
+} nxt_upstream_health_server_t;
+
+
+struct nxt_upstream_health_check_s {
+    nxt_str_t                        *name;
+    nxt_str_t                        uri;
+    nxt_msec_t                       interval;
+    nxt_msec_t                       timeout;
+    uint32_t                         fails;
+    uint32_t                         passes;
+
+    /* An array of nxt_upstream_health_server_t. */
+    nxt_array_t                      *servers;
+};
+
+
+typedef struct nxt_upstream_health_probe_s   nxt_upstream_health_probe_t;
+
+
+typedef struct {
+    nxt_timer_t                      timer;
+
+    nxt_upstream_health_check_t      *check;
+    nxt_upstream_health_server_t     *server;
+    nxt_upstream_health_probe_t      *probe;
+
+    uint32_t                         fails;
+    uint32_t                         passes;
+} nxt_upstream_health_target_t;
+
+
+/*
+ * The checker and its targets refer to the router configuration, they run
+ * in the router main thread and are replaced on each configuration update
+ * before the previous configuration can be released.
+ */
+
+typedef struct {
+    nxt_mp_t                         *mem_pool;
+    nxt_timer_t                      timer;
+
+    nxt_uint_t                       items;
+    nxt_upstream_health_target_t     target[0];
+} nxt_upstream_health_checker_t;
+
+
+/*
+ * A probe is allocated from its connection memory pool, so it can
+ * outlive a stopped checker.
+ */
+
+struct nxt_upstream_health_probe_s {
+    nxt_conn_t                       *conn;
+    nxt_upstream_health_target_t     *target;
+    nxt_msec_t                       timeout;
+};
+
+
+typedef struct {
+    nxt_str_t                        uri;
+    nxt_msec_t                       interval;
+    nxt_msec_t                       timeout;
+    uint32_t                         fails;
+    uint32_t                         passes;
+} nxt_upstream_health_check_conf_t;
+
+
+typedef struct {
+    uint32_t                         max_fails;
+    nxt_msec_t                       fail_timeout;
+} nxt_upstream_health_conf_t;
+
+
+static void nxt_upstream_health_checker_free(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_start(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_connected(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_sent(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_read(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_closed(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_error(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_send_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_health_probe_read_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_msec_t nxt_upstream_health_probe_timer_value(nxt_conn_t *c,
+    uintptr_t data);
+static void nxt_upstream_health_probe_done(nxt_task_t *task,
+    nxt_upstream_health_probe_t *probe, nxt_bool_t passed);
+static void nxt_upstream_health_probe_free(nxt_task_t *task, void *obj,
+    void *data);
+
+
+static const nxt_conn_state_t  nxt_upstream_health_probe_connect_state;
+static const nxt_conn_state_t  nxt_upstream_health_probe_send_state;
+static const nxt_conn_state_t  nxt_upstream_health_probe_read_state;
+static const nxt_conn_state_t  nxt_upstream_health_probe_close_state;
+
+
+static nxt_upstream_health_checker_t  *nxt_upstream_health_checker;
+
+
+static nxt_conf_map_t  nxt_upstream_health_check_conf[] = {
+    {
+        nxt_string("uri"),
+        NXT_CONF_MAP_STR_COPY,
+        offsetof(nxt_upstream_health_check_conf_t, uri),
+    },
+
+    {
+        nxt_string("interval"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_upstream_health_check_conf_t, interval),
+    },
+
+    {
+        nxt_string("timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_upstream_health_check_conf_t, timeout),
+    },
+
+    {
+        nxt_string("fails"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_upstream_health_check_conf_t, fails),
+    },
+
+    {
+        nxt_string("passes"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_upstream_health_check_conf_t, passes),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_upstream_health_conf[] = {
+    {
+        nxt_string("max_fails"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_upstream_health_conf_t, max_fails),
+    },
+
+    {
+        nxt_string("fail_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_upstream_health_conf_t, fail_timeout),
+    },
+};
+
+
+nxt_int_t
+nxt_upstream_health_check_create(nxt_router_temp_conf_t *tmcf,
+    nxt_conf_value_t *upstream_conf, nxt_upstream_t *upstream)
+{
+    nxt_mp_t                          *mp;
+    nxt_int_t                         ret;
+    nxt_conf_value_t                  *value;
+    nxt_upstream_health_check_t       *check;
+    nxt_upstream_health_check_conf_t  hccf;
+
+    static nxt_str_t  health_check = nxt_string("health_check");
+
+    upstream->health_check = NULL;
+
+    value = nxt_conf_get_object_member(upstream_conf, &health_check, NULL);
+    if (value == NULL) {
+        return NXT_OK;
+    }
+
+    mp = tmcf->router_conf->mem_pool;
+
+    nxt_str_set(&hccf.uri, "/");
+    hccf.interval = 5000;
+    hccf.timeout = 5000;
+    hccf.fails = 1;
+    hccf.passes = 1;
+
+    ret = nxt_conf_map_object(mp, value, nxt_upstream_health_check_conf,
+                              nxt_nitems(nxt_upstream_health_check_conf),
+                              &hccf);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    check = nxt_mp_zalloc(mp, sizeof(nxt_upstream_health_check_t));
+    if (nxt_slow_path(check == NULL)) {
+        return NXT_ERROR;
+    }
+
+    check->servers = nxt_array_create(mp, 4,
+                                      sizeof(nxt_upstream_health_server_t));
+    if (nxt_slow_path(check->servers == NULL)) {
+        return NXT_ERROR;
+    }
+
+    check->name = &upstream->name;
+    check->uri = hccf.uri;
+    check->interval = hccf.interval;
+    check->timeout = hccf.timeout;
+    check->fails = hccf.fails;
+    check->passes = hccf.passes;
+
+    upstream->health_check = check;
+
+    return NXT_OK;
+}
+
+
+nxt_upstream_health_t *
+nxt_upstream_health_create(nxt_router_temp_conf_t *tmcf,
+    nxt_conf_value_t *server_conf, nxt_upstream_t *upstream,
+    nxt_sockaddr_t *sa)
+{
+    nxt_mp_t                      *mp;
+    nxt_int_t                     ret;
+    nxt_upstream_health_t         *health;
+    nxt_upstream_health_conf_t    hcf;
+    nxt_upstream_health_server_t  *server;
+
+    mp = tmcf->router_conf->mem_pool;
+
+    hcf.max_fails = 0;
+    hcf.fail_timeout = 10000;
+
+    ret = nxt_conf_map_object(mp, server_conf, nxt_upstream_health_conf,
+                              nxt_nitems(nxt_upstream_health_conf), &hcf);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NULL;
+    }
+
+    health = nxt_mp_zget(mp, sizeof(nxt_upstream_health_t));
+    if (nxt_slow_path(health == NULL)) {
+        return NULL;
+    }
+
+    health->max_fails = hcf.max_fails;
+    health->fail_timeout = hcf.fail_timeout;
+
+    if (upstream->health_check != NULL) {
+        server = nxt_array_add(upstream->health_check->servers);
+        if (nxt_slow_path(server == NULL)) {
+            return NULL;
+        }
+
+        server->sockaddr = sa;
+        server->health = health;
+    }
+
+    return health;
+}
+
+
+void
+nxt_upstream_health_failed(nxt_task_t *task, nxt_upstream_server_t *us)
+{
+    nxt_atomic_uint_t      fails;
+    nxt_upstream_health_t  *health;
+
+    health = us->health;
+
+    if (health == NULL || health->max_fails == 0) {
+        return;
+    }
+
+    health->failed = task->thread->engine->timers.now;
+
+    fails = nxt_atomic_fetch_add(&health->fails, 1) + 1;
+
+    if (fails == health->max_fails) {
+        nxt_log(task, NXT_LOG_WARN, "upstream server %*s is unavailable "
+                "for %M ms after %uD failures",
+                (size_t) us->sockaddr->length, nxt_sockaddr_start(us->sockaddr),
+                health->fail_timeout, health->max_fails);
+    }
+}
+
+
+void
+nxt_upstream_health_checks_start(nxt_task_t *task, nxt_upstreams_t *upstreams)
+{
+    size_t                         size;
+    uint32_t                       i, j, n;
+    nxt_mp_t                       *mp;
+    nxt_event_engine_t             *engine;
+    nxt_upstream_health_check_t    *check;
+    nxt_upstream_health_target_t   *target;
+    nxt_upstream_health_checker_t  *checker;
+
+    engine = task->thread->engine;
+    checker = nxt_upstream_health_checker;
+
+    if (checker != NULL) {
+        nxt_debug(task, "upstream health checks stop");
+
+        for (i = 0; i < checker->items; i++) {
+            target = &checker->target[i];
+
+            nxt_timer_delete(engine, &target->timer);
+
+            if (target->probe != NULL) {
+                target->probe->target = NULL;
+            }
+        }
+
+        /*
+         * The checker is freed by a timer since the deleted timers
+         * are still referenced by the engine until the changes are
+         * committed.
+         */
+        checker->timer.handler = nxt_upstream_health_checker_free;
+        checker->timer.task = &engine->task;
+        checker->timer.log = engine->task.log;
+        checker->timer.work_queue = &engine->fast_work_queue;
+
+        nxt_timer_add(engine, &checker->timer, 0);
+
+        nxt_upstream_health_checker = NULL;
+    }
+
+    if (upstreams == NULL) {
+        return;
+    }
+
+    n = 0;
+
+    for (i = 0; i < upstreams->items; i++) {
+        check = upstreams->upstream[i].health_check;
+
+        if (check != NULL) {
+            n += check->servers->nelts;
+        }
+    }
+
+    if (n == 0) {
+        return;
+    }
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return;
+    }
+
+    size = sizeof(nxt_upstream_health_checker_t)
+           + n * sizeof(nxt_upstream_health_target_t);
+
+    checker = nxt_mp_zget(mp, size);
+    if (nxt_slow_path(checker == NULL)) {
+        nxt_mp_destroy(mp);
+        return;
+    }
+
+    checker->mem_pool = mp;
+    checker->items = n;
+
+    n = 0;
+
+    for (i = 0; i < upstreams->items; i++) {
+        check = upstreams->upstream[i].health_check;
+
+        if (check == NULL) {
+            continue;
+        }
+
+        for (j = 0; j < check->servers->nelts; j++) {
+            target = &checker->target[n++];
+
+            target->check = check;
+            target->server = &((nxt_upstream_health_server_t *)
+                               check->servers->elts)[j];
+
+            target->timer.handler = nxt_upstream_health_probe_start;
+            target->timer.task = &engine->task;
+            target->timer.log = engine->task.log;
+            target->timer.work_queue = &engine->fast_work_queue;
+
+            nxt_timer_add(engine, &target->timer, 0);
+        }
+    }
+
+    nxt_debug(task, "upstream health checks start: %ui", checker->items);
+
+    nxt_upstream_health_checker = checker;
+}
+
+
+static void
+nxt_upstream_health_checker_free(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t                    *timer;
+    nxt_upstream_health_checker_t  *checker;
+
+    timer = obj;
+    checker = nxt_timer_data(timer, nxt_upstream_health_checker_t, timer);
+
+    nxt_debug(task, "upstream health checker free");
+
+    nxt_mp_destroy(checker->mem_pool);
+}
+
+
+static void
+nxt_upstream_health_probe_start(nxt_task_t *task, void *obj, void *data)
+{
+    u_char                        *p;
+    size_t                        size, length;
+    nxt_mp_t                      *mp;
+    nxt_buf_t                     *b;
+    nxt_conn_t                    *c;
+    nxt_timer_t                   *timer;
+    nxt_sockaddr_t                *sa, *src;
+    nxt_event_engine_t            *engine;
+    nxt_upstream_health_check_t   *check;
+    nxt_upstream_health_probe_t   *probe;
+    nxt_upstream_health_target_t  *target;
+
+    timer = obj;
+    target = nxt_timer_data(timer, nxt_upstream_health_target_t, timer);
+    check = target->check;
+
+    engine = task->thread->engine;
+
+    nxt_timer_add(engine, &target->timer, check->interval);
+
+    if (target->probe != NULL) {
+        /* The previous probe is still in progress. */
+        return;
+    }
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return;
+    }
+
+    c = nxt_conn_create(mp, task);
+    if (nxt_slow_path(c == NULL)) {
+        nxt_mp_destroy(mp);
+        return;
+    }
+
+    c->read_work_queue = &engine->fast_work_queue;
+    c->write_work_queue = &engine->fast_work_queue;
+
+    probe = nxt_mp_zget(mp, sizeof(nxt_upstream_health_probe_t));
+    if (nxt_slow_path(probe == NULL)) {
+        goto fail;
+    }
+
+    /* The copy includes the textual representation. */
+
+    src = target->server->sockaddr;
+    length = src->start + src->length;
+
+    sa = nxt_mp_alloc(mp, length);
+    if (nxt_slow_path(sa == NULL)) {
+        goto fail;
+    }
+
+    nxt_memcpy(sa, src, length);
+
+    size = nxt_length("GET  HTTP/1.1\r\nHost: \r\nConnection: close\r\n\r\n")
+           + check->uri.length + sa->length;
+
+    b = nxt_buf_mem_alloc(mp, size, 0);
+    if (nxt_slow_path(b == NULL)) {
+        goto fail;
+    }
+
+    p = b->mem.free;
+    p = nxt_cpymem(p, "GET ", 4);
+    p = nxt_cpymem(p, check->uri.start, check->uri.length);
+    p = nxt_cpymem(p, " HTTP/1.1\r\nHost: ", 17);
+    p = nxt_cpymem(p, nxt_sockaddr_start(sa), sa->length);
+    p = nxt_cpymem(p, "\r\nConnection: close\r\n\r\n", 23);
+    b->mem.free = p;
+
+    probe->conn = c;
+    probe->target = target;
+    probe->timeout = check->timeout;
+
+    target->probe = probe;
+
+    nxt_debug(task, "upstream health probe: %*s%V",
+              (size_t) sa->length, nxt_sockaddr_start(sa), &check->uri);
+
+    c->remote = sa;
+    c->write = b;
+    c->socket.data = probe;
+    c->socket.write_ready = 1;
+    c->write_state = &nxt_upstream_health_probe_connect_state;
+
+    nxt_conn_connect(engine, c);
+
+    return;
+
+fail:
+
+    nxt_conn_free(task, c);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_health_probe_connect_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_health_probe_connected,
+    .close_handler = nxt_upstream_health_probe_error,
+    .error_handler = nxt_upstream_health_probe_error,
+
+    .timer_handler = nxt_upstream_health_probe_send_timeout,
+    .timer_value = nxt_upstream_health_probe_timer_value,
+};
+
+
+static void
+nxt_upstream_health_probe_connected(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t  *c;
+
+    c = obj;
+
+    c->write_state = &nxt_upstream_health_probe_send_state;
+
+    nxt_conn_write(task->thread->engine, c);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_health_probe_send_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_health_probe_sent,
+    .error_handler = nxt_upstream_health_probe_error,
+
+    .timer_handler = nxt_upstream_health_probe_send_timeout,
+    .timer_value = nxt_upstream_health_probe_timer_value,
+};
+
+
+static void
+nxt_upstream_health_probe_sent(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b;
+    nxt_conn_t          *c;
+    nxt_event_engine_t  *engine;
+
+    c = obj;
+    engine = task->thread->engine;
+
+    if (nxt_buf_mem_used_size(&c->write->mem) != 0) {
+        nxt_conn_write(engine, c);
+        return;
+    }
+
+    c->write = NULL;
+
+    b = nxt_buf_mem_alloc(c->mem_pool, 256, 0);
+    if (nxt_slow_path(b == NULL)) {
+        nxt_upstream_health_probe_done(task, data, 0);
+        return;
+    }
+
+    c->read = b;
+    c->read_state = &nxt_upstream_health_probe_read_state;
+
+    nxt_conn_read(engine, c);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_health_probe_read_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_health_probe_read,
+    .close_handler = nxt_upstream_health_probe_closed,
+    .error_handler = nxt_upstream_health_probe_error,
+
+    .timer_handler = nxt_upstream_health_probe_read_timeout,
+    .timer_value = nxt_upstream_health_probe_timer_value,
+};
+
+
+static void
+nxt_upstream_health_probe_read(nxt_task_t *task, void *obj, void *data)
+{
+    u_char      *p;
+    nxt_int_t   status;
+    nxt_buf_t   *b;
+    nxt_conn_t  *c;
+
+    c = obj;
+    b = c->read;
+
+    p = nxt_memchr(b->mem.pos, '\n', b->mem.free - b->mem.pos);
+
+    if (p == NULL) {
+        if (b->mem.free == b->mem.end) {
+            nxt_upstream_health_probe_done(task, data, 0);
+            return;
+        }
+
+        nxt_conn_read(task->thread->engine, c);
+        return;
+    }
+
+    /* "HTTP/1.x NNN ..." */
+
+    if (p - b->mem.pos < 12
+        || nxt_memcmp(b->mem.pos, "HTTP/1.", 7) != 0)
+    {
+        nxt_upstream_health_probe_done(task, data, 0);
+        return;
+    }
+
+    status = nxt_int_parse(b->mem.pos + 9, 3);
+
+    nxt_debug(task, "upstream health probe status: %i", status);
+
+    nxt_upstream_health_probe_done(task, data, status >= 200 && status < 400);
+}
+
+
+static void
+nxt_upstream_health_probe_closed(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_debug(task, "upstream health probe closed");
+
+    nxt_upstream_health_probe_done(task, data, 0);
+}
+
+
+static void
+nxt_upstream_health_probe_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_debug(task, "upstream health probe error");
+
+    nxt_upstream_health_probe_done(task, data, 0);
+}
+
+
+static void
+nxt_upstream_health_probe_send_timeout(nxt_task_t *task, void *obj,
+    void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_debug(task, "upstream health probe send timeout");
+
+    c = nxt_write_timer_conn(timer);
+    c->block_write = 1;
+    c->block_read = 1;
+
+    nxt_upstream_health_probe_done(task, c->socket.data, 0);
+}
+
+
+static void
+nxt_upstream_health_probe_read_timeout(nxt_task_t *task, void *obj,
+    void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_debug(task, "upstream health probe read timeout");
+
+    c = nxt_read_timer_conn(timer);
+    c->block_write = 1;
+    c->block_read = 1;
+
+    nxt_upstream_health_probe_done(task, c->socket.data, 0);
+}
+
+
+static nxt_msec_t
+nxt_upstream_health_probe_timer_value(nxt_conn_t *c, uintptr_t data)
+{
+    nxt_upstream_health_probe_t  *probe;
+
+    probe = c->socket.data;
+
+    return probe->timeout;
+}
+
+
+static void
+nxt_upstream_health_probe_done(nxt_task_t *task,
+    nxt_upstream_health_probe_t *probe, nxt_bool_t passed)
+{
+    nxt_conn_t                    *c;
+    nxt_sockaddr_t                *sa;
+    nxt_upstream_health_t         *health;
+    nxt_upstream_health_check_t   *check;
+    nxt_upstream_health_target_t  *target;
+
+    target = probe->target;
+
+    if (target != NULL) {
+        target->probe = NULL;
+
+        check = target->check;
+        health = target->server->health;
+        sa = target->server->sockaddr;
+
+        if (passed) {
+            target->fails = 0;
+            target->passes++;
+
+            if (health->down && target->passes >= check->passes) {
+                nxt_log(task, NXT_LOG_NOTICE, "upstream \"%V\" server %*s "
+                        "is healthy", check->name,
+                        (size_t) sa->length, nxt_sockaddr_start(sa));
+
+                health->fails = 0;
+                health->down = 0;
+            }
+
+        } else {
+            target->passes = 0;
+            target->fails++;
+
+            if (!health->down && target->fails >= check->fails) {
+                nxt_log(task, NXT_LOG_WARN, "upstream \"%V\" server %*s "
+                        "is unhealthy", check->name,
+                        (size_t) sa->length, nxt_sockaddr_start(sa));
+
+                health->down = 1;
+            }
+        }
+    }
+
+    c = probe->conn;
+
+    c->write_state = &nxt_upstream_health_probe_close_state;
+
+    nxt_conn_close(task->thread->engine, c);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_health_probe_close_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_health_probe_free,
+};
+
+
+static void
+nxt_upstream_health_probe_free(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t  *c;
+
+    c = obj;
+
+    nxt_debug(task, "upstream health probe free");
+
+    nxt_conn_free(task, c);
+}
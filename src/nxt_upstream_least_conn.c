@@ -0,0 +1,223 @@
+
+/*
+ * Copyright (C) Igor Sysoev
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_upstream.h>
+
+
+struct nxt_upstream_least_conn_server_s {
+    nxt_sockaddr_t                    *sockaddr;
+    nxt_upstream_health_t             *health;
+
+    /* The number of active requests, shared by all router threads. */
+    nxt_atomic_t                      conns;
+    double                            weight;
+
+    uint8_t                           protocol;
+};
+
+
+struct nxt_upstream_least_conn_s {
+    uint32_t                          items;
+    /* The first server to test, it is local to a router thread. */
+    uint32_t                          next;
+    nxt_upstream_least_conn_server_t  *server;
+};
+
+
+static nxt_upstream_t *nxt_upstream_least_conn_joint_create(
+    nxt_router_temp_conf_t *tmcf, nxt_upstream_t *upstream);
+static void nxt_upstream_least_conn_server_get(nxt_task_t *task,
+    nxt_upstream_server_t *us);
+static void nxt_upstream_least_conn_server_free(nxt_task_t *task,
+    nxt_upstream_server_t *us);
+
+
+static const nxt_upstream_server_proto_t  nxt_upstream_least_conn_proto = {
+    .joint_create = nxt_upstream_least_conn_joint_create,
+    .get          = nxt_upstream_least_conn_server_get,
+    .free         = nxt_upstream_least_conn_server_free,
+};
+
+
+nxt_int_t
+nxt_upstream_least_conn_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_conf_value_t *upstream_conf, nxt_upstream_t *upstream)
+{
+    uint32_t                   i, n, next;
+    nxt_mp_t                   *mp;
+    nxt_str_t                  name;
+    nxt_sockaddr_t             *sa;
+    nxt_conf_value_t           *servers_conf, *srvcf, *wtcf;
+    nxt_upstream_least_conn_t  *ulc;
+
+    static nxt_str_t  servers = nxt_string("servers");
+    static nxt_str_t  weight = nxt_string("weight");
+
+    mp = tmcf->router_conf->mem_pool;
+
+    servers_conf = nxt_conf_get_object_member(upstream_conf, &servers, NULL);
+    n = nxt_conf_object_members_count(servers_conf);
+
+    ulc = nxt_mp_zalloc(mp, sizeof(nxt_upstream_least_conn_t));
+    if (nxt_slow_path(ulc == NULL)) {
+        return NXT_ERROR;
+    }
+
+    ulc->server = nxt_mp_zalloc(mp,
+                               n * sizeof(nxt_upstream_least_conn_server_t));
+    if (nxt_slow_path(ulc->server == NULL)) {
+        return NXT_ERROR;
+    }
+
+    ulc->items = n;
+    next = 0;
+
+    for (i = 0; i < n; i++) {
+        srvcf = nxt_conf_next_object_member(servers_conf, &name, &next);
+
+        sa = nxt_sockaddr_parse(mp, &name);
+        if (nxt_slow_path(sa == NULL)) {
+            return NXT_ERROR;
+        }
+
+        sa->type = SOCK_STREAM;
+
+        ulc->server[i].sockaddr = sa;
+        ulc->server[i].protocol = NXT_HTTP_PROTO_H1;
+
+        ulc->server[i].health = nxt_upstream_health_create(tmcf, srvcf,
+                                                           upstream, sa);
+        if (nxt_slow_path(ulc->server[i].health == NULL)) {
+            return NXT_ERROR;
+        }
+
+        wtcf = nxt_conf_get_object_member(srvcf, &weight, NULL);
+        ulc->server[i].weight = (wtcf != NULL) ? nxt_conf_get_number(wtcf)
+                                               : 1;
+    }
+
+    upstream->proto = &nxt_upstream_least_conn_proto;
+    upstream->type.least_conn = ulc;
+
+    return NXT_OK;
+}
+
+
+static nxt_upstream_t *
+nxt_upstream_least_conn_joint_create(nxt_router_temp_conf_t *tmcf,
+    nxt_upstream_t *upstream)
+{
+    nxt_mp_t                   *mp;
+    nxt_upstream_t             *u;
+    nxt_upstream_least_conn_t  *ulc;
+
+    mp = tmcf->router_conf->mem_pool;
+
+    u = nxt_mp_alloc(mp, sizeof(nxt_upstream_t));
+    if (nxt_slow_path(u == NULL)) {
+        return NULL;
+    }
+
+    *u = *upstream;
+
+    ulc = nxt_mp_alloc(mp, sizeof(nxt_upstream_least_conn_t));
+    if (nxt_slow_path(ulc == NULL)) {
+        return NULL;
+    }
+
+    /* The servers and their counters are shared by all router threads. */
+    *ulc = *upstream->type.least_conn;
+
+    u->type.least_conn = ulc;
+
+    return u;
+}
+
+
+static void
+nxt_upstream_least_conn_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
+{
+    uint32_t                          i, k, n;
+    nxt_bool_t                        all;
+    nxt_atomic_uint_t                 conns, best_conns;
+    nxt_event_engine_t                *engine;
+    nxt_upstream_least_conn_t         *least_conn;
+    nxt_upstream_least_conn_server_t  *s, *best;
+
+    engine = task->thread->engine;
+    least_conn = us->upstream->type.least_conn;
+
+    n = least_conn->items;
+
+    all = 0;
+
+again:
+
+    best = NULL;
+    best_conns = 0;
+
+    /*
+     * The search starts from the next server on each request,
+     * so servers with equal load are chosen in turn.
+     */
+
+    for (i = 0; i < n; i++) {
+        k = (least_conn->next + i) % n;
+        s = &least_conn->server[k];
+
+        if (s->weight == 0
+            || nxt_upstream_server_tried(us, k)
+            || (!all && !nxt_upstream_health_available(engine, s->health)))
+        {
+            continue;
+        }
+
+        conns = s->conns;
+
+        if (best == NULL || conns * best->weight < best_conns * s->weight) {
+            best = s;
+            best_conns = conns;
+        }
+    }
+
+    if (best == NULL) {
+
+        if (!all) {
+            /* All servers are unavailable, so they are tried anyway. */
+            all = 1;
+            goto again;
+        }
+
+        us->state->error(task, us);
+        return;
+    }
+
+    least_conn->next = (least_conn->next + 1) % n;
+
+    nxt_upstream_server_try(us, best - least_conn->server);
+
+    (void) nxt_atomic_fetch_add(&best->conns, 1);
+
+    nxt_debug(task, "upstream least conn: %*s, conns:%uz",
+              (size_t) best->sockaddr->length,
+              nxt_sockaddr_start(best->sockaddr), (size_t) best_conns);
+
+    us->sockaddr = best->sockaddr;
+    us->protocol = best->protocol;
+    us->server.least_conn = best;
+    us->health = best->health;
+
+    us->state->ready(task, us);
+}
+
+
+static void
+nxt_upstream_least_conn_server_free(nxt_task_t *task, nxt_upstream_server_t *us)
+{
+    (void) nxt_atomic_fetch_add(&us->server.least_conn->conns, -1);
+}
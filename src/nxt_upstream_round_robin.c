@@ -12,6 +12,7 @@
 
 struct nxt_upstream_round_robin_server_s {
     nxt_sockaddr_t                     *sockaddr;
+    nxt_upstream_health_t              *health;
 
     int32_t                            current_weight;
     int32_t                            effective_weight;
@@ -104,6 +105,12 @@ nxt_upstream_round_robin_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         urr->server[i].sockaddr = sa;
         urr->server[i].protocol = NXT_HTTP_PROTO_H1;
 
+        urr->server[i].health = nxt_upstream_health_create(tmcf, srvcf,
+                                                           upstream, sa);
+        if (nxt_slow_path(urr->server[i].health == NULL)) {
+            return NXT_ERROR;
+        }
+
         wtcf = nxt_conf_get_object_member(srvcf, &weight, NULL);
         w = (wtcf != NULL) ? k * nxt_conf_get_number(wtcf) : k;
         wt = (w > 1 || w == 0) ? round(w) : 1;
@@ -166,19 +173,32 @@ nxt_upstream_round_robin_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
 {
     int32_t                            total;
     uint32_t                           i, n;
+    nxt_bool_t                         all;
+    nxt_event_engine_t                 *engine;
     nxt_upstream_round_robin_t         *round_robin;
     nxt_upstream_round_robin_server_t  *s, *best;
 
-    best = NULL;
-    total = 0;
-
+    engine = task->thread->engine;
     round_robin = us->upstream->type.round_robin;
 
     s = round_robin->server;
     n = round_robin->items;
 
+    all = 0;
+
+again:
+
+    best = NULL;
+    total = 0;
+
     for (i = 0; i < n; i++) {
 
+        if (nxt_upstream_server_tried(us, i)
+            || (!all && !nxt_upstream_health_available(engine, s[i].health)))
+        {
+            continue;
+        }
+
         s[i].current_weight += s[i].effective_weight;
         total += s[i].effective_weight;
 
@@ -192,14 +212,25 @@ nxt_upstream_round_robin_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
     }
 
     if (best == NULL || total == 0) {
+
+        if (!all) {
+            /* All servers are unavailable, so they are tried anyway. */
+            all = 1;
+            goto again;
+        }
+
         us->state->error(task, us);
         return;
     }
 
     best->current_weight -= total;
+
+    nxt_upstream_server_try(us, best - s);
+
     us->sockaddr = best->sockaddr;
     us->protocol = best->protocol;
     us->server.round_robin = best;
+    us->health = best->health;
 
     us->state->ready(task, us);
 }
@@ -274,6 +274,9 @@ nxt_locked_work_queue_pop(nxt_locked_work_queue_t *lwq, nxt_task_t **task,
             lwq->tail = NULL;
         }
 
+        /* The work may be posted again, e.g. by nxt_job_return(). */
+        work->next = NULL;
+
         handler = work->handler;
     }
 
@@ -289,7 +292,7 @@ void
 nxt_locked_work_queue_move(nxt_thread_t *thr, nxt_locked_work_queue_t *lwq,
     nxt_work_queue_t *wq)
 {
-    nxt_work_t  *work;
+    nxt_work_t  *work, *next;
 
     nxt_thread_spin_lock(&lwq->lock);
 
@@ -306,6 +309,9 @@ nxt_locked_work_queue_move(nxt_thread_t *thr, nxt_locked_work_queue_t *lwq,
         nxt_work_queue_add(wq, work->handler, work->task,
                            work->obj, work->data);
 
-        work = work->next;
+        next = work->next;
+        work->next = NULL;
+
+        work = next;
     }
 }
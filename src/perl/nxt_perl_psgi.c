@@ -123,6 +123,7 @@ NXT_EXPORT nxt_app_module_t  nxt_app_module = {
     0,
     NULL,
     nxt_perl_psgi_start,
+    NULL,
 };
 
 
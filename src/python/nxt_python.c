@@ -22,8 +22,13 @@ typedef struct {
 } nxt_py_thread_info_t;
 
 
+static nxt_int_t nxt_python_prototype(nxt_task_t *task,
+    nxt_process_data_t *data);
 static nxt_int_t nxt_python_start(nxt_task_t *task,
     nxt_process_data_t *data);
+static nxt_int_t nxt_python_init(nxt_task_t *task, nxt_python_app_conf_t *c);
+static nxt_int_t nxt_python_targets_init(nxt_task_t *task,
+    nxt_common_app_conf_t *app_conf);
 static nxt_int_t nxt_python_set_target(nxt_task_t *task,
     nxt_python_target_t *target, nxt_conf_value_t *conf);
 static nxt_int_t nxt_python_set_path(nxt_task_t *task, nxt_conf_value_t *value);
@@ -48,6 +53,7 @@ NXT_EXPORT nxt_app_module_t  nxt_app_module = {
     nxt_nitems(nxt_python_mounts),
     NULL,
     nxt_python_start,
+    nxt_python_prototype,
 };
 
 static PyObject           *nxt_py_stderr_flush;
@@ -62,30 +68,49 @@ static char               *nxt_py_home;
 static pthread_attr_t        *nxt_py_thread_attr;
 static nxt_py_thread_info_t  *nxt_py_threads;
 static nxt_python_proto_t    nxt_py_proto;
+static nxt_bool_t            nxt_py_prototype;
+
+
+static nxt_int_t
+nxt_python_prototype(nxt_task_t *task, nxt_process_data_t *data)
+{
+    nxt_common_app_conf_t  *app_conf;
+
+    app_conf = data->app;
+
+    if (nxt_slow_path(nxt_python_init(task, &app_conf->u.python) != NXT_OK)) {
+        goto fail;
+    }
+
+    if (app_conf->preload) {
+        if (nxt_slow_path(nxt_python_targets_init(task, app_conf) != NXT_OK)) {
+            goto fail;
+        }
+    }
+
+    nxt_py_prototype = 1;
+
+    return NXT_OK;
+
+fail:
+
+    nxt_python_atexit();
+
+    return NXT_ERROR;
+}
 
 
 static nxt_int_t
 nxt_python_start(nxt_task_t *task, nxt_process_data_t *data)
 {
     int                    rc;
-    size_t                 len, size;
-    uint32_t               next;
-    PyObject               *obj, *module;
-    nxt_str_t              proto, probe_proto, name;
-    nxt_int_t              ret, n, i;
+    nxt_str_t              proto, probe_proto;
+    nxt_int_t              i;
     nxt_unit_ctx_t         *unit_ctx;
     nxt_unit_init_t        python_init;
-    nxt_conf_value_t       *cv;
     nxt_python_targets_t   *targets;
     nxt_common_app_conf_t  *app_conf;
     nxt_python_app_conf_t  *c;
-#if PY_MAJOR_VERSION == 3
-    char                   *path;
-    nxt_int_t              pep405;
-
-    static const char pyvenv[] = "/pyvenv.cfg";
-    static const char bin_python[] = "/bin/python";
-#endif
 
     static const nxt_str_t  wsgi = nxt_string("wsgi");
     static const nxt_str_t  asgi = nxt_string("asgi");
@@ -93,6 +118,126 @@ nxt_python_start(nxt_task_t *task, nxt_process_data_t *data)
     app_conf = data->app;
     c = &app_conf->u.python;
 
+    python_init.ctx_data = NULL;
+
+    if (nxt_py_prototype) {
+        /* The interpreter is initialized by the prototype process. */
+
+#if PY_VERSION_HEX >= NXT_PYTHON_VER(3, 7)
+        PyOS_AfterFork_Child();
+#else
+        PyOS_AfterFork();
+#endif
+
+    } else if (nxt_slow_path(nxt_python_init(task, c) != NXT_OK)) {
+        goto fail;
+    }
+
+    if (nxt_py_targets == NULL) {
+        if (nxt_slow_path(nxt_python_targets_init(task, app_conf) != NXT_OK)) {
+            goto fail;
+        }
+    }
+
+    targets = nxt_py_targets;
+
+    nxt_unit_default_init(task, &python_init);
+
+    python_init.data = c;
+    python_init.shm_limit = data->app->shm_limit;
+    python_init.callbacks.ready_handler = nxt_python_ready_handler;
+
+    proto = c->protocol;
+
+    if (proto.length == 0) {
+        proto = nxt_python_asgi_check(targets->target[0].application)
+                ? asgi : wsgi;
+
+        for (i = 1; i < targets->count; i++) {
+            probe_proto = nxt_python_asgi_check(targets->target[i].application)
+                          ? asgi : wsgi;
+            if (probe_proto.start != proto.start) {
+                nxt_alert(task, "A mix of ASGI & WSGI targets is forbidden, "
+                                "specify protocol in config if incorrect");
+                goto fail;
+            }
+        }
+    }
+
+    if (nxt_strstr_eq(&proto, &asgi)) {
+        rc = nxt_python_asgi_init(&python_init, &nxt_py_proto);
+
+    } else {
+        rc = nxt_python_wsgi_init(&python_init, &nxt_py_proto);
+    }
+
+    if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
+        goto fail;
+    }
+
+    rc = nxt_py_proto.ctx_data_alloc(&python_init.ctx_data, 1);
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        goto fail;
+    }
+
+    rc = nxt_python_init_threads(c);
+    if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
+        goto fail;
+    }
+
+    if (nxt_py_proto.startup != NULL) {
+        if (nxt_py_proto.startup(python_init.ctx_data) != NXT_UNIT_OK) {
+            goto fail;
+        }
+    }
+
+    unit_ctx = nxt_unit_init(&python_init);
+    if (nxt_slow_path(unit_ctx == NULL)) {
+        goto fail;
+    }
+
+    rc = nxt_py_proto.run(unit_ctx);
+
+    nxt_python_join_threads(unit_ctx, c);
+
+    nxt_unit_done(unit_ctx);
+
+    nxt_py_proto.ctx_data_free(python_init.ctx_data);
+
+    nxt_python_atexit();
+
+    exit(rc);
+
+    return NXT_OK;
+
+fail:
+
+    nxt_python_join_threads(NULL, c);
+
+    if (python_init.ctx_data != NULL) {
+        nxt_py_proto.ctx_data_free(python_init.ctx_data);
+    }
+
+    nxt_python_atexit();
+
+    return NXT_ERROR;
+}
+
+
+static nxt_int_t
+nxt_python_init(nxt_task_t *task, nxt_python_app_conf_t *c)
+{
+    size_t     len;
+    PyObject   *obj;
+#if PY_MAJOR_VERSION == 3
+    char       *path;
+    size_t     size;
+    nxt_int_t  pep405;
+
+    static const char pyvenv[] = "/pyvenv.cfg";
+    static const char bin_python[] = "/bin/python";
+#endif
+
     if (c->home != NULL) {
         len = nxt_strlen(c->home);
 
@@ -154,44 +299,56 @@ nxt_python_start(nxt_task_t *task, nxt_process_data_t *data)
     }
 #endif
 
-    module = NULL;
-    obj = NULL;
-
-    python_init.ctx_data = NULL;
-
     obj = PySys_GetObject((char *) "stderr");
     if (nxt_slow_path(obj == NULL)) {
         nxt_alert(task, "Python failed to get \"sys.stderr\" object");
-        goto fail;
+        return NXT_ERROR;
     }
 
     nxt_py_stderr_flush = PyObject_GetAttrString(obj, "flush");
 
     /* obj is a Borrowed reference. */
-    obj = NULL;
 
     if (nxt_slow_path(nxt_py_stderr_flush == NULL)) {
         nxt_alert(task, "Python failed to get \"flush\" attribute of "
                         "\"sys.stderr\" object");
-        goto fail;
+        return NXT_ERROR;
     }
 
     if (nxt_slow_path(nxt_python_set_path(task, c->path) != NXT_OK)) {
-        goto fail;
+        return NXT_ERROR;
     }
 
     obj = Py_BuildValue("[s]", "unit");
     if (nxt_slow_path(obj == NULL)) {
         nxt_alert(task, "Python failed to create the \"sys.argv\" list");
-        goto fail;
+        return NXT_ERROR;
     }
 
     if (nxt_slow_path(PySys_SetObject((char *) "argv", obj) != 0)) {
         nxt_alert(task, "Python failed to set the \"sys.argv\" list");
-        goto fail;
+        Py_DECREF(obj);
+        return NXT_ERROR;
     }
 
-    Py_CLEAR(obj);
+    Py_DECREF(obj);
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_python_targets_init(nxt_task_t *task, nxt_common_app_conf_t *app_conf)
+{
+    size_t                 size;
+    uint32_t               next;
+    nxt_int_t              ret, n, i;
+    nxt_str_t              name;
+    nxt_conf_value_t       *cv;
+    nxt_python_targets_t   *targets;
+    nxt_python_app_conf_t  *c;
+
+    c = &app_conf->u.python;
 
     n = (c->targets != NULL ? nxt_conf_object_members_count(c->targets) : 1);
 
@@ -200,7 +357,7 @@ nxt_python_start(nxt_task_t *task, nxt_process_data_t *data)
     targets = nxt_unit_malloc(NULL, size);
     if (nxt_slow_path(targets == NULL)) {
         nxt_alert(task, "Could not allocate targets");
-        goto fail;
+        return NXT_ERROR;
     }
 
     memset(targets, 0, size);
@@ -219,100 +376,14 @@ nxt_python_start(nxt_task_t *task, nxt_process_data_t *data)
 
             ret = nxt_python_set_target(task, &targets->target[i], cv);
             if (nxt_slow_path(ret != NXT_OK)) {
-                goto fail;
-            }
-        }
-
-    } else {
-        ret = nxt_python_set_target(task, &targets->target[0], app_conf->self);
-        if (nxt_slow_path(ret != NXT_OK)) {
-            goto fail;
-        }
-    }
-
-    nxt_unit_default_init(task, &python_init);
-
-    python_init.data = c;
-    python_init.shm_limit = data->app->shm_limit;
-    python_init.callbacks.ready_handler = nxt_python_ready_handler;
-
-    proto = c->protocol;
-
-    if (proto.length == 0) {
-        proto = nxt_python_asgi_check(targets->target[0].application)
-                ? asgi : wsgi;
-
-        for (i = 1; i < targets->count; i++) {
-            probe_proto = nxt_python_asgi_check(targets->target[i].application)
-                          ? asgi : wsgi;
-            if (probe_proto.start != proto.start) {
-                nxt_alert(task, "A mix of ASGI & WSGI targets is forbidden, "
-                                "specify protocol in config if incorrect");
-                goto fail;
+                return NXT_ERROR;
             }
         }
-    }
-
-    if (nxt_strstr_eq(&proto, &asgi)) {
-        rc = nxt_python_asgi_init(&python_init, &nxt_py_proto);
-
-    } else {
-        rc = nxt_python_wsgi_init(&python_init, &nxt_py_proto);
-    }
-
-    if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
-        goto fail;
-    }
-
-    rc = nxt_py_proto.ctx_data_alloc(&python_init.ctx_data, 1);
-    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
-        goto fail;
-    }
-
-    rc = nxt_python_init_threads(c);
-    if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
-        goto fail;
-    }
-
-    if (nxt_py_proto.startup != NULL) {
-        if (nxt_py_proto.startup(python_init.ctx_data) != NXT_UNIT_OK) {
-            goto fail;
-        }
-    }
 
-    unit_ctx = nxt_unit_init(&python_init);
-    if (nxt_slow_path(unit_ctx == NULL)) {
-        goto fail;
-    }
-
-    rc = nxt_py_proto.run(unit_ctx);
-
-    nxt_python_join_threads(unit_ctx, c);
-
-    nxt_unit_done(unit_ctx);
-
-    nxt_py_proto.ctx_data_free(python_init.ctx_data);
-
-    nxt_python_atexit();
-
-    exit(rc);
-
-    return NXT_OK;
-
-fail:
-
-    nxt_python_join_threads(NULL, c);
-
-    if (python_init.ctx_data != NULL) {
-        nxt_py_proto.ctx_data_free(python_init.ctx_data);
+        return NXT_OK;
     }
 
-    Py_XDECREF(obj);
-    Py_XDECREF(module);
-
-    nxt_python_atexit();
-
-    return NXT_ERROR;
+    return nxt_python_set_target(task, &targets->target[0], app_conf->self);
 }
 
 
@@ -51,6 +51,15 @@ typedef struct {
 }  nxt_python_ctx_t;
 
 
+typedef struct {
+    PyObject_HEAD
+
+    PyObject                 *filelike;
+    Py_ssize_t               blksize;
+    int                      done;
+} nxt_py_file_wrapper_t;
+
+
 static int nxt_python_wsgi_ctx_data_alloc(void **pdata, int main);
 static void nxt_python_wsgi_ctx_data_free(void *data);
 static int nxt_python_wsgi_run(nxt_unit_ctx_t *ctx);
@@ -89,7 +98,16 @@ static PyObject *nxt_py_input_readlines(nxt_python_ctx_t *self,
 static PyObject *nxt_py_input_iter(PyObject *pctx);
 static PyObject *nxt_py_input_next(PyObject *pctx);
 
+static PyObject *nxt_py_file_wrapper_new(PyTypeObject *type, PyObject *args,
+    PyObject *kwds);
+static void nxt_py_file_wrapper_dealloc(nxt_py_file_wrapper_t *fw);
+static PyObject *nxt_py_file_wrapper_next(nxt_py_file_wrapper_t *fw);
+static PyObject *nxt_py_file_wrapper_close(nxt_py_file_wrapper_t *fw,
+    PyObject *args);
+
 static int nxt_python_write(nxt_python_ctx_t *pctx, PyObject *bytes);
+static int nxt_python_sendfile(nxt_python_ctx_t *pctx,
+    nxt_py_file_wrapper_t *fw);
 
 
 static PyMethodDef nxt_py_start_resp_method[] = {
@@ -124,6 +142,27 @@ static PyTypeObject nxt_py_input_type = {
 };
 
 
+static PyMethodDef nxt_py_file_wrapper_methods[] = {
+    { "close", (PyCFunction) nxt_py_file_wrapper_close, METH_NOARGS, 0 },
+    { NULL, NULL, 0, 0 }
+};
+
+
+static PyTypeObject nxt_py_file_wrapper_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+
+    .tp_name      = "unit._file_wrapper",
+    .tp_basicsize = sizeof(nxt_py_file_wrapper_t),
+    .tp_dealloc   = (destructor) nxt_py_file_wrapper_dealloc,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "unit file wrapper object.",
+    .tp_iter      = PyObject_SelfIter,
+    .tp_iternext  = (iternextfunc) nxt_py_file_wrapper_next,
+    .tp_methods   = nxt_py_file_wrapper_methods,
+    .tp_new       = nxt_py_file_wrapper_new,
+};
+
+
 static PyObject  *nxt_py_environ_ptyp;
 
 static PyObject  *nxt_py_80_str;
@@ -366,11 +405,15 @@ nxt_python_request_handler(nxt_unit_request_info_t *req)
         rc = nxt_python_write(pctx, response);
 
     } else {
+        rc = NXT_UNIT_OK;
+
+        if (Py_TYPE(response) == &nxt_py_file_wrapper_type) {
+            rc = nxt_python_sendfile(pctx, (nxt_py_file_wrapper_t *) response);
+        }
+
         iterator = PyObject_GetIter(response);
 
         if (nxt_fast_path(iterator != NULL)) {
-            rc = NXT_UNIT_OK;
-
             while (pctx->bytes_sent < pctx->content_length) {
                 item = PyIter_Next(iterator);
 
@@ -537,6 +580,22 @@ nxt_python_create_environ(nxt_python_app_conf_t *c)
     }
 
 
+    if (nxt_slow_path(PyType_Ready(&nxt_py_file_wrapper_type) != 0)) {
+        nxt_unit_alert(NULL,
+           "Python failed to initialize the \"wsgi.file_wrapper\" type object");
+        goto fail;
+    }
+
+    if (nxt_slow_path(PyDict_SetItemString(environ, "wsgi.file_wrapper",
+                                   (PyObject *) &nxt_py_file_wrapper_type)
+        != 0))
+    {
+        nxt_unit_alert(NULL,
+               "Python failed to set the \"wsgi.file_wrapper\" environ value");
+        goto fail;
+    }
+
+
     err = PySys_GetObject((char *) "stderr");
 
     if (nxt_slow_path(err == NULL)) {
@@ -1344,3 +1403,159 @@ nxt_python_write(nxt_python_ctx_t *pctx, PyObject *bytes)
 
     return rc;
 }
+
+
+static PyObject *
+nxt_py_file_wrapper_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    PyObject               *filelike;
+    Py_ssize_t             blksize;
+    nxt_py_file_wrapper_t  *fw;
+
+    static char  *kwlist[] = { (char *) "filelike", (char *) "block_size",
+                               NULL };
+
+    blksize = 8192;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|n:file_wrapper", kwlist,
+                                     &filelike, &blksize))
+    {
+        return NULL;
+    }
+
+    fw = (nxt_py_file_wrapper_t *) type->tp_alloc(type, 0);
+    if (nxt_slow_path(fw == NULL)) {
+        return NULL;
+    }
+
+    Py_INCREF(filelike);
+
+    fw->filelike = filelike;
+    fw->blksize = blksize;
+    fw->done = 0;
+
+    return (PyObject *) fw;
+}
+
+
+static void
+nxt_py_file_wrapper_dealloc(nxt_py_file_wrapper_t *fw)
+{
+    Py_XDECREF(fw->filelike);
+
+    Py_TYPE(fw)->tp_free((PyObject *) fw);
+}
+
+
+static PyObject *
+nxt_py_file_wrapper_next(nxt_py_file_wrapper_t *fw)
+{
+    PyObject  *data;
+
+    if (fw->done) {
+        return NULL;
+    }
+
+    data = PyObject_CallMethod(fw->filelike, (char *) "read", (char *) "n",
+                               fw->blksize);
+    if (nxt_slow_path(data == NULL)) {
+        return NULL;
+    }
+
+    if (PyBytes_Check(data) && PyBytes_GET_SIZE(data) == 0) {
+        Py_DECREF(data);
+
+        fw->done = 1;
+
+        return NULL;
+    }
+
+    return data;
+}
+
+
+static PyObject *
+nxt_py_file_wrapper_close(nxt_py_file_wrapper_t *fw, PyObject *args)
+{
+    PyObject  *close, *result;
+
+    close = PyObject_GetAttr(fw->filelike, nxt_py_close_str);
+
+    if (close == NULL) {
+        PyErr_Clear();
+
+        Py_RETURN_NONE;
+    }
+
+    result = PyObject_CallFunction(close, NULL);
+
+    Py_DECREF(close);
+
+    return result;
+}
+
+
+/*
+ * nxt_python_sendfile() sends the file of the "wsgi.file_wrapper" object
+ * with nxt_unit_response_sendfile() starting from the current position.
+ * The wrapper is marked as done unless the file object has no descriptor
+ * of a regular file, in which case it is read and sent by blocks.
+ */
+
+static int
+nxt_python_sendfile(nxt_python_ctx_t *pctx, nxt_py_file_wrapper_t *fw)
+{
+    int          rc;
+    long         fd;
+    uint64_t     size;
+    PyObject     *obj;
+    long long    offset;
+    struct stat  st;
+
+    obj = PyObject_CallMethod(fw->filelike, (char *) "fileno", NULL);
+    if (obj == NULL) {
+        PyErr_Clear();
+        return NXT_UNIT_OK;
+    }
+
+    fd = PyLong_AsLong(obj);
+
+    Py_DECREF(obj);
+
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        PyErr_Clear();
+        return NXT_UNIT_OK;
+    }
+
+    /* The file object may have read ahead, so the descriptor is not used. */
+    obj = PyObject_CallMethod(fw->filelike, (char *) "tell", NULL);
+    if (obj == NULL) {
+        PyErr_Clear();
+        return NXT_UNIT_OK;
+    }
+
+    offset = PyLong_AsLongLong(obj);
+
+    Py_DECREF(obj);
+
+    if (offset < 0 || offset > st.st_size) {
+        PyErr_Clear();
+        return NXT_UNIT_OK;
+    }
+
+    fw->done = 1;
+
+    size = st.st_size - offset;
+    size = nxt_min(size, pctx->content_length - pctx->bytes_sent);
+
+    if (size == 0) {
+        return NXT_UNIT_OK;
+    }
+
+    rc = nxt_unit_response_sendfile(pctx->req, fd, offset, size);
+    if (nxt_fast_path(rc == NXT_UNIT_OK)) {
+        pctx->bytes_sent += size;
+    }
+
+    return rc;
+}
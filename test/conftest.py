@@ -21,6 +21,7 @@ from unit.check.isolation import check_isolation
 from unit.check.node import check_node
 from unit.check.regex import check_regex
 from unit.check.tls import check_openssl
+from unit.check.zlib import check_zlib
 from unit.http import TestHTTP
 from unit.log import Log
 from unit.option import option
@@ -209,6 +210,7 @@ def pytest_sessionstart(session):
     )
     option.available['modules']['node'] = check_node(option.current_dir)
     option.available['modules']['regex'] = check_regex(unit['unitd'])
+    option.available['modules']['zlib'] = check_zlib(unit['unitd'])
 
     # remove None values
 
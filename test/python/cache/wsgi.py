@@ -0,0 +1,37 @@
+import time
+
+count = 0
+
+
+def application(env, start_response):
+    global count
+    count += 1
+
+    time.sleep(float(env.get('HTTP_X_DELAY', '0')))
+
+    length = env.get('HTTP_X_LENGTH')
+    chunks = int(env.get('HTTP_X_CHUNKS', '1'))
+
+    if length is not None:
+        body = [b'X' * int(length)] * chunks
+
+    else:
+        body = [str(count).encode()] * chunks
+
+    headers = [('Content-Type', 'text/plain'), ('X-Count', str(count))]
+
+    if chunks == 1:
+        headers.append(('Content-Length', str(len(body[0]))))
+
+    for name in ['Cache-Control', 'Expires', 'Set-Cookie', 'Vary']:
+        var = 'HTTP_X_' + name.upper().replace('-', '_')
+
+        if var in env:
+            headers.append((name, env[var]))
+
+    start_response(env.get('HTTP_X_STATUS', '200'), headers)
+
+    if env['REQUEST_METHOD'] == 'HEAD':
+        return []
+
+    return body
@@ -0,0 +1,29 @@
+import tempfile
+
+
+def application(env, start_response):
+    length = int(env.get('HTTP_X_LENGTH', '10'))
+    chunks = int(env.get('HTTP_X_CHUNKS', '1'))
+    body = [b'X' * length] * chunks
+
+    headers = [('Content-Type', env.get('HTTP_X_TYPE', 'text/plain'))]
+
+    if chunks == 1:
+        headers.append(('Content-Length', str(length)))
+
+    if 'HTTP_X_ENCODING' in env:
+        headers.append(('Content-Encoding', env['HTTP_X_ENCODING']))
+
+    if 'HTTP_X_ETAG' in env:
+        headers.append(('ETag', env['HTTP_X_ETAG']))
+
+    start_response(env.get('HTTP_X_STATUS', '200'), headers)
+
+    if 'HTTP_X_FILE_WRAPPER' in env:
+        f = tempfile.TemporaryFile()
+        f.write(b''.join(body))
+        f.seek(0)
+
+        return env['wsgi.file_wrapper'](f)
+
+    return body
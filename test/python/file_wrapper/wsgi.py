@@ -0,0 +1,22 @@
+import io
+import os
+
+
+def application(environ, start_response):
+    offset = int(environ.get('HTTP_X_OFFSET', 0))
+
+    if 'HTTP_X_MEMORY' in environ:
+        f = io.BytesIO(environ['HTTP_X_MEMORY'].encode())
+        size = len(environ['HTTP_X_MEMORY'])
+
+    else:
+        f = open(environ['HTTP_X_FILE'], 'rb')
+        size = os.fstat(f.fileno()).st_size
+
+    f.seek(offset)
+
+    length = environ.get('HTTP_X_LENGTH', str(size - offset))
+
+    start_response('200', [('Content-Length', length)])
+
+    return environ['wsgi.file_wrapper'](f, 1024)
@@ -0,0 +1,15 @@
+import os
+
+import_pid = os.getpid()
+
+
+def application(environ, start_response):
+    start_response(
+        '200',
+        [
+            ('Content-Length', '0'),
+            ('X-Pid', str(os.getpid())),
+            ('X-Import-Pid', str(import_pid)),
+        ],
+    )
+    return []
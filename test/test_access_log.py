@@ -264,3 +264,187 @@ Connection: close
             self.wait_for_record(r'"GET / HTTP/1.1" 200 0 "-" "-"', 'new.log')
             is not None
         ), 'change'
+
+    def test_access_log_object(self):
+        self.load('empty')
+
+        assert 'success' in self.conf(
+            {"path": option.temp_dir + '/access.log'}, 'access_log'
+        ), 'object'
+
+        self.get(url='/object')
+
+        assert (
+            self.wait_for_record(r'"GET /object HTTP/1.1" 200 0') is not None
+        ), 'object record'
+
+    def test_access_log_buffered(self):
+        self.load('empty')
+
+        assert 'success' in self.conf(
+            {
+                "path": option.temp_dir + '/access.log',
+                "buffer_size": 4096,
+                "flush_interval": 1,
+            },
+            'access_log',
+        ), 'buffered'
+
+        self.get(url='/buffered')
+
+        assert (
+            self.search_in_log(r'/buffered', 'access.log') is None
+        ), 'buffered record'
+
+        assert (
+            self.wait_for_record(r'"GET /buffered HTTP/1.1" 200 0') is not None
+        ), 'flushed record'
+
+        for i in range(50):
+            self.get(url='/full' + str(i))
+
+        assert (
+            self.wait_for_record(r'"GET /full49 HTTP/1.1" 200 0') is not None
+        ), 'full buffer'
+
+        for i in range(50):
+            assert (
+                self.search_in_log(r'"GET /full' + str(i) + ' ', 'access.log')
+                is not None
+            ), 'all records'
+
+    def test_access_log_buffered_change(self):
+        self.load('empty')
+
+        assert 'success' in self.conf(
+            {
+                "path": option.temp_dir + '/access.log',
+                "buffer_size": 4096,
+                "flush_interval": 60,
+            },
+            'access_log',
+        )
+
+        self.get(url='/old')
+
+        assert 'success' in self.conf(
+            '"' + option.temp_dir + '/new.log"', 'access_log'
+        )
+
+        self.get(url='/new')
+
+        assert (
+            self.wait_for_record(r'"GET /new HTTP/1.1" 200 0', 'new.log')
+            is not None
+        ), 'new log'
+        assert (
+            self.wait_for_record(r'"GET /old HTTP/1.1" 200 0') is not None
+        ), 'old log flushed'
+
+    def test_access_log_buffered_drop(self):
+        self.load('empty')
+
+        assert 'success' in self.conf(
+            {
+                "path": option.temp_dir + '/access.log',
+                "buffer_size": 16,
+                "flush_interval": 1,
+            },
+            'access_log',
+        ), 'small buffer'
+
+        for _ in range(3):
+            assert self.get(url='/drop')['status'] == 200
+
+        assert (
+            self.wait_for_record(r'3 access log lines dropped', 'unit.log')
+            is not None
+        ), 'dropped lines'
+        assert self.search_in_log(r'/drop', 'access.log') is None, 'no lines'
+
+    def test_access_log_format(self):
+        self.load('empty')
+
+        assert 'success' in self.conf(
+            {
+                "path": option.temp_dir + '/access.log',
+                "format": '[$remote_addr] "$request_line" $status '
+                '$body_bytes_sent $bytes_received "${header_referer}" '
+                '"$header_user_agent" $uri $request_time '
+                '$upstream_response_time',
+            },
+            'access_log',
+        ), 'format'
+
+        self.get(
+            url='/format?a=b',
+            headers={
+                'Host': 'localhost',
+                'Referer': 'referer-value',
+                'User-Agent': 'user-agent-value',
+                'Connection': 'close',
+            },
+        )
+
+        assert (
+            self.wait_for_record(
+                r'(?m)^\[127\.0\.0\.1\] "GET /format\?a=b HTTP/1\.1" 200 0 \d+ '
+                r'"referer-value" "user-agent-value" /format '
+                r'\d+\.\d{3} \d+\.\d{3}$'
+            )
+            is not None
+        ), 'format record'
+
+    def test_access_log_format_static(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [{"action": {"return": 204}}],
+                "applications": {},
+                "access_log": {
+                    "path": option.temp_dir + '/access.log',
+                    "format": 'static $status $upstream_response_time '
+                    '"$header_referer"',
+                },
+            }
+        ), 'format static'
+
+        assert self.get()['status'] == 204
+
+        assert (
+            self.wait_for_record(r'(?m)^static 204 - ""$') is not None
+        ), 'format static record'
+
+    def test_access_log_format_bytes_received(self):
+        self.load('empty')
+
+        assert 'success' in self.conf(
+            {"path": option.temp_dir + '/access.log', "format": '$bytes_received'},
+            'access_log',
+        ), 'format bytes received'
+
+        req = """POST / HTTP/1.1
+Host: localhost
+Content-Length: 10
+Connection: close
+
+0123456789"""
+
+        self.http(req.encode(), raw=True, raw_resp=True)
+
+        assert (
+            self.wait_for_record(r'(?m)^' + str(len(req)) + r'$') is not None
+        ), 'bytes received'
+
+    def test_access_log_invalid(self):
+        def check_error(conf):
+            assert 'error' in self.conf(conf, 'access_log')
+
+        check_error({})
+        check_error({"path": 1})
+        check_error({"path": "/a", "buffer_size": -1})
+        check_error({"path": "/a", "flush_interval": 0})
+        check_error({"path": "/a", "blah": 1})
+        check_error({"path": "/a", "format": ""})
+        check_error({"path": "/a", "format": "$blah"})
+        check_error({"path": "/a", "format": "${uri"})
@@ -0,0 +1,470 @@
+import gzip
+import os
+import select
+import time
+
+import pytest
+
+from unit.applications.lang.python import TestApplicationPython
+from unit.option import option
+
+
+class TestCache(TestApplicationPython):
+    prerequisites = {'modules': {'python': 'any'}}
+
+    @pytest.fixture(autouse=True)
+    def setup_method_fixture(self):
+        self.sock = None
+
+        self.load('cache')
+
+        assert 'success' in self.conf(
+            [
+                {
+                    "match": {"uri": "/proxy"},
+                    "action": {
+                        "proxy": "http://127.0.0.1:7081",
+                        "cache": {"valid": 60},
+                    },
+                },
+                {
+                    "action": {
+                        "pass": "applications/cache",
+                        "cache": {"valid": 60},
+                    }
+                },
+            ],
+            'routes',
+        ), 'routes configure'
+
+        assert 'success' in self.conf(
+            {
+                "*:7080": {"pass": "routes"},
+                "*:7081": {"pass": "applications/cache"},
+            },
+            'listeners',
+        ), 'listeners configure'
+
+        yield
+
+        if self.sock is not None:
+            self.sock.close()
+
+    def recv(self):
+        assert select.select([self.sock], [], [], 30)[0], 'response timeout'
+
+        part = self.sock.recv(4096)
+        assert part, 'connection closed'
+
+        return part
+
+    def get_cached(self, url='/', method='GET', **headers):
+        """
+        All requests of a test are sent over a single keep-alive connection,
+        so a test does not depend on the router thread a request is
+        handled by.
+        """
+        kwargs = {'sock': self.sock} if self.sock is not None else {}
+
+        _, self.sock = self.http(
+            method,
+            url=url,
+            headers={'Host': 'localhost', **headers},
+            start=True,
+            no_recv=True,
+            **kwargs,
+        )
+
+        data = b''
+        while b'\r\n\r\n' not in data:
+            data += self.recv()
+
+        header, body = data.split(b'\r\n\r\n', 1)
+        resp = self._resp_to_dict(header.decode() + '\r\n\r\n')
+
+        if method == 'HEAD':
+            pass
+
+        elif resp['headers'].get('Transfer-Encoding') == 'chunked':
+            while not body.endswith(b'0\r\n\r\n'):
+                body += self.recv()
+
+            body = self._parse_chunked_body(body)
+
+        else:
+            while len(body) < int(resp['headers']['Content-Length']):
+                body += self.recv()
+
+        resp['body'] = body
+
+        return resp
+
+    def count(self, url='/', **headers):
+        return self.get_cached(url, **headers)['headers']['X-Count']
+
+    def check_cached(self, url, cached=True, **headers):
+        first = self.get_cached(url, **headers)
+        second = self.get_cached(url, **headers)
+
+        assert first['status'] == second['status'], 'status'
+
+        if cached:
+            assert first['body'] == second['body'], 'body'
+            assert (
+                first['headers']['X-Count'] == second['headers']['X-Count']
+            ), 'cached'
+
+        else:
+            assert (
+                first['headers']['X-Count'] != second['headers']['X-Count']
+            ), 'not cached'
+
+        return second
+
+    def test_cache(self):
+        resp = self.check_cached('/')
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['Content-Type'] == 'text/plain', 'type'
+        assert resp['headers']['Content-Length'] == str(len(resp['body']))
+        assert 'Date' in resp['headers'], 'Date'
+        assert 'Server' in resp['headers'], 'Server'
+
+        count = resp['headers']['X-Count']
+
+        resp = self.get_cached('/', method='HEAD')
+        assert resp['headers']['X-Count'] == count, 'HEAD hit'
+        assert resp['headers']['Content-Length'] == str(len(count)), 'HEAD'
+        assert resp['body'] == b'', 'HEAD body'
+
+        assert self.count('/?blah') != count, 'key'
+
+    def test_cache_head_miss(self):
+        resp = self.get_cached('/head', method='HEAD')
+        assert resp['status'] == 200, 'HEAD'
+
+        count = self.count('/head')
+        assert count != resp['headers']['X-Count'], 'HEAD not stored'
+        assert self.count('/head') == count, 'GET stored'
+
+    def test_cache_methods(self):
+        count = self.count('/post')
+
+        resp = self.post(url='/post', body='blah')
+        assert resp['headers']['X-Count'] != count, 'POST'
+
+        resp = self.get(
+            url='/post',
+            headers={
+                'Host': 'localhost',
+                'Authorization': 'Basic dXNlcjpwYXNz',
+                'Connection': 'close',
+            },
+        )
+        assert resp['headers']['X-Count'] != count, 'Authorization'
+
+    def test_cache_control(self):
+        for value in [
+            'no-store',
+            'no-cache',
+            'private',
+            'Private="Set-Cookie"',
+            'public, max-age=0',
+            'max-age=blah',
+        ]:
+            self.check_cached(
+                '/?' + value, cached=False, **{'X-Cache-Control': value}
+            )
+
+        self.check_cached('/?public', **{'X-Cache-Control': 'public'})
+
+    def test_cache_max_age(self):
+        assert 'success' in self.conf_delete('routes/1/action/cache/valid')
+
+        self.check_cached('/?none', cached=False)
+
+        headers = {'X-Cache-Control': 'max-age=1'}
+        count = self.check_cached('/max-age', **headers)['headers']['X-Count']
+
+        time.sleep(2.1)
+
+        assert self.count('/max-age', **headers) != count, 'expired'
+
+        headers = {'X-Cache-Control': 'max-age=0, s-maxage=60'}
+        self.check_cached('/?s-maxage', **headers)
+
+    def test_cache_expires(self):
+        assert 'success' in self.conf_delete('routes/1/action/cache/valid')
+
+        self.check_cached(
+            '/?future', **{'X-Expires': 'Thu, 01 Jan 2037 00:00:00 GMT'}
+        )
+        self.check_cached(
+            '/?past',
+            cached=False,
+            **{'X-Expires': 'Thu, 01 Jan 1970 00:00:00 GMT'}
+        )
+        self.check_cached('/?invalid', cached=False, **{'X-Expires': '0'})
+
+    def test_cache_not_stored(self):
+        self.check_cached('/?cookie', cached=False, **{'X-Set-Cookie': 'a=b'})
+        self.check_cached('/?vary', cached=False, **{'X-Vary': 'Cookie'})
+        self.check_cached('/?status', cached=False, **{'X-Status': '404'})
+
+    def test_cache_key(self):
+        assert 'success' in self.conf(
+            '"$host"', 'routes/1/action/cache/key'
+        ), 'key configure'
+
+        assert self.count('/one') == self.count('/two'), 'key'
+
+    def test_cache_chunked(self):
+        resp = self.check_cached(
+            '/chunked', **{'X-Length': '10000', 'X-Chunks': '5'}
+        )
+        assert resp['body'] == b'X' * 50000, 'chunked body'
+        assert resp['headers']['Content-Length'] == '50000', 'length'
+
+    def test_cache_max_entry_size(self):
+        assert 'success' in self.conf(
+            {"http": {"cache": {"max_entry_size": 1000}}}, 'settings'
+        ), 'settings configure'
+
+        self.check_cached('/?1000', **{'X-Length': '1000'})
+        self.check_cached('/?1001', cached=False, **{'X-Length': '1001'})
+        self.check_cached(
+            '/?chunks',
+            cached=False,
+            **{'X-Length': '300', 'X-Chunks': '4'}
+        )
+
+    def test_cache_max_size(self):
+        assert 'success' in self.conf(
+            {"http": {"cache": {"max_size": 30000}}}, 'settings'
+        ), 'settings configure'
+
+        headers = {'X-Length': '10000'}
+
+        count = self.count('/1', **headers)
+        self.count('/2', **headers)
+        self.count('/3', **headers)
+
+        assert self.count('/1', **headers) != count, 'evicted'
+        self.check_cached('/3', **headers)
+
+        self.check_cached('/big', cached=False, **{'X-Length': '40000'})
+
+    def test_cache_collapse(self):
+        socks = []
+
+        for _ in range(5):
+            _, sock = self.get(
+                url='/collapse',
+                headers={
+                    'Host': 'localhost',
+                    'X-Delay': '1',
+                    'Connection': 'close',
+                },
+                no_recv=True,
+                start=True,
+            )
+            socks.append(sock)
+
+        counts = set()
+
+        for sock in socks:
+            resp = self._resp_to_dict(self.recvall(sock).decode())
+            sock.close()
+
+            assert resp['status'] == 200, 'status'
+            counts.add(resp['headers']['X-Count'])
+
+        # Concurrent misses are collapsed across router threads.
+        assert len(counts) == 1, 'collapsed'
+
+    def test_cache_shared(self):
+        count = self.count('/shared')
+
+        for _ in range(10):
+            resp = self.get(
+                url='/shared',
+                headers={'Host': 'localhost', 'Connection': 'close'},
+            )
+            assert resp['headers']['X-Count'] == count, 'shared by threads'
+
+    def test_cache_path(self, temp_dir):
+        assert 'success' in self.conf(
+            {"http": {"cache": {"path": temp_dir}}}, 'settings'
+        ), 'settings configure'
+
+        headers = {'X-Length': '100000', 'X-Chunks': '3'}
+
+        resp = self.check_cached('/path', **headers)
+        assert resp['body'] == b'X' * 300000, 'file body'
+        assert resp['headers']['Content-Length'] == '300000', 'length'
+
+        assert not [
+            f for f in os.listdir(temp_dir) if f.startswith('cache-')
+        ], 'temporary files unlinked'
+
+        resp = self.get_cached('/path', method='HEAD', **headers)
+        assert resp['body'] == b'', 'HEAD from file'
+
+        self.check_cached('/path_small')
+
+    def test_cache_collapse_not_stored(self):
+        socks = []
+
+        for _ in range(3):
+            _, sock = self.get(
+                url='/collapse',
+                headers={
+                    'Host': 'localhost',
+                    'X-Delay': '0.5',
+                    'X-Cache-Control': 'no-store',
+                    'Connection': 'close',
+                },
+                no_recv=True,
+                start=True,
+            )
+            socks.append(sock)
+
+        for sock in socks:
+            resp = self._resp_to_dict(self.recvall(sock).decode())
+            sock.close()
+
+            assert resp['status'] == 200, 'waiting requests are passed'
+
+    def test_cache_lock_timeout(self):
+        assert 'success' in self.conf(
+            {"http": {"cache": {"lock_timeout": 1}}}, 'settings'
+        ), 'settings configure'
+
+        assert 'success' in self.conf(
+            '2', 'applications/cache/processes/max'
+        ), 'processes configure'
+
+        socks = []
+
+        for delay in ['3', '0']:
+            _, sock = self.get(
+                url='/lock',
+                headers={
+                    'Host': 'localhost',
+                    'X-Delay': delay,
+                    'Connection': 'close',
+                },
+                no_recv=True,
+                start=True,
+            )
+            socks.append(sock)
+
+            time.sleep(0.2)
+
+        start = time.time()
+
+        resp = self._resp_to_dict(self.recvall(socks[1]).decode())
+        assert resp['status'] == 200, 'timed out request status'
+        assert time.time() - start < 2.5, 'timed out request is passed'
+
+        resp_first = self._resp_to_dict(self.recvall(socks[0]).decode())
+        assert resp_first['status'] == 200, 'first request status'
+
+        for sock in socks:
+            sock.close()
+
+        assert (
+            self.count('/lock') == resp_first['headers']['X-Count']
+        ), 'stored by the first request'
+
+    def test_cache_pass(self):
+        assert 'success' in self.conf(
+            '2', 'applications/cache/processes/max'
+        ), 'processes configure'
+
+        headers = {'X-Cache-Control': 'no-store'}
+
+        self.check_cached('/pass', cached=False, **headers)
+
+        socks = []
+
+        start = time.time()
+
+        for _ in range(2):
+            _, sock = self.get(
+                url='/pass',
+                headers={
+                    'Host': 'localhost',
+                    'X-Delay': '1',
+                    'Connection': 'close',
+                    **headers,
+                },
+                no_recv=True,
+                start=True,
+            )
+            socks.append(sock)
+
+        for sock in socks:
+            resp = self._resp_to_dict(self.recvall(sock).decode())
+            sock.close()
+
+            assert resp['status'] == 200, 'status'
+
+        # A key that is known to be not stored is not waited for.
+        assert time.time() - start < 1.8, 'not serialized'
+
+    def test_cache_proxy(self):
+        resp = self.check_cached('/proxy')
+        assert resp['headers']['Content-Length'] == str(len(resp['body']))
+
+        self.check_cached(
+            '/proxy?chunked', **{'X-Length': '10000', 'X-Chunks': '3'}
+        )
+        self.check_cached(
+            '/proxy?no-store', cached=False, **{'X-Cache-Control': 'no-store'}
+        )
+
+    def test_cache_compress(self):
+        if not option.available['modules']['zlib']:
+            pytest.skip('zlib is not available')
+
+        assert 'success' in self.conf(
+            {}, 'routes/1/action/compress'
+        ), 'compress configure'
+
+        headers = {'X-Length': '1000', 'Accept-Encoding': 'gzip'}
+
+        resp = self.check_cached('/compress', **headers)
+        assert resp['headers']['Content-Encoding'] == 'gzip', 'gzip'
+        assert gzip.decompress(resp['body']) == b'X' * 1000, 'body'
+
+        resp = self.get_cached('/compress', **{'X-Length': '1000'})
+        assert 'Content-Encoding' not in resp['headers'], 'identity'
+        assert resp['body'] == b'X' * 1000, 'identity body'
+
+    def test_cache_invalid(self):
+        def check_error(cache):
+            assert 'error' in self.conf(
+                cache, 'routes/1/action/cache'
+            ), 'invalid cache'
+
+        check_error({"key": ""})
+        check_error({"key": "$blah"})
+        check_error({"key": 1})
+        check_error({"valid": -1})
+        check_error({"valid": "1"})
+        check_error({"blah": 1})
+        check_error('true')
+
+        assert 'error' in self.conf(
+            {"return": 200, "cache": {}}, 'routes/1/action'
+        ), 'return cache'
+
+        assert 'error' in self.conf(
+            {"http": {"cache": {"max_size": -1}}}, 'settings'
+        ), 'invalid max_size'
+        assert 'error' in self.conf(
+            {"http": {"cache": {"max_entry_size": "1"}}}, 'settings'
+        ), 'invalid max_entry_size'
+        assert 'error' in self.conf(
+            {"http": {"cache": {"path": 1}}}, 'settings'
+        ), 'invalid path'
@@ -0,0 +1,206 @@
+import gzip
+import zlib
+
+import pytest
+
+from unit.applications.lang.python import TestApplicationPython
+from unit.option import option
+
+
+class TestCompress(TestApplicationPython):
+    prerequisites = {'modules': {'python': 'any'}}
+
+    @pytest.fixture(autouse=True)
+    def setup_method_fixture(self):
+        if not option.available['modules']['zlib']:
+            pytest.skip('zlib is not available')
+
+        self.load('compress')
+
+        assert 'success' in self.conf(
+            [
+                {
+                    "match": {"uri": "/proxy"},
+                    "action": {
+                        "proxy": "http://127.0.0.1:7081",
+                        "compress": {"min_length": 100},
+                    },
+                },
+                {
+                    "action": {
+                        "pass": "applications/compress",
+                        "compress": {"min_length": 100},
+                    }
+                },
+            ],
+            'routes',
+        ), 'routes configure'
+
+        assert 'success' in self.conf(
+            {
+                "*:7080": {"pass": "routes"},
+                "*:7081": {"pass": "applications/compress"},
+            },
+            'listeners',
+        ), 'listeners configure'
+
+    def get_compressed(self, encoding='gzip', url='/', **headers):
+        headers = {
+            'Host': 'localhost',
+            'Accept-Encoding': encoding,
+            'Connection': 'close',
+            **headers,
+        }
+
+        return self.get_binary(url=url, headers=headers)
+
+    def get_binary(self, **kwargs):
+        resp = self._resp_to_dict(
+            self.get(encoding='latin-1', raw_resp=True, **kwargs)
+        )
+        resp['body'] = resp['body'].encode('latin-1')
+
+        if resp['headers'].get('Transfer-Encoding') == 'chunked':
+            resp['body'] = self._parse_chunked_body(resp['body'])
+
+        return resp
+
+    def check_gzip(self, resp, length):
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['Content-Encoding'] == 'gzip', 'encoding'
+        assert resp['headers']['Vary'] == 'Accept-Encoding', 'Vary'
+        assert 'Content-Length' not in resp['headers'], 'no Content-Length'
+        assert gzip.decompress(resp['body']) == b'X' * length, 'body'
+
+    def test_compress_gzip(self):
+        resp = self.get_compressed(**{'X-Length': '1000'})
+        self.check_gzip(resp, 1000)
+        assert resp['headers']['Transfer-Encoding'] == 'chunked', 'chunked'
+        assert len(resp['body']) < 1000, 'compressed'
+
+        self.check_gzip(self.get_compressed(**{'X-Length': '300000'}), 300000)
+
+    def test_compress_file_wrapper(self):
+        resp = self.get_compressed(
+            **{'X-Length': '100000', 'X-File-Wrapper': '1'}
+        )
+        self.check_gzip(resp, 100000)
+
+        resp = self.get_compressed(
+            **{'X-Length': '300000', 'X-File-Wrapper': '1'}
+        )
+        self.check_gzip(resp, 300000)
+
+    def test_compress_chunks(self):
+        resp = self.get_compressed(**{'X-Length': '10000', 'X-Chunks': '50'})
+        self.check_gzip(resp, 500000)
+
+    def test_compress_deflate(self):
+        resp = self.get_compressed('deflate', **{'X-Length': '1000'})
+        assert resp['headers']['Content-Encoding'] == 'deflate', 'encoding'
+        assert zlib.decompress(resp['body']) == b'X' * 1000, 'body'
+
+        resp = self.get_compressed('deflate, gzip', **{'X-Length': '1000'})
+        assert resp['headers']['Content-Encoding'] == 'gzip', 'prefer gzip'
+
+    def test_compress_not_accepted(self):
+        for encoding in ['br', 'gzip;q=0', 'identity']:
+            resp = self.get_compressed(encoding, **{'X-Length': '1000'})
+            assert 'Content-Encoding' not in resp['headers'], encoding
+            assert resp['headers']['Vary'] == 'Accept-Encoding', 'Vary'
+            assert resp['headers']['Content-Length'] == '1000', 'length'
+            assert resp['body'] == b'X' * 1000, 'body'
+
+    def test_compress_skip(self):
+        resp = self.get_compressed(**{'X-Length': '99'})
+        assert 'Content-Encoding' not in resp['headers'], 'min_length'
+        assert resp['body'] == b'X' * 99, 'min_length body'
+
+        resp = self.get_compressed(
+            **{'X-Length': '1000', 'X-Encoding': 'identity'}
+        )
+        assert resp['headers']['Content-Encoding'] == 'identity', 'encoded'
+        assert resp['body'] == b'X' * 1000, 'encoded body'
+
+        resp = self.get_compressed(**{'X-Length': '1000', 'X-Status': '404'})
+        assert resp['status'] == 404, 'status'
+        assert 'Content-Encoding' not in resp['headers'], 'status skip'
+
+        resp = self.head(
+            headers={
+                'Host': 'localhost',
+                'Accept-Encoding': 'gzip',
+                'X-Length': '1000',
+                'Connection': 'close',
+            }
+        )
+        assert 'Content-Encoding' not in resp['headers'], 'HEAD'
+
+    def test_compress_etag(self):
+        resp = self.get_compressed(
+            **{'X-Length': '1000', 'X-ETag': '"blah"'}
+        )
+        assert resp['headers']['ETag'] == 'W/"blah"', 'weak ETag'
+
+    def test_compress_types(self):
+        assert 'success' in self.conf(
+            ["text/*", "!text/css"], 'routes/1/action/compress/types'
+        ), 'types configure'
+
+        resp = self.get_compressed(
+            **{'X-Length': '1000', 'X-Type': 'text/html; charset=utf-8'}
+        )
+        self.check_gzip(resp, 1000)
+
+        for content_type in ['text/css', 'image/png']:
+            resp = self.get_compressed(
+                **{'X-Length': '1000', 'X-Type': content_type}
+            )
+            assert 'Content-Encoding' not in resp['headers'], content_type
+            assert 'Vary' not in resp['headers'], 'Vary'
+
+    def test_compress_level(self):
+        assert 'success' in self.conf(
+            '9', 'routes/1/action/compress/level'
+        ), 'level configure'
+
+        self.check_gzip(self.get_compressed(**{'X-Length': '1000'}), 1000)
+
+    def test_compress_proxy(self):
+        resp = self.get_compressed(url='/proxy', **{'X-Length': '1000'})
+        self.check_gzip(resp, 1000)
+
+        resp = self.get_compressed(
+            url='/proxy', **{'X-Length': '10000', 'X-Chunks': '50'}
+        )
+        self.check_gzip(resp, 500000)
+
+    def test_compress_http10(self):
+        resp = self.get_binary(
+            headers={
+                'Host': 'localhost',
+                'Accept-Encoding': 'gzip',
+                'X-Length': '1000',
+            },
+            http_10=True,
+        )
+        assert resp['headers']['Content-Encoding'] == 'gzip', 'encoding'
+        assert 'Transfer-Encoding' not in resp['headers'], 'not chunked'
+        assert gzip.decompress(resp['body']) == b'X' * 1000, 'body'
+
+    def test_compress_invalid(self):
+        def check_error(compress):
+            assert 'error' in self.conf(
+                compress, 'routes/1/action/compress'
+            ), 'invalid compress'
+
+        check_error({"level": 0})
+        check_error({"level": 10})
+        check_error({"min_length": -1})
+        check_error({"types": 1})
+        check_error({"blah": 1})
+        check_error('"gzip"')
+
+        assert 'error' in self.conf(
+            {"return": 200, "compress": {}}, 'routes/1/action'
+        ), 'return compress'
@@ -0,0 +1,528 @@
+import struct
+
+from unit.applications.http2 import TestApplicationHTTP2
+
+
+class TestHTTP2(TestApplicationHTTP2):
+    prerequisites = {'modules': {'python': 'any', 'openssl': 'any'}}
+
+    def http2(self, enabled=True):
+        assert 'success' in self.conf(
+            {'http': {'http2': enabled}}, 'settings'
+        ), 'http2'
+
+    def test_http2_get(self):
+        self.load('variables')
+        self.http2()
+
+        resp = self.h2_get(
+            url='/path?var=1',
+            headers=[('content-type', 'text/html'), ('custom-header', 'blah')],
+        )
+
+        assert resp['status'] == 200, 'status'
+        headers = resp['headers']
+        assert headers['server-protocol'] == 'HTTP/2.0', 'protocol'
+        assert headers['request-method'] == 'GET', 'method'
+        assert headers['request-uri'] == '/path?var=1', 'uri'
+        assert headers['http-host'] == 'localhost', 'authority'
+        assert headers['custom-header'] == 'blah', 'custom header'
+        assert 'connection' not in headers, 'no connection'
+
+    def test_http2_disabled(self):
+        self.load('empty')
+
+        sock = self.h2_connect()
+
+        resp = sock.recv(1024)
+        sock.close()
+
+        assert resp.startswith(b'HTTP/1.1 '), 'http/1'
+
+        assert self.get()['status'] == 200, 'http/1 get'
+
+    def test_http2_http1(self):
+        self.load('variables')
+        self.http2()
+
+        resp = self.get(
+            headers={
+                'Host': 'localhost',
+                'Content-Type': 'text/html',
+                'Custom-Header': 'blah',
+                'Connection': 'close',
+            }
+        )
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['Server-Protocol'] == 'HTTP/1.1', 'protocol'
+
+    def test_http2_post(self):
+        self.load('mirror')
+        self.http2()
+
+        body = '0123456789' * 500
+
+        sock = self.h2_connect()
+
+        self.h2_request(
+            sock,
+            method='POST',
+            headers=[('content-length', str(len(body)))],
+            body=body,
+        )
+
+        resp = self.h2_response(sock)
+        assert resp['status'] == 200, 'status'
+        assert resp['body'] == body.encode(), 'body'
+
+        sock.close()
+
+    def test_http2_post_no_length(self):
+        self.load('mirror')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        self.h2_request(sock, method='POST', body='abc' * 100)
+
+        resp = self.h2_response(sock)
+        assert resp['status'] == 200, 'status'
+        assert resp['body'] == b'abc' * 100, 'body'
+
+        sock.close()
+
+    def test_http2_post_frames(self):
+        self.load('mirror')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        self.h2_request(
+            sock,
+            method='POST',
+            headers=[('content-length', '20000')],
+            body=b'',
+        )
+
+        resp = self.h2_response(sock)
+        assert resp['status'] == 400, 'body ended early'
+
+        sock.close()
+
+        sock = self.h2_connect()
+
+        sock.sendall(
+            self.frame(
+                self.HEADERS,
+                self.END_HEADERS,
+                1,
+                self.hpack_encode(
+                    [
+                        (':method', 'POST'),
+                        (':scheme', 'http'),
+                        (':path', '/'),
+                        ('content-length', '20000'),
+                    ]
+                ),
+            )
+        )
+
+        for i in range(4):
+            sock.sendall(self.frame(self.DATA, 0, 1, b'x' * 5000))
+
+        sock.sendall(self.frame(self.DATA, self.END_STREAM, 1))
+
+        resp = self.h2_response(sock)
+        assert resp['status'] == 200, 'status'
+        assert resp['body'] == b'x' * 20000, 'body'
+
+        sock.close()
+
+    def test_http2_streams(self):
+        self.load('body_generate')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        for stream in [1, 3, 5]:
+            self.h2_request(
+                sock, stream=stream, headers=[('x-length', str(stream * 10))]
+            )
+
+        resp = {}
+        done = set()
+        while len(done) < 3:
+            frame = self.frame_read(sock)
+
+            if frame['type'] == self.DATA:
+                resp[frame['stream']] = resp.get(frame['stream'], b'')
+                resp[frame['stream']] += frame['payload']
+
+                if frame['flags'] & self.END_STREAM:
+                    done.add(frame['stream'])
+
+        for stream in [1, 3, 5]:
+            assert resp[stream] == b'X' * stream * 10, 'stream ' + str(stream)
+
+        sock.close()
+
+    def test_http2_flow_control(self):
+        self.load('body_generate')
+        self.http2()
+
+        sock = self.h2_connect(
+            settings={self.SETTINGS_INITIAL_WINDOW_SIZE: 1000}
+        )
+
+        self.h2_request(sock, headers=[('x-length', '100000')])
+
+        size = 0
+        while True:
+            frame = self.frame_read(sock, read_timeout=1)
+            if frame is None:
+                break
+
+            if frame['type'] == self.DATA:
+                size += len(frame['payload'])
+
+        assert size == 1000, 'stream window'
+
+        sock.sendall(self.window_update(1, 99000))
+
+        size = 0
+        while True:
+            frame = self.frame_read(sock, read_timeout=1)
+            if frame is None:
+                break
+
+            if frame['type'] == self.DATA:
+                size += len(frame['payload'])
+
+        assert size == 65535 - 1000, 'connection window'
+
+        sock.sendall(self.window_update(0, 100000))
+
+        resp = self.h2_response(sock)
+        assert len(resp['body']) == 100000 - 65535, 'rest'
+
+        sock.close()
+
+    def test_http2_receive_window(self):
+        self.load('mirror')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        sock.sendall(
+            self.frame(
+                self.HEADERS,
+                self.END_HEADERS,
+                1,
+                self.hpack_encode(
+                    [
+                        (':method', 'POST'),
+                        (':scheme', 'http'),
+                        (':path', '/'),
+                        ('content-length', '40000'),
+                    ]
+                ),
+            )
+        )
+
+        for i in range(8):
+            sock.sendall(self.frame(self.DATA, 0, 1, b'x' * 5000))
+
+        sock.sendall(self.frame(self.DATA, self.END_STREAM, 1))
+
+        updates = []
+
+        while True:
+            frame = self.frame_read(sock)
+
+            if frame['type'] == self.WINDOW_UPDATE:
+                updates.append(
+                    (frame['stream'], struct.unpack('!I', frame['payload'])[0])
+                )
+
+            if frame['type'] == self.DATA and frame['flags'] & self.END_STREAM:
+                break
+
+        # The windows are restored once half of them has been used.
+        assert updates == [(0, 35000), (1, 35000)], 'window updates'
+
+        sock.close()
+
+    def test_http2_stream_closed(self):
+        self.load('delayed')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        self.h2_request(sock, headers=[('x-delay', '1')])
+        sock.sendall(self.frame(self.DATA, 0, 1, b'x'))
+
+        resp = self.h2_response(sock)
+        assert resp['reset'] == self.STREAM_CLOSED, 'data after end stream'
+
+        self.h2_request(sock, stream=3)
+
+        resp = self.h2_response(sock, stream=3)
+        assert resp['status'] == 200, 'next stream'
+
+        sock.close()
+
+    def test_http2_rapid_reset(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [{"action": {"return": 200}}],
+                "applications": {},
+            }
+        )
+        self.http2()
+
+        sock = self.h2_connect()
+
+        frames = b''
+
+        # 129 streams, one more than the limit.
+        for stream in range(1, 259, 2):
+            frames += self.frame(
+                self.HEADERS,
+                self.END_HEADERS | self.END_STREAM,
+                stream,
+                self.hpack_encode(
+                    [
+                        (':method', 'GET'),
+                        (':scheme', 'http'),
+                        (':authority', 'localhost'),
+                        (':path', '/'),
+                    ]
+                ),
+            )
+            frames += self.frame(
+                self.RST_STREAM, 0, stream, struct.pack('!I', 0x8)
+            )
+
+        sock.sendall(frames)
+
+        goaway = None
+
+        while goaway is None:
+            frame = self.frame_read(sock)
+            assert frame is not None, 'connection closed'
+
+            if frame['type'] == self.GOAWAY:
+                goaway = struct.unpack('!II', frame['payload'][:8])
+
+        assert goaway[1] == self.ENHANCE_YOUR_CALM, 'goaway'
+
+        sock.close()
+
+    def test_http2_large(self):
+        self.load('body_generate')
+        self.http2()
+
+        resp = self.h2_get(headers=[('x-length', '3000000')])
+
+        assert resp['status'] == 200, 'status'
+        assert len(resp['body']) == 3000000, 'body'
+
+    def test_http2_ping(self):
+        self.load('empty')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        sock.sendall(self.frame(self.PING, payload=b'12345678'))
+
+        while True:
+            frame = self.frame_read(sock)
+
+            if frame['type'] == self.PING:
+                break
+
+        assert frame['flags'] & self.ACK, 'ack'
+        assert frame['payload'] == b'12345678', 'payload'
+
+        sock.close()
+
+    def test_http2_invalid_headers(self):
+        self.load('empty')
+        self.http2()
+
+        def check(headers):
+            return self.h2_get(headers=headers)['status']
+
+        assert check([('Custom', 'x')]) == 400, 'uppercase'
+        assert check([('connection', 'close')]) == 400, 'connection'
+        assert check([('te', 'gzip')]) == 400, 'te'
+        assert check([('te', 'trailers')]) == 200, 'te trailers'
+        assert check([(':unknown', 'x')]) == 400, 'pseudo-header'
+
+        sock = self.h2_connect()
+
+        sock.sendall(
+            self.frame(
+                self.HEADERS,
+                self.END_HEADERS | self.END_STREAM,
+                1,
+                self.hpack_encode([(':method', 'GET'), (':scheme', 'http')]),
+            )
+        )
+
+        assert self.h2_response(sock)['status'] == 400, 'no path'
+
+        sock.close()
+
+    def test_http2_cookies(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [
+                    {
+                        "match": {
+                            "cookies": {"var1": "val1", "var2": "val2"}
+                        },
+                        "action": {"return": 200},
+                    },
+                    {"action": {"return": 404}},
+                ],
+                "applications": {},
+            }
+        ), 'routes'
+        self.http2()
+
+        resp = self.h2_get(
+            headers=[('cookie', 'var1=val1'), ('cookie', 'var2=val2')]
+        )
+        assert resp['status'] == 200, 'cookies'
+
+        resp = self.h2_get(headers=[('cookie', 'var1=val1')])
+        assert resp['status'] == 404, 'cookie'
+
+    def test_http2_continuation(self):
+        self.load('variables')
+        self.http2()
+
+        block = self.hpack_encode(
+            [
+                (':method', 'GET'),
+                (':scheme', 'http'),
+                (':authority', 'localhost'),
+                (':path', '/'),
+                ('content-type', 'text/html'),
+                ('custom-header', 'x' * 20000),
+            ]
+        )
+
+        sock = self.h2_connect()
+
+        sock.sendall(
+            self.frame(self.HEADERS, self.END_STREAM, 1, block[:16000])
+            + self.frame(self.CONTINUATION, 0, 1, block[16000:17000])
+            + self.frame(self.CONTINUATION, self.END_HEADERS, 1, block[17000:])
+        )
+
+        resp = self.h2_response(sock)
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['custom-header'] == 'x' * 20000, 'header'
+
+        sock.close()
+
+    def test_http2_protocol_error(self):
+        self.load('empty')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        sock.sendall(self.frame(self.DATA, 0, 0, b'x'))
+
+        resp = self.h2_response(sock)
+        assert resp['goaway'][1] == self.PROTOCOL_ERROR, 'goaway'
+
+        sock.close()
+
+        sock = self.h2_connect()
+
+        sock.sendall(self.frame(self.PING, payload=b'x'))
+
+        resp = self.h2_response(sock)
+        assert resp['goaway'][1] == self.FRAME_SIZE_ERROR, 'frame size'
+
+        sock.close()
+
+        sock = self.h2_connect()
+
+        self.h2_request(sock, stream=2)
+
+        resp = self.h2_response(sock, stream=2)
+        assert resp['goaway'][1] == self.PROTOCOL_ERROR, 'even stream'
+
+        sock.close()
+
+    def test_http2_reset(self):
+        self.load('delayed')
+        self.http2()
+
+        sock = self.h2_connect()
+
+        self.h2_request(sock, headers=[('x-delay', '1')])
+        sock.sendall(
+            self.frame(self.RST_STREAM, 0, 1, struct.pack('!I', 0x8))
+        )
+
+        self.h2_request(sock, stream=3)
+
+        resp = self.h2_response(sock, stream=3)
+        assert resp['status'] == 200, 'next stream'
+
+        sock.close()
+
+    def test_http2_tls(self):
+        self.load('variables')
+        self.certificate()
+
+        assert 'success' in self.conf(
+            {
+                "pass": "applications/variables",
+                "tls": {"certificate": "default"},
+            },
+            'listeners/*:7080',
+        )
+
+        sock = self.h2_connect(tls=True, preface=False)
+        assert sock.selected_alpn_protocol() != 'h2', 'disabled'
+        sock.close()
+
+        self.http2()
+
+        sock = self.h2_connect(tls=True)
+        assert sock.selected_alpn_protocol() == 'h2', 'alpn'
+
+        self.h2_request(
+            sock,
+            headers=[('content-type', 'text/html'), ('custom-header', 'blah')],
+            scheme='https',
+        )
+
+        resp = self.h2_response(sock)
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['server-protocol'] == 'HTTP/2.0', 'protocol'
+        assert resp['headers']['wsgi-url-scheme'] == 'https', 'scheme'
+
+        sock.close()
+
+        self.context.set_alpn_protocols(['http/1.1'])
+
+        assert (
+            self.get_ssl(
+                headers={
+                    'Host': 'localhost',
+                    'Content-Type': 'text/html',
+                    'Custom-Header': 'blah',
+                    'Connection': 'close',
+                }
+            )['status']
+            == 200
+        ), 'http/1.1'
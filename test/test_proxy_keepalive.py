@@ -0,0 +1,261 @@
+import re
+import socket
+import threading
+import time
+
+import pytest
+
+from conftest import run_process
+from unit.applications.lang.python import TestApplicationPython
+from unit.utils import waitforsocket
+
+
+class TestProxyKeepalive(TestApplicationPython):
+    prerequisites = {'modules': {'python': 'any'}}
+
+    SERVER_PORT = 7999
+
+    @staticmethod
+    def run_server(server_port):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+
+        server_address = ('', server_port)
+        sock.bind(server_address)
+        sock.listen(10)
+
+        def response(status, fields, body=b''):
+            data = 'HTTP/1.1 ' + status + '\r\n'
+
+            for name, value in fields:
+                data += name + ': ' + value + '\r\n'
+
+            return data.encode() + b'\r\n' + body
+
+        def handle(connection, number):
+            data = b''
+            requests = 0
+            drop = False
+
+            while True:
+                while b'\r\n\r\n' not in data:
+                    part = connection.recv(4096)
+
+                    if not part:
+                        connection.close()
+                        return
+
+                    data += part
+
+                if drop:
+                    connection.close()
+                    return
+
+                header, data = data.split(b'\r\n\r\n', 1)
+                header = header.decode()
+
+                m = re.search(r'Content-Length: (\d+)', header)
+                length = int(m.group(1)) if m else 0
+
+                while len(data) < length:
+                    data += connection.recv(4096)
+
+                data = data[length:]
+
+                requests += 1
+
+                method, uri = header.split(' ')[:2]
+
+                m = re.search(r'\r\nConnection: ([^\r]+)', header)
+                upstream_connection = m.group(1) if m else 'none'
+
+                body = str(number).encode()
+
+                fields = [
+                    ('X-Connection', str(number)),
+                    ('X-Requests', str(requests)),
+                    ('X-Upstream-Connection', upstream_connection),
+                ]
+
+                if uri == '/delay':
+                    time.sleep(0.5)
+
+                if uri == '/close':
+                    fields.append(('Connection', 'close'))
+
+                if uri == '/chunked':
+                    fields.append(('Transfer-Encoding', 'chunked'))
+                    body = b'1\r\n' + body[:1] + b'\r\n0\r\n\r\n'
+
+                elif uri == '/eof':
+                    pass
+
+                elif uri == '/204':
+                    connection.sendall(response('204 No Content', fields))
+                    continue
+
+                else:
+                    fields.append(('Content-Length', str(len(body))))
+
+                if method == 'HEAD':
+                    body = b''
+
+                connection.sendall(response('200 OK', fields, body))
+
+                if uri in ['/close', '/eof']:
+                    connection.close()
+                    return
+
+                if uri == '/drop':
+                    # The next request is read, but the connection is closed.
+                    drop = True
+
+        number = 0
+
+        while True:
+            connection, _ = sock.accept()
+
+            number += 1
+
+            threading.Thread(
+                target=handle, args=(connection, number), daemon=True
+            ).start()
+
+    def setup_method(self):
+        run_process(self.run_server, self.SERVER_PORT)
+        waitforsocket(self.SERVER_PORT)
+
+        assert 'success' in self.conf(
+            {
+                "settings": {"http": {"proxy": {"keepalive": 8}}},
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [
+                    {
+                        "action": {
+                            "proxy": "http://127.0.0.1:"
+                            + str(self.SERVER_PORT)
+                        }
+                    }
+                ],
+                "applications": {},
+            }
+        ), 'proxy keepalive configuration'
+
+    def get_connection(self, url='/', method='GET'):
+        resp = self.http(method, url=url, headers={
+            'Host': 'localhost',
+            'Connection': 'close',
+        })
+        assert resp['status'] in [200, 204], 'status'
+
+        return resp['headers']['X-Connection']
+
+    def test_proxy_keepalive(self):
+        resp = self.get()
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['X-Upstream-Connection'] == 'none', 'no close'
+
+        connection = resp['headers']['X-Connection']
+        assert resp['body'] == connection, 'body'
+
+        for requests in range(2, 5):
+            resp = self.get()
+            assert resp['headers']['X-Connection'] == connection, 'reused'
+            assert resp['headers']['X-Requests'] == str(requests), 'requests'
+            assert resp['body'] == connection, 'reused body'
+
+    def test_proxy_keepalive_disabled(self):
+        assert 'success' in self.conf_delete('settings/http/proxy/keepalive')
+
+        resp = self.get()
+        assert resp['headers']['X-Upstream-Connection'] == 'close', 'close'
+
+        assert self.get_connection() != resp['headers']['X-Connection']
+
+    def test_proxy_keepalive_close(self):
+        connection = self.get_connection('/close')
+        assert self.get_connection() != connection, 'Connection: close'
+
+        connection = self.get_connection('/eof')
+        assert self.get_connection() != connection, 'EOF'
+
+    def test_proxy_keepalive_no_body(self):
+        connection = self.get_connection('/204')
+        assert self.get_connection() == connection, '204'
+
+        assert self.get_connection(method='HEAD') == connection, 'HEAD'
+        assert self.get_connection() == connection, 'HEAD reused'
+
+    def test_proxy_keepalive_chunked(self):
+        resp = self.get(url='/chunked')
+        assert resp['status'] == 200, 'status'
+
+        connection = resp['headers']['X-Connection']
+        assert resp['body'] == connection[:1], 'chunked body'
+
+        assert self.get_connection() == connection, 'chunked reused'
+
+    def test_proxy_keepalive_post(self):
+        connection = self.get_connection()
+
+        resp = self.post(body='X' * 10000)
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['X-Connection'] == connection, 'POST reused'
+
+        assert self.get_connection() == connection, 'POST'
+
+    def test_proxy_keepalive_stale(self):
+        connection = self.get_connection('/drop')
+
+        resp = self.get()
+        assert resp['status'] == 200, 'retried'
+        assert resp['headers']['X-Connection'] != connection, 'new connection'
+
+    def test_proxy_keepalive_timeout(self):
+        assert 'success' in self.conf(
+            '1', 'settings/http/proxy/keepalive_timeout'
+        ), 'timeout configure'
+
+        connection = self.get_connection()
+        assert self.get_connection() == connection, 'reused'
+
+        time.sleep(1.5)
+
+        assert self.get_connection() != connection, 'timed out'
+
+    def test_proxy_keepalive_max(self):
+        assert 'success' in self.conf(
+            '1', 'settings/http/proxy/keepalive'
+        ), 'keepalive configure'
+
+        def parallel():
+            socks = []
+
+            for _ in range(2):
+                _, sock = self.get(url='/delay', no_recv=True, start=True)
+                socks.append(sock)
+
+            connections = set()
+
+            for sock in socks:
+                resp = self._resp_to_dict(self.recvall(sock).decode())
+                sock.close()
+
+                connections.add(resp['headers']['X-Connection'])
+
+            return connections
+
+        first = parallel()
+        assert len(first) == 2, 'two connections'
+
+        second = parallel()
+        assert len(first & second) == 1, 'one connection is kept'
+
+    def test_proxy_keepalive_invalid(self):
+        def check_error(conf):
+            assert 'error' in self.conf(conf, 'settings/http/proxy')
+
+        check_error({"keepalive": "1"})
+        check_error({"keepalive_timeout": "1"})
+        check_error({"blah": 1})
+        check_error('1')
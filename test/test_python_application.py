@@ -7,6 +7,7 @@ import time
 import pytest
 
 from unit.applications.lang.python import TestApplicationPython
+from unit.option import option
 
 
 class TestPythonApplication(TestApplicationPython):
@@ -362,6 +363,98 @@ Connection: close
 
         self.get(headers=headers_delay_1)
 
+    def test_python_application_queue_limit(self):
+        self.load('delayed', processes=1, limits={"queue": 1})
+
+        headers_delay = {
+            'Host': 'localhost',
+            'X-Delay': '2',
+            'Connection': 'close',
+        }
+
+        (_, sock) = self.get(headers=headers_delay, start=True, no_recv=True)
+
+        time.sleep(0.5)
+
+        (_, sock2) = self.get(headers=headers_delay, start=True, no_recv=True)
+
+        time.sleep(0.5)
+
+        resp = self.get()
+        assert resp['status'] == 503, 'queue limit'
+        assert resp['headers']['Retry-After'] == '1', 'queue limit retry'
+
+        assert self.recvall(sock).decode().startswith('HTTP/1.1 200')
+        assert self.recvall(sock2).decode().startswith('HTTP/1.1 200')
+
+        sock.close()
+        sock2.close()
+
+        assert self.get()['status'] == 200, 'queue limit free'
+
+    def test_python_application_queue_timeout(self):
+        self.load('delayed', processes=1, limits={"queue_timeout": 1})
+
+        (_, sock) = self.get(
+            headers={
+                'Host': 'localhost',
+                'X-Delay': '3',
+                'Connection': 'close',
+            },
+            start=True,
+            no_recv=True,
+        )
+
+        time.sleep(0.5)
+
+        resp = self.get()
+        assert resp['status'] == 503, 'queue timeout'
+        assert resp['headers']['Retry-After'] == '1', 'queue timeout retry'
+
+        assert self.recvall(sock).decode().startswith('HTTP/1.1 200')
+
+        sock.close()
+
+        assert self.get()['status'] == 200, 'queue timeout free'
+
+        assert (
+            self.wait_for_record(r'request queue timeout expired') is not None
+        ), 'queue timeout log'
+
+    def test_python_application_queue_timeout_limits_timeout(self):
+        self.load(
+            'delayed', processes=1, limits={"timeout": 4, "queue_timeout": 2}
+        )
+
+        def headers(delay):
+            return {
+                'Host': 'localhost',
+                'X-Delay': delay,
+                'Connection': 'close',
+            }
+
+        def delayed(delay):
+            return self.get(headers=headers(delay), start=True, no_recv=True)[1]
+
+        sock = delayed('3')
+        time.sleep(0.5)
+
+        resp = self.get(headers=headers('2'))
+        assert resp['status'] == 503, 'queue timeout'
+        assert resp['headers']['Retry-After'] == '2', 'queue timeout retry'
+
+        assert self.recvall(sock).decode().startswith('HTTP/1.1 200')
+        sock.close()
+
+        sock = delayed('2')
+        time.sleep(0.5)
+
+        resp = self.get(headers=headers('3'))
+        assert resp['status'] == 200, 'queue wait is not processing time'
+
+        assert self.recvall(sock).decode().startswith('HTTP/1.1 200')
+        sock.close()
+
     @pytest.mark.skip('not yet')
     def test_python_application_start_response_exit(self):
         self.load('start_response_exit')
@@ -508,6 +601,37 @@ last line: 987654321
 
         assert self.get()['body'] == 'body\n', 'body io file'
 
+    def test_python_application_file_wrapper(self):
+        self.load('file_wrapper')
+
+        body = ''.join(str(i % 10) for i in range(300000))
+
+        with open(option.temp_dir + '/file', 'w') as f:
+            f.write(body)
+
+        def get(**headers):
+            return self.get(
+                headers={
+                    'Host': 'localhost',
+                    'X-File': option.temp_dir + '/file',
+                    'Connection': 'close',
+                    **headers,
+                }
+            )
+
+        resp = get()
+        assert resp['status'] == 200, 'file wrapper status'
+        assert resp['body'] == body, 'file wrapper'
+
+        resp = get(**{'X-Offset': '1000'})
+        assert resp['body'] == body[1000:], 'file wrapper offset'
+
+        resp = get(**{'X-Offset': '10', 'X-Length': '5000'})
+        assert resp['body'] == body[10:5010], 'file wrapper length'
+
+        resp = get(**{'X-Memory': '0123456789'})
+        assert resp['body'] == '0123456789', 'file wrapper not a file'
+
     @pytest.mark.skip('not yet')
     def test_python_application_syntax_error(self, skip_alert):
         skip_alert(r'Python failed to import module "wsgi"')
@@ -522,6 +646,30 @@ last line: 987654321
 
         assert self.get()['status'] == 503, 'loading error'
 
+    def test_python_application_loading_error_queued(self, skip_alert):
+        skip_alert(r'Python failed to import module "blah"')
+
+        self.load(
+            'empty',
+            module="blah",
+            processes={"spare": 0, "max": 2},
+        )
+
+        socks = []
+        for _ in range(4):
+            (_, sock) = self.get(
+                headers={'Host': 'localhost', 'Connection': 'close'},
+                start=True,
+                no_recv=True,
+            )
+            socks.append(sock)
+
+        for sock in socks:
+            assert self.recvall(sock).decode().startswith(
+                'HTTP/1.1 503'
+            ), 'queued loading error'
+            sock.close()
+
     def test_python_application_close(self):
         self.load('close')
 
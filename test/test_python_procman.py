@@ -114,6 +114,63 @@ class TestPythonProcman(TestApplicationPython):
 
         self.stop_all()
 
+    def scaling_load(self, scaling):
+        self.load('delayed', self.app_name)
+        self.conf_proc(
+            {"spare": 0, "max": 4, "idle_timeout": 1, "scaling": scaling}
+        )
+
+        assert len(self.pids_for_process()) == 0, 'scaling 0'
+
+        socks = []
+        for _ in range(3):
+            (_, sock) = self.get(
+                headers={
+                    'Host': 'localhost',
+                    'X-Delay': '2',
+                    'Connection': 'close',
+                },
+                start=True,
+                no_recv=True,
+            )
+            socks.append(sock)
+
+        for sock in socks:
+            assert self.recvall(sock).decode().startswith('HTTP/1.1 200')
+            sock.close()
+
+        assert len(self.pids_for_process()) >= 2, 'scaling up'
+
+        # The load has dropped more than idle_timeout ago.
+
+        time.sleep(1.3)
+
+        return len(self.pids_for_process())
+
+    def test_python_scaling_reactive(self):
+        assert self.scaling_load('reactive') == 0, 'reactive scale down'
+
+        self.stop_all()
+
+    def test_python_scaling_predictive(self):
+        # Unlike the reactive policy, the target is lowered only after
+        # the demand average has stayed lower during idle_timeout.
+
+        assert self.scaling_load('predictive') >= 1, 'predictive hysteresis'
+
+        for _ in range(75):
+            if len(self.pids_for_process()) == 0:
+                break
+
+        assert len(self.pids_for_process()) == 0, 'predictive scale down'
+
+        self.stop_all()
+
+    def test_python_scaling_invalid(self):
+        assert 'error' in self.conf(
+            {"spare": 0, "max": 4, "scaling": "blah"}, self.app_proc
+        ), 'invalid scaling'
+
     def test_python_reconfigure(self):
         self.conf_proc({"spare": 2, "max": 6, "idle_timeout": 1})
 
@@ -0,0 +1,119 @@
+import re
+import subprocess
+import time
+
+from unit.applications.lang.python import TestApplicationPython
+from unit.option import option
+
+
+class TestPythonPrototype(TestApplicationPython):
+    prerequisites = {'modules': {'python': 'any'}}
+
+    def setup_method(self):
+        self.app_name = "app-" + option.temp_dir.split('/')[-1]
+        self.app_proc = 'applications/' + self.app_name + '/processes'
+
+    def pids_for_process(self, kind='application'):
+        time.sleep(0.2)
+
+        output = subprocess.check_output(['ps', 'ax'])
+
+        pids = set()
+        for m in re.findall(
+            '.*"' + self.app_name + '" ' + kind, output.decode()
+        ):
+            pids.add(re.search(r'^\s*(\d+)', m).group(1))
+
+        return pids
+
+    def load_prototype(self, prototype, processes=None):
+        if processes is None:
+            processes = {"spare": 0, "max": 4, "idle_timeout": 1}
+
+        self.load(
+            'prototype',
+            name=self.app_name,
+            prototype=prototype,
+            processes=processes,
+        )
+
+    def get_pids(self):
+        resp = self.get()
+        assert resp['status'] == 200, 'status'
+
+        return resp['headers']['X-Pid'], resp['headers']['X-Import-Pid']
+
+    def test_python_prototype(self):
+        self.load_prototype({})
+
+        assert len(self.pids_for_process('prototype')) == 0, 'no prototype'
+
+        pid, import_pid = self.get_pids()
+        assert pid == import_pid, 'imported in process'
+
+        protos = self.pids_for_process('prototype')
+        assert len(protos) == 1, 'prototype'
+        assert pid not in protos, 'process is not prototype'
+        assert self.pids_for_process() == {pid}, 'process'
+
+        time.sleep(1)
+
+        assert len(self.pids_for_process()) == 0, 'process idle'
+        assert len(self.pids_for_process('prototype')) == 0, 'prototype exit'
+
+        assert self.get_pids()[0] != pid, 'new process'
+
+    def test_python_prototype_preload(self):
+        self.load_prototype({"preload": True})
+
+        pid, import_pid = self.get_pids()
+
+        protos = self.pids_for_process('prototype')
+        assert protos == {import_pid}, 'imported in prototype'
+        assert pid != import_pid, 'process forked'
+
+    def test_python_prototype_processes(self):
+        self.load_prototype({"preload": True}, processes=3)
+
+        pids = self.pids_for_process()
+        assert len(pids) == 3, 'processes'
+        assert len(self.pids_for_process('prototype')) == 1, 'one prototype'
+
+        for _ in range(10):
+            pid, import_pid = self.get_pids()
+            assert pid in pids, 'process pid'
+            assert import_pid not in pids, 'prototype import'
+
+        assert 'success' in self.conf('5', self.app_proc), 'scale up'
+
+        assert len(self.pids_for_process()) == 5, 'scaled processes'
+        assert len(self.pids_for_process('prototype')) == 1, 'same prototype'
+
+    def test_python_prototype_restart(self):
+        self.load_prototype({"preload": True}, processes=2)
+
+        protos = self.pids_for_process('prototype')
+        assert len(protos) == 1, 'prototype'
+
+        assert 'success' in self.conf_get(
+            '/control/applications/' + self.app_name + '/restart'
+        ), 'restart processes'
+
+        time.sleep(0.5)
+
+        new_protos = self.pids_for_process('prototype')
+        assert len(new_protos) == 1, 'new prototype'
+        assert new_protos != protos, 'prototype restarted'
+        assert len(self.pids_for_process()) == 2, 'processes restarted'
+
+        assert self.get_pids()[1] in new_protos, 'new prototype import'
+
+    def test_python_prototype_invalid(self):
+        self.load('empty', name=self.app_name)
+
+        path = 'applications/' + self.app_name + '/prototype'
+
+        assert 'error' in self.conf('"yes"', path), 'string'
+        assert 'error' in self.conf({"preload": 1}, path), 'preload integer'
+        assert 'error' in self.conf({"blah": True}, path), 'unknown member'
+        assert 'success' in self.conf({"preload": False}, path), 'valid'
@@ -0,0 +1,65 @@
+import socket
+
+from unit.applications.proto import TestApplicationProto
+
+
+class TestReuseport(TestApplicationProto):
+    prerequisites = {}
+
+    def setup_method(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {
+                    "*:7080": {"pass": "routes", "reuseport": True},
+                },
+                "routes": [{"action": {"return": 200}}],
+                "applications": {},
+            }
+        ), 'reuseport configuration'
+
+    def test_reuseport(self):
+        for _ in range(50):
+            assert self.get()['status'] == 200, 'reuseport request'
+
+    def bind_reuseport(self, port):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+
+        try:
+            sock.bind(('127.0.0.1', port))
+            return True
+
+        except OSError:
+            return False
+
+        finally:
+            sock.close()
+
+    def test_reuseport_option(self):
+        assert self.bind_reuseport(7080), 'SO_REUSEPORT set'
+
+        assert 'success' in self.conf(
+            {"pass": "routes"}, 'listeners/*:7081'
+        ), 'plain listener'
+
+        assert not self.bind_reuseport(7081), 'SO_REUSEPORT not set'
+
+    def test_reuseport_reconfigure(self):
+        assert 'success' in self.conf(
+            {"*:7081": {"pass": "routes", "reuseport": True}}, 'listeners'
+        ), 'replace listener'
+
+        assert self.get(port=7081)['status'] == 200, 'new listener'
+
+        assert 'success' in self.conf(
+            {"pass": "routes", "reuseport": False}, 'listeners/*:7082'
+        ), 'reuseport disabled'
+
+        assert self.get(port=7082)['status'] == 200, 'disabled listener'
+        assert self.get(port=7081)['status'] == 200, 'listener still alive'
+
+        assert 'success' in self.conf({}, 'listeners'), 'remove listeners'
+
+    def test_reuseport_invalid(self):
+        assert 'error' in self.conf('"true"', 'listeners/*:7080/reuseport')
+        assert 'error' in self.conf('1', 'listeners/*:7080/reuseport')
@@ -1,9 +1,11 @@
+import os
 import re
 import socket
 import time
 
 import pytest
 
+from conftest import pid_by_name
 from unit.applications.lang.python import TestApplicationPython
 from unit.utils import sysctl
 
@@ -56,6 +58,7 @@ Connection: close
 """,
             start=True,
             raw=True,
+            raw_resp=True,
             no_recv=True,
         )
 
@@ -349,3 +352,289 @@ Connection: close
         assert bool(resp), 'response from application 4'
         assert resp['status'] == 200, 'status 4'
         assert resp['body'] == body, 'body 4'
+
+    def test_settings_body_streaming(self):
+        self.load('mirror')
+
+        assert 'success' in self.conf(
+            {'http': {'body_buffer_size': 1024, 'body_streaming': True}},
+            'settings',
+        )
+
+        body = '0123456789abcdef'
+        resp = self.post(body=body)
+        assert resp['status'] == 200, 'status small'
+        assert resp['body'] == body, 'body small'
+
+        for size in [1025, 64 * 1024, 4 * 1024 * 1024]:
+            body = ('0123456789abcdef' * (size // 16 + 1))[:size]
+            resp = self.post(body=body, read_buffer_size=1024 * 1024)
+            assert resp['status'] == 200, 'status ' + str(size)
+            assert resp['body'] == body, 'body ' + str(size)
+
+        body = '0123456789abcdef' * 1024
+        (resp, sock) = self.post(
+            headers={'Host': 'localhost', 'Connection': 'keep-alive'},
+            body=body,
+            start=True,
+            read_timeout=1,
+        )
+        assert resp['body'] == body, 'body keepalive'
+
+        resp = self.post(sock=sock, body=body)
+        assert resp['status'] == 200, 'status keepalive 2'
+        assert resp['body'] == body, 'body keepalive 2'
+
+    def test_settings_body_streaming_slow(self):
+        self.load('mirror')
+
+        assert 'success' in self.conf(
+            {'http': {'body_buffer_size': 16, 'body_streaming': True}},
+            'settings',
+        )
+
+        (_, sock) = self.http(
+            b"""POST / HTTP/1.1
+Host: localhost
+Content-Length: 40
+Connection: close
+
+0123456789""",
+            start=True,
+            raw=True,
+            no_recv=True,
+        )
+
+        time.sleep(0.5)
+
+        sock.sendall(b'0123456789')
+
+        time.sleep(0.5)
+
+        resp = self.http(b'01234567890123456789', sock=sock, raw=True)
+        assert resp['status'] == 200, 'status slow'
+        assert resp['body'] == '0123456789' * 4, 'body slow'
+
+    def test_settings_body_streaming_unread(self):
+        self.load('empty')
+
+        assert 'success' in self.conf(
+            {'http': {'body_buffer_size': 16, 'body_streaming': True}},
+            'settings',
+        )
+
+        resp = self.http(
+            b"""POST / HTTP/1.1
+Host: localhost
+Content-Length: 1000000
+
+0123456789""",
+            raw=True,
+            read_timeout=1,
+        )
+        assert resp['status'] == 200, 'response before body'
+        assert resp['headers']['Connection'] == 'close', 'no keepalive'
+
+    def test_settings_body_streaming_proxy(self):
+        self.load('mirror')
+
+        assert 'success' in self.conf(
+            {
+                "listeners": {
+                    "*:7080": {"pass": "routes"},
+                    "*:7081": {"pass": "applications/mirror"},
+                },
+                "routes": [{"action": {"proxy": "http://127.0.0.1:7081"}}],
+                "applications": self.conf_get('applications'),
+                "settings": {
+                    "http": {"body_buffer_size": 1024, "body_streaming": True}
+                },
+            }
+        )
+
+        body = '0123456789abcdef' * 64 * 1024
+        resp = self.post(body=body, read_buffer_size=1024 * 1024)
+        assert resp['status'] == 200, 'status proxy'
+        assert resp['body'] == body, 'body proxy'
+
+    def post_chunked(self, chunks, **kwargs):
+        body = b''.join(
+            b'%x\r\n%s\r\n' % (len(chunk), chunk) for chunk in chunks
+        )
+
+        return self.http(
+            b"""POST / HTTP/1.1
+Host: localhost
+Transfer-Encoding: chunked
+Connection: close
+
+"""
+            + body
+            + b'0\r\n\r\n',
+            raw=True,
+            **kwargs,
+        )
+
+    def test_settings_body_chunked(self):
+        self.load('mirror')
+
+        assert 'success' in self.conf(
+            {'http': {'body_buffer_size': 1024}}, 'settings'
+        )
+
+        resp = self.post_chunked([b'0123456789', b'abcdef'])
+        assert resp['status'] == 200, 'status'
+        assert resp['body'] == '0123456789abcdef', 'body'
+
+        resp = self.post_chunked([])
+        assert resp['status'] == 200, 'status empty'
+        assert resp['body'] == '', 'body empty'
+
+        chunks = [b'0123456789abcdef' * 1024] * 64
+        resp = self.post_chunked(chunks, read_buffer_size=1024 * 1024)
+        assert resp['status'] == 200, 'status file'
+        assert resp['body'] == (b''.join(chunks)).decode(), 'body file'
+
+        assert 'success' in self.conf(
+            {'http': {'body_buffer_size': 1024, 'body_streaming': True}},
+            'settings',
+        )
+
+        resp = self.post_chunked(chunks, read_buffer_size=1024 * 1024)
+        assert resp['status'] == 200, 'status streaming'
+        assert resp['body'] == (b''.join(chunks)).decode(), 'body streaming'
+
+    def test_settings_body_chunked_slow(self):
+        self.load('mirror')
+
+        (_, sock) = self.http(
+            b"""POST / HTTP/1.1
+Host: localhost
+Transfer-Encoding: chunked
+
+5\r
+01""",
+            start=True,
+            raw=True,
+            no_recv=True,
+        )
+
+        for part in [b'234\r', b'\na\r\n0123456789', b'\r\n0\r', b'\n']:
+            time.sleep(0.2)
+            sock.sendall(part)
+
+        time.sleep(0.2)
+
+        resp = self.http(
+            b"""\r
+GET / HTTP/1.1
+Host: localhost
+Connection: close
+
+""",
+            sock=sock,
+            raw=True,
+            raw_resp=True,
+        )
+
+        assert resp.count('HTTP/1.1 200') == 2, 'pipelined'
+        assert '012340123456789' in resp, 'body slow'
+
+    def test_settings_body_chunked_invalid(self):
+        self.load('mirror')
+
+        assert 'success' in self.conf(
+            {'http': {'max_body_size': 1024}}, 'settings'
+        )
+
+        resp = self.http(
+            b"""POST / HTTP/1.1
+Host: localhost
+Transfer-Encoding: chunked
+Connection: close
+
+x\r
+0\r
+\r
+""",
+            raw=True,
+        )
+        assert resp['status'] == 400, 'invalid chunk'
+
+        resp = self.http(
+            b"""POST / HTTP/1.1
+Host: localhost
+Transfer-Encoding: chunked
+Content-Length: 5
+Connection: close
+
+5\r
+01234\r
+0\r
+\r
+""",
+            raw=True,
+        )
+        assert resp['status'] == 400, 'content length and chunked'
+
+        resp = self.post_chunked([b'0123456789abcdef'] * 65)
+        assert resp['status'] == 413, 'too large'
+
+    def test_settings_body_streaming_invalid(self):
+        assert 'error' in self.conf(
+            {'http': {'body_streaming': 1}}, 'settings'
+        ), 'body streaming not boolean'
+
+    def router_threads_cpus(self):
+        router_pid = pid_by_name('unit: router')
+
+        cpus = []
+        for tid in os.listdir('/proc/' + router_pid + '/task'):
+            with open('/proc/%s/task/%s/status' % (router_pid, tid)) as f:
+                cpus.extend(
+                    re.findall(r'Cpus_allowed_list:\s+(\S+)', f.read())
+                )
+
+        return cpus
+
+    def test_settings_router_cpu_affinity(self):
+        if not os.path.exists('/proc/self/status'):
+            pytest.skip('requires procfs')
+
+        self.load('empty')
+
+        cpus = set(self.router_threads_cpus())
+
+        assert 'success' in self.conf(
+            {"router": {"cpu_affinity": [0], "numa": True}}, 'settings'
+        ), 'cpu affinity'
+
+        assert self.get()['status'] == 200, 'pinned engines'
+        assert '0' in self.router_threads_cpus(), 'pinned thread'
+
+        assert 'success' in self.conf(
+            {"pass": "applications/empty", "reuseport": True},
+            'listeners/*:7081',
+        ), 'steered listener'
+
+        for _ in range(10):
+            assert self.get(port=7081)['status'] == 200, 'steered connections'
+
+        assert 'success' in self.conf_delete('settings/router'), 'unpin'
+        assert self.get()['status'] == 200, 'unpinned engines'
+        assert set(self.router_threads_cpus()) == cpus, 'restored affinity'
+
+    def test_settings_router_invalid(self):
+        def check_error(conf):
+            assert 'error' in self.conf({"router": conf}, 'settings')
+
+        assert 'success' in self.conf(
+            {"router": {"cpu_affinity": [0], "numa": False}}, 'settings'
+        ), 'valid settings'
+
+        check_error({"cpu_affinity": 0})
+        check_error({"cpu_affinity": ["0"]})
+        check_error({"cpu_affinity": [-1]})
+        check_error({"cpu_affinity": [1024]})
+        check_error({"numa": 1})
+        check_error({"blah": True})
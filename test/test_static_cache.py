@@ -0,0 +1,113 @@
+import os
+import time
+from pathlib import Path
+
+import pytest
+
+from unit.applications.proto import TestApplicationProto
+
+
+class TestStaticCache(TestApplicationProto):
+    prerequisites = {}
+
+    @pytest.fixture(autouse=True)
+    def setup_method_fixture(self, temp_dir):
+        os.makedirs(temp_dir + '/assets/dir')
+        Path(temp_dir + '/assets/index.html').write_text('0123456789')
+        Path(temp_dir + '/assets/file').write_text('blah')
+
+        self._load_conf(
+            {
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [{"action": {"share": temp_dir + "/assets"}}],
+                "settings": {
+                    "http": {
+                        "static": {
+                            "open_file_cache": {
+                                "max": 10,
+                                "valid": 1,
+                                "inactive": 1,
+                            }
+                        }
+                    }
+                },
+            }
+        )
+
+    def set_cache(self, cache):
+        assert 'success' in self.conf(
+            cache, 'settings/http/static/open_file_cache'
+        ), 'open_file_cache configure'
+
+    def test_static_cache(self):
+        for _ in range(3):
+            resp = self.get()
+            assert resp['status'] == 200, 'status'
+            assert resp['body'] == '0123456789', 'body'
+
+            assert self.get(url='/file')['body'] == 'blah', 'file'
+            assert self.get(url='/dir')['status'] == 301, 'dir'
+            assert self.get(url='/blah')['status'] == 404, 'not found'
+
+        assert self.head()['headers']['Content-Length'] == '10', 'HEAD'
+
+    def test_static_cache_max(self, temp_dir):
+        self.set_cache({"max": 1, "inactive": 1})
+
+        for _ in range(2):
+            assert self.get()['body'] == '0123456789', 'index'
+            assert self.get(url='/file')['body'] == 'blah', 'file'
+
+    def test_static_cache_valid(self, temp_dir):
+        assert self.get(url='/file')['status'] == 200, 'cached'
+
+        os.remove(temp_dir + '/assets/file')
+
+        assert self.get(url='/file')['body'] == 'blah', 'still cached'
+
+        time.sleep(1.2)
+
+        assert self.get(url='/file')['status'] == 404, 'revalidated'
+
+    def test_static_cache_errors(self, temp_dir):
+        assert self.get(url='/new')['status'] == 404, 'not found'
+
+        Path(temp_dir + '/assets/new').write_text('new')
+
+        assert self.get(url='/new')['body'] == 'new', 'errors not cached'
+
+        self.set_cache({"valid": 1, "inactive": 1, "errors": True})
+
+        assert self.get(url='/new2')['status'] == 404, 'not found errors'
+
+        Path(temp_dir + '/assets/new2').write_text('new2')
+
+        assert self.get(url='/new2')['status'] == 404, 'error cached'
+
+        time.sleep(1.2)
+
+        assert self.get(url='/new2')['body'] == 'new2', 'error revalidated'
+
+    def test_static_cache_range(self):
+        for _ in range(2):
+            resp = self.get(
+                headers={
+                    'Host': 'localhost',
+                    'Range': 'bytes=2-5',
+                    'Connection': 'close',
+                }
+            )
+            assert resp['status'] == 206, 'range status'
+            assert resp['body'] == '2345', 'range body'
+
+    def test_static_cache_invalid(self):
+        def check_error(cache):
+            assert 'error' in self.conf(
+                cache, 'settings/http/static/open_file_cache'
+            ), 'invalid open_file_cache'
+
+        check_error({"max": -1})
+        check_error({"valid": "1"})
+        check_error({"inactive": 2147484})
+        check_error({"errors": 1})
+        check_error({"blah": 1})
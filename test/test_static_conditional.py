@@ -0,0 +1,281 @@
+import os
+import re
+import time
+from pathlib import Path
+
+import pytest
+
+from unit.applications.proto import TestApplicationProto
+
+
+class TestStaticConditional(TestApplicationProto):
+    prerequisites = {}
+
+    @pytest.fixture(autouse=True)
+    def setup_method_fixture(self, temp_dir):
+        os.makedirs(temp_dir + '/assets')
+        Path(temp_dir + '/assets/index.html').write_text('0123456789')
+        Path(temp_dir + '/assets/file.txt').write_text('blah')
+
+        self._load_conf(
+            {
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [{"action": {"share": temp_dir + "/assets"}}],
+            }
+        )
+
+    def get_headers(self, headers, url='/'):
+        headers['Host'] = 'localhost'
+        headers['Connection'] = 'close'
+
+        return self.get(url=url, headers=headers)
+
+    def test_static_conditional_etag(self):
+        etag = self.get()['headers']['ETag']
+
+        resp = self.get_headers({'If-None-Match': etag})
+        assert resp['status'] == 304, 'If-None-Match status'
+        assert resp['body'] == '', 'If-None-Match body'
+        assert resp['headers']['ETag'] == etag, 'If-None-Match ETag'
+        assert 'Content-Length' not in resp['headers'], 'no Content-Length'
+
+        assert (
+            self.get_headers({'If-None-Match': 'W/' + etag})['status'] == 304
+        ), 'If-None-Match weak'
+        assert (
+            self.get_headers({'If-None-Match': '"a", ' + etag})['status']
+            == 304
+        ), 'If-None-Match list'
+        assert (
+            self.get_headers({'If-None-Match': '*'})['status'] == 304
+        ), 'If-None-Match any'
+
+        resp = self.get_headers({'If-None-Match': '"blah"'})
+        assert resp['status'] == 200, 'If-None-Match mismatch'
+        assert resp['body'] == '0123456789', 'If-None-Match mismatch body'
+
+    def test_static_conditional_modified_since(self):
+        last_modified = self.get()['headers']['Last-Modified']
+
+        assert (
+            self.get_headers({'If-Modified-Since': last_modified})['status']
+            == 304
+        ), 'If-Modified-Since'
+        assert (
+            self.get_headers(
+                {'If-Modified-Since': 'Mon, 01 Jan 1990 00:00:00 GMT'}
+            )['status']
+            == 200
+        ), 'If-Modified-Since old'
+        assert (
+            self.get_headers({'If-Modified-Since': 'blah'})['status'] == 200
+        ), 'If-Modified-Since invalid'
+
+        assert (
+            self.get_headers(
+                {
+                    'If-None-Match': '"blah"',
+                    'If-Modified-Since': last_modified,
+                }
+            )['status']
+            == 200
+        ), 'If-None-Match precedence'
+
+    def test_static_conditional_precondition(self):
+        resp = self.get()
+        etag = resp['headers']['ETag']
+        last_modified = resp['headers']['Last-Modified']
+
+        assert (
+            self.get_headers({'If-Match': etag})['status'] == 200
+        ), 'If-Match'
+        assert (
+            self.get_headers({'If-Match': '"blah"'})['status'] == 412
+        ), 'If-Match mismatch'
+        assert (
+            self.get_headers({'If-Match': 'W/' + etag})['status'] == 412
+        ), 'If-Match weak'
+        assert (
+            self.get_headers({'If-Unmodified-Since': last_modified})[
+                'status'
+            ]
+            == 200
+        ), 'If-Unmodified-Since'
+        assert (
+            self.get_headers(
+                {'If-Unmodified-Since': 'Mon, 01 Jan 1990 00:00:00 GMT'}
+            )['status']
+            == 412
+        ), 'If-Unmodified-Since old'
+
+    def test_static_conditional_changed(self, temp_dir):
+        etag = self.get()['headers']['ETag']
+
+        time.sleep(1)
+        Path(temp_dir + '/assets/index.html').write_text('blah')
+
+        assert (
+            self.get_headers({'If-None-Match': etag})['body'] == 'blah'
+        ), 'changed'
+
+    def test_static_range(self):
+        resp = self.get_headers({'Range': 'bytes=2-5'})
+        assert resp['status'] == 206, 'range status'
+        assert resp['body'] == '2345', 'range body'
+        assert resp['headers']['Content-Range'] == 'bytes 2-5/10', 'range'
+        assert resp['headers']['Content-Length'] == '4', 'range length'
+
+        assert (
+            self.get_headers({'Range': 'bytes=7-'})['body'] == '789'
+        ), 'range open'
+        assert (
+            self.get_headers({'Range': 'bytes=-3'})['body'] == '789'
+        ), 'range suffix'
+        assert (
+            self.get_headers({'Range': 'bytes=-20'})['body'] == '0123456789'
+        ), 'range suffix large'
+        assert (
+            self.get_headers({'Range': 'bytes=8-20'})['body'] == '89'
+        ), 'range end large'
+        assert (
+            self.get_headers({'Range': 'bytes=1-2,'})['body'] == '12'
+        ), 'range trailing comma'
+
+    def test_static_range_ignored(self):
+        for value in ['bytes=5-2', 'bytes=a-2', 'items=1-2', 'bytes=-']:
+            resp = self.get_headers({'Range': value})
+            assert resp['status'] == 200, 'invalid range ' + value
+            assert resp['body'] == '0123456789', 'invalid range body'
+
+        assert (
+            self.get_headers({'Range': 'bytes=5-6,0-1'})['status'] == 200
+        ), 'descending ranges'
+
+        resp = self.get_headers({'Range': 'bytes=1-2'}, url='/')
+        assert resp['status'] == 206, 'range'
+
+    def test_static_range_coalesced(self):
+        resp = self.get_headers({'Range': 'bytes=0-5,3-8'})
+        assert resp['status'] == 206, 'overlapping status'
+        assert (
+            resp['headers']['Content-Range'] == 'bytes 0-8/10'
+        ), 'overlapping Content-Range'
+        assert resp['body'] == '012345678', 'overlapping body'
+
+        resp = self.get_headers({'Range': 'bytes=0-1,2-3,6-7'})
+        assert resp['status'] == 206, 'adjoining status'
+        assert resp['headers']['Content-Type'].startswith(
+            'multipart/byteranges'
+        ), 'adjoining multipart'
+        assert 'Content-Range: bytes 0-3/10' in resp['body'], 'adjoining first'
+        assert 'Content-Range: bytes 6-7/10' in resp['body'], 'adjoining last'
+
+    def test_static_range_not_satisfiable(self):
+        resp = self.get_headers({'Range': 'bytes=10-20'})
+        assert resp['status'] == 416, 'not satisfiable status'
+        assert (
+            resp['headers']['Content-Range'] == 'bytes */10'
+        ), 'not satisfiable Content-Range'
+
+        assert (
+            self.get_headers({'Range': 'bytes=-0'})['status'] == 416
+        ), 'not satisfiable suffix'
+
+    def test_static_range_if_range(self):
+        resp = self.get()
+        etag = resp['headers']['ETag']
+        last_modified = resp['headers']['Last-Modified']
+
+        assert (
+            self.get_headers({'Range': 'bytes=0-0', 'If-Range': etag})[
+                'status'
+            ]
+            == 206
+        ), 'If-Range'
+        assert (
+            self.get_headers(
+                {'Range': 'bytes=0-0', 'If-Range': last_modified}
+            )['status']
+            == 206
+        ), 'If-Range date'
+        assert (
+            self.get_headers({'Range': 'bytes=0-0', 'If-Range': '"blah"'})[
+                'status'
+            ]
+            == 200
+        ), 'If-Range mismatch'
+        assert (
+            self.get_headers(
+                {
+                    'Range': 'bytes=0-0',
+                    'If-Range': 'Mon, 01 Jan 1990 00:00:00 GMT',
+                }
+            )['status']
+            == 200
+        ), 'If-Range date mismatch'
+
+    def test_static_range_multipart(self):
+        resp = self.get_headers({'Range': 'bytes=0-1, 4-5,-2'})
+        assert resp['status'] == 206, 'multipart status'
+
+        m = re.match(
+            r'multipart/byteranges; boundary=(\w+)$',
+            resp['headers']['Content-Type'],
+        )
+        assert m is not None, 'multipart Content-Type'
+
+        boundary = m.group(1)
+        body = resp['body']
+
+        assert int(resp['headers']['Content-Length']) == len(body)
+        assert body.endswith('\r\n--' + boundary + '--\r\n'), 'closing'
+
+        parts = body.split('\r\n--' + boundary)[1:-1]
+        assert len(parts) == 3, 'parts'
+
+        expect = [('0-1', '01'), ('4-5', '45'), ('8-9', '89')]
+
+        for part, (range, data) in zip(parts, expect):
+            headers, content = part.split('\r\n\r\n', 1)
+            assert (
+                'Content-Type: text/html' in headers
+            ), 'part Content-Type'
+            assert (
+                'Content-Range: bytes ' + range + '/10' in headers
+            ), 'part Content-Range'
+            assert content == data, 'part data'
+
+    def test_static_range_multipart_large(self, temp_dir):
+        file_size = 512 * 1024
+        data = os.urandom(file_size)
+
+        with open(temp_dir + '/assets/large', 'wb') as f:
+            f.write(data)
+
+        resp = self.get(
+            url='/large',
+            headers={
+                'Host': 'localhost',
+                'Range': 'bytes=100-200000,300000-',
+                'Connection': 'close',
+            },
+            encoding='latin1',
+            read_buffer_size=1024 * 1024,
+        )
+        assert resp['status'] == 206, 'large multipart status'
+
+        body = resp['body'].encode('latin1')
+        assert int(resp['headers']['Content-Length']) == len(body)
+        assert data[100:200001] in body, 'large multipart first'
+        assert data[300000:] in body, 'large multipart second'
+
+    def test_static_range_head(self):
+        resp = self.head(
+            headers={
+                'Host': 'localhost',
+                'Range': 'bytes=2-5',
+                'Connection': 'close',
+            }
+        )
+        assert resp['status'] == 200, 'HEAD range ignored'
+        assert resp['headers']['Content-Length'] == '10', 'HEAD length'
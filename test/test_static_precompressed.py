@@ -0,0 +1,136 @@
+import os
+from pathlib import Path
+
+import pytest
+
+from unit.applications.proto import TestApplicationProto
+
+
+class TestStaticPrecompressed(TestApplicationProto):
+    prerequisites = {}
+
+    @pytest.fixture(autouse=True)
+    def setup_method_fixture(self, temp_dir):
+        os.makedirs(temp_dir + '/assets/dir.gz')
+        Path(temp_dir + '/assets/index.html').write_text('0123456789')
+        Path(temp_dir + '/assets/index.html.gz').write_text('gzip')
+        Path(temp_dir + '/assets/index.html.br').write_text('brotli')
+        Path(temp_dir + '/assets/file.js').write_text('file')
+        Path(temp_dir + '/assets/file.js.gz').write_text('file gzip')
+        Path(temp_dir + '/assets/dir').write_text('dir')
+
+        self._load_conf(
+            {
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [
+                    {
+                        "action": {
+                            "share": temp_dir + "/assets",
+                            "precompressed": True,
+                        }
+                    }
+                ],
+            }
+        )
+
+    def get_encoding(self, encoding, url='/'):
+        return self.get(
+            url=url,
+            headers={
+                'Host': 'localhost',
+                'Accept-Encoding': encoding,
+                'Connection': 'close',
+            },
+        )
+
+    def test_static_precompressed(self):
+        resp = self.get()
+        assert resp['body'] == '0123456789', 'identity'
+        assert 'Content-Encoding' not in resp['headers'], 'no encoding'
+        assert resp['headers']['Vary'] == 'Accept-Encoding', 'Vary'
+
+        resp = self.get_encoding('gzip')
+        assert resp['body'] == 'gzip', 'gzip'
+        assert resp['headers']['Content-Encoding'] == 'gzip', 'gzip encoding'
+        assert resp['headers']['Content-Type'] == 'text/html', 'gzip type'
+        assert resp['headers']['Content-Length'] == '4', 'gzip length'
+        assert resp['headers']['Vary'] == 'Accept-Encoding', 'gzip Vary'
+
+        resp = self.get_encoding('gzip, deflate, br')
+        assert resp['body'] == 'brotli', 'br'
+        assert resp['headers']['Content-Encoding'] == 'br', 'br encoding'
+
+        assert self.get_encoding('GZIP')['body'] == 'gzip', 'case'
+        assert self.get_encoding('deflate')['body'] == '0123456789', 'deflate'
+
+    def test_static_precompressed_qvalue(self):
+        assert self.get_encoding('br;q=0, gzip')['body'] == 'gzip', 'br q=0'
+        assert (
+            self.get_encoding('br;q=0.000, gzip;q=0.5')['body'] == 'gzip'
+        ), 'br q=0.000'
+        assert (
+            self.get_encoding('br; q=0, gzip;q=0')['body'] == '0123456789'
+        ), 'all q=0'
+        assert self.get_encoding('*')['body'] == 'brotli', 'any'
+        assert self.get_encoding('*, br;q=0')['body'] == 'gzip', 'any except'
+
+    def test_static_precompressed_missing(self):
+        resp = self.get_encoding('br, gzip', url='/file.js')
+        assert resp['body'] == 'file gzip', 'br missing'
+        assert resp['headers']['Content-Encoding'] == 'gzip', 'gzip fallback'
+
+        resp = self.get_encoding('br', url='/file.js')
+        assert resp['body'] == 'file', 'identity fallback'
+        assert 'Content-Encoding' not in resp['headers'], 'identity'
+
+        resp = self.get_encoding('gzip', url='/dir')
+        assert resp['body'] == 'dir', 'not a file'
+        assert 'Content-Encoding' not in resp['headers'], 'not a file'
+
+        assert self.get_encoding('gzip', url='/blah')['status'] == 404
+
+    def test_static_precompressed_disabled(self):
+        assert 'success' in self.conf(
+            'false', 'routes/0/action/precompressed'
+        ), 'disable'
+
+        resp = self.get_encoding('gzip')
+        assert resp['body'] == '0123456789', 'disabled'
+        assert 'Vary' not in resp['headers'], 'disabled Vary'
+
+    def test_static_precompressed_range(self):
+        resp = self.get(
+            headers={
+                'Host': 'localhost',
+                'Accept-Encoding': 'gzip',
+                'Range': 'bytes=1-2',
+                'Connection': 'close',
+            }
+        )
+        assert resp['status'] == 206, 'range status'
+        assert resp['body'] == 'zi', 'range body'
+
+    def test_static_precompressed_threads_cache(self):
+        assert 'success' in self.conf(
+            {
+                "http": {
+                    "static": {
+                        "threads": 2,
+                        "open_file_cache": {"inactive": 1},
+                    }
+                }
+            },
+            'settings',
+        ), 'configure'
+
+        for _ in range(2):
+            assert self.get_encoding('br, gzip', url='/file.js')['body'] == (
+                'file gzip'
+            ), 'threads gzip'
+            assert self.get_encoding('br')['body'] == 'brotli', 'threads br'
+            assert self.get()['body'] == '0123456789', 'threads identity'
+
+    def test_static_precompressed_invalid(self):
+        assert 'error' in self.conf(
+            '"on"', 'routes/0/action/precompressed'
+        ), 'invalid'
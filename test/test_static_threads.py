@@ -0,0 +1,124 @@
+import os
+import time
+from pathlib import Path
+
+import pytest
+
+from unit.applications.proto import TestApplicationProto
+from unit.slowfs import SlowFS
+
+
+class TestStaticThreads(TestApplicationProto):
+    prerequisites = {}
+
+    @pytest.fixture(autouse=True)
+    def setup_method_fixture(self, temp_dir):
+        os.makedirs(temp_dir + '/assets/dir')
+        Path(temp_dir + '/assets/index.html').write_text('0123456789')
+        Path(temp_dir + '/assets/file').write_text('blah')
+
+        self._load_conf(
+            {
+                "listeners": {"*:7080": {"pass": "routes"}},
+                "routes": [{"action": {"share": temp_dir + "/assets"}}],
+                "settings": {"http": {"static": {"threads": 2}}},
+            }
+        )
+
+    def test_static_threads(self):
+        assert self.get()['body'] == '0123456789', 'index'
+        assert self.get(url='/file')['body'] == 'blah', 'file'
+        assert self.get(url='/dir')['status'] == 301, 'dir'
+        assert self.get(url='/blah')['status'] == 404, 'not found'
+        assert self.head()['headers']['Content-Length'] == '10', 'HEAD'
+
+    def test_static_threads_fallback(self):
+        assert 'success' in self.conf(
+            {"share": "/blah", "fallback": {"return": 200}}, 'routes/0/action'
+        ), 'configure fallback'
+
+        assert self.get()['status'] == 200, 'fallback'
+
+    def test_static_threads_cache(self):
+        assert 'success' in self.conf(
+            {"threads": 2, "open_file_cache": {"inactive": 1}},
+            'settings/http/static',
+        ), 'configure cache'
+
+        for _ in range(2):
+            assert self.get()['body'] == '0123456789', 'index'
+            assert self.get(url='/blah')['status'] == 404, 'not found'
+
+    def test_static_threads_concurrent(self):
+        socks = []
+
+        for i in range(50):
+            url = '/' if i % 2 else '/blah'
+            _, sock = self.get(url=url, no_recv=True, start=True)
+            socks.append((url, sock))
+
+        for url, sock in socks:
+            resp = self._resp_to_dict(self.recvall(sock).decode())
+            sock.close()
+
+            if url == '/':
+                assert resp['body'] == '0123456789', 'concurrent'
+
+            else:
+                assert resp['status'] == 404, 'concurrent not found'
+
+    def test_static_threads_stress(self):
+        for _ in range(20):
+            self.test_static_threads_concurrent()
+
+        assert self.get()['body'] == '0123456789', 'after stress'
+
+    def test_static_threads_slow_fs(self, is_su, temp_dir):
+        if not is_su or not os.path.exists('/dev/fuse'):
+            pytest.skip('requires root and FUSE')
+
+        delay = 1
+
+        assert 'success' in self.conf(
+            '8', 'settings/http/static/threads'
+        ), 'configure threads'
+
+        os.makedirs(temp_dir + '/assets/mnt')
+        fs = SlowFS(temp_dir + '/assets/mnt', {'slow': b'slow'}, delay)
+
+        try:
+            slow = []
+
+            for _ in range(3):
+                _, sock = self.get(url='/mnt/slow', no_recv=True, start=True)
+                slow.append(sock)
+
+            latency = []
+
+            for _ in range(50):
+                start = time.monotonic()
+                assert self.get()['body'] == '0123456789', 'fast'
+                latency.append(time.monotonic() - start)
+
+            latency.sort()
+
+            assert latency[int(len(latency) * 0.99)] < delay / 4, 'p99'
+
+            for sock in slow:
+                resp = self._resp_to_dict(self.recvall(sock).decode())
+                sock.close()
+
+                assert resp['body'] == 'slow', 'slow'
+
+        finally:
+            fs.umount()
+
+    def test_static_threads_invalid(self):
+        def check_error(threads):
+            assert 'error' in self.conf(
+                threads, 'settings/http/static/threads'
+            ), 'invalid threads'
+
+        check_error('0')
+        check_error('-1')
+        check_error('"1"')
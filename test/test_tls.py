@@ -168,6 +168,310 @@ basicConstraints = critical,CA:TRUE"""
             '/certificates/blah'
         ), 'remove nonexistings certificate'
 
+    def test_tls_file_wrapper(self):
+        self.load('file_wrapper')
+
+        self.certificate()
+
+        self.add_tls(application='file_wrapper')
+
+        body = ''.join(str(i % 10) for i in range(300000))
+
+        with open(option.temp_dir + '/file', 'w') as f:
+            f.write(body)
+
+        resp = self.get_ssl(
+            headers={
+                'Host': 'localhost',
+                'X-File': option.temp_dir + '/file',
+                'X-Offset': '10',
+                'Connection': 'close',
+            }
+        )
+        assert resp['status'] == 200, 'file wrapper status'
+        assert resp['body'] == body[10:], 'file wrapper'
+
+    def test_tls_ktls(self):
+        self.load('file_wrapper')
+
+        self.certificate()
+
+        if 'success' not in self.conf(
+            {
+                "pass": "applications/file_wrapper",
+                "tls": {"certificate": "default", "ktls": True},
+            },
+            'listeners/*:7080',
+        ):
+            pytest.skip('kTLS is not supported')
+
+        body = ''.join(str(i % 10) for i in range(300000))
+
+        with open(option.temp_dir + '/file', 'w') as f:
+            f.write(body)
+
+        resp = self.get_ssl(
+            headers={
+                'Host': 'localhost',
+                'X-File': option.temp_dir + '/file',
+                'X-Offset': '10',
+                'Connection': 'close',
+            }
+        )
+        assert resp['status'] == 200, 'ktls status'
+        assert resp['body'] == body[10:], 'ktls file'
+
+        (resp, sock) = self.get_ssl(
+            headers={
+                'Host': 'localhost',
+                'X-File': option.temp_dir + '/file',
+                'X-Offset': '10',
+                'X-Length': '1000',
+            },
+            start=True,
+            read_timeout=1,
+        )
+        assert resp['body'] == body[10:1010], 'ktls file keepalive'
+
+        resp = self.get_ssl(
+            headers={
+                'Host': 'localhost',
+                'X-Memory': 'blah',
+                'Connection': 'close',
+            },
+            sock=sock,
+        )
+        assert resp['status'] == 200, 'ktls keepalive status'
+        assert resp['body'] == 'blah', 'ktls keepalive'
+
+    def test_tls_ktls_static(self):
+        self.certificate()
+
+        if 'success' not in self.conf(
+            {
+                "listeners": {
+                    "*:7080": {
+                        "pass": "routes",
+                        "tls": {"certificate": "default", "ktls": True},
+                    }
+                },
+                "routes": [{"action": {"share": option.temp_dir}}],
+                "applications": {},
+            }
+        ):
+            pytest.skip('kTLS is not supported')
+
+        body = ''.join(str(i % 10) for i in range(300000))
+
+        with open(option.temp_dir + '/file', 'w') as f:
+            f.write(body)
+
+        resp = self.get_ssl(
+            url='/file', headers={'Host': 'localhost', 'Connection': 'close'}
+        )
+        assert resp['status'] == 200, 'ktls static status'
+        assert resp['body'] == body, 'ktls static'
+
+        # The kernel loads the TLS module on the first kTLS connection.
+
+        with open('/proc/sys/net/ipv4/tcp_available_ulp') as f:
+            if 'tls' not in f.read().split():
+                pytest.skip('kTLS is not supported by the kernel')
+
+        (resp, sock) = self.get_ssl(
+            url='/file',
+            headers={'Host': 'localhost', 'Range': 'bytes=10-1009'},
+            start=True,
+            read_timeout=1,
+        )
+        assert resp['status'] == 206, 'ktls static range status'
+        assert resp['body'] == body[10:1010], 'ktls static range'
+
+        resp = self.get_ssl(
+            url='/file',
+            headers={
+                'Host': 'localhost',
+                'Range': 'bytes=0-9,20-29',
+                'Connection': 'close',
+            },
+            sock=sock,
+        )
+        assert resp['status'] == 206, 'ktls static multipart status'
+        assert body[20:30] in resp['body'], 'ktls static multipart'
+
+    def test_tls_records(self):
+        self.load('body_generate')
+
+        self.certificate()
+
+        self.add_tls(application='body_generate')
+
+        def check(length):
+            resp = self.get_ssl(
+                headers={
+                    'Host': 'localhost',
+                    'X-Length': str(length),
+                    'Connection': 'close',
+                }
+            )
+            assert resp['status'] == 200, 'status ' + str(length)
+            assert resp['body'] == 'X' * length, 'body ' + str(length)
+
+        check(10)
+        check(5000)
+        check(3000000)
+
+    def test_tls_session_cache(self):
+        self.load('empty')
+
+        self.certificate()
+
+        assert 'success' in self.conf(
+            {
+                "pass": "applications/empty",
+                "tls": {
+                    "certificate": "default",
+                    "session": {"cache_size": 10},
+                },
+            },
+            'listeners/*:7080',
+        )
+
+        def get(session=None):
+            def wrapper(sock, **kwargs):
+                return self.context.wrap_socket(
+                    sock, session=session, **kwargs
+                )
+
+            (resp, sock) = self.get(
+                headers={'Host': 'localhost', 'Connection': 'close'},
+                wrapper=wrapper,
+                start=True,
+            )
+            assert resp['status'] == 200, 'status'
+
+            reused = sock.session_reused
+            session = sock.session
+            sock.close()
+
+            return (reused, session)
+
+        (reused, session) = get()
+        assert not reused, 'new session'
+
+        (reused, _) = get(session)
+        assert reused, 'session reused'
+
+        assert 'success' in self.conf(
+            {"http": {"idle_timeout": 10}}, 'settings'
+        )
+
+        (reused, _) = get(session)
+        assert reused, 'session reused after reconfiguration'
+
+        assert 'success' in self.conf(
+            {"certificate": "default", "session": {"cache_size": 0}},
+            'listeners/*:7080/tls',
+        )
+
+        (reused, _) = get(session)
+        assert not reused, 'cache disabled'
+
+    def test_tls_ocsp_stapling(self, temp_dir):
+        self.load('empty')
+
+        self.certificate('root', False)
+        self.req()
+
+        self.generate_ca_conf()
+
+        with open(temp_dir + '/ca.conf', 'a') as f:
+            f.write('\nauthorityInfoAccess = OCSP;URI:http://127.0.0.1:7081')
+
+        self.ca()
+
+        with open(temp_dir + '/chain.crt', 'wb') as crt, open(
+            temp_dir + '/localhost.crt', 'rb'
+        ) as end, open(temp_dir + '/root.crt', 'rb') as root:
+            crt.write(end.read() + root.read())
+
+        assert 'success' in self.certificate_load('chain', 'localhost')
+
+        if 'success' not in self.conf(
+            {
+                "pass": "applications/empty",
+                "tls": {"certificate": "chain", "ocsp_stapling": True},
+            },
+            'listeners/*:7080',
+        ):
+            pytest.skip('OCSP stapling is not supported')
+
+        def status():
+            return subprocess.run(
+                [
+                    'openssl',
+                    's_client',
+                    '-connect',
+                    '127.0.0.1:7080',
+                    '-status',
+                ],
+                input=b'',
+                stdout=subprocess.PIPE,
+                stderr=subprocess.STDOUT,
+            ).stdout.decode()
+
+        assert 'no response sent' in status(), 'no responder'
+
+        responder = subprocess.Popen(
+            [
+                'openssl',
+                'ocsp',
+                '-index',
+                temp_dir + '/certindex',
+                '-port',
+                '7081',
+                '-rsigner',
+                temp_dir + '/root.crt',
+                '-rkey',
+                temp_dir + '/root.key',
+                '-CA',
+                temp_dir + '/root.crt',
+                '-nmin',
+                '10',
+            ],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+
+        try:
+            # The failed fetch is retried on reconfiguration.
+
+            assert 'success' in self.conf(
+                {"certificate": "chain", "ocsp_stapling": True},
+                'listeners/*:7080/tls',
+            )
+
+            for _ in range(50):
+                resp = status()
+
+                if 'Cert Status: good' in resp:
+                    break
+
+                time.sleep(0.1)
+
+            assert 'OCSP Response Status: successful' in resp, 'stapled'
+            assert 'Cert Status: good' in resp, 'status good'
+
+        finally:
+            responder.kill()
+            responder.wait()
+
+        assert 'success' in self.conf(
+            {"certificate": "chain"}, 'listeners/*:7080/tls'
+        )
+
+        assert 'no response sent' in status(), 'disabled'
+
     @pytest.mark.skip('not yet')
     def test_tls_certificate_update(self):
         self.load('empty')
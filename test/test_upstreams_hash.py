@@ -0,0 +1,100 @@
+from unit.applications.proto import TestApplicationProto
+
+
+class TestUpstreamsHash(TestApplicationProto):
+    prerequisites = {}
+
+    def setup_method(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {
+                    "*:7080": {"pass": "upstreams/one"},
+                    "*:7081": {"pass": "routes/one"},
+                    "*:7082": {"pass": "routes/two"},
+                    "*:7083": {"pass": "routes/three"},
+                },
+                "upstreams": {
+                    "one": {
+                        "balance": "hash",
+                        "key": "$uri",
+                        "servers": {
+                            "127.0.0.1:7081": {},
+                            "127.0.0.1:7082": {},
+                            "127.0.0.1:7083": {},
+                        },
+                    },
+                },
+                "routes": {
+                    "one": [{"action": {"return": 200}}],
+                    "two": [{"action": {"return": 201}}],
+                    "three": [{"action": {"return": 202}}],
+                },
+                "applications": {},
+            },
+        ), 'upstreams initial configuration'
+
+    def get_servers(self, req=60):
+        return [self.get(url='/' + str(i))['status'] for i in range(req)]
+
+    def test_upstreams_hash(self):
+        servers = self.get_servers()
+
+        assert len(set(servers)) == 3, 'all servers'
+        assert self.get_servers() == servers, 'same keys'
+
+        for status in [200, 201, 202]:
+            assert servers.count(status) > 5, 'distribution'
+
+        assert self.get(url='/0?arg')['status'] == servers[0], 'uri key'
+
+    def test_upstreams_hash_consistent(self):
+        servers = self.get_servers()
+
+        assert 'success' in self.conf_delete(
+            'upstreams/one/servers/127.0.0.1:7083'
+        ), 'server remove'
+
+        for old, new in zip(servers, self.get_servers()):
+            assert new != 202, 'removed server'
+
+            if old != 202:
+                assert new == old, 'kept keys'
+
+        assert 'success' in self.conf(
+            {}, 'upstreams/one/servers/127.0.0.1:7083'
+        ), 'server add'
+
+        assert self.get_servers() == servers, 'restored keys'
+
+    def test_upstreams_hash_key(self):
+        assert 'success' in self.conf(
+            '"$host"', 'upstreams/one/key'
+        ), 'host key'
+
+        servers = self.get_servers(10)
+        assert len(set(servers)) == 1, 'same host'
+
+        assert 'success' in self.conf('"static"', 'upstreams/one/key')
+
+        servers = self.get_servers(10)
+        assert len(set(servers)) == 1, 'static key'
+
+    def test_upstreams_hash_weight(self):
+        assert 'success' in self.conf(
+            {"weight": 0}, 'upstreams/one/servers/127.0.0.1:7081'
+        ), 'zero weight'
+
+        assert 200 not in self.get_servers(), 'zero weight server'
+
+        assert 'success' in self.conf(
+            {"weight": 10}, 'upstreams/one/servers/127.0.0.1:7082'
+        ), 'weight'
+
+        servers = self.get_servers(100)
+        assert servers.count(201) > servers.count(202) * 3, 'weighted'
+
+    def test_upstreams_hash_invalid(self):
+        assert 'error' in self.conf_delete('upstreams/one/key'), 'no key'
+        assert 'error' in self.conf('""', 'upstreams/one/key'), 'empty key'
+        assert 'error' in self.conf('"$blah"', 'upstreams/one/key')
+        assert 'error' in self.conf('1', 'upstreams/one/key')
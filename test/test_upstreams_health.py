@@ -0,0 +1,141 @@
+import re
+import time
+
+from unit.applications.proto import TestApplicationProto
+
+
+class TestUpstreamsHealth(TestApplicationProto):
+    prerequisites = {}
+
+    def setup_method(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {
+                    "*:7080": {"pass": "upstreams/one"},
+                    "*:7081": {"pass": "routes/one"},
+                    "*:7082": {"pass": "routes/two"},
+                },
+                "upstreams": {
+                    "one": {
+                        "servers": {
+                            "127.0.0.1:7081": {},
+                            "127.0.0.1:7082": {},
+                        },
+                    },
+                },
+                "routes": {
+                    "one": [{"action": {"return": 200}}],
+                    "two": [
+                        {
+                            "match": {"uri": "/health"},
+                            "action": {"return": 503},
+                        },
+                        {"action": {"return": 201}},
+                    ],
+                },
+                "applications": {},
+            },
+        ), 'upstreams initial configuration'
+
+    def get_resps_sc(self, req=30):
+        to_send = b"""GET / HTTP/1.1
+Host: localhost
+
+""" * (
+            req - 1
+        )
+
+        to_send += b"""GET / HTTP/1.1
+Host: localhost
+Connection: close
+
+"""
+
+        resp = self.http(to_send, raw_resp=True, raw=True)
+        return re.findall(r'HTTP\/\d\.\d\s(\d\d\d)', resp)
+
+    def test_upstreams_health_passive(self):
+        assert 'success' in self.conf(
+            {"max_fails": 1, "fail_timeout": 1},
+            'upstreams/one/servers/127.0.0.1:7084',
+        ), 'configure bad server'
+
+        status = self.get_resps_sc()
+        assert len(status) == 30, 'responses'
+        assert status.count('502') == 1, 'bad server is skipped'
+
+        time.sleep(1.5)
+
+        status = self.get_resps_sc()
+        assert status.count('502') == 1, 'bad server is retried'
+
+    def test_upstreams_health_passive_disabled(self):
+        assert 'success' in self.conf(
+            {}, 'upstreams/one/servers/127.0.0.1:7084'
+        ), 'configure bad server'
+
+        status = self.get_resps_sc()
+        assert status.count('502') == 10, 'bad server is not skipped'
+
+    def test_upstreams_health_active(self):
+        assert 'success' in self.conf(
+            {"uri": "/health", "interval": 1},
+            'upstreams/one/health_check',
+        ), 'configure health check'
+
+        time.sleep(1)
+
+        status = self.get_resps_sc(10)
+        assert status == ['200'] * 10, 'unhealthy server is skipped'
+
+        assert 'success' in self.conf(
+            {"return": 204}, 'routes/two/0/action'
+        ), 'fix health'
+
+        time.sleep(1.5)
+
+        status = self.get_resps_sc(10)
+        assert status.count('200') == 5, 'healthy server'
+        assert status.count('201') == 5, 'recovered server'
+
+    def test_upstreams_health_active_all_down(self):
+        assert 'success' in self.conf(
+            {"uri": "/health", "interval": 1, "fails": 1},
+            'upstreams/one/health_check',
+        ), 'configure health check'
+
+        assert 'success' in self.conf(
+            [
+                {
+                    "match": {"uri": "/health"},
+                    "action": {"return": 503},
+                },
+                {"action": {"return": 200}},
+            ],
+            'routes/one',
+        ), 'all unhealthy'
+
+        time.sleep(1)
+
+        status = self.get_resps_sc(10)
+        assert status.count('200') == 5, 'unhealthy server is tried'
+        assert status.count('201') == 5, 'all unhealthy servers are tried'
+
+    def test_upstreams_health_invalid(self):
+        def check_error(conf, path):
+            assert 'error' in self.conf(conf, path)
+
+        server = 'upstreams/one/servers/127.0.0.1:7081/'
+        check_error('-1', server + 'max_fails')
+        check_error('"1"', server + 'max_fails')
+        check_error('1.5', server + 'fail_timeout')
+        check_error('-1', server + 'fail_timeout')
+
+        check_error('"/"', 'upstreams/one/health_check')
+        check_error({"uri": "health"}, 'upstreams/one/health_check')
+        check_error({"uri": "/a b"}, 'upstreams/one/health_check')
+        check_error({"interval": 0}, 'upstreams/one/health_check')
+        check_error({"timeout": -1}, 'upstreams/one/health_check')
+        check_error({"fails": 0}, 'upstreams/one/health_check')
+        check_error({"passes": "1"}, 'upstreams/one/health_check')
+        check_error({"blah": 1}, 'upstreams/one/health_check')
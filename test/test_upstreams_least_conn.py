@@ -0,0 +1,124 @@
+import re
+import time
+
+from unit.applications.lang.python import TestApplicationPython
+from unit.option import option
+
+
+class TestUpstreamsLeastConn(TestApplicationPython):
+    prerequisites = {'modules': {'python': 'any'}}
+
+    def setup_method(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {
+                    "*:7080": {"pass": "upstreams/one"},
+                    "*:7081": {"pass": "routes"},
+                    "*:7082": {"pass": "routes"},
+                },
+                "upstreams": {
+                    "one": {
+                        "balance": "least_conn",
+                        "servers": {
+                            "127.0.0.1:7081": {},
+                            "127.0.0.1:7082": {},
+                        },
+                    },
+                },
+                "routes": [
+                    {
+                        "match": {"destination": "*:7081"},
+                        "action": {"pass": "applications/delayed"},
+                    },
+                    {
+                        "match": {"destination": "*:7082"},
+                        "action": {"return": 201},
+                    },
+                ],
+                "applications": {
+                    "delayed": {
+                        "type": "python",
+                        "processes": {"spare": 0},
+                        "path": option.test_dir + "/python/delayed",
+                        "working_directory": option.test_dir
+                        + "/python/delayed",
+                        "module": "wsgi",
+                    }
+                },
+            },
+        ), 'upstreams initial configuration'
+
+    def get_resps(self, req):
+        socks = []
+
+        for _ in range(req):
+            # The delayed application sends the body in two parts.
+
+            _, sock = self.post(
+                headers={
+                    'Host': 'localhost',
+                    'X-Delay': '2',
+                    'X-Parts': '2',
+                    'Connection': 'close',
+                },
+                body='0123456789',
+                start=True,
+                no_recv=True,
+            )
+            socks.append(sock)
+
+            time.sleep(0.05)
+
+        resps = [0, 0]
+
+        for sock in socks:
+            resp = self._resp_to_dict(self.recvall(sock).decode())
+            sock.close()
+
+            resps[resp['status'] % 10] += 1
+
+        return resps
+
+    def test_upstreams_least_conn(self):
+        assert self.get_resps(10) == [1, 9], 'busy server is avoided'
+
+    def test_upstreams_least_conn_weight(self):
+        assert 'success' in self.conf(
+            {"weight": 0}, 'upstreams/one/servers/127.0.0.1:7082'
+        ), 'zero weight'
+
+        for _ in range(5):
+            assert self.get()['status'] == 200, 'zero weight server'
+
+        assert 'success' in self.conf(
+            {"weight": 0}, 'upstreams/one/servers/127.0.0.1:7081'
+        ), 'all zero weights'
+
+        assert self.get()['status'] == 502, 'no server'
+
+    def test_upstreams_least_conn_idle(self):
+        assert 'success' in self.conf(
+            {"return": 200}, 'routes/0/action'
+        ), 'no delay'
+
+        # Requests of a single connection are handled by one router thread.
+
+        to_send = b"""GET / HTTP/1.1
+Host: localhost
+
+""" * 9 + b"""GET / HTTP/1.1
+Host: localhost
+Connection: close
+
+"""
+
+        resp = self.http(to_send, raw_resp=True, raw=True)
+        status = re.findall(r'HTTP/1.1 20(\d)', resp)
+
+        assert len(status) == 10, 'responses'
+        assert status.count('0') == 5, 'idle servers are chosen in turn'
+
+    def test_upstreams_least_conn_invalid(self):
+        assert 'error' in self.conf('"blah"', 'upstreams/one/balance')
+        assert 'error' in self.conf('1', 'upstreams/one/balance')
+        assert 'error' in self.conf('"$uri"', 'upstreams/one/key')
@@ -0,0 +1,96 @@
+import socket
+
+from conftest import run_process
+from unit.applications.proto import TestApplicationProto
+from unit.utils import waitforsocket
+
+
+class TestUpstreamsRetry(TestApplicationProto):
+    prerequisites = {}
+
+    SERVER_PORT = 7999
+
+    @staticmethod
+    def run_server(server_port):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+
+        server_address = ('', server_port)
+        sock.bind(server_address)
+        sock.listen(5)
+
+        # The request is read and the connection is closed without response.
+
+        while True:
+            connection, _ = sock.accept()
+            connection.recv(4096)
+            connection.close()
+
+    def setup_method(self):
+        assert 'success' in self.conf(
+            {
+                "listeners": {
+                    "*:7080": {"pass": "upstreams/one"},
+                    "*:7081": {"pass": "routes/one"},
+                },
+                "upstreams": {
+                    "one": {
+                        "retries": 1,
+                        "servers": {
+                            "127.0.0.1:7081": {},
+                            "127.0.0.1:7084": {},
+                        },
+                    },
+                },
+                "routes": {"one": [{"action": {"return": 200}}]},
+                "applications": {},
+            },
+        ), 'upstreams initial configuration'
+
+    def get_statuses(self, req=10, method='GET'):
+        return [self.http(method)['status'] for _ in range(req)]
+
+    def test_upstreams_retry_refused(self):
+        assert self.get_statuses() == [200] * 10, 'refused server retry'
+        assert self.get_statuses(method='POST') == [200] * 10, 'post retry'
+
+    def test_upstreams_retry_disabled(self):
+        assert 'success' in self.conf('0', 'upstreams/one/retries')
+
+        assert self.get_statuses().count(502) == 5, 'no retry'
+
+    def test_upstreams_retry_limit(self):
+        assert 'success' in self.conf(
+            {"127.0.0.1:7084": {}, "127.0.0.1:7085": {}, "127.0.0.1:7086": {}},
+            'upstreams/one/servers',
+        ), 'bad servers'
+
+        assert self.get()['status'] == 502, 'tries limit'
+
+        assert 'success' in self.conf('5', 'upstreams/one/retries')
+
+        assert self.get()['status'] == 502, 'all servers tried'
+
+    def test_upstreams_retry_idempotent(self):
+        run_process(self.run_server, self.SERVER_PORT)
+        waitforsocket(self.SERVER_PORT)
+
+        assert 'success' in self.conf(
+            {}, 'upstreams/one/servers/127.0.0.1:' + str(self.SERVER_PORT)
+        ), 'closing server'
+
+        assert 'success' in self.conf_delete(
+            'upstreams/one/servers/127.0.0.1:7084'
+        ), 'no refused server'
+
+        assert self.get_statuses() == [200] * 10, 'idempotent retry'
+
+        statuses = self.get_statuses(method='POST')
+        assert statuses.count(200) == 5, 'non-idempotent success'
+        assert statuses.count(502) == 5, 'non-idempotent no retry'
+
+    def test_upstreams_retry_invalid(self):
+        assert 'error' in self.conf('-1', 'upstreams/one/retries')
+        assert 'error' in self.conf('"1"', 'upstreams/one/retries')
+        assert 'error' in self.conf('1.5', 'upstreams/one/retry_timeout')
+        assert 'error' in self.conf('-1', 'upstreams/one/retry_timeout')
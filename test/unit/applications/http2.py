@@ -0,0 +1,382 @@
+import select
+import socket
+import ssl
+import struct
+
+import pytest
+from unit.applications.tls import TestApplicationTLS
+
+PREFACE = b'PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n'
+
+
+class TestApplicationHTTP2(TestApplicationTLS):
+
+    DATA = 0x0
+    HEADERS = 0x1
+    PRIORITY = 0x2
+    RST_STREAM = 0x3
+    SETTINGS = 0x4
+    PUSH_PROMISE = 0x5
+    PING = 0x6
+    GOAWAY = 0x7
+    WINDOW_UPDATE = 0x8
+    CONTINUATION = 0x9
+
+    END_STREAM = 0x1
+    ACK = 0x1
+    END_HEADERS = 0x4
+    PADDED = 0x8
+
+    SETTINGS_INITIAL_WINDOW_SIZE = 0x4
+    SETTINGS_MAX_FRAME_SIZE = 0x5
+
+    NO_ERROR = 0x0
+    PROTOCOL_ERROR = 0x1
+    FLOW_CONTROL_ERROR = 0x3
+    STREAM_CLOSED = 0x5
+    FRAME_SIZE_ERROR = 0x6
+    REFUSED_STREAM = 0x7
+    ENHANCE_YOUR_CALM = 0xB
+
+    STATIC_TABLE = [
+        (':authority', ''),
+        (':method', 'GET'),
+        (':method', 'POST'),
+        (':path', '/'),
+        (':path', '/index.html'),
+        (':scheme', 'http'),
+        (':scheme', 'https'),
+        (':status', '200'),
+        (':status', '204'),
+        (':status', '206'),
+        (':status', '304'),
+        (':status', '400'),
+        (':status', '404'),
+        (':status', '500'),
+        ('accept-charset', ''),
+        ('accept-encoding', 'gzip, deflate'),
+        ('accept-language', ''),
+        ('accept-ranges', ''),
+        ('accept', ''),
+        ('access-control-allow-origin', ''),
+        ('age', ''),
+        ('allow', ''),
+        ('authorization', ''),
+        ('cache-control', ''),
+        ('content-disposition', ''),
+        ('content-encoding', ''),
+        ('content-language', ''),
+        ('content-length', ''),
+        ('content-location', ''),
+        ('content-range', ''),
+        ('content-type', ''),
+        ('cookie', ''),
+        ('date', ''),
+        ('etag', ''),
+        ('expect', ''),
+        ('expires', ''),
+        ('from', ''),
+        ('host', ''),
+        ('if-match', ''),
+        ('if-modified-since', ''),
+        ('if-none-match', ''),
+        ('if-range', ''),
+        ('if-unmodified-since', ''),
+        ('last-modified', ''),
+        ('link', ''),
+        ('location', ''),
+        ('max-forwards', ''),
+        ('proxy-authenticate', ''),
+        ('proxy-authorization', ''),
+        ('range', ''),
+        ('referer', ''),
+        ('refresh', ''),
+        ('retry-after', ''),
+        ('server', ''),
+        ('set-cookie', ''),
+        ('strict-transport-security', ''),
+        ('transfer-encoding', ''),
+        ('user-agent', ''),
+        ('vary', ''),
+        ('via', ''),
+        ('www-authenticate', ''),
+    ]
+
+    def h2_connect(self, port=7080, settings=None, tls=False, preface=True):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+        if tls:
+            self.context.set_alpn_protocols(['h2', 'http/1.1'])
+            sock = self.context.wrap_socket(sock)
+
+        try:
+            sock.connect(('127.0.0.1', port))
+        except ConnectionRefusedError:
+            sock.close()
+            pytest.fail('Client can\'t connect to the server.')
+
+        if preface:
+            sock.sendall(PREFACE + self.settings(settings or {}))
+
+        return sock
+
+    def frame(self, type, flags=0, stream=0, payload=b''):
+        return (
+            struct.pack('!I', len(payload))[1:]
+            + struct.pack('!BBI', type, flags, stream)
+            + payload
+        )
+
+    def settings(self, settings):
+        payload = b''.join(
+            struct.pack('!HI', k, v) for k, v in settings.items()
+        )
+
+        return self.frame(self.SETTINGS, payload=payload)
+
+    def window_update(self, stream, increment):
+        return self.frame(
+            self.WINDOW_UPDATE,
+            stream=stream,
+            payload=struct.pack('!I', increment),
+        )
+
+    def frame_read(self, sock, read_timeout=60):
+        def recv_bytes(size):
+            data = b''
+
+            while len(data) < size:
+                # A TLS record can hold several frames.
+                if not (isinstance(sock, ssl.SSLSocket) and sock.pending()):
+                    rlist = select.select([sock], [], [], read_timeout)[0]
+                    if not rlist:
+                        # The default timeout means a frame is expected.
+                        if read_timeout == 60:
+                            pytest.fail('Can\'t read frame from server.')
+
+                        return None
+
+                chunk = sock.recv(size - len(data))
+                if not chunk:
+                    return None
+
+                data += chunk
+
+            return data
+
+        header = recv_bytes(9)
+        if header is None:
+            return None
+
+        length = struct.unpack('!I', b'\x00' + header[:3])[0]
+        type, flags, stream = struct.unpack('!BBI', header[3:])
+
+        payload = recv_bytes(length) if length else b''
+
+        return {
+            'type': type,
+            'flags': flags,
+            'stream': stream & 0x7FFFFFFF,
+            'payload': payload,
+        }
+
+    def hpack_int(self, value, prefix, first=0):
+        limit = (1 << prefix) - 1
+
+        if value < limit:
+            return bytes([first | value])
+
+        res = [first | limit]
+        value -= limit
+
+        while value >= 128:
+            res.append((value & 0x7F) | 0x80)
+            value >>= 7
+
+        res.append(value)
+
+        return bytes(res)
+
+    def hpack_str(self, s):
+        if isinstance(s, str):
+            s = s.encode()
+
+        return self.hpack_int(len(s), 7) + s
+
+    def hpack_encode(self, headers):
+        """Literal fields without indexing and without Huffman coding."""
+
+        block = b''
+
+        for name, value in headers:
+            block += b'\x00' + self.hpack_str(name) + self.hpack_str(value)
+
+        return block
+
+    def hpack_decode(self, block):
+        """Decodes the static table indices and plain literals only, as
+        Unit does not use the dynamic table and Huffman coding in responses.
+        """
+
+        def get_int(pos, prefix):
+            limit = (1 << prefix) - 1
+            value = block[pos] & limit
+            pos += 1
+
+            if value == limit:
+                shift = 0
+
+                while True:
+                    b = block[pos]
+                    pos += 1
+                    value += (b & 0x7F) << shift
+                    shift += 7
+
+                    if not b & 0x80:
+                        break
+
+            return value, pos
+
+        def get_str(pos):
+            assert not block[pos] & 0x80, 'huffman'
+
+            length, pos = get_int(pos, 7)
+
+            return block[pos : pos + length].decode(), pos + length
+
+        headers = []
+        pos = 0
+
+        while pos < len(block):
+            b = block[pos]
+
+            if b & 0x80:
+                index, pos = get_int(pos, 7)
+                headers.append(self.STATIC_TABLE[index - 1])
+                continue
+
+            if b & 0xE0 == 0x20:
+                _, pos = get_int(pos, 5)
+                continue
+
+            index, pos = get_int(pos, 6 if b & 0x40 else 4)
+
+            if index == 0:
+                name, pos = get_str(pos)
+            else:
+                name = self.STATIC_TABLE[index - 1][0]
+
+            value, pos = get_str(pos)
+            headers.append((name, value))
+
+        return headers
+
+    def h2_request(
+        self,
+        sock,
+        stream=1,
+        method='GET',
+        url='/',
+        headers=None,
+        body=None,
+        authority='localhost',
+        scheme='http',
+    ):
+        fields = [
+            (':method', method),
+            (':scheme', scheme),
+            (':authority', authority),
+            (':path', url),
+        ]
+
+        if headers is not None:
+            fields += headers
+
+        flags = self.END_HEADERS
+
+        if body is None:
+            flags |= self.END_STREAM
+
+        sock.sendall(
+            self.frame(self.HEADERS, flags, stream, self.hpack_encode(fields))
+        )
+
+        if body is not None:
+            if isinstance(body, str):
+                body = body.encode()
+
+            sock.sendall(self.frame(self.DATA, self.END_STREAM, stream, body))
+
+    def h2_response(self, sock, stream=1, window_update=True):
+        resp = {'headers': {}, 'body': b''}
+        block = b''
+        end_stream = False
+
+        while True:
+            frame = self.frame_read(sock)
+            if frame is None:
+                pytest.fail('Connection closed.')
+
+            if frame['type'] == self.SETTINGS:
+                if not frame['flags'] & self.ACK:
+                    sock.sendall(self.frame(self.SETTINGS, self.ACK))
+
+                continue
+
+            if frame['type'] == self.GOAWAY:
+                resp['goaway'] = struct.unpack('!II', frame['payload'][:8])
+                return resp
+
+            if frame['stream'] != stream:
+                continue
+
+            if frame['type'] == self.RST_STREAM:
+                resp['reset'] = struct.unpack('!I', frame['payload'])[0]
+                return resp
+
+            if frame['type'] in (self.HEADERS, self.DATA):
+                end_stream = frame['flags'] & self.END_STREAM
+
+            if frame['type'] in (self.HEADERS, self.CONTINUATION):
+                block += frame['payload']
+
+                if not frame['flags'] & self.END_HEADERS:
+                    continue
+
+                for name, value in self.hpack_decode(block):
+                    if name == ':status':
+                        resp['status'] = int(value)
+                    else:
+                        resp['headers'][name] = value
+
+                block = b''
+
+            if frame['type'] == self.DATA:
+                resp['body'] += frame['payload']
+
+                if window_update and frame['payload']:
+                    size = len(frame['payload'])
+                    sock.sendall(
+                        self.window_update(0, size)
+                        + self.window_update(stream, size)
+                    )
+
+            if end_stream:
+                return resp
+
+    def h2_get(self, url='/', headers=None, port=7080, tls=False):
+        sock = self.h2_connect(port=port, tls=tls)
+
+        self.h2_request(
+            sock,
+            url=url,
+            headers=headers,
+            scheme='https' if tls else 'http',
+        )
+
+        resp = self.h2_response(sock)
+
+        sock.close()
+
+        return resp
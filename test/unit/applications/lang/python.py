@@ -49,6 +49,7 @@ class TestApplicationPython(TestApplicationProto):
             'limits',
             'path',
             'protocol',
+            'prototype',
             'targets',
             'threads',
         ):
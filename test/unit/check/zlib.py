@@ -0,0 +1,13 @@
+import re
+import subprocess
+
+
+def check_zlib(unitd):
+    output = subprocess.check_output(
+        [unitd, '--version'], stderr=subprocess.STDOUT
+    )
+
+    if re.search('--zlib', output.decode()):
+        return True
+
+    return False
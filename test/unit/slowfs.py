@@ -0,0 +1,159 @@
+import ctypes
+import errno
+import os
+import stat
+import struct
+import threading
+import time
+
+# A minimal read-only FUSE file system.  Looking up a name that starts
+# with "slow" takes "delay" seconds, so it simulates a slow network or
+# a cold disk.  Other lookups and all reads are answered at once.
+
+FUSE_LOOKUP = 1
+FUSE_FORGET = 2
+FUSE_GETATTR = 3
+FUSE_OPEN = 14
+FUSE_READ = 15
+FUSE_RELEASE = 18
+FUSE_FLUSH = 25
+FUSE_INIT = 26
+FUSE_OPENDIR = 27
+FUSE_RELEASEDIR = 29
+FUSE_INTERRUPT = 36
+FUSE_DESTROY = 38
+FUSE_BATCH_FORGET = 42
+
+NO_REPLY = (FUSE_FORGET, FUSE_INTERRUPT, FUSE_BATCH_FORGET)
+
+IN_HEADER = struct.Struct('=IIQQIIII')
+OUT_HEADER = struct.Struct('=IiQ')
+ATTR = struct.Struct('=QQQQQQIIIIIIIIII')
+ENTRY = struct.Struct('=QQQQII')
+READ_IN = struct.Struct('=QQII')
+
+MNT_DETACH = 2
+
+
+class SlowFS:
+    def __init__(self, mountpoint, files, delay):
+        self.mountpoint = mountpoint
+        self.files = {}
+        self.delay = delay
+
+        for ino, (name, data) in enumerate(files.items(), start=2):
+            self.files[ino] = (name.encode(), data)
+
+        self.libc = ctypes.CDLL(None, use_errno=True)
+
+        self.fd = os.open('/dev/fuse', os.O_RDWR)
+
+        opts = 'fd=%d,rootmode=40000,user_id=0,group_id=0,allow_other' % (
+            self.fd
+        )
+
+        if (
+            self.libc.mount(
+                b'slowfs', mountpoint.encode(), b'fuse', 0, opts.encode()
+            )
+            != 0
+        ):
+            os.close(self.fd)
+            raise OSError(ctypes.get_errno(), 'mount')
+
+        self.thread = threading.Thread(target=self._serve, daemon=True)
+        self.thread.start()
+
+    def umount(self):
+        self.libc.umount2(self.mountpoint.encode(), MNT_DETACH)
+        self.thread.join(5)
+        os.close(self.fd)
+
+    def _attr(self, ino):
+        if ino == 1:
+            mode, size = stat.S_IFDIR | 0o755, 0
+
+        else:
+            mode, size = stat.S_IFREG | 0o644, len(self.files[ino][1])
+
+        now = int(time.time())
+
+        return ATTR.pack(
+            ino, size, 0, now, now, now, 0, 0, 0, mode, 1, 0, 0, 0, 4096, 0
+        )
+
+    def _reply(self, unique, error=0, data=b''):
+        try:
+            os.write(
+                self.fd,
+                OUT_HEADER.pack(OUT_HEADER.size + len(data), -error, unique)
+                + data,
+            )
+
+        except OSError:
+            pass
+
+    def _serve(self):
+        while True:
+            try:
+                req = os.read(self.fd, 1 << 20)
+
+            except OSError as e:
+                if e.errno in (errno.EINTR, errno.ENOENT):
+                    continue
+
+                return
+
+            _, opcode, unique, ino, *_ = IN_HEADER.unpack_from(req)
+            arg = req[IN_HEADER.size :]
+
+            if opcode in NO_REPLY:
+                continue
+
+            if opcode == FUSE_INIT:
+                major, minor = struct.unpack_from('=II', arg)
+                init = struct.pack(
+                    '=IIIIHHIIHHI28x', 7, min(minor, 26), 0, 0, 0, 0, 4096,
+                    1, 0, 0, 0
+                )
+                self._reply(unique, data=init)
+
+            elif opcode == FUSE_LOOKUP:
+                name = arg.split(b'\0', 1)[0]
+
+                if name.startswith(b'slow'):
+                    time.sleep(self.delay)
+
+                for i, (fname, _) in self.files.items():
+                    if ino == 1 and fname == name:
+                        self._reply(
+                            unique,
+                            data=ENTRY.pack(i, 0, 0, 0, 0, 0) + self._attr(i),
+                        )
+                        break
+
+                else:
+                    self._reply(unique, errno.ENOENT)
+
+            elif opcode == FUSE_GETATTR:
+                self._reply(
+                    unique, data=struct.pack('=QII', 0, 0, 0) + self._attr(ino)
+                )
+
+            elif opcode in (FUSE_OPEN, FUSE_OPENDIR):
+                self._reply(unique, data=struct.pack('=QII', 0, 0, 0))
+
+            elif opcode == FUSE_READ:
+                _, offset, size, _ = READ_IN.unpack_from(arg)
+                data = self.files[ino][1]
+                self._reply(unique, data=data[offset : offset + size])
+
+            elif opcode in (FUSE_RELEASE, FUSE_RELEASEDIR, FUSE_FLUSH):
+                self._reply(unique)
+
+            elif opcode == FUSE_DESTROY:
+                self._reply(unique)
+                return
+
+            else:
+                self._reply(unique, errno.ENOSYS)